@@ -73,7 +73,13 @@ configEntry configKeysRestartCC[] = {
     ,
     {"EUCALYPTUS", "/"}
     ,
-    {"NC_FANOUT", "1"}
+    {"NC_FANOUT", NULL}
+    ,
+    {"NC_CLIENT_POOL", "Y"}
+    ,
+    {"NC_DESCRIBE_DELTA", "Y"}
+    ,
+    {"NC_POLL_CONCURRENCY", NULL}
     ,
     {"NC_PORT", "8775"}
     ,
@@ -95,6 +95,7 @@
 #include "axis2_skel_EucalyptusCC.h"
 
 #include <misc.h>
+#include <hash.h>
 #include <data.h>
 #include <ipc.h>
 #include <objectstorage.h>
@@ -115,6 +116,9 @@
 #include "client-marshal.h"
 #include "config-cc.h"
 #include "handlers-state.h"
+#include "nc-pool.h"
+#include "nc-poll.h"
+#include "sched-index.h"
 
 #include <stats.h>
 #include <message_stats.h>
@@ -149,6 +153,28 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+//! Node actions a poll callback found necessary but must not run from a worker
+//! thread (they may fork or take process-wide locks); the calling thread runs
+//! them once the round is over
+typedef struct ncDeferredActions_t {
+    boolean powerUp;                   //!< Call powerUp() on the node
+    boolean powerDown;                 //!< Call powerDown() on the node
+    char *migrationHost;               //!< Node to send the migration action to, if any
+    char *migrationInstance;           //!< Instance the migration action is for
+    char *migrationAction;             //!< Migration action ("commit" or "rollback")
+} ncDeferredActions;
+
+//! Arguments shared by the per-node callbacks of one NC poll round
+typedef struct ncRefreshArgs_t {
+    ncMetadata *pMeta;                 //!< Request metadata (each callback works on its own copy)
+    time_t op_start;                   //!< When the round started
+    int timeout;                       //!< Time budget of the round in seconds
+    int history_size;                  //!< Sensor history size (refresh_sensors() only)
+    long long collection_interval_time_ms;  //!< Sensor collection interval (refresh_sensors() only)
+    ncDeferredActions *deferred;       //!< Per-node actions to run after the round (one entry per node, may be NULL)
+    boolean fullDescribe;              //!< Ask every NC for its full instance list (refresh_instances() only)
+} ncRefreshArgs;
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                             EXTERNAL VARIABLES                             |
@@ -206,6 +232,7 @@ char *SCHEDPOLICIES[SCHEDLAST] = {
     "ROUNDROBIN",
     "POWERSAVE",
     "USER",
+    "BESTFIT",
 };
 
 /*----------------------------------------------------------------------------*\
@@ -222,11 +249,31 @@ char *SCHEDPOLICIES[SCHEDLAST] = {
 
 static void reconfigure_resourceCache(ccResource * res, int numHosts);
 static void refresh_resourceCache(ccResourceCache * updatedResourceCache, boolean do_purge_unconfigured);
+static void refresh_resourceCacheNode(ccResource * updatedResource);
+static int hash_instanceCacheKey(const char *key);
+static void link_instanceCacheChain(ccInstanceCacheChain * chain, int bucket, int slot);
+static void unlink_instanceCacheChain(ccInstanceCacheChain * chain, int slot);
+static void unindex_instanceCacheSlot(int slot);
+static void index_instanceCacheSlot(int slot);
+static void rebuild_instanceCacheIndex(void);
+static void check_instanceCacheIndex(void);
+static int lookup_instanceCacheId(const char *instanceId);
+static int lookup_instanceCacheIP(const char *ip);
+static void count_instanceCacheSlot(int slot, int delta);
+static int read_instanceNodeIdx(const ccInstance * inst, void *ncHostIdx);
+static void copy_poll_meta(ncMetadata * pDst, ncMetadata * pSrc);
+static void free_poll_meta(ncMetadata * pMeta);
+static void addrmap_changed(void);
+static void run_deferred_actions(ncMetadata * pMeta, ncDeferredActions * deferred, int numNodes);
+static int refresh_resources_node(int idx, void *arg);
+static int refresh_instances_node(int idx, void *arg);
+static int refresh_sensors_node(int idx, void *arg);
 
 static int schedule_instance_migration(ncInstance * instance, char **includeNodes, char **excludeNodes, int includeNodeCount, int excludeNodeCount, int inresid, int *outresid,
                                        ccResourceCache * resourceCacheLocal, char **replyString);
 static int migration_handler(ccInstance * myInstance, char *host, char *src, char *dst, migration_states migration_state, char **node, char **instance, char **action);
 static int populateOutboundMeta(ncMetadata * pMeta);
+static int ncClientCallPooled(ncMetadata * pMeta, int timeout, char *ncURL, char *ncOp, va_list al);
 static int initialize_stats_system(int interval_sec);
 static json_object **message_stats_getter();
 static void message_stats_setter();
@@ -374,12 +421,10 @@ int doBundleInstance(ncMetadata * pMeta, char *instanceId, char *bucketName, cha
 {
     int i, j, rc, start = 0, stop = 0, ret = 0, timeout, done;
     char internalObjectStorageURL[EUCA_MAX_PATH], theObjectStorageURL[EUCA_MAX_PATH];
-    ccInstance *myInstance;
     time_t op_start;
     ccResourceCache resourceCacheLocal;
 
     i = j = 0;
-    myInstance = NULL;
     op_start = time(NULL);
 
     rc = initialize(pMeta, FALSE);
@@ -415,14 +460,9 @@ int doBundleInstance(ncMetadata * pMeta, char *instanceId, char *bucketName, cha
     memcpy(&resourceCacheLocal, resourceCache, sizeof(ccResourceCache));
     sem_mypost(RESCACHE);
 
-    rc = find_instanceCacheId(instanceId, &myInstance);
-    if (!rc) {
+    if ((rc = find_instanceCacheNodeIdx(instanceId, &start)) == 0) {
         // found the instance in the cache
-        if (myInstance) {
-            start = myInstance->ncHostIdx;
-            stop = start + 1;
-            EUCA_FREE(myInstance);
-        }
+        stop = start + 1;
     } else {
         start = 0;
         stop = resourceCacheLocal.numResources;
@@ -469,7 +509,6 @@ int doBundleRestartInstance(ncMetadata * pMeta, char *instanceId)
     int ret = 0;
     int timeout = 0;
     int done = 0;
-    ccInstance *myInstance = NULL;
     time_t op_start = time(NULL);
     ccResourceCache resourceCacheLocal;
 
@@ -490,14 +529,9 @@ int doBundleRestartInstance(ncMetadata * pMeta, char *instanceId)
     }
     sem_mypost(RESCACHE);
 
-    if ((rc = find_instanceCacheId(instanceId, &myInstance)) == 0) {
+    if ((rc = find_instanceCacheNodeIdx(instanceId, &start)) == 0) {
         // found the instance in the cache
-        if (myInstance) {
-            start = myInstance->ncHostIdx;
-            stop = start + 1;
-            EUCA_FREE(myInstance);
-            myInstance = NULL;
-        }
+        stop = start + 1;
     } else {
         start = 0;
         stop = resourceCacheLocal.numResources;
@@ -535,12 +569,10 @@ int doBundleRestartInstance(ncMetadata * pMeta, char *instanceId)
 int doCancelBundleTask(ncMetadata * pMeta, char *instanceId)
 {
     int i, rc, start = 0, stop = 0, ret = 0, done, timeout;
-    ccInstance *myInstance;
     time_t op_start;
     ccResourceCache resourceCacheLocal;
 
     i = 0;
-    myInstance = NULL;
     op_start = time(NULL);
 
     rc = initialize(pMeta, FALSE);
@@ -558,14 +590,9 @@ int doCancelBundleTask(ncMetadata * pMeta, char *instanceId)
     memcpy(&resourceCacheLocal, resourceCache, sizeof(ccResourceCache));
     sem_mypost(RESCACHE);
 
-    rc = find_instanceCacheId(instanceId, &myInstance);
-    if (!rc) {
+    if ((rc = find_instanceCacheNodeIdx(instanceId, &start)) == 0) {
         // found the instance in the cache
-        if (myInstance) {
-            start = myInstance->ncHostIdx;
-            stop = start + 1;
-            EUCA_FREE(myInstance);
-        }
+        stop = start + 1;
     } else {
         start = 0;
         stop = resourceCacheLocal.numResources;
@@ -621,6 +648,271 @@ void filter_services(ncMetadata * meta, char *filter_partition)
     }
 }
 
+//!
+//! Non-forking variant of ncClientCall() that invokes the NC operation in the
+//! calling process using a stub from the NC client pool. Results are handed to
+//! the caller directly instead of being marshalled through a pipe, and the
+//! call deadline is enforced by the transport timeout of the stub.
+//!
+//! Unlike the forked path, the per-NC call semaphore is not taken: the pool
+//! hands out at most NC_POOL_STUBS_PER_NODE stubs per NC and blocks further
+//! callers until one is released, which is what bounds the load on each NC.
+//!
+//! @param[in] pMeta a pointer to the node controller (NC) metadata structure
+//! @param[in] timeout the call deadline in seconds (must be positive)
+//! @param[in] ncURL the NC endpoint URL
+//! @param[in] ncOp the operation name
+//! @param[in] al the operation arguments, as for ncClientCall()
+//!
+//! @return EUCA_OK on success, EUCA_ERROR or EUCA_TIMEOUT_ERROR on failure, or
+//!         EUCA_UNSUPPORTED_ERROR if no pooled stub was available and the caller
+//!         should fall back to the forking path
+//!
+static int ncClientCallPooled(ncMetadata * pMeta, int timeout, char *ncURL, char *ncOp, va_list al)
+{
+    int rc = 0;
+    long long startMs = 0;
+    long long elapsedMs = 0;
+    ncStub *ncs = NULL;
+    ncMetadata localmeta = { 0 };
+
+    LOGTRACE("invoked: ncOps=%s ncURL=%s timeout=%d (pooled)\n", ncOp, ncURL, timeout);
+
+    if ((ncs = nc_pool_acquire(ncURL, timeout, config->use_wssec, config->policyFile)) == NULL) {
+        return (EUCA_UNSUPPORTED_ERROR);
+    }
+
+    // the stubs free the correlation id, so hand them copies the caller keeps no reference to
+    memcpy(&localmeta, pMeta, sizeof(ncMetadata));
+    localmeta.correlationId = strdup((pMeta->correlationId) ? (pMeta->correlationId) : ("unset"));
+    localmeta.userId = strdup((pMeta->userId) ? (pMeta->userId) : ("eucalyptus"));
+    localmeta.replyString = NULL;
+    if (populateOutboundMeta(&localmeta)) {
+        LOGERROR("Failed to update output service metadata\n");
+    }
+
+    startMs = time_ms();
+    if (!strcmp(ncOp, "ncGetConsoleOutput")) {
+        char *instId = va_arg(al, char *);
+        char **consoleOutput = va_arg(al, char **);
+
+        if (consoleOutput)
+            *consoleOutput = NULL;
+        rc = ncGetConsoleOutputStub(ncs, &localmeta, instId, consoleOutput);
+        if (rc && consoleOutput)
+            EUCA_FREE(*consoleOutput);
+    } else if (!strcmp(ncOp, "ncAttachVolume")) {
+        char *instanceId = va_arg(al, char *);
+        char *volumeId = va_arg(al, char *);
+        char *remoteDev = va_arg(al, char *);
+        char *localDev = va_arg(al, char *);
+
+        rc = ncAttachVolumeStub(ncs, &localmeta, instanceId, volumeId, remoteDev, localDev);
+    } else if (!strcmp(ncOp, "ncDetachVolume")) {
+        char *instanceId = va_arg(al, char *);
+        char *volumeId = va_arg(al, char *);
+        char *remoteDev = va_arg(al, char *);
+        char *localDev = va_arg(al, char *);
+        int force = va_arg(al, int);
+
+        rc = ncDetachVolumeStub(ncs, &localmeta, instanceId, volumeId, remoteDev, localDev, force);
+    } else if (!strcmp(ncOp, "ncAttachNetworkInterface")) {
+        char *instanceId = va_arg(al, char *);
+        netConfig *netCfg = va_arg(al, netConfig *);
+
+        rc = ncAttachNetworkInterfaceStub(ncs, &localmeta, instanceId, netCfg);
+    } else if (!strcmp(ncOp, "ncDetachNetworkInterface")) {
+        char *instanceId = va_arg(al, char *);
+        char *attachmentId = va_arg(al, char *);
+        int force = va_arg(al, int);
+
+        rc = ncDetachNetworkInterfaceStub(ncs, &localmeta, instanceId, attachmentId, force);
+    } else if (!strcmp(ncOp, "ncCreateImage")) {
+        char *instanceId = va_arg(al, char *);
+        char *volumeId = va_arg(al, char *);
+        char *remoteDev = va_arg(al, char *);
+
+        rc = ncCreateImageStub(ncs, &localmeta, instanceId, volumeId, remoteDev);
+    } else if (!strcmp(ncOp, "ncPowerDown")) {
+        rc = ncPowerDownStub(ncs, &localmeta);
+    } else if (!strcmp(ncOp, "ncAssignAddress")) {
+        char *instanceId = va_arg(al, char *);
+        char *publicIp = va_arg(al, char *);
+
+        rc = ncAssignAddressStub(ncs, &localmeta, instanceId, publicIp);
+    } else if (!strcmp(ncOp, "ncBroadcastNetworkInfo")) {
+        char *networkInfo = va_arg(al, char *);
+
+        rc = ncBroadcastNetworkInfoStub(ncs, &localmeta, networkInfo);
+    } else if (!strcmp(ncOp, "ncRebootInstance")) {
+        char *instId = va_arg(al, char *);
+
+        rc = ncRebootInstanceStub(ncs, &localmeta, instId);
+    } else if (!strcmp(ncOp, "ncTerminateInstance")) {
+        char *instId = va_arg(al, char *);
+        int force = va_arg(al, int);
+        int *shutdownState = va_arg(al, int *);
+        int *previousState = va_arg(al, int *);
+
+        if (shutdownState && previousState)
+            *shutdownState = *previousState = 0;
+        rc = ncTerminateInstanceStub(ncs, &localmeta, instId, force, shutdownState, previousState);
+    } else if (!strcmp(ncOp, "ncStartNetwork")) {   //! @TODO remove this NC call logic, since it is not used any more
+        char *uuid = va_arg(al, char *);
+        char **peers = va_arg(al, char **);
+        int peersLen = va_arg(al, int);
+        int port = va_arg(al, int);
+        int vlan = va_arg(al, int);
+        char **outStatus = va_arg(al, char **);
+
+        if (outStatus)
+            *outStatus = NULL;
+        rc = ncStartNetworkStub(ncs, &localmeta, uuid, peers, peersLen, port, vlan, outStatus);
+    } else if (!strcmp(ncOp, "ncRunInstance")) {
+        char *uuid = va_arg(al, char *);
+        char *instId = va_arg(al, char *);
+        char *reservationId = va_arg(al, char *);
+        virtualMachine *ncvm = va_arg(al, virtualMachine *);
+        char *imageId = va_arg(al, char *);
+        char *imageURL = va_arg(al, char *);
+        char *kernelId = va_arg(al, char *);
+        char *kernelURL = va_arg(al, char *);
+        char *ramdiskId = va_arg(al, char *);
+        char *ramdiskURL = va_arg(al, char *);
+        char *ownerId = va_arg(al, char *);
+        char *accountId = va_arg(al, char *);
+        char *keyName = va_arg(al, char *);
+        netConfig *ncnet = va_arg(al, netConfig *);
+        char *userData = va_arg(al, char *);
+        char *credential = va_arg(al, char *);
+        char *launchIndex = va_arg(al, char *);
+        char *platform = va_arg(al, char *);
+        int expiryTime = va_arg(al, int);
+        char **netNames = va_arg(al, char **);
+        int netNamesLen = va_arg(al, int);
+        char *rootDirective = va_arg(al, char *);
+        char **netIds = va_arg(al, char **);
+        int netIdsLen = va_arg(al, int);
+        netConfig *secNetCfgs = va_arg(al, netConfig *);
+        int secNetCfgsLen = va_arg(al, int);
+        ncInstance **outInst = va_arg(al, ncInstance **);
+
+        if (outInst)
+            *outInst = NULL;
+        rc = ncRunInstanceStub(ncs, &localmeta, uuid, instId, reservationId, ncvm, imageId, imageURL, kernelId, kernelURL, ramdiskId, ramdiskURL,
+                               ownerId, accountId, keyName, ncnet, userData, credential, launchIndex, platform, expiryTime, netNames, netNamesLen, rootDirective, netIds,
+                               netIdsLen, secNetCfgs, secNetCfgsLen, outInst);
+    } else if (!strcmp(ncOp, "ncDescribeInstances")) {
+        char **instIds = va_arg(al, char **);
+        int instIdsLen = va_arg(al, int);
+        ncInstance ***ncOutInsts = va_arg(al, ncInstance ***);
+        int *ncOutInstsLen = va_arg(al, int *);
+
+        if (ncOutInsts && ncOutInstsLen) {
+            *ncOutInsts = NULL;
+            *ncOutInstsLen = 0;
+        }
+        rc = ncDescribeInstancesStub(ncs, &localmeta, instIds, instIdsLen, ncOutInsts, ncOutInstsLen);
+    } else if (!strcmp(ncOp, "ncDescribeInstancesSince")) {
+        long long sinceEpoch = va_arg(al, long long);
+        long long sinceSeq = va_arg(al, long long);
+        ncInstance ***ncOutInsts = va_arg(al, ncInstance ***);
+        int *ncOutInstsLen = va_arg(al, int *);
+        char ***removedIds = va_arg(al, char ***);
+        int *removedIdsLen = va_arg(al, int *);
+        long long *outEpoch = va_arg(al, long long *);
+        long long *outSeq = va_arg(al, long long *);
+        boolean *isDelta = va_arg(al, boolean *);
+
+        rc = ncDescribeInstancesSinceStub(ncs, &localmeta, sinceEpoch, sinceSeq, ncOutInsts, ncOutInstsLen, removedIds, removedIdsLen, outEpoch, outSeq, isDelta);
+    } else if (!strcmp(ncOp, "ncDescribeResource")) {
+        char *resourceType = va_arg(al, char *);
+        ncResource **outRes = va_arg(al, ncResource **);
+        char **errMsg = va_arg(al, char **);
+        const char *axisMsg = NULL;
+
+        if (outRes)
+            *outRes = NULL;
+        rc = ncDescribeResourceStub(ncs, &localmeta, resourceType, outRes);
+        if ((rc || (outRes && (*outRes == NULL))) && errMsg) {
+            if ((axisMsg = axutil_error_get_message(ncs->env->error)) != NULL) {
+                *errMsg = strndup(axisMsg, 1024 - 1);
+            }
+            rc = 1;
+        }
+    } else if (!strcmp(ncOp, "ncDescribeSensors")) {
+        int history_size = va_arg(al, int);
+        long long collection_interval_time_ms = va_arg(al, long long);
+        char **instIds = va_arg(al, char **);
+        int instIdsLen = va_arg(al, int);
+        char **sensorIds = va_arg(al, char **);
+        int sensorIdsLen = va_arg(al, int);
+        sensorResource ***srs = va_arg(al, sensorResource ***);
+        int *srsLen = va_arg(al, int *);
+
+        if (srs && srsLen) {
+            *srs = NULL;
+            *srsLen = 0;
+        }
+        rc = ncDescribeSensorsStub(ncs, &localmeta, history_size, collection_interval_time_ms, instIds, instIdsLen, sensorIds, sensorIdsLen, srs, srsLen);
+    } else if (!strcmp(ncOp, "ncBundleInstance")) {
+        char *instanceId = va_arg(al, char *);
+        char *bucketName = va_arg(al, char *);
+        char *filePrefix = va_arg(al, char *);
+        char *objectStorageURL = va_arg(al, char *);
+        char *userPublicKey = va_arg(al, char *);
+        char *S3Policy = va_arg(al, char *);
+        char *S3PolicySig = va_arg(al, char *);
+        char *architecture = va_arg(al, char *);
+
+        rc = ncBundleInstanceStub(ncs, &localmeta, instanceId, bucketName, filePrefix, objectStorageURL, userPublicKey, S3Policy, S3PolicySig, architecture);
+    } else if (!strcmp(ncOp, "ncBundleRestartInstance")) {
+        char *instanceId = va_arg(al, char *);
+        rc = ncBundleRestartInstanceStub(ncs, &localmeta, instanceId);
+    } else if (!strcmp(ncOp, "ncCancelBundleTask")) {
+        char *instanceId = va_arg(al, char *);
+        rc = ncCancelBundleTaskStub(ncs, &localmeta, instanceId);
+    } else if (!strcmp(ncOp, "ncModifyNode")) {
+        char *stateName = va_arg(al, char *);
+        rc = ncModifyNodeStub(ncs, &localmeta, stateName);
+    } else if (!strcmp(ncOp, "ncMigrateInstances")) {
+        ncInstance **instances = va_arg(al, ncInstance **);
+        int instancesLen = va_arg(al, int);
+        char *action = va_arg(al, char *);
+        char *credentials = va_arg(al, char *);
+        char **resourceLocations = va_arg(al, char **);
+        int resourceLocationsLen = va_arg(al, int);
+        rc = ncMigrateInstancesStub(ncs, &localmeta, instances, instancesLen, action, credentials, resourceLocations, resourceLocationsLen);
+    } else if (!strcmp(ncOp, "ncStartInstance")) {
+        char *instanceId = va_arg(al, char *);
+        rc = ncStartInstanceStub(ncs, &localmeta, instanceId);
+    } else if (!strcmp(ncOp, "ncStopInstance")) {
+        char *instanceId = va_arg(al, char *);
+        rc = ncStopInstanceStub(ncs, &localmeta, instanceId);
+    } else {
+        LOGWARN("\tncOps=%s operation '%s' not found\n", ncOp, ncOp);
+        rc = 1;
+    }
+    elapsedMs = time_ms() - startMs;
+
+    if (localmeta.replyString != NULL) {
+        LOGDEBUG("NC replied to '%s' with '%s'\n", ncOp, localmeta.replyString);
+        EUCA_FREE(pMeta->replyString);
+        pMeta->replyString = localmeta.replyString;
+    }
+    EUCA_FREE(localmeta.correlationId);
+    EUCA_FREE(localmeta.userId);
+
+    nc_pool_release(ncs, rc, elapsedMs);
+
+    LOGTRACE("done ncOps=%s clientrc=%d elapsed=%lldms (pooled)\n", ncOp, rc, elapsedMs);
+    if (rc == 0)
+        return (EUCA_OK);
+    if (elapsedMs >= (((long long)timeout) * 1000LL))
+        return (EUCA_TIMEOUT_ERROR);
+    return (EUCA_ERROR);
+}
+
 //!
 //!
 //!
@@ -691,6 +983,28 @@ int ncClientCall(ncMetadata * pMeta, int timeout, int ncLock, char *ncURL, char
     int filedes[2] = { 0 };
     va_list al = { {0} };
 
+    // calls with a deadline go through the pooled, non-forking path; fire-and-forget
+    // calls (timeout == 0) still fork so that the caller never waits on the NC
+    if (timeout && config->ncClientPool) {
+        va_start(al, ncOp);
+        rc = ncClientCallPooled(pMeta, timeout, ncURL, ncOp, al);
+        va_end(al);
+        if (rc != EUCA_UNSUPPORTED_ERROR) {
+            return (rc);
+        }
+        LOGDEBUG("no pooled stub available for %s, falling back to forked call for '%s'\n", ncURL, ncOp);
+    }
+
+    // the forked path cannot carry the change sequence back, the caller will ask for the full list instead
+    if (!strcmp(ncOp, "ncDescribeInstancesSince")) {
+        return (EUCA_UNSUPPORTED_ERROR);
+    }
+    // never fork next to other poll workers, the child could inherit their locks
+    if (nc_poll_in_threaded_round()) {
+        LOGERROR("no pooled stub available for %s, failing '%s' rather than forking from a poll worker\n", ncURL, ncOp);
+        return (EUCA_ERROR);
+    }
+
     LOGTRACE("invoked: ncOps=%s ncURL=%s timeout=%d\n", ncOp, ncURL, timeout);  // these are common
 
     if ((rc = pipe(filedes)) != 0) {
@@ -1466,12 +1780,10 @@ int ncGetTimeout(time_t op_start, time_t op_max, int numCalls, int idx)
 int doAttachVolume(ncMetadata * pMeta, char *volumeId, char *instanceId, char *remoteDev, char *localDev)
 {
     int i, rc, start = 0, stop = 0, ret = 0, done = 0, timeout;
-    ccInstance *myInstance;
     time_t op_start;
     ccResourceCache resourceCacheLocal;
 
     i = 0;
-    myInstance = NULL;
     op_start = time(NULL);
 
     rc = initialize(pMeta, FALSE);
@@ -1491,14 +1803,9 @@ int doAttachVolume(ncMetadata * pMeta, char *volumeId, char *instanceId, char *r
     memcpy(&resourceCacheLocal, resourceCache, sizeof(ccResourceCache));
     sem_mypost(RESCACHE);
 
-    rc = find_instanceCacheId(instanceId, &myInstance);
-    if (!rc) {
+    if ((rc = find_instanceCacheNodeIdx(instanceId, &start)) == 0) {
         // found the instance in the cache
-        if (myInstance) {
-            start = myInstance->ncHostIdx;
-            stop = start + 1;
-            EUCA_FREE(myInstance);
-        }
+        stop = start + 1;
     } else {
         start = 0;
         stop = resourceCacheLocal.numResources;
@@ -1546,12 +1853,10 @@ int doAttachVolume(ncMetadata * pMeta, char *volumeId, char *instanceId, char *r
 int doDetachVolume(ncMetadata * pMeta, char *volumeId, char *instanceId, char *remoteDev, char *localDev, int force)
 {
     int i, rc, start = 0, stop = 0, ret = 0, done = 0, timeout;
-    ccInstance *myInstance;
     time_t op_start;
     ccResourceCache resourceCacheLocal;
 
     i = 0;
-    myInstance = NULL;
     op_start = time(NULL);
 
     rc = initialize(pMeta, FALSE);
@@ -1570,14 +1875,9 @@ int doDetachVolume(ncMetadata * pMeta, char *volumeId, char *instanceId, char *r
     memcpy(&resourceCacheLocal, resourceCache, sizeof(ccResourceCache));
     sem_mypost(RESCACHE);
 
-    rc = find_instanceCacheId(instanceId, &myInstance);
-    if (!rc) {
+    if ((rc = find_instanceCacheNodeIdx(instanceId, &start)) == 0) {
         // found the instance in the cache
-        if (myInstance) {
-            start = myInstance->ncHostIdx;
-            stop = start + 1;
-            EUCA_FREE(myInstance);
-        }
+        stop = start + 1;
     } else {
         start = 0;
         stop = resourceCacheLocal.numResources;
@@ -1727,6 +2027,7 @@ int doAssignAddress(ncMetadata * pMeta, char *uuid, char *src, char *dst)
         if ((rc = map_instanceCache(privIpCmp, dst, pubIpSet, src)) != 0) {
             LOGERROR("map_instanceCache() failed to assign %s->%s\n", dst, src);
         } else {
+            addrmap_changed();
             if ((rc = find_instanceCacheIP(src, &myInstance)) == 0) {
                 LOGDEBUG("found instance (%s) in cache with IP (%s)\n", myInstance->instanceId, myInstance->ccnet.publicIp);
                 // found the instance in the cache
@@ -1809,6 +2110,8 @@ int doUnassignAddress(ncMetadata * pMeta, char *src, char *dst)
             // refresh instance cache
             if ((rc = map_instanceCache(pubIpCmp, src, pubIpSet, "0.0.0.0")) != 0) {
                 LOGERROR("map_instanceCache() failed to assign %s->%s\n", dst, src);
+            } else {
+                addrmap_changed();
             }
             // TODO swathi should this account for public ip of secondary enis?
         }
@@ -2200,7 +2503,7 @@ int broadcast_network_info(ncMetadata * pMeta, int timeout, int dolock)
     sem_mypost(RESCACHE);
 
     sem_close(locks[REFRESHLOCK]);
-    locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncFanout);
+    locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncPollConcurrency);
 
     pids = EUCA_ZALLOC(resourceCacheStage->numResources, sizeof(int));
     if (!pids) {
@@ -2234,7 +2537,7 @@ int broadcast_network_info(ncMetadata * pMeta, int timeout, int dolock)
         if (!rc) {
             // timed out, really bad failure (reset REFRESHLOCK semaphore)
             sem_close(locks[REFRESHLOCK]);
-            locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncFanout);
+            locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncPollConcurrency);
             rc = 1;
         } else if (rc > 0) {
             // process exited, and wait picked it up.
@@ -2259,13 +2562,203 @@ int broadcast_network_info(ncMetadata * pMeta, int timeout, int dolock)
 }
 
 //!
+//! Gives a poll worker its own copy of the round's NC metadata. The identifiers
+//! are duplicated so that no two workers share, or free, the same string.
+//!
+//! @param[out] pDst the worker's metadata
+//! @param[in] pSrc the metadata of the polling round
+//!
+//! @see free_poll_meta()
+//!
+static void copy_poll_meta(ncMetadata * pDst, ncMetadata * pSrc)
+{
+    memcpy(pDst, pSrc, sizeof(ncMetadata));
+    pDst->correlationId = ((pSrc->correlationId) ? strdup(pSrc->correlationId) : NULL);
+    pDst->userId = ((pSrc->userId) ? strdup(pSrc->userId) : NULL);
+    pDst->replyString = NULL;
+}
+
+//!
+//! Releases the strings owned by a poll worker's copy of the NC metadata.
+//!
+//! @param[in] pMeta the worker's metadata, as set by copy_poll_meta()
+//!
+static void free_poll_meta(ncMetadata * pMeta)
+{
+    EUCA_FREE(pMeta->correlationId);
+    EUCA_FREE(pMeta->userId);
+    EUCA_FREE(pMeta->replyString);
+}
+
+//!
+//! Records that the CC changed the public address mapping of an instance, so that
+//! the next instance poll asks every NC for its full list and resyncs addresses.
+//!
+static void addrmap_changed(void)
+{
+    sem_mywait(CONFIG);
+    config->addrMapSeq++;
+    sem_mypost(CONFIG);
+}
+
+//!
+//! Runs, on the calling thread, the node actions the poll workers of a round
+//! deferred, and releases them.
+//!
+//! @param[in] pMeta a pointer to the node controller (NC) metadata structure
+//! @param[in] deferred the per-node actions collected during the round
+//! @param[in] numNodes the number of entries in deferred
+//!
+//! @pre must not be called from a poll worker
+//!
+static void run_deferred_actions(ncMetadata * pMeta, ncDeferredActions * deferred, int numNodes)
+{
+    int i = 0;
+    ccResource *res = NULL;
+
+    if (deferred == NULL)
+        return;
+
+    for (i = 0; i < numNodes; i++) {
+        res = &(resourceCacheStage->resources[i]);
+        if (deferred[i].powerUp) {
+            powerUp(res);
+        }
+        if (deferred[i].powerDown && powerDown(pMeta, res)) {
+            LOGWARN("powerDown for %s failed\n", res->hostname);
+        }
+        if (deferred[i].migrationHost) {
+            if (!strcmp(deferred[i].migrationAction, "commit")) {
+                LOGDEBUG("[%s] notifying source %s to commit migration\n", deferred[i].migrationInstance, deferred[i].migrationHost);
+                // Note: Really only need to specify the instance here.
+                doMigrateInstances(pMeta, deferred[i].migrationHost, deferred[i].migrationInstance, NULL, 0, 0, "commit", NULL, 0);
+            } else if (!strcmp(deferred[i].migrationAction, "rollback")) {
+                LOGDEBUG("[%s] notifying node %s to roll back migration\n", deferred[i].migrationInstance, deferred[i].migrationHost);
+                doMigrateInstances(pMeta, deferred[i].migrationHost, deferred[i].migrationInstance, NULL, 0, 0, "rollback", NULL, 0);
+            } else {
+                LOGWARN("unexpected migration action '%s' for node %s -- doing nothing\n", deferred[i].migrationAction, deferred[i].migrationHost);
+            }
+        }
+        EUCA_FREE(deferred[i].migrationHost);
+        EUCA_FREE(deferred[i].migrationInstance);
+        EUCA_FREE(deferred[i].migrationAction);
+    }
+}
+
+//!
+//! Polls one NC for its resources on behalf of refresh_resources(). Runs in a
+//! poll worker thread; the node's entry in resourceCacheStage is only touched
+//! by this worker during the round.
+//!
+//! @param[in] idx index of the node in resourceCacheStage
+//! @param[in] arg a pointer to the ncRefreshArgs of the round
+//!
+//! @return EUCA_OK on success or EUCA_ERROR if the node did not answer
+//!
+//! @see nc_poll_run()
+//!
+static int refresh_resources_node(int idx, void *arg)
+{
+    int rc = EUCA_OK;
+    int nctimeout = 0;
+    char *mac = NULL;
+    char *errMsg = NULL;
+    long long startMs = 0;
+    ncMetadata meta = { 0 };
+    ncResource *ncResDst = NULL;
+    ncRefreshArgs *args = ((ncRefreshArgs *) arg);
+    ccResource *res = &(resourceCacheStage->resources[idx]);
+
+    copy_poll_meta(&meta, args->pMeta);
+
+    if (res->state != RESASLEEP && res->running == 0) {
+        nctimeout = ncGetTimeout(args->op_start, args->timeout, 1, 1);
+        startMs = time_ms();
+        rc = ncClientCall(&meta, nctimeout, res->lockidx, res->ncURL, "ncDescribeResource", NULL, &ncResDst, &errMsg);
+        res->rttMs = time_ms() - startMs;
+        if (rc != 0) {
+            // powerUp() is left to the calling thread once the round is over
+            if (args->deferred)
+                args->deferred[idx].powerUp = TRUE;
+
+            if (res->state == RESWAKING && ((time(NULL) - res->stateChange) < config->wakeThresh)) {
+                LOGDEBUG("resource still waking up (%ld more seconds until marked as down)\n", config->wakeThresh - (time(NULL) - res->stateChange));
+            } else {
+                LOGERROR("bad return from ncDescribeResource(%s) (%d)\n", res->hostname, rc);
+                res->maxMemory = 0;
+                res->availMemory = 0;
+                res->maxDisk = 0;
+                res->availDisk = 0;
+                res->maxCores = 0;
+                res->availCores = 0;
+                changeState(res, RESDOWN);
+                res->ncState = NOTREADY;
+                res->migrationCapable = FALSE;
+                euca_strncpy(res->nodeMessage, SP(errMsg), 1024);
+                LOGERROR("error message from ncDescribeResource: %s\n", res->nodeMessage);
+            }
+            rc = EUCA_ERROR;
+        } else {
+            LOGDEBUG("received data from node=%s status=%s mem=%d/%d disk=%d/%d cores=%d/%d migrationCapable=%s rtt=%lldms\n",
+                     res->hostname,
+                     ncResDst->nodeStatus,
+                     ncResDst->memorySizeAvailable, ncResDst->memorySizeMax,
+                     ncResDst->diskSizeAvailable, ncResDst->diskSizeMax, ncResDst->numberOfCoresAvailable, ncResDst->numberOfCoresMax,
+                     (ncResDst->migrationCapable == TRUE) ? "TRUE" : "FALSE", res->rttMs);
+            res->maxMemory = ncResDst->memorySizeMax;
+            res->availMemory = ncResDst->memorySizeAvailable;
+            res->maxDisk = ncResDst->diskSizeMax;
+            res->availDisk = ncResDst->diskSizeAvailable;
+            res->maxCores = ncResDst->numberOfCoresMax;
+            res->availCores = ncResDst->numberOfCoresAvailable;
+            if (!strcmp(ncResDst->nodeStatus, "enabled")) {
+                res->ncState = ENABLED;
+            } else if (!strcmp(ncResDst->nodeStatus, "disabled")) {
+                res->ncState = STOPPED;
+            }
+            res->migrationCapable = ncResDst->migrationCapable;
+            euca_strncpy(res->nodeStatus, ncResDst->nodeStatus, 24);
+            strcpy(res->nodeMessage, "");
+            // set iqn, if set
+            if (strlen(ncResDst->iqn)) {
+                snprintf(res->iqn, 128, "%s", ncResDst->iqn);
+            }
+            if (strlen(ncResDst->hypervisor)) {
+                euca_strncpy(res->hypervisor, ncResDst->hypervisor, 16);
+            }
+            changeState(res, RESUP);
+        }
+        EUCA_FREE(errMsg);
+    } else {
+        LOGDEBUG("resource asleep/running instances (%d), skipping resource update\n", res->running);
+    }
+
+    // try to discover the mac address of the resource
+    if (res->mac[0] == '\0' && res->ip[0] != '\0') {
+        if (!IP2MAC(res->ip, &mac)) {
+            euca_strncpy(res->mac, mac, 24);
+            EUCA_FREE(mac);
+            LOGDEBUG("discovered MAC '%s' for host %s(%s)\n", res->mac, res->hostname, res->ip);
+        }
+    }
+
+    // make the reply visible to the scheduler right away instead of at the end of the round
+    refresh_resourceCacheNode(res);
+
+    EUCA_FREE(ncResDst);
+    free_poll_meta(&meta);
+    return (rc);
+}
+
 //!
+//! Polls every NC for its resources, with at most NC_POLL_CONCURRENCY
+//! requests in flight, and merges the replies into the resource cache.
 //!
 //! @param[in] pMeta a pointer to the node controller (NC) metadata structure
 //! @param[in] timeout
 //! @param[in] dolock
 //!
-//! @return
+//! @return Always 0
 //!
 //! @pre
 //!
@@ -2273,15 +2766,12 @@ int broadcast_network_info(ncMetadata * pMeta, int timeout, int dolock)
 //!
 int refresh_resources(ncMetadata * pMeta, int timeout, int dolock)
 {
-    int i, rc, nctimeout, pid, *pids = NULL;
-    int status;
-    time_t op_start;
-    ncResource *ncResDst = NULL;
+    ncRefreshArgs args = { 0 };
+    ncPollSummary summary = { 0 };
 
     if (timeout <= 0)
         timeout = 1;
 
-    op_start = time(NULL);
     LOGDEBUG("invoked: timeout=%d, dolock=%d\n", timeout, dolock);
 
     // critical NC call section
@@ -2289,138 +2779,26 @@ int refresh_resources(ncMetadata * pMeta, int timeout, int dolock)
     memcpy(resourceCacheStage, resourceCache, sizeof(ccResourceCache));
     sem_mypost(RESCACHE);
 
-    sem_close(locks[REFRESHLOCK]);
-    locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncFanout);
-
-    pids = EUCA_ZALLOC(resourceCacheStage->numResources, sizeof(int));
-    if (!pids) {
-        LOGFATAL("out of memory!\n");
-        unlock_exit(1);
-    }
-
-    for (i = 0; i < resourceCacheStage->numResources; i++) {
-        sem_mywait(REFRESHLOCK);
-
-        pid = fork();
-        if (!pid) {
-            ncResDst = NULL;
-            if (resourceCacheStage->resources[i].state != RESASLEEP && resourceCacheStage->resources[i].running == 0) {
-                nctimeout = ncGetTimeout(op_start, timeout, 1, 1);
-                char *errMsg = NULL;
-                rc = ncClientCall(pMeta, nctimeout, resourceCacheStage->resources[i].lockidx, resourceCacheStage->resources[i].ncURL,
-                                  "ncDescribeResource", NULL, &ncResDst, &errMsg);
-                if (rc != 0) {
-                    powerUp(&(resourceCacheStage->resources[i]));
-
-                    if (resourceCacheStage->resources[i].state == RESWAKING && ((time(NULL) - resourceCacheStage->resources[i].stateChange) < config->wakeThresh)) {
-                        LOGDEBUG("resource still waking up (%ld more seconds until marked as down)\n",
-                                 config->wakeThresh - (time(NULL) - resourceCacheStage->resources[i].stateChange));
-                    } else {
-                        LOGERROR("bad return from ncDescribeResource(%s) (%d)\n", resourceCacheStage->resources[i].hostname, rc);
-                        resourceCacheStage->resources[i].maxMemory = 0;
-                        resourceCacheStage->resources[i].availMemory = 0;
-                        resourceCacheStage->resources[i].maxDisk = 0;
-                        resourceCacheStage->resources[i].availDisk = 0;
-                        resourceCacheStage->resources[i].maxCores = 0;
-                        resourceCacheStage->resources[i].availCores = 0;
-                        changeState(&(resourceCacheStage->resources[i]), RESDOWN);
-                        resourceCacheStage->resources[i].ncState = NOTREADY;
-                        resourceCacheStage->resources[i].migrationCapable = FALSE;
-                        euca_strncpy(resourceCacheStage->resources[i].nodeMessage, SP(errMsg), 1024);
-                        LOGERROR("error message from ncDescribeResource: %s\n", resourceCacheStage->resources[i].nodeMessage);
-                    }
-                } else {
-                    LOGDEBUG("received data from node=%s status=%s mem=%d/%d disk=%d/%d cores=%d/%d migrationCapable=%s\n",
-                             resourceCacheStage->resources[i].hostname,
-                             ncResDst->nodeStatus,
-                             ncResDst->memorySizeAvailable, ncResDst->memorySizeMax,
-                             ncResDst->diskSizeAvailable, ncResDst->diskSizeMax, ncResDst->numberOfCoresAvailable, ncResDst->numberOfCoresMax,
-                             (ncResDst->migrationCapable == TRUE) ? "TRUE" : "FALSE");
-                    resourceCacheStage->resources[i].maxMemory = ncResDst->memorySizeMax;
-                    resourceCacheStage->resources[i].availMemory = ncResDst->memorySizeAvailable;
-                    resourceCacheStage->resources[i].maxDisk = ncResDst->diskSizeMax;
-                    resourceCacheStage->resources[i].availDisk = ncResDst->diskSizeAvailable;
-                    resourceCacheStage->resources[i].maxCores = ncResDst->numberOfCoresMax;
-                    resourceCacheStage->resources[i].availCores = ncResDst->numberOfCoresAvailable;
-                    if (!strcmp(ncResDst->nodeStatus, "enabled")) {
-                        resourceCacheStage->resources[i].ncState = ENABLED;
-                    } else if (!strcmp(ncResDst->nodeStatus, "disabled")) {
-                        resourceCacheStage->resources[i].ncState = STOPPED;
-                    }
-                    resourceCacheStage->resources[i].migrationCapable = ncResDst->migrationCapable;
-                    euca_strncpy(resourceCacheStage->resources[i].nodeStatus, ncResDst->nodeStatus, 24);
-////                    // temporarily duplicate the NC reported value in the node message for debugging
-                    strcpy(resourceCacheStage->resources[i].nodeMessage, "");
-                    // set iqn, if set
-                    if (strlen(ncResDst->iqn)) {
-                        snprintf(resourceCacheStage->resources[i].iqn, 128, "%s", ncResDst->iqn);
-                    }
-                    if (strlen(ncResDst->hypervisor)) {
-                        euca_strncpy(resourceCacheStage->resources[i].hypervisor, ncResDst->hypervisor, 16);
-                    }
-                    changeState(&(resourceCacheStage->resources[i]), RESUP);
-                }
-                if (errMsg != NULL) {
-                    EUCA_FREE(errMsg);
-                }
-            } else {
-                LOGDEBUG("resource asleep/running instances (%d), skipping resource update\n", resourceCacheStage->resources[i].running);
-            }
-
-            // try to discover the mac address of the resource
-            if (resourceCacheStage->resources[i].mac[0] == '\0' && resourceCacheStage->resources[i].ip[0] != '\0') {
-                char *mac;
-                rc = IP2MAC(resourceCacheStage->resources[i].ip, &mac);
-                if (!rc) {
-                    euca_strncpy(resourceCacheStage->resources[i].mac, mac, 24);
-                    EUCA_FREE(mac);
-                    LOGDEBUG("discovered MAC '%s' for host %s(%s)\n", resourceCacheStage->resources[i].mac,
-                             resourceCacheStage->resources[i].hostname, resourceCacheStage->resources[i].ip);
-                }
-            }
-
-            EUCA_FREE(ncResDst);
-            sem_mypost(REFRESHLOCK);
-            exit(0);
-        } else {
-            pids[i] = pid;
-        }
-    }
-
-    for (i = 0; i < resourceCacheStage->numResources; i++) {
-        rc = timewait(pids[i], &status, 120);
-        if (!rc) {
-            // timed out, really bad failure (reset REFRESHLOCK semaphore)
-            sem_close(locks[REFRESHLOCK]);
-            locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncFanout);
-            rc = 1;
-        } else if (rc > 0) {
-            // process exited, and wait picked it up.
-            if (WIFEXITED(status)) {
-                rc = WEXITSTATUS(status);
-            } else {
-                rc = 1;
-            }
-        } else {
-            // process no longer exists, and someone else reaped it
-            rc = 0;
-        }
-        if (rc) {
-            LOGWARN("error waiting for child pid '%d', exit code '%d'\n", pids[i], rc);
-        }
-    }
-
-    // resourceCacheStage[] entries were updated based on replies from NC,
-    // so merge them into the canonical location: resourceCache[] (no
-    // need to try removing hosts, since instanceCache membership
-    // does not change as part of the update)
+    args.pMeta = pMeta;
+    args.op_start = time(NULL);
+    args.timeout = timeout;
+    args.deferred = EUCA_ZALLOC(maxint(resourceCacheStage->numResources, 1), sizeof(ncDeferredActions));
+    nc_poll_run("ncDescribeResource", resourceCacheStage->numResources, config->ncPollConcurrency, refresh_resources_node, &args, NULL, &summary);
+    run_deferred_actions(pMeta, args.deferred, resourceCacheStage->numResources);
+    EUCA_FREE(args.deferred);
+    if (summary.slowestIdx >= 0) {
+        LOGDEBUG("slowest node %s answered ncDescribeResource in %lld ms\n", resourceCacheStage->resources[summary.slowestIdx].hostname,
+                 resourceCacheStage->resources[summary.slowestIdx].rttMs);
+    }
+
+    // resourceCacheStage[] entries were updated based on replies from NC
+    // and merged one by one as they came in; this final pass only takes
+    // care of hosts that are no longer in the configuration
     refresh_resourceCache(resourceCacheStage, FALSE);
 
-    EUCA_FREE(pids);
     LOGTRACE("done\n");
     return (0);
 }
-
 //!
 //! @param[in] myInstance instance to check for migration
 //! @param[in] host reported hostname
@@ -2526,13 +2904,216 @@ static int migration_handler(ccInstance * myInstance, char *host, char *src, cha
 }
 
 //!
+//! Polls one NC for its instances on behalf of refresh_instances() and
+//! updates the instance cache with every instance as soon as the reply is in.
+//! Runs in a poll worker thread.
+//!
+//! With NC_DESCRIBE_DELTA the NC is asked only for the instances that changed
+//! since the change sequence it returned last time; the cached instances it
+//! left out are simply marked as seen. A full list is requested every
+//! NC_DESCRIBE_FULL_ROUNDS rounds, after any error and while an instance of
+//! the node is migrating.
+//!
+//! @param[in] idx index of the node in resourceCacheStage
+//! @param[in] arg a pointer to the ncRefreshArgs of the round
+//!
+//! @return EUCA_OK on success or EUCA_ERROR if the node did not answer
+//!
+//! @see nc_poll_run()
+//!
+static int refresh_instances_node(int idx, void *arg)
+{
+    int j = 0;
+    int rc = EUCA_OK;
+    int nctimeout = 0;
+    int ncOutInstsLen = 0;
+    int removedIdsLen = 0;
+    int numInsts = 0;
+    char *ip = NULL;
+    char *migration_host = NULL;
+    char *migration_instance = NULL;
+    char *migration_action = NULL;
+    char **removedIds = NULL;
+    long long sinceSeq = 0;
+    long long outEpoch = 0;
+    long long outSeq = 0;
+    boolean isDelta = FALSE;
+    boolean migrating = FALSE;
+    ncMetadata meta = { 0 };
+    ncInstance **ncOutInsts = NULL;
+    ccInstance *myInstance = NULL;
+    ncRefreshArgs *args = ((ncRefreshArgs *) arg);
+    ccResource *res = &(resourceCacheStage->resources[idx]);
+
+    if (res->state != RESUP) {
+        res->instSeq = 0;
+        return (EUCA_OK);
+    }
+
+    copy_poll_meta(&meta, args->pMeta);
+
+    nctimeout = ncGetTimeout(args->op_start, args->timeout, 1, 1);
+    rc = EUCA_UNSUPPORTED_ERROR;
+    if (config->ncDescribeDelta) {
+        sinceSeq = ((!args->fullDescribe && (res->instDeltaRounds < NC_DESCRIBE_FULL_ROUNDS)) ? res->instSeq : 0);
+        rc = ncClientCall(&meta, nctimeout, res->lockidx, res->ncURL, "ncDescribeInstancesSince", res->instSeqEpoch, sinceSeq, &ncOutInsts, &ncOutInstsLen,
+                          &removedIds, &removedIdsLen, &outEpoch, &outSeq, &isDelta);
+    }
+    if ((rc != EUCA_OK) && (rc != EUCA_TIMEOUT_ERROR)) {
+        // no pooled stub, or an NC that does not understand change sequences
+        for (j = 0; j < ncOutInstsLen; j++) {
+            free_instance(&(ncOutInsts[j]));
+        }
+        EUCA_FREE(ncOutInsts);
+        for (j = 0; j < removedIdsLen; j++) {
+            EUCA_FREE(removedIds[j]);
+        }
+        EUCA_FREE(removedIds);
+        ncOutInstsLen = removedIdsLen = 0;
+        outEpoch = outSeq = 0;
+        isDelta = FALSE;
+        // start the second call from fresh ids, the first one may have consumed them
+        free_poll_meta(&meta);
+        copy_poll_meta(&meta, args->pMeta);
+        rc = ncClientCall(&meta, nctimeout, res->lockidx, res->ncURL, "ncDescribeInstances", NULL, 0, &ncOutInsts, &ncOutInstsLen);
+    }
+    if (rc != 0) {
+        res->instSeq = 0;
+        free_poll_meta(&meta);
+        return (EUCA_ERROR);
+    }
+
+    if (isDelta) {
+        res->instDeltaRounds++;
+    } else {
+        res->instDeltaRounds = 0;
+        res->instFullAt = args->op_start;
+    }
+    res->instSeqEpoch = outEpoch;
+    res->instSeq = outSeq;
+    LOGTRACE("node %s returned %d %s instances (%d removed, now at %lld)\n", res->hostname, ncOutInstsLen, (isDelta ? "changed" : "total"), removedIdsLen, outSeq);
+
+    // populate instanceCache
+    for (j = 0; j < ncOutInstsLen; j++) {
+        myInstance = NULL;
+        LOGDEBUG("describing instance %s, %s, %d\n", ncOutInsts[j]->instanceId, ncOutInsts[j]->stateName, j);
+
+        // grab instance from cache, if available.  otherwise, start from scratch
+        rc = find_instanceCacheId(ncOutInsts[j]->instanceId, &myInstance);
+        if (rc || !myInstance) {
+            myInstance = EUCA_ZALLOC(1, sizeof(ccInstance));
+            if (!myInstance) {
+                LOGFATAL("out of memory!\n");
+                unlock_exit(1);
+            }
+        }
+        // update CC instance with instance state from NC
+        rc = ncInstance_to_ccInstance(myInstance, ncOutInsts[j]);
+
+        // migration-related logic
+        if (ncOutInsts[j]->migration_state != NOT_MIGRATING) {
+            rc = migration_handler(myInstance, res->hostname, ncOutInsts[j]->migration_src, ncOutInsts[j]->migration_dst, ncOutInsts[j]->migration_state,
+                                   &migration_host, &migration_instance, &migration_action);
+
+            // For now just ignore updates from destination while migrating.
+            if (!strcmp(res->hostname, ncOutInsts[j]->migration_dst)) {
+                LOGTRACE("[%s] ignoring update from destination node %s during migration (host=%s, instance=%s, action=%s)\n",
+                         myInstance->instanceId, ncOutInsts[j]->migration_dst, SP(migration_host), SP(migration_instance), SP(migration_action));
+                EUCA_FREE(myInstance);
+                continue;
+            }
+        }
+        // instance info that the CC maintains
+        myInstance->ncHostIdx = idx;
+
+        // Is this redundant?
+        myInstance->migration_state = ncOutInsts[j]->migration_state;
+
+        euca_strncpy(myInstance->serviceTag, res->ncURL, 384);
+        if (!strcmp(myInstance->ccnet.privateIp, "0.0.0.0")) {
+            if ((rc = MAC2IP(myInstance->ccnet.privateMac, &ip)) == 0) {
+                euca_strncpy(myInstance->ccnet.privateIp, ip, INET_ADDR_LEN);
+            }
+        }
+        EUCA_FREE(ip);
+
+        if ((myInstance->ccnet.publicIp[0] != '\0' && strcmp(myInstance->ccnet.publicIp, "0.0.0.0"))
+            && (myInstance->ncnet.publicIp[0] == '\0' || !strcmp(myInstance->ncnet.publicIp, "0.0.0.0"))) {
+            // CC has network info, NC does not
+            LOGDEBUG("sending ncAssignAddress to sync NC\n");
+            rc = ncClientCall(&meta, nctimeout, res->lockidx, res->ncURL, "ncAssignAddress", myInstance->instanceId, myInstance->ccnet.publicIp);
+            if (rc) {
+                // problem, but will retry next time
+                LOGWARN("could not send AssignAddress to NC\n");
+            }
+        }
+
+        refresh_instanceCache(myInstance->instanceId, myInstance);
+        LOGDEBUG("storing instance state: %s/%s/%s/%s\n", myInstance->instanceId, myInstance->state, myInstance->ccnet.publicIp, myInstance->ccnet.privateIp);
+        print_ccInstance("refresh_instances(): ", myInstance);
+        sensor_set_resource_alias(myInstance->instanceId, myInstance->ncnet.privateIp);
+        // TODO swathi should this account for secondary enis?
+        EUCA_FREE(myInstance);
+    }
+
+    // the instances a delta reply left out are still there, unchanged
+    numInsts = ncOutInstsLen;
+    if (isDelta) {
+        numInsts = touch_instanceCacheNode(idx, res->instFullAt, removedIds, removedIdsLen, &migrating);
+        if (migrating) {
+            res->instSeq = 0;
+        }
+    }
+
+    // if idle, power down
+    if (numInsts == 0) {
+        LOGDEBUG("node %s idle since %ld: (%ld/%d) seconds\n", res->hostname, res->idleStart, time(NULL) - res->idleStart, config->idleThresh);
+        if (!res->idleStart) {
+            res->idleStart = time(NULL);
+        } else if ((time(NULL) - res->idleStart) > config->idleThresh) {
+            // call powerdown, from the calling thread once the round is over
+            if (args->deferred)
+                args->deferred[idx].powerDown = TRUE;
+        }
+    } else {
+        res->idleStart = 0;
+    }
+
+    if (ncOutInsts) {
+        for (j = 0; j < ncOutInstsLen; j++) {
+            free_instance(&(ncOutInsts[j]));
+        }
+        EUCA_FREE(ncOutInsts);
+    }
+
+    for (j = 0; j < removedIdsLen; j++) {
+        EUCA_FREE(removedIds[j]);
+    }
+    EUCA_FREE(removedIds);
+
+    // doMigrateInstances() takes the CC locks, so hand the action to the calling thread
+    if (migration_host && args->deferred) {
+        args->deferred[idx].migrationHost = migration_host;
+        args->deferred[idx].migrationInstance = migration_instance;
+        args->deferred[idx].migrationAction = migration_action;
+        migration_host = migration_instance = migration_action = NULL;
+    }
+    EUCA_FREE(migration_host);
+    EUCA_FREE(migration_instance);
+    EUCA_FREE(migration_action);
+    free_poll_meta(&meta);
+    return (EUCA_OK);
+}
+
 //!
+//! Polls every NC for its instances, with at most NC_POLL_CONCURRENCY
+//! requests in flight, and refreshes the instance cache from the replies.
 //!
 //! @param[in] pMeta a pointer to the node controller (NC) metadata structure
 //! @param[in] timeout
 //! @param[in] dolock
 //!
-//! @return
+//! @return Always 0
 //!
 //! @pre
 //!
@@ -2540,16 +3121,8 @@ static int migration_handler(ccInstance * myInstance, char *host, char *src, cha
 //!
 int refresh_instances(ncMetadata * pMeta, int timeout, int dolock)
 {
-    ccInstance *myInstance = NULL;
-    int i, numInsts = 0, found, ncOutInstsLen, rc, pid, nctimeout, *pids = NULL, status;
-    time_t op_start;
-    char *migration_host = NULL;
-    char *migration_instance = NULL;
-    char *migration_action = NULL;
-
-    ncInstance **ncOutInsts = NULL;
-
-    op_start = time(NULL);
+    int addrMapSeq = 0;
+    ncRefreshArgs args = { 0 };
 
     LOGDEBUG("invoked: timeout=%d, dolock=%d\n", timeout, dolock);
     set_clean_instanceCache();
@@ -2559,195 +3132,92 @@ int refresh_instances(ncMetadata * pMeta, int timeout, int dolock)
     memcpy(resourceCacheStage, resourceCache, sizeof(ccResourceCache));
     sem_mypost(RESCACHE);
 
-    sem_close(locks[REFRESHLOCK]);
-    locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncFanout);
-
-    pids = EUCA_ZALLOC(resourceCacheStage->numResources, sizeof(int));
-    if (!pids) {
-        LOGFATAL("out of memory!\n");
-        unlock_exit(1);
-    }
-
     invalidate_instanceCache();
 
-    for (i = 0; i < resourceCacheStage->numResources; i++) {
-        sem_mywait(REFRESHLOCK);
-        pid = fork();
-        if (!pid) {
-            if (resourceCacheStage->resources[i].state == RESUP) {
-                int j;
+    // a delta only carries the instances the NCs changed, so when the CC changed an address
+    // mapping ask for everything: the public address resync below needs to see every instance
+    sem_mywait(CONFIG);
+    addrMapSeq = config->addrMapSeq;
+    args.fullDescribe = ((addrMapSeq != config->addrMapSyncedSeq) ? TRUE : FALSE);
+    config->addrMapSyncedSeq = addrMapSeq;
+    sem_mypost(CONFIG);
 
-                nctimeout = ncGetTimeout(op_start, timeout, 1, 1);
-                rc = ncClientCall(pMeta, nctimeout, resourceCacheStage->resources[i].lockidx, resourceCacheStage->resources[i].ncURL,
-                                  "ncDescribeInstances", NULL, 0, &ncOutInsts, &ncOutInstsLen);
-                if (!rc) {
+    args.pMeta = pMeta;
+    args.op_start = time(NULL);
+    args.timeout = timeout;
+    args.deferred = EUCA_ZALLOC(maxint(resourceCacheStage->numResources, 1), sizeof(ncDeferredActions));
+    nc_poll_run("ncDescribeInstances", resourceCacheStage->numResources, config->ncPollConcurrency, refresh_instances_node, &args, NULL, NULL);
+    run_deferred_actions(pMeta, args.deferred, resourceCacheStage->numResources);
+    EUCA_FREE(args.deferred);
 
-                    // if idle, power down
-                    if (ncOutInstsLen == 0) {
-                        LOGDEBUG("node %s idle since %ld: (%ld/%d) seconds\n", resourceCacheStage->resources[i].hostname,
-                                 resourceCacheStage->resources[i].idleStart, time(NULL) - resourceCacheStage->resources[i].idleStart, config->idleThresh);
-                        if (!resourceCacheStage->resources[i].idleStart) {
-                            resourceCacheStage->resources[i].idleStart = time(NULL);
-                        } else if ((time(NULL) - resourceCacheStage->resources[i].idleStart) > config->idleThresh) {
-                            // call powerdown
-
-                            if (powerDown(pMeta, &(resourceCacheStage->resources[i]))) {
-                                LOGWARN("powerDown for %s failed\n", resourceCacheStage->resources[i].hostname);
-                            }
-                        }
-                    } else {
-                        resourceCacheStage->resources[i].idleStart = 0;
-                    }
+    invalidate_instanceCache();        // purge old instances from cache
 
-                    // populate instanceCache
-                    for (j = 0; j < ncOutInstsLen; j++) {
-                        found = 1;
-                        if (found) {
-                            myInstance = NULL;
-                            // add it
-                            LOGDEBUG("describing instance %s, %s, %d\n", ncOutInsts[j]->instanceId, ncOutInsts[j]->stateName, j);
-                            numInsts++;
-
-                            // grab instance from cache, if available.  otherwise, start from scratch
-                            rc = find_instanceCacheId(ncOutInsts[j]->instanceId, &myInstance);
-                            if (rc || !myInstance) {
-                                myInstance = EUCA_ZALLOC(1, sizeof(ccInstance));
-                                if (!myInstance) {
-                                    LOGFATAL("out of memory!\n");
-                                    unlock_exit(1);
-                                }
-                            }
-                            // update CC instance with instance state from NC
-                            rc = ncInstance_to_ccInstance(myInstance, ncOutInsts[j]);
-
-                            // migration-related logic
-                            if (ncOutInsts[j]->migration_state != NOT_MIGRATING) {
-
-                                rc = migration_handler(myInstance,
-                                                       resourceCacheStage->resources[i].hostname,
-                                                       ncOutInsts[j]->migration_src,
-                                                       ncOutInsts[j]->migration_dst, ncOutInsts[j]->migration_state, &migration_host, &migration_instance, &migration_action);
-
-                                // For now just ignore updates from destination while migrating.
-                                if (!strcmp(resourceCacheStage->resources[i].hostname, ncOutInsts[j]->migration_dst)) {
-                                    LOGTRACE("[%s] ignoring update from destination node %s during migration (host=%s, instance=%s, action=%s)\n",
-                                             myInstance->instanceId, ncOutInsts[j]->migration_dst, SP(migration_host), SP(migration_instance), SP(migration_action));
-                                    EUCA_FREE(myInstance);
-                                    continue;
-                                }
-                            }
-                            // instance info that the CC maintains
-                            myInstance->ncHostIdx = i;
-
-                            // Is this redundant?
-                            myInstance->migration_state = ncOutInsts[j]->migration_state;
-
-                            euca_strncpy(myInstance->serviceTag, resourceCacheStage->resources[i].ncURL, 384);
-                            {
-                                char *ip = NULL;
-                                if (!strcmp(myInstance->ccnet.privateIp, "0.0.0.0")) {
-                                    if ((rc = MAC2IP(myInstance->ccnet.privateMac, &ip)) == 0) {
-                                        euca_strncpy(myInstance->ccnet.privateIp, ip, INET_ADDR_LEN);
-                                    }
-                                }
-                                EUCA_FREE(ip);
-                            }
+    // update canonical array of resources with latest changes
+    // to resourceCacheStage (.idleStart may have changed) and
+    // remove any unconfigured hosts if they have no instances
+    refresh_resourceCache(resourceCacheStage, TRUE);
 
-                            if ((myInstance->ccnet.publicIp[0] != '\0' && strcmp(myInstance->ccnet.publicIp, "0.0.0.0"))
-                                && (myInstance->ncnet.publicIp[0] == '\0' || !strcmp(myInstance->ncnet.publicIp, "0.0.0.0"))) {
-                                // CC has network info, NC does not
-                                LOGDEBUG("sending ncAssignAddress to sync NC\n");
-                                rc = ncClientCall(pMeta, nctimeout, resourceCacheStage->resources[i].lockidx, resourceCacheStage->resources[i].ncURL,
-                                                  "ncAssignAddress", myInstance->instanceId, myInstance->ccnet.publicIp);
-                                if (rc) {
-                                    // problem, but will retry next time
-                                    LOGWARN("could not send AssignAddress to NC\n");
-                                }
-                            }
+    LOGTRACE("done\n");
+    return (0);
+}
 
-                            refresh_instanceCache(myInstance->instanceId, myInstance);
-                            LOGDEBUG("storing instance state: %s/%s/%s/%s\n", myInstance->instanceId, myInstance->state, myInstance->ccnet.publicIp, myInstance->ccnet.privateIp);
-                            print_ccInstance("refresh_instances(): ", myInstance);
-                            sensor_set_resource_alias(myInstance->instanceId, myInstance->ncnet.privateIp);
-                            // TODO swathi should this account for secondary enis?
-                            EUCA_FREE(myInstance);
-                        }
-                    }
-                }
-                if (ncOutInsts) {
-                    for (j = 0; j < ncOutInstsLen; j++) {
-                        free_instance(&(ncOutInsts[j]));
-                    }
-                    EUCA_FREE(ncOutInsts);
-                }
-            }
-            sem_mypost(REFRESHLOCK);
+//!
+//! Collects sensor data from one NC on behalf of refresh_sensors(). Runs in
+//! a poll worker thread.
+//!
+//! @param[in] idx index of the node in resourceCacheStage
+//! @param[in] arg a pointer to the ncRefreshArgs of the round
+//!
+//! @return EUCA_OK on success or EUCA_ERROR if the node did not answer
+//!
+//! @see nc_poll_run()
+//!
+static int refresh_sensors_node(int idx, void *arg)
+{
+    int j = 0;
+    int rc = EUCA_OK;
+    int srsLen = 0;
+    int nctimeout = 0;
+    ncMetadata meta = { 0 };
+    sensorResource **srs = NULL;
+    ncRefreshArgs *args = ((ncRefreshArgs *) arg);
+    ccResource *res = &(resourceCacheStage->resources[idx]);
 
-            if (migration_host) {
-                if (!strcmp(migration_action, "commit")) {
-                    LOGDEBUG("[%s] notifying source %s to commit migration\n", migration_instance, migration_host);
-                    // Note: Really only need to specify the instance here.
-                    doMigrateInstances(pMeta, migration_host, migration_instance, NULL, 0, 0, "commit", NULL, 0);
-                } else if (!strcmp(migration_action, "rollback")) {
-                    LOGDEBUG("[%s] notifying node %s to roll back migration\n", migration_instance, migration_host);
-                    doMigrateInstances(pMeta, migration_host, migration_instance, NULL, 0, 0, "rollback", NULL, 0);
-                } else {
-                    LOGWARN("unexpected migration action '%s' for node %s -- doing nothing\n", migration_action, migration_host);
-                }
-                EUCA_FREE(migration_host);
-            }
-            EUCA_FREE(migration_instance);
-            EUCA_FREE(migration_action);
+    if (res->state != RESUP)
+        return (EUCA_OK);
 
-            exit(0);
-        } else {
-            pids[i] = pid;
+    copy_poll_meta(&meta, args->pMeta);
+
+    nctimeout = ncGetTimeout(args->op_start, args->timeout, 1, 1);
+    rc = ncClientCall(&meta, nctimeout, res->lockidx, res->ncURL, "ncDescribeSensors", args->history_size, args->collection_interval_time_ms,
+                      NULL, 0, NULL, 0, &srs, &srsLen);
+    if (!rc) {
+        // update our cache
+        if (sensor_merge_records(srs, srsLen, TRUE) != EUCA_OK) {
+            LOGWARN("failed to store all sensor data due to lack of space");
         }
-    }
 
-    for (i = 0; i < resourceCacheStage->numResources; i++) {
-        rc = timewait(pids[i], &status, 120);
-        if (!rc) {
-            // timed out, really bad failure (reset REFRESHLOCK semaphore)
-            sem_close(locks[REFRESHLOCK]);
-            locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncFanout);
-            rc = 1;
-        } else if (rc > 0) {
-            // process exited, and wait picked it up.
-            if (WIFEXITED(status)) {
-                rc = WEXITSTATUS(status);
-            } else {
-                rc = 1;
+        if (srsLen > 0) {
+            for (j = 0; j < srsLen; j++) {
+                EUCA_FREE(srs[j]);
             }
-        } else {
-            // process no longer exists, and someone else reaped it
-            rc = 0;
-        }
-        if (rc) {
-            LOGWARN("error waiting for child pid '%d', exit code '%d'\n", pids[i], rc);
+            EUCA_FREE(srs);
         }
     }
 
-    invalidate_instanceCache();        // purge old instances from cache
-
-    // update canonical array of resources with latest changes
-    // to resourceCacheStage (.idleStart may have changed) and
-    // remove any unconfigured hosts if they have no instances
-    refresh_resourceCache(resourceCacheStage, TRUE);
-    EUCA_FREE(pids);
-
-    LOGTRACE("done\n");
-    return (0);
+    free_poll_meta(&meta);
+    return ((rc) ? EUCA_ERROR : EUCA_OK);
 }
 
 //!
-//!
+//! Collects sensor data from every NC, with at most NC_POLL_CONCURRENCY
+//! requests in flight.
 //!
 //! @param[in] pMeta a pointer to the node controller (NC) metadata structure
 //! @param[in] timeout
 //! @param[in] dolock
 //!
-//! @return
+//! @return 0 on success or 1 if the sensor subsystem is not configured yet
 //!
 //! @pre
 //!
@@ -2755,13 +3225,12 @@ int refresh_instances(ncMetadata * pMeta, int timeout, int dolock)
 //!
 int refresh_sensors(ncMetadata * pMeta, int timeout, int dolock)
 {
+    ncRefreshArgs args = { 0 };
 
-    time_t op_start = time(NULL);
     LOGDEBUG("invoked: timeout=%d, dolock=%d\n", timeout, dolock);
 
-    int history_size;
-    long long collection_interval_time_ms;
-    if ((sensor_get_config(&history_size, &collection_interval_time_ms) != 0) || history_size < 1 || collection_interval_time_ms == 0)
+    args.op_start = time(NULL);
+    if ((sensor_get_config(&args.history_size, &args.collection_interval_time_ms) != 0) || args.history_size < 1 || args.collection_interval_time_ms == 0)
         return (1);                    // sensor system not configured yet
 
     // critical NC call section
@@ -2769,75 +3238,10 @@ int refresh_sensors(ncMetadata * pMeta, int timeout, int dolock)
     memcpy(resourceCacheStage, resourceCache, sizeof(ccResourceCache));
     sem_mypost(RESCACHE);
 
-    sem_close(locks[REFRESHLOCK]);
-    locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncFanout);
-
-    int *pids = EUCA_ZALLOC(resourceCacheStage->numResources, sizeof(int));
-    if (!pids) {
-        LOGFATAL("out of memory!\n");
-        unlock_exit(1);
-    }
-
-    for (int i = 0; i < resourceCacheStage->numResources; i++) {
-        sem_mywait(REFRESHLOCK);
-        pid_t pid = fork();
-        if (!pid) {
-            if (resourceCacheStage->resources[i].state == RESUP) {
-                int nctimeout = ncGetTimeout(op_start, timeout, 1, 1);
-
-                sensorResource **srs;
-                int srsLen;
-                int rc = ncClientCall(pMeta, nctimeout, resourceCacheStage->resources[i].lockidx, resourceCacheStage->resources[i].ncURL,
-                                      "ncDescribeSensors", history_size, collection_interval_time_ms,
-                                      NULL, 0, NULL, 0, &srs, &srsLen);
-
-                if (!rc) {
-                    // update our cache
-                    if (sensor_merge_records(srs, srsLen, TRUE) != EUCA_OK) {
-                        LOGWARN("failed to store all sensor data due to lack of space");
-                    }
-
-                    if (srsLen > 0) {
-                        for (int j = 0; j < srsLen; j++) {
-                            EUCA_FREE(srs[j]);
-                        }
-                        EUCA_FREE(srs);
-                    }
-                }
-            }
-            sem_mypost(REFRESHLOCK);
-            exit(0);
-        } else {
-            pids[i] = pid;
-        }
-    }
-
-    for (int i = 0; i < resourceCacheStage->numResources; i++) {
-        int status;
-
-        int rc = timewait(pids[i], &status, 120);
-        if (!rc) {
-            // timed out, really bad failure (reset REFRESHLOCK semaphore)
-            sem_close(locks[REFRESHLOCK]);
-            locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncFanout);
-            rc = 1;
-        } else if (rc > 0) {
-            // process exited, and wait picked it up.
-            if (WIFEXITED(status)) {
-                rc = WEXITSTATUS(status);
-            } else {
-                rc = 1;
-            }
-        } else {
-            // process no longer exists, and someone else reaped it
-            rc = 0;
-        }
-        if (rc) {
-            LOGWARN("error waiting for child pid '%d', exit code '%d'\n", pids[i], rc);
-        }
-    }
+    args.pMeta = pMeta;
+    args.timeout = timeout;
+    nc_poll_run("ncDescribeSensors", resourceCacheStage->numResources, config->ncPollConcurrency, refresh_sensors_node, &args, NULL, NULL);
 
-    EUCA_FREE(pids);
     LOGTRACE("done\n");
     return (0);
 }
@@ -3140,6 +3544,8 @@ int schedule_instance(virtualMachine * vm, char *amiId, char *kernelId, char *ra
         ret = schedule_instance_greedy(vm, outresid);
     } else if (config->schedPolicy == SCHEDUSER) {
         ret = schedule_instance_user(vm, amiId, kernelId, ramdiskId, instId, userData, platform, outresid);
+    } else if (config->schedPolicy == SCHEDBESTFIT) {
+        ret = schedule_instance_bestfit(vm, outresid);
     } else {
         ret = schedule_instance_greedy(vm, outresid);
     }
@@ -3259,9 +3665,9 @@ static int schedule_instance_migration(ncInstance * instance, char **includeNode
     } else {
         if (config->schedPolicy == SCHEDROUNDROBIN) {
             LOGDEBUG("[%s] scheduling migration using ROUNDROBIN scheduler\n", instance->instanceId);
-        } else if (config->schedPolicy == SCHEDGREEDY || config->schedPolicy == SCHEDPOWERSAVE) {
+        } else if (config->schedPolicy == SCHEDGREEDY || config->schedPolicy == SCHEDPOWERSAVE || config->schedPolicy == SCHEDBESTFIT) {
             LOGINFO
-                ("[%s] scheduling migration using ROUNDROBIN scheduler, despite GREEDY or POWERSAVE scheduler specification in Eucalyptus configuration file; GREEDY scheduling can be emulated by selecting specific destination nodes for migrations\n",
+                ("[%s] scheduling migration using ROUNDROBIN scheduler, despite GREEDY, POWERSAVE or BESTFIT scheduler specification in Eucalyptus configuration file; GREEDY scheduling can be emulated by selecting specific destination nodes for migrations\n",
                  instance->instanceId);
         } else {
             LOGWARN("[%s] unsupported scheduler configuration--scheduling migration using ROUNDROBIN scheduler\n", instance->instanceId);
@@ -3475,6 +3881,121 @@ int schedule_instance_greedy(virtualMachine * vm, int *outresid)
     return (0);
 }
 
+//!
+//! Best-fit (bin packing) scheduler: picks the node with the least room left
+//! that can still take the instance, preferring awake nodes over sleeping ones
+//!
+//! @param[in]  vm the instance to place
+//! @param[out] outresid index of the chosen node in the resource cache
+//!
+//! @return 0 on success or 1 if no node can take the instance
+//!
+//! @pre RESCACHE and CONFIG locks are held
+//!
+int schedule_instance_bestfit(virtualMachine * vm, int *outresid)
+{
+    int resid = -1;
+    schedIndex *idx = NULL;
+
+    *outresid = 0;
+
+    LOGDEBUG("scheduler using BESTFIT policy to find next resource\n");
+    if ((idx = EUCA_ZALLOC(1, sizeof(schedIndex))) == NULL) {
+        LOGFATAL("out of memory!\n");
+        unlock_exit(1);
+    }
+
+    sched_index_build(idx, resourceCache, vm, SCHEDBESTFIT);
+    if (sched_index_plan(idx, 1, 0, &resid, NULL) != 1) {
+        // didn't find a resource
+        EUCA_FREE(idx);
+        return (1);
+    }
+    EUCA_FREE(idx);
+
+    *outresid = resid;
+    if (resourceCache->resources[resid].state == RESASLEEP) {
+        powerUp(&(resourceCache->resources[resid]));
+    }
+    return (0);
+}
+
+//!
+//! Places a whole batch of identical instances in one pass over the resource
+//! cache, following the configured scheduling policy. The plan is only a
+//! suggestion: schedule_instance_planned() checks every entry again when the
+//! instance is about to be run.
+//!
+//! @param[in]  vm the shape shared by all the instances of the batch
+//! @param[in]  count number of instances in the batch
+//! @param[out] plan array of count entries receiving the planned node of each instance
+//!
+//! @return the number of instances that could be planned (0 with the USER policy)
+//!
+//! @pre RESCACHE and CONFIG locks are held
+//!
+int schedule_instance_batch(virtualMachine * vm, int count, int *plan)
+{
+    int planned = 0;
+    schedIndex *idx = NULL;
+
+    if (config->schedPolicy == SCHEDUSER) {
+        return (0);
+    }
+
+    if ((idx = EUCA_ZALLOC(1, sizeof(schedIndex))) == NULL) {
+        LOGFATAL("out of memory!\n");
+        unlock_exit(1);
+    }
+
+    sched_index_build(idx, resourceCache, vm, config->schedPolicy);
+    if ((planned = sched_index_plan(idx, count, config->schedState, plan, NULL)) < 0) {
+        planned = 0;
+    }
+    LOGDEBUG("%s scheduler planned %d of %d instances (%d more would fit)\n", SP(SCHEDPOLICIES[config->schedPolicy]), planned, count, (idx->numFree - planned));
+    EUCA_FREE(idx);
+
+    return (planned);
+}
+
+//!
+//! Checks that the node planned by schedule_instance_batch() for an instance
+//! can still take it and, if so, commits the choice the way the per-instance
+//! scheduler of the configured policy would.
+//!
+//! @param[in]  vm the instance to place
+//! @param[in]  resid index of the planned node in the resource cache
+//! @param[out] outresid index of the chosen node in the resource cache
+//!
+//! @return 0 on success or 1 if the planned node cannot be used anymore
+//!
+//! @pre RESCACHE and CONFIG locks are held
+//!
+int schedule_instance_planned(virtualMachine * vm, int resid, int *outresid)
+{
+    ccResource *res = NULL;
+
+    if ((resid < 0) || (resid >= resourceCache->numResources)) {
+        return (1);
+    }
+
+    res = &(resourceCache->resources[resid]);
+    if ((res->ncState != ENABLED) || (res->state == RESDOWN)) {
+        return (1);
+    }
+    if (((res->availMemory - vm->mem) < 0) || ((res->availDisk - vm->disk) < 0) || ((res->availCores - vm->cores) < 0)) {
+        return (1);
+    }
+
+    *outresid = resid;
+    if (config->schedPolicy == SCHEDROUNDROBIN) {
+        config->schedState = (resid + 1) % resourceCache->numResources;
+    } else if (res->state == RESASLEEP) {
+        powerUp(res);
+    }
+    return (0);
+}
+
 //!
 //!
 //!
@@ -3647,7 +4168,8 @@ int doRunInstances(ncMetadata * pMeta, char *amiId, char *kernelId, char *ramdis
                    char *platform, int expiryTime, char *targetNode, char *rootDirective, char *eniAttachmentId, netConfig * secNetCfgs, int secNetCfgsLen,
                    ccInstance ** outInsts, int *outInstsLen)
 {
-    int rc = 0, i = 0, done = 0, runCount = 0, resid = 0, foundnet = 0, error = 0, nidx = 0, thenidx = 0, pid = 0;
+    int rc = 0, i = 0, done = 0, runCount = 0, resid = 0, foundnet = 0, error = 0, nidx = 0, thenidx = 0, pid = 0, planLen = 0;
+    int *plan = NULL;
     ccInstance *myInstance = NULL, *retInsts = NULL;
     char instId[INSTANCE_ID_LEN], uuid[48];
     ccResource *res = NULL;
@@ -3730,6 +4252,20 @@ int doRunInstances(ncMetadata * pMeta, char *amiId, char *kernelId, char *ramdis
 
     runCount = 0;
 
+    // place the whole batch up front; an instance whose planned node cannot
+    // take it anymore when its turn comes goes through schedule_instance()
+    if ((targetNode == NULL) && (maxCount > 1)) {
+        if ((plan = EUCA_ZALLOC(maxCount, sizeof(int))) == NULL) {
+            LOGFATAL("out of memory!\n");
+            unlock_exit(1);
+        }
+        sem_mywait(RESCACHE);
+        sem_mywait(CONFIG);
+        planLen = schedule_instance_batch(ccvm, maxCount, plan);
+        sem_mypost(CONFIG);
+        sem_mypost(RESCACHE);
+    }
+
     // get updated resource information
 
     done = 0;
@@ -3821,7 +4357,11 @@ int doRunInstances(ncMetadata * pMeta, char *amiId, char *kernelId, char *ramdis
             resid = 0;
 
             sem_mywait(CONFIG);
-            rc = schedule_instance(ccvm, amiId, kernelId, ramdiskId, instId, userData, platform, targetNode, &resid);
+            if ((runCount < planLen) && (schedule_instance_planned(ccvm, plan[runCount], &resid) == 0)) {
+                rc = 0;
+            } else {
+                rc = schedule_instance(ccvm, amiId, kernelId, ramdiskId, instId, userData, platform, targetNode, &resid);
+            }
             sem_mypost(CONFIG);
 
             res = &(resourceCache->resources[resid]);
@@ -3947,6 +4487,7 @@ int doRunInstances(ncMetadata * pMeta, char *amiId, char *kernelId, char *ramdis
         }
         EUCA_FREE(mac);
     }
+    EUCA_FREE(plan);
     *outInstsLen = runCount;
     *outInsts = retInsts;
 
@@ -3989,7 +4530,6 @@ int doGetConsoleOutput(ncMetadata * pMeta, char *instanceId, char **consoleOutpu
     char *rawconsole = NULL;
     char pwfile[EUCA_MAX_PATH] = "";
     time_t op_start = 0;
-    ccInstance *myInstance = NULL;
     ccResourceCache resourceCacheLocal = { {{{0}}} };
 
     op_start = time(NULL);
@@ -4009,11 +4549,9 @@ int doGetConsoleOutput(ncMetadata * pMeta, char *instanceId, char **consoleOutpu
     }
     sem_mypost(RESCACHE);
 
-    if ((rc = find_instanceCacheId(instanceId, &myInstance)) == 0) {
+    if ((rc = find_instanceCacheNodeIdx(instanceId, &start)) == 0) {
         // found the instance in the cache
-        start = myInstance->ncHostIdx;
         stop = start + 1;
-        EUCA_FREE(myInstance);
     } else {
         start = 0;
         stop = resourceCacheLocal.numResources;
@@ -4055,13 +4593,11 @@ int doRebootInstances(ncMetadata * pMeta, char **instIds, int instIdsLen)
 {
     int i, j, rc, numInsts, start, stop, done, timeout = 0, ret = 0;
     char *instId;
-    ccInstance *myInstance;
     time_t op_start;
     ccResourceCache resourceCacheLocal;
 
     i = j = numInsts = 0;
     instId = NULL;
-    myInstance = NULL;
     op_start = time(NULL);
 
     rc = initialize(pMeta, FALSE);
@@ -4078,12 +4614,9 @@ int doRebootInstances(ncMetadata * pMeta, char **instIds, int instIdsLen)
 
     for (i = 0; i < instIdsLen; i++) {
         instId = instIds[i];
-        rc = find_instanceCacheId(instId, &myInstance);
-        if (!rc) {
+        if ((rc = find_instanceCacheNodeIdx(instId, &start)) == 0) {
             // found the instance in the cache
-            start = myInstance->ncHostIdx;
             stop = start + 1;
-            EUCA_FREE(myInstance);
         } else {
             start = 0;
             stop = resourceCacheLocal.numResources;
@@ -4219,12 +4752,10 @@ int doTerminateInstances(ncMetadata * pMeta, char **instIds, int instIdsLen, int
 int doCreateImage(ncMetadata * pMeta, char *instanceId, char *volumeId, char *remoteDev)
 {
     int i, rc, start = 0, stop = 0, ret = 0, done = 0, timeout;
-    ccInstance *myInstance;
     time_t op_start;
     ccResourceCache resourceCacheLocal;
 
     i = 0;
-    myInstance = NULL;
     op_start = time(NULL);
 
     rc = initialize(pMeta, FALSE);
@@ -4243,14 +4774,9 @@ int doCreateImage(ncMetadata * pMeta, char *instanceId, char *volumeId, char *re
     memcpy(&resourceCacheLocal, resourceCache, sizeof(ccResourceCache));
     sem_mypost(RESCACHE);
 
-    rc = find_instanceCacheId(instanceId, &myInstance);
-    if (!rc) {
+    if ((rc = find_instanceCacheNodeIdx(instanceId, &start)) == 0) {
         // found the instance in the cache
-        if (myInstance) {
-            start = myInstance->ncHostIdx;
-            stop = start + 1;
-            EUCA_FREE(myInstance);
-        }
+        stop = start + 1;
     } else {
         start = 0;
         stop = resourceCacheLocal.numResources;
@@ -4838,7 +5364,6 @@ int doStartInstance(ncMetadata * pMeta, char *instanceId)
     int ret = 0;
     int timeout = 0;
     int done = 0;
-    ccInstance *myInstance = NULL;
     time_t op_start = time(NULL);
     ccResourceCache resourceCacheLocal;
 
@@ -4859,14 +5384,9 @@ int doStartInstance(ncMetadata * pMeta, char *instanceId)
     }
     sem_mypost(RESCACHE);
 
-    if ((rc = find_instanceCacheId(instanceId, &myInstance)) == 0) {
+    if ((rc = find_instanceCacheNodeIdx(instanceId, &start)) == 0) {
         // found the instance in the cache
-        if (myInstance) {
-            start = myInstance->ncHostIdx;
-            stop = start + 1;
-            EUCA_FREE(myInstance);
-            myInstance = NULL;
-        }
+        stop = start + 1;
     } else {
         start = 0;
         stop = resourceCacheLocal.numResources;
@@ -4910,7 +5430,6 @@ int doStopInstance(ncMetadata * pMeta, char *instanceId)
     int ret = 0;
     int timeout = 0;
     int done = 0;
-    ccInstance *myInstance = NULL;
     time_t op_start = time(NULL);
     ccResourceCache resourceCacheLocal;
 
@@ -4931,14 +5450,9 @@ int doStopInstance(ncMetadata * pMeta, char *instanceId)
     }
     sem_mypost(RESCACHE);
 
-    if ((rc = find_instanceCacheId(instanceId, &myInstance)) == 0) {
+    if ((rc = find_instanceCacheNodeIdx(instanceId, &start)) == 0) {
         // found the instance in the cache
-        if (myInstance) {
-            start = myInstance->ncHostIdx;
-            stop = start + 1;
-            EUCA_FREE(myInstance);
-            myInstance = NULL;
-        }
+        stop = start + 1;
     } else {
         start = 0;
         stop = resourceCacheLocal.numResources;
@@ -5518,6 +6032,7 @@ void *monitor_thread(void *in)
                     last_log_update = now;
                     LOGINFO("instances: %04d (%04d extant + %04d pending + %04d terminated)\n", (num_pending + num_extant + num_teardown), num_extant, num_pending, num_teardown);
                     LOGINFO("    nodes: %04d (%04d busy + %04d idle + %04d unresponsive)\n", (res_busy + res_idle + res_bad), res_busy, res_idle, res_bad);
+                    nc_pool_log_stats();
                 }
             }
 
@@ -6159,6 +6674,8 @@ int init_config(void)
     int rc = 0;
     int numHosts = 0;
     int use_wssec = 0;
+    int use_nc_pool = 0;
+    int use_nc_delta = 0;
     int use_tunnels = 0;
     int use_proxy = 0;
     int proxy_max_cache_size = 0;
@@ -6180,7 +6697,7 @@ int init_config(void)
     time_t instanceTimeout = 0;
     time_t ncPollingFrequency = 0;
     time_t clcPollingFrequency = 0;
-    time_t ncFanout;
+    int ncPollConcurrency = NC_POLL_DEFAULT_INFLIGHT;
     ccResource *res = NULL;
 
     // read in base config information
@@ -6280,6 +6797,8 @@ int init_config(void)
             schedPolicy = SCHEDROUNDROBIN;
         else if (!strcmp(tmpstr, "POWERSAVE"))
             schedPolicy = SCHEDPOWERSAVE;
+        else if (!strcmp(tmpstr, "BESTFIT"))
+            schedPolicy = SCHEDBESTFIT;
         else if (access(tmpstr, X_OK) == 0) {   // scheduler is an executable path, assumed to be user scheduler
             LOGWARN("will use user-defined scheduler at '%s'\n", tmpstr);
             euca_strncpy(schedPath, tmpstr, sizeof(schedPath));
@@ -6356,15 +6875,18 @@ int init_config(void)
         bzero(arbitrators, 256);
     }
 
-    tmpstr = configFileValue("NC_FANOUT");
-    if (!tmpstr) {
-        ncFanout = 1;
-        tmpstr = NULL;
-    } else {
-        ncFanout = atoi(tmpstr);
-        if (ncFanout < 1 || ncFanout > 32) {
-            LOGWARN("NC_FANOUT set out of bounds (min=%d max=%d) (current=%ld), resetting to default (1 NC)\n", 1, 32, ncFanout);
-            ncFanout = 1;
+    // number of NCs polled (and broadcast to) at the same time, NC_FANOUT is the older name of the setting
+    if ((tmpstr = configFileValue("NC_POLL_CONCURRENCY")) == NULL) {
+        if ((tmpstr = configFileValue("NC_FANOUT")) != NULL) {
+            LOGWARN("NC_FANOUT is deprecated, use NC_POLL_CONCURRENCY instead\n");
+        }
+    }
+    if (tmpstr) {
+        ncPollConcurrency = atoi(tmpstr);
+        if (ncPollConcurrency < NC_POLL_MIN_INFLIGHT || ncPollConcurrency > NC_POLL_MAX_INFLIGHT) {
+            LOGWARN("NC_POLL_CONCURRENCY set out of bounds (min=%d max=%d) (current=%d), resetting to default (%d NCs)\n", NC_POLL_MIN_INFLIGHT,
+                    NC_POLL_MAX_INFLIGHT, ncPollConcurrency, NC_POLL_DEFAULT_INFLIGHT);
+            ncPollConcurrency = NC_POLL_DEFAULT_INFLIGHT;
         }
     }
     EUCA_FREE(tmpstr);
@@ -6397,6 +6919,28 @@ int init_config(void)
     }
     EUCA_FREE(tmpstr);
 
+    // long-lived NC client stubs instead of a forked process per NC call
+    use_nc_pool = 1;
+    tmpstr = configFileValue("NC_CLIENT_POOL");
+    if (tmpstr && strcmp(tmpstr, "Y")) {
+        use_nc_pool = 0;
+    }
+    EUCA_FREE(tmpstr);
+
+    // without the pool every NC call forks, which is unsafe from concurrent poll threads
+    if (!use_nc_pool && (ncPollConcurrency > 1)) {
+        LOGWARN("NC_POLL_CONCURRENCY=%d requires NC_CLIENT_POOL=Y, polling one NC at a time\n", ncPollConcurrency);
+        ncPollConcurrency = 1;
+    }
+
+    // only ask NCs for the instances that changed since the last poll
+    use_nc_delta = 1;
+    tmpstr = configFileValue("NC_DESCRIBE_DELTA");
+    if (tmpstr && strcmp(tmpstr, "Y")) {
+        use_nc_delta = 0;
+    }
+    EUCA_FREE(tmpstr);
+
     // Config ccMaxInstances if defined, otherwise use default of DEFAULT_MAX_INSTANCES_PER_CC
     tmpstr = configFileValue("MAX_INSTANCES_PER_CC");
     if (tmpstr) {
@@ -6459,6 +7003,8 @@ int init_config(void)
     EUCA_FREE(proxyIp);
 
     config->use_wssec = use_wssec;
+    config->ncClientPool = use_nc_pool;
+    config->ncDescribeDelta = use_nc_delta;
     config->schedPolicy = schedPolicy;
     euca_strncpy(config->schedPath, schedPath, sizeof(config->schedPath));
     config->idleThresh = idleThresh;
@@ -6467,9 +7013,9 @@ int init_config(void)
     config->ncPollingFrequency = ncPollingFrequency;
     config->ncSensorsPollingInterval = ncPollingFrequency;  // initially poll sensors with the same frequency as other NC ops
     config->clcPollingFrequency = clcPollingFrequency;
-    config->ncFanout = ncFanout;
+    config->ncPollConcurrency = ncPollConcurrency;
     config->ccMaxInstances = ccMaxInstances;
-    locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncFanout);
+    locks[REFRESHLOCK] = sem_open("/eucalyptusCCrefreshLock", O_CREAT, 0644, config->ncPollConcurrency);
     config->initialized = 1;
     ccChangeState(LOADED);
     config->ccStatus.localEpoch = 0;
@@ -6500,6 +7046,9 @@ int init_config(void)
     LOGINFO("   CC Configuration: eucahome=%s\n", SP(config->eucahome));
     LOGINFO("                     policyfile=%s\n", SP(config->policyFile));
     LOGINFO("                     ws-security=%s\n", use_wssec ? "ENABLED" : "DISABLED");
+    LOGINFO("                     ncClientPool=%s\n", use_nc_pool ? "ENABLED" : "DISABLED");
+    LOGINFO("                     ncPollConcurrency=%d\n", config->ncPollConcurrency);
+    LOGINFO("                     ncDescribeDelta=%s\n", use_nc_delta ? "ENABLED" : "DISABLED");
     LOGINFO("                     schedulerPolicy=%s\n", SP(SCHEDPOLICIES[config->schedPolicy]));
     LOGINFO("                     idleThreshold=%d\n", config->idleThresh);
     LOGINFO("                     wakeThreshold=%d\n", config->wakeThresh);
@@ -7030,6 +7579,229 @@ int pubIpSet(ccInstance * inst, void *ip)
     return (0);
 }
 
+//!
+//! Maps a key onto a bucket of the instance cache hash indexes
+//!
+//! @param[in] key the instance ID or IP address to hash
+//!
+//! @return the bucket number in [0, INSTCACHE_HASH_BUCKETS)
+//!
+static int hash_instanceCacheKey(const char *key)
+{
+    return ((int)(jenkins(key, strlen(key)) & (INSTCACHE_HASH_BUCKETS - 1)));
+}
+
+//!
+//! Files a cache slot under the given bucket of an index chain
+//!
+//! @param[in] chain the index chain
+//! @param[in] bucket the bucket to file the slot under
+//! @param[in] slot the instanceCache[] slot
+//!
+//! @pre INSTCACHE lock is held and the slot is not linked in this chain
+//!
+static void link_instanceCacheChain(ccInstanceCacheChain * chain, int bucket, int slot)
+{
+    chain->bucket[slot] = bucket;
+    chain->next[slot] = chain->head[bucket];
+    chain->head[bucket] = slot;
+}
+
+//!
+//! Removes a cache slot from an index chain, if it is linked there
+//!
+//! @param[in] chain the index chain
+//! @param[in] slot the instanceCache[] slot
+//!
+//! @pre INSTCACHE lock is held
+//!
+static void unlink_instanceCacheChain(ccInstanceCacheChain * chain, int slot)
+{
+    int *link = NULL;
+
+    if (chain->bucket[slot] < 0)
+        return;
+
+    for (link = &(chain->head[chain->bucket[slot]]); (*link >= 0); link = &(chain->next[*link])) {
+        if (*link == slot) {
+            *link = chain->next[slot];
+            break;
+        }
+    }
+    chain->next[slot] = -1;
+    chain->bucket[slot] = -1;
+}
+
+//!
+//! Removes a cache slot from all the instance cache indexes
+//!
+//! @param[in] slot the instanceCache[] slot
+//!
+//! @pre INSTCACHE lock is held
+//!
+static void unindex_instanceCacheSlot(int slot)
+{
+    ccInstanceCacheIndex *index = &(instanceCacheMetadata->index);
+
+    unlink_instanceCacheChain(&(index->byId), slot);
+    unlink_instanceCacheChain(&(index->byPublicIp), slot);
+    unlink_instanceCacheChain(&(index->byPrivateIp), slot);
+    unlink_instanceCacheChain(&(index->byNode), slot);
+}
+
+//!
+//! (Re)files a cache slot in all the instance cache indexes based on its
+//! current content. Must be called every time a slot is written.
+//!
+//! @param[in] slot the instanceCache[] slot
+//!
+//! @pre INSTCACHE lock is held
+//!
+static void index_instanceCacheSlot(int slot)
+{
+    ccInstance *inst = &(instanceCache[slot].instance);
+    ccInstanceCacheIndex *index = &(instanceCacheMetadata->index);
+
+    unindex_instanceCacheSlot(slot);
+    if (instanceCache[slot].cacheState != INSTVALID)
+        return;
+
+    link_instanceCacheChain(&(index->byId), hash_instanceCacheKey(inst->instanceId), slot);
+    if (inst->ccnet.publicIp[0] != '\0')
+        link_instanceCacheChain(&(index->byPublicIp), hash_instanceCacheKey(inst->ccnet.publicIp), slot);
+    if (inst->ccnet.privateIp[0] != '\0')
+        link_instanceCacheChain(&(index->byPrivateIp), hash_instanceCacheKey(inst->ccnet.privateIp), slot);
+    if ((inst->ncHostIdx >= 0) && (inst->ncHostIdx < MAXNODES))
+        link_instanceCacheChain(&(index->byNode), inst->ncHostIdx, slot);
+}
+
+//!
+//! Rebuilds all the instance cache indexes from scratch
+//!
+//! @pre INSTCACHE lock is held
+//!
+static void rebuild_instanceCacheIndex(void)
+{
+    int i = 0;
+    ccInstanceCacheIndex *index = &(instanceCacheMetadata->index);
+
+    // all bits set is -1, the empty marker of every array in a chain
+    memset(&(index->byId), 0xFF, sizeof(ccInstanceCacheChain));
+    memset(&(index->byPublicIp), 0xFF, sizeof(ccInstanceCacheChain));
+    memset(&(index->byPrivateIp), 0xFF, sizeof(ccInstanceCacheChain));
+    memset(&(index->byNode), 0xFF, sizeof(ccInstanceCacheChain));
+
+    for (i = 0; i < config->ccMaxInstances; i++) {
+        index_instanceCacheSlot(i);
+    }
+    index->numSlots = config->ccMaxInstances;
+}
+
+//!
+//! Builds the instance cache indexes if this has not been done yet for the
+//! current cache size (first use of the shared segment, or MAX_INSTANCES_PER_CC
+//! changed across a restart).
+//!
+//! @pre INSTCACHE lock is held
+//!
+static void check_instanceCacheIndex(void)
+{
+    if (instanceCacheMetadata->index.numSlots != config->ccMaxInstances) {
+        LOGDEBUG("building instance cache index for %d slots\n", config->ccMaxInstances);
+        rebuild_instanceCacheIndex();
+    }
+}
+
+//!
+//! Looks up the cache slot holding an instance
+//!
+//! @param[in] instanceId the instance identifier
+//!
+//! @return the instanceCache[] slot or -1 if the instance is not cached
+//!
+//! @pre INSTCACHE lock is held
+//!
+static int lookup_instanceCacheId(const char *instanceId)
+{
+    int slot = 0;
+    ccInstanceCacheChain *chain = &(instanceCacheMetadata->index.byId);
+
+    check_instanceCacheIndex();
+    for (slot = chain->head[hash_instanceCacheKey(instanceId)]; slot >= 0; slot = chain->next[slot]) {
+        if ((instanceCache[slot].cacheState == INSTVALID) && !strcmp(instanceCache[slot].instance.instanceId, instanceId))
+            return (slot);
+    }
+    return (-1);
+}
+
+//!
+//! Looks up the first cache slot (in cache order, like a linear scan would)
+//! holding an instance with the given public or private IP address
+//!
+//! @param[in] ip the public or private IP address
+//!
+//! @return the instanceCache[] slot or -1 if no cached instance has that address
+//!
+//! @pre INSTCACHE lock is held
+//!
+static int lookup_instanceCacheIP(const char *ip)
+{
+    int slot = 0;
+    int found = -1;
+    int bucket = 0;
+    ccInstanceCacheChain *chain = NULL;
+
+    check_instanceCacheIndex();
+    bucket = hash_instanceCacheKey(ip);
+
+    chain = &(instanceCacheMetadata->index.byPublicIp);
+    for (slot = chain->head[bucket]; slot >= 0; slot = chain->next[slot]) {
+        if (((found < 0) || (slot < found)) && !strcmp(instanceCache[slot].instance.ccnet.publicIp, ip))
+            found = slot;
+    }
+
+    chain = &(instanceCacheMetadata->index.byPrivateIp);
+    for (slot = chain->head[bucket]; slot >= 0; slot = chain->next[slot]) {
+        if (((found < 0) || (slot < found)) && !strcmp(instanceCache[slot].instance.ccnet.privateIp, ip))
+            found = slot;
+    }
+    return (found);
+}
+
+//!
+//! Adds or removes a cache slot's contribution to the instance counters
+//!
+//! @param[in] slot the instanceCache[] slot
+//! @param[in] delta 1 to count the slot, -1 to uncount it
+//!
+//! @pre INSTCACHE and INSTCACHEMD locks are held
+//!
+static void count_instanceCacheSlot(int slot, int delta)
+{
+    if (instanceCache[slot].cacheState != INSTVALID)
+        return;
+
+    if (!strcmp(instanceCache[slot].instance.state, "Extant") || !strcmp(instanceCache[slot].instance.state, "Pending")) {
+        instanceCacheMetadata->numInstsActive += delta;
+    }
+    instanceCacheMetadata->numInsts += delta;
+}
+
+//!
+//! Reader for peek_instanceCacheId() returning the index of the node the
+//! instance runs on
+//!
+//! @param[in]  inst the cached instance
+//! @param[out] ncHostIdx a pointer to an integer receiving the node index
+//!
+//! @return Always 0
+//!
+static int read_instanceNodeIdx(const ccInstance * inst, void *ncHostIdx)
+{
+    *((int *)ncHostIdx) = inst->ncHostIdx;
+    return (0);
+}
+
 //!
 //!
 //!
@@ -7042,19 +7814,38 @@ int pubIpSet(ccInstance * inst, void *ip)
 //!
 //! @pre
 //!
-//! @note
+//! @note when matching with pubIpCmp() or privIpCmp(), only the instances
+//!       filed under that address in the cache index are visited
 //!
 int map_instanceCache(int (*match) (ccInstance *, void *), void *matchParam, int (*operate) (ccInstance *, void *), void *operateParam)
 {
-    int i, ret = 0;
+    int i, next, ret = 0;
+    ccInstanceCacheChain *chain = NULL;
 
     sem_mywait(INSTCACHE);
-
-    for (i = 0; i < config->ccMaxInstances; i++) {
-        if (!match(&(instanceCache[i].instance), matchParam)) {
-            if (operate(&(instanceCache[i].instance), operateParam)) {
-                LOGWARN("instance cache mapping failed to operate at index %d\n", i);
-                ret++;
+    check_instanceCacheIndex();
+
+    if (((match == pubIpCmp) || (match == privIpCmp)) && matchParam) {
+        chain = ((match == pubIpCmp) ? &(instanceCacheMetadata->index.byPublicIp) : &(instanceCacheMetadata->index.byPrivateIp));
+        for (i = chain->head[hash_instanceCacheKey(matchParam)]; i >= 0; i = next) {
+            // operate() may change the address and move the slot to another chain
+            next = chain->next[i];
+            if (!match(&(instanceCache[i].instance), matchParam)) {
+                if (operate(&(instanceCache[i].instance), operateParam)) {
+                    LOGWARN("instance cache mapping failed to operate at index %d\n", i);
+                    ret++;
+                }
+                index_instanceCacheSlot(i);
+            }
+        }
+    } else {
+        for (i = 0; i < config->ccMaxInstances; i++) {
+            if (!match(&(instanceCache[i].instance), matchParam)) {
+                if (operate(&(instanceCache[i].instance), operateParam)) {
+                    LOGWARN("instance cache mapping failed to operate at index %d\n", i);
+                    ret++;
+                }
+                index_instanceCacheSlot(i);
             }
         }
     }
@@ -7271,6 +8062,11 @@ void invalidate_instanceCache(void)
         }
     }
     LOGDEBUG("instance counts: %d/%d\n", instanceCacheMetadata->numInsts, instanceCacheMetadata->numInstsActive);
+
+    // we just walked every slot anyway, so refile them all; this also repairs
+    // any slot that was written without going through index_instanceCacheSlot()
+    rebuild_instanceCacheIndex();
+
     sem_mypost(INSTCACHEMD);
     sem_mypost(INSTCACHE);
 }
@@ -7289,7 +8085,7 @@ void invalidate_instanceCache(void)
 //!
 int refresh_instanceCache(char *instanceId, ccInstance * in)
 {
-    int i, done;
+    int i;
 
     if (!instanceId || !in) {
         return (1);
@@ -7297,41 +8093,25 @@ int refresh_instanceCache(char *instanceId, ccInstance * in)
 
     sem_mywait(INSTCACHE);
     sem_mywait(INSTCACHEMD);
-    done = 0;
-    for (i = 0; i < config->ccMaxInstances && !done; i++) {
-        if (!strcmp(instanceCache[i].instance.instanceId, instanceId)) {
-            // in cache
-            // give precedence to instances that are in Extant/Pending over expired instances, when info comes from two different nodes
-            if (strcmp(in->serviceTag, instanceCache[i].instance.serviceTag) && strcmp(in->state, instanceCache[i].instance.state)
-                && !strcmp(in->state, "Teardown")) {
-                // skip
-                LOGDEBUG("skipping cache refresh with instance in Teardown (instance with non-Teardown from different node already cached)\n");
-            } else {
-                // update cached instance info
-                memcpy(&(instanceCache[i].instance), in, sizeof(ccInstance));
-                instanceCache[i].lastseen = time(NULL);
-            }
-            //            sem_mypost(INSTCACHE);
-            //            return (0);
-            done++;
+    if ((i = lookup_instanceCacheId(instanceId)) >= 0) {
+        // in cache
+        // give precedence to instances that are in Extant/Pending over expired instances, when info comes from two different nodes
+        if (strcmp(in->serviceTag, instanceCache[i].instance.serviceTag) && strcmp(in->state, instanceCache[i].instance.state)
+            && !strcmp(in->state, "Teardown")) {
+            // skip
+            LOGDEBUG("skipping cache refresh with instance in Teardown (instance with non-Teardown from different node already cached)\n");
+        } else {
+            // update cached instance info
+            count_instanceCacheSlot(i, -1);
+            memcpy(&(instanceCache[i].instance), in, sizeof(ccInstance));
+            instanceCache[i].lastseen = time(NULL);
+            count_instanceCacheSlot(i, 1);
+            index_instanceCacheSlot(i);
         }
-    }
-
-    if (!done) {
+    } else {
         // did not find the instance already in cache
         add_instanceCache(instanceId, in);
     }
-
-
-    instanceCacheMetadata->numInsts = instanceCacheMetadata->numInstsActive = 0;
-    for (i = 0; i < config->ccMaxInstances; i++) {
-        if ((instanceCache[i].cacheState == INSTVALID)) {
-            if ( !strcmp(instanceCache[i].instance.state, "Extant") || !strcmp(instanceCache[i].instance.state, "Pending") ) {
-                instanceCacheMetadata->numInstsActive++;
-            }
-            instanceCacheMetadata->numInsts++;
-        }
-    }
     LOGDEBUG("instance counts: %d/%d\n", instanceCacheMetadata->numInsts, instanceCacheMetadata->numInstsActive);
 
     sem_mypost(INSTCACHEMD);
@@ -7348,7 +8128,7 @@ int refresh_instanceCache(char *instanceId, ccInstance * in)
 //!
 //! @return
 //!
-//! @pre
+//! @pre INSTCACHE and INSTCACHEMD locks are held
 //!
 //! @note
 //!
@@ -7363,16 +8143,18 @@ int add_instanceCache(char *instanceId, ccInstance * in)
     ret = 0;
 
     //    sem_mywait(INSTCACHE);
+    if ((i = lookup_instanceCacheId(instanceId)) >= 0) {
+        // already in cache
+        LOGDEBUG("'%s/%s/%s' already in cache\n", instanceId, in->ccnet.publicIp, in->ccnet.privateIp);
+        instanceCache[i].lastseen = time(NULL);
+        //    sem_mypost(INSTCACHE);
+        return (0);
+    }
+
     firstNull = idxDescribedTeardown = idxNotDescribedTeardown = idxDescribedExtant = -1;
     done = 0;
     for (i = 0; i < config->ccMaxInstances && !done; i++) {
-        if ((instanceCache[i].cacheState == INSTVALID) && (!strcmp(instanceCache[i].instance.instanceId, instanceId))) {
-            // already in cache
-            LOGDEBUG("'%s/%s/%s' already in cache\n", instanceId, in->ccnet.publicIp, in->ccnet.privateIp);
-            instanceCache[i].lastseen = time(NULL);
-            //            sem_mypost(INSTCACHE);
-            return (0);
-        } else if (instanceCache[i].cacheState == INSTINVALID) {
+        if (instanceCache[i].cacheState == INSTINVALID) {
             firstNull = i;
             done++;
         } else if (!strcmp(instanceCache[i].instance.state, "Teardown") && instanceCache[i].described == 1) {
@@ -7403,6 +8185,7 @@ int add_instanceCache(char *instanceId, ccInstance * in)
         //        if (instanceCache->cacheState[cacheIdx] == INSTINVALID) {
         //            instanceCacheMetadata->numInsts++;
         //        }
+        count_instanceCacheSlot(cacheIdx, -1);
 
         allocate_ccInstance(&(instanceCache[cacheIdx].instance), in->instanceId, in->amiId, in->kernelId, in->ramdiskId, in->amiURL, in->kernelURL,
                             in->ramdiskURL, in->ownerId, in->accountId, in->state, in->ccState, in->ts, in->reservationId, &(in->ccnet), &(in->ncnet),
@@ -7411,6 +8194,8 @@ int add_instanceCache(char *instanceId, ccInstance * in)
         instanceCache[cacheIdx].described = 0;
         instanceCache[cacheIdx].lastseen = time(NULL);
         instanceCache[cacheIdx].cacheState = INSTVALID;
+        count_instanceCacheSlot(cacheIdx, 1);
+        index_instanceCacheSlot(cacheIdx);
     } else {
         LOGERROR("not enough cache space for storing instance [%s]: skipping update\n", instanceId);
         ret = 1;
@@ -7435,18 +8220,17 @@ int del_instanceCacheId(char *instanceId)
     int i;
 
     sem_mywait(INSTCACHE);
-    for (i = 0; i < config->ccMaxInstances; i++) {
-        if ((instanceCache[i].cacheState == INSTVALID) && (!strcmp(instanceCache[i].instance.instanceId, instanceId))) {
-            // del from cache
-            bzero(&(instanceCache[i].instance), sizeof(ccInstance));
-            instanceCache[i].described = 0;
-            instanceCache[i].lastseen = 0;
-            instanceCache[i].cacheState = INSTINVALID;
-            //            instanceCache->numInsts--;
-            //            instanceCache->numInstsActive = instanceCache->numInsts;
-            sem_mypost(INSTCACHE);
-            return (0);
-        }
+    if ((i = lookup_instanceCacheId(instanceId)) >= 0) {
+        // del from cache
+        sem_mywait(INSTCACHEMD);
+        count_instanceCacheSlot(i, -1);
+        sem_mypost(INSTCACHEMD);
+
+        unindex_instanceCacheSlot(i);
+        bzero(&(instanceCache[i].instance), sizeof(ccInstance));
+        instanceCache[i].described = 0;
+        instanceCache[i].lastseen = 0;
+        instanceCache[i].cacheState = INSTINVALID;
     }
     sem_mypost(INSTCACHE);
     return (0);
@@ -7475,33 +8259,31 @@ int find_instanceCacheId(char *instanceId, ccInstance ** out)
     sem_mywait(INSTCACHE);
     *out = NULL;
     done = 0;
-    for (i = 0; i < config->ccMaxInstances && !done; i++) {
-        if (!strcmp(instanceCache[i].instance.instanceId, instanceId)) {
-            // found it
-            *out = EUCA_ZALLOC(1, sizeof(ccInstance));
-            if (!*out) {
-                LOGFATAL("out of memory!\n");
-                unlock_exit(1);
-            }
-            allocate_ccInstance(*out, instanceCache[i].instance.instanceId, instanceCache[i].instance.amiId, instanceCache[i].instance.kernelId,
-                                instanceCache[i].instance.ramdiskId, instanceCache[i].instance.amiURL, instanceCache[i].instance.kernelURL,
-                                instanceCache[i].instance.ramdiskURL, instanceCache[i].instance.ownerId, instanceCache[i].instance.accountId,
-                                instanceCache[i].instance.state, instanceCache[i].instance.ccState, instanceCache[i].instance.ts,
-                                instanceCache[i].instance.reservationId, &(instanceCache[i].instance.ccnet), &(instanceCache[i].instance.ncnet),
-                                &(instanceCache[i].instance.ccvm), instanceCache[i].instance.ncHostIdx, instanceCache[i].instance.keyName,
-                                instanceCache[i].instance.serviceTag, instanceCache[i].instance.userData, instanceCache[i].instance.launchIndex,
-                                instanceCache[i].instance.platform, instanceCache[i].instance.guestStateName, instanceCache[i].instance.bundleTaskStateName,
-                                instanceCache[i].instance.groupNames, instanceCache[i].instance.groupIds, instanceCache[i].instance.volumes,
-                                instanceCache[i].instance.volumesSize, instanceCache[i].instance.bundleTaskProgress, instanceCache[i].instance.secNetCfgs,
-                                instanceCache[i].instance.secNetCfgsSize);
-            LOGTRACE("found instance in cache '%s/%s/%s'\n", instanceCache[i].instance.instanceId,
-                     instanceCache[i].instance.ccnet.publicIp, instanceCache[i].instance.ccnet.privateIp);
-            // migration-related
-            // TO-DO: move to allocate_ccInstance() ?
-            (*out)->migration_state = instanceCache[i].instance.migration_state;
-            LOGTRACE("instance %s migration state=%s\n", instanceCache[i].instance.instanceId, migration_state_names[(*out)->migration_state]);
-            done++;
+    if ((i = lookup_instanceCacheId(instanceId)) >= 0) {
+        // found it
+        *out = EUCA_ZALLOC(1, sizeof(ccInstance));
+        if (!*out) {
+            LOGFATAL("out of memory!\n");
+            unlock_exit(1);
         }
+        allocate_ccInstance(*out, instanceCache[i].instance.instanceId, instanceCache[i].instance.amiId, instanceCache[i].instance.kernelId,
+                            instanceCache[i].instance.ramdiskId, instanceCache[i].instance.amiURL, instanceCache[i].instance.kernelURL,
+                            instanceCache[i].instance.ramdiskURL, instanceCache[i].instance.ownerId, instanceCache[i].instance.accountId,
+                            instanceCache[i].instance.state, instanceCache[i].instance.ccState, instanceCache[i].instance.ts,
+                            instanceCache[i].instance.reservationId, &(instanceCache[i].instance.ccnet), &(instanceCache[i].instance.ncnet),
+                            &(instanceCache[i].instance.ccvm), instanceCache[i].instance.ncHostIdx, instanceCache[i].instance.keyName,
+                            instanceCache[i].instance.serviceTag, instanceCache[i].instance.userData, instanceCache[i].instance.launchIndex,
+                            instanceCache[i].instance.platform, instanceCache[i].instance.guestStateName, instanceCache[i].instance.bundleTaskStateName,
+                            instanceCache[i].instance.groupNames, instanceCache[i].instance.groupIds, instanceCache[i].instance.volumes,
+                            instanceCache[i].instance.volumesSize, instanceCache[i].instance.bundleTaskProgress, instanceCache[i].instance.secNetCfgs,
+                            instanceCache[i].instance.secNetCfgsSize);
+        LOGTRACE("found instance in cache '%s/%s/%s'\n", instanceCache[i].instance.instanceId,
+                 instanceCache[i].instance.ccnet.publicIp, instanceCache[i].instance.ccnet.privateIp);
+        // migration-related
+        // TO-DO: move to allocate_ccInstance() ?
+        (*out)->migration_state = instanceCache[i].instance.migration_state;
+        LOGTRACE("instance %s migration state=%s\n", instanceCache[i].instance.instanceId, migration_state_names[(*out)->migration_state]);
+        done++;
     }
     sem_mypost(INSTCACHE);
     if (done) {
@@ -7533,30 +8315,26 @@ int find_instanceCacheIP(char *ip, ccInstance ** out)
     sem_mywait(INSTCACHE);
     *out = NULL;
     done = 0;
-    for (i = 0; i < config->ccMaxInstances && !done; i++) {
-        if ((instanceCache[i].instance.ccnet.publicIp[0] != '\0' || instanceCache[i].instance.ccnet.privateIp[0] != '\0')) {
-            if (!strcmp(instanceCache[i].instance.ccnet.publicIp, ip) || !strcmp(instanceCache[i].instance.ccnet.privateIp, ip)) {
-                // found it
-                *out = EUCA_ZALLOC(1, sizeof(ccInstance));
-                if (!*out) {
-                    LOGFATAL("out of memory!\n");
-                    unlock_exit(1);
-                }
-                allocate_ccInstance(*out, instanceCache[i].instance.instanceId, instanceCache[i].instance.amiId,
-                                    instanceCache[i].instance.kernelId, instanceCache[i].instance.ramdiskId, instanceCache[i].instance.amiURL,
-                                    instanceCache[i].instance.kernelURL, instanceCache[i].instance.ramdiskURL,
-                                    instanceCache[i].instance.ownerId, instanceCache[i].instance.accountId, instanceCache[i].instance.state,
-                                    instanceCache[i].instance.ccState, instanceCache[i].instance.ts, instanceCache[i].instance.reservationId,
-                                    &(instanceCache[i].instance.ccnet), &(instanceCache[i].instance.ncnet), &(instanceCache[i].instance.ccvm),
-                                    instanceCache[i].instance.ncHostIdx, instanceCache[i].instance.keyName,
-                                    instanceCache[i].instance.serviceTag, instanceCache[i].instance.userData,
-                                    instanceCache[i].instance.launchIndex, instanceCache[i].instance.platform,
-                                    instanceCache[i].instance.guestStateName, instanceCache[i].instance.bundleTaskStateName, instanceCache[i].instance.groupNames,
-                                    instanceCache[i].instance.groupIds, instanceCache[i].instance.volumes, instanceCache[i].instance.volumesSize,
-                                    instanceCache[i].instance.bundleTaskProgress, instanceCache[i].instance.secNetCfgs, instanceCache[i].instance.secNetCfgsSize);
-                done++;
-            }
+    if ((i = lookup_instanceCacheIP(ip)) >= 0) {
+        // found it
+        *out = EUCA_ZALLOC(1, sizeof(ccInstance));
+        if (!*out) {
+            LOGFATAL("out of memory!\n");
+            unlock_exit(1);
         }
+        allocate_ccInstance(*out, instanceCache[i].instance.instanceId, instanceCache[i].instance.amiId,
+                            instanceCache[i].instance.kernelId, instanceCache[i].instance.ramdiskId, instanceCache[i].instance.amiURL,
+                            instanceCache[i].instance.kernelURL, instanceCache[i].instance.ramdiskURL,
+                            instanceCache[i].instance.ownerId, instanceCache[i].instance.accountId, instanceCache[i].instance.state,
+                            instanceCache[i].instance.ccState, instanceCache[i].instance.ts, instanceCache[i].instance.reservationId,
+                            &(instanceCache[i].instance.ccnet), &(instanceCache[i].instance.ncnet), &(instanceCache[i].instance.ccvm),
+                            instanceCache[i].instance.ncHostIdx, instanceCache[i].instance.keyName,
+                            instanceCache[i].instance.serviceTag, instanceCache[i].instance.userData,
+                            instanceCache[i].instance.launchIndex, instanceCache[i].instance.platform,
+                            instanceCache[i].instance.guestStateName, instanceCache[i].instance.bundleTaskStateName, instanceCache[i].instance.groupNames,
+                            instanceCache[i].instance.groupIds, instanceCache[i].instance.volumes, instanceCache[i].instance.volumesSize,
+                            instanceCache[i].instance.bundleTaskProgress, instanceCache[i].instance.secNetCfgs, instanceCache[i].instance.secNetCfgsSize);
+        done++;
     }
 
     sem_mypost(INSTCACHE);
@@ -7566,6 +8344,128 @@ int find_instanceCacheIP(char *ip, ccInstance ** out)
     return (1);
 }
 
+//!
+//! Runs a reader on the cached copy of an instance without copying it. The
+//! reader is called with the instance cache locked and must not keep the
+//! pointer nor call back into the instance cache.
+//!
+//! @param[in] instanceId the instance identifier
+//! @param[in] reader function called with the cached instance
+//! @param[in] readerParam opaque argument handed to the reader
+//!
+//! @return the reader's return value (0 for success by convention) or 1 if
+//!         the instance is not in the cache
+//!
+//! @see find_instanceCacheId() for a private, deep copy of the instance
+//!
+int peek_instanceCacheId(char *instanceId, int (*reader) (const ccInstance *, void *), void *readerParam)
+{
+    int i, ret = 1;
+
+    if (!instanceId || !reader) {
+        return (1);
+    }
+
+    sem_mywait(INSTCACHE);
+    if ((i = lookup_instanceCacheId(instanceId)) >= 0) {
+        ret = reader(&(instanceCache[i].instance), readerParam);
+    }
+    sem_mypost(INSTCACHE);
+    return (ret);
+}
+
+//!
+//! Same as peek_instanceCacheId() but finds the instance by its public or
+//! private IP address
+//!
+//! @param[in] ip the public or private IP address
+//! @param[in] reader function called with the cached instance
+//! @param[in] readerParam opaque argument handed to the reader
+//!
+//! @return the reader's return value (0 for success by convention) or 1 if
+//!         no cached instance has that address
+//!
+int peek_instanceCacheIP(char *ip, int (*reader) (const ccInstance *, void *), void *readerParam)
+{
+    int i, ret = 1;
+
+    if (!ip || !reader) {
+        return (1);
+    }
+
+    sem_mywait(INSTCACHE);
+    if ((i = lookup_instanceCacheIP(ip)) >= 0) {
+        ret = reader(&(instanceCache[i].instance), readerParam);
+    }
+    sem_mypost(INSTCACHE);
+    return (ret);
+}
+
+//!
+//! Retrieves the index (in the resource cache) of the node an instance runs on
+//!
+//! @param[in]  instanceId the instance identifier
+//! @param[out] ncHostIdx a pointer to an integer receiving the node index
+//!
+//! @return 0 on success or 1 if the instance is not in the cache
+//!
+int find_instanceCacheNodeIdx(char *instanceId, int *ncHostIdx)
+{
+    if (!ncHostIdx) {
+        return (1);
+    }
+    return (peek_instanceCacheId(instanceId, read_instanceNodeIdx, ncHostIdx));
+}
+
+//!
+//! Marks as seen the cached instances of a node that a delta ncDescribeInstances
+//! reply left out because they did not change. Only instances seen since the
+//! node's last full reply are touched, so that an instance the node never
+//! reported still ages out once the next full reply omits it.
+//!
+//! @param[in]  ncHostIdx index of the node in the resource cache
+//! @param[in]  since time of the node's last full reply
+//! @param[in]  skipIds identifiers of the instances the node reported as removed
+//! @param[in]  skipIdsLen number of identifiers in skipIds
+//! @param[out] migrating optional, set to TRUE if one of the instances is migrating
+//!
+//! @return the number of instances of the node that were touched
+//!
+int touch_instanceCacheNode(int ncHostIdx, time_t since, char **skipIds, int skipIdsLen, boolean * migrating)
+{
+    int i, j, count = 0;
+    time_t now = time(NULL);
+    ccInstanceCacheChain *byNode = NULL;
+
+    if (migrating) {
+        *migrating = FALSE;
+    }
+    if ((ncHostIdx < 0) || (ncHostIdx >= MAXNODES)) {
+        return (0);
+    }
+
+    sem_mywait(INSTCACHE);
+    check_instanceCacheIndex();
+    byNode = &(instanceCacheMetadata->index.byNode);
+    for (i = byNode->head[ncHostIdx]; i >= 0; i = byNode->next[i]) {
+        if ((instanceCache[i].cacheState != INSTVALID) || (instanceCache[i].lastseen < since)) {
+            continue;
+        }
+        for (j = 0; (j < skipIdsLen) && strcmp(skipIds[j], instanceCache[i].instance.instanceId); j++) ;
+        if (j < skipIdsLen) {
+            continue;
+        }
+
+        instanceCache[i].lastseen = now;
+        if (migrating && (instanceCache[i].instance.migration_state != NOT_MIGRATING)) {
+            *migrating = TRUE;
+        }
+        count++;
+    }
+    sem_mypost(INSTCACHE);
+    return (count);
+}
+
 //!
 //! Updates the canonical cache of resources based on the
 //! configuration. The configuration may bring new nodes,
@@ -7669,28 +8569,31 @@ static void reconfigure_resourceCache(ccResource * res, int numHosts)
 static int reindex_instanceCache(int removed_index, ccResource * removed_resource)
 {
     int ret = EUCA_OK;
+    ccInstanceCacheChain *byNode = NULL;
 
     // reset the indexes of all concerned instances, atomically
     sem_mywait(INSTCACHE);
     {
-        for (int i = 0; i < config->ccMaxInstances; i++) {
-            ccInstance *inst = &instanceCache[i].instance;
+        check_instanceCacheIndex();
+        byNode = &(instanceCacheMetadata->index.byNode);
 
-            if ((instanceCache[i].cacheState == INSTVALID) &&  // a valid instance slot
-                (inst->ncHostIdx == removed_index)) {   // is pointing to the host being removed
-                LOGWARN("BUG: instance struct (%s) points to node to be removed (%s)\n", inst->instanceId, removed_resource->hostname);
-                ret = EUCA_ERROR;
-                break;
-            }
+        if ((removed_index >= 0) && (removed_index < MAXNODES) && (byNode->head[removed_index] >= 0)) {
+            // a valid instance slot is pointing to the host being removed
+            LOGWARN("BUG: instance struct (%s) points to node to be removed (%s)\n", instanceCache[byNode->head[removed_index]].instance.instanceId,
+                    removed_resource->hostname);
+            ret = EUCA_ERROR;
         }
-        if (ret == EUCA_OK) {
-            for (int i = 0; i < config->ccMaxInstances; i++) {
-                ccInstance *inst = &instanceCache[i].instance;
-                if ((instanceCache[i].cacheState == INSTVALID) &&  // a valid instance slot
-                    (inst->ncHostIdx > removed_index)) {    // host index bigger than one being removed
-                    inst->ncHostIdx--;
+        if ((ret == EUCA_OK) && (removed_index >= 0) && (removed_index < MAXNODES)) {
+            // only instances on hosts with an index bigger than the one being removed are
+            // affected; shift their node chains down along with the index they hold
+            for (int node = removed_index + 1; node < MAXNODES; node++) {
+                for (int i = byNode->head[node]; i >= 0; i = byNode->next[i]) {
+                    instanceCache[i].instance.ncHostIdx--;
+                    byNode->bucket[i] = node - 1;
                 }
             }
+            memmove(&(byNode->head[removed_index]), &(byNode->head[removed_index + 1]), sizeof(int) * (MAXNODES - removed_index - 1));
+            byNode->head[MAXNODES - 1] = -1;
         }
     }
     sem_mypost(INSTCACHE);
@@ -7762,6 +8665,29 @@ static void refresh_resourceCache(ccResourceCache * updatedResourceCache, boolea
     sem_mypost(RESCACHE);
 }
 
+//!
+//! Copies the latest information about a single node into the canonical
+//! resource cache. Unlike refresh_resourceCache(), nodes that are no longer
+//! configured are left alone.
+//!
+//! @param[in] updatedResource the refreshed node
+//!
+static void refresh_resourceCacheNode(ccResource * updatedResource)
+{
+    sem_mywait(RESCACHE);
+    {
+        for (int j = 0; j < resourceCache->numResources; j++) {
+            if (strncmp(updatedResource->hostname, resourceCache->resources[j].hostname, sizeof(((ccResource *) 0)->hostname)) == 0) {
+                if (resourceCache->cacheState[j] != RES_UNCONFIGURED) {
+                    memcpy(resourceCache->resources + j, updatedResource, sizeof(ccResource));
+                }
+                break;
+            }
+        }
+    }
+    sem_mypost(RESCACHE);
+}
+
 //!
 //!
 //!
@@ -7990,12 +8916,10 @@ int image_cache_proxykick(ccResource * res, int *numHosts)
 int doAttachNetworkInterface(ncMetadata * pMeta, char *instanceId, netConfig * netCfg){
     return (-1);
     int i, rc, start = 0, stop = 0, ret = 0, done = 0, timeout;
-    ccInstance *myInstance;
     time_t op_start;
     ccResourceCache resourceCacheLocal;
 
     i = 0;
-    myInstance = NULL;
     op_start = time(NULL);
 
     rc = initialize(pMeta, FALSE);
@@ -8016,14 +8940,9 @@ int doAttachNetworkInterface(ncMetadata * pMeta, char *instanceId, netConfig * n
     memcpy(&resourceCacheLocal, resourceCache, sizeof(ccResourceCache));
     sem_mypost(RESCACHE);
 
-    rc = find_instanceCacheId(instanceId, &myInstance);
-    if (!rc) {
+    if ((rc = find_instanceCacheNodeIdx(instanceId, &start)) == 0) {
         // found the instance in the cache
-        if (myInstance) {
-            start = myInstance->ncHostIdx;
-            stop = start + 1;
-            EUCA_FREE(myInstance);
-        }
+        stop = start + 1;
     } else {
         start = 0;
         stop = resourceCacheLocal.numResources;
@@ -8068,12 +8987,10 @@ int doAttachNetworkInterface(ncMetadata * pMeta, char *instanceId, netConfig * n
 int doDetachNetworkInterface(ncMetadata * pMeta, char *instanceId, char *attachmentId, int force){
     return (-1);
     int i, rc, start = 0, stop = 0, ret = 0, done = 0, timeout;
-    ccInstance *myInstance;
     time_t op_start;
     ccResourceCache resourceCacheLocal;
 
     i = 0;
-    myInstance = NULL;
     op_start = time(NULL);
 
     rc = initialize(pMeta, FALSE);
@@ -8092,14 +9009,9 @@ int doDetachNetworkInterface(ncMetadata * pMeta, char *instanceId, char *attachm
     memcpy(&resourceCacheLocal, resourceCache, sizeof(ccResourceCache));
     sem_mypost(RESCACHE);
 
-    rc = find_instanceCacheId(instanceId, &myInstance);
-    if (!rc) {
+    if ((rc = find_instanceCacheNodeIdx(instanceId, &start)) == 0) {
         // found the instance in the cache
-        if (myInstance) {
-            start = myInstance->ncHostIdx;
-            stop = start + 1;
-            EUCA_FREE(myInstance);
-        }
+        stop = start + 1;
     } else {
         start = 0;
         stop = resourceCacheLocal.numResources;
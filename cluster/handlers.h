@@ -96,6 +96,8 @@
 #define LOG_INTERVAL_SUMMARY_SEC                 60
 #define SCHED_TIMEOUT_SEC                         8 //! timeout for user scheduler
 #define MESSAGE_STATS_MEMORY_REGION_SIZE         10485760   //! 10 MB
+#define INSTCACHE_HASH_BUCKETS                   (2 * MAX_INSTANCES_PER_CC)    //! buckets per instance cache index (power of two)
+#define NC_DESCRIBE_FULL_ROUNDS                  10 //! with NC_DESCRIBE_DELTA, ask each NC for its full instance list at least this often
 
 /*
 {
@@ -216,6 +218,7 @@ enum {
     SCHEDROUNDROBIN,
     SCHEDPOWERSAVE,
     SCHEDUSER,
+    SCHEDBESTFIT,
     SCHEDLAST,
 };
 
@@ -305,6 +308,13 @@ typedef struct resource_t {
     char nodeStatus[24];
     boolean migrationCapable;
     char hypervisor[16];
+    // round-trip time of the last ncDescribeResource, in milliseconds
+    long long rttMs;
+    // change sequence of the node's instances as of the last ncDescribeInstances (0 asks for a full list)
+    long long instSeqEpoch;
+    long long instSeq;
+    time_t instFullAt;
+    int instDeltaRounds;
 } ccResource;
 
 typedef struct ccResourceCache_t {
@@ -325,11 +335,38 @@ typedef struct ccInstanceCache_t {
     int described;
 } ccInstanceCache;
 
+//
+// One secondary index over instanceCache[]: every bucket heads a chain of
+// cache slots linked through next[]. The bucket each slot was filed under is
+// remembered in bucket[] so that the slot can be unlinked even after the
+// instance it holds was overwritten in place. Only INSTVALID slots are
+// linked; -1 terminates a chain and marks an unlinked slot.
+//
+typedef struct ccInstanceCacheChain_t {
+    int head[INSTCACHE_HASH_BUCKETS];
+    int next[MAX_INSTANCES_PER_CC];
+    int bucket[MAX_INSTANCES_PER_CC];
+} ccInstanceCacheChain;
+
+//
+// Indexes over instanceCache[] by instance ID, public IP, private IP and node
+// (ncHostIdx). They live in shared memory next to the cache metadata and
+// are protected by the INSTCACHE lock, like the cache itself.
+//
+typedef struct ccInstanceCacheIndex_t {
+    int numSlots;                      // number of cache slots the index was built for (0 if never built)
+    ccInstanceCacheChain byId;
+    ccInstanceCacheChain byPublicIp;
+    ccInstanceCacheChain byPrivateIp;
+    ccInstanceCacheChain byNode;
+} ccInstanceCacheIndex;
+
 typedef struct ccInstanceCacheMetadata_t {
     int numInsts; 
     int numInstsActive;
     int instanceCacheUpdate;
     int dirty;
+    ccInstanceCacheIndex index;
 } ccInstanceCacheMetadata;
 
 typedef struct ccConfig_t {
@@ -359,7 +396,11 @@ typedef struct ccConfig_t {
     time_t clcPollingFrequency;
     time_t ncSensorsPollingInterval;
     int threads[NUM_THREADS];
-    int ncFanout;
+    int ncClientPool;
+    int ncPollConcurrency;
+    int ncDescribeDelta;
+    int addrMapSeq;                    //!< Bumped whenever the CC maps or unmaps a public address (NC_DESCRIBE_DELTA only)
+    int addrMapSyncedSeq;              //!< Value of addrMapSeq when the last full instance poll started
     int ccState;
     int ccLastState;
     int kick_network;
@@ -428,6 +469,9 @@ int schedule_instance_roundrobin(virtualMachine * vm, int *outresid);
 int schedule_instance_explicit(virtualMachine * vm, char *targetNode, int *outresid, boolean is_migration);
 int schedule_instance_user(virtualMachine * vm, char *amiId, char *kernelId, char *ramdiskId, char *instId, char *userData, char *platform, int *outresid);
 int schedule_instance_greedy(virtualMachine * vm, int *outresid);
+int schedule_instance_bestfit(virtualMachine * vm, int *outresid);
+int schedule_instance_batch(virtualMachine * vm, int count, int *plan);
+int schedule_instance_planned(virtualMachine * vm, int resid, int *outresid);
 int doRunInstances(ncMetadata * pMeta, char *amiId, char *kernelId, char *ramdiskId, char *amiURL, char *kernelURL, char *ramdiskURL, char **instIds,
                    int instIdsLen, char **netNames, int netNamesLen, char **netIds, int netIdsLen, char **macAddrs, int macAddrsLen, int *networkIndexList,
                    int networkIndexListLen, char **uuids, int uuidsLen, char **privateIps, int privateIpsLen, int minCount, int maxCount, char *accountId,
@@ -488,6 +532,10 @@ int add_instanceCache(char *instanceId, ccInstance * in);
 int del_instanceCacheId(char *instanceId);
 int find_instanceCacheId(char *instanceId, ccInstance ** out);
 int find_instanceCacheIP(char *ip, ccInstance ** out);
+int peek_instanceCacheId(char *instanceId, int (*reader) (const ccInstance *, void *), void *readerParam);
+int peek_instanceCacheIP(char *ip, int (*reader) (const ccInstance *, void *), void *readerParam);
+int find_instanceCacheNodeIdx(char *instanceId, int *ncHostIdx);
+int touch_instanceCacheNode(int ncHostIdx, time_t since, char **skipIds, int skipIdsLen, boolean * migrating);
 void unlock_exit(int code);
 int sem_mywait(int lockno);
 int sem_mypost(int lockno);
@@ -0,0 +1,239 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+//!
+//! @file cluster/nc-poll.c
+//! In-process engine that polls every NC with a bounded number of requests
+//! in flight.
+//!
+//! The monitor used to fork one child per NC for every refresh and then wait
+//! for the children one at a time, with a named semaphore limiting how many
+//! were alive at once. A slow node therefore held up the collection of every
+//! node after it and each poll paid for a fork().
+//!
+//! nc_poll_run() instead starts up to maxInFlight worker threads that pull
+//! node indexes off a shared cursor. As soon as a worker is done with one
+//! node it picks up the next one, so the round completes in roughly the time
+//! of the slowest node rather than the sum of the stragglers. Results are
+//! applied by the per-node callback as each reply arrives. The NC calls made
+//! from the callbacks go through the pooled, non-forking ncClientCall() path,
+//! whose stub timeout bounds how long any single worker can be held up.
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  INCLUDES                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <eucalyptus.h>
+#include <misc.h>
+#include <log.h>
+
+#include "nc-poll.h"
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                 STRUCTURES                                 |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! State shared by the workers of one poll round
+typedef struct ncPollContext_t {
+    pthread_mutex_t mutex;             //!< Protects every field below
+    int next;                          //!< Next node index to hand out
+    int inFlight;                      //!< Callbacks currently running
+    int numNodes;                      //!< Number of nodes in this round
+    ncPollFunc func;                   //!< Per-node callback
+    void *arg;                         //!< Opaque argument for the callback
+    long long *rttMs;                  //!< Optional per-node round-trip times (numNodes entries)
+    ncPollSummary *summary;            //!< Summary being filled in
+    boolean threaded;                  //!< Set when the round runs on more than one thread
+} ncPollContext;
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                              STATIC VARIABLES                              |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+static __thread boolean in_threaded_round = FALSE; //!< Set while this thread runs callbacks next to other workers
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                              STATIC PROTOTYPES                             |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+static void *nc_poll_worker(void *arg);
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                               IMPLEMENTATION                               |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//!
+//! Worker loop: take the next unclaimed node, run the callback for it and
+//! account for the result until no node is left.
+//!
+//! @param[in] arg a pointer to the ncPollContext of the round
+//!
+//! @return Always NULL
+//!
+static void *nc_poll_worker(void *arg)
+{
+    int idx = 0;
+    int rc = 0;
+    long long startMs = 0;
+    long long elapsedMs = 0;
+    ncPollContext *ctx = ((ncPollContext *) arg);
+
+    in_threaded_round = ctx->threaded;
+    for (;;) {
+        pthread_mutex_lock(&ctx->mutex);
+        {
+            if (ctx->next >= ctx->numNodes) {
+                pthread_mutex_unlock(&ctx->mutex);
+                break;
+            }
+            idx = ctx->next++;
+            ctx->inFlight++;
+            if (ctx->inFlight > ctx->summary->peakInFlight)
+                ctx->summary->peakInFlight = ctx->inFlight;
+        }
+        pthread_mutex_unlock(&ctx->mutex);
+
+        startMs = time_ms();
+        rc = ctx->func(idx, ctx->arg);
+        elapsedMs = time_ms() - startMs;
+
+        pthread_mutex_lock(&ctx->mutex);
+        {
+            ctx->inFlight--;
+            if (rc)
+                ctx->summary->numFailed++;
+            if (ctx->rttMs)
+                ctx->rttMs[idx] = elapsedMs;
+            if (elapsedMs >= ctx->summary->maxRttMs) {
+                ctx->summary->maxRttMs = elapsedMs;
+                ctx->summary->slowestIdx = idx;
+            }
+        }
+        pthread_mutex_unlock(&ctx->mutex);
+    }
+    in_threaded_round = FALSE;
+
+    return (NULL);
+}
+
+//!
+//! Tells whether the calling thread is running poll callbacks while other
+//! poll workers of the process may be running too. Such callers must not
+//! fork(), as the child would inherit locks held by the other threads.
+//!
+//! @return TRUE if called from a callback of a multi-threaded poll round
+//!
+boolean nc_poll_in_threaded_round(void)
+{
+    return (in_threaded_round);
+}
+
+//!
+//! Runs one poll round: invokes func(idx, arg) once for every idx in
+//! [0, numNodes) with at most maxInFlight invocations running at once, and
+//! returns once every node has been handled.
+//!
+//! @param[in]  opName name of the operation, used for logging only
+//! @param[in]  numNodes number of nodes to poll
+//! @param[in]  maxInFlight maximum number of concurrent callbacks
+//! @param[in]  func the per-node callback
+//! @param[in]  arg opaque argument handed to the callback
+//! @param[out] rttMs optional array of numNodes entries receiving each node's round-trip time
+//! @param[out] summary optional summary of the round
+//!
+//! @return EUCA_OK if every callback succeeded, EUCA_ERROR if any failed, or
+//!         EUCA_INVALID_ERROR if the parameters are bad
+//!
+//! @pre func must not be NULL
+//!
+//! @note the calling thread takes part in the round; if no additional worker
+//!       can be started the nodes are simply polled one after the other
+//!
+int nc_poll_run(const char *opName, int numNodes, int maxInFlight, ncPollFunc func, void *arg, long long *rttMs, ncPollSummary * summary)
+{
+    int i = 0;
+    int numWorkers = 0;
+    int numStarted = 0;
+    long long startMs = 0;
+    pthread_t workers[NC_POLL_MAX_INFLIGHT] = { 0 };
+    ncPollSummary localSummary = { 0 };
+    ncPollContext ctx = { 0 };
+
+    if ((func == NULL) || (numNodes < 0))
+        return (EUCA_INVALID_ERROR);
+
+    if (summary == NULL)
+        summary = &localSummary;
+    bzero(summary, sizeof(ncPollSummary));
+    summary->numNodes = numNodes;
+    summary->slowestIdx = -1;
+    if (numNodes == 0)
+        return (EUCA_OK);
+
+    maxInFlight = maxint(minint(maxInFlight, NC_POLL_MAX_INFLIGHT), NC_POLL_MIN_INFLIGHT);
+    numWorkers = minint(maxInFlight, numNodes);
+
+    pthread_mutex_init(&ctx.mutex, NULL);
+    ctx.numNodes = numNodes;
+    ctx.func = func;
+    ctx.arg = arg;
+    ctx.rttMs = rttMs;
+    ctx.summary = summary;
+    ctx.threaded = (numWorkers > 1) ? TRUE : FALSE;
+
+    // The calling thread is one of the workers
+    startMs = time_ms();
+    for (numStarted = 0; numStarted < (numWorkers - 1); numStarted++) {
+        if (pthread_create(&workers[numStarted], NULL, nc_poll_worker, &ctx) != 0) {
+            LOGWARN("%s: could only start %d of %d poll workers\n", SP(opName), (numStarted + 1), numWorkers);
+            break;
+        }
+    }
+    summary->numWorkers = numStarted + 1;
+
+    nc_poll_worker(&ctx);
+
+    for (i = 0; i < numStarted; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    summary->elapsedMs = time_ms() - startMs;
+    pthread_mutex_destroy(&ctx.mutex);
+
+    LOGDEBUG("%s: polled %d nodes in %lld ms (workers=%d peak in flight=%d failed=%d slowest=%d at %lld ms)\n",
+             SP(opName), summary->numNodes, summary->elapsedMs, summary->numWorkers, summary->peakInFlight, summary->numFailed, summary->slowestIdx,
+             summary->maxRttMs);
+
+    return ((summary->numFailed > 0) ? EUCA_ERROR : EUCA_OK);
+}
@@ -0,0 +1,84 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+#ifndef _INCLUDE_NC_POLL_H_
+#define _INCLUDE_NC_POLL_H_
+
+//!
+//! @file cluster/nc-poll.h
+//! In-process engine that polls every NC with a bounded number of requests
+//! in flight.
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  INCLUDES                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#include <eucalyptus.h>
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  DEFINES                                   |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#define NC_POLL_MIN_INFLIGHT                           1    //!< Smallest accepted value for NC_POLL_CONCURRENCY
+#define NC_POLL_MAX_INFLIGHT                          64    //!< Largest accepted value for NC_POLL_CONCURRENCY
+#define NC_POLL_DEFAULT_INFLIGHT                      16    //!< Default number of NC requests in flight during a poll
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                 TYPEDEFS                                   |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! Per-node poll callback, invoked from a worker thread. Each index is handed
+//! to exactly one worker so the callback may update per-node state without
+//! locking; anything shared across nodes must be protected by the callback.
+typedef int (*ncPollFunc) (int idx, void *arg);
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                 STRUCTURES                                 |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! Outcome of one poll round across all nodes
+typedef struct ncPollSummary_t {
+    int numNodes;                      //!< Number of nodes handed to the engine
+    int numFailed;                     //!< Number of nodes whose callback returned non-zero
+    int numWorkers;                    //!< Number of worker threads that were started
+    int peakInFlight;                  //!< Largest number of callbacks observed running at once
+    long long elapsedMs;               //!< Wall-clock duration of the whole round
+    long long maxRttMs;                //!< Slowest single node
+    int slowestIdx;                    //!< Index of the slowest node (-1 if none)
+} ncPollSummary;
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                             EXPORTED PROTOTYPES                            |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+boolean nc_poll_in_threaded_round(void);
+int nc_poll_run(const char *opName, int numNodes, int maxInFlight, ncPollFunc func, void *arg, long long *rttMs, ncPollSummary * summary);
+
+#endif /* ! _INCLUDE_NC_POLL_H_ */
@@ -0,0 +1,416 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+//!
+//! @file cluster/nc-pool.c
+//! Process-local pool of long-lived NC client stubs.
+//!
+//! Creating an Axis2 environment and stub (and engaging rampart when
+//! WS-Security is on) is the dominant cost of a CC to NC call. The pool
+//! keeps up to NC_POOL_STUBS_PER_NODE initialized stubs per NC endpoint so
+//! that callers running in the same process (the monitor process, the
+//! request-handling processes) reuse them across calls. A stub is owned by
+//! exactly one caller between nc_pool_acquire() and nc_pool_release(), which
+//! makes the pool safe to use from multiple threads.
+//!
+//! The pool is never shared across fork(): the child side of an atfork
+//! handler forgets all inherited stubs so that a child never writes onto a
+//! connection that its parent is also using.
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  INCLUDES                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <eucalyptus.h>
+#include <misc.h>
+#include <euca_string.h>
+#include <euca_axis.h>
+#include <log.h>
+
+#include "nc-pool.h"
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                              STATIC VARIABLES                              |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static ncPoolEntry pool_entries[NC_POOL_MAX_NODES];
+static int pool_entries_len = 0;
+static ncPoolStats pool_stats = { 0 };
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                              STATIC PROTOTYPES                             |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+static void nc_pool_atfork_child(void);
+static void nc_pool_register_atfork(void);
+static ncPoolEntry *nc_pool_find_entry(const char *ncURL, boolean create);
+static void nc_pool_expire_idle(ncPoolEntry * entry, time_t now);
+static void nc_pool_stats_add(ncPoolStats * stats, int rc, long long elapsedMs);
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                               IMPLEMENTATION                               |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//!
+//! Resets the pool in a freshly forked child. Inherited stubs are forgotten,
+//! not destroyed: their sockets are still in use by the parent.
+//!
+static void nc_pool_atfork_child(void)
+{
+    pthread_mutex_init(&pool_mutex, NULL);
+    pthread_cond_init(&pool_cond, NULL);
+    bzero(pool_entries, sizeof(pool_entries));
+    bzero(&pool_stats, sizeof(pool_stats));
+    pool_entries_len = 0;
+}
+
+//!
+//! One-time registration of the fork handler
+//!
+static void nc_pool_register_atfork(void)
+{
+    pthread_atfork(NULL, NULL, nc_pool_atfork_child);
+}
+
+//!
+//! Initializes the pool for this process. Safe to call more than once.
+//!
+//! @return EUCA_OK
+//!
+int nc_pool_init(void)
+{
+    pthread_once(&pool_once, nc_pool_register_atfork);
+    return (EUCA_OK);
+}
+
+//!
+//! Looks up the pool entry for an endpoint. Must be called with pool_mutex held.
+//!
+//! @param[in] ncURL the NC endpoint URL
+//! @param[in] create set to TRUE to allocate an entry if none exists
+//!
+//! @return a pointer to the entry or NULL if not found (or the pool is full)
+//!
+static ncPoolEntry *nc_pool_find_entry(const char *ncURL, boolean create)
+{
+    int i = 0;
+    ncPoolEntry *entry = NULL;
+
+    for (i = 0; i < pool_entries_len; i++) {
+        if (!strcmp(pool_entries[i].ncURL, ncURL))
+            return (&(pool_entries[i]));
+    }
+
+    if (!create || (pool_entries_len >= NC_POOL_MAX_NODES))
+        return (NULL);
+
+    entry = &(pool_entries[pool_entries_len++]);
+    bzero(entry, sizeof(ncPoolEntry));
+    euca_strncpy(entry->ncURL, ncURL, sizeof(entry->ncURL));
+    return (entry);
+}
+
+//!
+//! Destroys stubs that have been idle for longer than NC_POOL_IDLE_TIMEOUT_SEC.
+//! Must be called with pool_mutex held.
+//!
+//! @param[in] entry the pool entry to inspect
+//! @param[in] now the current time
+//!
+static void nc_pool_expire_idle(ncPoolEntry * entry, time_t now)
+{
+    int i = 0;
+    ncPoolStub *slot = NULL;
+
+    for (i = 0; i < NC_POOL_STUBS_PER_NODE; i++) {
+        slot = &(entry->stubs[i]);
+        if (slot->stub && !slot->inUse && ((now - slot->lastUsed) > NC_POOL_IDLE_TIMEOUT_SEC)) {
+            LOGTRACE("dropping idle stub for %s\n", entry->ncURL);
+            ncStubDestroy(slot->stub);
+            bzero(slot, sizeof(ncPoolStub));
+        }
+    }
+}
+
+//!
+//! Hands out an initialized stub for the given endpoint, creating one if no
+//! idle stub is cached and the per-node limit allows it, or waiting for a busy
+//! one otherwise. The stub's transport timeout is set to the call deadline.
+//!
+//! @param[in] ncURL the NC endpoint URL
+//! @param[in] timeout the call deadline in seconds (0 for no deadline)
+//! @param[in] use_wssec set to TRUE to engage WS-Security on newly created stubs
+//! @param[in] policyFile the WS-Security policy file
+//!
+//! @return a stub that must be returned with nc_pool_release(), or NULL if none could be provided
+//!
+ncStub *nc_pool_acquire(const char *ncURL, int timeout, boolean use_wssec, const char *policyFile)
+{
+    int i = 0;
+    boolean waited = FALSE;
+    ncStub *stub = NULL;
+    ncPoolStub *slot = NULL;
+    ncPoolEntry *entry = NULL;
+
+    if (ncURL == NULL)
+        return (NULL);
+
+    nc_pool_init();
+
+    pthread_mutex_lock(&pool_mutex);
+    if ((entry = nc_pool_find_entry(ncURL, TRUE)) == NULL) {
+        pthread_mutex_unlock(&pool_mutex);
+        LOGWARN("NC client pool is full, cannot pool stub for %s\n", ncURL);
+        return (NULL);
+    }
+
+    while (slot == NULL) {
+        nc_pool_expire_idle(entry, time(NULL));
+
+        // prefer an idle, already initialized stub
+        for (i = 0; i < NC_POOL_STUBS_PER_NODE; i++) {
+            if (entry->stubs[i].stub && !entry->stubs[i].inUse) {
+                slot = &(entry->stubs[i]);
+                slot->inUse = TRUE;
+                entry->stats.hits++;
+                pool_stats.hits++;
+                break;
+            }
+        }
+
+        // otherwise reserve an empty slot and create the stub outside of the lock
+        if (slot == NULL) {
+            for (i = 0; i < NC_POOL_STUBS_PER_NODE; i++) {
+                if (!entry->stubs[i].stub && !entry->stubs[i].inUse) {
+                    slot = &(entry->stubs[i]);
+                    slot->inUse = TRUE;
+                    slot->stale = FALSE;
+                    entry->stats.misses++;
+                    pool_stats.misses++;
+                    break;
+                }
+            }
+        }
+
+        if (slot == NULL) {
+            if (!waited) {
+                entry->stats.waits++;
+                pool_stats.waits++;
+                waited = TRUE;
+            }
+            pthread_cond_wait(&pool_cond, &pool_mutex);
+        }
+    }
+    stub = slot->stub;
+    pthread_mutex_unlock(&pool_mutex);
+
+    if (stub == NULL) {
+        LOGTRACE("creating pooled stub for %s\n", ncURL);
+        if ((stub = ncStubCreate((char *)ncURL, NULL, NULL)) != NULL) {
+            if (use_wssec && (InitWSSEC(stub->env, stub->stub, (char *)policyFile) != EUCA_OK)) {
+                LOGERROR("failed to initialize WS-Security for pooled stub to %s\n", ncURL);
+                ncStubDestroy(stub);
+                stub = NULL;
+            } else {
+                ncStubSetKeepAlive(stub, TRUE);
+            }
+        }
+
+        pthread_mutex_lock(&pool_mutex);
+        slot->stub = stub;
+        if (stub == NULL) {
+            slot->inUse = FALSE;
+            pthread_cond_broadcast(&pool_cond);
+        }
+        pthread_mutex_unlock(&pool_mutex);
+    }
+
+    if (stub) {
+        ncStubSetTimeout(stub, ((long)timeout) * 1000L);
+    }
+    return (stub);
+}
+
+//!
+//! Accumulates the outcome of one call into a set of counters
+//!
+//! @param[in] stats the counters to update
+//! @param[in] rc the return code of the call
+//! @param[in] elapsedMs the call latency in milliseconds
+//!
+static void nc_pool_stats_add(ncPoolStats * stats, int rc, long long elapsedMs)
+{
+    stats->calls++;
+    stats->totalMs += elapsedMs;
+    if (elapsedMs > stats->maxMs)
+        stats->maxMs = elapsedMs;
+    if (rc)
+        stats->failures++;
+}
+
+//!
+//! Returns a stub obtained with nc_pool_acquire() and records the call outcome.
+//! Stubs that took part in a failed call are destroyed, since the state of
+//! their underlying connection is unknown.
+//!
+//! @param[in] stub the stub to return
+//! @param[in] rc the return code of the call made with the stub
+//! @param[in] elapsedMs the call latency in milliseconds
+//!
+void nc_pool_release(ncStub * stub, int rc, long long elapsedMs)
+{
+    int i = 0;
+    int j = 0;
+    boolean drop = FALSE;
+    ncPoolStub *slot = NULL;
+
+    if (stub == NULL)
+        return;
+
+    pthread_mutex_lock(&pool_mutex);
+    for (i = 0; (i < pool_entries_len) && (slot == NULL); i++) {
+        for (j = 0; j < NC_POOL_STUBS_PER_NODE; j++) {
+            if (pool_entries[i].stubs[j].stub == stub) {
+                slot = &(pool_entries[i].stubs[j]);
+                nc_pool_stats_add(&(pool_entries[i].stats), rc, elapsedMs);
+                break;
+            }
+        }
+    }
+    nc_pool_stats_add(&pool_stats, rc, elapsedMs);
+
+    if (slot) {
+        drop = (rc || slot->stale);
+        if (drop) {
+            bzero(slot, sizeof(ncPoolStub));
+        } else {
+            slot->inUse = FALSE;
+            slot->lastUsed = time(NULL);
+        }
+    } else {
+        // not ours (e.g. acquired before a flush or a fork), just get rid of it
+        drop = TRUE;
+    }
+    pthread_cond_broadcast(&pool_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    if (drop) {
+        ncStubDestroy(stub);
+    }
+}
+
+//!
+//! Destroys all idle stubs and marks busy ones to be destroyed when released.
+//! Used when configuration that affects stub creation (e.g. WS-Security) changes.
+//!
+void nc_pool_flush(void)
+{
+    int i = 0;
+    int j = 0;
+    ncPoolStub *slot = NULL;
+
+    pthread_mutex_lock(&pool_mutex);
+    for (i = 0; i < pool_entries_len; i++) {
+        for (j = 0; j < NC_POOL_STUBS_PER_NODE; j++) {
+            slot = &(pool_entries[i].stubs[j]);
+            if (slot->inUse) {
+                slot->stale = TRUE;
+            } else if (slot->stub) {
+                ncStubDestroy(slot->stub);
+                bzero(slot, sizeof(ncPoolStub));
+            }
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+//!
+//! Retrieves the counters aggregated over all endpoints
+//!
+//! @param[out] stats the counters
+//!
+void nc_pool_get_stats(ncPoolStats * stats)
+{
+    if (stats == NULL)
+        return;
+
+    pthread_mutex_lock(&pool_mutex);
+    memcpy(stats, &pool_stats, sizeof(ncPoolStats));
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+//!
+//! Retrieves the counters of one endpoint
+//!
+//! @param[in]  ncURL the NC endpoint URL
+//! @param[out] stats the counters
+//!
+//! @return EUCA_OK on success or EUCA_NOT_FOUND_ERROR if the endpoint is not pooled
+//!
+int nc_pool_get_node_stats(const char *ncURL, ncPoolStats * stats)
+{
+    int ret = EUCA_NOT_FOUND_ERROR;
+    ncPoolEntry *entry = NULL;
+
+    if ((ncURL == NULL) || (stats == NULL))
+        return (EUCA_INVALID_ERROR);
+
+    pthread_mutex_lock(&pool_mutex);
+    if ((entry = nc_pool_find_entry(ncURL, FALSE)) != NULL) {
+        memcpy(stats, &(entry->stats), sizeof(ncPoolStats));
+        ret = EUCA_OK;
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    return (ret);
+}
+
+//!
+//! Logs a one-line summary of pool effectiveness and call latency
+//!
+void nc_pool_log_stats(void)
+{
+    ncPoolStats stats = { 0 };
+    long long acquires = 0;
+
+    nc_pool_get_stats(&stats);
+    acquires = stats.hits + stats.misses;
+    if (acquires == 0)
+        return;
+
+    LOGINFO("nc pool: %04lld calls (%lld failed) hit rate %lld%% (%lld waits) latency avg=%lldms max=%lldms\n",
+            stats.calls, stats.failures, (stats.hits * 100) / acquires, stats.waits, (stats.calls ? (stats.totalMs / stats.calls) : 0), stats.maxMs);
+}
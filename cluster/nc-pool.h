@@ -0,0 +1,96 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+#ifndef _INCLUDE_NC_POOL_H_
+#define _INCLUDE_NC_POOL_H_
+
+//!
+//! @file cluster/nc-pool.h
+//! Process-local pool of long-lived NC client stubs used by the non-forking
+//! ncClientCall() path.
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  INCLUDES                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#include <pthread.h>
+
+#include <eucalyptus.h>
+#include <client-marshal.h>
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  DEFINES                                   |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#define NC_POOL_MAX_NODES                        MAXNODES   //!< Maximum number of distinct NC endpoints in the pool
+#define NC_POOL_STUBS_PER_NODE                         4    //!< Maximum number of concurrent stubs (connections) per NC
+#define NC_POOL_IDLE_TIMEOUT_SEC                     300    //!< Idle stubs older than this are dropped on the next acquire
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                 STRUCTURES                                 |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! Counters kept for the whole pool (and for each NC endpoint)
+typedef struct ncPoolStats_t {
+    long long calls;                   //!< Number of calls completed through pooled stubs
+    long long hits;                    //!< Number of acquires satisfied by an existing stub
+    long long misses;                  //!< Number of acquires that had to create a new stub
+    long long failures;                //!< Number of calls that returned an error (stub is discarded)
+    long long waits;                   //!< Number of acquires that had to wait for a busy stub
+    long long totalMs;                 //!< Sum of call latencies in milliseconds
+    long long maxMs;                   //!< Largest call latency seen in milliseconds
+} ncPoolStats;
+
+//! A single cached stub
+typedef struct ncPoolStub_t {
+    ncStub *stub;                      //!< The Axis2 stub (NULL if the slot is empty)
+    boolean inUse;                     //!< Set while a caller owns the stub
+    boolean stale;                     //!< Set by nc_pool_flush() on stubs in use so they are dropped on release
+    time_t lastUsed;                   //!< When the stub was last released
+} ncPoolStub;
+
+//! Per-NC entry of the pool
+typedef struct ncPoolEntry_t {
+    char ncURL[384];                   //!< Endpoint URL the stubs are bound to
+    ncPoolStub stubs[NC_POOL_STUBS_PER_NODE];   //!< Cached stubs for this endpoint
+    ncPoolStats stats;                 //!< Counters for this endpoint
+} ncPoolEntry;
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                             EXPORTED PROTOTYPES                            |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+int nc_pool_init(void);
+ncStub *nc_pool_acquire(const char *ncURL, int timeout, boolean use_wssec, const char *policyFile);
+void nc_pool_release(ncStub * stub, int rc, long long elapsedMs);
+void nc_pool_flush(void);
+void nc_pool_get_stats(ncPoolStats * stats);
+int nc_pool_get_node_stats(const char *ncURL, ncPoolStats * stats);
+void nc_pool_log_stats(void);
+
+#endif /* ! _INCLUDE_NC_POOL_H_ */
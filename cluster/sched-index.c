@@ -0,0 +1,521 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+//!
+//! @file cluster/sched-index.c
+//! Capacity index over the resource cache used to place a batch of identical
+//! instances in a single pass.
+//!
+//! doRunInstances() used to call the scheduler once per instance and every
+//! call walked the whole resource cache re-checking memory, disk and cores,
+//! so a large RunInstances request cost (instances x nodes) comparisons.
+//! All the instances of one request have the same shape, so
+//! sched_index_build() turns each node's free memory, disk and cores into a
+//! single number: how many more instances of that shape it can take. Nodes
+//! are filed in buckets by that capacity, and sched_index_plan() hands out
+//! the whole batch in one pass that is linear in (instances + nodes):
+//!
+//!   - GREEDY and POWERSAVE fill the awake nodes in index order, then the
+//!     sleeping ones, which is what repeated calls to
+//!     schedule_instance_greedy() do;
+//!   - ROUNDROBIN deals one instance to every node with room, starting at
+//!     the scheduler state, exactly like repeated calls to
+//!     schedule_instance_roundrobin();
+//!   - BESTFIT fills the node with the least room left first (bin packing),
+//!     preferring awake nodes over sleeping ones.
+//!
+//! The plan is computed from a snapshot; the caller re-checks each planned
+//! node before using it and falls back to the per-instance scheduler if the
+//! resource cache has changed in the meantime.
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  INCLUDES                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <eucalyptus.h>
+
+#include "sched-index.h"
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                              STATIC PROTOTYPES                             |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+static int sched_index_capacity(int avail, int need, int capacity);
+static int sched_index_fill(schedIndex * idx, int node, int count, int *plan, int placed);
+static int sched_index_plan_greedy(schedIndex * idx, int count, int *plan);
+static int sched_index_plan_roundrobin(schedIndex * idx, int count, int rrStart, int *plan, int *rrNext);
+static int sched_index_plan_bestfit(schedIndex * idx, int count, int *plan);
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                               IMPLEMENTATION                               |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//!
+//! Narrows a node's capacity by one resource dimension
+//!
+//! @param[in] avail amount of the resource still available on the node
+//! @param[in] need amount of the resource needed by one instance
+//! @param[in] capacity capacity computed from the other dimensions so far
+//!
+//! @return the number of instances the node can take considering this dimension too
+//!
+static int sched_index_capacity(int avail, int need, int capacity)
+{
+    if (avail < 0)
+        return (0);
+    if (need <= 0)
+        return (capacity);
+    return (((avail / need) < capacity) ? (avail / need) : capacity);
+}
+
+//!
+//! Builds the capacity index of a resource cache for one instance shape
+//!
+//! @param[out] idx the index to build
+//! @param[in]  cache the resource cache to index
+//! @param[in]  vm the shape of the instances to place
+//! @param[in]  policy the scheduling policy sched_index_plan() will follow
+//!
+//! @return EUCA_OK on success or EUCA_INVALID_ERROR if any parameter is NULL
+//!
+//! @pre the caller holds whatever lock protects the cache
+//!
+int sched_index_build(schedIndex * idx, ccResourceCache * cache, virtualMachine * vm, int policy)
+{
+    int i = 0;
+    int bucket = 0;
+    ccResource *res = NULL;
+
+    if (!idx || !cache || !vm)
+        return (EUCA_INVALID_ERROR);
+
+    idx->policy = policy;
+    idx->numResources = ((cache->numResources < MAXNODES) ? cache->numResources : MAXNODES);
+    idx->mem = vm->mem;
+    idx->disk = vm->disk;
+    idx->cores = vm->cores;
+    idx->numFree = 0;
+    memset(idx->head, 0xFF, sizeof(idx->head));
+
+    // walk backwards so that every bucket lists its nodes in index order
+    for (i = idx->numResources - 1; i >= 0; i--) {
+        res = &(cache->resources[i]);
+        idx->next[i] = -1;
+
+        if (res->ncState != ENABLED) {
+            idx->nodeClass[i] = SCHED_NODE_INELIGIBLE;
+        } else if ((res->state == RESUP) || (res->state == RESWAKING)) {
+            idx->nodeClass[i] = SCHED_NODE_AWAKE;
+        } else if (res->state == RESASLEEP) {
+            idx->nodeClass[i] = SCHED_NODE_ASLEEP;
+        } else {
+            idx->nodeClass[i] = SCHED_NODE_INELIGIBLE;
+        }
+
+        idx->capacity[i] = sched_index_capacity(res->availMemory, vm->mem, INT_MAX);
+        idx->capacity[i] = sched_index_capacity(res->availDisk, vm->disk, idx->capacity[i]);
+        idx->capacity[i] = sched_index_capacity(res->availCores, vm->cores, idx->capacity[i]);
+        if ((idx->nodeClass[i] == SCHED_NODE_INELIGIBLE) || (idx->capacity[i] <= 0)) {
+            idx->capacity[i] = 0;
+            continue;
+        }
+
+        bucket = ((idx->capacity[i] < (SCHED_INDEX_BUCKETS - 1)) ? idx->capacity[i] : (SCHED_INDEX_BUCKETS - 1));
+        idx->next[i] = idx->head[idx->nodeClass[i]][bucket];
+        idx->head[idx->nodeClass[i]][bucket] = i;
+        idx->numFree = ((idx->numFree > (INT_MAX - idx->capacity[i])) ? INT_MAX : (idx->numFree + idx->capacity[i]));
+    }
+
+    return (EUCA_OK);
+}
+
+//!
+//! Places as many instances as possible on one node
+//!
+//! @param[in]     idx the capacity index
+//! @param[in]     node the node to fill
+//! @param[in]     count the size of the whole batch
+//! @param[in,out] plan the placement being built
+//! @param[in]     placed the number of instances already placed
+//!
+//! @return the number of instances placed once the node is full or the batch is complete
+//!
+static int sched_index_fill(schedIndex * idx, int node, int count, int *plan, int placed)
+{
+    while ((placed < count) && (idx->capacity[node] > 0)) {
+        plan[placed++] = node;
+        idx->capacity[node]--;
+    }
+    return (placed);
+}
+
+//!
+//! GREEDY and POWERSAVE placement: lowest awake node first, then the lowest
+//! sleeping one
+//!
+//! @param[in]  idx the capacity index
+//! @param[in]  count the number of instances to place
+//! @param[out] plan receives the node index of every placed instance
+//!
+//! @return the number of instances placed
+//!
+static int sched_index_plan_greedy(schedIndex * idx, int count, int *plan)
+{
+    int i = 0;
+    int placed = 0;
+    int nodeClass = 0;
+
+    for (nodeClass = SCHED_NODE_AWAKE; (nodeClass <= SCHED_NODE_ASLEEP) && (placed < count); nodeClass++) {
+        for (i = 0; (i < idx->numResources) && (placed < count); i++) {
+            if (idx->nodeClass[i] == nodeClass)
+                placed = sched_index_fill(idx, i, count, plan, placed);
+        }
+    }
+    return (placed);
+}
+
+//!
+//! ROUNDROBIN placement: one instance per node with room, in circular order
+//! starting at rrStart, until the batch is placed or every node is full
+//!
+//! @param[in]  idx the capacity index
+//! @param[in]  count the number of instances to place
+//! @param[in]  rrStart the round-robin scheduler state
+//! @param[out] plan receives the node index of every placed instance
+//! @param[out] rrNext the round-robin scheduler state after the last placed instance
+//!
+//! @return the number of instances placed
+//!
+static int sched_index_plan_roundrobin(schedIndex * idx, int count, int rrStart, int *plan, int *rrNext)
+{
+    int i = 0;
+    int j = 0;
+    int node = 0;
+    int placed = 0;
+    int numLive = 0;
+    int live[MAXNODES] = { 0 };
+
+    if (idx->numResources == 0)
+        return (0);
+    if ((rrStart < 0) || (rrStart >= idx->numResources))
+        rrStart = 0;
+
+    for (i = 0; i < idx->numResources; i++) {
+        node = (rrStart + i) % idx->numResources;
+        if (idx->capacity[node] > 0)
+            live[numLive++] = node;
+    }
+
+    // every pass deals one instance to each node that still has room and drops the full ones
+    while ((placed < count) && (numLive > 0)) {
+        for (i = 0, j = 0; (i < numLive) && (placed < count); i++) {
+            node = live[i];
+            plan[placed++] = node;
+            if (--idx->capacity[node] > 0)
+                live[j++] = node;
+        }
+        numLive = j;
+    }
+
+    if (placed > 0)
+        *rrNext = (plan[placed - 1] + 1) % idx->numResources;
+    return (placed);
+}
+
+//!
+//! BESTFIT placement: the node with the least room left that still fits is
+//! filled first, awake nodes before sleeping ones. Nodes that can take
+//! SCHED_INDEX_BUCKETS - 1 instances or more share a bucket and are filled in
+//! index order.
+//!
+//! @param[in]  idx the capacity index
+//! @param[in]  count the number of instances to place
+//! @param[out] plan receives the node index of every placed instance
+//!
+//! @return the number of instances placed
+//!
+static int sched_index_plan_bestfit(schedIndex * idx, int count, int *plan)
+{
+    int node = 0;
+    int bucket = 0;
+    int placed = 0;
+    int nodeClass = 0;
+
+    for (nodeClass = SCHED_NODE_AWAKE; (nodeClass <= SCHED_NODE_ASLEEP) && (placed < count); nodeClass++) {
+        for (bucket = 1; (bucket < SCHED_INDEX_BUCKETS) && (placed < count); bucket++) {
+            for (node = idx->head[nodeClass][bucket]; (node >= 0) && (placed < count); node = idx->next[node]) {
+                placed = sched_index_fill(idx, node, count, plan, placed);
+            }
+        }
+    }
+    return (placed);
+}
+
+//!
+//! Places up to count instances of the indexed shape following the policy
+//! the index was built for. The capacities in the index are consumed, so a
+//! second call continues where the first one stopped.
+//!
+//! @param[in]  idx the capacity index built by sched_index_build()
+//! @param[in]  count the number of instances to place
+//! @param[in]  rrStart the round-robin scheduler state (ROUNDROBIN only)
+//! @param[out] plan array of at least count entries receiving the node index of every placed instance
+//! @param[out] rrNext optional, the round-robin scheduler state after the last placed instance
+//!
+//! @return the number of instances placed, which is less than count if the
+//!         nodes ran out of room, or -1 if the policy is not supported
+//!
+int sched_index_plan(schedIndex * idx, int count, int rrStart, int *plan, int *rrNext)
+{
+    int dummy = 0;
+
+    if (!idx || !plan || (count < 0))
+        return (-1);
+    if (rrNext == NULL)
+        rrNext = &dummy;
+    *rrNext = rrStart;
+
+    switch (idx->policy) {
+    case SCHEDGREEDY:
+    case SCHEDPOWERSAVE:
+        return (sched_index_plan_greedy(idx, count, plan));
+    case SCHEDROUNDROBIN:
+        return (sched_index_plan_roundrobin(idx, count, rrStart, plan, rrNext));
+    case SCHEDBESTFIT:
+        return (sched_index_plan_bestfit(idx, count, plan));
+    default:
+        break;
+    }
+    return (-1);
+}
+
+#ifdef _UNIT_TEST
+#include <sys/time.h>
+
+//! Instance shapes replayed by the micro-benchmark (mem MB, disk GB, cores)
+static const int test_shapes[][3] = {
+    {512, 5, 1}, {1024, 10, 1}, {2048, 10, 2}, {4096, 20, 4}, {8192, 40, 8},
+};
+
+//!
+//! Returns the current time in microseconds
+//!
+static long long test_now_usec(void)
+{
+    struct timeval tv = { 0 };
+
+    gettimeofday(&tv, NULL);
+    return (((long long)tv.tv_sec) * 1000000LL + tv.tv_usec);
+}
+
+//!
+//! Fills a fake resource cache with nodes of random size and state
+//!
+static void test_fake_cache(ccResourceCache * cache, int numNodes)
+{
+    int i = 0;
+    ccResource *res = NULL;
+
+    bzero(cache, sizeof(ccResourceCache));
+    cache->numResources = numNodes;
+    for (i = 0; i < numNodes; i++) {
+        res = &(cache->resources[i]);
+        snprintf(res->hostname, sizeof(res->hostname), "node%d", i);
+        res->maxCores = 8 << (rand() % 4);
+        res->maxMemory = res->maxCores * 2048;
+        res->maxDisk = res->maxCores * 50;
+        res->availCores = rand() % (res->maxCores + 1);
+        res->availMemory = res->availCores * 2048;
+        res->availDisk = res->availCores * 50;
+        res->ncState = ((rand() % 20) ? ENABLED : STOPPED);
+        switch (rand() % 10) {
+        case 0:
+            res->state = RESDOWN;
+            break;
+        case 1:
+            res->state = RESASLEEP;
+            break;
+        default:
+            res->state = RESUP;
+            break;
+        }
+    }
+}
+
+//!
+//! Reference scheduler: the per-instance linear scan doRunInstances() used to
+//! do, including the BESTFIT rule applied one instance at a time
+//!
+static int test_naive_schedule(ccResourceCache * cache, virtualMachine * vm, int policy, int *rrState)
+{
+    int i = 0;
+    int n = 0;
+    int cap = 0;
+    int best = -1;
+    int bestCap = INT_MAX;
+    int nodeClass = 0;
+    int wanted = 0;
+    ccResource *res = NULL;
+
+    if (policy == SCHEDROUNDROBIN) {
+        for (n = 0; n < cache->numResources; n++) {
+            i = (*rrState + n) % cache->numResources;
+            res = &(cache->resources[i]);
+            if ((res->state != RESDOWN) && (res->ncState == ENABLED) && ((res->availMemory - vm->mem) >= 0) && ((res->availDisk - vm->disk) >= 0)
+                && ((res->availCores - vm->cores) >= 0)) {
+                *rrState = (i + 1) % cache->numResources;
+                return (i);
+            }
+        }
+        return (-1);
+    }
+
+    for (wanted = SCHED_NODE_AWAKE; wanted <= SCHED_NODE_ASLEEP; wanted++) {
+        for (i = 0; i < cache->numResources; i++) {
+            res = &(cache->resources[i]);
+            nodeClass = (res->ncState != ENABLED) ? SCHED_NODE_INELIGIBLE : ((res->state == RESUP) || (res->state == RESWAKING)) ? SCHED_NODE_AWAKE :
+                (res->state == RESASLEEP) ? SCHED_NODE_ASLEEP : SCHED_NODE_INELIGIBLE;
+            if ((nodeClass != wanted) || ((res->availMemory - vm->mem) < 0) || ((res->availDisk - vm->disk) < 0) || ((res->availCores - vm->cores) < 0))
+                continue;
+            if (policy != SCHEDBESTFIT)
+                return (i);
+
+            cap = sched_index_capacity(res->availMemory, vm->mem, INT_MAX);
+            cap = sched_index_capacity(res->availDisk, vm->disk, cap);
+            cap = sched_index_capacity(res->availCores, vm->cores, cap);
+            if (cap < bestCap) {
+                best = i;
+                bestCap = cap;
+            }
+        }
+        if (best >= 0)
+            return (best);
+    }
+    return (-1);
+}
+
+//!
+//! Replays synthetic launch bursts against a fake resource cache, checks that
+//! the batch placement matches the per-instance reference scheduler and
+//! reports how long each one took.
+//!
+//! usage: test_sched_index [nodes] [burst size] [bursts]
+//!
+int main(int argc, char **argv)
+{
+    int i = 0;
+    int k = 0;
+    int p = 0;
+    int node = 0;
+    int placed = 0;
+    int numNaive = 0;
+    int rrState = 0;
+    int rrNext = 0;
+    int failures = 0;
+    int numNodes = ((argc > 1) ? atoi(argv[1]) : MAXNODES);
+    int burst = ((argc > 2) ? atoi(argv[2]) : 1000);
+    int bursts = ((argc > 3) ? atoi(argv[3]) : 50);
+    int *plan = NULL;
+    int *naive = NULL;
+    long long naiveUsec = 0;
+    long long indexUsec = 0;
+    long long start = 0;
+    const int policies[] = { SCHEDGREEDY, SCHEDROUNDROBIN, SCHEDPOWERSAVE, SCHEDBESTFIT };
+    const char *names[] = { "GREEDY", "ROUNDROBIN", "POWERSAVE", "BESTFIT" };
+    virtualMachine vm = { 0 };
+    schedIndex *idx = NULL;
+    ccResourceCache *cache = NULL;
+    ccResourceCache *work = NULL;
+
+    numNodes = ((numNodes < 1) ? 1 : ((numNodes > MAXNODES) ? MAXNODES : numNodes));
+    burst = ((burst < 1) ? 1 : burst);
+    bursts = ((bursts < 1) ? 1 : bursts);
+
+    idx = calloc(1, sizeof(schedIndex));
+    cache = calloc(1, sizeof(ccResourceCache));
+    work = calloc(1, sizeof(ccResourceCache));
+    plan = calloc(burst, sizeof(int));
+    naive = calloc(burst, sizeof(int));
+    if (!idx || !cache || !work || !plan || !naive) {
+        fprintf(stderr, "out of memory\n");
+        return (1);
+    }
+
+    srand(42);
+    printf("%d nodes, %d bursts of %d instances\n", numNodes, bursts, burst);
+    for (p = 0; p < (int)(sizeof(policies) / sizeof(policies[0])); p++) {
+        naiveUsec = indexUsec = 0;
+        for (k = 0; k < bursts; k++) {
+            test_fake_cache(cache, numNodes);
+            vm.mem = test_shapes[k % 5][0];
+            vm.disk = test_shapes[k % 5][1];
+            vm.cores = test_shapes[k % 5][2];
+            rrState = rand() % numNodes;
+
+            // one scan per instance
+            memcpy(work, cache, sizeof(ccResourceCache));
+            rrNext = rrState;
+            start = test_now_usec();
+            for (numNaive = 0; numNaive < burst; numNaive++) {
+                if ((node = test_naive_schedule(work, &vm, policies[p], &rrNext)) < 0)
+                    break;
+                naive[numNaive] = node;
+                work->resources[node].availMemory -= vm.mem;
+                work->resources[node].availDisk -= vm.disk;
+                work->resources[node].availCores -= vm.cores;
+            }
+            naiveUsec += test_now_usec() - start;
+
+            // one pass for the whole burst
+            start = test_now_usec();
+            sched_index_build(idx, cache, &vm, policies[p]);
+            placed = sched_index_plan(idx, burst, rrState, plan, NULL);
+            indexUsec += test_now_usec() - start;
+
+            if ((placed != numNaive) || memcmp(plan, naive, placed * sizeof(int))) {
+                for (i = 0; (i < placed) && (i < numNaive) && (plan[i] == naive[i]); i++) ;
+                printf("  %s burst %d: placement differs at instance %d (index placed %d, reference placed %d)\n", names[p], k, i, placed, numNaive);
+                failures++;
+            }
+        }
+        printf("%-10s per-instance scan: %8lld usec  batch index: %8lld usec\n", names[p], naiveUsec, indexUsec);
+    }
+
+    free(naive);
+    free(plan);
+    free(work);
+    free(cache);
+    free(idx);
+
+    printf("%s\n", ((failures) ? "FAILED" : "OK"));
+    return ((failures) ? 1 : 0);
+}
+#endif /* _UNIT_TEST */
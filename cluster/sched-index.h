@@ -0,0 +1,91 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+#ifndef _INCLUDE_SCHED_INDEX_H_
+#define _INCLUDE_SCHED_INDEX_H_
+
+//!
+//! @file cluster/sched-index.h
+//! Capacity index over the resource cache used to place a batch of identical
+//! instances in a single pass.
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  INCLUDES                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#include <eucalyptus.h>
+#include <data.h>
+
+#include "handlers.h"
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  DEFINES                                   |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#define SCHED_INDEX_BUCKETS                          256    //!< Capacity buckets; the last one holds every node that can take at least that many instances
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                ENUMERATIONS                                |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! How a node is considered by the scheduler
+enum {
+    SCHED_NODE_INELIGIBLE,             //!< Down or not enabled
+    SCHED_NODE_AWAKE,                  //!< Up or waking up
+    SCHED_NODE_ASLEEP,                 //!< Asleep, must be powered up before use
+    SCHED_NODE_LAST,
+};
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                 STRUCTURES                                 |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! Snapshot of how many instances of one shape every node can still take
+typedef struct schedIndex_t {
+    int policy;                        //!< Scheduling policy (SCHEDGREEDY, SCHEDROUNDROBIN, ...) used by sched_index_plan()
+    int numResources;                  //!< Number of nodes in the snapshot
+    int mem;                           //!< Memory of the instance shape
+    int disk;                          //!< Disk of the instance shape
+    int cores;                         //!< Cores of the instance shape
+    int numFree;                       //!< Total number of instances of that shape the eligible nodes can take
+    int nodeClass[MAXNODES];           //!< SCHED_NODE_* class of each node
+    int capacity[MAXNODES];            //!< Number of instances of that shape each node can take
+    int head[SCHED_NODE_LAST][SCHED_INDEX_BUCKETS]; //!< First node of each capacity bucket, per node class (-1 if empty)
+    int next[MAXNODES];                //!< Next node in the same bucket (-1 terminates)
+} schedIndex;
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                             EXPORTED PROTOTYPES                            |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+int sched_index_build(schedIndex * idx, ccResourceCache * cache, virtualMachine * vm, int policy);
+int sched_index_plan(schedIndex * idx, int count, int rrStart, int *plan, int *rrNext);
+
+#endif /* ! _INCLUDE_SCHED_INDEX_H_ */
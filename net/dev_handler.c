@@ -64,7 +64,10 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <ifaddrs.h>
+#include <sys/socket.h>
 #include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 
 #include <eucalyptus.h>
 #include <misc.h>
@@ -87,6 +90,16 @@
 #define BRCTL_PATH                               "/usr/sbin/brctl"
 #define VCONFIG_PATH                             "/sbin/vconfig"
 
+#define DEV_NL_BUFFER_SIZE                       32768  //!< Receive buffer for rtnetlink replies and events, larger than any dump message
+#define DEV_NL_EVENT_RCVBUF                      (1 << 20)  //!< Socket buffer of the event subscription, so bursts of events do not overflow it
+
+//! @{
+//! @name IFLA_BR_* bridge attributes of linux/if_link.h, spelled out for kernel headers that predate them
+#define DEV_NL_BR_FORWARD_DELAY                  1
+#define DEV_NL_BR_HELLO_TIME                     2
+#define DEV_NL_BR_STP_STATE                      5
+//! @}
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                  TYPEDEFS                                  |
@@ -105,6 +118,16 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+//! rtnetlink request on a link or an address, with room for its attributes
+typedef struct dev_nl_request_t {
+    struct nlmsghdr hdr;               //!< Netlink header
+    union {
+        struct ifinfomsg link;         //!< Payload of RTM_*LINK requests
+        struct ifaddrmsg addr;         //!< Payload of RTM_*ADDR requests
+    };
+    char attrs[512];                   //!< Room for the attributes, way more than our requests need
+} dev_nl_request;
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                             EXTERNAL VARIABLES                             |
@@ -150,6 +173,28 @@ static inline void dev_free_list(dev_entry **pList, int nbItems);
 static inline void dev_free_ips(in_addr_entry **pList);
 static inline void dev_in_addr_entry(in_addr_entry *pEntry, const char *psDeviceName, in_addr_t address, in_addr_t netmask);
 
+//! @{
+//! @name rtnetlink helpers
+static void dev_nl_request_init(dev_nl_request *pReq, u16 type, u16 flags, size_t payloadLen);
+static struct rtattr *dev_nl_add_attr(dev_nl_request *pReq, int type, const void *pData, int len);
+static void dev_nl_end_nest(dev_nl_request *pReq, struct rtattr *pNest);
+static int dev_nl_open(u32 groups);
+static int dev_nl_talk(dev_handler *devh, dev_nl_request *pReq);
+static int dev_nl_dump(dev_handler *devh, u16 type, u8 family);
+static int dev_nl_process_events(dev_handler *devh);
+static void dev_nl_apply(dev_handler *devh, struct nlmsghdr *pHdr);
+static void dev_nl_apply_link(dev_handler *devh, struct nlmsghdr *pHdr);
+static void dev_nl_apply_addr(dev_handler *devh, struct nlmsghdr *pHdr);
+static int dev_nl_set_link(dev_handler *devh, const char *psDeviceName, u32 flags, u32 change, const char *psNewDevName, int masterIndex);
+static int dev_nl_new_link(dev_handler *devh, const char *psDeviceName, const char *psKind, const char *psParentName, int vlan);
+static int dev_nl_del_link(dev_handler *devh, const char *psDeviceName);
+static int dev_nl_addr(dev_handler *devh, u16 type, const char *psDeviceName, in_addr_t address, in_addr_t netmask, in_addr_t broadcast, const char *psScope);
+static inline boolean dev_nl_fallback(int rc);
+static boolean dev_name_matches(const char *cpsSearch, const char *psDeviceName);
+static boolean dev_type_matches(dev_type deviceType, const char *psDeviceName, boolean isBridge);
+static int dev_nl_set_bridge_attr(dev_handler *devh, const char *psBridgeName, u16 attr, u32 value);
+//! @}
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                   MACROS                                   |
@@ -194,6 +239,8 @@ int dev_handler_init(dev_handler *devh, const char *cmdprefix) {
     } else {
         devh->cmdprefix[0] = '\0';
     }
+    devh->nlFd = -1;
+    devh->nlEventFd = -1;
     
     devh->init = 1;
     return (0);
@@ -216,6 +263,12 @@ int dev_handler_free(dev_handler *devh) {
     devh->numberOfNetworks = 0;
     EUCA_FREE(devh->pDevices);
     EUCA_FREE(devh->pNetworks);
+    if (devh->nlFd >= 0) {
+        close(devh->nlFd);
+    }
+    if (devh->nlEventFd >= 0) {
+        close(devh->nlEventFd);
+    }
 
     return (dev_handler_init(devh, saved_cmdprefix));
 }
@@ -232,17 +285,27 @@ int dev_handler_close(dev_handler *devh) {
     }
     EUCA_FREE(devh->pDevices);
     EUCA_FREE(devh->pNetworks);
+    if (devh->nlFd >= 0) {
+        close(devh->nlFd);
+    }
+    if (devh->nlEventFd >= 0) {
+        close(devh->nlEventFd);
+    }
     memset(devh, 0, sizeof (dev_handler));
     return (0);
 }
 
 /**
- * Retrieves the current device state from the system.
+ * Retrieves the current device state from the system. The first call dumps the devices
+ * and IPv4 addresses over rtnetlink and subscribes to link and address events. Following
+ * calls only apply the events received since, unless events were lost, in which case the
+ * devices are dumped again.
  * @param devh [in] pointer to device handler
  * @return 0 on success. 1 on failure.
  */
 int dev_handler_repopulate(dev_handler *devh) {
     int rc = 0;
+    int nbEvents = 0;
     struct timeval tv = { 0 };
 
     eucanetd_timer_usec(&tv);
@@ -250,24 +313,42 @@ int dev_handler_repopulate(dev_handler *devh) {
         return (1);
     }
 
-    rc = dev_handler_free(devh);
-    if (rc) {
-        LOGERROR("could not reinitialize dev handler.\n");
-        return (1);
+    if (devh->populated) {
+        if ((nbEvents = dev_nl_process_events(devh)) >= 0) {
+            LOGDEBUG("devices updated from %d event(s) in %.2f ms.\n", nbEvents, eucanetd_timer_usec(&tv) / 1000.0);
+            return (0);
+        }
+        LOGWARN("lost network device events, rescanning devices\n");
     }
-    // Retrieve our system network device information
-    if ((rc = dev_get_list(devh, NULL, &devh->pDevices, &devh->numberOfDevices)) != 0) {
-        LOGERROR("Cannot retrieve system network device information.\n");
-        dev_handler_free(devh);
-        return (1);
+    devh->populated = FALSE;
+    devh->numberOfDevices = 0;
+    devh->numberOfNetworks = 0;
+    EUCA_FREE(devh->pDevices);
+    EUCA_FREE(devh->pNetworks);
+
+    // Subscribe before the dump: events about changes the dump already shows are harmless when applied after it
+    if (devh->nlEventFd < 0) {
+        if ((devh->nlEventFd = dev_nl_open(RTMGRP_LINK | RTMGRP_IPV4_IFADDR)) < 0) {
+            LOGWARN("cannot subscribe to network device events: %s. Devices will be rescanned on every update.\n", strerror(errno));
+        } else {
+            int rcvbuf = DEV_NL_EVENT_RCVBUF;
+            setsockopt(devh->nlEventFd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        }
     }
+
     // Retrieve our system network device information
-    if ((rc = dev_get_ips(NULL, &devh->pNetworks, &devh->numberOfNetworks)) != 0) {
-        LOGERROR("Cannot retrieve system network information.\n");
-        dev_handler_free(devh);
+    if (((rc = dev_nl_dump(devh, RTM_GETLINK, AF_UNSPEC)) != 0) || ((rc = dev_nl_dump(devh, RTM_GETADDR, AF_INET)) != 0)) {
+        LOGERROR("Cannot retrieve system network device information: %s\n", strerror(rc));
+        devh->numberOfDevices = 0;
+        devh->numberOfNetworks = 0;
+        EUCA_FREE(devh->pDevices);
+        EUCA_FREE(devh->pNetworks);
         return (1);
     }
 
+    if ((devh->nlEventFd >= 0) && (dev_nl_process_events(devh) >= 0)) {
+        devh->populated = TRUE;
+    }
     LOGDEBUG("devices populated in %.2f ms.\n", eucanetd_timer_usec(&tv) / 1000.0);
     return (0);
 }
@@ -287,7 +368,7 @@ int dev_handler_repopulate(dev_handler *devh) {
  *
  * @return 0 on success or 1 on failure
  *
- * @see dev_free_list()
+ * @see dev_free_list(), dev_handler_repopulate()
  *
  * @pre
  *     Both ppsDevNames and pNumberOfDevices MUST not be NULL.
@@ -299,7 +380,8 @@ int dev_handler_repopulate(dev_handler *devh) {
  *
  * @note
  *     Caller is responsible to free the dynamically allocated list of device name entries
- *     using the dev_free_list() API.
+ *     using the dev_free_list() API. Once the device handler was populated, the list is
+ *     served from its cache, which is first brought up to date with the pending events.
  */
 int dev_get(dev_handler *devh, const char *cpsSearch, dev_entry **pDevices, int *pNbDevices, dev_type deviceType) {
     int i = 0;
@@ -316,6 +398,24 @@ int dev_get(dev_handler *devh, const char *cpsSearch, dev_entry **pDevices, int
     (*pDevices) = NULL;
     (*pNbDevices) = 0;
 
+    if (devh && devh->populated && (dev_nl_process_events(devh) >= 0)) {
+        for (i = 0; i < devh->numberOfDevices; i++) {
+            if (!dev_name_matches(cpsSearch, devh->pDevices[i].sDevName) || !dev_type_matches(deviceType, devh->pDevices[i].sDevName, devh->pDevices[i].isBridge))
+                continue;
+
+            if ((pPtr = EUCA_REALLOC((*pDevices), ((*pNbDevices) + 1), sizeof(dev_entry))) == NULL) {
+                LOGERROR("Memory allocation failure.\n");
+                dev_free_list(pDevices, (*pNbDevices));
+                (*pNbDevices) = 0;
+                return (1);
+            }
+            (*pDevices) = pPtr;
+            (*pDevices)[(*pNbDevices)] = devh->pDevices[i];
+            (*pNbDevices)++;
+        }
+        return (0);
+    }
+
     // get the list of network devices
     if (getifaddrs(&pIfAddr) == -1) {
         LOGERROR("Failed to retrieve the list of network devices.\n");
@@ -332,20 +432,8 @@ int dev_get(dev_handler *devh, const char *cpsSearch, dev_entry **pDevices, int
             continue;
 
         // Check if we need to filter this name
-        if ((cpsSearch != NULL) && strcmp(cpsSearch, "*")) {
-            // Is this an exact match?
-            if (cpsSearch[strlen(cpsSearch) - 1] == '*') {
-                // if the name does not start with the search name then skip
-                if (strncmp(pIfa->ifa_name, cpsSearch, (strlen(cpsSearch) - 1))) {
-                    continue;
-                }
-            } else {
-                // if the name does not match the search name then skip
-                if (strcmp(pIfa->ifa_name, cpsSearch)) {
-                    continue;
-                }
-            }
-        }
+        if (!dev_name_matches(cpsSearch, pIfa->ifa_name))
+            continue;
         // Check if we already have this name in the list
         for (i = 0, found = FALSE; ((i < (*pNbDevices)) && !found); i++) {
             if (!strcmp((*pDevices)[i].sDevName, pIfa->ifa_name)) {
@@ -358,21 +446,8 @@ int dev_get(dev_handler *devh, const char *cpsSearch, dev_entry **pDevices, int
             continue;
 
         // Do we have to filter on type?
-        if (deviceType != DEV_TYPE_ANY) {
-            if (deviceType == DEV_TYPE_BRIDGE) {
-                // Skip if this is not a bridge device
-                if (!dev_is_bridge(pIfa->ifa_name))
-                    continue;
-            } else if (deviceType == DEV_TYPE_TUNNEL) {
-                // Skip if this is not a tunnel device
-                if (!dev_is_tunnel(pIfa->ifa_name))
-                    continue;
-            } else if (deviceType == DEV_TYPE_INTERFACE) {
-                // Skip if we are a bridge or a tunnel device
-                if (dev_is_bridge(pIfa->ifa_name) || dev_is_tunnel(pIfa->ifa_name))
-                    continue;
-            }
-        }
+        if ((deviceType != DEV_TYPE_ANY) && !dev_type_matches(deviceType, pIfa->ifa_name, dev_is_bridge(pIfa->ifa_name)))
+            continue;
         // Alright, new one, allocate some memory
         if ((pPtr = EUCA_REALLOC((*pDevices), ((*pNbDevices) + 1), sizeof(dev_entry))) == NULL) {
             LOGERROR("Memory allocation failure.\n");
@@ -395,6 +470,47 @@ int dev_get(dev_handler *devh, const char *cpsSearch, dev_entry **pDevices, int
     return (0);
 }
 
+/**
+ * Checks whether a device name matches a dev_get() search filter.
+ *
+ * @param cpsSearch [in] the filter: NULL or "*" for any device, a prefix followed by "*", or a device name
+ * @param psDeviceName [in] the device name to check
+ *
+ * @return TRUE if the name matches the filter otherwise FALSE is returned
+ */
+static boolean dev_name_matches(const char *cpsSearch, const char *psDeviceName) {
+    if ((cpsSearch == NULL) || !strcmp(cpsSearch, "*"))
+        return (TRUE);
+
+    // Is this a prefix match?
+    if (cpsSearch[strlen(cpsSearch) - 1] == '*')
+        return (strncmp(psDeviceName, cpsSearch, (strlen(cpsSearch) - 1)) ? FALSE : TRUE);
+    return (strcmp(psDeviceName, cpsSearch) ? FALSE : TRUE);
+}
+
+/**
+ * Checks whether a device is of a given type.
+ *
+ * @param deviceType [in] the device type to filter on
+ * @param psDeviceName [in] the device name
+ * @param isBridge [in] set if the device is a bridge device
+ *
+ * @return TRUE if the device is of the given type otherwise FALSE is returned
+ */
+static boolean dev_type_matches(dev_type deviceType, const char *psDeviceName, boolean isBridge) {
+    switch (deviceType) {
+    case DEV_TYPE_BRIDGE:
+        return (isBridge);
+    case DEV_TYPE_TUNNEL:
+        return (dev_is_tunnel(psDeviceName));
+    case DEV_TYPE_INTERFACE:
+        // Skip if we are a bridge or a tunnel device
+        return ((isBridge || dev_is_tunnel(psDeviceName)) ? FALSE : TRUE);
+    default:
+        return (TRUE);
+    }
+}
+
 /**
  * Checks whether or not a device exists.
  *
@@ -508,6 +624,12 @@ int dev_up(dev_handler *devh, const char *psDeviceName) {
         return (1);
     }
     // enable the device
+    if ((rc = dev_nl_set_link(devh, psDeviceName, IFF_UP, IFF_UP, NULL, -1)) == 0) {
+        return (0);
+    } else if (!dev_nl_fallback(rc)) {
+        LOGERROR("Fail to enable device '%s': %s\n", psDeviceName, strerror(rc));
+        return (1);
+    }
     if (euca_execlp(&rc, devh->cmdprefix, "ip", "link", "set", "dev", psDeviceName, "up", NULL) != EUCA_OK) {
         LOGERROR("Fail to enable device '%s'. error=%d\n", psDeviceName, rc);
         return (1);
@@ -544,6 +666,12 @@ int dev_down(dev_handler *devh, const char *psDeviceName) {
         return (1);
     }
     // disable the device
+    if ((rc = dev_nl_set_link(devh, psDeviceName, 0, IFF_UP, NULL, -1)) == 0) {
+        return (0);
+    } else if (!dev_nl_fallback(rc)) {
+        LOGERROR("Fail to disable device '%s': %s\n", psDeviceName, strerror(rc));
+        return (1);
+    }
     if (euca_execlp(&rc, devh->cmdprefix, "ip", "link", "set", "dev", psDeviceName, "down", NULL) != EUCA_OK) {
         LOGERROR("Fail to enable device '%s'. error=%d\n", psDeviceName, rc);
         return (1);
@@ -607,10 +735,16 @@ int dev_rename(dev_handler *devh, const char *psDeviceName, const char *psNewDev
         LOGERROR("Fail to rename network device '%s' to '%s'. Fail to disable '%s'!\n", psDeviceName, psNewDevName, psDeviceName);
         return (1);
     }
-    // disable the device
-    if (euca_execlp(&rc, devh->cmdprefix, "ip", "link", "set", "dev", psDeviceName, "name", psNewDevName, NULL) != EUCA_OK) {
-        LOGERROR("Fail to rename network device '%s' to '%s'. error=%d\n", psDeviceName, psNewDevName, rc);
-        return (1);
+    // rename the device
+    if ((rc = dev_nl_set_link(devh, psDeviceName, 0, 0, psNewDevName, -1)) != 0) {
+        if (!dev_nl_fallback(rc)) {
+            LOGERROR("Fail to rename network device '%s' to '%s': %s\n", psDeviceName, psNewDevName, strerror(rc));
+            return (1);
+        }
+        if (euca_execlp(&rc, devh->cmdprefix, "ip", "link", "set", "dev", psDeviceName, "name", psNewDevName, NULL) != EUCA_OK) {
+            LOGERROR("Fail to rename network device '%s' to '%s'. error=%d\n", psDeviceName, psNewDevName, rc);
+            return (1);
+        }
     }
     // Enable the device using the new name and just WARN on error
     if (dev_up(devh, psNewDevName) != 0) {
@@ -765,9 +899,15 @@ dev_entry *dev_create_vlan(dev_handler *devh, const char *psDeviceName, u16 vlan
     }
     // Execute the request
     snprintf(sVlan, 8, "%u", vlan);
-    if (euca_execlp(&rc, devh->cmdprefix, VCONFIG_PATH, "add", psDeviceName, sVlan, NULL) != EUCA_OK) {
-        LOGERROR("Fail to add VLAN '%s' to device '%s'. error=%d\n", sVlan, psDeviceName, rc);
-        return (NULL);
+    if ((rc = dev_nl_new_link(devh, dev_get_vlan_name(psDeviceName, vlan), "vlan", psDeviceName, vlan)) != 0) {
+        if (!dev_nl_fallback(rc)) {
+            LOGERROR("Fail to add VLAN '%s' to device '%s': %s\n", sVlan, psDeviceName, strerror(rc));
+            return (NULL);
+        }
+        if (euca_execlp(&rc, devh->cmdprefix, VCONFIG_PATH, "add", psDeviceName, sVlan, NULL) != EUCA_OK) {
+            LOGERROR("Fail to add VLAN '%s' to device '%s'. error=%d\n", sVlan, psDeviceName, rc);
+            return (NULL);
+        }
     }
     // If the device exist then success
     if (!dev_has_vlan(psDeviceName, vlan))
@@ -844,9 +984,15 @@ int dev_remove_vlan_interface(dev_handler *devh, const char *psVlanInterfaceName
         return (0);
 
     // Execute the request
-    if (euca_execlp(&rc, devh->cmdprefix, VCONFIG_PATH, "rem", psVlanInterfaceName, NULL) != EUCA_OK) {
-        LOGERROR("Fail to remove vlan interface '%s'. error=%d\n", psVlanInterfaceName, rc);
-        return (1);
+    if ((rc = dev_nl_del_link(devh, psVlanInterfaceName)) != 0) {
+        if (!dev_nl_fallback(rc)) {
+            LOGERROR("Fail to remove vlan interface '%s': %s\n", psVlanInterfaceName, strerror(rc));
+            return (1);
+        }
+        if (euca_execlp(&rc, devh->cmdprefix, VCONFIG_PATH, "rem", psVlanInterfaceName, NULL) != EUCA_OK) {
+            LOGERROR("Fail to remove vlan interface '%s'. error=%d\n", psVlanInterfaceName, rc);
+            return (1);
+        }
     }
     // If the device does not exist then success
     if (dev_exist(psVlanInterfaceName))
@@ -1162,6 +1308,12 @@ int dev_set_bridge_stp(dev_handler *devh, const char *psBridgeName, const char *
         return (1);
 
     // Set the STP state
+    if ((rc = dev_nl_set_bridge_attr(devh, psBridgeName, DEV_NL_BR_STP_STATE, (strcmp(psStpState, BRIDGE_STP_ON) ? 0 : 1))) == 0) {
+        return (0);
+    } else if (!dev_nl_fallback(rc)) {
+        LOGERROR("Fail to set STP to '%s' on bridge device '%s': %s\n", psStpState, psBridgeName, strerror(rc));
+        return (1);
+    }
     if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "stp", psBridgeName, psStpState, NULL) != EUCA_OK) {
         LOGERROR("Fail to set STP to '%s' on bridge device '%s'. error=%d\n", psStpState, psBridgeName, rc);
         return (1);
@@ -1220,28 +1372,41 @@ dev_entry *dev_create_bridge(dev_handler *devh, const char *psBridgeName, const
         return (pBridge);
     }
     // Create the bridge device
-    if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "addbr", psBridgeName, NULL) != EUCA_OK) {
-        LOGERROR("Fail to create bridge device '%s'. error=%d\n", psBridgeName, rc);
+    if ((rc = dev_nl_new_link(devh, psBridgeName, "bridge", NULL, -1)) != 0) {
+        if (!dev_nl_fallback(rc)) {
+            LOGERROR("Fail to create bridge device '%s': %s\n", psBridgeName, strerror(rc));
+        } else if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "addbr", psBridgeName, NULL) != EUCA_OK) {
+            LOGERROR("Fail to create bridge device '%s'. error=%d\n", psBridgeName, rc);
+        }
     }
     // Did it work?
     if (!dev_exist(psBridgeName))
         return (NULL);
 
     // Set the STP state
-    if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "stp", psBridgeName, psStpState, NULL) != EUCA_OK) {
-        LOGERROR("Fail to set STP state '%s' on bridge device '%s'. error=%d\n", psStpState, psBridgeName, rc);
+    if (dev_set_bridge_stp(devh, psBridgeName, psStpState) != 0) {
+        LOGERROR("Fail to set STP state '%s' on bridge device '%s'.\n", psStpState, psBridgeName);
     }
-    // Set the forwarding delay
-    if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "setfd", psBridgeName, "2", NULL) != EUCA_OK) {
+    // Set the forwarding delay (2 seconds, in hundredths of a second)
+    if (((rc = dev_nl_set_bridge_attr(devh, psBridgeName, DEV_NL_BR_FORWARD_DELAY, 200)) != 0) && dev_nl_fallback(rc)
+        && (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "setfd", psBridgeName, "2", NULL) != EUCA_OK)) {
         LOGERROR("Fail to set forwarding delay on bridge device '%s'. error=%d\n", psBridgeName, rc);
+    } else if (rc && !dev_nl_fallback(rc)) {
+        LOGERROR("Fail to set forwarding delay on bridge device '%s': %s\n", psBridgeName, strerror(rc));
     }
-    // Set the hello time
-    if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "sethello", psBridgeName, "2", NULL) != EUCA_OK) {
+    // Set the hello time (2 seconds, in hundredths of a second)
+    if (((rc = dev_nl_set_bridge_attr(devh, psBridgeName, DEV_NL_BR_HELLO_TIME, 200)) != 0) && dev_nl_fallback(rc)
+        && (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "sethello", psBridgeName, "2", NULL) != EUCA_OK)) {
         LOGERROR("Fail to set hello time on bridge device '%s'. error=%d\n", psBridgeName, rc);
+    } else if (rc && !dev_nl_fallback(rc)) {
+        LOGERROR("Fail to set hello time on bridge device '%s': %s\n", psBridgeName, strerror(rc));
     }
     // RHEL7/CentOS7 - set bridge interface in promiscuous mode
-    if (euca_execlp(&rc, devh->cmdprefix, "ip", "link", "set", "dev", psBridgeName, "promisc", "on", NULL) != EUCA_OK) {
+    if (((rc = dev_nl_set_link(devh, psBridgeName, IFF_PROMISC, IFF_PROMISC, NULL, -1)) != 0) && dev_nl_fallback(rc)
+        && (euca_execlp(&rc, devh->cmdprefix, "ip", "link", "set", "dev", psBridgeName, "promisc", "on", NULL) != EUCA_OK)) {
         LOGERROR("Fail to set bridge device '%s' in promisc. error=%d\n", psBridgeName, rc);
+    } else if (rc && !dev_nl_fallback(rc)) {
+        LOGERROR("Fail to set bridge device '%s' in promisc: %s\n", psBridgeName, strerror(rc));
     }
     // This must work since we know the device exists
     dev_get_bridges(devh, psBridgeName, &pBridge, &nbBridges);
@@ -1401,9 +1566,13 @@ int dev_remove_bridge(dev_handler *devh, const char *psBridgeName, boolean force
         return (1);
 
     // Remove the bridge device
-    if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "delbr", psBridgeName, NULL) != EUCA_OK) {
+    if ((rc = dev_nl_del_link(devh, psBridgeName)) != 0) {
         // Lets follow through in case we can do something else
-        LOGERROR("Fail to delete bridge device '%s'. error=%d\n", psBridgeName, rc);
+        if (!dev_nl_fallback(rc)) {
+            LOGERROR("Fail to delete bridge device '%s': %s\n", psBridgeName, strerror(rc));
+        } else if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "delbr", psBridgeName, NULL) != EUCA_OK) {
+            LOGERROR("Fail to delete bridge device '%s'. error=%d\n", psBridgeName, rc);
+        }
     }
     // Did it work?
     if (dev_exist(psBridgeName)) {
@@ -1466,8 +1635,12 @@ int dev_bridge_assign_interface(dev_handler *devh, const char *psBridgeName, con
         }
     }
     // Add the network device to the bridge
-    if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "addif", psBridgeName, psDeviceName, NULL) != EUCA_OK) {
-        LOGERROR("Fail to add interface '%s' to bridge device '%s'. error=%d\n", psDeviceName, psBridgeName, rc);
+    if ((rc = dev_nl_set_link(devh, psDeviceName, 0, 0, NULL, if_nametoindex(psBridgeName))) != 0) {
+        if (!dev_nl_fallback(rc)) {
+            LOGERROR("Fail to add interface '%s' to bridge device '%s': %s\n", psDeviceName, psBridgeName, strerror(rc));
+        } else if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "addif", psBridgeName, psDeviceName, NULL) != EUCA_OK) {
+            LOGERROR("Fail to add interface '%s' to bridge device '%s'. error=%d\n", psDeviceName, psBridgeName, rc);
+        }
     }
     // Did it work?
     if (!dev_is_bridge_interface(psDeviceName, psBridgeName))
@@ -1528,8 +1701,12 @@ int dev_bridge_delete_interface(dev_handler *devh, const char *psBridgeName, con
     }
 
     // Remove the network device from the bridge
-    if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "delif", psBridgeName, psDeviceName, NULL) != EUCA_OK) {
-        LOGERROR("Fail to remove interface '%s' from bridge device '%s'. error=%d\n", psDeviceName, psBridgeName, rc);
+    if ((rc = dev_nl_set_link(devh, psDeviceName, 0, 0, NULL, 0)) != 0) {
+        if (!dev_nl_fallback(rc)) {
+            LOGERROR("Fail to remove interface '%s' from bridge device '%s': %s\n", psDeviceName, psBridgeName, strerror(rc));
+        } else if (euca_execlp(&rc, devh->cmdprefix, BRCTL_PATH, "delif", psBridgeName, psDeviceName, NULL) != EUCA_OK) {
+            LOGERROR("Fail to remove interface '%s' from bridge device '%s'. error=%d\n", psDeviceName, psBridgeName, rc);
+        }
     }
     // Did it work?
     if (dev_is_bridge_interface(psDeviceName, psBridgeName))
@@ -1830,7 +2007,11 @@ boolean dev_has_host(const char *psDeviceName, in_addr_t ip, in_addr_t netmask)
  *     The device is stripped of all its IP configuration
  */
 int dev_flush_ips(dev_handler *devh, const char *psDeviceName) {
+    int i = 0;
     int rc = 0;
+    int len = 0;
+    int nbIps = 0;
+    in_addr_entry *pIps = NULL;
 
     if (!devh) {
         LOGWARN("Invalid argument: null device handler\n");
@@ -1840,7 +2021,22 @@ int dev_flush_ips(dev_handler *devh, const char *psDeviceName) {
     if (!dev_exist(psDeviceName)) {
         return (1);
     }
-    // Ok, we're good. Now lets flush the IP addresses
+    // Ok, we're good. Now lets flush the IP addresses, including the ones with a "[device]:[label]" label
+    if (dev_get_ips(NULL, &pIps, &nbIps) == 0) {
+        for (i = 0, rc = 0; ((i < nbIps) && !rc); i++) {
+            len = strlen(psDeviceName);
+            if (!strncmp(pIps[i].sDevName, psDeviceName, len) && ((pIps[i].sDevName[len] == '\0') || (pIps[i].sDevName[len] == ':'))) {
+                rc = dev_nl_addr(devh, RTM_DELADDR, psDeviceName, pIps[i].address, pIps[i].netmask, 0, NULL);
+            }
+        }
+        dev_free_ips(&pIps);
+        if (rc == 0) {
+            return (0);
+        } else if (!dev_nl_fallback(rc)) {
+            LOGERROR("Fail to flush ip addresses on network device '%s': %s\n", psDeviceName, strerror(rc));
+            return (1);
+        }
+    }
     if (euca_execlp(&rc, devh->cmdprefix, "ip", "addr", "flush", psDeviceName, NULL) != EUCA_OK) {
         LOGERROR("Fail to flush ip addresses on network device '%s'. error=%d\n", psDeviceName, rc);
         return (1);
@@ -1884,14 +2080,19 @@ int dev_install_ip(dev_handler *devh, const char *psDeviceName, in_addr_t addres
     if (!dev_exist(psDeviceName)) {
         return (1);
     }
-    // Set our host address
-    snprintf(sHost, NETWORK_ADDR_LEN, "%s/%u", euca_ntoa(address), slashnet);
-
     //
     // If the address is already assigned, this will simply update if anything needs
     // to be updated. Changing the scope/netmask of an installed address is a valid
     // optration.
     //
+    if ((rc = dev_nl_addr(devh, RTM_NEWADDR, psDeviceName, address, netmask, broadcast, psScope)) == 0) {
+        return (0);
+    } else if (!dev_nl_fallback(rc)) {
+        LOGERROR("Failed to install host '%s/%u' with scope '%s' on network device '%s': %s\n", euca_ntoa(address), slashnet, psScope, psDeviceName, strerror(rc));
+        return (1);
+    }
+    // Set our host address
+    snprintf(sHost, NETWORK_ADDR_LEN, "%s/%u", euca_ntoa(address), slashnet);
     if (broadcast) {
         if (euca_execlp(&rc, devh->cmdprefix, "ip", "addr", "add", sHost, "broadcast", euca_ntoa(broadcast), "scope", psScope, "dev", psDeviceName, NULL) != EUCA_OK) {
             LOGERROR("Failed to install host '%s' Broadcast '%s' with scope '%s' on network device '%s'. error=%d\n", sHost, euca_ntoa(broadcast), psScope, psDeviceName, rc);
@@ -2080,6 +2281,12 @@ int dev_remove_ip(dev_handler *devh, const char *psDeviceName, in_addr_t address
         return (0);
     }
 
+    if ((rc = dev_nl_addr(devh, RTM_DELADDR, psDeviceName, address, netmask, 0, NULL)) == 0) {
+        return (0);
+    } else if (!dev_nl_fallback(rc)) {
+        LOGERROR("Fail to remove host '%s/%u' from network device '%s': %s\n", euca_ntoa(address), slashnet, psDeviceName, strerror(rc));
+        return (1);
+    }
     snprintf(sHost, NETWORK_ADDR_LEN, "%s/%u", euca_ntoa(address), slashnet);
     if (euca_execlp(&rc, devh->cmdprefix, "ip", "addr", "del", sHost, "dev", psDeviceName, NULL) != EUCA_OK) {
         LOGERROR("Fail to remove host '%s' from network device '%s'. error=%d\n", sHost, psDeviceName, rc);
@@ -2122,3 +2329,555 @@ int dev_remove_ips(dev_handler *devh, in_addr_entry *pIps, int nbIps) {
     return (removed);
 }
 
+
+/**
+ * Initializes an rtnetlink request that the kernel must acknowledge.
+ *
+ * @param pReq [in] pointer to the request
+ * @param type [in] the request type (RTM_NEWLINK, RTM_DELADDR, ...)
+ * @param flags [in] additional netlink flags (NLM_F_CREATE, ...)
+ * @param payloadLen [in] size of the request payload (struct ifinfomsg or struct ifaddrmsg)
+ */
+static void dev_nl_request_init(dev_nl_request *pReq, u16 type, u16 flags, size_t payloadLen) {
+    memset(pReq, 0, sizeof(dev_nl_request));
+    pReq->hdr.nlmsg_len = NLMSG_LENGTH(payloadLen);
+    pReq->hdr.nlmsg_type = type;
+    pReq->hdr.nlmsg_flags = (NLM_F_REQUEST | NLM_F_ACK | flags);
+}
+
+/**
+ * Appends an attribute to an rtnetlink request.
+ *
+ * @param pReq [in] pointer to the request
+ * @param type [in] the attribute type
+ * @param pData [in] the attribute value
+ * @param len [in] the attribute value length. 0 starts a nested attribute.
+ *
+ * @return a pointer to the attribute, to close it with dev_nl_end_nest() if nested
+ */
+static struct rtattr *dev_nl_add_attr(dev_nl_request *pReq, int type, const void *pData, int len) {
+    struct rtattr *pAttr = (struct rtattr *)(((char *)&(pReq->hdr)) + NLMSG_ALIGN(pReq->hdr.nlmsg_len));
+
+    pAttr->rta_type = type;
+    pAttr->rta_len = RTA_LENGTH(len);
+    if (len) {
+        memcpy(RTA_DATA(pAttr), pData, len);
+    }
+    pReq->hdr.nlmsg_len = NLMSG_ALIGN(pReq->hdr.nlmsg_len) + RTA_ALIGN(pAttr->rta_len);
+    return (pAttr);
+}
+
+/**
+ * Closes a nested attribute once all of its content was appended.
+ *
+ * @param pReq [in] pointer to the request
+ * @param pNest [in] the nested attribute started with dev_nl_add_attr()
+ */
+static void dev_nl_end_nest(dev_nl_request *pReq, struct rtattr *pNest) {
+    pNest->rta_len = (((char *)&(pReq->hdr)) + pReq->hdr.nlmsg_len) - ((char *)pNest);
+}
+
+/**
+ * Opens an rtnetlink socket.
+ *
+ * @param groups [in] multicast groups to subscribe to (RTMGRP_*), 0 for none
+ *
+ * @return the socket on success or -1 on failure, with errno set
+ */
+static int dev_nl_open(u32 groups) {
+    int fd = -1;
+    int err = 0;
+    struct sockaddr_nl sa = { 0 };
+
+    if ((fd = socket(AF_NETLINK, (SOCK_RAW | SOCK_CLOEXEC), NETLINK_ROUTE)) < 0) {
+        return (-1);
+    }
+    sa.nl_family = AF_NETLINK;
+    sa.nl_groups = groups;
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return (-1);
+    }
+    return (fd);
+}
+
+/**
+ * Sends an rtnetlink request and waits for its acknowledgement.
+ *
+ * @param devh [in] pointer to the device handler
+ * @param pReq [in] pointer to the request
+ *
+ * @return 0 on success or the errno value of the failure
+ */
+static int dev_nl_talk(dev_handler *devh, dev_nl_request *pReq) {
+    int len = 0;
+    char sBuffer[DEV_NL_BUFFER_SIZE] = "";
+    struct nlmsghdr *pHdr = NULL;
+
+    if ((devh->nlFd < 0) && ((devh->nlFd = dev_nl_open(0)) < 0)) {
+        return (errno);
+    }
+
+    pReq->hdr.nlmsg_seq = ++devh->nlSeq;
+    if (send(devh->nlFd, pReq, pReq->hdr.nlmsg_len, 0) < 0) {
+        return (errno);
+    }
+
+    for (;;) {
+        if ((len = recv(devh->nlFd, sBuffer, sizeof(sBuffer), 0)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return (errno);
+        }
+        for (pHdr = (struct nlmsghdr *)sBuffer; NLMSG_OK(pHdr, len); pHdr = NLMSG_NEXT(pHdr, len)) {
+            // Skip the late replies of requests we gave up on
+            if (pHdr->nlmsg_seq != pReq->hdr.nlmsg_seq)
+                continue;
+            if (pHdr->nlmsg_type == NLMSG_ERROR) {
+                return (-((struct nlmsgerr *)NLMSG_DATA(pHdr))->error);
+            }
+        }
+    }
+}
+
+/**
+ * Dumps the links or the addresses of the system into the device handler lists.
+ *
+ * @param devh [in] pointer to the device handler
+ * @param type [in] RTM_GETLINK or RTM_GETADDR
+ * @param family [in] address family of the dump
+ *
+ * @return 0 on success or the errno value of the failure
+ */
+static int dev_nl_dump(dev_handler *devh, u16 type, u8 family) {
+    int len = 0;
+    char sBuffer[DEV_NL_BUFFER_SIZE] = "";
+    struct nlmsghdr *pHdr = NULL;
+    dev_nl_request req = { { 0 } };
+
+    if ((devh->nlFd < 0) && ((devh->nlFd = dev_nl_open(0)) < 0)) {
+        return (errno);
+    }
+
+    dev_nl_request_init(&req, type, NLM_F_DUMP, sizeof(struct rtgenmsg));
+    req.hdr.nlmsg_flags &= ~NLM_F_ACK;
+    req.hdr.nlmsg_seq = ++devh->nlSeq;
+    ((struct rtgenmsg *)NLMSG_DATA(&(req.hdr)))->rtgen_family = family;
+    if (send(devh->nlFd, &req, req.hdr.nlmsg_len, 0) < 0) {
+        return (errno);
+    }
+
+    for (;;) {
+        if ((len = recv(devh->nlFd, sBuffer, sizeof(sBuffer), 0)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return (errno);
+        }
+        for (pHdr = (struct nlmsghdr *)sBuffer; NLMSG_OK(pHdr, len); pHdr = NLMSG_NEXT(pHdr, len)) {
+            if (pHdr->nlmsg_seq != req.hdr.nlmsg_seq)
+                continue;
+            if (pHdr->nlmsg_type == NLMSG_DONE)
+                return (0);
+            if (pHdr->nlmsg_type == NLMSG_ERROR)
+                return (-((struct nlmsgerr *)NLMSG_DATA(pHdr))->error);
+            dev_nl_apply(devh, pHdr);
+        }
+    }
+}
+
+/**
+ * Applies the link and address events received since the last call to the device
+ * handler lists. When events were lost, the handler is marked as not populated so
+ * that the next dev_handler_repopulate() dumps the devices again.
+ *
+ * @param devh [in] pointer to the device handler
+ *
+ * @return the number of events applied, or -1 if the lists may be out of date
+ */
+static int dev_nl_process_events(dev_handler *devh) {
+    int len = 0;
+    int nbEvents = 0;
+    char sBuffer[DEV_NL_BUFFER_SIZE] = "";
+    struct nlmsghdr *pHdr = NULL;
+
+    if (devh->nlEventFd < 0) {
+        devh->populated = FALSE;
+        return (-1);
+    }
+
+    for (;;) {
+        if ((len = recv(devh->nlEventFd, sBuffer, sizeof(sBuffer), MSG_DONTWAIT)) < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                return (nbEvents);
+            if (errno == EINTR)
+                continue;
+            // ENOBUFS: the kernel dropped events
+            LOGDEBUG("cannot read network device events: %s\n", strerror(errno));
+            devh->populated = FALSE;
+            return (-1);
+        }
+        for (pHdr = (struct nlmsghdr *)sBuffer; NLMSG_OK(pHdr, len); pHdr = NLMSG_NEXT(pHdr, len)) {
+            dev_nl_apply(devh, pHdr);
+            nbEvents++;
+        }
+    }
+}
+
+/**
+ * Applies a link or address message, from a dump or an event, to the device handler lists.
+ *
+ * @param devh [in] pointer to the device handler
+ * @param pHdr [in] the rtnetlink message
+ */
+static void dev_nl_apply(dev_handler *devh, struct nlmsghdr *pHdr) {
+    switch (pHdr->nlmsg_type) {
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+        dev_nl_apply_link(devh, pHdr);
+        break;
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+        dev_nl_apply_addr(devh, pHdr);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Adds, updates or removes the device of an RTM_NEWLINK or RTM_DELLINK message.
+ *
+ * @param devh [in] pointer to the device handler
+ * @param pHdr [in] the rtnetlink message
+ */
+static void dev_nl_apply_link(dev_handler *devh, struct nlmsghdr *pHdr) {
+    int i = 0;
+    int j = 0;
+    int len = 0;
+    int nestLen = 0;
+    int macLen = 0;
+    boolean isBridge = FALSE;
+    const char *psName = NULL;
+    const u8 *pMac = NULL;
+    dev_entry *pDevice = NULL;
+    struct rtattr *pAttr = NULL;
+    struct rtattr *pNest = NULL;
+    struct ifinfomsg *pIfi = NLMSG_DATA(pHdr);
+
+    // Bridge port notifications (AF_BRIDGE) do not describe the device itself
+    if (pIfi->ifi_family != AF_UNSPEC)
+        return;
+
+    len = IFLA_PAYLOAD(pHdr);
+    for (pAttr = IFLA_RTA(pIfi); RTA_OK(pAttr, len); pAttr = RTA_NEXT(pAttr, len)) {
+        if (pAttr->rta_type == IFLA_IFNAME) {
+            psName = RTA_DATA(pAttr);
+        } else if (pAttr->rta_type == IFLA_ADDRESS) {
+            pMac = RTA_DATA(pAttr);
+            macLen = RTA_PAYLOAD(pAttr);
+        } else if (pAttr->rta_type == IFLA_LINKINFO) {
+            nestLen = RTA_PAYLOAD(pAttr);
+            for (pNest = RTA_DATA(pAttr); RTA_OK(pNest, nestLen); pNest = RTA_NEXT(pNest, nestLen)) {
+                if ((pNest->rta_type == IFLA_INFO_KIND) && !strncmp(RTA_DATA(pNest), "bridge", RTA_PAYLOAD(pNest)) && (RTA_PAYLOAD(pNest) >= strlen("bridge")))
+                    isBridge = TRUE;
+            }
+        }
+    }
+
+    for (i = 0; ((i < devh->numberOfDevices) && (devh->pDevices[i].ifIndex != pIfi->ifi_index)); i++) ;
+
+    if (pHdr->nlmsg_type == RTM_DELLINK) {
+        if (i < devh->numberOfDevices) {
+            memmove(&(devh->pDevices[i]), &(devh->pDevices[i + 1]), ((devh->numberOfDevices - i - 1) * sizeof(dev_entry)));
+            devh->numberOfDevices--;
+        }
+        // The addresses of the device go away with it
+        for (j = 0; j < devh->numberOfNetworks;) {
+            if (devh->pNetworks[j].ifIndex == pIfi->ifi_index) {
+                memmove(&(devh->pNetworks[j]), &(devh->pNetworks[j + 1]), ((devh->numberOfNetworks - j - 1) * sizeof(in_addr_entry)));
+                devh->numberOfNetworks--;
+            } else {
+                j++;
+            }
+        }
+        return;
+    }
+
+    if (!psName)
+        return;
+
+    if (i == devh->numberOfDevices) {
+        if ((pDevice = EUCA_REALLOC(devh->pDevices, (devh->numberOfDevices + 1), sizeof(dev_entry))) == NULL) {
+            LOGERROR("Memory allocation failure.\n");
+            devh->populated = FALSE;
+            return;
+        }
+        devh->pDevices = pDevice;
+        devh->numberOfDevices++;
+        memset(&(devh->pDevices[i]), 0, sizeof(dev_entry));
+        devh->pDevices[i].ifIndex = pIfi->ifi_index;
+    } else if (strcmp(devh->pDevices[i].sDevName, psName)) {
+        // Renamed device: its addresses are listed under its name
+        for (j = 0; j < devh->numberOfNetworks; j++) {
+            if ((devh->pNetworks[j].ifIndex == pIfi->ifi_index) && !strcmp(devh->pNetworks[j].sDevName, devh->pDevices[i].sDevName)) {
+                snprintf(devh->pNetworks[j].sDevName, IF_NAME_LEN, "%s", psName);
+            }
+        }
+    }
+
+    pDevice = &(devh->pDevices[i]);
+    snprintf(pDevice->sDevName, IF_NAME_LEN, "%s", psName);
+    pDevice->isBridge = isBridge;
+    pDevice->sMacAddress[0] = '\0';
+    // Same format as /sys/class/net/[device]/address
+    for (j = 0, len = 0; (j < macLen) && ((len + 3) < ENET_ADDR_LEN); j++) {
+        len += snprintf(&(pDevice->sMacAddress[len]), (ENET_ADDR_LEN - len), (j ? ":%02x" : "%02x"), pMac[j]);
+    }
+}
+
+/**
+ * Adds or removes the IPv4 address of an RTM_NEWADDR or RTM_DELADDR message.
+ *
+ * @param devh [in] pointer to the device handler
+ * @param pHdr [in] the rtnetlink message
+ */
+static void dev_nl_apply_addr(dev_handler *devh, struct nlmsghdr *pHdr) {
+    int i = 0;
+    int len = 0;
+    in_addr_t address = 0;
+    in_addr_t netmask = 0;
+    boolean hasAddress = FALSE;
+    char sName[IF_NAMESIZE] = "";
+    const char *psLabel = NULL;
+    in_addr_entry *pEntry = NULL;
+    struct rtattr *pAttr = NULL;
+    struct ifaddrmsg *pIfa = NLMSG_DATA(pHdr);
+
+    if (pIfa->ifa_family != AF_INET)
+        return;
+
+    len = IFA_PAYLOAD(pHdr);
+    for (pAttr = IFA_RTA(pIfa); RTA_OK(pAttr, len); pAttr = RTA_NEXT(pAttr, len)) {
+        // IFA_LOCAL is the address of the device, IFA_ADDRESS is the peer on point to point links
+        if ((pAttr->rta_type == IFA_LOCAL) || ((pAttr->rta_type == IFA_ADDRESS) && !hasAddress)) {
+            address = ntohl(*((u32 *)RTA_DATA(pAttr)));
+            hasAddress = TRUE;
+        } else if (pAttr->rta_type == IFA_LABEL) {
+            psLabel = RTA_DATA(pAttr);
+        }
+    }
+    if (!hasAddress)
+        return;
+    netmask = ((pIfa->ifa_prefixlen) ? (0xFFFFFFFF << (32 - pIfa->ifa_prefixlen)) : 0);
+
+    for (i = 0; i < devh->numberOfNetworks; i++) {
+        pEntry = &(devh->pNetworks[i]);
+        if ((pEntry->ifIndex == (int)pIfa->ifa_index) && (pEntry->address == address) && (pEntry->netmask == netmask))
+            break;
+    }
+
+    if (pHdr->nlmsg_type == RTM_DELADDR) {
+        if (i < devh->numberOfNetworks) {
+            memmove(&(devh->pNetworks[i]), &(devh->pNetworks[i + 1]), ((devh->numberOfNetworks - i - 1) * sizeof(in_addr_entry)));
+            devh->numberOfNetworks--;
+        }
+        return;
+    }
+
+    if (i == devh->numberOfNetworks) {
+        if ((pEntry = EUCA_REALLOC(devh->pNetworks, (devh->numberOfNetworks + 1), sizeof(in_addr_entry))) == NULL) {
+            LOGERROR("Memory allocation failure.\n");
+            devh->populated = FALSE;
+            return;
+        }
+        devh->pNetworks = pEntry;
+        devh->numberOfNetworks++;
+    }
+
+    // Addresses are listed under their label, like getifaddrs() does, which defaults to the device name
+    if (!psLabel) {
+        psLabel = (if_indextoname(pIfa->ifa_index, sName) ? sName : "");
+    }
+    dev_in_addr_entry(&(devh->pNetworks[i]), psLabel, address, netmask);
+    devh->pNetworks[i].ifIndex = pIfa->ifa_index;
+}
+
+/**
+ * Changes the flags, the name or the master device of a link.
+ *
+ * @param devh [in] pointer to the device handler
+ * @param psDeviceName [in] the device name
+ * @param flags [in] new values of the flags in change (IFF_UP, IFF_PROMISC, ...)
+ * @param change [in] mask of the flags to change
+ * @param psNewDevName [in] new device name, NULL to keep it
+ * @param masterIndex [in] index of the new master device, 0 to detach the device from its master, -1 to keep it
+ *
+ * @return 0 on success or the errno value of the failure
+ */
+static int dev_nl_set_link(dev_handler *devh, const char *psDeviceName, u32 flags, u32 change, const char *psNewDevName, int masterIndex) {
+    dev_nl_request req = { { 0 } };
+
+    dev_nl_request_init(&req, RTM_NEWLINK, 0, sizeof(struct ifinfomsg));
+    req.link.ifi_family = AF_UNSPEC;
+    if ((req.link.ifi_index = if_nametoindex(psDeviceName)) == 0) {
+        return (ENODEV);
+    }
+    req.link.ifi_flags = flags;
+    req.link.ifi_change = change;
+    if (psNewDevName) {
+        dev_nl_add_attr(&req, IFLA_IFNAME, psNewDevName, (strlen(psNewDevName) + 1));
+    }
+    if (masterIndex >= 0) {
+        dev_nl_add_attr(&req, IFLA_MASTER, &masterIndex, sizeof(masterIndex));
+    }
+    return (dev_nl_talk(devh, &req));
+}
+
+/**
+ * Creates a link of the given kind.
+ *
+ * @param devh [in] pointer to the device handler
+ * @param psDeviceName [in] the name of the new device
+ * @param psKind [in] the kind of device ("bridge", "vlan", ...)
+ * @param psParentName [in] the device a VLAN device is created on, NULL for none
+ * @param vlan [in] the VLAN identifier of a VLAN device, -1 for none
+ *
+ * @return 0 on success or the errno value of the failure
+ */
+static int dev_nl_new_link(dev_handler *devh, const char *psDeviceName, const char *psKind, const char *psParentName, int vlan) {
+    int parentIndex = 0;
+    u16 vlanId = 0;
+    struct rtattr *pLinkInfo = NULL;
+    struct rtattr *pInfoData = NULL;
+    dev_nl_request req = { { 0 } };
+
+    dev_nl_request_init(&req, RTM_NEWLINK, (NLM_F_CREATE | NLM_F_EXCL), sizeof(struct ifinfomsg));
+    req.link.ifi_family = AF_UNSPEC;
+    dev_nl_add_attr(&req, IFLA_IFNAME, psDeviceName, (strlen(psDeviceName) + 1));
+    if (psParentName) {
+        if ((parentIndex = if_nametoindex(psParentName)) == 0) {
+            return (ENODEV);
+        }
+        dev_nl_add_attr(&req, IFLA_LINK, &parentIndex, sizeof(parentIndex));
+    }
+    pLinkInfo = dev_nl_add_attr(&req, IFLA_LINKINFO, NULL, 0);
+    dev_nl_add_attr(&req, IFLA_INFO_KIND, psKind, strlen(psKind));
+    if (vlan >= 0) {
+        vlanId = vlan;
+        pInfoData = dev_nl_add_attr(&req, IFLA_INFO_DATA, NULL, 0);
+        dev_nl_add_attr(&req, IFLA_VLAN_ID, &vlanId, sizeof(vlanId));
+        dev_nl_end_nest(&req, pInfoData);
+    }
+    dev_nl_end_nest(&req, pLinkInfo);
+    return (dev_nl_talk(devh, &req));
+}
+
+/**
+ * Deletes a link.
+ *
+ * @param devh [in] pointer to the device handler
+ * @param psDeviceName [in] the device name
+ *
+ * @return 0 on success or the errno value of the failure
+ */
+static int dev_nl_del_link(dev_handler *devh, const char *psDeviceName) {
+    dev_nl_request req = { { 0 } };
+
+    dev_nl_request_init(&req, RTM_DELLINK, 0, sizeof(struct ifinfomsg));
+    req.link.ifi_family = AF_UNSPEC;
+    if ((req.link.ifi_index = if_nametoindex(psDeviceName)) == 0) {
+        return (ENODEV);
+    }
+    return (dev_nl_talk(devh, &req));
+}
+
+/**
+ * Installs (RTM_NEWADDR) or removes (RTM_DELADDR) an IPv4 address on a device. An
+ * installed address that already exists is updated with the given netmask, broadcast
+ * address and scope.
+ *
+ * @param devh [in] pointer to the device handler
+ * @param type [in] RTM_NEWADDR or RTM_DELADDR
+ * @param psDeviceName [in] the device name
+ * @param address [in] the address
+ * @param netmask [in] the netmask
+ * @param broadcast [in] the broadcast address, 0 for none
+ * @param psScope [in] the scope (SCOPE_GLOBAL, ...), ignored when removing
+ *
+ * @return 0 on success or the errno value of the failure
+ */
+static int dev_nl_addr(dev_handler *devh, u16 type, const char *psDeviceName, in_addr_t address, in_addr_t netmask, in_addr_t broadcast, const char *psScope) {
+    u32 value = 0;
+    dev_nl_request req = { { 0 } };
+
+    dev_nl_request_init(&req, type, ((type == RTM_NEWADDR) ? (NLM_F_CREATE | NLM_F_REPLACE) : 0), sizeof(struct ifaddrmsg));
+    req.addr.ifa_family = AF_INET;
+    req.addr.ifa_prefixlen = NETMASK_TO_SLASHNET(netmask);
+    if ((req.addr.ifa_index = if_nametoindex(psDeviceName)) == 0) {
+        return (ENODEV);
+    }
+    if (psScope && !strcmp(psScope, SCOPE_HOST)) {
+        req.addr.ifa_scope = RT_SCOPE_HOST;
+    } else if (psScope && !strcmp(psScope, SCOPE_LINK)) {
+        req.addr.ifa_scope = RT_SCOPE_LINK;
+    } else if (psScope && !strcmp(psScope, SCOPE_SITE)) {
+        req.addr.ifa_scope = RT_SCOPE_SITE;
+    } else {
+        req.addr.ifa_scope = RT_SCOPE_UNIVERSE;
+    }
+
+    value = htonl(address);
+    dev_nl_add_attr(&req, IFA_LOCAL, &value, sizeof(value));
+    dev_nl_add_attr(&req, IFA_ADDRESS, &value, sizeof(value));
+    if (broadcast && (type == RTM_NEWADDR)) {
+        value = htonl(broadcast);
+        dev_nl_add_attr(&req, IFA_BROADCAST, &value, sizeof(value));
+    }
+    return (dev_nl_talk(devh, &req));
+}
+
+/**
+ * Tells whether an operation that failed over rtnetlink should be run with the helper
+ * commands instead. This is the case when we lack CAP_NET_ADMIN, which eucanetd keeps
+ * across its privilege drop unless the system refused it, or when the kernel does not
+ * support the request.
+ *
+ * @param rc [in] the errno value of the rtnetlink failure
+ *
+ * @return TRUE if the helper commands should be used otherwise FALSE is returned
+ */
+static inline boolean dev_nl_fallback(int rc) {
+    return (((rc == EPERM) || (rc == EACCES) || (rc == EOPNOTSUPP)) ? TRUE : FALSE);
+}
+
+/**
+ * Sets a bridge attribute (IFLA_BR_*) over rtnetlink. Kernels without bridge
+ * netlink configuration reject the request with EOPNOTSUPP.
+ *
+ * @param devh [in] pointer to the device handler
+ * @param psBridgeName [in] the bridge device name
+ * @param attr [in] the attribute (DEV_NL_BR_STP_STATE, DEV_NL_BR_FORWARD_DELAY, ...)
+ * @param value [in] the value to set, times are in hundredths of a second
+ *
+ * @return 0 on success or the errno value of the failure
+ */
+static int dev_nl_set_bridge_attr(dev_handler *devh, const char *psBridgeName, u16 attr, u32 value) {
+    struct rtattr *pLinkInfo = NULL;
+    struct rtattr *pInfoData = NULL;
+    dev_nl_request req = { { 0 } };
+
+    dev_nl_request_init(&req, RTM_NEWLINK, 0, sizeof(struct ifinfomsg));
+    req.link.ifi_family = AF_UNSPEC;
+    if ((req.link.ifi_index = if_nametoindex(psBridgeName)) == 0) {
+        return (ENODEV);
+    }
+    pLinkInfo = dev_nl_add_attr(&req, IFLA_LINKINFO, NULL, 0);
+    dev_nl_add_attr(&req, IFLA_INFO_KIND, "bridge", strlen("bridge"));
+    pInfoData = dev_nl_add_attr(&req, IFLA_INFO_DATA, NULL, 0);
+    dev_nl_add_attr(&req, attr, &value, sizeof(value));
+    dev_nl_end_nest(&req, pInfoData);
+    dev_nl_end_nest(&req, pLinkInfo);
+    return (dev_nl_talk(devh, &req));
+}
@@ -118,6 +118,7 @@ typedef struct dev_entry_t {
     char sDevName[IF_NAME_LEN];        //!< Name of the device
     char sMacAddress[ENET_ADDR_LEN];   //!< Mac address string associated with this interface
     boolean isBridge;                  //!< Indicates if a device is a bridge device (TRUE) or not (FALSE)
+    int ifIndex;                       //!< Kernel index of the device (only set in the device handler cache)
 } dev_entry;
 
 //! A structure containing the pertinent information about a networking addresses
@@ -128,6 +129,7 @@ typedef struct in_addr_entry_t {
     in_addr_t broascast;               //!< The network broadcast address
     u32 slashnet;                      //!< The bitmask for the network
     char sHost[NETWORK_ADDR_LEN];      //!< The host entry for this IP in the form of AAA.BBB.CCC.DDD/XX
+    int ifIndex;                       //!< Kernel index of the device (only set in the device handler cache)
 } in_addr_entry;
 
 typedef struct dev_handler_t {
@@ -137,6 +139,10 @@ typedef struct dev_handler_t {
     int numberOfNetworks;              //!< The number of networks in the pNetworks list
     int init;
     char cmdprefix[EUCA_MAX_PATH];
+    int nlFd;                          //!< rtnetlink socket used to configure devices (-1 until first used)
+    u32 nlSeq;                         //!< Sequence number of the last rtnetlink request
+    int nlEventFd;                     //!< rtnetlink socket subscribed to link and IPv4 address events (-1 if none)
+    boolean populated;                 //!< Set once the lists hold the system state, which events then keep up to date
 } dev_handler;
 
 
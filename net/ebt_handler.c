@@ -92,6 +92,10 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+static const char *ebt_chain_key(const void *base, int idx);
+static const char *ebt_rule_key(const void *base, int idx);
+static void ebt_handler_free_tables(ebt_handler *ebth);
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                   MACROS                                   |
@@ -509,6 +513,7 @@ int ebt_table_add_chain(ebt_handler *ebth, char *tablename, char *chainname, cha
             table->chains[table->max_chains].ref_count = 1;
         }
 
+        euca_strindex_add(&(table->chain_index), table->chains[table->max_chains].name, table->max_chains, ebt_chain_key, table->chains);
         table->max_chains++;
 
     }
@@ -555,6 +560,7 @@ int ebt_chain_add_rule(ebt_handler *ebth, char *tablename, char *chainname, char
         }
         bzero(&(chain->rules[chain->max_rules]), sizeof(ebt_rule));
         snprintf(chain->rules[chain->max_rules].ebtrule, 1024, "%s", newrule);
+        euca_strindex_add(&(chain->rule_index), chain->rules[chain->max_rules].ebtrule, chain->max_rules, ebt_rule_key, chain->rules);
         chain->max_rules++;
     }
     return (0);
@@ -636,7 +642,7 @@ ebt_table *ebt_handler_find_table(ebt_handler *ebth, char *findtable) {
  * @return pointer to ebt_chain structure of interest if found. NULL otherwise.
  */
 ebt_chain *ebt_table_find_chain(ebt_handler *ebth, char *tablename, char *findchain) {
-    int i, found = 0, chainidx = 0;
+    int chainidx = 0;
     ebt_table *table = NULL;
 
     if (!ebth || !tablename || !findchain || !ebth->init) {
@@ -648,14 +654,8 @@ ebt_chain *ebt_table_find_chain(ebt_handler *ebth, char *tablename, char *findch
         return (NULL);
     }
 
-    found = 0;
-    for (i = 0; i < table->max_chains && !found; i++) {
-        chainidx = i;
-        if (!strcmp(table->chains[i].name, findchain))
-            found++;
-    }
-
-    if (!found) {
+    chainidx = euca_strindex_find(&(table->chain_index), findchain, ebt_chain_key, table->chains);
+    if (chainidx < 0) {
         return (NULL);
     }
 
@@ -673,7 +673,7 @@ ebt_chain *ebt_table_find_chain(ebt_handler *ebth, char *tablename, char *findch
  * @return pointer to ebt_rule structure if found. NULL otherwise.
  */
 ebt_rule *ebt_chain_find_rule(ebt_handler *ebth, char *tablename, char *chainname, char *findrule) {
-    int i, found = 0;
+    int ruleidx = 0;
     ebt_chain *chain;
 
     if (!ebth || !tablename || !chainname || !findrule || !ebth->init) {
@@ -685,14 +685,11 @@ ebt_rule *ebt_chain_find_rule(ebt_handler *ebth, char *tablename, char *chainnam
         return (NULL);
     }
 
-    for (i = 0; i < chain->max_rules; i++) {
-        if (!strcmp(chain->rules[i].ebtrule, findrule))
-            found++;
-    }
-    if (!found) {
+    ruleidx = euca_strindex_find(&(chain->rule_index), findrule, ebt_rule_key, chain->rules);
+    if (ruleidx < 0) {
         return (NULL);
     }
-    return (&(chain->rules[i]));
+    return (&(chain->rules[ruleidx]));
 }
 
 /**
@@ -739,7 +736,7 @@ int ebt_table_deletechainempty(ebt_handler *ebth, char *tablename) {
  * @return 0 on success. 1 on failure.
  */
 int ebt_table_deletechainmatch(ebt_handler *ebth, char *tablename, char *chainmatch) {
-    int i, found = 0;
+    int i, found = 0, renamed = 0;
     ebt_table *table = NULL;
 
     if (!ebth || !tablename || !chainmatch || !ebth->init) {
@@ -755,11 +752,17 @@ int ebt_table_deletechainmatch(ebt_handler *ebth, char *tablename, char *chainma
     for (i = 0; i < table->max_chains && !found; i++) {
         if (strstr(table->chains[i].name, chainmatch)) {
             EUCA_FREE(table->chains[i].rules);
+            euca_strindex_clear(&(table->chains[i].rule_index));
             bzero(&(table->chains[i]), sizeof(ebt_chain));
             snprintf(table->chains[i].name, 64, "EMPTY");
+            renamed++;
         }
     }
 
+    // chains were renamed
+    if (renamed) {
+        euca_strindex_rebuild(&(table->chain_index), table->max_chains, ebt_chain_key, table->chains);
+    }
     return (0);
 }
 
@@ -790,6 +793,7 @@ int ebt_chain_flush(ebt_handler *ebth, char *tablename, char *chainname) {
     }
 
     EUCA_FREE(chain->rules);
+    euca_strindex_clear(&(chain->rule_index));
     chain->max_rules = 0;
     chain->counters[0] = '\0';
 
@@ -848,8 +852,10 @@ int ebt_chain_flush_rule(ebt_handler *ebth, char *tablename, char *chainname, ch
             EUCA_FREE(chain->rules);
             chain->rules = newrules;
             chain->max_rules = nridx;
+            euca_strindex_rebuild(&(chain->rule_index), chain->max_rules, ebt_rule_key, chain->rules);
         } else {
             EUCA_FREE(chain->rules);
+            euca_strindex_clear(&(chain->rule_index));
             chain->max_rules = 0;
             chain->counters[0] = '\0';
         }
@@ -868,21 +874,13 @@ int ebt_chain_flush_rule(ebt_handler *ebth, char *tablename, char *chainname, ch
  * @return 0 on success. 1 on failure.
  */
 int ebt_handler_free(ebt_handler *ebth) {
-    int i = 0;
-    int j = 0;
     char saved_cmdprefix[EUCA_MAX_PATH] = "";
     if (!ebth || !ebth->init) {
         return (1);
     }
     snprintf(saved_cmdprefix, EUCA_MAX_PATH, "%s", ebth->cmdprefix);
 
-    for (i = 0; i < ebth->max_tables; i++) {
-        for (j = 0; j < ebth->tables[i].max_chains; j++) {
-            EUCA_FREE(ebth->tables[i].chains[j].rules);
-        }
-        EUCA_FREE(ebth->tables[i].chains);
-    }
-    EUCA_FREE(ebth->tables);
+    ebt_handler_free_tables(ebth);
 
     return (ebt_handler_init(ebth, saved_cmdprefix));
 }
@@ -895,27 +893,64 @@ int ebt_handler_free(ebt_handler *ebth) {
  * @return 0 on success. 1 otherwise.
  */
 int ebt_handler_close(ebt_handler *ebth) {
-    int i = 0;
-    int j = 0;
     if (!ebth || !ebth->init) {
         LOGTRACE("Invalid argument. NULL or uninitialized ebt_handler.\n");
         return (1);
     }
 
+    ebt_handler_free_tables(ebth);
+
+    unlink_handler_file(ebth->ebt_filter_file);
+    unlink_handler_file(ebth->ebt_nat_file);
+    unlink_handler_file(ebth->ebt_asc_file);
+    ebth->init = 0;
+
+    return (0);
+}
+
+/**
+ * Releases the tables, chains, rules and indexes of this handler.
+ *
+ * @param ebth [in] pointer to the EB table handler structure
+ */
+static void ebt_handler_free_tables(ebt_handler *ebth) {
+    int i = 0;
+    int j = 0;
+
     for (i = 0; i < ebth->max_tables; i++) {
         for (j = 0; j < ebth->tables[i].max_chains; j++) {
             EUCA_FREE(ebth->tables[i].chains[j].rules);
+            euca_strindex_clear(&(ebth->tables[i].chains[j].rule_index));
         }
         EUCA_FREE(ebth->tables[i].chains);
+        euca_strindex_clear(&(ebth->tables[i].chain_index));
     }
     EUCA_FREE(ebth->tables);
+    ebth->max_tables = 0;
+}
 
-    unlink_handler_file(ebth->ebt_filter_file);
-    unlink_handler_file(ebth->ebt_nat_file);
-    unlink_handler_file(ebth->ebt_asc_file);
-    ebth->init = 0;
+/**
+ * Returns the name of a chain, for the chain index of a table.
+ *
+ * @param base [in] the chain array of the table
+ * @param idx [in] position of the chain
+ *
+ * @return the chain name
+ */
+static const char *ebt_chain_key(const void *base, int idx) {
+    return (((const ebt_chain *)base)[idx].name);
+}
 
-    return (0);
+/**
+ * Returns the text of a rule, for the rule index of a chain.
+ *
+ * @param base [in] the rule array of the chain
+ * @param idx [in] position of the rule
+ *
+ * @return the rule text
+ */
+static const char *ebt_rule_key(const void *base, int idx) {
+    return (((const ebt_rule *)base)[idx].ebtrule);
 }
 
 /**
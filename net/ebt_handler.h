@@ -31,6 +31,8 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+#include "euca_strindex.h"
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                  DEFINES                                   |
@@ -66,12 +68,14 @@ typedef struct ebt_chain_t {
     ebt_rule *rules;
     int max_rules;
     int ref_count;
+    euca_strindex rule_index;          //!< Rules indexed by their text
 } ebt_chain;
 
 typedef struct ebt_table_t {
     char name[64];
     ebt_chain *chains;
     int max_chains;
+    euca_strindex chain_index;         //!< Chains indexed by name
 } ebt_table;
 
 typedef struct ebt_handler_t {
@@ -1124,10 +1124,12 @@ int do_midonet_teardown(mido_config *mido) {
  * Creates the meta-data instance/interface IP map file.
  * @param gni [in] Global Network Information to be applied.
  * @param appliedGni [in] most recently applied global network state.
+ * @param diff [in] changes from appliedGni to gni. If not NULL, VPCs, interfaces and
+ * security groups that did not change are tagged as implemented without comparing them.
  * @param mido [in] data structure that holds MidoNet configuration
  * @return 0 on success. 1 otherwise.
  */
-int do_midonet_update_pass1(globalNetworkInfo *gni, globalNetworkInfo *appliedGni, mido_config *mido) {
+int do_midonet_update_pass1(globalNetworkInfo *gni, globalNetworkInfo *appliedGni, gni_diff *diff, mido_config *mido) {
     int ret = 0, i = 0, j = 0, k = 0, rc = 0;
     int vpcidx = 0;
     int vpcsubnetidx = 0;
@@ -1202,7 +1204,9 @@ int do_midonet_update_pass1(globalNetworkInfo *gni, globalNetworkInfo *appliedGn
         } else {
             LOGTRACE("pass1: global VPC %s in mido: Y\n", gnivpc->name);
             if (appliedGni) {
-                if (vpc->gniVpc) {
+                if (diff) {
+                    appliedvpc = gni_diff_get_before(diff, GNI_DIFF_VPCS, gnivpc->name, gnivpc);
+                } else if (vpc->gniVpc) {
                     appliedvpc = vpc->gniVpc;
                 } else {
                     appliedvpc = gni_get_vpc(appliedGni, vpc->name, &vpcidx);
@@ -1328,7 +1332,9 @@ int do_midonet_update_pass1(globalNetworkInfo *gni, globalNetworkInfo *appliedGn
                 } else {
                     LOGTRACE("pass1: global VPC INSTANCE/INTERFACE %s in mido: Y\n", gniinstance->name);
                     if (appliedGni) {
-                        if (vpcinstance->gniInst) {
+                        if (diff) {
+                            appliedinstance = gni_diff_get_before(diff, GNI_DIFF_INTERFACES, gniinstance->name, gniinstance);
+                        } else if (vpcinstance->gniInst) {
                             appliedinstance = vpcinstance->gniInst;
                         } else {
                             appliedinstance = gni_get_interface(appliedvpcsubnet, vpcinstance->name, &vpcinstanceidx);
@@ -1426,7 +1432,9 @@ int do_midonet_update_pass1(globalNetworkInfo *gni, globalNetworkInfo *appliedGn
         } else {
             LOGTRACE("pass1: global VPC SECGROUP %s in mido: Y\n", gnisecgroup->name);
             if (appliedGni) {
-                if (vpcsecgroup->gniSecgroup) {
+                if (diff) {
+                    appliedsecgroup = gni_diff_get_before(diff, GNI_DIFF_SECGROUPS, gnisecgroup->name, gnisecgroup);
+                } else if (vpcsecgroup->gniSecgroup) {
                     appliedsecgroup = vpcsecgroup->gniSecgroup;
                 } else {
                     appliedsecgroup = gni_get_secgroup(appliedGni, vpcsecgroup->name, &vpcsgidx);
@@ -1961,7 +1969,9 @@ int do_midonet_update_pass3_sgs(globalNetworkInfo *gni, mido_config *mido) {
     mido_vpc_secgroup *vpcsecgroup = NULL;
     gni_secgroup *gnisecgroup = NULL;
 
-    // Process security groups
+    // Create mido objects of new security groups in a single batch - objects
+    // that fail to be created are retried (and cleaned up) in the loop below
+    mido_batch_begin();
     for (i = 0; i < gni->max_secgroups; i++) {
         gnisecgroup = &(gni->secgroups[i]);
         vpcsecgroup = (mido_vpc_secgroup *) gnisecgroup->mido_present;
@@ -1985,6 +1995,20 @@ int do_midonet_update_pass3_sgs(globalNetworkInfo *gni, mido_config *mido) {
             vpcsecgroup->interfaces_changed = 1;
         }
 
+        if (!vpcsecgroup->midopresent) {
+            create_mido_vpc_secgroup(mido, vpcsecgroup);
+        }
+    }
+    rc = mido_batch_commit();
+    if (rc) {
+        LOGWARN("failed to create %d mido objects in batch - retrying\n", rc);
+    }
+
+    // Process security groups
+    for (i = 0; i < gni->max_secgroups; i++) {
+        gnisecgroup = &(gni->secgroups[i]);
+        vpcsecgroup = (mido_vpc_secgroup *) gnisecgroup->mido_present;
+
         if (vpcsecgroup->midopresent) {
             // SG presence test passed in pass1
             LOGTRACE("\t\t%s found in mido\n", gnisecgroup->name);
@@ -2168,21 +2192,15 @@ int do_midonet_update_pass3_insts(globalNetworkInfo *gni, mido_config *mido) {
         }
     }
 
-    // Process instances/interfaces
+    // Create mido objects of new instances/interfaces in a single batch - objects
+    // that fail to be created are retried (and cleaned up) in the loop below
+    mido_batch_begin();
     for (i = 0; i < gni->max_ifs; i++) {
-        eucanetd_timer_usec(&tv);
         gniif = gni->ifs[i];
-        if (strlen(gniif->name) == 0) {
-            LOGWARN("Empty interface detected in GNI.\n");
-            ret++;
-            continue;
-        }
         vpc = (mido_vpc *) gniif->mido_vpc;
         vpcsubnet = (mido_vpc_subnet *) gniif->mido_vpcsubnet;
         vpcif = (mido_vpc_instance *) gniif->mido_present;
-        if (!vpc || !vpcsubnet) {
-            LOGWARN("Unable to find %s and/or %s\n", gniif->vpc, gniif->subnet);
-            ret++;
+        if ((strlen(gniif->name) == 0) || !vpc || !vpcsubnet) {
             continue;
         }
 
@@ -2206,6 +2224,33 @@ int do_midonet_update_pass3_insts(globalNetworkInfo *gni, mido_config *mido) {
             LOGINFO("\tcreating %s\n", gniif->name);
         }
 
+        if (!vpcif->midopresent) {
+            create_mido_vpc_instance(vpcif);
+        }
+    }
+    rc = mido_batch_commit();
+    if (rc) {
+        LOGWARN("failed to create %d mido objects in batch - retrying\n", rc);
+    }
+
+    // Process instances/interfaces
+    for (i = 0; i < gni->max_ifs; i++) {
+        eucanetd_timer_usec(&tv);
+        gniif = gni->ifs[i];
+        if (strlen(gniif->name) == 0) {
+            LOGWARN("Empty interface detected in GNI.\n");
+            ret++;
+            continue;
+        }
+        vpc = (mido_vpc *) gniif->mido_vpc;
+        vpcsubnet = (mido_vpc_subnet *) gniif->mido_vpcsubnet;
+        vpcif = (mido_vpc_instance *) gniif->mido_present;
+        if (!vpc || !vpcsubnet || !vpcif) {
+            LOGWARN("Unable to find %s and/or %s\n", gniif->vpc, gniif->subnet);
+            ret++;
+            continue;
+        }
+
         if (vpcif->midopresent) {
             LOGTRACE("\t\tskipping pass3 for %s\n", gniif->name);
             continue;
@@ -3118,12 +3163,13 @@ int do_midonet_maint(mido_config *mido) {
  * Executes a VPCMIDO update based on the Global Network Information.
  * @param gni [in] current global network state.
  * @param appliedGni [in] most recently applied global network state.
+ * @param diff [in] changes from appliedGni to gni. Can be NULL.
  * @param mido [in] data structure that holds MidoNet configuration
  * @return 0 on success. Positive integer when failures are detected. -2 if
  * failures are detected on instances/interfaces creation. -1 if failures are
  * detected on gateway(s) processing.
  */
-int do_midonet_update(globalNetworkInfo *gni, globalNetworkInfo *appliedGni, mido_config *mido) {
+int do_midonet_update(globalNetworkInfo *gni, globalNetworkInfo *appliedGni, gni_diff *diff, mido_config *mido) {
     int rc = 0, ret = 0;
     struct timeval tv;
 
@@ -3144,7 +3190,7 @@ int do_midonet_update(globalNetworkInfo *gni, globalNetworkInfo *appliedGni, mid
         midocache_invalid = 0;
 
         //rc = midonet_api_cache_refresh();
-        rc = midonet_api_cache_refresh_v_threads(MIDO_CACHE_REFRESH_ALL);
+        rc = midonet_api_cache_refresh_v_threads(MIDO_CACHE_REFRESH_INCREMENTAL);
         if (rc) {
             LOGERROR("failed to retrieve objects from MidoNet.\n");
             mido->config->eucanetd_err = EUCANETD_ERR_VPCMIDO_API;
@@ -3273,7 +3319,7 @@ int do_midonet_update(globalNetworkInfo *gni, globalNetworkInfo *appliedGni, mid
     }
 
     eucanetd_timer_usec(&tv);
-    rc = do_midonet_update_pass1(gni, appliedGni, mido);
+    rc = do_midonet_update_pass1(gni, appliedGni, diff, mido);
     if (rc) {
         LOGERROR("pass1: failed update - check midonet health\n");
         ret++;
@@ -5971,6 +6017,7 @@ int initialize_mido(mido_config *mido, eucanetdConfig *eucanetd_config, globalNe
             SP(eucanetd_config->mido_extmdcidr), SP(eucanetd_config->mido_mdcidr));
 
     mido_set_apiuribase(mido->config->mido_api_uribase);
+    midonet_api_cache_set_full_refresh_interval(mido->config->mido_cache_full_refresh);
     midonet_api_init();
     mido_info_midonetapi();
 
@@ -585,8 +585,8 @@ void print_mido_gw(mido_gw *gw, log_level_e llevel);
 int do_midonet_maint(mido_config *mido);
 int do_midonet_populate(mido_config *mido);
 int do_midonet_populate_vpcs(mido_config *mido);
-int do_midonet_update(globalNetworkInfo *gni, globalNetworkInfo *appliedGni, mido_config *mido);
-int do_midonet_update_pass1(globalNetworkInfo *gni, globalNetworkInfo *appliedGni, mido_config *mido);
+int do_midonet_update(globalNetworkInfo *gni, globalNetworkInfo *appliedGni, gni_diff *diff, mido_config *mido);
+int do_midonet_update_pass1(globalNetworkInfo *gni, globalNetworkInfo *appliedGni, gni_diff *diff, mido_config *mido);
 int do_midonet_update_pass2(globalNetworkInfo *gni, mido_config *mido);
 int do_midonet_update_pass3_vpcs(globalNetworkInfo *gni, mido_config *mido);
 int do_midonet_update_pass3_sgs(globalNetworkInfo *gni, mido_config *mido);
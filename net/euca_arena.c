@@ -0,0 +1,281 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+//!
+//! @file net/euca_arena.c
+//! Region allocator for object graphs that are built, used and thrown away as a
+//! whole.
+//!
+//! Allocations are carved out of large chunks and are never released one at a
+//! time. Resetting the arena releases everything at once but keeps its largest
+//! chunk, so rebuilding a graph of about the same size does not go back to the
+//! system allocator. Every allocation is zeroed, like calloc().
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  INCLUDES                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <eucalyptus.h>
+#include <log.h>
+
+#include "euca_arena.h"
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                   MACROS                                   |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! Size of the chunk header, rounded up so the data that follows it is aligned
+#define EUCA_ARENA_HEADER                        ((sizeof(euca_arena_chunk) + EUCA_ARENA_ALIGN - 1) & ~((size_t)EUCA_ARENA_ALIGN - 1))
+
+//! Address of the first byte of data of a chunk
+#define EUCA_ARENA_DATA(_chunk)                  (((char *)(_chunk)) + EUCA_ARENA_HEADER)
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                              STATIC PROTOTYPES                             |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+static euca_arena_chunk *euca_arena_add_chunk(euca_arena *arena, size_t bytes);
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                               IMPLEMENTATION                               |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+/**
+ * Allocates zeroed memory for an array of nmemb elements of size bytes each from an
+ * arena. The memory remains valid until the arena is reset or freed.
+ *
+ * @param arena [in] pointer to the arena
+ * @param nmemb [in] number of elements
+ * @param size [in] size of an element
+ *
+ * @return a pointer to the allocated memory or NULL if any failure occurred. A request
+ *         for 0 bytes returns a valid pointer that must not be written to.
+ */
+void *euca_arena_alloc(euca_arena *arena, size_t nmemb, size_t size) {
+    void *ptr = NULL;
+    size_t bytes = 0;
+    euca_arena_chunk *chunk = NULL;
+
+    if (!arena || ((size != 0) && (nmemb > (SIZE_MAX - EUCA_ARENA_ALIGN) / size))) {
+        return (NULL);
+    }
+
+    bytes = (((nmemb * size) + EUCA_ARENA_ALIGN - 1) & ~((size_t)EUCA_ARENA_ALIGN - 1));
+    chunk = arena->chunks;
+    if (!chunk || ((chunk->size - chunk->used) < bytes)) {
+        if ((chunk = euca_arena_add_chunk(arena, bytes)) == NULL) {
+            return (NULL);
+        }
+    }
+
+    ptr = EUCA_ARENA_DATA(chunk) + chunk->used;
+    chunk->used += bytes;
+    arena->used += bytes;
+    memset(ptr, 0, bytes);
+    return (ptr);
+}
+
+/**
+ * Resizes an array allocated from an arena. The array is moved to a new allocation
+ * (the old one is only reclaimed when the arena is reset) unless it is the last
+ * allocation of the arena and there is room to extend it in place. Elements past
+ * oldnmemb are zeroed.
+ *
+ * @param arena [in] pointer to the arena
+ * @param ptr [in] array to resize (may be NULL)
+ * @param oldnmemb [in] current number of elements of the array
+ * @param nmemb [in] new number of elements of the array
+ * @param size [in] size of an element
+ *
+ * @return a pointer to the resized array or NULL if any failure occurred, in which
+ *         case ptr is left untouched
+ */
+void *euca_arena_realloc(euca_arena *arena, void *ptr, size_t oldnmemb, size_t nmemb, size_t size) {
+    void *newptr = NULL;
+    size_t oldbytes = 0;
+    size_t newbytes = 0;
+    euca_arena_chunk *chunk = NULL;
+
+    if (!arena || ((size != 0) && (nmemb > (SIZE_MAX - EUCA_ARENA_ALIGN) / size))) {
+        return (NULL);
+    }
+    if (!ptr || (oldnmemb == 0)) {
+        return (euca_arena_alloc(arena, nmemb, size));
+    }
+    if (nmemb <= oldnmemb) {
+        return (ptr);
+    }
+
+    oldbytes = (((oldnmemb * size) + EUCA_ARENA_ALIGN - 1) & ~((size_t)EUCA_ARENA_ALIGN - 1));
+    newbytes = (((nmemb * size) + EUCA_ARENA_ALIGN - 1) & ~((size_t)EUCA_ARENA_ALIGN - 1));
+    chunk = arena->chunks;
+    if (chunk && (((char *)ptr + oldbytes) == (EUCA_ARENA_DATA(chunk) + chunk->used)) && ((chunk->size - chunk->used) >= (newbytes - oldbytes))) {
+        memset((char *)ptr + oldbytes, 0, (newbytes - oldbytes));
+        chunk->used += (newbytes - oldbytes);
+        arena->used += (newbytes - oldbytes);
+        return (ptr);
+    }
+
+    if ((newptr = euca_arena_alloc(arena, nmemb, size)) != NULL) {
+        memcpy(newptr, ptr, (oldnmemb * size));
+    }
+    return (newptr);
+}
+
+/**
+ * Duplicates a string into an arena.
+ *
+ * @param arena [in] pointer to the arena
+ * @param str [in] the string to duplicate
+ *
+ * @return a pointer to the copy or NULL if any failure occurred
+ */
+char *euca_arena_strdup(euca_arena *arena, const char *str) {
+    char *copy = NULL;
+    size_t len = 0;
+
+    if (!str) {
+        return (NULL);
+    }
+
+    len = strlen(str) + 1;
+    if ((copy = euca_arena_alloc(arena, len, sizeof(char))) != NULL) {
+        memcpy(copy, str, len);
+    }
+    return (copy);
+}
+
+/**
+ * Releases every allocation of an arena at once. The largest chunk is kept for the
+ * allocations that follow; the others are given back to the system. If the largest
+ * chunk could not hold everything that was allocated, it is replaced by one that can,
+ * so that filling the arena again with as much data takes a single chunk.
+ *
+ * @param arena [in] pointer to the arena
+ */
+void euca_arena_reset(euca_arena *arena) {
+    size_t used = 0;
+    euca_arena_chunk *chunk = NULL;
+    euca_arena_chunk *next = NULL;
+    euca_arena_chunk *largest = NULL;
+
+    if (!arena) {
+        return;
+    }
+
+    used = arena->used;
+
+    for (chunk = arena->chunks; chunk != NULL; chunk = chunk->next) {
+        if (!largest || (chunk->size > largest->size)) {
+            largest = chunk;
+        }
+    }
+    for (chunk = arena->chunks; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        if (chunk != largest) {
+            EUCA_FREE(chunk);
+        }
+    }
+
+    arena->chunks = largest;
+    arena->used = 0;
+    arena->size = 0;
+    if (largest) {
+        largest->next = NULL;
+        largest->used = 0;
+        arena->size = largest->size;
+        if (largest->size < used) {
+            euca_arena_free(arena);
+            euca_arena_add_chunk(arena, used);
+        }
+    }
+}
+
+/**
+ * Releases every allocation and every chunk of an arena and leaves it empty.
+ *
+ * @param arena [in] pointer to the arena
+ */
+void euca_arena_free(euca_arena *arena) {
+    euca_arena_chunk *chunk = NULL;
+    euca_arena_chunk *next = NULL;
+
+    if (!arena) {
+        return;
+    }
+
+    for (chunk = arena->chunks; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        EUCA_FREE(chunk);
+    }
+    arena->chunks = NULL;
+    arena->used = 0;
+    arena->size = 0;
+}
+
+/**
+ * Adds a chunk that can hold at least the given number of bytes in front of the
+ * chunk list of an arena. Chunks double in size up to EUCA_ARENA_MAX_CHUNK, so the
+ * number of chunks stays logarithmic in the size of the arena.
+ *
+ * @param arena [in] pointer to the arena
+ * @param bytes [in] number of bytes the new chunk must be able to hold
+ *
+ * @return a pointer to the new chunk or NULL if any failure occurred
+ */
+static euca_arena_chunk *euca_arena_add_chunk(euca_arena *arena, size_t bytes) {
+    size_t size = 0;
+    euca_arena_chunk *chunk = NULL;
+
+    size = ((arena->chunks) ? (2 * arena->chunks->size) : EUCA_ARENA_MIN_CHUNK);
+    if (size > EUCA_ARENA_MAX_CHUNK) {
+        size = EUCA_ARENA_MAX_CHUNK;
+    }
+    if (size < bytes) {
+        size = bytes;
+    }
+    if (size > (SIZE_MAX - EUCA_ARENA_HEADER)) {
+        return (NULL);
+    }
+
+    if ((chunk = EUCA_ALLOC(1, (EUCA_ARENA_HEADER + size))) == NULL) {
+        LOGERROR("out of memory (failed to add a chunk of %zu bytes to arena)\n", size);
+        return (NULL);
+    }
+    chunk->next = arena->chunks;
+    chunk->size = size;
+    chunk->used = 0;
+    arena->chunks = chunk;
+    arena->size += size;
+    return (chunk);
+}
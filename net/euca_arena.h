@@ -0,0 +1,79 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+#ifndef _INCLUDE_EUCA_ARENA_H_
+#define _INCLUDE_EUCA_ARENA_H_
+
+//!
+//! @file net/euca_arena.h
+//! Region allocator for object graphs that are built, used and thrown away as a
+//! whole, such as the global network information.
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  INCLUDES                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#include <stddef.h>
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  DEFINES                                   |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#define EUCA_ARENA_ALIGN                         16     //!< Alignment of every allocation
+#define EUCA_ARENA_MIN_CHUNK              (64 * 1024)   //!< Size of the first chunk of an arena
+#define EUCA_ARENA_MAX_CHUNK        (16 * 1024 * 1024)  //!< Chunks stop doubling past this size (larger requests get a chunk of their own)
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                 STRUCTURES                                 |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! Block of memory allocations are carved from
+typedef struct euca_arena_chunk_t {
+    struct euca_arena_chunk_t *next;   //!< Previously filled chunk
+    size_t size;                       //!< Number of bytes available in the chunk
+    size_t used;                       //!< Number of bytes handed out from the chunk
+} euca_arena_chunk;
+
+//! List of chunks released together. A zeroed structure is a valid empty arena.
+typedef struct euca_arena_t {
+    euca_arena_chunk *chunks;          //!< Chunk being filled, followed by the ones filled before it
+    size_t used;                       //!< Number of bytes handed out since the last reset
+    size_t size;                       //!< Number of bytes held in all chunks
+} euca_arena;
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                             EXPORTED PROTOTYPES                            |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+void *euca_arena_alloc(euca_arena *arena, size_t nmemb, size_t size);
+void *euca_arena_realloc(euca_arena *arena, void *ptr, size_t oldnmemb, size_t nmemb, size_t size);
+char *euca_arena_strdup(euca_arena *arena, const char *str);
+void euca_arena_reset(euca_arena *arena);
+void euca_arena_free(euca_arena *arena);
+
+#endif /* ! _INCLUDE_EUCA_ARENA_H_ */
@@ -41,6 +41,7 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <ifaddrs.h>
+#include <libxml/xmlreader.h>
 
 #include <eucalyptus.h>
 #include <misc.h>
@@ -55,6 +56,7 @@
 #include "dev_handler.h"
 #include "euca_gni.h"
 #include "eucanetd_util.h"
+#include "euca_strindex.h"
 
 /*----------------------------------------------------------------------------*\
  |                                                                            |
@@ -80,6 +82,23 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+//! State of the streaming GNI parser
+typedef struct gni_reader_t {
+    globalNetworkInfo *gni;            //!< GNI being populated
+    int cap_instances;                 //!< Number of entries allocated in gni->instances
+    int cap_ifs;                       //!< Number of entries allocated in gni->ifs
+    int cap_secgroups;                 //!< Number of entries allocated in gni->secgroups
+    int cap_vpcs;                      //!< Number of entries allocated in gni->vpcs
+    int cap_vpcIgws;                   //!< Number of entries allocated in gni->vpcIgws
+    int cap_dhcpos;                    //!< Number of entries allocated in gni->dhcpos
+} gni_reader;
+
+//! Parses one element of a top level section of the GNI document
+typedef int (*gni_reader_fn) (gni_reader *reader, xmlNodePtr node);
+
+//! Returns the GNI_DIFF_CHANGE_* properties that differ between two versions of an object
+typedef u32(*gni_diff_cmp_fn) (void *before, void *after);
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                             EXTERNAL VARIABLES                             |
@@ -105,6 +124,33 @@
  |                              STATIC PROTOTYPES                             |
  |                                                                            |
 \*----------------------------------------------------------------------------*/
+
+static int gni_populate_finalize(int mode, globalNetworkInfo *gni, struct timeval *ttv);
+static int gni_populate_reader(int mode, globalNetworkInfo *gni, const char *xmlpath);
+static void gni_populate_vpc_interfaces(globalNetworkInfo *gni);
+
+static const char *gni_instance_key(const void *base, int idx);
+static const char *gni_ifname_key(const void *base, int idx);
+static const char *gni_secgroup_key(const void *base, int idx);
+static const char *gni_vpc_key(const void *base, int idx);
+static const char *gni_vpcsubnet_key(const void *base, int idx);
+static const char *gni_dhcpos_key(const void *base, int idx);
+static int gni_index_lookup(euca_strindex *index, const char *name, int *startidx, euca_strindex_key_fn keyof, const void *base, int nmemb);
+static void gni_index_build(globalNetworkInfo *gni);
+static void gni_index_clear(globalNetworkInfo *gni);
+
+static const char *gni_igw_key(const void *base, int idx);
+static const char *gni_diff_entry_key(const void *base, int idx);
+static u32 gni_diff_instance(void *before, void *after);
+static u32 gni_diff_members(gni_instance **before, int max_before, gni_instance **after, int max_after);
+static u32 gni_diff_secgroup(void *before, void *after);
+static u32 gni_diff_vpc(void *before, void *after);
+static u32 gni_diff_igw(void *before, void *after);
+static u32 gni_diff_dhcpos(void *before, void *after);
+static void gni_diff_add(gni_diff_set *set, const char *name, void *before, void *after, u32 changes);
+static void gni_diff_set_build(gni_diff_set *set, euca_strindex_key_fn keyof, size_t size, gni_diff_cmp_fn cmpfn, void *beforebase, int max_before,
+                               euca_strindex *beforeindex, void *afterbase, int max_after, euca_strindex *afterindex);
+
 #define TCP_PROTOCOL_NUMBER 6
 #define UDP_PROTOCOL_NUMBER 17
 #define ICMP_PROTOCOL_NUMBER 1
@@ -406,6 +452,253 @@ int gni_vpcsubnet_get_interfaces(globalNetworkInfo *gni, gni_vpcsubnet *vpcsubne
     return (0);
 }
 
+/**
+ * Builds the interface lists of all VPCs and VPC subnets in a single pass over the
+ * interfaces. Interfaces keep the order they have in gni->ifs, as they would with
+ * gni_vpc_get_interfaces() and gni_vpcsubnet_get_interfaces(). The index of the
+ * interfaces of each subnet is rebuilt as well.
+ *
+ * @param gni [in] a pointer to the global network information structure
+ *
+ * @pre
+ *     gni->vpc_index is built and the VPC interface lists are empty.
+ */
+static void gni_populate_vpc_interfaces(globalNetworkInfo *gni) {
+    int i = 0;
+    int j = 0;
+    int idx = 0;
+    int *vpcof = NULL;
+    int *subnetof = NULL;
+    gni_vpc *vpc = NULL;
+    gni_vpcsubnet *gnisubnet = NULL;
+    euca_strindex subnet_index = { 0 };
+
+    if (!gni || (gni->max_vpcs == 0)) {
+        return;
+    }
+
+    // Find the VPC of each interface and size the VPC lists
+    vpcof = EUCA_ZALLOC_C(gni->max_ifs + 1, sizeof (int));
+    for (i = 0; i < gni->max_ifs; i++) {
+        vpcof[i] = gni_index_lookup(&(gni->vpc_index), gni->ifs[i]->vpc, NULL, gni_vpc_key, gni->vpcs, gni->max_vpcs);
+        if (vpcof[i] >= 0) {
+            gni->vpcs[vpcof[i]].max_interfaces++;
+        }
+    }
+    for (i = 0; i < gni->max_vpcs; i++) {
+        vpc = &(gni->vpcs[i]);
+        if (vpc->max_interfaces) {
+            vpc->interfaces = EUCA_ZALLOC_C(vpc->max_interfaces, sizeof (gni_instance *));
+        }
+        vpc->max_interfaces = 0;
+    }
+    for (i = 0; i < gni->max_ifs; i++) {
+        if (vpcof[i] >= 0) {
+            vpc = &(gni->vpcs[vpcof[i]]);
+            vpc->interfaces[vpc->max_interfaces++] = gni->ifs[i];
+        }
+    }
+    EUCA_FREE(vpcof);
+
+    // Same thing for the subnets, from the interfaces of their VPC
+    for (i = 0; i < gni->max_vpcs; i++) {
+        vpc = &(gni->vpcs[i]);
+        if (vpc->max_subnets == 0) {
+            continue;
+        }
+        euca_strindex_rebuild(&subnet_index, vpc->max_subnets, gni_vpcsubnet_key, vpc->subnets);
+        subnetof = EUCA_ZALLOC_C(vpc->max_interfaces + 1, sizeof (int));
+        for (j = 0; j < vpc->max_interfaces; j++) {
+            subnetof[j] = euca_strindex_find(&subnet_index, vpc->interfaces[j]->subnet, gni_vpcsubnet_key, vpc->subnets);
+            if (subnetof[j] >= 0) {
+                vpc->subnets[subnetof[j]].max_interfaces++;
+            }
+        }
+        for (j = 0; j < vpc->max_subnets; j++) {
+            gnisubnet = &(vpc->subnets[j]);
+            if (gnisubnet->max_interfaces) {
+                gnisubnet->interfaces = EUCA_ZALLOC_C(gnisubnet->max_interfaces, sizeof (gni_instance *));
+            }
+            gnisubnet->max_interfaces = 0;
+        }
+        for (j = 0; j < vpc->max_interfaces; j++) {
+            if ((idx = subnetof[j]) >= 0) {
+                gnisubnet = &(vpc->subnets[idx]);
+                gnisubnet->interfaces[gnisubnet->max_interfaces++] = vpc->interfaces[j];
+            }
+        }
+        EUCA_FREE(subnetof);
+
+        for (j = 0; j < vpc->max_subnets; j++) {
+            gnisubnet = &(vpc->subnets[j]);
+            euca_strindex_rebuild(&(gnisubnet->interface_index), gnisubnet->max_interfaces, gni_instance_key, gnisubnet->interfaces);
+        }
+    }
+    euca_strindex_clear(&subnet_index);
+}
+
+/**
+ * Returns the name of the instance (or interface) at position idx of an array of
+ * gni_instance pointers. Used as key function of the instance and interface indexes.
+ *
+ * @param base [in] array of gni_instance pointers
+ * @param idx [in] position of the element in the array
+ *
+ * @return the name of the element
+ */
+static const char *gni_instance_key(const void *base, int idx) {
+    return (((gni_instance * const *)base)[idx]->name);
+}
+
+/**
+ * Returns the interface ID of the interface at position idx of an array of
+ * gni_instance pointers.
+ *
+ * @param base [in] array of gni_instance pointers
+ * @param idx [in] position of the element in the array
+ *
+ * @return the interface ID of the element
+ */
+static const char *gni_ifname_key(const void *base, int idx) {
+    return (((gni_instance * const *)base)[idx]->ifname);
+}
+
+/**
+ * Returns the name of the security group at position idx of an array of gni_secgroup.
+ *
+ * @param base [in] array of gni_secgroup
+ * @param idx [in] position of the element in the array
+ *
+ * @return the name of the element
+ */
+static const char *gni_secgroup_key(const void *base, int idx) {
+    return (((const gni_secgroup *)base)[idx].name);
+}
+
+/**
+ * Returns the name of the VPC at position idx of an array of gni_vpc.
+ *
+ * @param base [in] array of gni_vpc
+ * @param idx [in] position of the element in the array
+ *
+ * @return the name of the element
+ */
+static const char *gni_vpc_key(const void *base, int idx) {
+    return (((const gni_vpc *)base)[idx].name);
+}
+
+/**
+ * Returns the name of the VPC subnet at position idx of an array of gni_vpcsubnet.
+ *
+ * @param base [in] array of gni_vpcsubnet
+ * @param idx [in] position of the element in the array
+ *
+ * @return the name of the element
+ */
+static const char *gni_vpcsubnet_key(const void *base, int idx) {
+    return (((const gni_vpcsubnet *)base)[idx].name);
+}
+
+/**
+ * Returns the name of the DHCP option set at position idx of an array of gni_dhcp_os.
+ *
+ * @param base [in] array of gni_dhcp_os
+ * @param idx [in] position of the element in the array
+ *
+ * @return the name of the element
+ */
+static const char *gni_dhcpos_key(const void *base, int idx) {
+    return (((const gni_dhcp_os *)base)[idx].name);
+}
+
+/**
+ * Looks up a name in one of the GNI indexes. The semantics are the ones of the
+ * gni_get_xxx() helpers: the search starts at position *startidx (if not NULL),
+ * which is updated past the match. Indexes that have not been built (GNI filled
+ * by hand) are searched linearly.
+ *
+ * @param index [in] pointer to the index of the array
+ * @param name [in] name of interest
+ * @param startidx [i/o] position where to start the search. Can be NULL.
+ * @param keyof [in] key function of the index
+ * @param base [in] the indexed array
+ * @param nmemb [in] number of elements in the array
+ *
+ * @return the position of the first element named name at or after the start
+ *         position, or -1 if there is none
+ */
+static int gni_index_lookup(euca_strindex *index, const char *name, int *startidx, euca_strindex_key_fn keyof, const void *base, int nmemb) {
+    int i = 0;
+    int start = 0;
+    int idx = -1;
+
+    if (!name) {
+        return (-1);
+    }
+    if (startidx) {
+        start = *startidx;
+    }
+
+    if (index->size > 0) {
+        if ((idx = euca_strindex_find(index, name, keyof, base)) < 0) {
+            return (-1);
+        }
+    }
+    if ((idx < 0) || (idx < start)) {
+        // No index, or the first entry with that name is before the start position
+        for (i = start, idx = -1; (i < nmemb) && (idx < 0); i++) {
+            if (!strcmp(name, keyof(base, i))) {
+                idx = i;
+            }
+        }
+    }
+
+    if ((idx >= 0) && startidx) {
+        *startidx = idx + 1;
+    }
+    return (idx);
+}
+
+/**
+ * Builds the name indexes of the instances, interfaces, security groups, VPCs and
+ * DHCP option sets of a populated GNI.
+ *
+ * @param gni [in] a pointer to the global network information structure
+ */
+static void gni_index_build(globalNetworkInfo *gni) {
+    if (!gni) {
+        return;
+    }
+    euca_strindex_rebuild(&(gni->instance_index), gni->max_instances, gni_instance_key, gni->instances);
+    euca_strindex_rebuild(&(gni->if_index), gni->max_ifs, gni_instance_key, gni->ifs);
+    euca_strindex_rebuild(&(gni->ifname_index), gni->max_ifs, gni_ifname_key, gni->ifs);
+    euca_strindex_rebuild(&(gni->secgroup_index), gni->max_secgroups, gni_secgroup_key, gni->secgroups);
+    euca_strindex_rebuild(&(gni->vpc_index), gni->max_vpcs, gni_vpc_key, gni->vpcs);
+    euca_strindex_rebuild(&(gni->dhcpos_index), gni->max_dhcpos, gni_dhcpos_key, gni->dhcpos);
+}
+
+/**
+ * Releases the name indexes of a GNI, including the ones of the VPC subnets.
+ *
+ * @param gni [in] a pointer to the global network information structure
+ */
+static void gni_index_clear(globalNetworkInfo *gni) {
+    if (!gni) {
+        return;
+    }
+    euca_strindex_clear(&(gni->instance_index));
+    euca_strindex_clear(&(gni->if_index));
+    euca_strindex_clear(&(gni->ifname_index));
+    euca_strindex_clear(&(gni->secgroup_index));
+    euca_strindex_clear(&(gni->vpc_index));
+    euca_strindex_clear(&(gni->dhcpos_index));
+    for (int i = 0; i < gni->max_vpcs; i++) {
+        for (int j = 0; j < gni->vpcs[i].max_subnets; j++) {
+            euca_strindex_clear(&(gni->vpcs[i].subnets[j].interface_index));
+        }
+    }
+}
+
 /**
  * Looks up for the cluster for which we are assigned within a configured cluster list. We can
  * be the cluster itself or one of its node.
@@ -472,12 +765,10 @@ int gni_find_secgroup(globalNetworkInfo *gni, const char *psGroupId, gni_secgrou
     // Initialize to NULL
     (*pSecGroup) = NULL;
 
-    // Go through our security group list and look for that group
-    for (i = 0; i < gni->max_secgroups; i++) {
-        if (!strcmp(psGroupId, gni->secgroups[i].name)) {
-            (*pSecGroup) = &(gni->secgroups[i]);
-            return (0);
-        }
+    // Look that group up in our security group index
+    if ((i = gni_index_lookup(&(gni->secgroup_index), psGroupId, NULL, gni_secgroup_key, gni->secgroups, gni->max_secgroups)) >= 0) {
+        (*pSecGroup) = &(gni->secgroups[i]);
+        return (0);
     }
     return (1);
 }
@@ -499,22 +790,10 @@ int gni_find_instance(globalNetworkInfo *gni, const char *psInstanceId, gni_inst
 
     LOGTRACE("attempting search for instance id %s in gni\n", psInstanceId);
 
-    // binary search - instances should be already sorted in GNI (uncomment below if not sorted)
-/*
-    if (gni->sorted_instances == FALSE) {
-        qsort(gni->instances, gni->max_instances,
-                sizeof (gni_instance *), compare_gni_instance_name);
-        gni->sorted_instances = TRUE;
-    }
-*/
-    gni_instance inst;
-    snprintf(inst.name, INTERFACE_ID_LEN, "%s", psInstanceId);
-    gni_instance *pinst = &inst;
-    gni_instance **res = (gni_instance **) bsearch(&pinst,
-            gni->instances, gni->max_instances,
-            sizeof (gni_instance *), compare_gni_instance_name);
-    if (res) {
-        *pInstance = *res;
+    // hash lookup - does not depend on the order of the instances in GNI
+    int idx = gni_index_lookup(&(gni->instance_index), psInstanceId, NULL, gni_instance_key, gni->instances, gni->max_instances);
+    if (idx >= 0) {
+        *pInstance = gni->instances[idx];
         return (0);
     }
 
@@ -538,19 +817,13 @@ int gni_find_interface(globalNetworkInfo *gni, const char *psInstanceId, gni_ins
 
     LOGTRACE("attempting search for interface id %s in gni\n", psInstanceId);
 
-    if (gni->sorted_ifs == FALSE) {
-        qsort(gni->ifs, gni->max_ifs,
-                sizeof (gni_instance *), compare_gni_interface_name);
-        gni->sorted_ifs = TRUE;
-    }
-    gni_instance inst;
-    snprintf(inst.name, INTERFACE_ID_LEN, "%s", psInstanceId);
-    gni_instance *pinst = &inst;
-    gni_instance **res = (gni_instance **) bsearch(&pinst,
-            gni->ifs, gni->max_ifs,
-            sizeof (gni_instance *), compare_gni_interface_name);
-    if (res) {
-        *pInstance = *res;
+    // interfaces match either their ID (eni-xxx) or, for primary ones, the instance ID
+    int idx = gni_index_lookup(&(gni->ifname_index), psInstanceId, NULL, gni_ifname_key, gni->ifs, gni->max_ifs);
+    if (idx < 0) {
+        idx = gni_index_lookup(&(gni->if_index), psInstanceId, NULL, gni_instance_key, gni->ifs, gni->max_ifs);
+    }
+    if (idx >= 0) {
+        *pInstance = gni->ifs[idx];
         return (0);
     }
 
@@ -2022,7 +2295,8 @@ int gni_populate(globalNetworkInfo *gni, gni_hostname_info *host_info, char *xml
 }
 
 /**
- * Populates a given globalNetworkInfo structure from the content of an XML file
+ * Populates a given globalNetworkInfo structure from the content of an XML file. The
+ * file is read in a single streaming pass (see gni_populate_reader()).
  * @param mode [in] mode what to populate GNI_POPULATE_ALL || GNI_POPULATE_CONFIG || GNI_POPULATE_NONE
  * @param gni [in] a pointer to the global network information structure
  * @param host_info [in] a pointer to the hostname info data structure (only relevant to VPCMIDO - to be deprecated)
@@ -2030,7 +2304,44 @@ int gni_populate(globalNetworkInfo *gni, gni_hostname_info *host_info, char *xml
  * @return 0 on success or 1 on failure
  */
 int gni_populate_v(int mode, globalNetworkInfo *gni, gni_hostname_info *host_info, char *xmlpath) {
-    int rc = 0;
+    struct timeval tv, ttv;
+
+    if (mode == GNI_POPULATE_NONE) {
+        return (0);
+    }
+
+    eucanetd_timer_usec(&ttv);
+    eucanetd_timer_usec(&tv);
+    if (!gni) {
+        LOGERROR("invalid input\n");
+        return (1);
+    }
+
+    gni_clear(gni);
+    LOGTRACE("gni cleared in %ld us.\n", eucanetd_timer_usec(&tv));
+
+    XML_INIT();
+    LIBXML_TEST_VERSION
+    if (gni_populate_reader(mode, gni, xmlpath)) {
+        return (1);
+    }
+    LOGTRACE("gni read in %ld us (%zu bytes in arena).\n", eucanetd_timer_usec(&tv), gni->arena.used);
+
+    return (gni_populate_finalize(mode, gni, &ttv));
+}
+
+#ifdef _UNIT_TEST
+/**
+ * Populates a given globalNetworkInfo structure from the content of an XML file, using
+ * XPath queries over the complete document. Produces the same result as gni_populate_v(),
+ * only slower; only built into the unit test, where it checks the streaming parser.
+ * @param mode [in] mode what to populate GNI_POPULATE_ALL || GNI_POPULATE_CONFIG || GNI_POPULATE_NONE
+ * @param gni [in] a pointer to the global network information structure
+ * @param host_info [in] a pointer to the hostname info data structure (only relevant to VPCMIDO - to be deprecated)
+ * @param xmlpath [in] path to the XML file to be used to populate
+ * @return 0 on success or 1 on failure
+ */
+int gni_populate_xpath(int mode, globalNetworkInfo *gni, gni_hostname_info *host_info, char *xmlpath) {
     xmlDocPtr docptr;
     xmlXPathContextPtr ctxptr;
     struct timeval tv, ttv;
@@ -2067,59 +2378,70 @@ int gni_populate_v(int mode, globalNetworkInfo *gni, gni_hostname_info *host_inf
     LOGTRACE("xml Xpath context - %ld us.\n", eucanetd_timer_usec(&tv));
 
     eucanetd_timer_usec(&tv);
-    rc = gni_populate_xpathnodes(docptr, gni_nodes);
+    gni_populate_xpathnodes(docptr, gni_nodes);
 
     LOGTRACE("begin parsing XML into data structures\n");
 
     // GNI version
-    rc = gni_populate_gnidata(gni, gni_nodes[GNI_XPATH_CONFIGURATION], ctxptr, docptr);
+    gni_populate_gnidata(gni, gni_nodes[GNI_XPATH_CONFIGURATION], ctxptr, docptr);
     LOGTRACE("gni version populated in %ld us.\n", eucanetd_timer_usec(&tv));
 
     if (mode == GNI_POPULATE_ALL) {
         // Instances
-        rc = gni_populate_instances(gni, gni_nodes[GNI_XPATH_INSTANCES], ctxptr, docptr);
+        gni_populate_instances(gni, gni_nodes[GNI_XPATH_INSTANCES], ctxptr, docptr);
         LOGTRACE("gni instances populated in %ld us.\n", eucanetd_timer_usec(&tv));
 
         // Security Groups
-        rc = gni_populate_sgs(gni, gni_nodes[GNI_XPATH_SECURITYGROUPS], ctxptr, docptr);
+        gni_populate_sgs(gni, gni_nodes[GNI_XPATH_SECURITYGROUPS], ctxptr, docptr);
         LOGTRACE("gni sgs populated in %ld us.\n", eucanetd_timer_usec(&tv));
 
         // VPCs
-        rc = gni_populate_vpcs(gni, gni_nodes[GNI_XPATH_VPCS], ctxptr, docptr);
+        gni_populate_vpcs(gni, gni_nodes[GNI_XPATH_VPCS], ctxptr, docptr);
         LOGTRACE("gni vpcs populated in %ld us.\n", eucanetd_timer_usec(&tv));
         
         // Internet Gateways
-        rc = gni_populate_internetgateways(gni, gni_nodes[GNI_XPATH_INTERNETGATEWAYS], ctxptr, docptr);
+        gni_populate_internetgateways(gni, gni_nodes[GNI_XPATH_INTERNETGATEWAYS], ctxptr, docptr);
         LOGTRACE("gni Internet Gateways populated in %ld us.\n", eucanetd_timer_usec(&tv));
 
         // DHCP Option Sets
-        rc = gni_populate_dhcpos(gni, gni_nodes[GNI_XPATH_DHCPOPTIONSETS], ctxptr, docptr);
+        gni_populate_dhcpos(gni, gni_nodes[GNI_XPATH_DHCPOPTIONSETS], ctxptr, docptr);
         LOGTRACE("gni DHCP Option Sets populated in %ld us.\n", eucanetd_timer_usec(&tv));
     }
 
     // Configuration
-    rc = gni_populate_configuration(gni, host_info, gni_nodes[GNI_XPATH_CONFIGURATION], ctxptr, docptr);
+    gni_populate_configuration(gni, host_info, gni_nodes[GNI_XPATH_CONFIGURATION], ctxptr, docptr);
     LOGTRACE("gni configuration populated in %ld us.\n", eucanetd_timer_usec(&tv));
 
     xmlXPathFreeContext(ctxptr);
     xmlFreeDoc(docptr);
 
+    return (gni_populate_finalize(mode, gni, &ttv));
+}
+#endif /* _UNIT_TEST */
+
+/**
+ * Completes the population of a GNI once the XML content has been read: resolves the
+ * VPC and subnet interfaces, DHCP option sets and network ACLs, and validates the result.
+ * @param mode [in] mode what was populated GNI_POPULATE_ALL || GNI_POPULATE_CONFIG
+ * @param gni [in] a pointer to the global network information structure
+ * @param ttv [in] time at which the population started
+ * @return 0 on success or 1 on failure
+ */
+static int gni_populate_finalize(int mode, globalNetworkInfo *gni, struct timeval *ttv) {
+    int rc = 0;
+    struct timeval tv;
+
+    // Index everything that is looked up by name
+    gni_index_build(gni);
+
     if (mode == GNI_POPULATE_ALL) {
         // Find VPC and subnet interfaces
+        gni_populate_vpc_interfaces(gni);
         for (int i = 0; i < gni->max_vpcs; i++) {
             gni_vpc *vpc = &(gni->vpcs[i]);
-            rc = gni_vpc_get_interfaces(gni, vpc, &(vpc->interfaces), &(vpc->max_interfaces));
-            if (rc) {
-                LOGWARN("Failed to populate gni %s interfaces.\n", vpc->name);
-            }
             vpc->dhcpOptionSet = gni_get_dhcpos(gni, vpc->dhcpOptionSet_name, NULL);
             for (int j = 0; j < vpc->max_subnets; j++) {
                 gni_vpcsubnet *gnisubnet = &(vpc->subnets[j]);
-                rc = gni_vpcsubnet_get_interfaces(gni, gnisubnet, vpc->interfaces, vpc->max_interfaces,
-                        &(gnisubnet->interfaces), &(gnisubnet->max_interfaces));
-                if (rc) {
-                    LOGWARN("Failed to populate gni %s interfaces.\n", gnisubnet->name);
-                }
                 gnisubnet->networkAcl = gni_get_networkacl(vpc, gnisubnet->networkAcl_name, NULL);
             }
         }
@@ -2134,7 +2456,7 @@ int gni_populate_v(int mode, globalNetworkInfo *gni, gni_hostname_info *host_inf
     }
     LOGDEBUG("gni validated in %ld us.\n", eucanetd_timer_usec(&tv));
 
-    LOGDEBUG("gni populated in %.2f ms.\n", eucanetd_timer_usec(&ttv) / 1000.0);
+    LOGDEBUG("gni populated in %.2f ms.\n", eucanetd_timer_usec(ttv) / 1000.0);
 
 /*
     for (int i = 0; i < gni->max_instances; i++) {
@@ -4072,7 +4394,7 @@ int gni_populate_dhcpos(globalNetworkInfo *gni, xmlNodePtr xmlnode, xmlXPathCont
                 gdh->netbios_ns[i] = dot2hex(results[i]);
                 EUCA_FREE(results[i]);
             }
-            gdh->max_ntp = max_results;
+            gdh->max_netbios_ns = max_results;
             EUCA_FREE(results);
 
             snprintf(expression, 2048, "./property[@name='netbios-node-type']/value");
@@ -4091,80 +4413,1382 @@ int gni_populate_dhcpos(globalNetworkInfo *gni, xmlNodePtr xmlnode, xmlXPathCont
     return (0);
 }
 
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                         STREAMING GNI XML PARSER                           |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
 /**
- * Parses a list of IP address ranges (start - end) and converts into a linear
- * array.
- * @param inlist [in] list of IP address ranges of interest
- * @param inmax [in] number of entries in the list
- * @param outlist [out] list of IP addresses converted from the input list
- * @param outmax [out] number of entries in the list of IP addresses
- * @return  0 on success. 1 on failure.
+ * Returns the text content of an XML element, as evaluate_xpath_property() sees it.
+ * @param node [in] xml element of interest
+ * @return the text of the first child of node, or NULL if there is none
  */
-int gni_serialize_iprange_list(char **inlist, int inmax, u32 **outlist, int *outmax) {
-    int i = 0;
-    int ret = 0;
-    int outidx = 0;
-    u32 *outlistbuf = NULL;
-    int max_outlistbuf = 0;
+static const char *gni_xml_text(xmlNodePtr node) {
+    if (node && node->children && node->children->content) {
+        return ((const char *) node->children->content);
+    }
+    return (NULL);
+}
 
-    if (!inlist || inmax < 0 || !outlist || !outmax) {
-        LOGERROR("invalid input\n");
-        return (1);
+/**
+ * Returns the value of an attribute of an XML element.
+ * @param node [in] xml element of interest
+ * @param name [in] name of the attribute
+ * @return the value of the first attribute named name, or NULL if there is none
+ */
+static const char *gni_xml_attr(xmlNodePtr node, const char *name) {
+    for (xmlAttr *prop = node->properties; prop != NULL; prop = prop->next) {
+        if (!strcmp((char *) prop->name, name)) {
+            return ((prop->children) ? ((const char *) prop->children->content) : NULL);
+        }
     }
-    *outlist = NULL;
-    *outmax = 0;
+    return (NULL);
+}
 
-    for (i = 0; i < inmax; i++) {
-        char *range = NULL;
-        char *tok = NULL;
-        char *start = NULL;
-        char *end = NULL;
-        int numi = 0;
+/**
+ * Tells whether an XML node is an element with the given name and, optionally, with
+ * the given name attribute (i.e., matches the XPath step name[@name='propname']).
+ * @param node [in] xml node of interest
+ * @param name [in] element name to match
+ * @param propname [in] value of the name attribute to match (NULL to match any)
+ * @return TRUE if node matches, FALSE otherwise
+ */
+static boolean gni_xml_match(xmlNodePtr node, const char *name, const char *propname) {
+    const char *attr = NULL;
 
-        LOGTRACE("parsing input range: %s\n", inlist[i]);
+    if ((node->type != XML_ELEMENT_NODE) || strcmp((const char *) node->name, name)) {
+        return (FALSE);
+    }
+    if (propname) {
+        attr = gni_xml_attr(node, "name");
+        return ((attr && !strcmp(attr, propname)) ? TRUE : FALSE);
+    }
+    return (TRUE);
+}
 
-        range = strdup(inlist[i]);
-        tok = strchr(range, '-');
-        if (tok) {
-            *tok = '\0';
-            tok++;
-            if (strlen(tok)) {
-                start = strdup(range);
-                end = strdup(tok);
-            } else {
-                LOGERROR("empty end range from input '%s': check network config\n", inlist[i]);
-                start = NULL;
-                end = NULL;
+/**
+ * Selects, in document order, the elements matching the relative path
+ * outer[@name='propname']/inner under parent, the way evaluate_xpath_nodeset()
+ * (textonly FALSE) or evaluate_xpath_property() (textonly TRUE) would.
+ * @param parent [in] xml element where the search starts
+ * @param outer [in] name of the child elements of parent
+ * @param propname [in] value of the name attribute of the outer elements (NULL to match any)
+ * @param inner [in] name of the child elements of the outer elements (NULL to select the outer elements)
+ * @param textonly [in] set to only select elements that have some text content
+ * @param out [out] selected elements (only counted if NULL)
+ * @return the number of elements selected
+ */
+static int gni_xml_select(xmlNodePtr parent, const char *outer, const char *propname, const char *inner, boolean textonly, xmlNodePtr *out) {
+    int count = 0;
+    xmlNodePtr node = NULL;
+    xmlNodePtr child = NULL;
+
+    for (node = parent->children; node != NULL; node = node->next) {
+        if (!gni_xml_match(node, outer, propname)) {
+            continue;
+        }
+        if (!inner) {
+            if (!textonly || gni_xml_text(node)) {
+                if (out) {
+                    out[count] = node;
+                }
+                count++;
             }
-        } else {
-            start = strdup(range);
-            end = strdup(range);
+            continue;
         }
-        EUCA_FREE(range);
-
-        if (start && end) {
-            uint32_t startb, endb, idxb, localhost;
-
-            LOGTRACE("start=%s end=%s\n", start, end);
-            localhost = dot2hex("127.0.0.1");
-            startb = dot2hex(start);
-            endb = dot2hex(end);
-            if ((startb <= endb) && (startb != localhost) && (endb != localhost)) {
-                numi = (int) (endb - startb) + 1;
-                outlistbuf = EUCA_REALLOC_C(outlistbuf, (max_outlistbuf + numi), sizeof (u32));
-                outidx = max_outlistbuf;
-                max_outlistbuf += numi;
-                for (idxb = startb; idxb <= endb; idxb++) {
-                    outlistbuf[outidx] = idxb;
-                    outidx++;
+        for (child = node->children; child != NULL; child = child->next) {
+            if (gni_xml_match(child, inner, NULL) && (!textonly || gni_xml_text(child))) {
+                if (out) {
+                    out[count] = child;
                 }
-            } else {
-                LOGERROR("end range '%s' is smaller than start range '%s' from input '%s': check network config\n", end, start, inlist[i]);
-                ret = 1;
+                count++;
             }
-        } else {
-            LOGERROR("couldn't parse range from input '%s': check network config\n", inlist[i]);
-            ret = 1;
+        }
+    }
+    return (count);
+}
+
+/**
+ * Allocates and fills the list of elements matching outer[@name='propname']/inner
+ * under parent. See gni_xml_select().
+ * @param parent [in] xml element where the search starts
+ * @param outer [in] name of the child elements of parent
+ * @param propname [in] value of the name attribute of the outer elements (NULL to match any)
+ * @param inner [in] name of the child elements of the outer elements (NULL to select the outer elements)
+ * @param textonly [in] set to only select elements that have some text content
+ * @param count [out] number of elements selected
+ * @return the list of elements, to be freed by the caller, or NULL if nothing matched
+ */
+static xmlNodePtr *gni_xml_nodes(xmlNodePtr parent, const char *outer, const char *propname, const char *inner, boolean textonly, int *count) {
+    xmlNodePtr *nodes = NULL;
+
+    *count = gni_xml_select(parent, outer, propname, inner, textonly, NULL);
+    if (*count > 0) {
+        nodes = EUCA_ZALLOC_C(*count, sizeof (xmlNodePtr));
+        gni_xml_select(parent, outer, propname, inner, textonly, nodes);
+    }
+    return (nodes);
+}
+
+/**
+ * Returns the text of the last element matching outer[@name='propname']/inner under
+ * parent. When a property appears more than once, the XPath parser assigns every
+ * value in turn, so the last one is what ends up in the GNI.
+ * @param parent [in] xml element where the search starts
+ * @param outer [in] name of the child elements of parent
+ * @param propname [in] value of the name attribute of the outer elements (NULL to match any)
+ * @param inner [in] name of the child elements of the outer elements (NULL to select the outer elements)
+ * @return the text of the last matching element, or NULL if nothing matched
+ */
+static const char *gni_xml_value(xmlNodePtr parent, const char *outer, const char *propname, const char *inner) {
+    const char *value = NULL;
+    xmlNodePtr node = NULL;
+    xmlNodePtr child = NULL;
+
+    for (node = parent->children; node != NULL; node = node->next) {
+        if (!gni_xml_match(node, outer, propname)) {
+            continue;
+        }
+        if (!inner) {
+            value = (gni_xml_text(node) ? gni_xml_text(node) : value);
+            continue;
+        }
+        for (child = node->children; child != NULL; child = child->next) {
+            if (gni_xml_match(child, inner, NULL) && gni_xml_text(child)) {
+                value = gni_xml_text(child);
+            }
+        }
+    }
+    return (value);
+}
+
+/**
+ * Allocates zeroed memory from the arena of a GNI. Like EUCA_ZALLOC_C(), running out
+ * of memory is fatal.
+ * @param gni [in] a pointer to the global network information structure
+ * @param nmemb [in] number of elements
+ * @param size [in] size of an element
+ * @return a pointer to the allocated memory, valid until the GNI is cleared
+ */
+static void *gni_zalloc(globalNetworkInfo *gni, size_t nmemb, size_t size) {
+    void *ret = euca_arena_alloc(&(gni->arena), nmemb, size);
+    if (ret == NULL) {
+        LOGFATAL("out of memory - gni alloc nmemb %zd, size %zd\n", nmemb, size);
+        LOGFATAL("Shutting down eucanetd.\n");
+        get_stack_trace();
+        exit(1);
+    }
+    return (ret);
+}
+
+/**
+ * Duplicates a string into the arena of a GNI. Running out of memory is fatal.
+ * @param gni [in] a pointer to the global network information structure
+ * @param str [in] the string to duplicate
+ * @return a pointer to the copy, valid until the GNI is cleared
+ */
+static char *gni_strdup(globalNetworkInfo *gni, const char *str) {
+    char *ret = gni_zalloc(gni, strlen(str) + 1, sizeof (char));
+    memcpy(ret, str, strlen(str));
+    return (ret);
+}
+
+/**
+ * Makes sure an array allocated from the arena of a GNI has room for at least needed
+ * entries, doubling its capacity as needed. New entries are zeroed.
+ * @param gni [in] a pointer to the global network information structure
+ * @param array [in] array to grow (may be NULL)
+ * @param capacity [i/o] number of entries allocated in array
+ * @param needed [in] number of entries needed
+ * @param size [in] size of an entry
+ * @return the (possibly moved) array
+ */
+static void *gni_reader_grow(globalNetworkInfo *gni, void *array, int *capacity, int needed, size_t size) {
+    int newcap = 0;
+
+    if (needed <= *capacity) {
+        return (array);
+    }
+    newcap = ((*capacity > 0) ? *capacity : 16);
+    while (newcap < needed) {
+        newcap *= 2;
+    }
+    if ((array = euca_arena_realloc(&(gni->arena), array, *capacity, newcap, size)) == NULL) {
+        LOGFATAL("out of memory - gni realloc nmemb %d, size %zd\n", newcap, size);
+        LOGFATAL("Shutting down eucanetd.\n");
+        get_stack_trace();
+        exit(1);
+    }
+    *capacity = newcap;
+    return (array);
+}
+
+/**
+ * Populates a security group rule from its XML element.
+ * @param rule [in] a pointer to the (clean) rule structure to populate
+ * @param node [in] the "rule" xml element
+ */
+static void gni_reader_rule(gni_rule *rule, xmlNodePtr node) {
+    const char *value = NULL;
+    char *scidrnetaddr = NULL;
+
+    if ((value = gni_xml_value(node, "protocol", NULL, NULL)) != NULL) {
+        rule->protocol = atoi(value);
+    }
+    if ((value = gni_xml_value(node, "groupId", NULL, NULL)) != NULL) {
+        snprintf(rule->groupId, SECURITY_GROUP_ID_LEN, "%s", value);
+    }
+    if ((value = gni_xml_value(node, "groupOwnerId", NULL, NULL)) != NULL) {
+        snprintf(rule->groupOwnerId, OWNER_ID_LEN, "%s", value);
+    }
+    if ((value = gni_xml_value(node, "cidr", NULL, NULL)) != NULL) {
+        snprintf(rule->cidr, NETWORK_ADDR_LEN, "%s", value);
+        cidrsplit(rule->cidr, &scidrnetaddr, &(rule->cidrSlashnet));
+        rule->cidrNetaddr = dot2hex(scidrnetaddr);
+        EUCA_FREE(scidrnetaddr);
+    }
+    if ((value = gni_xml_value(node, "fromPort", NULL, NULL)) != NULL) {
+        rule->fromPort = atoi(value);
+    }
+    if ((value = gni_xml_value(node, "toPort", NULL, NULL)) != NULL) {
+        rule->toPort = atoi(value);
+    }
+    if ((value = gni_xml_value(node, "icmpType", NULL, NULL)) != NULL) {
+        rule->icmpType = atoi(value);
+    }
+    if ((value = gni_xml_value(node, "icmpCode", NULL, NULL)) != NULL) {
+        rule->icmpCode = atoi(value);
+    }
+}
+
+/**
+ * Populates a list of security group rules from the rule elements found under
+ * the given path.
+ * @param gni [in] a pointer to the global network information structure
+ * @param node [in] the "securityGroup" xml element
+ * @param outer [in] name of the element holding the rules
+ * @param rules [out] list of rules
+ * @param max_rules [out] number of rules in the list
+ */
+static void gni_reader_rules(globalNetworkInfo *gni, xmlNodePtr node, const char *outer, gni_rule **rules, int *max_rules) {
+    int i = 0;
+    int count = 0;
+    xmlNodePtr *nodes = NULL;
+
+    nodes = gni_xml_nodes(node, outer, NULL, "rule", FALSE, &count);
+    if (count > 0) {
+        *rules = gni_zalloc(gni, count, sizeof (gni_rule));
+        *max_rules = count;
+    }
+    for (i = 0; i < count; i++) {
+        gni_reader_rule(&((*rules)[i]), nodes[i]);
+    }
+    EUCA_FREE(nodes);
+}
+
+/**
+ * Populates an instance or interface structure from its XML element. Equivalent to
+ * gni_populate_instance_interface().
+ * @param gni [in] a pointer to the global network information structure
+ * @param instance [in] a pointer to the (clean) instance structure to populate
+ * @param node [in] the "instance" or "networkInterface" xml element
+ */
+static void gni_reader_instance_interface(globalNetworkInfo *gni, gni_instance *instance, xmlNodePtr node) {
+    int i = 0;
+    int count = 0;
+    const char *value = NULL;
+    xmlNodePtr *nodes = NULL;
+
+    if ((value = gni_xml_attr(node, "name")) != NULL) {
+        snprintf(instance->name, INTERFACE_ID_LEN, "%s", value);
+    }
+    if (strlen(instance->name) == 0) {
+        LOGERROR("Invalid argument: invalid instance name.\n");
+    }
+
+    if ((value = gni_xml_value(node, "ownerId", NULL, NULL)) != NULL) {
+        snprintf(instance->accountId, OWNER_ID_LEN, "%s", value);
+    }
+    if ((value = gni_xml_value(node, "macAddress", NULL, NULL)) != NULL) {
+        mac2hex(value, instance->macAddress);
+    }
+    if ((value = gni_xml_value(node, "publicIp", NULL, NULL)) != NULL) {
+        instance->publicIp = dot2hex(value);
+    }
+    if ((value = gni_xml_value(node, "privateIp", NULL, NULL)) != NULL) {
+        instance->privateIp = dot2hex(value);
+    }
+    if ((value = gni_xml_value(node, "vpc", NULL, NULL)) != NULL) {
+        snprintf(instance->vpc, VPC_ID_LEN, "%s", value);
+    }
+    if ((value = gni_xml_value(node, "subnet", NULL, NULL)) != NULL) {
+        snprintf(instance->subnet, VPC_SUBNET_ID_LEN, "%s", value);
+    }
+
+    nodes = gni_xml_nodes(node, "securityGroups", NULL, "value", TRUE, &count);
+    instance->secgroup_names = gni_zalloc(gni, count, sizeof (gni_name_32));
+    instance->gnisgs = gni_zalloc(gni, count, sizeof (gni_secgroup *));
+    for (i = 0; i < count; i++) {
+        snprintf(instance->secgroup_names[i].name, 32, "%s", gni_xml_text(nodes[i]));
+    }
+    instance->max_secgroup_names = count;
+    EUCA_FREE(nodes);
+
+    if ((value = gni_xml_value(node, "attachmentId", NULL, NULL)) != NULL) {
+        snprintf(instance->attachmentId, ENI_ATTACHMENT_ID_LEN, "%s", value);
+    }
+
+    if (strstr(instance->name, "eni-")) {
+        if ((value = gni_xml_value(node, "sourceDestCheck", NULL, NULL)) != NULL) {
+            instance->srcdstcheck = (strcasecmp(value, "true") ? FALSE : TRUE);
+        }
+        if ((value = gni_xml_value(node, "deviceIndex", NULL, NULL)) != NULL) {
+            instance->deviceidx = atoi(value);
+        }
+        // Use the instance name for primary interfaces
+        snprintf(instance->ifname, INTERFACE_ID_LEN, "%s", instance->name);
+        if (instance->deviceidx == 0) {
+            snprintf(instance->name, INTERFACE_ID_LEN, "%s", instance->instance_name.name);
+        }
+    }
+}
+
+/**
+ * Appends an instance, and its network interfaces, to the GNI. Interfaces are read
+ * regardless of the network mode, which may not be known yet; gni_reader_finish()
+ * drops them when not in VPCMIDO mode.
+ * @param reader [in] streaming parser state
+ * @param node [in] the "instance" xml element
+ * @return 0 on success or 1 on failure
+ */
+static int gni_reader_instance(gni_reader *reader, xmlNodePtr node) {
+    int i = 0;
+    int count = 0;
+    xmlNodePtr *nodes = NULL;
+    gni_instance *instance = NULL;
+    gni_instance *interface = NULL;
+    globalNetworkInfo *gni = reader->gni;
+
+    gni->instances = gni_reader_grow(gni, gni->instances, &(reader->cap_instances), gni->max_instances + 1, sizeof (gni_instance *));
+    instance = gni_zalloc(gni, 1, sizeof (gni_instance));
+    gni->instances[gni->max_instances++] = instance;
+    gni_reader_instance_interface(gni, instance, node);
+
+    nodes = gni_xml_nodes(node, "networkInterfaces", NULL, "networkInterface", FALSE, &count);
+    if (count > 0) {
+        instance->interfaces = gni_zalloc(gni, count, sizeof (gni_instance *));
+        instance->max_interfaces = count;
+        gni->ifs = gni_reader_grow(gni, gni->ifs, &(reader->cap_ifs), gni->max_ifs + count, sizeof (gni_instance *));
+        for (i = 0; i < count; i++) {
+            interface = gni_zalloc(gni, 1, sizeof (gni_instance));
+            snprintf(interface->instance_name.name, 32, "%s", instance->name);
+            gni_reader_instance_interface(gni, interface, nodes[i]);
+            instance->interfaces[i] = interface;
+            gni->ifs[gni->max_ifs++] = interface;
+        }
+    }
+    EUCA_FREE(nodes);
+    return (0);
+}
+
+/**
+ * Appends a security group to the GNI. Instances and interfaces are linked to their
+ * security groups by gni_reader_finish().
+ * @param reader [in] streaming parser state
+ * @param node [in] the "securityGroup" xml element
+ * @return 0 on success or 1 on failure
+ */
+static int gni_reader_secgroup(gni_reader *reader, xmlNodePtr node) {
+    const char *value = NULL;
+    gni_secgroup *secgroup = NULL;
+    globalNetworkInfo *gni = reader->gni;
+
+    gni->secgroups = gni_reader_grow(gni, gni->secgroups, &(reader->cap_secgroups), gni->max_secgroups + 1, sizeof (gni_secgroup));
+    secgroup = &(gni->secgroups[gni->max_secgroups++]);
+
+    if ((value = gni_xml_attr(node, "name")) != NULL) {
+        snprintf(secgroup->name, SECURITY_GROUP_ID_LEN, "%s", value);
+    }
+    if ((value = gni_xml_value(node, "ownerId", NULL, NULL)) != NULL) {
+        snprintf(secgroup->accountId, OWNER_ID_LEN, "%s", value);
+    }
+    gni_reader_rules(gni, node, "ingressRules", &(secgroup->ingress_rules), &(secgroup->max_ingress_rules));
+    gni_reader_rules(gni, node, "egressRules", &(secgroup->egress_rules), &(secgroup->max_egress_rules));
+    return (0);
+}
+
+/**
+ * Populates a network ACL entry from its XML element.
+ * @param aclentry [in] a pointer to the (clean) acl entry structure to populate
+ * @param node [in] the "entry" xml element
+ */
+static void gni_reader_aclentry(gni_acl_entry *aclentry, xmlNodePtr node) {
+    const char *value = NULL;
+    char *scidrnetaddr = NULL;
+
+    if ((value = gni_xml_attr(node, "number")) != NULL) {
+        aclentry->number = atoi(value);
+    }
+    if ((value = gni_xml_value(node, "action", NULL, NULL)) != NULL) {
+        aclentry->allow = (strcmp(value, "allow") ? 0 : 1);
+    }
+    if ((value = gni_xml_value(node, "protocol", NULL, NULL)) != NULL) {
+        aclentry->protocol = atoi(value);
+    }
+    if ((value = gni_xml_value(node, "cidr", NULL, NULL)) != NULL) {
+        snprintf(aclentry->cidr, NETWORK_ADDR_LEN, "%s", value);
+        cidrsplit(aclentry->cidr, &scidrnetaddr, &(aclentry->cidrSlashnet));
+        aclentry->cidrNetaddr = dot2hex(scidrnetaddr);
+        EUCA_FREE(scidrnetaddr);
+    }
+    if ((value = gni_xml_value(node, "portRangeFrom", NULL, NULL)) != NULL) {
+        aclentry->fromPort = atoi(value);
+    }
+    if ((value = gni_xml_value(node, "portRangeTo", NULL, NULL)) != NULL) {
+        aclentry->toPort = atoi(value);
+    }
+    if ((value = gni_xml_value(node, "icmpType", NULL, NULL)) != NULL) {
+        aclentry->icmpType = atoi(value);
+    }
+    if ((value = gni_xml_value(node, "icmpCode", NULL, NULL)) != NULL) {
+        aclentry->icmpCode = atoi(value);
+    }
+}
+
+/**
+ * Populates a list of network ACL entries from the entry elements found under the
+ * given path.
+ * @param gni [in] a pointer to the global network information structure
+ * @param node [in] the "networkAcl" xml element
+ * @param outer [in] name of the element holding the entries
+ * @param entries [out] list of entries
+ * @param max_entries [out] number of entries in the list
+ */
+static void gni_reader_aclentries(globalNetworkInfo *gni, xmlNodePtr node, const char *outer, gni_acl_entry **entries, int *max_entries) {
+    int i = 0;
+    int count = 0;
+    xmlNodePtr *nodes = NULL;
+
+    nodes = gni_xml_nodes(node, outer, NULL, "entry", FALSE, &count);
+    if (count > 0) {
+        *entries = gni_zalloc(gni, count, sizeof (gni_acl_entry));
+        *max_entries = count;
+    }
+    for (i = 0; i < count; i++) {
+        gni_reader_aclentry(&((*entries)[i]), nodes[i]);
+    }
+    EUCA_FREE(nodes);
+}
+
+/**
+ * Populates the route tables of a VPC from its XML element.
+ * @param gni [in] a pointer to the global network information structure
+ * @param vpc [in] a pointer to the VPC structure
+ * @param node [in] the "vpc" xml element
+ */
+static void gni_reader_routetables(globalNetworkInfo *gni, gni_vpc *vpc, xmlNodePtr node) {
+    int i = 0;
+    int j = 0;
+    int count = 0;
+    int max_routes = 0;
+    const char *value = NULL;
+    xmlNodePtr *nodes = NULL;
+    xmlNodePtr *routes = NULL;
+    gni_route_table *routetable = NULL;
+    gni_route_entry *route = NULL;
+
+    nodes = gni_xml_nodes(node, "routeTables", NULL, "routeTable", FALSE, &count);
+    if (count > 0) {
+        vpc->routeTables = gni_zalloc(gni, count, sizeof (gni_route_table));
+        vpc->max_routeTables = count;
+    }
+    for (i = 0; i < count; i++) {
+        routetable = &(vpc->routeTables[i]);
+        if (!nodes[i]->properties) {
+            continue;
+        }
+        if ((value = gni_xml_attr(nodes[i], "name")) != NULL) {
+            snprintf(routetable->name, RTB_ID_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "ownerId", NULL, NULL)) != NULL) {
+            snprintf(routetable->accountId, OWNER_ID_LEN, "%s", value);
+        }
+
+        routes = gni_xml_nodes(nodes[i], "routes", NULL, "route", FALSE, &max_routes);
+        if (max_routes > 0) {
+            routetable->entries = gni_zalloc(gni, max_routes, sizeof (gni_route_entry));
+            routetable->max_entries = max_routes;
+        }
+        for (j = 0; j < max_routes; j++) {
+            route = &(routetable->entries[j]);
+            if ((value = gni_xml_value(routes[j], "destinationCidr", NULL, NULL)) != NULL) {
+                snprintf(route->destCidr, NETWORK_ADDR_LEN, "%s", value);
+            }
+            // the target is an internet gateway, a network interface or a nat gateway
+            if ((value = gni_xml_value(routes[j], "gatewayId", NULL, NULL)) == NULL) {
+                if ((value = gni_xml_value(routes[j], "networkInterfaceId", NULL, NULL)) == NULL) {
+                    value = gni_xml_value(routes[j], "natGatewayId", NULL, NULL);
+                }
+            }
+            if (value) {
+                snprintf(route->target, LID_LEN, "%s", value);
+            }
+        }
+        EUCA_FREE(routes);
+    }
+    EUCA_FREE(nodes);
+}
+
+/**
+ * Populates the subnets of a VPC from its XML element. The route tables of the VPC
+ * must have been populated.
+ * @param gni [in] a pointer to the global network information structure
+ * @param vpc [in] a pointer to the VPC structure
+ * @param node [in] the "vpc" xml element
+ */
+static void gni_reader_vpcsubnets(globalNetworkInfo *gni, gni_vpc *vpc, xmlNodePtr node) {
+    int i = 0;
+    int count = 0;
+    const char *value = NULL;
+    xmlNodePtr *nodes = NULL;
+    gni_vpcsubnet *vpcsubnet = NULL;
+
+    nodes = gni_xml_nodes(node, "subnets", NULL, "subnet", FALSE, &count);
+    if (count > 0) {
+        vpc->subnets = gni_zalloc(gni, count, sizeof (gni_vpcsubnet));
+        vpc->max_subnets = count;
+    }
+    for (i = 0; i < count; i++) {
+        vpcsubnet = &(vpc->subnets[i]);
+        if (!nodes[i]->properties) {
+            continue;
+        }
+        if ((value = gni_xml_attr(nodes[i], "name")) != NULL) {
+            snprintf(vpcsubnet->name, VPC_SUBNET_ID_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "ownerId", NULL, NULL)) != NULL) {
+            snprintf(vpcsubnet->accountId, OWNER_ID_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "cidr", NULL, NULL)) != NULL) {
+            snprintf(vpcsubnet->cidr, NETWORK_ADDR_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "cluster", NULL, NULL)) != NULL) {
+            snprintf(vpcsubnet->cluster_name, HOSTNAME_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "networkAcl", NULL, NULL)) != NULL) {
+            snprintf(vpcsubnet->networkAcl_name, NETWORK_ACL_ID_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "routeTable", NULL, NULL)) != NULL) {
+            snprintf(vpcsubnet->routeTable_name, RTB_ID_LEN, "%s", value);
+            vpcsubnet->routeTable = gni_vpc_get_routeTable(vpc, value);
+            if (vpcsubnet->routeTable == NULL) {
+                LOGWARN("Failed to find GNI %s for %s\n", value, vpcsubnet->name);
+            } else {
+                vpcsubnet->rt_entry_applied = gni_zalloc(gni, vpcsubnet->routeTable->max_entries, sizeof (int));
+            }
+        }
+    }
+    EUCA_FREE(nodes);
+}
+
+/**
+ * Populates the NAT gateways of a VPC from its XML element.
+ * @param gni [in] a pointer to the global network information structure
+ * @param vpc [in] a pointer to the VPC structure
+ * @param node [in] the "vpc" xml element
+ */
+static void gni_reader_natgateways(globalNetworkInfo *gni, gni_vpc *vpc, xmlNodePtr node) {
+    int i = 0;
+    int count = 0;
+    const char *value = NULL;
+    xmlNodePtr *nodes = NULL;
+    gni_nat_gateway *natg = NULL;
+
+    nodes = gni_xml_nodes(node, "natGateways", NULL, "natGateway", FALSE, &count);
+    if (count > 0) {
+        vpc->natGateways = gni_zalloc(gni, count, sizeof (gni_nat_gateway));
+        vpc->max_natGateways = count;
+    }
+    for (i = 0; i < count; i++) {
+        natg = &(vpc->natGateways[i]);
+        if (!nodes[i]->properties) {
+            continue;
+        }
+        if ((value = gni_xml_attr(nodes[i], "name")) != NULL) {
+            snprintf(natg->name, NATG_ID_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "ownerId", NULL, NULL)) != NULL) {
+            snprintf(natg->accountId, OWNER_ID_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "macAddress", NULL, NULL)) != NULL) {
+            mac2hex(value, natg->macAddress);
+        }
+        if ((value = gni_xml_value(nodes[i], "publicIp", NULL, NULL)) != NULL) {
+            natg->publicIp = dot2hex(value);
+        }
+        if ((value = gni_xml_value(nodes[i], "privateIp", NULL, NULL)) != NULL) {
+            natg->privateIp = dot2hex(value);
+        }
+        if ((value = gni_xml_value(nodes[i], "vpc", NULL, NULL)) != NULL) {
+            snprintf(natg->vpc, VPC_ID_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "subnet", NULL, NULL)) != NULL) {
+            snprintf(natg->subnet, VPC_SUBNET_ID_LEN, "%s", value);
+        }
+    }
+    EUCA_FREE(nodes);
+}
+
+/**
+ * Populates the network ACLs of a VPC from its XML element.
+ * @param gni [in] a pointer to the global network information structure
+ * @param vpc [in] a pointer to the VPC structure
+ * @param node [in] the "vpc" xml element
+ */
+static void gni_reader_networkacls(globalNetworkInfo *gni, gni_vpc *vpc, xmlNodePtr node) {
+    int i = 0;
+    int count = 0;
+    const char *value = NULL;
+    xmlNodePtr *nodes = NULL;
+    gni_network_acl *netacl = NULL;
+
+    nodes = gni_xml_nodes(node, "networkAcls", NULL, "networkAcl", FALSE, &count);
+    if (count > 0) {
+        vpc->networkAcls = gni_zalloc(gni, count, sizeof (gni_network_acl));
+        vpc->max_networkAcls = count;
+    }
+    for (i = 0; i < count; i++) {
+        netacl = &(vpc->networkAcls[i]);
+        if (!nodes[i]->properties) {
+            continue;
+        }
+        if ((value = gni_xml_attr(nodes[i], "name")) != NULL) {
+            snprintf(netacl->name, NETWORK_ACL_ID_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "ownerId", NULL, NULL)) != NULL) {
+            snprintf(netacl->accountId, OWNER_ID_LEN, "%s", value);
+        }
+        gni_reader_aclentries(gni, nodes[i], "ingressEntries", &(netacl->ingress), &(netacl->max_ingress));
+        gni_reader_aclentries(gni, nodes[i], "egressEntries", &(netacl->egress), &(netacl->max_egress));
+    }
+    EUCA_FREE(nodes);
+}
+
+/**
+ * Appends a VPC, with its route tables, subnets, NAT gateways and network ACLs, to the GNI.
+ * @param reader [in] streaming parser state
+ * @param node [in] the "vpc" xml element
+ * @return 0 on success or 1 on failure
+ */
+static int gni_reader_vpc(gni_reader *reader, xmlNodePtr node) {
+    int i = 0;
+    int count = 0;
+    const char *value = NULL;
+    xmlNodePtr *nodes = NULL;
+    gni_vpc *vpc = NULL;
+    globalNetworkInfo *gni = reader->gni;
+
+    gni->vpcs = gni_reader_grow(gni, gni->vpcs, &(reader->cap_vpcs), gni->max_vpcs + 1, sizeof (gni_vpc));
+    vpc = &(gni->vpcs[gni->max_vpcs++]);
+    if (!node->properties) {
+        return (0);
+    }
+
+    if ((value = gni_xml_attr(node, "name")) != NULL) {
+        snprintf(vpc->name, VPC_ID_LEN, "%s", value);
+    }
+    if ((value = gni_xml_value(node, "ownerId", NULL, NULL)) != NULL) {
+        snprintf(vpc->accountId, OWNER_ID_LEN, "%s", value);
+    }
+    if ((value = gni_xml_value(node, "cidr", NULL, NULL)) != NULL) {
+        snprintf(vpc->cidr, NETWORK_ADDR_LEN, "%s", value);
+    }
+    if ((value = gni_xml_value(node, "dhcpOptionSet", NULL, NULL)) != NULL) {
+        snprintf(vpc->dhcpOptionSet_name, DHCP_OS_ID_LEN, "%s", value);
+    }
+
+    gni_reader_routetables(gni, vpc, node);
+    gni_reader_vpcsubnets(gni, vpc, node);
+
+    nodes = gni_xml_nodes(node, "internetGateways", NULL, "value", TRUE, &count);
+    vpc->internetGatewayNames = gni_zalloc(gni, count, sizeof (gni_name_32));
+    for (i = 0; i < count; i++) {
+        snprintf(vpc->internetGatewayNames[i].name, 32, "%s", gni_xml_text(nodes[i]));
+    }
+    vpc->max_internetGatewayNames = count;
+    EUCA_FREE(nodes);
+
+    gni_reader_natgateways(gni, vpc, node);
+    gni_reader_networkacls(gni, vpc, node);
+    return (0);
+}
+
+/**
+ * Appends an internet gateway to the GNI.
+ * @param reader [in] streaming parser state
+ * @param node [in] the "internetGateway" xml element
+ * @return 0 on success or 1 on failure
+ */
+static int gni_reader_internetgateway(gni_reader *reader, xmlNodePtr node) {
+    const char *value = NULL;
+    gni_internet_gateway *igw = NULL;
+    globalNetworkInfo *gni = reader->gni;
+
+    gni->vpcIgws = gni_reader_grow(gni, gni->vpcIgws, &(reader->cap_vpcIgws), gni->max_vpcIgws + 1, sizeof (gni_internet_gateway));
+    igw = &(gni->vpcIgws[gni->max_vpcIgws++]);
+
+    if ((value = gni_xml_attr(node, "name")) != NULL) {
+        snprintf(igw->name, INETG_ID_LEN, "%s", value);
+    }
+    if ((value = gni_xml_value(node, "ownerId", NULL, NULL)) != NULL) {
+        snprintf(igw->accountId, OWNER_ID_LEN, "%s", value);
+    }
+    return (0);
+}
+
+/**
+ * Reads the list of IP addresses of a property into a newly allocated array.
+ * @param gni [in] a pointer to the global network information structure
+ * @param node [in] xml element holding the property
+ * @param propname [in] name of the property
+ * @param count [out] number of addresses read
+ * @return the list of addresses (allocated even if empty)
+ */
+static u32 *gni_reader_addresses(globalNetworkInfo *gni, xmlNodePtr node, const char *propname, int *count) {
+    int i = 0;
+    u32 *addresses = NULL;
+    xmlNodePtr *nodes = NULL;
+
+    nodes = gni_xml_nodes(node, "property", propname, "value", TRUE, count);
+    addresses = gni_zalloc(gni, *count, sizeof (u32));
+    for (i = 0; i < *count; i++) {
+        addresses[i] = dot2hex(gni_xml_text(nodes[i]));
+    }
+    EUCA_FREE(nodes);
+    return (addresses);
+}
+
+/**
+ * Appends a DHCP option set to the GNI.
+ * @param reader [in] streaming parser state
+ * @param node [in] the "dhcpOptionSet" xml element
+ * @return 0 on success or 1 on failure
+ */
+static int gni_reader_dhcpos(gni_reader *reader, xmlNodePtr node) {
+    int i = 0;
+    int count = 0;
+    const char *value = NULL;
+    xmlNodePtr *nodes = NULL;
+    gni_dhcp_os *dhcpos = NULL;
+    globalNetworkInfo *gni = reader->gni;
+
+    gni->dhcpos = gni_reader_grow(gni, gni->dhcpos, &(reader->cap_dhcpos), gni->max_dhcpos + 1, sizeof (gni_dhcp_os));
+    dhcpos = &(gni->dhcpos[gni->max_dhcpos++]);
+
+    if ((value = gni_xml_attr(node, "name")) != NULL) {
+        snprintf(dhcpos->name, DHCP_OS_ID_LEN, "%s", value);
+    }
+    if ((value = gni_xml_value(node, "ownerId", NULL, NULL)) != NULL) {
+        snprintf(dhcpos->accountId, OWNER_ID_LEN, "%s", value);
+    }
+
+    nodes = gni_xml_nodes(node, "property", "domain-name", "value", TRUE, &count);
+    dhcpos->domains = gni_zalloc(gni, count, sizeof (gni_name_256));
+    for (i = 0; i < count; i++) {
+        snprintf(dhcpos->domains[i].name, 256, "%s", gni_xml_text(nodes[i]));
+    }
+    dhcpos->max_domains = count;
+    EUCA_FREE(nodes);
+
+    dhcpos->dns = gni_reader_addresses(gni, node, "domain-name-servers", &(dhcpos->max_dns));
+    dhcpos->ntp = gni_reader_addresses(gni, node, "ntp-servers", &(dhcpos->max_ntp));
+    dhcpos->netbios_ns = gni_reader_addresses(gni, node, "netbios-name-servers", &(dhcpos->max_netbios_ns));
+    if ((value = gni_xml_value(node, "property", "netbios-node-type", "value")) != NULL) {
+        dhcpos->netbios_type = atoi(value);
+    }
+    return (0);
+}
+
+/**
+ * Reads a list of strings of a property into a newly allocated array.
+ * @param gni [in] a pointer to the global network information structure
+ * @param node [in] xml element holding the property
+ * @param propname [in] name of the property
+ * @param count [out] number of strings read
+ * @return the list of strings (allocated even if empty)
+ */
+static char **gni_reader_strings(globalNetworkInfo *gni, xmlNodePtr node, const char *propname, int *count) {
+    int i = 0;
+    char **strings = NULL;
+    xmlNodePtr *nodes = NULL;
+
+    nodes = gni_xml_nodes(node, "property", propname, "value", TRUE, count);
+    strings = gni_zalloc(gni, *count, sizeof (char *));
+    for (i = 0; i < *count; i++) {
+        strings[i] = gni_strdup(gni, gni_xml_text(nodes[i]));
+    }
+    EUCA_FREE(nodes);
+    return (strings);
+}
+
+/**
+ * Populates the mido gateways of the GNI from the "mido" property of the configuration.
+ * @param gni [in] a pointer to the global network information structure
+ * @param node [in] the "configuration" xml element
+ */
+static void gni_reader_midogws(globalNetworkInfo *gni, xmlNodePtr node) {
+    int i = 0;
+    int count = 0;
+    u32 asn = 0;
+    const char *value = NULL;
+    const char *peer_ip = NULL;
+    const char *external_cidr = NULL;
+    xmlNodePtr mido = NULL;
+    xmlNodePtr *nodes = NULL;
+    gni_mido_gateway *midogw = NULL;
+
+    if (gni_xml_select(node, "property", "mido", NULL, FALSE, NULL) < 1) {
+        LOGTRACE("mido section not found in GNI\n");
+        return;
+    }
+    for (mido = node->children; !gni_xml_match(mido, "property", "mido"); mido = mido->next) ;
+
+    // pre-4.3 Mido Gateway
+    external_cidr = gni_xml_value(mido, "property", "publicNetworkCidr", "value");
+    peer_ip = gni_xml_value(mido, "property", "publicGatewayIP", "value");
+    if ((value = gni_xml_value(mido, "property", "bgpAsn", "value")) != NULL) {
+        asn = (u32) atoi(value);
+    }
+
+    nodes = gni_xml_nodes(mido, "property", "gateways", "gateway", FALSE, &count);
+    LOGTRACE("Found %d gateways\n", count);
+    gni->midogws = gni_zalloc(gni, count, sizeof (gni_mido_gateway));
+    gni->max_midogws = count;
+    for (i = 0; i < count; i++) {
+        midogw = &(gni->midogws[i]);
+        if ((value = gni_xml_value(nodes[i], "property", "gatewayHost", "value")) != NULL) {
+            snprintf(midogw->host, HOSTNAME_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "property", "gatewayIP", "value")) != NULL) {
+            snprintf(midogw->ext_ip, INET_ADDR_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "property", "gatewayInterface", "value")) != NULL) {
+            snprintf(midogw->ext_dev, IF_NAME_LEN, "%s", value);
+        }
+        if (external_cidr) {
+            snprintf(midogw->ext_cidr, NETWORK_ADDR_LEN, "%s", external_cidr);
+        }
+        if (peer_ip) {
+            snprintf(midogw->peer_ip, INET_ADDR_LEN, "%s", peer_ip);
+        }
+
+        // 4.4 values take precedence over the pre-4.3 ones
+        if ((value = gni_xml_value(nodes[i], "property", "ip", "value")) != NULL) {
+            snprintf(midogw->host, INET_ADDR_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "property", "externalCidr", "value")) != NULL) {
+            snprintf(midogw->ext_cidr, NETWORK_ADDR_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "property", "externalIp", "value")) != NULL) {
+            snprintf(midogw->ext_ip, INET_ADDR_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "property", "externalDevice", "value")) != NULL) {
+            snprintf(midogw->ext_dev, IF_NAME_LEN, "%s", value);
+        }
+        // static router
+        if ((value = gni_xml_value(nodes[i], "property", "externalRouterIp", "value")) != NULL) {
+            snprintf(midogw->peer_ip, INET_ADDR_LEN, "%s", value);
+        }
+        // BGP parameters
+        if ((value = gni_xml_value(nodes[i], "property", "bgpPeerIp", "value")) != NULL) {
+            snprintf(midogw->peer_ip, INET_ADDR_LEN, "%s", value);
+        }
+        if ((value = gni_xml_value(nodes[i], "property", "bgpPeerAsn", "value")) != NULL) {
+            midogw->peer_asn = (u32) atoi(value);
+            midogw->asn = asn;
+        }
+        midogw->ad_routes = gni_reader_strings(gni, nodes[i], "bgpAdRoutes", &(midogw->max_ad_routes));
+    }
+    EUCA_FREE(nodes);
+
+    if (count <= 0) {
+        LOGERROR("Invalid mido gateway(s) detected. Check network configuration.\n");
+    }
+}
+
+/**
+ * Populates a cluster, and its nodes, from its XML element. Instances are linked to
+ * their node by gni_reader_finish().
+ * @param gni [in] a pointer to the global network information structure
+ * @param cluster [in] a pointer to the (clean) cluster structure to populate
+ * @param node [in] the "cluster" xml element
+ */
+static void gni_reader_cluster(globalNetworkInfo *gni, gni_cluster *cluster, xmlNodePtr node) {
+    int i = 0;
+    int j = 0;
+    int count = 0;
+    int max_names = 0;
+    const char *value = NULL;
+    xmlNodePtr subnet = NULL;
+    xmlNodePtr *nodes = NULL;
+    xmlNodePtr *names = NULL;
+    gni_node *gninode = NULL;
+
+    if ((value = gni_xml_attr(node, "name")) != NULL) {
+        snprintf(cluster->name, HOSTNAME_LEN, "%s", value);
+    }
+    if ((value = gni_xml_value(node, "property", "enabledCCIp", "value")) != NULL) {
+        cluster->enabledCCIp = dot2hex(value);
+    }
+    if ((value = gni_xml_value(node, "property", "macPrefix", "value")) != NULL) {
+        snprintf(cluster->macPrefix, ENET_MACPREFIX_LEN, "%s", value);
+    }
+    cluster->private_ips_str = gni_reader_strings(gni, node, "privateIps", &(cluster->max_private_ips_str));
+
+    for (subnet = node->children; subnet && !gni_xml_match(subnet, "subnet", NULL); subnet = subnet->next) ;
+    if (subnet) {
+        if ((value = gni_xml_value(subnet, "property", "subnet", "value")) != NULL) {
+            cluster->private_subnet.subnet = dot2hex(value);
+        }
+        if ((value = gni_xml_value(subnet, "property", "netmask", "value")) != NULL) {
+            cluster->private_subnet.netmask = dot2hex(value);
+        }
+        if ((value = gni_xml_value(subnet, "property", "gateway", "value")) != NULL) {
+            cluster->private_subnet.gateway = dot2hex(value);
+        }
+    }
+
+    nodes = gni_xml_nodes(node, "property", "nodes", "node", FALSE, &count);
+    if (count > 0) {
+        cluster->nodes = gni_zalloc(gni, count, sizeof (gni_node));
+        cluster->max_nodes = count;
+    }
+    for (i = 0; i < count; i++) {
+        gninode = &(cluster->nodes[i]);
+        if ((value = gni_xml_attr(nodes[i], "name")) != NULL) {
+            snprintf(gninode->name, HOSTNAME_LEN, "%s", value);
+        }
+        names = gni_xml_nodes(nodes[i], "instanceIds", NULL, "value", TRUE, &max_names);
+        gninode->instance_names = gni_zalloc(gni, max_names, sizeof (gni_name_32));
+        for (j = 0; j < max_names; j++) {
+            snprintf(gninode->instance_names[j].name, 32, "%s", gni_xml_text(names[j]));
+        }
+        gninode->max_instance_names = max_names;
+        EUCA_FREE(names);
+    }
+    EUCA_FREE(nodes);
+}
+
+/**
+ * Populates the network mode and the eucanetd configuration of the GNI from the
+ * configuration element. Equivalent to gni_populate_gnidata() and gni_populate_configuration().
+ * @param reader [in] streaming parser state
+ * @param node [in] the "configuration" xml element
+ * @return 0 on success or 1 on failure
+ */
+static int gni_reader_configuration(gni_reader *reader, xmlNodePtr node) {
+    int i = 0;
+    int count = 0;
+    const char *value = NULL;
+    xmlNodePtr *nodes = NULL;
+    globalNetworkInfo *gni = reader->gni;
+
+    if ((value = gni_xml_value(node, "property", "mode", "value")) != NULL) {
+        snprintf(gni->sMode, NETMODE_LEN, "%s", value);
+        gni->nmCode = euca_netmode_atoi(gni->sMode);
+    }
+    if ((value = gni_xml_value(node, "property", "enabledCLCIp", "value")) != NULL) {
+        gni->enabledCLCIp = dot2hex(value);
+    }
+    if ((value = gni_xml_value(node, "property", "instanceDNSDomain", "value")) != NULL) {
+        snprintf(gni->instanceDNSDomain, HOSTNAME_LEN, "%s", value);
+    }
+    if (IS_NETMODE_VPCMIDO(gni)) {
+        gni_reader_midogws(gni, node);
+    }
+    gni->instanceDNSServers = gni_reader_addresses(gni, node, "instanceDNSServers", &(gni->max_instanceDNSServers));
+    gni->public_ips_str = gni_reader_strings(gni, node, "publicIps", &(gni->max_public_ips_str));
+
+    // global subnets
+    nodes = gni_xml_nodes(node, "property", "subnets", "subnet", FALSE, &count);
+    if (count > 0) {
+        gni->subnets = gni_zalloc(gni, count, sizeof (gni_subnet));
+        gni->max_subnets = count;
+    }
+    for (i = 0; i < count; i++) {
+        if ((value = gni_xml_value(nodes[i], "property", "subnet", "value")) != NULL) {
+            gni->subnets[i].subnet = dot2hex(value);
+        }
+        if ((value = gni_xml_value(nodes[i], "property", "netmask", "value")) != NULL) {
+            gni->subnets[i].netmask = dot2hex(value);
+        }
+        if ((value = gni_xml_value(nodes[i], "property", "gateway", "value")) != NULL) {
+            gni->subnets[i].gateway = dot2hex(value);
+        }
+    }
+    EUCA_FREE(nodes);
+
+    // clusters
+    nodes = gni_xml_nodes(node, "property", "clusters", "cluster", FALSE, &count);
+    if (count > 0) {
+        gni->clusters = gni_zalloc(gni, count, sizeof (gni_cluster));
+        gni->max_clusters = count;
+    }
+    for (i = 0; i < count; i++) {
+        if (nodes[i]->properties) {
+            gni_reader_cluster(gni, &(gni->clusters[i]), nodes[i]);
+        } else {
+            LOGWARN("invalid cluster at idx %d\n", i);
+        }
+    }
+    EUCA_FREE(nodes);
+    return (0);
+}
+
+/**
+ * Returns the name of a security group, for the security group index.
+ * @param base [in] the security group array of the GNI
+ * @param idx [in] position of the security group
+ * @return the security group name
+ */
+static const char *gni_reader_secgroup_key(const void *base, int idx) {
+    return (((const gni_secgroup *) base)[idx].name);
+}
+
+/**
+ * Returns the name of an instance, for the instance index.
+ * @param base [in] the instance array of the GNI
+ * @param idx [in] position of the instance
+ * @return the instance name
+ */
+static const char *gni_reader_instance_key(const void *base, int idx) {
+    return (((gni_instance * const *) base)[idx]->name);
+}
+
+/**
+ * Links the security groups to their instances and interfaces, the same way
+ * gni_populate_sgs() does, but through a name index rather than comparing every
+ * security group with every instance.
+ * @param gni [in] a pointer to the global network information structure
+ * @param sgindex [in] index of the security groups of the GNI by name
+ * @param instances [in] list of instances or interfaces
+ * @param max_instances [in] number of entries in instances
+ * @param interfaces [in] set if instances is the list of interfaces
+ */
+static void gni_reader_link_secgroups(globalNetworkInfo *gni, euca_strindex *sgindex, gni_instance **instances, int max_instances, boolean interfaces) {
+    int i = 0;
+    int j = 0;
+    int idx = 0;
+    int *counts = NULL;
+    gni_instance *gi = NULL;
+    gni_secgroup *gsg = NULL;
+
+    counts = EUCA_ZALLOC_C(gni->max_secgroups, sizeof (int));
+    for (i = 0; i < max_instances; i++) {
+        for (j = 0; j < instances[i]->max_secgroup_names; j++) {
+            if ((idx = euca_strindex_find(sgindex, instances[i]->secgroup_names[j].name, gni_reader_secgroup_key, gni->secgroups)) >= 0) {
+                counts[idx]++;
+            }
+        }
+    }
+    for (i = 0; i < gni->max_secgroups; i++) {
+        if (counts[i] > 0) {
+            if (interfaces) {
+                gni->secgroups[i].interfaces = gni_zalloc(gni, counts[i], sizeof (gni_instance *));
+            } else {
+                gni->secgroups[i].instances = gni_zalloc(gni, counts[i], sizeof (gni_instance *));
+            }
+        }
+    }
+    for (i = 0; i < max_instances; i++) {
+        gi = instances[i];
+        for (j = 0; j < gi->max_secgroup_names; j++) {
+            if ((idx = euca_strindex_find(sgindex, gi->secgroup_names[j].name, gni_reader_secgroup_key, gni->secgroups)) < 0) {
+                continue;
+            }
+            gsg = &(gni->secgroups[idx]);
+            if (interfaces) {
+                gi->gnisgs[j] = gsg;
+                gsg->interfaces[gsg->max_interfaces++] = gi;
+            } else {
+                gsg->instances[gsg->max_instances++] = gi;
+            }
+        }
+    }
+    EUCA_FREE(counts);
+}
+
+/**
+ * Completes a GNI once the whole document has been read: drops the interfaces outside
+ * of VPCMIDO mode, and links security groups and nodes to their instances and interfaces.
+ * @param reader [in] streaming parser state
+ */
+static void gni_reader_finish(gni_reader *reader) {
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    int l = 0;
+    int idx = 0;
+    euca_strindex index = { 0 };
+    gni_node *gninode = NULL;
+    gni_instance *instance = NULL;
+    globalNetworkInfo *gni = reader->gni;
+
+    // the interfaces stay in the arena until the GNI is cleared
+    if (!IS_NETMODE_VPCMIDO(gni) && gni->max_ifs) {
+        gni->ifs = NULL;
+        gni->max_ifs = 0;
+        for (i = 0; i < gni->max_instances; i++) {
+            gni->instances[i]->interfaces = NULL;
+            gni->instances[i]->max_interfaces = 0;
+        }
+    }
+
+    if (gni->max_secgroups) {
+        euca_strindex_rebuild(&index, gni->max_secgroups, gni_reader_secgroup_key, gni->secgroups);
+        gni_reader_link_secgroups(gni, &index, gni->instances, gni->max_instances, FALSE);
+        if (IS_NETMODE_VPCMIDO(gni)) {
+            gni_reader_link_secgroups(gni, &index, gni->ifs, gni->max_ifs, TRUE);
+        }
+        euca_strindex_clear(&index);
+    }
+
+    if (gni->max_instances) {
+        euca_strindex_rebuild(&index, gni->max_instances, gni_reader_instance_key, gni->instances);
+        for (i = 0; i < gni->max_clusters; i++) {
+            for (j = 0; j < gni->clusters[i].max_nodes; j++) {
+                gninode = &(gni->clusters[i].nodes[j]);
+                for (k = 0; k < gninode->max_instance_names; k++) {
+                    if ((idx = euca_strindex_find(&index, gninode->instance_names[k].name, gni_reader_instance_key, gni->instances)) < 0) {
+                        continue;
+                    }
+                    instance = gni->instances[idx];
+                    snprintf(instance->node, HOSTNAME_LEN, "%s", gninode->name);
+                    if (IS_NETMODE_VPCMIDO(gni)) {
+                        for (l = 0; l < instance->max_interfaces; l++) {
+                            snprintf(instance->interfaces[l]->node, HOSTNAME_LEN, "%s", gninode->name);
+                        }
+                    }
+                }
+            }
+        }
+        euca_strindex_clear(&index);
+    }
+}
+
+/**
+ * Reads the children of a top level section of the GNI document (e.g., the instances),
+ * handing each element of interest, expanded with its subtree, to a callback. Only one
+ * such element is held in memory at a time.
+ * @param xmlreader [in] xml reader positioned on the section element
+ * @param name [in] name of the elements of interest
+ * @param fn [in] callback invoked for every element of interest
+ * @param reader [in] streaming parser state
+ * @return 1 when positioned at the end of the section, 0 at the end of the document, -1 on error
+ */
+static int gni_reader_section(xmlTextReaderPtr xmlreader, const char *name, gni_reader_fn fn, gni_reader *reader) {
+    int rc = 0;
+    int depth = 0;
+    int type = 0;
+    xmlNodePtr node = NULL;
+
+    if (xmlTextReaderIsEmptyElement(xmlreader)) {
+        return (1);
+    }
+    depth = xmlTextReaderDepth(xmlreader);
+    rc = xmlTextReaderRead(xmlreader);
+    while (rc == 1) {
+        type = xmlTextReaderNodeType(xmlreader);
+        if ((type == XML_READER_TYPE_END_ELEMENT) && (xmlTextReaderDepth(xmlreader) == depth)) {
+            return (1);
+        }
+        if ((type == XML_READER_TYPE_ELEMENT) && (xmlTextReaderDepth(xmlreader) == (depth + 1)) && !xmlStrcmp(xmlTextReaderConstName(xmlreader), (const xmlChar *) name)) {
+            if ((node = xmlTextReaderExpand(xmlreader)) == NULL) {
+                return (-1);
+            }
+            fn(reader, node);
+            rc = xmlTextReaderNext(xmlreader);
+            continue;
+        }
+        rc = xmlTextReaderRead(xmlreader);
+    }
+    return (rc);
+}
+
+/**
+ * Populates a globalNetworkInfo structure in a single streaming pass over an XML file.
+ * Top level sections are read one element at a time (an instance, a security group, a
+ * VPC, ...), so the whole document is never held in memory, and every element is read
+ * by walking its children instead of evaluating XPath expressions. The result is the
+ * same as with the XPath parser the unit test compares it with (gni_populate_xpath()).
+ * @param mode [in] mode what to populate GNI_POPULATE_ALL || GNI_POPULATE_CONFIG
+ * @param gni [in] a pointer to the (clean) global network information structure
+ * @param xmlpath [in] path to the XML file to be used to populate
+ * @return 0 on success or 1 on failure
+ */
+static int gni_populate_reader(int mode, globalNetworkInfo *gni, const char *xmlpath) {
+    int rc = 0;
+    int ret = 0;
+    xmlChar *attr = NULL;
+    xmlNodePtr node = NULL;
+    xmlTextReaderPtr xmlreader = NULL;
+    gni_reader reader = { 0 };
+
+    if ((xmlreader = xmlReaderForFile(xmlpath, NULL, 0)) == NULL) {
+        LOGERROR("unable to open XML file (%s)\n", xmlpath);
+        return (1);
+    }
+    reader.gni = gni;
+
+    while (((rc = xmlTextReaderRead(xmlreader)) == 1) && (xmlTextReaderNodeType(xmlreader) != XML_READER_TYPE_ELEMENT)) ;
+    if ((rc != 1) || xmlStrcmp(xmlTextReaderConstName(xmlreader), (const xmlChar *) "network-data")) {
+        LOGERROR("network-data node not found in GNI xml (%s)\n", xmlpath);
+        xmlFreeTextReader(xmlreader);
+        return (1);
+    }
+
+    if ((attr = xmlTextReaderGetAttribute(xmlreader, (const xmlChar *) "version")) != NULL) {
+        snprintf(gni->version, GNI_VERSION_LEN, "%s", (char *) attr);
+        xmlFree(attr);
+    }
+    if ((attr = xmlTextReaderGetAttribute(xmlreader, (const xmlChar *) "applied-version")) != NULL) {
+        snprintf(gni->appliedVersion, GNI_VERSION_LEN, "%s", (char *) attr);
+        xmlFree(attr);
+    }
+
+    if (!xmlTextReaderIsEmptyElement(xmlreader)) {
+        rc = xmlTextReaderRead(xmlreader);
+    }
+    while (rc == 1) {
+        if ((xmlTextReaderNodeType(xmlreader) == XML_READER_TYPE_END_ELEMENT) && (xmlTextReaderDepth(xmlreader) == 0)) {
+            break;
+        }
+        if ((xmlTextReaderNodeType(xmlreader) != XML_READER_TYPE_ELEMENT) || (xmlTextReaderDepth(xmlreader) != 1)) {
+            rc = xmlTextReaderRead(xmlreader);
+            continue;
+        }
+
+        switch (gni_xmlstr2type(xmlTextReaderConstName(xmlreader))) {
+            case GNI_XPATH_CONFIGURATION:
+                if ((node = xmlTextReaderExpand(xmlreader)) == NULL) {
+                    rc = -1;
+                    continue;
+                }
+                gni_reader_configuration(&reader, node);
+                rc = xmlTextReaderNext(xmlreader);
+                continue;
+            case GNI_XPATH_INSTANCES:
+                rc = ((mode == GNI_POPULATE_ALL) ? gni_reader_section(xmlreader, "instance", gni_reader_instance, &reader) : 1);
+                break;
+            case GNI_XPATH_SECURITYGROUPS:
+                rc = ((mode == GNI_POPULATE_ALL) ? gni_reader_section(xmlreader, "securityGroup", gni_reader_secgroup, &reader) : 1);
+                break;
+            case GNI_XPATH_VPCS:
+                rc = ((mode == GNI_POPULATE_ALL) ? gni_reader_section(xmlreader, "vpc", gni_reader_vpc, &reader) : 1);
+                break;
+            case GNI_XPATH_INTERNETGATEWAYS:
+                rc = ((mode == GNI_POPULATE_ALL) ? gni_reader_section(xmlreader, "internetGateway", gni_reader_internetgateway, &reader) : 1);
+                break;
+            case GNI_XPATH_DHCPOPTIONSETS:
+                rc = ((mode == GNI_POPULATE_ALL) ? gni_reader_section(xmlreader, "dhcpOptionSet", gni_reader_dhcpos, &reader) : 1);
+                break;
+            default:
+                LOGTRACE("Unknown GNI xml node %s\n", xmlTextReaderConstName(xmlreader));
+                break;
+        }
+        if (rc == 1) {
+            // skip what is left of the section
+            rc = xmlTextReaderNext(xmlreader);
+        }
+    }
+
+    if (rc < 0) {
+        LOGERROR("unable to parse XML file (%s)\n", xmlpath);
+        ret = 1;
+    }
+    xmlFreeTextReader(xmlreader);
+
+    if (!ret) {
+        gni_reader_finish(&reader);
+    }
+    return (ret);
+}
+
+/**
+ * Parses a list of IP address ranges (start - end) and converts into a linear
+ * array.
+ * @param inlist [in] list of IP address ranges of interest
+ * @param inmax [in] number of entries in the list
+ * @param outlist [out] list of IP addresses converted from the input list
+ * @param outmax [out] number of entries in the list of IP addresses
+ * @return  0 on success. 1 on failure.
+ */
+int gni_serialize_iprange_list(char **inlist, int inmax, u32 **outlist, int *outmax) {
+    int i = 0;
+    int ret = 0;
+    int outidx = 0;
+    u32 *outlistbuf = NULL;
+    int max_outlistbuf = 0;
+
+    if (!inlist || inmax < 0 || !outlist || !outmax) {
+        LOGERROR("invalid input\n");
+        return (1);
+    }
+    *outlist = NULL;
+    *outmax = 0;
+
+    for (i = 0; i < inmax; i++) {
+        char *range = NULL;
+        char *tok = NULL;
+        char *start = NULL;
+        char *end = NULL;
+        int numi = 0;
+
+        LOGTRACE("parsing input range: %s\n", inlist[i]);
+
+        range = strdup(inlist[i]);
+        tok = strchr(range, '-');
+        if (tok) {
+            *tok = '\0';
+            tok++;
+            if (strlen(tok)) {
+                start = strdup(range);
+                end = strdup(tok);
+            } else {
+                LOGERROR("empty end range from input '%s': check network config\n", inlist[i]);
+                start = NULL;
+                end = NULL;
+            }
+        } else {
+            start = strdup(range);
+            end = strdup(range);
+        }
+        EUCA_FREE(range);
+
+        if (start && end) {
+            uint32_t startb, endb, idxb, localhost;
+
+            LOGTRACE("start=%s end=%s\n", start, end);
+            localhost = dot2hex("127.0.0.1");
+            startb = dot2hex(start);
+            endb = dot2hex(end);
+            if ((startb <= endb) && (startb != localhost) && (endb != localhost)) {
+                numi = (int) (endb - startb) + 1;
+                outlistbuf = EUCA_REALLOC_C(outlistbuf, (max_outlistbuf + numi), sizeof (u32));
+                outidx = max_outlistbuf;
+                max_outlistbuf += numi;
+                for (idxb = startb; idxb <= endb; idxb++) {
+                    outlistbuf[outidx] = idxb;
+                    outidx++;
+                }
+            } else {
+                LOGERROR("end range '%s' is smaller than start range '%s' from input '%s': check network config\n", end, start, inlist[i]);
+                ret = 1;
+            }
+        } else {
+            LOGERROR("couldn't parse range from input '%s': check network config\n", inlist[i]);
+            ret = 1;
         }
 
         EUCA_FREE(start);
@@ -4368,64 +5992,83 @@ int gni_iterate(globalNetworkInfo *gni, gni_iterate_mode mode, log_level_e lleve
             }
             break;
         case GNI_ITERATE_FREE:
-            EUCA_FREE(gni->instanceDNSServers);
-
-            for (i = 0; i < gni->max_midogws; i++) {
-                gni_midogw_clear(&(gni->midogws[i]));
-            }
-            EUCA_FREE(gni->midogws);
+            gni_index_clear(gni);
+            if (gni->arena.used) {
+                // populated by gni_populate_v(): everything read from the XML goes away with the arena,
+                // only the lists built later on are on the heap
+                EUCA_FREE(gni->public_ips);
+                for (i = 0; i < gni->max_clusters; i++) {
+                    EUCA_FREE(gni->clusters[i].private_ips);
+                }
+                for (i = 0; i < gni->max_vpcs; i++) {
+                    for (j = 0; j < gni->vpcs[i].max_subnets; j++) {
+                        EUCA_FREE(gni->vpcs[i].subnets[j].interfaces);
+                    }
+                    EUCA_FREE(gni->vpcs[i].interfaces);
+                }
+            } else {
+                EUCA_FREE(gni->instanceDNSServers);
 
-            EUCA_FREE(gni->public_ips);
-            for (i = 0; i < gni->max_public_ips_str; i++) {
-                EUCA_FREE(gni->public_ips_str[i]);
-            }
-            EUCA_FREE(gni->public_ips_str);
+                for (i = 0; i < gni->max_midogws; i++) {
+                    gni_midogw_clear(&(gni->midogws[i]));
+                }
+                EUCA_FREE(gni->midogws);
+
+                EUCA_FREE(gni->public_ips);
+                for (i = 0; i < gni->max_public_ips_str; i++) {
+                    EUCA_FREE(gni->public_ips_str[i]);
+                }
+                EUCA_FREE(gni->public_ips_str);
 
-            EUCA_FREE(gni->subnets);
+                EUCA_FREE(gni->subnets);
 
-            for (i = 0; i < gni->max_clusters; i++) {
-                for (j = 0; j < gni->clusters[i].max_nodes; j++) {
-                    gni_node_clear(&(gni->clusters[i].nodes[j]));
+                for (i = 0; i < gni->max_clusters; i++) {
+                    for (j = 0; j < gni->clusters[i].max_nodes; j++) {
+                        gni_node_clear(&(gni->clusters[i].nodes[j]));
+                    }
+                    gni_cluster_clear(&(gni->clusters[i]));
                 }
-                gni_cluster_clear(&(gni->clusters[i]));
-            }
-            EUCA_FREE(gni->clusters);
+                EUCA_FREE(gni->clusters);
 
-            for (i = 0; i < gni->max_instances; i++) {
-                gni_instance_clear(gni->instances[i]);
-                EUCA_FREE(gni->instances[i]);
-            }
-            EUCA_FREE(gni->instances);
+                for (i = 0; i < gni->max_instances; i++) {
+                    gni_instance_clear(gni->instances[i]);
+                    EUCA_FREE(gni->instances[i]);
+                }
+                EUCA_FREE(gni->instances);
 
-            for (i = 0; i < gni->max_ifs; i++) {
-                gni_instance_clear(gni->ifs[i]);
-                EUCA_FREE(gni->ifs[i]);
-            }
-            EUCA_FREE(gni->ifs);
+                for (i = 0; i < gni->max_ifs; i++) {
+                    gni_instance_clear(gni->ifs[i]);
+                    EUCA_FREE(gni->ifs[i]);
+                }
+                EUCA_FREE(gni->ifs);
 
-            for (i = 0; i < gni->max_secgroups; i++) {
-                gni_secgroup_clear(&(gni->secgroups[i]));
-            }
-            EUCA_FREE(gni->secgroups);
+                for (i = 0; i < gni->max_secgroups; i++) {
+                    gni_secgroup_clear(&(gni->secgroups[i]));
+                }
+                EUCA_FREE(gni->secgroups);
 
-            for (i = 0; i < gni->max_vpcs; i++) {
-                gni_vpc_clear(&(gni->vpcs[i]));
-            }
-            EUCA_FREE(gni->vpcs);
+                for (i = 0; i < gni->max_vpcs; i++) {
+                    gni_vpc_clear(&(gni->vpcs[i]));
+                }
+                EUCA_FREE(gni->vpcs);
 
-            EUCA_FREE(gni->vpcIgws);
+                EUCA_FREE(gni->vpcIgws);
 
-            for (i = 0; i < gni->max_dhcpos; i++) {
-                gni_dhcpos_clear(&(gni->dhcpos[i]));
+                for (i = 0; i < gni->max_dhcpos; i++) {
+                    gni_dhcpos_clear(&(gni->dhcpos[i]));
+                }
+                EUCA_FREE(gni->dhcpos);
             }
-            EUCA_FREE(gni->dhcpos);
 
+            euca_arena arena = gni->arena;
+            euca_arena_reset(&arena);
             gni->init = 1;
             gni->networkInfo[0] = '\0';
             // version_addr statements below are equivalent. Using second one to avoid Coverity alert
             //char *version_addr = (char *) &(gni->version);
             char *version_addr = (char *) gni + (sizeof (gni->init) + sizeof (gni->networkInfo));
             memset(version_addr, 0, sizeof (globalNetworkInfo) - sizeof (gni->init) - sizeof (gni->networkInfo));
+            gni->arena = arena;
 
             break;
         default:
@@ -4437,7 +6080,8 @@ int gni_iterate(globalNetworkInfo *gni, gni_iterate_mode mode, log_level_e lleve
 
 /**
  * Clears a given globalNetworkInfo structure. This will free member's allocated memory and zero
- * out the structure itself.
+ * out the structure itself. What gni_populate_v() allocated is released at once with the arena,
+ * whose largest chunk is kept to populate the structure again.
  *
  * @param gni [in] a pointer to the global network information structure
  *
@@ -4475,6 +6119,7 @@ int gni_free(globalNetworkInfo *gni) {
         return (0);
     }
     gni_clear(gni);
+    euca_arena_free(&(gni->arena));
     EUCA_FREE(gni);
     return (0);
 }
@@ -4702,6 +6347,7 @@ int gni_vpc_clear(gni_vpc *vpc) {
     for (i = 0; i < vpc->max_subnets; i++) {
         EUCA_FREE(vpc->subnets[i].interfaces);
         EUCA_FREE(vpc->subnets[i].rt_entry_applied);
+        euca_strindex_clear(&(vpc->subnets[i].interface_index));
     }
     EUCA_FREE(vpc->subnets);
     for (i = 0; i < vpc->max_networkAcls; i++) {
@@ -4800,25 +6446,13 @@ int gni_midogw_dup(gni_mido_gateway *dst, gni_mido_gateway *src) {
  * @return pointer to the gni_vpc of interest when found. NULL otherwise.
  */
 gni_vpc *gni_get_vpc(globalNetworkInfo *gni, char *name, int *startidx) {
-    gni_vpc *vpcs = NULL;
-    int start = 0;
+    int idx = 0;
 
     if ((gni == NULL) || (name == NULL)) {
         return NULL;
     }
-    if (startidx) {
-        start = *startidx;
-    }
-    vpcs = gni->vpcs;
-    for (int i = start; i < gni->max_vpcs; i++) {
-        if (!strcmp(name, vpcs[i].name)) {
-            if (startidx) {
-                *startidx = i + 1;
-            }
-            return &(vpcs[i]);
-        }
-    }
-    return (NULL);
+    idx = gni_index_lookup(&(gni->vpc_index), name, startidx, gni_vpc_key, gni->vpcs, gni->max_vpcs);
+    return ((idx < 0) ? NULL : &(gni->vpcs[idx]));
 }
 
 /**
@@ -4862,25 +6496,13 @@ gni_vpcsubnet *gni_get_vpcsubnet(gni_vpc *vpc, char *name, int *startidx) {
  * @return pointer to the gni_vpcsubnet of interest when found. NULL otherwise.
  */
 gni_instance *gni_get_interface(gni_vpcsubnet *vpcsubnet, char *name, int *startidx) {
-    gni_instance **interfaces = NULL;
-    int start = 0;
+    int idx = 0;
 
     if ((vpcsubnet == NULL) || (name == NULL)) {
         return NULL;
     }
-    if (startidx) {
-        start = *startidx;
-    }
-    interfaces = vpcsubnet->interfaces;
-    for (int i = start; i < vpcsubnet->max_interfaces; i++) {
-        if (!strcmp(name, interfaces[i]->name)) {
-            if (startidx) {
-                *startidx = i + 1;
-            }
-            return (interfaces[i]);
-        }
-    }
-    return (NULL);
+    idx = gni_index_lookup(&(vpcsubnet->interface_index), name, startidx, gni_instance_key, vpcsubnet->interfaces, vpcsubnet->max_interfaces);
+    return ((idx < 0) ? NULL : vpcsubnet->interfaces[idx]);
 }
 
 /**
@@ -4987,25 +6609,13 @@ gni_route_table *gni_get_routetable(gni_vpc *vpc, char *name, int *startidx) {
  * @return pointer to the gni_secgroup of interest when found. NULL otherwise.
  */
 gni_secgroup *gni_get_secgroup(globalNetworkInfo *gni, char *name, int *startidx) {
-    gni_secgroup *secgroups = NULL;
-    int start = 0;
+    int idx = 0;
 
     if ((gni == NULL) || (name == NULL)) {
         return NULL;
     }
-    if (startidx) {
-        start = *startidx;
-    }
-    secgroups = gni->secgroups;
-    for (int i = start; i < gni->max_secgroups; i++) {
-        if (!strcmp(name, secgroups[i].name)) {
-            if (startidx) {
-                *startidx = i + 1;
-            }
-            return &(secgroups[i]);
-        }
-    }
-    return (NULL);
+    idx = gni_index_lookup(&(gni->secgroup_index), name, startidx, gni_secgroup_key, gni->secgroups, gni->max_secgroups);
+    return ((idx < 0) ? NULL : &(gni->secgroups[idx]));
 }
 
 /**
@@ -5049,25 +6659,13 @@ gni_network_acl *gni_get_networkacl(gni_vpc *vpc, char *name, int *startidx) {
  * @return pointer to the gni_dhcp_os of interest when found. NULL otherwise.
  */
 gni_dhcp_os *gni_get_dhcpos(globalNetworkInfo *gni, char *name, int *startidx) {
-    gni_dhcp_os *dhcpos = NULL;
-    int start = 0;
+    int idx = 0;
 
     if ((gni == NULL) || (name == NULL)) {
         return NULL;
     }
-    if (startidx) {
-        start = *startidx;
-    }
-    dhcpos = gni->dhcpos;
-    for (int i = start; i < gni->max_dhcpos; i++) {
-        if (!strcmp(name, dhcpos[i].name)) {
-            if (startidx) {
-                *startidx = i + 1;
-            }
-            return &(dhcpos[i]);
-        }
-    }
-    return (NULL);
+    idx = gni_index_lookup(&(gni->dhcpos_index), name, startidx, gni_dhcpos_key, gni->dhcpos, gni->max_dhcpos);
+    return ((idx < 0) ? NULL : &(gni->dhcpos[idx]));
 }
 
 /**
@@ -6606,64 +8204,503 @@ int cmp_gni_instance(gni_instance *a, gni_instance *b) {
         }
     }
 
-    if (abmatch) {
-        return (0);
+    if (abmatch) {
+        return (0);
+    }
+    return (1);
+}
+
+/**
+ * Compares gni_mido_gateway structures a and b.
+ *
+ * @param a [in] gni_instance structure of interest.
+ * @param b [in] gni_instance structure of interest.
+ * @return 0 if name and other properties of a and b match. Non-zero otherwise.
+ */
+int cmp_gni_mido_gateway(gni_mido_gateway *a, gni_mido_gateway *b) {
+    int abmatch = 1;
+    if (a == b) {
+        return (0);
+    }
+    if ((a == NULL) || (b == NULL)) {
+        return (1);
+    }
+    if (strcmp(a->host, b->host)) {
+        abmatch = 0;
+    } else {
+        if (a->asn != b->asn) {
+            abmatch = 0;
+        }
+        if (a->peer_asn != b->peer_asn) {
+            abmatch = 0;
+        }
+        if (strcmp(a->ext_ip, b->ext_ip)) {
+            abmatch = 0;
+        }
+        if (strcmp(a->ext_dev, b->ext_dev)) {
+            abmatch = 0;
+        }
+        if (strcmp(a->ext_cidr, b->ext_cidr)) {
+            abmatch = 0;
+        }
+        if (strcmp(a->peer_ip, b->peer_ip)) {
+            abmatch = 0;
+        }
+        if (a->max_ad_routes != b->max_ad_routes) {
+            abmatch = 0;
+        } else {
+            for (int i = 0; i < a->max_ad_routes; i++) {
+                if (strcmp(a->ad_routes[i], b->ad_routes[i])) {
+                    abmatch = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (abmatch) {
+        return (0);
+    }
+    return (1);
+}
+
+/**
+ * Returns the name of the internet gateway at position idx of an array of gni_internet_gateway.
+ *
+ * @param base [in] array of gni_internet_gateway
+ * @param idx [in] position of the element in the array
+ *
+ * @return the name of the element
+ */
+static const char *gni_igw_key(const void *base, int idx) {
+    return (((const gni_internet_gateway *)base)[idx].name);
+}
+
+/**
+ * Returns the name of the object of the entry at position idx of an array of gni_diff_entry.
+ *
+ * @param base [in] array of gni_diff_entry
+ * @param idx [in] position of the entry in the array
+ *
+ * @return the name of the object
+ */
+static const char *gni_diff_entry_key(const void *base, int idx) {
+    return (((const gni_diff_entry *)base)[idx].name);
+}
+
+/**
+ * Compares two versions of an instance or interface.
+ *
+ * @param before [in] the gni_instance in the older GNI
+ * @param after [in] the gni_instance in the newer GNI
+ *
+ * @return the GNI_DIFF_CHANGE_* properties that differ, 0 if none
+ */
+static u32 gni_diff_instance(void *before, void *after) {
+    int i = 0;
+    u32 changes = 0;
+    gni_instance *a = (gni_instance *) before;
+    gni_instance *b = (gni_instance *) after;
+
+    if (a->publicIp != b->publicIp) {
+        changes |= GNI_DIFF_CHANGE_PUBLICIP;
+    }
+    if (a->privateIp != b->privateIp) {
+        changes |= GNI_DIFF_CHANGE_PRIVATEIP;
+    }
+    if (memcmp(a->macAddress, b->macAddress, sizeof (a->macAddress))) {
+        changes |= GNI_DIFF_CHANGE_MAC;
+    }
+    if (strcmp(a->node, b->node)) {
+        changes |= GNI_DIFF_CHANGE_NODE;
+    }
+    if (a->srcdstcheck != b->srcdstcheck) {
+        changes |= GNI_DIFF_CHANGE_SRCDSTCHECK;
+    }
+    if (a->max_secgroup_names != b->max_secgroup_names) {
+        changes |= GNI_DIFF_CHANGE_SECGROUPS;
+    } else {
+        for (i = 0; i < a->max_secgroup_names; i++) {
+            if (strcmp(a->secgroup_names[i].name, b->secgroup_names[i].name)) {
+                changes |= GNI_DIFF_CHANGE_SECGROUPS;
+                break;
+            }
+        }
+    }
+    if (strcmp(a->ifname, b->ifname) || strcmp(a->attachmentId, b->attachmentId) || strcmp(a->accountId, b->accountId) || strcmp(a->vpc, b->vpc)
+        || strcmp(a->subnet, b->subnet) || strcmp(a->instance_name.name, b->instance_name.name) || (a->deviceidx != b->deviceidx)
+        || (a->max_interfaces != b->max_interfaces)) {
+        changes |= GNI_DIFF_CHANGE_OTHER;
+    } else {
+        for (i = 0; i < a->max_interfaces; i++) {
+            if (strcmp(a->interfaces[i]->ifname, b->interfaces[i]->ifname)) {
+                changes |= GNI_DIFF_CHANGE_OTHER;
+                break;
+            }
+        }
+    }
+    return (changes);
+}
+
+/**
+ * Compares two versions of the member instances or interfaces of a security group.
+ * Members are compared in order, along with their addresses.
+ *
+ * @param before [in] the members in the older GNI
+ * @param max_before [in] number of members in the older GNI
+ * @param after [in] the members in the newer GNI
+ * @param max_after [in] number of members in the newer GNI
+ *
+ * @return GNI_DIFF_CHANGE_MEMBERS if the members differ, 0 otherwise
+ */
+static u32 gni_diff_members(gni_instance **before, int max_before, gni_instance **after, int max_after) {
+    if (max_before != max_after) {
+        return (GNI_DIFF_CHANGE_MEMBERS);
+    }
+    for (int i = 0; i < max_before; i++) {
+        if (strcmp(before[i]->name, after[i]->name) || (before[i]->publicIp != after[i]->publicIp) || (before[i]->privateIp != after[i]->privateIp)) {
+            return (GNI_DIFF_CHANGE_MEMBERS);
+        }
+    }
+    return (0);
+}
+
+/**
+ * Compares two versions of a security group.
+ *
+ * @param before [in] the gni_secgroup in the older GNI
+ * @param after [in] the gni_secgroup in the newer GNI
+ *
+ * @return the GNI_DIFF_CHANGE_* properties that differ, 0 if none
+ */
+static u32 gni_diff_secgroup(void *before, void *after) {
+    int ingress_diff = 0;
+    int egress_diff = 0;
+    u32 changes = 0;
+    gni_secgroup *a = (gni_secgroup *) before;
+    gni_secgroup *b = (gni_secgroup *) after;
+
+    cmp_gni_secgroup(a, b, &ingress_diff, &egress_diff, NULL);
+    if (ingress_diff) {
+        changes |= GNI_DIFF_CHANGE_INGRESS;
+    }
+    if (egress_diff) {
+        changes |= GNI_DIFF_CHANGE_EGRESS;
+    }
+    changes |= gni_diff_members(a->instances, a->max_instances, b->instances, b->max_instances);
+    changes |= gni_diff_members(a->interfaces, a->max_interfaces, b->interfaces, b->max_interfaces);
+    if (strcmp(a->accountId, b->accountId)) {
+        changes |= GNI_DIFF_CHANGE_OTHER;
+    }
+    return (changes);
+}
+
+/**
+ * Compares two versions of a VPC, along with its subnets, route tables, network
+ * ACLs, NAT gateways and internet gateways. Lists are compared in order.
+ *
+ * @param before [in] the gni_vpc in the older GNI
+ * @param after [in] the gni_vpc in the newer GNI
+ *
+ * @return GNI_DIFF_CHANGE_OTHER if anything differs, 0 otherwise
+ */
+static u32 gni_diff_vpc(void *before, void *after) {
+    int i = 0;
+    gni_vpc *a = (gni_vpc *) before;
+    gni_vpc *b = (gni_vpc *) after;
+
+    if (cmp_gni_vpc(a, b) || strcmp(a->accountId, b->accountId) || strcmp(a->cidr, b->cidr)) {
+        return (GNI_DIFF_CHANGE_OTHER);
+    }
+    // cmp_gni_vpc() made sure that the lists have the same size
+    for (i = 0; i < a->max_subnets; i++) {
+        gni_vpcsubnet *sa = &(a->subnets[i]);
+        gni_vpcsubnet *sb = &(b->subnets[i]);
+        if (strcmp(sa->name, sb->name) || strcmp(sa->accountId, sb->accountId) || strcmp(sa->cidr, sb->cidr) || strcmp(sa->cluster_name, sb->cluster_name)
+            || strcmp(sa->networkAcl_name, sb->networkAcl_name) || strcmp(sa->routeTable_name, sb->routeTable_name)) {
+            return (GNI_DIFF_CHANGE_OTHER);
+        }
+    }
+    for (i = 0; i < a->max_routeTables; i++) {
+        if (cmp_gni_route_table(&(a->routeTables[i]), &(b->routeTables[i]))) {
+            return (GNI_DIFF_CHANGE_OTHER);
+        }
+    }
+    for (i = 0; i < a->max_networkAcls; i++) {
+        if (cmp_gni_nacl(&(a->networkAcls[i]), &(b->networkAcls[i]), NULL, NULL)) {
+            return (GNI_DIFF_CHANGE_OTHER);
+        }
+    }
+    for (i = 0; i < a->max_natGateways; i++) {
+        gni_nat_gateway *na = &(a->natGateways[i]);
+        gni_nat_gateway *nb = &(b->natGateways[i]);
+        if (cmp_gni_nat_gateway(na, nb) || (na->publicIp != nb->publicIp) || (na->privateIp != nb->privateIp)
+            || memcmp(na->macAddress, nb->macAddress, sizeof (na->macAddress)) || strcmp(na->subnet, nb->subnet)) {
+            return (GNI_DIFF_CHANGE_OTHER);
+        }
+    }
+    for (i = 0; i < a->max_internetGatewayNames; i++) {
+        if (strcmp(a->internetGatewayNames[i].name, b->internetGatewayNames[i].name)) {
+            return (GNI_DIFF_CHANGE_OTHER);
+        }
+    }
+    return (0);
+}
+
+/**
+ * Compares two versions of an internet gateway.
+ *
+ * @param before [in] the gni_internet_gateway in the older GNI
+ * @param after [in] the gni_internet_gateway in the newer GNI
+ *
+ * @return GNI_DIFF_CHANGE_OTHER if they differ, 0 otherwise
+ */
+static u32 gni_diff_igw(void *before, void *after) {
+    gni_internet_gateway *a = (gni_internet_gateway *) before;
+    gni_internet_gateway *b = (gni_internet_gateway *) after;
+
+    return (strcmp(a->accountId, b->accountId) ? GNI_DIFF_CHANGE_OTHER : 0);
+}
+
+/**
+ * Compares two versions of a DHCP option set.
+ *
+ * @param before [in] the gni_dhcp_os in the older GNI
+ * @param after [in] the gni_dhcp_os in the newer GNI
+ *
+ * @return GNI_DIFF_CHANGE_OTHER if they differ, 0 otherwise
+ */
+static u32 gni_diff_dhcpos(void *before, void *after) {
+    gni_dhcp_os *a = (gni_dhcp_os *) before;
+    gni_dhcp_os *b = (gni_dhcp_os *) after;
+
+    if (strcmp(a->accountId, b->accountId) || (a->netbios_type != b->netbios_type) || (a->max_dns != b->max_dns) || (a->max_ntp != b->max_ntp)
+        || (a->max_netbios_ns != b->max_netbios_ns) || (a->max_domains != b->max_domains)) {
+        return (GNI_DIFF_CHANGE_OTHER);
+    }
+    if ((a->max_dns && memcmp(a->dns, b->dns, a->max_dns * sizeof (u32))) || (a->max_ntp && memcmp(a->ntp, b->ntp, a->max_ntp * sizeof (u32)))
+        || (a->max_netbios_ns && memcmp(a->netbios_ns, b->netbios_ns, a->max_netbios_ns * sizeof (u32)))) {
+        return (GNI_DIFF_CHANGE_OTHER);
+    }
+    for (int i = 0; i < a->max_domains; i++) {
+        if (strcmp(a->domains[i].name, b->domains[i].name)) {
+            return (GNI_DIFF_CHANGE_OTHER);
+        }
+    }
+    return (0);
+}
+
+/**
+ * Appends an entry to a set of differences.
+ *
+ * @param set [in] the set of differences
+ * @param name [in] name of the object
+ * @param before [in] the object in the older GNI, NULL if it was added
+ * @param after [in] the object in the newer GNI, NULL if it was removed
+ * @param changes [in] GNI_DIFF_CHANGE_* properties that differ
+ */
+static void gni_diff_add(gni_diff_set *set, const char *name, void *before, void *after, u32 changes) {
+    gni_diff_entry *entry = NULL;
+
+    if ((set->max_entries % 32) == 0) {
+        set->entries = EUCA_REALLOC_C(set->entries, set->max_entries + 32, sizeof (gni_diff_entry));
+    }
+    entry = &(set->entries[set->max_entries++]);
+    entry->name = name;
+    entry->before = before;
+    entry->after = after;
+    entry->changes = changes;
+}
+
+/**
+ * Computes the differences between two versions of an array of GNI objects. Objects
+ * are matched by name using the GNI indexes; arrays without an index get a temporary one.
+ *
+ * @param set [out] the set of differences, assumed empty
+ * @param keyof [in] returns the name of an object of the arrays
+ * @param size [in] size of the objects of the arrays, 0 for arrays of pointers to objects
+ * @param cmpfn [in] compares two versions of an object
+ * @param beforebase [in] the array in the older GNI
+ * @param max_before [in] number of objects in the older GNI
+ * @param beforeindex [in] index of the array of the older GNI. Can be NULL.
+ * @param afterbase [in] the array in the newer GNI
+ * @param max_after [in] number of objects in the newer GNI
+ * @param afterindex [in] index of the array of the newer GNI. Can be NULL.
+ */
+static void gni_diff_set_build(gni_diff_set *set, euca_strindex_key_fn keyof, size_t size, gni_diff_cmp_fn cmpfn, void *beforebase, int max_before,
+                               euca_strindex *beforeindex, void *afterbase, int max_after, euca_strindex *afterindex) {
+#define GNI_DIFF_OBJECT(_base, _idx)     ((size) ? (void *)((char *)(_base) + ((_idx) * (size))) : ((void **)(_base))[(_idx)])
+
+    int i = 0;
+    int idx = 0;
+    u32 changes = 0;
+    const char *name = NULL;
+    euca_strindex tmpbefore = { 0 };
+    euca_strindex tmpafter = { 0 };
+
+    if (!beforeindex || ((beforeindex->size == 0) && (max_before > 0))) {
+        euca_strindex_rebuild(&tmpbefore, max_before, keyof, beforebase);
+        beforeindex = &tmpbefore;
+    }
+    if (!afterindex || ((afterindex->size == 0) && (max_after > 0))) {
+        euca_strindex_rebuild(&tmpafter, max_after, keyof, afterbase);
+        afterindex = &tmpafter;
+    }
+
+    for (i = 0; i < max_after; i++) {
+        name = keyof(afterbase, i);
+        if ((idx = gni_index_lookup(beforeindex, name, NULL, keyof, beforebase, max_before)) < 0) {
+            gni_diff_add(set, name, NULL, GNI_DIFF_OBJECT(afterbase, i), 0);
+            set->added++;
+        } else if ((changes = cmpfn(GNI_DIFF_OBJECT(beforebase, idx), GNI_DIFF_OBJECT(afterbase, i))) != 0) {
+            gni_diff_add(set, name, GNI_DIFF_OBJECT(beforebase, idx), GNI_DIFF_OBJECT(afterbase, i), changes);
+            set->modified++;
+        }
+    }
+    for (i = 0; i < max_before; i++) {
+        name = keyof(beforebase, i);
+        if (gni_index_lookup(afterindex, name, NULL, keyof, afterbase, max_after) < 0) {
+            gni_diff_add(set, name, GNI_DIFF_OBJECT(beforebase, i), NULL, 0);
+            set->removed++;
+        }
+    }
+    euca_strindex_rebuild(&(set->index), set->max_entries, gni_diff_entry_key, set->entries);
+
+    euca_strindex_clear(&tmpbefore);
+    euca_strindex_clear(&tmpafter);
+
+#undef GNI_DIFF_OBJECT
+}
+
+/**
+ * Computes the structural differences between two GNI versions: the instances,
+ * interfaces, security groups, VPCs, internet gateways and DHCP option sets that
+ * were added, removed or modified, and the configuration changes. The entries
+ * point to objects of both GNI, which must be kept until the diff is cleared.
+ *
+ * @param before [in] the older GNI, typically the last applied one
+ * @param after [in] the newer GNI
+ * @param diff [out] the differences. Must be zeroed or cleared with gni_diff_clear().
+ *
+ * @return 0 on success or 1 on failure
+ *
+ * @see gni_diff_find(), gni_diff_clear()
+ */
+int gni_diff_build(globalNetworkInfo *before, globalNetworkInfo *after, gni_diff *diff) {
+    struct timeval tv = { 0 };
+    gni_diff_set *sets = NULL;
+
+    if (!before || !after || !diff) {
+        LOGWARN("Invalid argument: cannot diff NULL GNI\n");
+        return (1);
+    }
+
+    eucanetd_timer_usec(&tv);
+    gni_diff_clear(diff);
+    diff->before = before;
+    diff->after = after;
+    diff->config = cmp_gni_config(before, after);
+
+    sets = diff->sets;
+    gni_diff_set_build(&(sets[GNI_DIFF_INSTANCES]), gni_instance_key, 0, gni_diff_instance, before->instances, before->max_instances,
+                       &(before->instance_index), after->instances, after->max_instances, &(after->instance_index));
+    gni_diff_set_build(&(sets[GNI_DIFF_INTERFACES]), gni_instance_key, 0, gni_diff_instance, before->ifs, before->max_ifs, &(before->if_index),
+                       after->ifs, after->max_ifs, &(after->if_index));
+    gni_diff_set_build(&(sets[GNI_DIFF_SECGROUPS]), gni_secgroup_key, sizeof (gni_secgroup), gni_diff_secgroup, before->secgroups,
+                       before->max_secgroups, &(before->secgroup_index), after->secgroups, after->max_secgroups, &(after->secgroup_index));
+    gni_diff_set_build(&(sets[GNI_DIFF_VPCS]), gni_vpc_key, sizeof (gni_vpc), gni_diff_vpc, before->vpcs, before->max_vpcs, &(before->vpc_index),
+                       after->vpcs, after->max_vpcs, &(after->vpc_index));
+    gni_diff_set_build(&(sets[GNI_DIFF_VPCIGWS]), gni_igw_key, sizeof (gni_internet_gateway), gni_diff_igw, before->vpcIgws, before->max_vpcIgws,
+                       NULL, after->vpcIgws, after->max_vpcIgws, NULL);
+    gni_diff_set_build(&(sets[GNI_DIFF_DHCPOS]), gni_dhcpos_key, sizeof (gni_dhcp_os), gni_diff_dhcpos, before->dhcpos, before->max_dhcpos,
+                       &(before->dhcpos_index), after->dhcpos, after->max_dhcpos, &(after->dhcpos_index));
+
+    LOGDEBUG("gni diff %s -> %s in %ld us: config %x, instances +%d -%d ~%d, interfaces +%d -%d ~%d, secgroups +%d -%d ~%d, vpcs +%d -%d ~%d\n",
+             before->version, after->version, eucanetd_timer_usec(&tv), diff->config, sets[GNI_DIFF_INSTANCES].added, sets[GNI_DIFF_INSTANCES].removed,
+             sets[GNI_DIFF_INSTANCES].modified, sets[GNI_DIFF_INTERFACES].added, sets[GNI_DIFF_INTERFACES].removed, sets[GNI_DIFF_INTERFACES].modified,
+             sets[GNI_DIFF_SECGROUPS].added, sets[GNI_DIFF_SECGROUPS].removed, sets[GNI_DIFF_SECGROUPS].modified, sets[GNI_DIFF_VPCS].added,
+             sets[GNI_DIFF_VPCS].removed, sets[GNI_DIFF_VPCS].modified);
+    return (0);
+}
+
+/**
+ * Looks up the change of an object between the two GNI versions of a diff.
+ *
+ * @param diff [in] the differences computed by gni_diff_build()
+ * @param type [in] type of the object (see gni_diff_type_t)
+ * @param name [in] name of the object
+ *
+ * @return the entry of the object, or NULL if it did not change
+ */
+gni_diff_entry *gni_diff_find(gni_diff *diff, int type, const char *name) {
+    int idx = 0;
+    gni_diff_set *set = NULL;
+
+    if (!diff || !name || (type < 0) || (type >= GNI_DIFF_TYPES)) {
+        return (NULL);
+    }
+    set = &(diff->sets[type]);
+    if ((idx = euca_strindex_find(&(set->index), name, gni_diff_entry_key, set->entries)) < 0) {
+        return (NULL);
+    }
+    return (&(set->entries[idx]));
+}
+
+/**
+ * Returns the version of an object of the newer GNI of a diff in the older GNI.
+ * Objects that did not change are their own older version, so that comparing both
+ * versions with the cmp_gni_xxx() functions finds no difference right away.
+ *
+ * @param diff [in] the differences computed by gni_diff_build()
+ * @param type [in] type of the object (see gni_diff_type_t)
+ * @param name [in] name of the object
+ * @param after [in] the object in the newer GNI
+ *
+ * @return the object in the older GNI, after if it did not change, or NULL if it was added
+ */
+void *gni_diff_get_before(gni_diff *diff, int type, const char *name, void *after) {
+    gni_diff_entry *entry = NULL;
+
+    if ((entry = gni_diff_find(diff, type, name)) == NULL) {
+        return (after);
     }
-    return (1);
+    return (entry->before);
 }
 
 /**
- * Compares gni_mido_gateway structures a and b.
+ * Returns the number of objects that were added, removed or modified between the two
+ * GNI versions of a diff. Configuration changes are not counted (see gni_diff.config).
  *
- * @param a [in] gni_instance structure of interest.
- * @param b [in] gni_instance structure of interest.
- * @return 0 if name and other properties of a and b match. Non-zero otherwise.
+ * @param diff [in] the differences computed by gni_diff_build()
+ *
+ * @return the number of objects that differ
  */
-int cmp_gni_mido_gateway(gni_mido_gateway *a, gni_mido_gateway *b) {
-    int abmatch = 1;
-    if (a == b) {
+int gni_diff_count(gni_diff *diff) {
+    int count = 0;
+
+    if (!diff) {
         return (0);
     }
-    if ((a == NULL) || (b == NULL)) {
-        return (1);
-    }
-    if (strcmp(a->host, b->host)) {
-        abmatch = 0;
-    } else {
-        if (a->asn != b->asn) {
-            abmatch = 0;
-        }
-        if (a->peer_asn != b->peer_asn) {
-            abmatch = 0;
-        }
-        if (strcmp(a->ext_ip, b->ext_ip)) {
-            abmatch = 0;
-        }
-        if (strcmp(a->ext_dev, b->ext_dev)) {
-            abmatch = 0;
-        }
-        if (strcmp(a->ext_cidr, b->ext_cidr)) {
-            abmatch = 0;
-        }
-        if (strcmp(a->peer_ip, b->peer_ip)) {
-            abmatch = 0;
-        }
-        if (a->max_ad_routes != b->max_ad_routes) {
-            abmatch = 0;
-        } else {
-            for (int i = 0; i < a->max_ad_routes; i++) {
-                if (strcmp(a->ad_routes[i], b->ad_routes[i])) {
-                    abmatch = 0;
-                    break;
-                }
-            }
-        }
+    for (int i = 0; i < GNI_DIFF_TYPES; i++) {
+        count += diff->sets[i].max_entries;
     }
+    return (count);
+}
 
-    if (abmatch) {
-        return (0);
+/**
+ * Releases the memory held by a diff and zeroes it out.
+ *
+ * @param diff [in] the differences to clear
+ */
+void gni_diff_clear(gni_diff *diff) {
+    if (!diff) {
+        return;
     }
-    return (1);
+    for (int i = 0; i < GNI_DIFF_TYPES; i++) {
+        EUCA_FREE(diff->sets[i].entries);
+        euca_strindex_clear(&(diff->sets[i].index));
+    }
+    memset(diff, 0, sizeof (gni_diff));
 }
 
 /**
@@ -6758,3 +8795,802 @@ int compare_gni_interface_name(const void *p1, const void *p2) {
     return (strcmp(name1, name2));
 }
 
+
+#ifdef _UNIT_TEST
+#include <sys/time.h>
+
+#define TEST_INSTANCES                         20000    //!< Default number of instances in the synthetic GNI
+#define TEST_SECGROUPS                          5000    //!< Default number of security groups in the synthetic GNI
+#define TEST_SECGROUP_RULES                        4    //!< Number of ingress rules per security group
+#define TEST_NODES                               100    //!< Number of nodes the instances are spread across
+#define TEST_LOOKUP_INSTANCES                   8000    //!< Number of instances of the lookup benchmark, 10000 interfaces in a single VPC
+
+/**
+ * Returns the current time in microseconds
+ *
+ * @return the current time in microseconds
+ */
+static long long test_now_usec(void) {
+    struct timeval tv = { 0 };
+
+    gettimeofday(&tv, NULL);
+    return (((long long)tv.tv_sec) * 1000000LL + tv.tv_usec);
+}
+
+/**
+ * Writes a synthetic GNI document. In VPCMIDO mode, every instance has a primary
+ * network interface and every fourth one a secondary interface, and the document
+ * carries a mido section, VPCs, internet gateways and DHCP option sets.
+ *
+ * @param path [in] path of the file to write
+ * @param vpcmido [in] set to write a VPCMIDO document, EDGE otherwise
+ * @param ninstances [in] number of instances
+ * @param nsecgroups [in] number of security groups
+ * @param nvpcs [in] number of VPCs the instances are spread across
+ *
+ * @return 0 on success or 1 on failure
+ */
+static int test_write_gni(const char *path, boolean vpcmido, int ninstances, int nsecgroups, int nvpcs) {
+    int i = 0;
+    int j = 0;
+    FILE *fh = NULL;
+
+    if ((fh = fopen(path, "w")) == NULL) {
+        return (1);
+    }
+
+    fprintf(fh, "<network-data version=\"%d\" applied-version=\"%d\">\n", ninstances, ninstances - 1);
+    fprintf(fh, "  <configuration>\n");
+    fprintf(fh, "    <property name=\"mode\"><value>%s</value></property>\n", (vpcmido ? "VPCMIDO" : "EDGE"));
+    fprintf(fh, "    <property name=\"enabledCLCIp\"><value>10.111.1.1</value></property>\n");
+    fprintf(fh, "    <property name=\"instanceDNSDomain\"><value>eucalyptus.internal</value></property>\n");
+    fprintf(fh, "    <property name=\"instanceDNSServers\"><value>10.111.1.2</value><value>10.111.1.3</value></property>\n");
+    if (vpcmido) {
+        fprintf(fh, "    <property name=\"mido\">\n");
+        fprintf(fh, "      <property name=\"publicNetworkCidr\"><value>10.116.0.0/16</value></property>\n");
+        fprintf(fh, "      <property name=\"bgpAsn\"><value>64512</value></property>\n");
+        fprintf(fh, "      <property name=\"gateways\">\n");
+        for (i = 0; i < 2; i++) {
+            fprintf(fh, "        <gateway><property name=\"ip\"><value>10.111.5.%d</value></property>"
+                    "<property name=\"externalCidr\"><value>10.116.128.0/17</value></property>"
+                    "<property name=\"externalIp\"><value>10.116.133.%d</value></property>"
+                    "<property name=\"externalDevice\"><value>em1.116</value></property>"
+                    "<property name=\"bgpPeerIp\"><value>10.116.133.1%d</value></property>"
+                    "<property name=\"bgpPeerAsn\"><value>6500%d</value></property>"
+                    "<property name=\"bgpAdRoutes\"><value>10.116.%d.0/24</value><value>10.117.%d.0/24</value></property></gateway>\n", i + 10, i + 20, i, i,
+                    i, i);
+        }
+        fprintf(fh, "      </property>\n");
+        fprintf(fh, "    </property>\n");
+    } else {
+        fprintf(fh, "    <property name=\"publicIps\"><value>10.116.0.10-10.116.255.250</value></property>\n");
+        fprintf(fh, "    <property name=\"subnets\"><subnet name=\"172.16.0.0\"><property name=\"subnet\"><value>172.16.0.0</value></property>"
+                "<property name=\"netmask\"><value>255.255.0.0</value></property><property name=\"gateway\"><value>172.16.0.1</value></property></subnet></property>\n");
+    }
+    fprintf(fh, "    <property name=\"clusters\"><cluster name=\"cluster0\">\n");
+    fprintf(fh, "      <property name=\"enabledCCIp\"><value>10.111.1.4</value></property>\n");
+    fprintf(fh, "      <property name=\"macPrefix\"><value>d0:0d</value></property>\n");
+    if (!vpcmido) {
+        fprintf(fh, "      <subnet name=\"172.16.0.0\"><property name=\"subnet\"><value>172.16.0.0</value></property>"
+                "<property name=\"netmask\"><value>255.255.0.0</value></property><property name=\"gateway\"><value>172.16.0.1</value></property></subnet>\n");
+        fprintf(fh, "      <property name=\"privateIps\"><value>172.16.0.10-172.16.255.250</value></property>\n");
+    }
+    fprintf(fh, "      <property name=\"nodes\">\n");
+    for (i = 0; i < TEST_NODES; i++) {
+        fprintf(fh, "        <node name=\"10.111.10.%d\"><instanceIds>", i + 1);
+        for (j = i; j < ninstances; j += TEST_NODES) {
+            fprintf(fh, "<value>i-%08x</value>", j);
+        }
+        fprintf(fh, "</instanceIds></node>\n");
+    }
+    fprintf(fh, "      </property>\n");
+    fprintf(fh, "    </cluster></property>\n");
+    fprintf(fh, "  </configuration>\n");
+
+    fprintf(fh, "  <instances>\n");
+    for (i = 0; i < ninstances; i++) {
+        fprintf(fh, "    <instance name=\"i-%08x\"><ownerId>%012d</ownerId><macAddress>d0:0d:%02x:%02x:%02x:%02x</macAddress>"
+                "<publicIp>10.116.%d.%d</publicIp><privateIp>172.16.%d.%d</privateIp>", i, i % 7, (i >> 24) & 0xff, (i >> 16) & 0xff, (i >> 8) & 0xff,
+                i & 0xff, (i >> 8) & 0xff, i & 0xff, (i >> 8) & 0xff, i & 0xff);
+        if (vpcmido) {
+            fprintf(fh, "<vpc>vpc-%08x</vpc><subnet>subnet-%08x</subnet>", i % nvpcs, i % nvpcs);
+        }
+        fprintf(fh, "<securityGroups><value>sg-%08x</value><value>sg-%08x</value></securityGroups>", i % nsecgroups, (i * 7 + 3) % nsecgroups);
+        if (vpcmido) {
+            fprintf(fh, "<networkInterfaces>");
+            for (j = 0; j < (((i % 4) == 0) ? 2 : 1); j++) {
+                fprintf(fh, "<networkInterface name=\"eni-%08x\"><ownerId>%012d</ownerId><macAddress>d0:0d:%02x:%02x:%02x:%02x</macAddress>"
+                        "<publicIp>10.116.%d.%d</publicIp><privateIp>172.%d.%d.%d</privateIp><vpc>vpc-%08x</vpc><subnet>subnet-%08x</subnet>"
+                        "<securityGroups><value>sg-%08x</value></securityGroups><attachmentId>eni-attach-%08x</attachmentId>"
+                        "<sourceDestCheck>%s</sourceDestCheck><deviceIndex>%d</deviceIndex></networkInterface>", (i << 1) + j, i % 7, j, (i >> 16) & 0xff,
+                        (i >> 8) & 0xff, i & 0xff, (i >> 8) & 0xff, i & 0xff, 16 + j, (i >> 8) & 0xff, i & 0xff, i % nvpcs, i % nvpcs, (i + j) % nsecgroups,
+                        (i << 1) + j, (j ? "false" : "true"), j);
+            }
+            fprintf(fh, "</networkInterfaces>");
+        }
+        fprintf(fh, "</instance>\n");
+    }
+    fprintf(fh, "  </instances>\n");
+
+    fprintf(fh, "  <securityGroups>\n");
+    for (i = 0; i < nsecgroups; i++) {
+        fprintf(fh, "    <securityGroup name=\"sg-%08x\"><ownerId>%012d</ownerId><ingressRules>", i, i % 7);
+        for (j = 0; j < TEST_SECGROUP_RULES; j++) {
+            if (j == 0) {
+                fprintf(fh, "<rule><protocol>-1</protocol><groupId>sg-%08x</groupId><groupOwnerId>%012d</groupOwnerId></rule>", (i + 1) % nsecgroups,
+                        (i + 1) % 7);
+            } else {
+                fprintf(fh, "<rule><protocol>%d</protocol><cidr>10.%d.%d.0/24</cidr><fromPort>%d</fromPort><toPort>%d</toPort></rule>",
+                        ((j % 2) ? 6 : 17), j, i & 0xff, 1000 + j, 2000 + j);
+            }
+        }
+        fprintf(fh, "</ingressRules>");
+        if (vpcmido) {
+            fprintf(fh, "<egressRules><rule><protocol>1</protocol><cidr>0.0.0.0/0</cidr><icmpType>8</icmpType><icmpCode>-1</icmpCode></rule></egressRules>");
+        }
+        fprintf(fh, "</securityGroup>\n");
+    }
+    fprintf(fh, "  </securityGroups>\n");
+
+    if (vpcmido) {
+        fprintf(fh, "  <vpcs>\n");
+        for (i = 0; i < nvpcs; i++) {
+            fprintf(fh, "    <vpc name=\"vpc-%08x\"><ownerId>%012d</ownerId><cidr>172.16.0.0/12</cidr><dhcpOptionSet>dopt-%08x</dhcpOptionSet>"
+                    "<subnets><subnet name=\"subnet-%08x\"><ownerId>%012d</ownerId><cidr>172.16.0.0/16</cidr><cluster>cluster0</cluster>"
+                    "<networkAcl>acl-%08x</networkAcl><routeTable>rtb-%08x</routeTable></subnet></subnets>"
+                    "<networkAcls><networkAcl name=\"acl-%08x\"><ownerId>%012d</ownerId>"
+                    "<ingressEntries><entry number=\"100\"><action>allow</action><protocol>-1</protocol><cidr>0.0.0.0/0</cidr></entry></ingressEntries>"
+                    "<egressEntries><entry number=\"100\"><action>allow</action><protocol>6</protocol><cidr>10.0.0.0/8</cidr>"
+                    "<portRangeFrom>80</portRangeFrom><portRangeTo>443</portRangeTo></entry>"
+                    "<entry number=\"32767\"><action>deny</action><protocol>-1</protocol><cidr>0.0.0.0/0</cidr></entry></egressEntries></networkAcl></networkAcls>"
+                    "<routeTables><routeTable name=\"rtb-%08x\"><ownerId>%012d</ownerId><routes>"
+                    "<route><destinationCidr>172.16.0.0/12</destinationCidr><gatewayId>local</gatewayId></route>"
+                    "<route><destinationCidr>0.0.0.0/0</destinationCidr><gatewayId>igw-%08x</gatewayId></route>"
+                    "<route><destinationCidr>192.168.0.0/16</destinationCidr><networkInterfaceId>eni-%08x</networkInterfaceId></route>"
+                    "</routes></routeTable></routeTables>"
+                    "<natGateways><natGateway name=\"nat-%08x\"><ownerId>%012d</ownerId><macAddress>d0:0d:ff:00:%02x:%02x</macAddress>"
+                    "<publicIp>10.117.%d.%d</publicIp><privateIp>172.31.%d.%d</privateIp><vpc>vpc-%08x</vpc><subnet>subnet-%08x</subnet></natGateway></natGateways>"
+                    "<internetGateways><value>igw-%08x</value></internetGateways></vpc>\n", i, i % 7, i, i, i % 7, i, i, i, i % 7, i, i % 7, i, i << 1,
+                    i, i % 7, (i >> 8) & 0xff, i & 0xff, (i >> 8) & 0xff, i & 0xff, (i >> 8) & 0xff, i & 0xff, i, i, i);
+        }
+        fprintf(fh, "  </vpcs>\n");
+
+        fprintf(fh, "  <internetGateways>\n");
+        for (i = 0; i < nvpcs; i++) {
+            fprintf(fh, "    <internetGateway name=\"igw-%08x\"><ownerId>%012d</ownerId></internetGateway>\n", i, i % 7);
+        }
+        fprintf(fh, "  </internetGateways>\n");
+
+        fprintf(fh, "  <dhcpOptionSets>\n");
+        for (i = 0; i < nvpcs; i++) {
+            fprintf(fh, "    <dhcpOptionSet name=\"dopt-%08x\"><ownerId>%012d</ownerId>"
+                    "<property name=\"domain-name\"><value>eucalyptus.internal</value><value>vpc%d.internal</value></property>"
+                    "<property name=\"domain-name-servers\"><value>10.111.1.2</value></property>"
+                    "<property name=\"ntp-servers\"><value>10.111.1.5</value><value>10.111.1.6</value></property>"
+                    "<property name=\"netbios-name-servers\"><value>10.111.1.7</value></property>"
+                    "<property name=\"netbios-node-type\"><value>2</value></property></dhcpOptionSet>\n", i, i % 7, i);
+        }
+        fprintf(fh, "  </dhcpOptionSets>\n");
+    }
+    fprintf(fh, "</network-data>\n");
+    fclose(fh);
+    return (0);
+}
+
+/**
+ * Dumps a list of security group rules
+ *
+ * @param fh [in] stream to write to
+ * @param rules [in] list of rules
+ * @param max_rules [in] number of rules in the list
+ */
+static void test_dump_rules(FILE *fh, gni_rule *rules, int max_rules) {
+    for (int i = 0; i < max_rules; i++) {
+        fprintf(fh, "  rule %d %d %d %d %d %d/%d %s %s %s\n", rules[i].protocol, rules[i].fromPort, rules[i].toPort, rules[i].icmpType, rules[i].icmpCode,
+                rules[i].cidrNetaddr, rules[i].cidrSlashnet, rules[i].cidr, rules[i].groupId, rules[i].groupOwnerId);
+    }
+}
+
+/**
+ * Dumps an instance or an interface
+ *
+ * @param fh [in] stream to write to
+ * @param gi [in] instance or interface to dump
+ */
+static void test_dump_instance(FILE *fh, gni_instance *gi) {
+    fprintf(fh, "instance %s %s %s %s %02x:%02x:%02x:%02x:%02x:%02x %x %x %s %s %s %d %d %s %d\n", gi->name, gi->ifname, gi->attachmentId, gi->accountId,
+            gi->macAddress[0], gi->macAddress[1], gi->macAddress[2], gi->macAddress[3], gi->macAddress[4], gi->macAddress[5], gi->publicIp, gi->privateIp,
+            gi->vpc, gi->subnet, gi->node, gi->srcdstcheck, gi->deviceidx, gi->instance_name.name, gi->max_interfaces);
+    for (int i = 0; i < gi->max_secgroup_names; i++) {
+        fprintf(fh, "  sg %s %s\n", gi->secgroup_names[i].name, (gi->gnisgs[i] ? gi->gnisgs[i]->name : "-"));
+    }
+    for (int i = 0; i < gi->max_interfaces; i++) {
+        fprintf(fh, "  if %s\n", gi->interfaces[i]->ifname);
+    }
+}
+
+/**
+ * Dumps everything a GNI holds, following links by name, so that two GNI populated
+ * from the same document can be compared.
+ *
+ * @param gni [in] GNI to dump
+ *
+ * @return the dump. The caller must free it.
+ */
+static char *test_dump_gni(globalNetworkInfo *gni) {
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *fh = NULL;
+
+    fh = open_memstream(&buf, &len);
+    fprintf(fh, "gni %s %s %s %d %x %s\n", gni->version, gni->appliedVersion, gni->sMode, gni->nmCode, gni->enabledCLCIp, gni->instanceDNSDomain);
+    for (i = 0; i < gni->max_instanceDNSServers; i++) {
+        fprintf(fh, "dns %x\n", gni->instanceDNSServers[i]);
+    }
+    for (i = 0; i < gni->max_public_ips_str; i++) {
+        fprintf(fh, "publicip %s\n", gni->public_ips_str[i]);
+    }
+    for (i = 0; i < gni->max_midogws; i++) {
+        gni_mido_gateway *gw = &(gni->midogws[i]);
+        fprintf(fh, "midogw %s %s %s %s %s %u %u\n", gw->host, gw->ext_ip, gw->ext_dev, gw->ext_cidr, gw->peer_ip, gw->peer_asn, gw->asn);
+        for (j = 0; j < gw->max_ad_routes; j++) {
+            fprintf(fh, "  route %s\n", gw->ad_routes[j]);
+        }
+    }
+    for (i = 0; i < gni->max_subnets; i++) {
+        fprintf(fh, "subnet %x %x %x\n", gni->subnets[i].subnet, gni->subnets[i].netmask, gni->subnets[i].gateway);
+    }
+    for (i = 0; i < gni->max_clusters; i++) {
+        gni_cluster *cluster = &(gni->clusters[i]);
+        fprintf(fh, "cluster %s %x %s %x %x %x\n", cluster->name, cluster->enabledCCIp, cluster->macPrefix, cluster->private_subnet.subnet,
+                cluster->private_subnet.netmask, cluster->private_subnet.gateway);
+        for (j = 0; j < cluster->max_private_ips_str; j++) {
+            fprintf(fh, "  privateip %s\n", cluster->private_ips_str[j]);
+        }
+        for (j = 0; j < cluster->max_nodes; j++) {
+            fprintf(fh, "  node %s\n", cluster->nodes[j].name);
+            for (k = 0; k < cluster->nodes[j].max_instance_names; k++) {
+                fprintf(fh, "    instance %s\n", cluster->nodes[j].instance_names[k].name);
+            }
+        }
+    }
+    for (i = 0; i < gni->max_instances; i++) {
+        test_dump_instance(fh, gni->instances[i]);
+    }
+    for (i = 0; i < gni->max_ifs; i++) {
+        test_dump_instance(fh, gni->ifs[i]);
+    }
+    for (i = 0; i < gni->max_secgroups; i++) {
+        gni_secgroup *sg = &(gni->secgroups[i]);
+        fprintf(fh, "secgroup %s %s\n", sg->name, sg->accountId);
+        test_dump_rules(fh, sg->ingress_rules, sg->max_ingress_rules);
+        test_dump_rules(fh, sg->egress_rules, sg->max_egress_rules);
+        for (j = 0; j < sg->max_instances; j++) {
+            fprintf(fh, "  instance %s\n", sg->instances[j]->name);
+        }
+        for (j = 0; j < sg->max_interfaces; j++) {
+            fprintf(fh, "  interface %s\n", sg->interfaces[j]->ifname);
+        }
+    }
+    for (i = 0; i < gni->max_vpcs; i++) {
+        gni_vpc *vpc = &(gni->vpcs[i]);
+        fprintf(fh, "vpc %s %s %s %s %s\n", vpc->name, vpc->accountId, vpc->cidr, vpc->dhcpOptionSet_name, (vpc->dhcpOptionSet ? vpc->dhcpOptionSet->name : "-"));
+        for (j = 0; j < vpc->max_routeTables; j++) {
+            fprintf(fh, "  routetable %s %s\n", vpc->routeTables[j].name, vpc->routeTables[j].accountId);
+            for (k = 0; k < vpc->routeTables[j].max_entries; k++) {
+                fprintf(fh, "    route %s %s\n", vpc->routeTables[j].entries[k].destCidr, vpc->routeTables[j].entries[k].target);
+            }
+        }
+        for (j = 0; j < vpc->max_subnets; j++) {
+            gni_vpcsubnet *subnet = &(vpc->subnets[j]);
+            fprintf(fh, "  subnet %s %s %s %s %s %s %s %s %d\n", subnet->name, subnet->accountId, subnet->cidr, subnet->cluster_name, subnet->networkAcl_name,
+                    subnet->routeTable_name, (subnet->routeTable ? subnet->routeTable->name : "-"), (subnet->networkAcl ? subnet->networkAcl->name : "-"),
+                    subnet->max_interfaces);
+        }
+        for (j = 0; j < vpc->max_natGateways; j++) {
+            gni_nat_gateway *natg = &(vpc->natGateways[j]);
+            fprintf(fh, "  natgateway %s %s %02x:%02x:%02x:%02x:%02x:%02x %x %x %s %s\n", natg->name, natg->accountId, natg->macAddress[0], natg->macAddress[1],
+                    natg->macAddress[2], natg->macAddress[3], natg->macAddress[4], natg->macAddress[5], natg->publicIp, natg->privateIp, natg->vpc, natg->subnet);
+        }
+        for (j = 0; j < vpc->max_networkAcls; j++) {
+            gni_network_acl *acl = &(vpc->networkAcls[j]);
+            fprintf(fh, "  networkacl %s %s\n", acl->name, acl->accountId);
+            for (k = 0; k < acl->max_ingress; k++) {
+                fprintf(fh, "    ingress %d %d %d %d %d %d %d %s\n", acl->ingress[k].number, acl->ingress[k].allow, acl->ingress[k].protocol,
+                        acl->ingress[k].fromPort, acl->ingress[k].toPort, acl->ingress[k].icmpType, acl->ingress[k].icmpCode, acl->ingress[k].cidr);
+            }
+            for (k = 0; k < acl->max_egress; k++) {
+                fprintf(fh, "    egress %d %d %d %d %d %d %d %s\n", acl->egress[k].number, acl->egress[k].allow, acl->egress[k].protocol,
+                        acl->egress[k].fromPort, acl->egress[k].toPort, acl->egress[k].icmpType, acl->egress[k].icmpCode, acl->egress[k].cidr);
+            }
+        }
+        for (j = 0; j < vpc->max_internetGatewayNames; j++) {
+            fprintf(fh, "  igw %s\n", vpc->internetGatewayNames[j].name);
+        }
+        fprintf(fh, "  interfaces %d\n", vpc->max_interfaces);
+    }
+    for (i = 0; i < gni->max_vpcIgws; i++) {
+        fprintf(fh, "igw %s %s\n", gni->vpcIgws[i].name, gni->vpcIgws[i].accountId);
+    }
+    for (i = 0; i < gni->max_dhcpos; i++) {
+        gni_dhcp_os *dhcpos = &(gni->dhcpos[i]);
+        fprintf(fh, "dhcpos %s %s %d\n", dhcpos->name, dhcpos->accountId, dhcpos->netbios_type);
+        for (j = 0; j < dhcpos->max_domains; j++) {
+            fprintf(fh, "  domain %s\n", dhcpos->domains[j].name);
+        }
+        for (j = 0; j < dhcpos->max_dns; j++) {
+            fprintf(fh, "  dns %x\n", dhcpos->dns[j]);
+        }
+        for (j = 0; j < dhcpos->max_ntp; j++) {
+            fprintf(fh, "  ntp %x\n", dhcpos->ntp[j]);
+        }
+        for (j = 0; j < dhcpos->max_netbios_ns; j++) {
+            fprintf(fh, "  netbios %x\n", dhcpos->netbios_ns[j]);
+        }
+    }
+    fclose(fh);
+    return (buf);
+}
+
+/**
+ * Populates a GNI from a synthetic document with both the streaming and the XPath
+ * parsers, checks that they agree and reports how long each took. The streaming GNI
+ * is then cleared and populated again, reusing its arena.
+ *
+ * @param path [in] path of the file to use for the document
+ * @param vpcmido [in] set to test a VPCMIDO document, EDGE otherwise
+ * @param ninstances [in] number of instances
+ * @param nsecgroups [in] number of security groups
+ *
+ * @return the number of errors
+ */
+static int test_compare_parsers(const char *path, boolean vpcmido, int ninstances, int nsecgroups) {
+    int errors = 0;
+    int streamrc = 0;
+    int xpathrc = 0;
+    long long stream = 0;
+    long long xpath = 0;
+    size_t arena = 0;
+    char *streamdump = NULL;
+    char *xpathdump = NULL;
+    globalNetworkInfo *streamgni = NULL;
+    globalNetworkInfo *xpathgni = NULL;
+
+    if (test_write_gni(path, vpcmido, ninstances, nsecgroups, (ninstances / 50) + 1)) {
+        printf("cannot write %s\n", path);
+        return (1);
+    }
+
+    streamgni = gni_init();
+    stream = test_now_usec();
+    streamrc = gni_populate_v(GNI_POPULATE_ALL, streamgni, NULL, (char *)path);
+    stream = test_now_usec() - stream;
+
+    xpathgni = gni_init();
+    xpath = test_now_usec();
+    xpathrc = gni_populate_xpath(GNI_POPULATE_ALL, xpathgni, NULL, (char *)path);
+    xpath = test_now_usec() - xpath;
+
+    printf("%s: %d instances, %d interfaces, %d security groups, %d vpcs\n", (vpcmido ? "VPCMIDO" : "EDGE"), xpathgni->max_instances, xpathgni->max_ifs,
+           xpathgni->max_secgroups, xpathgni->max_vpcs);
+    printf("  streaming parser %.2f ms, xpath parser %.2f ms\n", stream / 1000.0, xpath / 1000.0);
+
+    if (streamrc || xpathrc) {
+        printf("  population failed: streaming rc=%d, xpath rc=%d\n", streamrc, xpathrc);
+        errors++;
+    }
+    streamdump = test_dump_gni(streamgni);
+    xpathdump = test_dump_gni(xpathgni);
+    if (strcmp(streamdump, xpathdump)) {
+        printf("  streaming and xpath GNI differ\n");
+        errors++;
+    }
+    EUCA_FREE(streamdump);
+
+    // clearing releases the arena in one shot and keeps its largest chunk for the next version
+    arena = streamgni->arena.size;
+    stream = test_now_usec();
+    gni_clear(streamgni);
+    stream = test_now_usec() - stream;
+    xpath = test_now_usec();
+    gni_clear(xpathgni);
+    xpath = test_now_usec() - xpath;
+    printf("  cleared arena (%zu bytes) in %.2f ms, xpath GNI in %.2f ms\n", arena, stream / 1000.0, xpath / 1000.0);
+
+    stream = test_now_usec();
+    streamrc = gni_populate_v(GNI_POPULATE_ALL, streamgni, NULL, (char *)path);
+    stream = test_now_usec() - stream;
+    printf("  streaming parser into a recycled arena %.2f ms (%zu bytes, %zu allocated)\n", stream / 1000.0, streamgni->arena.used, streamgni->arena.size);
+    streamdump = test_dump_gni(streamgni);
+    if (streamrc || strcmp(streamdump, xpathdump)) {
+        printf("  GNI populated into a recycled arena differs\n");
+        errors++;
+    }
+
+    EUCA_FREE(streamdump);
+    EUCA_FREE(xpathdump);
+    GNI_FREE(streamgni);
+    GNI_FREE(xpathgni);
+    unlink(path);
+    return (errors);
+}
+
+/**
+ * Looks up an interface of a VPC subnet the way gni_get_interface() used to
+ *
+ * @param vpcsubnet [in] subnet of interest
+ * @param name [in] name of the interface
+ *
+ * @return the first interface with that name or NULL
+ */
+static gni_instance *test_linear_interface(gni_vpcsubnet *vpcsubnet, char *name) {
+    for (int i = 0; i < vpcsubnet->max_interfaces; i++) {
+        if (!strcmp(name, vpcsubnet->interfaces[i]->name)) {
+            return (vpcsubnet->interfaces[i]);
+        }
+    }
+    return (NULL);
+}
+
+/**
+ * Looks up an interface by interface ID, or by instance ID for primary interfaces,
+ * with a linear scan of all interfaces
+ *
+ * @param gni [in] GNI of interest
+ * @param name [in] interface or instance ID
+ *
+ * @return the first interface with that interface ID, else the first one of that instance, or NULL
+ */
+static gni_instance *test_linear_find_interface(globalNetworkInfo *gni, const char *name) {
+    for (int i = 0; i < gni->max_ifs; i++) {
+        if (!strcmp(name, gni->ifs[i]->ifname)) {
+            return (gni->ifs[i]);
+        }
+    }
+    for (int i = 0; i < gni->max_ifs; i++) {
+        if (!strcmp(name, gni->ifs[i]->name)) {
+            return (gni->ifs[i]);
+        }
+    }
+    return (NULL);
+}
+
+/**
+ * Looks every interface of a large single VPC topology up, along with its VPC,
+ * subnet, instance and security group, with the indexed GNI helpers and with
+ * linear scans, checks that they agree and reports how long each took.
+ *
+ * @param path [in] path of the file to use for the document
+ * @param ninstances [in] number of instances
+ * @param nsecgroups [in] number of security groups
+ *
+ * @return the number of errors
+ */
+static int test_lookups(const char *path, int ninstances, int nsecgroups) {
+    int i = 0;
+    int j = 0;
+    int rc = 0;
+    int errors = 0;
+    int max_ref = 0;
+    long long indexed = 0;
+    long long linear = 0;
+    gni_vpc *vpc = NULL;
+    gni_vpcsubnet *vpcsubnet = NULL;
+    gni_instance *gi = NULL;
+    gni_instance *found = NULL;
+    gni_instance *instance = NULL;
+    gni_instance **ref = NULL;
+    gni_secgroup *secgroup = NULL;
+    globalNetworkInfo *gni = NULL;
+    void **found_indexed = NULL;
+    void **found_linear = NULL;
+
+    if (test_write_gni(path, TRUE, ninstances, nsecgroups, 1)) {
+        printf("cannot write %s\n", path);
+        return (1);
+    }
+    gni = gni_init();
+    indexed = test_now_usec();
+    rc = gni_populate_v(GNI_POPULATE_ALL, gni, NULL, (char *)path);
+    indexed = test_now_usec() - indexed;
+    unlink(path);
+    if (rc || (gni->max_vpcs != 1) || (gni->vpcs[0].max_subnets != 1)) {
+        printf("lookups: population failed\n");
+        GNI_FREE(gni);
+        return (1);
+    }
+    printf("lookups: %d interfaces in a single VPC, populated in %.2f ms\n", gni->max_ifs, indexed / 1000.0);
+
+    // The grouped VPC and subnet lists must match the ones built by a search
+    vpc = &(gni->vpcs[0]);
+    vpcsubnet = &(vpc->subnets[0]);
+    linear = test_now_usec();
+    gni_vpc_get_interfaces(gni, vpc, &ref, &max_ref);
+    linear = test_now_usec() - linear;
+    if ((max_ref != vpc->max_interfaces) || (max_ref && memcmp(ref, vpc->interfaces, max_ref * sizeof (gni_instance *)))) {
+        printf("  VPC interfaces differ\n");
+        errors++;
+    }
+    printf("  gni_vpc_get_interfaces() %.2f ms\n", linear / 1000.0);
+    EUCA_FREE(ref);
+    gni_vpcsubnet_get_interfaces(gni, vpcsubnet, vpc->interfaces, vpc->max_interfaces, &ref, &max_ref);
+    if ((max_ref != vpcsubnet->max_interfaces) || (max_ref && memcmp(ref, vpcsubnet->interfaces, max_ref * sizeof (gni_instance *)))) {
+        printf("  VPC subnet interfaces differ\n");
+        errors++;
+    }
+    EUCA_FREE(ref);
+
+    // Each interface is looked up along with its VPC, subnet, instance and security group
+    found_indexed = EUCA_ZALLOC_C(4 * gni->max_ifs, sizeof (void *));
+    found_linear = EUCA_ZALLOC_C(4 * gni->max_ifs, sizeof (void *));
+    indexed = test_now_usec();
+    for (i = 0; i < gni->max_ifs; i++) {
+        gi = gni->ifs[i];
+        vpc = gni_get_vpc(gni, gi->vpc, NULL);
+        vpcsubnet = gni_get_vpcsubnet(vpc, gi->subnet, NULL);
+        found_indexed[4 * i] = gni_get_interface(vpcsubnet, gi->name, NULL);
+        found_indexed[4 * i + 1] = (gni_find_interface(gni, gi->ifname, &found) ? NULL : found);
+        found_indexed[4 * i + 2] = (gni_find_instance(gni, gi->name, &instance) ? NULL : instance);
+        found_indexed[4 * i + 3] = gni_get_secgroup(gni, gi->secgroup_names[0].name, NULL);
+    }
+    indexed = test_now_usec() - indexed;
+
+    linear = test_now_usec();
+    for (i = 0; i < gni->max_ifs; i++) {
+        gi = gni->ifs[i];
+        for (vpc = NULL, j = 0; (j < gni->max_vpcs) && !vpc; j++) {
+            vpc = (strcmp(gi->vpc, gni->vpcs[j].name) ? NULL : &(gni->vpcs[j]));
+        }
+        vpcsubnet = gni_get_vpcsubnet(vpc, gi->subnet, NULL);
+        found_linear[4 * i] = test_linear_interface(vpcsubnet, gi->name);
+        found_linear[4 * i + 1] = test_linear_find_interface(gni, gi->ifname);
+        for (instance = NULL, j = 0; (j < gni->max_instances) && !instance; j++) {
+            instance = (strcmp(gi->name, gni->instances[j]->name) ? NULL : gni->instances[j]);
+        }
+        found_linear[4 * i + 2] = instance;
+        for (secgroup = NULL, j = 0; (j < gni->max_secgroups) && !secgroup; j++) {
+            secgroup = (strcmp(gi->secgroup_names[0].name, gni->secgroups[j].name) ? NULL : &(gni->secgroups[j]));
+        }
+        found_linear[4 * i + 3] = secgroup;
+    }
+    linear = test_now_usec() - linear;
+    printf("  %d interface lookups: indexed %.2f ms, linear %.2f ms\n", gni->max_ifs, indexed / 1000.0, linear / 1000.0);
+
+    for (i = 0; i < gni->max_ifs; i++) {
+        if ((found_indexed[4 * i + 1] != gni->ifs[i]) || memcmp(&(found_indexed[4 * i]), &(found_linear[4 * i]), 4 * sizeof (void *))) {
+            printf("  indexed and linear lookups of %s differ\n", gni->ifs[i]->ifname);
+            errors++;
+            break;
+        }
+        if (test_linear_find_interface(gni, gni->ifs[i]->name) != (gni_find_interface(gni, gni->ifs[i]->name, &found) ? NULL : found)) {
+            printf("  indexed and linear lookups of %s differ\n", gni->ifs[i]->name);
+            errors++;
+            break;
+        }
+    }
+    EUCA_FREE(found_indexed);
+    EUCA_FREE(found_linear);
+
+    if ((gni_get_vpc(gni, "vpc-ffffffff", NULL) != NULL) || (gni_find_interface(gni, "eni-ffffffff", &found) == 0)
+        || (gni_get_secgroup(gni, "sg-ffffffff", NULL) != NULL)) {
+        printf("  lookup of unknown names succeeded\n");
+        errors++;
+    }
+
+    GNI_FREE(gni);
+    return (errors);
+}
+
+/**
+ * Populates a GNI from a generated document.
+ *
+ * @param path [in] path of the file to use for the document
+ * @param vpcmido [in] set to TRUE to generate a VPCMIDO document, FALSE for EDGE
+ * @param ninstances [in] number of instances
+ * @param nsecgroups [in] number of security groups
+ *
+ * @return the populated GNI, or NULL on failure
+ */
+static globalNetworkInfo *test_populate_gni(const char *path, boolean vpcmido, int ninstances, int nsecgroups) {
+    int rc = 0;
+    globalNetworkInfo *gni = NULL;
+
+    if (test_write_gni(path, vpcmido, ninstances, nsecgroups, (vpcmido ? 4 : 1))) {
+        return (NULL);
+    }
+    gni = gni_init();
+    rc = gni_populate_v(GNI_POPULATE_ALL, gni, NULL, (char *)path);
+    unlink(path);
+    if (rc) {
+        GNI_FREE(gni);
+        return (NULL);
+    }
+    return (gni);
+}
+
+/**
+ * Checks the number of entries of a set of differences.
+ *
+ * @param diff [in] the differences
+ * @param type [in] type of the set to check (see gni_diff_type_t)
+ * @param added [in] expected number of added objects
+ * @param removed [in] expected number of removed objects
+ * @param modified [in] expected number of modified objects
+ *
+ * @return 0 if the set matches, 1 otherwise
+ */
+static int test_diff_set(gni_diff *diff, int type, int added, int removed, int modified) {
+    gni_diff_set *set = &(diff->sets[type]);
+
+    if ((set->added != added) || (set->removed != removed) || (set->modified != modified) || (set->max_entries != (added + removed + modified))) {
+        printf("  diff type %d: +%d -%d ~%d, expected +%d -%d ~%d\n", type, set->added, set->removed, set->modified, added, removed, modified);
+        return (1);
+    }
+    return (0);
+}
+
+/**
+ * Diffs GNI versions that are identical, that differ by one public IP, by one
+ * instance and by one NAT gateway, and checks that exactly those changes are found.
+ *
+ * @param path [in] path of the file to use for the documents
+ * @param ninstances [in] number of instances
+ * @param nsecgroups [in] number of security groups
+ *
+ * @return the number of errors
+ */
+static int test_diff(const char *path, int ninstances, int nsecgroups) {
+    int errors = 0;
+    long long elapsed = 0;
+    gni_instance *gi = NULL;
+    gni_diff_entry *entry = NULL;
+    globalNetworkInfo *a = NULL;
+    globalNetworkInfo *b = NULL;
+    globalNetworkInfo *c = NULL;
+    gni_diff diff = { 0 };
+
+    a = test_populate_gni(path, FALSE, ninstances, nsecgroups);
+    b = test_populate_gni(path, FALSE, ninstances, nsecgroups);
+    c = test_populate_gni(path, FALSE, ninstances + 1, nsecgroups);
+    if (!a || !b || !c || (ninstances < 2)) {
+        printf("diff: population failed\n");
+        errors++;
+        goto cleanup;
+    }
+
+    // Identical documents
+    elapsed = test_now_usec();
+    gni_diff_build(a, b, &diff);
+    elapsed = test_now_usec() - elapsed;
+    printf("diff: %d instances, %d security groups diffed in %.2f ms\n", a->max_instances, a->max_secgroups, elapsed / 1000.0);
+    if (diff.config || gni_diff_count(&diff)) {
+        printf("  identical GNI differ: config %x, %d objects\n", diff.config, gni_diff_count(&diff));
+        errors++;
+    }
+    if (gni_diff_get_before(&diff, GNI_DIFF_INSTANCES, b->instances[1]->name, b->instances[1]) != b->instances[1]) {
+        printf("  unchanged instance not its own older version\n");
+        errors++;
+    }
+
+    // One elastic IP association
+    gi = b->instances[1];
+    gi->publicIp++;
+    gni_diff_build(a, b, &diff);
+    errors += test_diff_set(&diff, GNI_DIFF_INSTANCES, 0, 0, 1);
+    entry = gni_diff_find(&diff, GNI_DIFF_INSTANCES, gi->name);
+    if (!entry || (entry->changes != GNI_DIFF_CHANGE_PUBLICIP) || (entry->before != a->instances[1]) || (entry->after != gi)) {
+        printf("  public IP change of %s not found\n", gi->name);
+        errors++;
+    }
+    if (gni_diff_get_before(&diff, GNI_DIFF_INSTANCES, gi->name, gi) != a->instances[1]) {
+        printf("  older version of %s not found\n", gi->name);
+        errors++;
+    }
+    entry = gni_diff_find(&diff, GNI_DIFF_SECGROUPS, gi->secgroup_names[0].name);
+    if (!entry || (entry->changes != GNI_DIFF_CHANGE_MEMBERS)) {
+        printf("  member change of %s not found\n", gi->secgroup_names[0].name);
+        errors++;
+    }
+    if (gni_diff_find(&diff, GNI_DIFF_INSTANCES, b->instances[0]->name) != NULL) {
+        printf("  unchanged instance %s found\n", b->instances[0]->name);
+        errors++;
+    }
+    gi->publicIp--;
+
+    // One instance launched, then terminated
+    gni_diff_build(a, c, &diff);
+    errors += test_diff_set(&diff, GNI_DIFF_INSTANCES, 1, 0, 0);
+    entry = gni_diff_find(&diff, GNI_DIFF_INSTANCES, c->instances[ninstances]->name);
+    if (!entry || entry->before || (entry->after != c->instances[ninstances])) {
+        printf("  launch of %s not found\n", c->instances[ninstances]->name);
+        errors++;
+    }
+    gni_diff_build(c, a, &diff);
+    errors += test_diff_set(&diff, GNI_DIFF_INSTANCES, 0, 1, 0);
+    entry = gni_diff_find(&diff, GNI_DIFF_INSTANCES, c->instances[ninstances]->name);
+    if (!entry || entry->after || (entry->before != c->instances[ninstances])) {
+        printf("  termination of %s not found\n", c->instances[ninstances]->name);
+        errors++;
+    }
+    gni_diff_clear(&diff);
+    GNI_FREE(a);
+    GNI_FREE(b);
+    GNI_FREE(c);
+
+    // VPCs and the objects they hold
+    a = test_populate_gni(path, TRUE, ninstances, nsecgroups);
+    b = test_populate_gni(path, TRUE, ninstances, nsecgroups);
+    if (!a || !b || (a->max_vpcs < 2)) {
+        printf("diff: VPC population failed\n");
+        errors++;
+        goto cleanup;
+    }
+    gni_diff_build(a, b, &diff);
+    if (diff.config || gni_diff_count(&diff)) {
+        printf("  identical VPC GNI differ: config %x, %d objects\n", diff.config, gni_diff_count(&diff));
+        errors++;
+    }
+    b->vpcs[1].natGateways[0].publicIp++;
+    gni_diff_build(a, b, &diff);
+    errors += test_diff_set(&diff, GNI_DIFF_VPCS, 0, 0, 1);
+    if (gni_diff_count(&diff) != 1) {
+        printf("  NAT gateway change: %d objects differ\n", gni_diff_count(&diff));
+        errors++;
+    }
+    if (gni_diff_get_before(&diff, GNI_DIFF_VPCS, b->vpcs[1].name, &(b->vpcs[1])) != &(a->vpcs[1])) {
+        printf("  older version of %s not found\n", b->vpcs[1].name);
+        errors++;
+    }
+
+cleanup:
+    gni_diff_clear(&diff);
+    GNI_FREE(a);
+    GNI_FREE(b);
+    GNI_FREE(c);
+    return (errors);
+}
+
+/**
+ * Unit test and benchmark of the GNI parsers, lookups and diffs: test_euca_gni [instances [security groups]]
+ *
+ * @param argc [in] number of arguments
+ * @param argv [in] arguments
+ *
+ * @return 0 if the streaming and XPath parsers agree and the lookups and diffs succeed, 1 otherwise
+ */
+int main(int argc, char **argv) {
+    int errors = 0;
+    int ninstances = TEST_INSTANCES;
+    int nsecgroups = TEST_SECGROUPS;
+    char path[] = "/tmp/test_euca_gni.XXXXXX";
+    int fd = -1;
+
+    if (argc > 1) {
+        ninstances = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        nsecgroups = atoi(argv[2]);
+    }
+    if ((ninstances < 1) || (nsecgroups < 1)) {
+        printf("usage: %s [instances [security groups]]\n", argv[0]);
+        return (1);
+    }
+    if ((fd = mkstemp(path)) < 0) {
+        printf("cannot create a temporary file\n");
+        return (1);
+    }
+    close(fd);
+
+    log_params_set(EUCA_LOG_WARN, 0, 100);
+    errors += test_compare_parsers(path, FALSE, ninstances, nsecgroups);
+    errors += test_compare_parsers(path, TRUE, ninstances, nsecgroups);
+    errors += test_lookups(path, TEST_LOOKUP_INSTANCES, nsecgroups);
+    errors += test_diff(path, ninstances, nsecgroups);
+
+    printf("%s\n", (errors ? "FAILED" : "PASSED"));
+    return (errors ? 1 : 0);
+}
+#endif /* _UNIT_TEST */
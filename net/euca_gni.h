@@ -41,6 +41,9 @@
 #include <euca_string.h>
 #include <euca_network.h>
 
+#include "euca_arena.h"
+#include "euca_strindex.h"
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                  DEFINES                                   |
@@ -93,6 +96,31 @@ enum gni_config_diff_t {
     GNI_CONFIG_DIFF_OTHER              = 0x80000000,
 };
 
+//! Types of objects compared by gni_diff_build()
+enum gni_diff_type_t {
+    GNI_DIFF_INSTANCES,                //!< Instances, by instance ID
+    GNI_DIFF_INTERFACES,               //!< VPC interfaces, by name
+    GNI_DIFF_SECGROUPS,                //!< Security groups
+    GNI_DIFF_VPCS,                     //!< VPCs, along with their subnets, route tables, network ACLs and NAT gateways
+    GNI_DIFF_VPCIGWS,                  //!< VPC internet gateways
+    GNI_DIFF_DHCPOS,                   //!< DHCP option sets
+    GNI_DIFF_TYPES,
+};
+
+//! Properties that differ in a modified object
+enum gni_diff_change_t {
+    GNI_DIFF_CHANGE_PUBLICIP           = 0x00000001,
+    GNI_DIFF_CHANGE_PRIVATEIP          = 0x00000002,
+    GNI_DIFF_CHANGE_MAC                = 0x00000004,
+    GNI_DIFF_CHANGE_NODE               = 0x00000008,
+    GNI_DIFF_CHANGE_SECGROUPS          = 0x00000010, //!< Security groups of an instance or interface
+    GNI_DIFF_CHANGE_SRCDSTCHECK        = 0x00000020,
+    GNI_DIFF_CHANGE_INGRESS            = 0x00000040, //!< Ingress rules of a security group
+    GNI_DIFF_CHANGE_EGRESS             = 0x00000080, //!< Egress rules of a security group
+    GNI_DIFF_CHANGE_MEMBERS            = 0x00000100, //!< Members of a security group, or their addresses
+    GNI_DIFF_CHANGE_OTHER              = 0x80000000,
+};
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                 STRUCTURES                                 |
@@ -292,6 +320,7 @@ typedef struct gni_vpcsubnet_t {
     gni_network_acl *networkAcl;
     int *rt_entry_applied;
     int max_interfaces;
+    euca_strindex interface_index;     //!< Index of the interfaces by name
     void *mido_present;
 } gni_vpcsubnet;
 
@@ -363,8 +392,41 @@ typedef struct globalNetworkInfo_t {
     int max_vpcIgws;                        //!< Number of VPC Internet Gateways
     gni_dhcp_os *dhcpos;                    //!< List of DHCP Options Set information
     int max_dhcpos;                         //!< Number of DHCP Option Sets
+    euca_strindex instance_index;           //!< Index of the instances by name
+    euca_strindex if_index;                 //!< Index of the interfaces by name
+    euca_strindex ifname_index;             //!< Index of the interfaces by interface ID
+    euca_strindex secgroup_index;           //!< Index of the security groups by name
+    euca_strindex vpc_index;                //!< Index of the VPCs by name
+    euca_strindex dhcpos_index;             //!< Index of the DHCP Option Sets by name
+    euca_arena arena;                       //!< Storage of everything gni_populate_v() reads from the XML, released by gni_clear()
 } globalNetworkInfo;
 
+//! An object added, removed or modified between two GNI versions
+typedef struct gni_diff_entry_t {
+    const char *name;                  //!< Name of the object
+    void *before;                      //!< The object in the older GNI, NULL if it was added
+    void *after;                       //!< The object in the newer GNI, NULL if it was removed
+    u32 changes;                       //!< GNI_DIFF_CHANGE_* properties that differ (modified objects only)
+} gni_diff_entry;
+
+//! Differences between two GNI versions for one type of object
+typedef struct gni_diff_set_t {
+    gni_diff_entry *entries;           //!< Added and modified objects in the order of the newer GNI, then removed ones
+    int max_entries;                   //!< Number of entries
+    int added;                         //!< Number of added objects
+    int removed;                       //!< Number of removed objects
+    int modified;                      //!< Number of modified objects
+    euca_strindex index;               //!< Index of the entries by name
+} gni_diff_set;
+
+//! Differences between two GNI versions
+typedef struct gni_diff_t {
+    globalNetworkInfo *before;         //!< The older GNI
+    globalNetworkInfo *after;          //!< The newer GNI
+    int config;                        //!< GNI_CONFIG_DIFF_* bits, as returned by cmp_gni_config()
+    gni_diff_set sets[GNI_DIFF_TYPES]; //!< Changes per type of object (see gni_diff_type_t)
+} gni_diff;
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                             EXPORTED VARIABLES                             |
@@ -384,6 +446,9 @@ int gni_print(globalNetworkInfo *gni, log_level_e llevel);
 int gni_iterate(globalNetworkInfo *gni, gni_iterate_mode mode, log_level_e llevel);
 int gni_populate(globalNetworkInfo *gni, gni_hostname_info *host_info, char *xmlpath);
 int gni_populate_v(int mode, globalNetworkInfo *gni, gni_hostname_info *host_info, char *xmlpath);
+#ifdef _UNIT_TEST
+int gni_populate_xpath(int mode, globalNetworkInfo *gni, gni_hostname_info *host_info, char *xmlpath);
+#endif /* _UNIT_TEST */
 int gni_populate_xpathnodes(xmlDocPtr doc, xmlNode **gni_nodes);
 gni_xpath_node_type gni_xmlstr2type(const xmlChar *nodename);
 int gni_populate_gnidata(globalNetworkInfo *gni, xmlNodePtr xmlnode, xmlXPathContextPtr ctxptr, xmlDocPtr doc);
@@ -509,6 +574,12 @@ int cmp_gni_interface(gni_instance *a, gni_instance *b, int *pubip_diff, int *sd
 int cmp_gni_instance(gni_instance *a, gni_instance *b);
 int cmp_gni_mido_gateway(gni_mido_gateway *a, gni_mido_gateway *b);
 
+int gni_diff_build(globalNetworkInfo *before, globalNetworkInfo *after, gni_diff *diff);
+gni_diff_entry *gni_diff_find(gni_diff *diff, int type, const char *name);
+void *gni_diff_get_before(gni_diff *diff, int type, const char *name, void *after);
+int gni_diff_count(gni_diff *diff);
+void gni_diff_clear(gni_diff *diff);
+
 int ruleconvert(char *rulebuf, char *outrule);
 int ingress_gni_to_iptables_rule(char *scidr, gni_rule *iggnirule, char *outrule, int flags);
 
@@ -0,0 +1,356 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+//!
+//! @file net/euca_lpm.c
+//! Longest prefix match table mapping IPv4 addresses to values.
+//!
+//! The table is a multibit trie that consumes one octet of the address per
+//! level. Prefixes are expanded to the next octet boundary and pushed down
+//! to the leaves as longer prefixes split their range, so that each entry
+//! holds either the final value or a child node and a lookup never has to
+//! backtrack. The table is built once from the full list of prefixes and is
+//! read-only afterwards; changing a prefix means building a new table.
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  INCLUDES                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <eucalyptus.h>
+#include <log.h>
+
+#include "euca_lpm.h"
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                 STRUCTURES                                 |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! Prefix being sorted, with its position in the list given to euca_lpm_build()
+typedef struct euca_lpm_sorted_t {
+    euca_lpm_prefix prefix;            //!< The prefix, host bits cleared
+    int idx;                           //!< Position of the prefix in the original list
+} euca_lpm_sorted;
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                              STATIC PROTOTYPES                             |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+static int euca_lpm_prefix_cmp(const void *p1, const void *p2);
+static int euca_lpm_new_node(euca_lpm *lpm, u32 value);
+static int euca_lpm_insert(euca_lpm *lpm, const euca_lpm_prefix *prefix);
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                               IMPLEMENTATION                               |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+/**
+ * Builds the table of a list of prefixes. When several prefixes are identical, the
+ * last one wins. Host bits of the prefix addresses are ignored.
+ *
+ * @param lpm [in] the table to build. Any previous content is released.
+ * @param prefixes [in] the prefixes
+ * @param max_prefixes [in] number of prefixes
+ * @param defval [in] value of the addresses that match no prefix
+ *
+ * @return 0 on success or 1 if any failure occurred, in which case the table is empty
+ */
+int euca_lpm_build(euca_lpm *lpm, const euca_lpm_prefix *prefixes, int max_prefixes, u32 defval) {
+    int rc = 0;
+    euca_lpm_sorted *sorted = NULL;
+
+    if (!lpm || (max_prefixes && !prefixes) || (defval > EUCA_LPM_MAX_VALUE)) {
+        return (1);
+    }
+    for (int i = 0; i < max_prefixes; i++) {
+        if ((prefixes[i].len < 0) || (prefixes[i].len > 32) || (prefixes[i].value > EUCA_LPM_MAX_VALUE)) {
+            LOGWARN("invalid prefix length %d or value %u\n", prefixes[i].len, prefixes[i].value);
+            return (1);
+        }
+    }
+
+    euca_lpm_clear(lpm);
+    if (euca_lpm_new_node(lpm, defval) < 0) {
+        return (1);
+    }
+
+    // Shorter prefixes first, so that longer ones overwrite the part of their range they cover
+    if (max_prefixes) {
+        if ((sorted = EUCA_ALLOC(max_prefixes, sizeof (euca_lpm_sorted))) == NULL) {
+            LOGERROR("out of memory (failed to sort %d prefixes)\n", max_prefixes);
+            euca_lpm_clear(lpm);
+            return (1);
+        }
+        for (int i = 0; i < max_prefixes; i++) {
+            sorted[i].prefix = prefixes[i];
+            sorted[i].prefix.addr = ((prefixes[i].len) ? (prefixes[i].addr & (0xFFFFFFFFU << (32 - prefixes[i].len))) : 0);
+            sorted[i].idx = i;
+        }
+        qsort(sorted, max_prefixes, sizeof (euca_lpm_sorted), euca_lpm_prefix_cmp);
+        for (int i = 0; (i < max_prefixes) && !rc; i++) {
+            rc = euca_lpm_insert(lpm, &(sorted[i].prefix));
+        }
+        EUCA_FREE(sorted);
+    }
+    if (rc) {
+        euca_lpm_clear(lpm);
+        return (1);
+    }
+    return (0);
+}
+
+/**
+ * Releases the memory of a table.
+ *
+ * @param lpm [in] the table to clear
+ */
+void euca_lpm_clear(euca_lpm *lpm) {
+    if (!lpm) {
+        return;
+    }
+    EUCA_FREE(lpm->nodes);
+    lpm->max_nodes = 0;
+    lpm->size = 0;
+}
+
+/**
+ * Orders prefixes by increasing length, then by address, then by position in the
+ * original list. This is a total order, so qsort() does not need to be stable for
+ * the last of identical prefixes to be inserted last, and win.
+ *
+ * @param p1 [in] pointer to the first euca_lpm_sorted
+ * @param p2 [in] pointer to the second euca_lpm_sorted
+ *
+ * @return a negative, zero or positive integer as p1 sorts before, as or after p2
+ */
+static int euca_lpm_prefix_cmp(const void *p1, const void *p2) {
+    const euca_lpm_sorted *a = (const euca_lpm_sorted *)p1;
+    const euca_lpm_sorted *b = (const euca_lpm_sorted *)p2;
+
+    if (a->prefix.len != b->prefix.len) {
+        return (a->prefix.len - b->prefix.len);
+    }
+    if (a->prefix.addr != b->prefix.addr) {
+        return ((a->prefix.addr < b->prefix.addr) ? -1 : 1);
+    }
+    return (a->idx - b->idx);
+}
+
+/**
+ * Appends a node whose entries all hold the same value.
+ *
+ * @param lpm [in] the table
+ * @param value [in] value of the entries of the node
+ *
+ * @return the index of the new node or -1 if out of memory
+ */
+static int euca_lpm_new_node(euca_lpm *lpm, u32 value) {
+    int size = 0;
+    u32 *node = NULL;
+
+    if (lpm->max_nodes == lpm->size) {
+        size = (lpm->size ? (lpm->size * 2) : 4);
+        if ((node = EUCA_REALLOC(lpm->nodes, (size_t) size * EUCA_LPM_FANOUT, sizeof (u32))) == NULL) {
+            LOGERROR("out of memory (failed to grow table to %d nodes)\n", size);
+            return (-1);
+        }
+        lpm->nodes = node;
+        lpm->size = size;
+    }
+    node = &(lpm->nodes[lpm->max_nodes * EUCA_LPM_FANOUT]);
+    for (int i = 0; i < EUCA_LPM_FANOUT; i++) {
+        node[i] = value;
+    }
+    return (lpm->max_nodes++);
+}
+
+/**
+ * Inserts a prefix that is at least as long as any prefix inserted before it.
+ * Entries on the path of the prefix that hold a value are replaced by nodes
+ * inheriting that value, then the entries covered by the prefix in the node of
+ * its last octet are set to its value.
+ *
+ * @param lpm [in] the table
+ * @param prefix [in] the prefix to insert
+ *
+ * @return 0 on success or 1 if out of memory
+ */
+static int euca_lpm_insert(euca_lpm *lpm, const euca_lpm_prefix *prefix) {
+    int shift = 32 - EUCA_LPM_STRIDE;
+    int span = 0;
+    int child = 0;
+    u32 node = 0;
+    u32 first = 0;
+    u32 *entry = NULL;
+    u32 addr = ((prefix->len) ? (prefix->addr & (0xFFFFFFFFU << (32 - prefix->len))) : 0);
+
+    // Walk down to the node of the octet where the prefix ends
+    while ((32 - shift) < prefix->len) {
+        entry = &(lpm->nodes[(node * EUCA_LPM_FANOUT) + ((addr >> shift) & (EUCA_LPM_FANOUT - 1))]);
+        if (!(*entry & EUCA_LPM_NODE)) {
+            if ((child = euca_lpm_new_node(lpm, *entry)) < 0) {
+                return (1);
+            }
+            // nodes may have moved
+            entry = &(lpm->nodes[(node * EUCA_LPM_FANOUT) + ((addr >> shift) & (EUCA_LPM_FANOUT - 1))]);
+            *entry = (EUCA_LPM_NODE | child);
+        }
+        node = (*entry & ~EUCA_LPM_NODE);
+        shift -= EUCA_LPM_STRIDE;
+    }
+
+    // Expand the prefix to the entries of that octet it covers
+    span = 1 << ((32 - shift) - prefix->len);
+    first = (addr >> shift) & (EUCA_LPM_FANOUT - 1);
+    for (u32 i = first; i < (first + span); i++) {
+        entry = &(lpm->nodes[(node * EUCA_LPM_FANOUT) + i]);
+        // Prefixes are inserted by increasing length: a child node can only come from
+        // an identical prefix, which cannot be longer
+        if (*entry & EUCA_LPM_NODE) {
+            LOGEXTREME("prefix %08x/%d already split\n", addr, prefix->len);
+            continue;
+        }
+        *entry = prefix->value;
+    }
+    return (0);
+}
+
+#ifdef _UNIT_TEST
+#define TEST_PREFIXES                           2000    //!< Number of random prefixes in a table
+#define TEST_LOOKUPS                           50000    //!< Number of random lookups checked against the linear scan
+#define TEST_ROUNDS                               20    //!< Number of tables built and checked
+
+/**
+ * Finds the value of the longest prefix matching an address by scanning the list,
+ * the way euca_lpm_lookup() is expected to answer. Among identical prefixes the
+ * last one wins.
+ *
+ * @param prefixes [in] the prefixes
+ * @param max_prefixes [in] number of prefixes
+ * @param defval [in] value of the addresses that match no prefix
+ * @param addr [in] IPv4 address, host byte order
+ *
+ * @return the value of the longest matching prefix, or the default value
+ */
+static u32 test_linear_lookup(const euca_lpm_prefix *prefixes, int max_prefixes, u32 defval, u32 addr) {
+    int best = -1;
+    u32 mask = 0;
+
+    for (int i = 0; i < max_prefixes; i++) {
+        mask = ((prefixes[i].len) ? (0xFFFFFFFFU << (32 - prefixes[i].len)) : 0);
+        if (((addr & mask) == (prefixes[i].addr & mask)) && ((best < 0) || (prefixes[i].len >= prefixes[best].len))) {
+            best = i;
+        }
+    }
+    return ((best < 0) ? defval : prefixes[best].value);
+}
+
+/**
+ * Returns a random 32 bit number
+ *
+ * @return a random 32 bit number
+ */
+static u32 test_random32(void) {
+    return ((((u32) random()) << 16) ^ ((u32) random()));
+}
+
+/**
+ * Builds tables out of random prefixes, with many duplicates, nested prefixes and
+ * host bits set, and checks random lookups against a linear longest-match scan.
+ * Half of the lookups are drawn near a prefix of the table so that they hit it.
+ *
+ * @param argc [in] the number of arguments
+ * @param argv [in] the arguments, an optional seed
+ *
+ * @return 0 if every lookup matched, 1 otherwise
+ */
+int main(int argc, char **argv) {
+    int errors = 0;
+    u32 addr = 0;
+    u32 got = 0;
+    u32 expected = 0;
+    unsigned int seed = ((argc > 1) ? ((unsigned int)strtoul(argv[1], NULL, 10)) : ((unsigned int)time(NULL)));
+    euca_lpm lpm = { 0 };
+    euca_lpm_prefix *prefixes = NULL;
+
+    printf("seed %u\n", seed);
+    srandom(seed);
+    if ((prefixes = EUCA_ZALLOC(TEST_PREFIXES, sizeof (euca_lpm_prefix))) == NULL) {
+        printf("out of memory\n");
+        return (1);
+    }
+
+    for (int round = 0; (round < TEST_ROUNDS) && (errors < 10); round++) {
+        for (int i = 0; i < TEST_PREFIXES; i++) {
+            if ((i > 0) && ((random() % 4) == 0)) {
+                // same network as an earlier prefix, either identical or nested
+                prefixes[i] = prefixes[random() % i];
+                if ((random() % 2) && ((prefixes[i].len += (random() % 9)) > 32)) {
+                    prefixes[i].len = 32;
+                }
+                prefixes[i].addr |= (test_random32() & ((prefixes[i].len) ? ~(0xFFFFFFFFU << (32 - prefixes[i].len)) : 0xFFFFFFFFU));
+            } else {
+                // few distinct leading octets so that prefixes overlap
+                prefixes[i].addr = ((((u32) (random() % 4)) << 24) | (test_random32() & 0x00FFFFFFU));
+                prefixes[i].len = (random() % 33);
+            }
+            prefixes[i].value = (test_random32() & EUCA_LPM_MAX_VALUE);
+        }
+
+        if (euca_lpm_build(&lpm, prefixes, TEST_PREFIXES, round)) {
+            printf("round %d: failed to build the table\n", round);
+            errors++;
+            break;
+        }
+
+        for (int i = 0; (i < TEST_LOOKUPS) && (errors < 10); i++) {
+            if (i % 2) {
+                addr = prefixes[random() % TEST_PREFIXES].addr ^ (test_random32() >> (random() % 32));
+            } else {
+                addr = test_random32();
+            }
+            got = euca_lpm_lookup(&lpm, addr);
+            expected = test_linear_lookup(prefixes, TEST_PREFIXES, round, addr);
+            if (got != expected) {
+                printf("round %d: lookup of %08x returned %u, expected %u\n", round, addr, got, expected);
+                errors++;
+            }
+        }
+        printf("round %d: %d nodes, %d lookups checked\n", round, lpm.max_nodes, TEST_LOOKUPS);
+    }
+
+    euca_lpm_clear(&lpm);
+    EUCA_FREE(prefixes);
+    printf("%s\n", (errors ? "FAILED" : "PASSED"));
+    return (errors ? 1 : 0);
+}
+#endif /* _UNIT_TEST */
@@ -0,0 +1,113 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+#ifndef _INCLUDE_EUCA_LPM_H_
+#define _INCLUDE_EUCA_LPM_H_
+
+//!
+//! @file net/euca_lpm.h
+//! Longest prefix match table mapping IPv4 addresses to values, used to classify
+//! captured packets in eucanetd_meter.
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  INCLUDES                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#include <eucalyptus.h>
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  DEFINES                                   |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#define EUCA_LPM_STRIDE                           8     //!< Number of address bits consumed at each level of the table
+#define EUCA_LPM_FANOUT                         256     //!< Number of entries of a node (2 ^ EUCA_LPM_STRIDE)
+#define EUCA_LPM_NODE                   0x80000000U     //!< Entry flag of a pointer to a child node
+#define EUCA_LPM_MAX_VALUE              0x7FFFFFFFU     //!< Largest value that can be stored in the table
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                 STRUCTURES                                 |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! IPv4 prefix and the value that addresses matching it map to
+typedef struct euca_lpm_prefix_t {
+    u32 addr;                          //!< Network address, host byte order
+    int len;                           //!< Prefix length (0 to 32)
+    u32 value;                         //!< Value of the addresses matching the prefix
+} euca_lpm_prefix;
+
+//! Multibit trie with a stride of 8 bits and leaf pushing. All nodes are stored in
+//! a single array; node 0 is indexed by the first octet of the address. An entry
+//! is either a value or EUCA_LPM_NODE | index of the node of the next octet, so a
+//! lookup takes at most 4 memory accesses whatever the number of prefixes.
+typedef struct euca_lpm_t {
+    u32 *nodes;                        //!< max_nodes * EUCA_LPM_FANOUT entries
+    int max_nodes;                     //!< Number of nodes in use
+    int size;                          //!< Number of nodes allocated
+} euca_lpm;
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                             EXPORTED PROTOTYPES                            |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+int euca_lpm_build(euca_lpm *lpm, const euca_lpm_prefix *prefixes, int max_prefixes, u32 defval);
+void euca_lpm_clear(euca_lpm *lpm);
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                           STATIC INLINE PROTOTYPES                         |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+static inline u32 euca_lpm_lookup(const euca_lpm *lpm, u32 addr);
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                          STATIC INLINE IMPLEMENTATION                      |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+/**
+ * Looks up the value of the longest prefix matching an address.
+ *
+ * @param lpm [in] table built with euca_lpm_build()
+ * @param addr [in] IPv4 address, host byte order
+ *
+ * @return the value of the longest matching prefix, or the default value
+ */
+static inline u32 euca_lpm_lookup(const euca_lpm *lpm, u32 addr) {
+    int shift = 32 - EUCA_LPM_STRIDE;
+    u32 entry = lpm->nodes[addr >> shift];
+
+    while (entry & EUCA_LPM_NODE) {
+        shift -= EUCA_LPM_STRIDE;
+        entry = lpm->nodes[((entry & ~EUCA_LPM_NODE) * EUCA_LPM_FANOUT) + ((addr >> shift) & (EUCA_LPM_FANOUT - 1))];
+    }
+    return (entry);
+}
+
+#endif /* ! _INCLUDE_EUCA_LPM_H_ */
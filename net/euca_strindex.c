@@ -0,0 +1,235 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+//!
+//! @file net/euca_strindex.c
+//! Hash index mapping strings to positions in an array kept by the caller.
+//!
+//! The iptables and ebtables handlers keep their chains and rules in plain
+//! arrays that get reallocated as they grow, so the index only records array
+//! positions and asks the caller for the key at a position when it needs to
+//! compare. Lookups and insertions are O(1) on average, which keeps building
+//! a ruleset linear in its number of rules. Entries are never removed one at
+//! a time: when elements move or get renamed, the owner rebuilds the index.
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  INCLUDES                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <eucalyptus.h>
+#include <log.h>
+
+#include "euca_strindex.h"
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                              STATIC PROTOTYPES                             |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+static void euca_strindex_insert(euca_strindex *index, unsigned int hash, int idx);
+static int euca_strindex_grow(euca_strindex *index);
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                               IMPLEMENTATION                               |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+/**
+ * Computes the 32-bit FNV-1a hash of a string.
+ *
+ * @param key [in] the string to hash
+ *
+ * @return the hash value
+ */
+unsigned int euca_strindex_hash(const char *key) {
+    unsigned int hash = 2166136261U;
+    const unsigned char *c = NULL;
+
+    for (c = (const unsigned char *)key; *c; c++) {
+        hash = (hash ^ *c) * 16777619U;
+    }
+    return (hash);
+}
+
+/**
+ * Looks up the array position of the element with the given key.
+ *
+ * @param index [in] pointer to the index
+ * @param key [in] the key we're looking for
+ * @param keyof [in] function returning the key of an element of the array
+ * @param base [in] the array the index refers to
+ *
+ * @return the position of the element if found, -1 otherwise. When several elements
+ *         have the same key, the one that was added first is returned.
+ */
+int euca_strindex_find(euca_strindex *index, const char *key, euca_strindex_key_fn keyof, const void *base) {
+    unsigned int hash = 0;
+    unsigned int mask = 0;
+    unsigned int slot = 0;
+
+    if (!index || !key || !keyof || (index->size == 0)) {
+        return (-1);
+    }
+
+    hash = euca_strindex_hash(key);
+    mask = index->size - 1;
+    for (slot = (hash & mask); index->slots[slot]; slot = ((slot + 1) & mask)) {
+        if ((index->hashes[slot] == hash) && !strcmp(keyof(base, (index->slots[slot] - 1)), key)) {
+            return (index->slots[slot] - 1);
+        }
+    }
+    return (-1);
+}
+
+/**
+ * Records the array position of an element under its key. Nothing is recorded if the
+ * key is already indexed, so that lookups keep returning the first element with that key.
+ *
+ * @param index [in] pointer to the index
+ * @param key [in] the key of the element
+ * @param idx [in] the position of the element in the array
+ * @param keyof [in] function returning the key of an element of the array
+ * @param base [in] the array the index refers to
+ *
+ * @return 0 on success or 1 if any failure occurred
+ */
+int euca_strindex_add(euca_strindex *index, const char *key, int idx, euca_strindex_key_fn keyof, const void *base) {
+    if (!index || !key || !keyof || (idx < 0)) {
+        return (1);
+    }
+
+    if (euca_strindex_find(index, key, keyof, base) >= 0) {
+        return (0);
+    }
+
+    // keep the load factor under 1/2 so probe sequences stay short
+    if ((2 * (index->count + 1)) > index->size) {
+        if (euca_strindex_grow(index)) {
+            return (1);
+        }
+    }
+
+    euca_strindex_insert(index, euca_strindex_hash(key), idx);
+    return (0);
+}
+
+/**
+ * Drops every entry of an index and indexes the first nmemb elements of the array again.
+ *
+ * @param index [in] pointer to the index
+ * @param nmemb [in] number of elements in the array
+ * @param keyof [in] function returning the key of an element of the array
+ * @param base [in] the array the index refers to
+ *
+ * @return 0 on success or 1 if any failure occurred
+ */
+int euca_strindex_rebuild(euca_strindex *index, int nmemb, euca_strindex_key_fn keyof, const void *base) {
+    int i = 0;
+    int rc = 0;
+
+    if (!index || !keyof) {
+        return (1);
+    }
+
+    if (index->size) {
+        bzero(index->slots, (index->size * sizeof(int)));
+    }
+    index->count = 0;
+
+    for (i = 0; i < nmemb; i++) {
+        rc |= euca_strindex_add(index, keyof(base, i), i, keyof, base);
+    }
+    return (rc);
+}
+
+/**
+ * Releases the memory held by an index and leaves it empty.
+ *
+ * @param index [in] pointer to the index
+ */
+void euca_strindex_clear(euca_strindex *index) {
+    if (!index) {
+        return;
+    }
+    EUCA_FREE(index->slots);
+    EUCA_FREE(index->hashes);
+    index->size = 0;
+    index->count = 0;
+}
+
+/**
+ * Stores a position in the first free slot of its probe sequence.
+ *
+ * @param index [in] pointer to the index, which must have a free slot
+ * @param hash [in] hash of the key of the element
+ * @param idx [in] the position of the element in the array
+ */
+static void euca_strindex_insert(euca_strindex *index, unsigned int hash, int idx) {
+    unsigned int mask = index->size - 1;
+    unsigned int slot = 0;
+
+    for (slot = (hash & mask); index->slots[slot]; slot = ((slot + 1) & mask)) ;
+    index->slots[slot] = idx + 1;
+    index->hashes[slot] = hash;
+    index->count++;
+}
+
+/**
+ * Doubles the number of slots of an index and moves its entries over.
+ *
+ * @param index [in] pointer to the index
+ *
+ * @return 0 on success or 1 if any failure occurred
+ */
+static int euca_strindex_grow(euca_strindex *index) {
+    int i = 0;
+    int size = 0;
+    int *slots = NULL;
+    unsigned int *hashes = NULL;
+    euca_strindex old = *index;
+
+    size = ((index->size > 0) ? (2 * index->size) : EUCA_STRINDEX_MIN_SLOTS);
+    if (((slots = EUCA_ZALLOC(size, sizeof(int))) == NULL) || ((hashes = EUCA_ZALLOC(size, sizeof(unsigned int))) == NULL)) {
+        LOGERROR("out of memory (failed to grow index to %d slots)\n", size);
+        EUCA_FREE(slots);
+        return (1);
+    }
+
+    index->slots = slots;
+    index->hashes = hashes;
+    index->size = size;
+    index->count = 0;
+    for (i = 0; i < old.size; i++) {
+        if (old.slots[i]) {
+            euca_strindex_insert(index, old.hashes[i], (old.slots[i] - 1));
+        }
+    }
+    EUCA_FREE(old.slots);
+    EUCA_FREE(old.hashes);
+    return (0);
+}
@@ -0,0 +1,73 @@
+// -*- mode: C; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil -*-
+// vim: set softtabstop=4 shiftwidth=4 tabstop=4 expandtab:
+
+/*************************************************************************
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development Company LP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ ************************************************************************/
+
+#ifndef _INCLUDE_EUCA_STRINDEX_H_
+#define _INCLUDE_EUCA_STRINDEX_H_
+
+//!
+//! @file net/euca_strindex.h
+//! Hash index mapping strings to positions in an array kept by the caller, used
+//! to look up chains and rules by name in the iptables and ebtables handlers.
+//!
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  DEFINES                                   |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+#define EUCA_STRINDEX_MIN_SLOTS                  16     //!< Number of slots of an index when its first entry is added
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                  TYPEDEFS                                  |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! Returns the key of the element at position idx of the array base
+typedef const char *(*euca_strindex_key_fn) (const void *base, int idx);
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                                 STRUCTURES                                 |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+//! Open addressing hash table of array positions. Only positions are stored, so the
+//! array may be reallocated freely; it must be rebuilt when elements move or are renamed.
+typedef struct euca_strindex_t {
+    int *slots;                        //!< Array position + 1 of each entry, 0 for an empty slot
+    unsigned int *hashes;              //!< Hash of the key of each entry
+    int size;                          //!< Number of slots, a power of two
+    int count;                         //!< Number of entries
+} euca_strindex;
+
+/*----------------------------------------------------------------------------*\
+ |                                                                            |
+ |                             EXPORTED PROTOTYPES                            |
+ |                                                                            |
+\*----------------------------------------------------------------------------*/
+
+int euca_strindex_find(euca_strindex *index, const char *key, euca_strindex_key_fn keyof, const void *base);
+int euca_strindex_add(euca_strindex *index, const char *key, int idx, euca_strindex_key_fn keyof, const void *base);
+int euca_strindex_rebuild(euca_strindex *index, int nmemb, euca_strindex_key_fn keyof, const void *base);
+void euca_strindex_clear(euca_strindex *index);
+unsigned int euca_strindex_hash(const char *key);
+
+#endif /* ! _INCLUDE_EUCA_STRINDEX_H_ */
@@ -40,6 +40,9 @@
 #include <pwd.h>
 #include <dirent.h>
 #include <errno.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/capability.h>
 
 #include <signal.h>
 #include <eucalyptus.h>
@@ -163,6 +166,8 @@ configEntry configKeysRestartEUCANETD[] = {
     ,
     {"MIDO_MAX_ENIID", "1048576"}
     ,
+    {"MIDO_CACHE_FULL_REFRESH_INTERVAL", "3600"}
+    ,
     {"MIDO_VALIDATE_MIDOCONFIG", "Y"}
     ,
     {NULL, NULL}
@@ -263,6 +268,7 @@ static void eucanetd_sigusr2_handler(int signal);
 static void eucanetd_install_signal_handlers(void);
 
 static int eucanetd_daemonize(void);
+static int eucanetd_keep_net_admin(boolean keep);
 static int eucanetd_fetch_latest_local_config(void);
 static int eucanetd_initialize(void);
 static int eucanetd_initialize_network_drivers(eucanetdConfig *pConfig, globalNetworkInfo *pGni);
@@ -1028,12 +1034,32 @@ static int eucanetd_daemonize(void) {
         exit(1);
     }
 
+    // Retain our capabilities through setuid() so CAP_NET_ADMIN can be kept below
+    if ((getuid() == 0) && (pwent->pw_uid != 0) && (prctl(PR_SET_KEEPCAPS, 1, 0, 0, 0) != 0)) {
+        perror("prctl()");
+        fprintf(stderr, "could not retain capabilities, network devices will be configured through the root wrapper\n");
+    }
+
     if (setgid(pwent->pw_gid) || setuid(pwent->pw_uid)) {
         perror("setgid() setuid()");
         fprintf(stderr, "could not switch daemon process to UID/GID '%d/%d'\n", pwent->pw_uid, pwent->pw_gid);
         exit(1);
     }
 
+    if (prctl(PR_GET_KEEPCAPS, 0, 0, 0, 0) == 1) {
+        prctl(PR_SET_KEEPCAPS, 0, 0, 0, 0);
+        if (eucanetd_keep_net_admin(TRUE) != 0) {
+            perror("capset()");
+            fprintf(stderr, "could not restrict daemon process capabilities to CAP_NET_ADMIN, network devices will be configured through the root wrapper\n");
+            // never keep the full root set that survived setuid()
+            if (eucanetd_keep_net_admin(FALSE) != 0) {
+                perror("capset()");
+                fprintf(stderr, "could not drop daemon process capabilities\n");
+                exit(1);
+            }
+        }
+    }
+
     char eucadir[EUCA_MAX_PATH] = "";
     snprintf(eucadir, EUCA_MAX_PATH, "%s/var/log/eucalyptus", config->eucahome);
     if (check_directory(eucadir)) {
@@ -1063,6 +1089,31 @@ static int eucanetd_daemonize(void) {
     return (0);
 }
 
+/**
+ * Reduces the capabilities retained across the switch to the eucalyptus user to
+ * CAP_NET_ADMIN only. This lets the device handler configure links and addresses
+ * over rtnetlink without forking the root wrapper for every change. Commands run
+ * by eucanetd lose the capability on exec() and still go through the root wrapper.
+ *
+ * @param keep [in] set to FALSE to drop every capability instead
+ *
+ * @return 0 on success or -1 on failure (errno is set)
+ *
+ * @pre The process switched users with PR_SET_KEEPCAPS set
+ */
+static int eucanetd_keep_net_admin(boolean keep) {
+    struct __user_cap_header_struct caphead = { 0 };
+    struct __user_cap_data_struct cap[_LINUX_CAPABILITY_U32S_3] = { { 0 } };
+
+    caphead.version = _LINUX_CAPABILITY_VERSION_3;
+    caphead.pid = 0;
+    if (keep) {
+        cap[CAP_TO_INDEX(CAP_NET_ADMIN)].effective = CAP_TO_MASK(CAP_NET_ADMIN);
+        cap[CAP_TO_INDEX(CAP_NET_ADMIN)].permitted = CAP_TO_MASK(CAP_NET_ADMIN);
+    }
+    return ((syscall(__NR_capset, &caphead, cap) < 0) ? -1 : 0);
+}
+
 /**
  * Initialize eucanetd service
  *
@@ -1334,6 +1385,7 @@ static int eucanetd_read_config(globalNetworkInfo *pGni) {
     cvals[EUCANETD_CVAL_MIDO_MDCIDR] = configFileValue("MIDO_MD_CIDR");
     cvals[EUCANETD_CVAL_MIDO_MAX_RTID] = configFileValue("MIDO_MAX_RTID");
     cvals[EUCANETD_CVAL_MIDO_MAX_ENIID] = configFileValue("MIDO_MAX_ENIID");
+    cvals[EUCANETD_CVAL_MIDO_CACHE_FULL_REFRESH_INTERVAL] = configFileValue("MIDO_CACHE_FULL_REFRESH_INTERVAL");
     cvals[EUCANETD_CVAL_MIDO_ENABLE_ARPTABLE] = configFileValue("MIDO_ENABLE_ARPTABLE");
     cvals[EUCANETD_CVAL_MIDO_ENABLE_MIDOMD] = configFileValue("MIDO_ENABLE_MIDOMD");
     cvals[EUCANETD_CVAL_MIDO_API_URIBASE] = configFileValue("MIDO_API_URIBASE");
@@ -1458,6 +1510,7 @@ static int eucanetd_read_config(globalNetworkInfo *pGni) {
             snprintf(config->mido_mdcidr, NETWORK_ADDR_LEN, "%s", cvals[EUCANETD_CVAL_MIDO_MDCIDR]);
         config->mido_max_rtid = atoi(cvals[EUCANETD_CVAL_MIDO_MAX_RTID]);
         config->mido_max_eniid = atoi(cvals[EUCANETD_CVAL_MIDO_MAX_ENIID]);
+        config->mido_cache_full_refresh = atoi(cvals[EUCANETD_CVAL_MIDO_CACHE_FULL_REFRESH_INTERVAL]);
         if (cvals[EUCANETD_CVAL_MIDO_MD_254_EGRESS])
             snprintf(config->mido_md_254_egress, 256, "%s", cvals[EUCANETD_CVAL_MIDO_MD_254_EGRESS]);
         if (cvals[EUCANETD_CVAL_MIDO_MD_253_EGRESS])
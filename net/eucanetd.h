@@ -140,6 +140,7 @@ enum {
     EUCANETD_CVAL_MIDO_MDCIDR,
     EUCANETD_CVAL_MIDO_MAX_RTID,
     EUCANETD_CVAL_MIDO_MAX_ENIID,
+    EUCANETD_CVAL_MIDO_CACHE_FULL_REFRESH_INTERVAL,
     EUCANETD_CVAL_MIDO_ENABLE_ARPTABLE,
     EUCANETD_CVAL_MIDO_ENABLE_MIDOMD,
     EUCANETD_CVAL_MIDO_API_URIBASE,
@@ -229,6 +230,7 @@ typedef struct eucanetdConfig_t {
     char mido_api_uribase[URI_LEN];
     int mido_max_rtid;
     int mido_max_eniid;
+    int mido_cache_full_refresh;       //!< Seconds between full midocache refreshes, 0 to always refresh in full (MIDO_CACHE_FULL_REFRESH_INTERVAL)
 
     atomic_file global_network_info_file;
     char lastAppliedVersion[32];
@@ -147,6 +147,12 @@ static edge_netmeter *netmeter = NULL;
 
 static int edgeMaintCount = 0;
 
+//! Set when a dhcpd restart was deferred to coalesce a burst of DHCP configuration changes
+static boolean edgeDhcpdRestartPending = FALSE;
+
+//! Time of the last dhcpd (re)start requested by this driver
+static time_t edgeDhcpdRestartTs = 0;
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                             EXPORTED PROTOTYPES                            |
@@ -173,6 +179,9 @@ static u32 network_driver_system_scrub(eucanetdConfig *pConfig, globalNetworkInf
 //static int network_driver_handle_signal(eucanetdConfig *pConfig, globalNetworkInfo *pGni, int signal);
 //! @}
 
+static boolean is_my_secgroup(edge_config *edge, const char *name);
+static int edge_kick_dhcpd_server(eucanetdConfig *config);
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                   MACROS                                   |
@@ -587,6 +596,13 @@ static int network_driver_system_maint(eucanetdConfig *pConfig, globalNetworkInf
         return (1);
     }
 
+    // Complete a dhcpd restart deferred during a burst of instance changes
+    if (edgeDhcpdRestartPending && PEER_IS_NC(eucanetdPeer)) {
+        if (edge_kick_dhcpd_server(pConfig) != 0) {
+            LOGWARN("Failed to restart deferred dhcpd: check above log errors for details\n");
+        }
+    }
+
     if ((edgeMaintCount % 10) == 0) {
         if (pGni == edgeConfig_a->gni) {
             edgeConfig_a->config = pConfig;
@@ -657,41 +673,37 @@ static u32 network_driver_system_scrub(eucanetdConfig *pConfig, globalNetworkInf
         return (EUCANETD_RUN_ERROR_API);
     }
 
-    boolean do_edge_update = TRUE;
     int do_instances = 1;
+    int do_eips = 1;
     int do_sgs = 1;
     int do_allprivate = 1;
+    gni_diff diff = { 0 };
+    gni_diff *pDiff = NULL;
+    // pGniApplied is only set when it was successfully applied: apply what changed since
     if (pGniApplied && (pGni != pGniApplied)) {
-        int config_changed = cmp_gni_config(pGni, pGniApplied);
-        if ((config_changed & GNI_CONFIG_DIFF_SUBNETS) == 0) {
-            edgeConfigApplied->gni = pGniApplied;
-            edgeConfigApplied->config = pConfig;
-
-            rc = extract_edge_config_from_gni(edgeConfigApplied);
-            if (!rc) {
-                if (!cmp_edge_config(edgeConfig, edgeConfigApplied, &do_instances,
-                        &do_sgs, &do_allprivate)) {
-                    do_edge_update = FALSE;
-                    LOGINFO("\tSystem is already up-to-date\n");
-                }
+        if (!gni_diff_build(pGniApplied, pGni, &diff) && (diff.config == 0)) {
+            pDiff = &diff;
+            if (!cmp_edge_gni_diff(edgeConfig, pDiff, &do_instances, &do_eips, &do_sgs, &do_allprivate)) {
+                LOGINFO("\tSystem is already up-to-date\n");
             }
         }
     }
 
-    if (do_edge_update) {
-        if (do_allprivate) {
-            rc += do_edge_update_allprivate(edgeConfig);
-        }
-        if (do_sgs) {
-            rc += do_edge_update_sgs(edgeConfig);
-        }
-        if (do_instances) {
-            rc += do_edge_update_eips(edgeConfig);
-            rc += do_edge_update_l2(edgeConfig);
-            rc += do_edge_update_ips(edgeConfig);
-        }
+    if (do_allprivate) {
+        rc += do_edge_update_allprivate(edgeConfig);
+    }
+    if (do_sgs) {
+        rc += do_edge_update_sgs(edgeConfig);
+    }
+    if (do_eips) {
+        rc += do_edge_update_eips(edgeConfig, pDiff);
+    }
+    if (do_instances) {
+        rc += do_edge_update_l2(edgeConfig);
+        rc += do_edge_update_ips(edgeConfig);
     }
     rc += do_edge_update_netmeter(edgeConfig);
+    gni_diff_clear(&diff);
 
     if (rc) {
         ret = EUCANETD_RUN_ERROR_API;
@@ -1046,9 +1058,12 @@ int do_edge_update_sgs(edge_config *edge) {
  * Update the elastic IP artifacts. This will install the NAT rules for each one
  * of them.
  * @param edge [in] pointer to EDGE configuration structure
+ * @param diff [in] changes since the last applied GNI. If NULL, all public IPs of
+ * local instances are (re)assigned to the public interface and all unused public IPs
+ * are checked for removal. Otherwise only the ones that changed are.
  * @return 0 on success. Positive integer on any error during processing.
  */
-int do_edge_update_eips(edge_config *edge) {
+int do_edge_update_eips(edge_config *edge, gni_diff *diff) {
 #define MAX_RULE_LEN               1024
 
     int slashnet = 0;
@@ -1059,6 +1074,9 @@ int do_edge_update_eips(edge_config *edge) {
     int found = 0;
     u32 nw = 0;
     u32 nm = 0;
+    gni_instance *before = NULL;
+    gni_diff_entry *entry = NULL;
+    gni_diff_set *set = NULL;
     char cmd[EUCA_MAX_PATH] = "";
     char rule[MAX_RULE_LEN] = "";
     char *strptra = NULL;
@@ -1156,18 +1174,27 @@ int do_edge_update_eips(edge_config *edge) {
         strptrb = hex2dot(instances[i].privateIp);
         LOGTRACE("instance pub/priv: %s: %s/%s\n", instances[i].name, strptra, strptrb);
         if ((instances[i].publicIp && instances[i].privateIp) && (instances[i].publicIp != instances[i].privateIp)) {
-            // run some commands
-            snprintf(cmd, EUCA_MAX_PATH, "%s/32", strptra);
-            euca_execlp_redirect(&rc, NULL, "/dev/null", FALSE, "/dev/null", FALSE, edge->config->cmdprefix, "ip", "addr", "add", cmd, "dev", edge->config->pubInterface, NULL);
-            rc = rc >> 8;
-            if (!(rc == 0 || rc == 2)) {
-                LOGERROR("could not execute: adding ips\n");
-                ret = 1;
-            } else {
-                // try arping up to 3 times
-                rc = EUCA_TIMEOUT_ERROR;
-                for (j = 1; j < 4 && rc != EUCA_OK; j++) {
-                    rc = euca_exec_wait(j, edge->config->cmdprefix, "arping", "-c", "1", "-U", "-I", edge->config->pubInterface, strptra, NULL);
+            // only (re)assign the public IPs that moved since the last applied GNI
+            entry = NULL;
+            if (diff && (entry = gni_diff_find(diff, GNI_DIFF_INSTANCES, instances[i].name)) != NULL) {
+                if (entry->before && !(entry->changes & (GNI_DIFF_CHANGE_PUBLICIP | GNI_DIFF_CHANGE_NODE))) {
+                    entry = NULL;
+                }
+            }
+            if (!diff || entry) {
+                // run some commands
+                snprintf(cmd, EUCA_MAX_PATH, "%s/32", strptra);
+                euca_execlp_redirect(&rc, NULL, "/dev/null", FALSE, "/dev/null", FALSE, edge->config->cmdprefix, "ip", "addr", "add", cmd, "dev", edge->config->pubInterface, NULL);
+                rc = rc >> 8;
+                if (!(rc == 0 || rc == 2)) {
+                    LOGERROR("could not execute: adding ips\n");
+                    ret = 1;
+                } else {
+                    // try arping up to 3 times
+                    rc = EUCA_TIMEOUT_ERROR;
+                    for (j = 1; j < 4 && rc != EUCA_OK; j++) {
+                        rc = euca_exec_wait(j, edge->config->cmdprefix, "arping", "-c", "1", "-U", "-I", edge->config->pubInterface, strptra, NULL);
+                    }
                 }
             }
 
@@ -1229,8 +1256,39 @@ int do_edge_update_eips(edge_config *edge) {
         ret = 1;
     }
 
+    // if all has gone well, clear the public IPs of local instances that changed since the last applied GNI
+    if (!ret && diff) {
+        set = &(diff->sets[GNI_DIFF_INSTANCES]);
+        for (i = 0; i < set->max_entries; i++) {
+            entry = &(set->entries[i]);
+            before = (gni_instance *) entry->before;
+            if (!before || (entry->after && !(entry->changes & (GNI_DIFF_CHANGE_PUBLICIP | GNI_DIFF_CHANGE_NODE)))) {
+                continue;
+            }
+            if (strcmp(before->node, edge->my_node->name) || !before->publicIp || (before->publicIp == before->privateIp)) {
+                continue;
+            }
+            for (j = 0, found = 0; j < max_instances && !found; j++) {
+                if (instances[j].publicIp == before->publicIp) {
+                    // the public IP moved to another instance running on this node, do not delete
+                    found = 1;
+                }
+            }
+            if (!found) {
+                strptra = hex2dot(before->publicIp);
+                snprintf(cmd, EUCA_MAX_PATH, "%s/32", strptra);
+                EUCA_FREE(strptra);
+                if (euca_execlp_redirect(NULL, NULL, "/dev/null", FALSE, "/dev/null", FALSE, edge->config->cmdprefix,
+                                         "ip", "addr", "del", cmd, "dev", edge->config->pubInterface, NULL) != EUCA_OK) {
+                    LOGERROR("could not execute: revoking no longer in use ips\n");
+                    ret = 1;
+                }
+            }
+        }
+    }
+
     // if all has gone well, now clear any public IPs that have not been mapped to private IPs
-    if (!ret) {
+    if (!ret && !diff) {
         u32 *ips=NULL, *nms=NULL;
         int max_nets;
         
@@ -1524,11 +1582,15 @@ int do_edge_update_l2(edge_config *edge) {
 
 /**
  * Update the private IP addressing. This will ensure a DHCP configuration file
- * is generated and the server restarted upon success.
+ * is generated and the server restarted when the set of local hosts changed.
+ * Restarts are rate limited to one every EDGE_DHCPD_RESTART_INTERVAL seconds
+ * so that instance launch bursts do not repeatedly drop DHCP service; changes
+ * that arrive within that window are applied by a single deferred restart.
  * @param edge [in] pointer to EDGE configuration structure
  * @return 0 on success. Positive integer on any error during processing.
  */
 int do_edge_update_ips(edge_config *edge) {
+    boolean changed = FALSE;
     struct timeval tv = { 0 };
 
     eucanetd_timer_usec(&tv);
@@ -1542,15 +1604,25 @@ int do_edge_update_ips(edge_config *edge) {
 
     if (edge->max_my_instances == 0) {
         LOGDEBUG("\tstopping dhcpd\n");
+        edgeDhcpdRestartPending = FALSE;
         eucanetd_stop_dhcpd_server(edge->config);
     } else {
         // Generate the DHCP configuration so instances can get their network config
-        if ((generate_dhcpd_config(edge)) != 0) {
+        if ((generate_dhcpd_config(edge, &changed)) != 0) {
             LOGERROR("unable to generate new dhcp configuration file: check above log errors for details\n");
             return (1);
         }
-        // Restart the DHCP server so it can pick up the new configuration
-        if ((eucanetd_kick_dhcpd_server(edge->config)) != 0) {
+        // Restart the DHCP server only if it needs to pick up a new configuration
+        if (!changed && !edgeDhcpdRestartPending) {
+            if (eucanetd_dhcpd_server_running(edge->config)) {
+                LOGDEBUG("\tdhcp config unchanged\n");
+                LOGINFO("\tdhcp config processed in %.2f ms.\n", eucanetd_timer_usec(&tv) / 1000.0);
+                return (0);
+            }
+            // a restart within the interval is deferred and left pending for the next pass
+            LOGDEBUG("\tdhcpd is not running\n");
+        }
+        if ((edge_kick_dhcpd_server(edge->config)) != 0) {
             LOGERROR("unable to (re)configure local dhcpd server: check above log errors for details\n");
             return (1);
         }
@@ -1559,6 +1631,30 @@ int do_edge_update_ips(edge_config *edge) {
     return (0);
 }
 
+/**
+ * Restarts the local DHCP server unless it was already restarted within the
+ * last EDGE_DHCPD_RESTART_INTERVAL seconds, in which case the restart is left
+ * pending and is completed by a later iteration or by the maintenance hook.
+ * @param config [in] pointer to eucanetd system-wide configuration
+ * @return 0 on success (restarted or deferred). Positive integer on failure.
+ */
+static int edge_kick_dhcpd_server(eucanetdConfig *config) {
+    int rc = 0;
+    time_t now = time(NULL);
+
+    edgeDhcpdRestartPending = TRUE;
+    if ((now - edgeDhcpdRestartTs) < EDGE_DHCPD_RESTART_INTERVAL) {
+        LOGDEBUG("\tdhcpd restarted %ld seconds ago, deferring restart\n", (long) (now - edgeDhcpdRestartTs));
+        return (0);
+    }
+
+    edgeDhcpdRestartTs = now;
+    if ((rc = eucanetd_kick_dhcpd_server(config)) == 0) {
+        edgeDhcpdRestartPending = FALSE;
+    }
+    return (rc);
+}
+
 /**
  * Update netmeter. Go through each instance's public and private IP iptables counter
  * rules and extract the updated counts.
@@ -1666,11 +1762,13 @@ int do_edge_update_netmeter(edge_config *edge) {
 
 /**
  * Generates the DHCP server configuration so the instances can get their
- * networking configuration information.
+ * networking configuration information. The configuration is written to a
+ * temporary file and only replaces the current one if the content differs.
  * @param edge [in] pointer to EDGE configuration structure
+ * @param changed [out] set to TRUE if the configuration file content changed
  * @return 0 on success. Positive integer on any error during processing.
  */
-int generate_dhcpd_config(edge_config *edge) {
+int generate_dhcpd_config(edge_config *edge, boolean *changed) {
     int i = 0;
     int ret = 0;
     int max_instances = 0;
@@ -1683,17 +1781,21 @@ int generate_dhcpd_config(edge_config *edge) {
     char *broadcast = NULL;
     char *router = NULL;
     char *strptra = NULL;
+    char *current = NULL;
+    char *generated = NULL;
     char dhcpd_config_path[EUCA_MAX_PATH] = "";
+    char dhcpd_config_tmp_path[EUCA_MAX_PATH] = "";
     char pid_file_path[EUCA_MAX_PATH] = "";
     char lease_file_path[EUCA_MAX_PATH] = "";
     FILE *OFH = NULL;
     gni_instance *instances = NULL;
 
     // Make sure our given parameter is valid
-    if (!edge || !edge->config || !edge->gni || !edge->my_cluster) {
+    if (!edge || !edge->config || !edge->gni || !edge->my_cluster || !changed) {
         LOGERROR("Invalid argument: cannot update dhcp from NULL configuration.\n");
         return (1);
     }
+    *changed = FALSE;
 
     nw = edge->my_cluster->private_subnet.subnet;
     nm = edge->my_cluster->private_subnet.netmask;
@@ -1703,11 +1805,12 @@ int generate_dhcpd_config(edge_config *edge) {
 
     // Open the DHCP configuration file
     snprintf(dhcpd_config_path, EUCA_MAX_PATH, NC_NET_PATH_DEFAULT "/euca-dhcp.conf", edge->config->eucahome);
+    snprintf(dhcpd_config_tmp_path, EUCA_MAX_PATH, NC_NET_PATH_DEFAULT "/euca-dhcp.conf.tmp", edge->config->eucahome);
     snprintf(pid_file_path, EUCA_MAX_PATH, NC_NET_PATH_DEFAULT "/euca-dhcp.pid", edge->config->eucahome);
     snprintf(lease_file_path, EUCA_MAX_PATH, NC_NET_PATH_DEFAULT "/euca-dhcp.leases", edge->config->eucahome);
-    OFH = fopen(dhcpd_config_path, "w");
+    OFH = fopen(dhcpd_config_tmp_path, "w");
     if (!OFH) {
-        LOGERROR("cannot open dhcpd server config file for write '%s': check permissions\n", dhcpd_config_path);
+        LOGERROR("cannot open dhcpd server config file for write '%s': check permissions\n", dhcpd_config_tmp_path);
         ret = 1;
     } else {
         fprintf(OFH, "# automatically generated config file for DHCP server\n"
@@ -1759,7 +1862,26 @@ int generate_dhcpd_config(edge_config *edge) {
         }
 
         fprintf(OFH, "}\n");
-        fclose(OFH);
+        if (fclose(OFH) != 0) {
+            LOGERROR("cannot write dhcpd server config file '%s': check disk capacity\n", dhcpd_config_tmp_path);
+            unlink(dhcpd_config_tmp_path);
+            return (1);
+        }
+
+        // Only replace the live configuration if it differs from what we generated
+        current = file2str(dhcpd_config_path);
+        generated = file2str(dhcpd_config_tmp_path);
+        if (current && generated && !strcmp(current, generated)) {
+            unlink(dhcpd_config_tmp_path);
+        } else if (rename(dhcpd_config_tmp_path, dhcpd_config_path) != 0) {
+            LOGERROR("cannot install dhcpd server config file '%s': check permissions\n", dhcpd_config_path);
+            unlink(dhcpd_config_tmp_path);
+            ret = 1;
+        } else {
+            *changed = TRUE;
+        }
+        EUCA_FREE(current);
+        EUCA_FREE(generated);
     }
 
     return (ret);
@@ -2190,6 +2312,102 @@ boolean is_my_ip(edge_config *edge, u32 ip) {
     return (FALSE);
 }
 
+/**
+ * Checks whether a security group is used by or referenced by the security groups
+ * of the instances hosted by this NC.
+ * @param edge [in] edge_config structure of interest
+ * @param name [in] name of the security group of interest
+ * @return TRUE if the security group is in my_sgs or ref_sgs. FALSE otherwise.
+ */
+static boolean is_my_secgroup(edge_config *edge, const char *name) {
+    for (int i = 0; i < edge->max_my_sgs; i++) {
+        if (!strcmp(name, edge->my_sgs[i]->name)) return (TRUE);
+    }
+    for (int i = 0; i < edge->max_ref_sgs; i++) {
+        if (!strcmp(name, edge->ref_sgs[i]->name)) return (TRUE);
+    }
+    return (FALSE);
+}
+
+/**
+ * Decides which EDGE artifacts need to be updated given the changes between the
+ * last applied GNI and the GNI of edge.
+ * @param edge [in] edge_config structure extracted from the newer GNI of diff
+ * @param diff [in] changes between the last applied GNI and the GNI of edge
+ * @param my_instances_diff [out] set to 1 iff L2/DHCP of instances local to NC need an update
+ * @param eips_diff [out] set to 1 iff public IPs of instances local to NC need an update
+ * @param sgs_diff [out] set to 1 iff security groups relevant to NC need an update
+ * @param instances_diff [out] set to 1 iff the private IPs of all instances need an update
+ * @return 0 if nothing needs to be updated. 1 otherwise.
+ */
+int cmp_edge_gni_diff(edge_config *edge, gni_diff *diff, int *my_instances_diff,
+        int *eips_diff, int *sgs_diff, int *instances_diff) {
+    int mine = 0;
+    u32 changes = 0;
+    gni_instance *inst = NULL;
+    gni_diff_entry *entry = NULL;
+    gni_diff_set *set = NULL;
+
+    *my_instances_diff = 0;
+    *eips_diff = 0;
+    *sgs_diff = 0;
+    *instances_diff = 0;
+
+    if (!edge || !diff || !edge->my_node) {
+        *my_instances_diff = *eips_diff = *sgs_diff = *instances_diff = 1;
+        return (1);
+    }
+
+    set = &(diff->sets[GNI_DIFF_INSTANCES]);
+    for (int i = 0; i < set->max_entries; i++) {
+        entry = &(set->entries[i]);
+        changes = (entry->before && entry->after) ? entry->changes : 0xFFFFFFFF;
+        mine = 0;
+        if (entry->before && !strcmp(((gni_instance *) entry->before)->node, edge->my_node->name)) {
+            mine = 1;
+        }
+        if (entry->after && !strcmp(((gni_instance *) entry->after)->node, edge->my_node->name)) {
+            mine = 1;
+        }
+
+        if (changes & GNI_DIFF_CHANGE_PRIVATEIP) {
+            *instances_diff = 1;
+        }
+        if (mine) {
+            if (changes & (GNI_DIFF_CHANGE_PUBLICIP | GNI_DIFF_CHANGE_PRIVATEIP | GNI_DIFF_CHANGE_NODE)) {
+                *eips_diff = 1;
+            }
+            if (changes & ~(GNI_DIFF_CHANGE_PUBLICIP | GNI_DIFF_CHANGE_SECGROUPS)) {
+                *my_instances_diff = 1;
+            }
+            if (changes & (GNI_DIFF_CHANGE_PUBLICIP | GNI_DIFF_CHANGE_PRIVATEIP | GNI_DIFF_CHANGE_NODE | GNI_DIFF_CHANGE_SECGROUPS)) {
+                *sgs_diff = 1;
+            }
+        } else if (!*sgs_diff && (changes & (GNI_DIFF_CHANGE_PUBLICIP | GNI_DIFF_CHANGE_PRIVATEIP | GNI_DIFF_CHANGE_NODE | GNI_DIFF_CHANGE_SECGROUPS))) {
+            // members of the groups of local instances are matched by IP
+            inst = (gni_instance *) (entry->after ? entry->after : entry->before);
+            for (int j = 0; j < inst->max_secgroup_names && !*sgs_diff; j++) {
+                if (is_my_secgroup(edge, inst->secgroup_names[j].name)) {
+                    *sgs_diff = 1;
+                }
+            }
+        }
+    }
+
+    set = &(diff->sets[GNI_DIFF_SECGROUPS]);
+    for (int i = 0; i < set->max_entries && !*sgs_diff; i++) {
+        entry = &(set->entries[i]);
+        if (!entry->before || !entry->after || is_my_secgroup(edge, entry->name)) {
+            *sgs_diff = 1;
+        }
+    }
+
+    if (*my_instances_diff || *eips_diff || *sgs_diff || *instances_diff) {
+        return (1);
+    }
+    return (0);
+}
+
 /**
  * Compares edge_config data structures a and b.
  * @param a [in] edge_config data structure of interest
@@ -45,6 +45,9 @@
 #define EDGE_NETMETER_FILE_NEW NC_NET_PATH_DEFAULT "/edge_netmeter"
 #define EDGE_NETMETER_FILE_DONE NC_NET_PATH_DEFAULT "/edge_netmeter_done"
 
+//! Minimum number of seconds between two dhcpd restarts triggered by DHCP configuration changes
+#define EDGE_DHCPD_RESTART_INTERVAL 5
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                  TYPEDEFS                                  |
@@ -117,12 +120,12 @@ typedef struct edge_config_t {
 
 int do_edge_update_allprivate(edge_config *edge);
 int do_edge_update_sgs(edge_config *edge);
-int do_edge_update_eips(edge_config *edge);
+int do_edge_update_eips(edge_config *edge, gni_diff *diff);
 int do_edge_update_l2(edge_config *edge);
 int do_edge_update_ips(edge_config *edge);
 int do_edge_update_netmeter(edge_config *edge);
 
-int generate_dhcpd_config(edge_config *edge);
+int generate_dhcpd_config(edge_config *edge, boolean *changed);
 int update_host_arp(edge_config *edge);
 int free_edge_config(edge_config *edge);
 int free_edge_netmeter_instance(edge_netmeter_instance *nm);
@@ -142,6 +145,8 @@ boolean is_my_ip(edge_config *edge, u32 ip);
 
 int cmp_edge_config(edge_config *a, edge_config *b, int *my_instances_diff,
         int *sgs_diff, int *instances_diff);
+int cmp_edge_gni_diff(edge_config *edge, gni_diff *diff, int *my_instances_diff,
+        int *eips_diff, int *sgs_diff, int *instances_diff);
 
 /*----------------------------------------------------------------------------*\
  |                                                                            |
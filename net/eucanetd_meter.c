@@ -46,6 +46,8 @@
 
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
+#include <poll.h>
 
 #include <linux/filter.h>
 #include <linux/if_packet.h>
@@ -88,6 +90,33 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+//! TPACKET_V3 capture ring of one capture thread, member of the fanout group of the device
+typedef struct enmRing_t {
+    int fd;                            //!< AF_PACKET socket
+    u_char *map;                       //!< Memory mapped ring of ENM_RING_BLOCK_NR blocks
+    int shard;                         //!< Class counters used by the thread
+    pthread_t tid;                     //!< Capture thread
+    long long pkts;                    //!< Number of packets accounted by the thread
+    enmConfig *config;
+} enmRing;
+
+//! Captured packet loaded from a pcap file
+typedef struct enmReplayPacket_t {
+    size_t offset;                     //!< Position of the captured bytes in enmReplay.data
+    u32 caplen;                        //!< Number of captured bytes
+    u32 len;                           //!< Length of the packet on the wire
+} enmReplayPacket;
+
+//! Packets of a pcap file replayed by one thread
+typedef struct enmReplay_t {
+    enmConfig *config;
+    u_char *data;                      //!< Captured bytes of all packets
+    enmReplayPacket *pkts;
+    int max_pkts;
+    int shard;                         //!< Class counters used by the thread, which replays every max_shards packet from shard
+    int passes;                        //!< Number of times the packets are replayed
+} enmReplay;
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                             EXTERNAL VARIABLES                             |
@@ -148,6 +177,10 @@ static volatile boolean intCaught = FALSE;
 
 static volatile boolean pcapThreadRunning = FALSE;
 static volatile boolean monitorThreadRunning = FALSE;
+static volatile boolean ringThreadsRunning = FALSE;
+
+//! Capture rings, one per capture thread (config->queues)
+static enmRing *rings = NULL;
 
 /*----------------------------------------------------------------------------*\
  |                                                                            |
@@ -162,6 +195,17 @@ static void *enm_pcap_thread(void *config);
 static int enm_pcap_open_retry(enmConfig *config, int tries);
 static int enm_pcap_loop(enmConfig *config);
 static void enm_handle_ippkt(u_char *args, const struct pcap_pkthdr *header, const u_char *packet);
+static void enm_account_ippkt(enmInterface *eni, enmClassCounts *counts, const u_char *packet, u32 caplen, u32 len);
+
+static int enm_ring_open(enmConfig *config, enmRing *ring, int fanout);
+static void enm_ring_close(enmRing *ring);
+static int enm_rings_open_retry(enmConfig *config, int tries);
+static void enm_rings_close(enmConfig *config);
+static void *enm_ring_thread(void *ring);
+static int enm_ring_loop(enmConfig *config);
+
+static void *enm_replay_thread(void *replay);
+static int enm_replay(enmConfig *config);
 
 static int enm_read_config(enmConfig *config);
 static int enm_read_gni(enmConfig *config, globalNetworkInfo *gni, char *eucahome);
@@ -184,6 +228,11 @@ static int enm_daemonize(enmConfig *config);
 
 static int enm_trim(char *str);
 
+static int enm_prefix_cmp(const void *p1, const void *p2);
+static boolean enm_prefix_contains(u32 netaddr, int netlen, u32 addr, int len);
+static void enm_fold_classes(enmInterface *eni);
+static void enm_counter_totals(enmInterface *eni, int idx, long long *pkts_in, long long *bytes_in, long long *pkts_out, long long *bytes_out);
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                   MACROS                                   |
@@ -211,8 +260,10 @@ static void print_usage(char *argv0) {
             "\t%-12s| run in background\n"
             "\t%-12s| enable interface in promiscuous mode (note: inverse of tcpdump)\n"
             "\t%-12s| read snaplen bytes of each captured packet (default 64 bytes)\n"
+            "\t%-12s| capture with queues TPACKET_V3 rings and threads (AF_PACKET fanout)\n"
+            "\t%-12s| replay a pcap file through the counters (device mode, count passes)\n"
             , EUCA_VERSION, argv0, "-c count", "-i dev", "-m mode", "-l l_ips",
-            "-n l_sn", "-d", "-p", "-s slen");
+            "-n l_sn", "-d", "-p", "-s slen", "-q queues", "-r file");
     exit (1);
 }
 
@@ -251,7 +302,7 @@ int main(int argc, char *argv[]) {
     config = EUCA_ZALLOC_C(1, sizeof (enmConfig));
     config->snaplen = 64;
 
-    while ((opt = getopt(argc, argv, "hHc:i:m:l:n:dps:")) != -1) {
+    while ((opt = getopt(argc, argv, "hHc:i:m:l:n:dps:q:r:")) != -1) {
         switch (opt) {
             case 'c':
                 config->count = atoi(optarg);
@@ -266,7 +317,7 @@ int main(int argc, char *argv[]) {
                 snprintf(lips, CHAR_BUFFER_SIZE, "%s", optarg);
                 break;
             case 'n':
-                snprintf(dev, NETWORK_ADDR_LEN, "%s", optarg);
+                snprintf(lsn, NETWORK_ADDR_LEN, "%s", optarg);
                 break;
             case 'd':
                 config->daemonize = 1;
@@ -281,6 +332,17 @@ int main(int argc, char *argv[]) {
                     config->snaplen = 64;
                 }
                 break;
+            case 'q':
+                config->queues = atoi(optarg);
+                if ((config->queues < 0) || (config->queues > ENM_MAX_QUEUES)) {
+                    LOGWARN("Invalid number of queues %s. Will default to libpcap capture\n", optarg);
+                    config->queues = 0;
+                }
+                break;
+            case 'r':
+                EUCA_FREE(config->replay);
+                config->replay = strdup(optarg);
+                break;
             case 'H':
             case 'h':
             default:
@@ -288,12 +350,33 @@ int main(int argc, char *argv[]) {
                 break;
         }
     }
-    if (!strlen(dev)) {
+    if (!strlen(dev) && !config->replay) {
         fprintf(stderr, "\tPlease specify interface to meter.\n");
         enm_exit(1, NULL);
     }
     if (!strlen(mode)) {
-        snprintf(dev, IF_NAME_LEN, "device");
+        snprintf(mode, SMALL_CHAR_BUFFER_SIZE, "device");
+    }
+    int max_shards = ((config->queues > 0) ? config->queues : 1);
+
+    if (config->replay) {
+        enm_initialize_logs(config, EUCA_LOG_INFO);
+        if (strlen(lips)) {
+            config->lips = strdup(lips);
+        }
+        if (strlen(lsn)) {
+            config->lsn = strdup(lsn);
+        }
+        enm_read_config_dev(dev, config);
+        if (enmCompileCounters(&(config->eni), max_shards) || enm_replay(config)) {
+            enm_exit(1, NULL);
+        }
+        char *stats = enmPrintCounters(config);
+        LOGINFO("\n%s\n", stats);
+        EUCA_FREE(stats);
+        enm_config_free(config);
+        EUCA_FREE(config);
+        return (0);
     }
 
     if (config->daemonize) {
@@ -312,7 +395,11 @@ int main(int argc, char *argv[]) {
         snprintf(pcapdev, IF_NAME_LEN, "vn_%s", dev);
     }
     config->device = strdup(pcapdev);
-    if (enm_pcap_open_retry(config, 100)) {
+    if (config->queues) {
+        if (enm_rings_open_retry(config, 100)) {
+            enm_exit(1, NULL);
+        }
+    } else if (enm_pcap_open_retry(config, 100)) {
         enm_exit(1, NULL);
     }
     
@@ -346,13 +433,20 @@ int main(int argc, char *argv[]) {
         GNI_FREE(gni);
         EUCA_FREE(gni);
     }
+    if (enmCompileCounters(&(config->eni), max_shards)) {
+        enm_exit(1, "failed to compile counters");
+    }
 
     monitorThreadId = enm_create_thread(enm_monitor_thread, config);
     if (monitorThreadId > 0) {
         LOGINFO("created thread %ld\n", monitorThreadId);
     }
 
-    enm_pcap_thread(config);
+    if (config->queues) {
+        enm_ring_loop(config);
+    } else {
+        enm_pcap_thread(config);
+    }
     
     if (monitorThreadId > 0) {
         if (monitorThreadRunning) {
@@ -366,6 +460,7 @@ int main(int argc, char *argv[]) {
     if (ph) {
         pcap_close(ph);
     }
+    enm_rings_close(config);
 
     char *stats = enmPrintCounters(config);
     LOGINFO("\n%s\n", stats);
@@ -493,16 +588,31 @@ static int enm_pcap_loop(enmConfig *config) {
  * @param packet [out] captured packet's data
  */
 static void enm_handle_ippkt(u_char *args, const struct pcap_pkthdr *header, const u_char *packet) {
-    struct ip *ip_hdr = NULL;
-       
     if (!header || !packet || !args) {
         LOGWARN("cannot handle null packet\n");
         return;
     }
     
     enmConfig *config = (enmConfig *) args;
-    enmInterface *eni = &(config->eni);
-    
+    enm_account_ippkt(&(config->eni), config->eni.counts, packet, header->caplen, header->len);
+}
+
+/**
+ * Accounts a captured IP packet to the traffic classes of its addresses.
+ * @param eni [in] enmInterface structure of interest
+ * @param counts [in] class counters of the calling capture thread
+ * @param packet [in] captured packet's data, starting with its ethernet header
+ * @param caplen [in] number of bytes captured
+ * @param len [in] length of the packet on the wire
+ */
+static void enm_account_ippkt(enmInterface *eni, enmClassCounts *counts, const u_char *packet, u32 caplen, u32 len) {
+    struct ip *ip_hdr = NULL;
+
+    if (caplen < (ETH_HLEN + sizeof (struct ip))) {
+        LOGWARN("truncated IP packet captured\n");
+        return;
+    }
+
     ip_hdr = (struct ip *) (packet + ETH_HLEN);
     int ip_hdr_len = ip_hdr->ip_hl * 4;
     if (ip_hdr_len < 20) {
@@ -510,56 +620,28 @@ static void enm_handle_ippkt(u_char *args, const struct pcap_pkthdr *header, con
         return;
     }
 
-    if (header->len < (ip_hdr_len + ETH_HLEN)) {
+    if (len < (ip_hdr_len + ETH_HLEN)) {
         LOGWARN("invalid IP packet captured\n");
         return;
     }
     
-    boolean pktin = FALSE;
-    boolean pktout = FALSE;
-    for (int i = 0; !pktin && !pktout && (i < eni->max_local_ips); i++) {
-        if (ip_hdr->ip_src.s_addr == eni->local_ips[i]->s_addr) {
-            pktout = TRUE;
-        }
-        if (ip_hdr->ip_dst.s_addr == eni->local_ips[i]->s_addr) {
-            pktin = TRUE;
-        }
+    if (!eni->max_classes) {
+        return;
     }
 
-    for (int i = 0; i < eni->max_counters; i++) {
-        enmCounter *counter = eni->counters[i];
-        if (pktin) {
-            for (int j = 0; j < counter->max_match; j++) {
-                if ((ip_hdr->ip_src.s_addr & counter->match_netmask[j]->s_addr) ==
-                        counter->match_netaddr[j]->s_addr) {
-                    (counter->pkts_in)++;
-                    counter->bytes_in += header->len;
-                }
-            }
-            for (int j = 0; j < counter->max_inv_match; j++) {
-                if ((ip_hdr->ip_src.s_addr & counter->inv_match_netmask[j]->s_addr) !=
-                        counter->inv_match_netaddr[j]->s_addr) {
-                    (counter->pkts_in)++;
-                    counter->bytes_in += header->len;
-                }
-            }
-        }
-        if (pktout) {
-            for (int j = 0; j < counter->max_match; j++) {
-                if ((ip_hdr->ip_dst.s_addr & counter->match_netmask[j]->s_addr) ==
-                        counter->match_netaddr[j]->s_addr) {
-                    (counter->pkts_out)++;
-                    counter->bytes_out += header->len;
-                }
-            }
-            for (int j = 0; j < counter->max_inv_match; j++) {
-                if ((ip_hdr->ip_dst.s_addr & counter->inv_match_netmask[j]->s_addr) !=
-                        counter->inv_match_netaddr[j]->s_addr) {
-                    (counter->pkts_out)++;
-                    counter->bytes_out += header->len;
-                }
-            }
-        }
+    // Each address maps to the class of the local IPs and counter entries it matches
+    u32 srcclass = euca_lpm_lookup(&(eni->classifier), ntohl(ip_hdr->ip_src.s_addr));
+    u32 dstclass = euca_lpm_lookup(&(eni->classifier), ntohl(ip_hdr->ip_dst.s_addr));
+    boolean pktin = eni->classes[dstclass].local;
+    boolean pktout = eni->classes[srcclass].local;
+
+    if (pktin) {
+        (counts[srcclass].pkts_in)++;
+        counts[srcclass].bytes_in += len;
+    }
+    if (pktout) {
+        (counts[dstclass].pkts_out)++;
+        counts[dstclass].bytes_out += len;
     }
 
 #ifdef EUCANETD_DEBUG
@@ -567,13 +649,336 @@ static void enm_handle_ippkt(u_char *args, const struct pcap_pkthdr *header, con
     u16 type = ntohs(eth_hdr->h_proto);
     char *src = EUCA_INETA2DOT(&(ip_hdr->ip_src));
     char *dst = EUCA_INETA2DOT(&(ip_hdr->ip_dst));
-    LOGINFO("%d bytes, type %x, %s -> %s %s\n", header->len, type,
+    LOGINFO("%d bytes, type %x, %s -> %s %s\n", len, type,
             src, dst, pktin ? "in" : "out");
     EUCA_FREE(src);
     EUCA_FREE(dst);
 #endif //EUCANETD_DEBUG
 }
 
+/**
+ * Opens a TPACKET_V3 capture ring on config->device. Only IP packets are captured,
+ * truncated to config->snaplen bytes in the kernel. When there are several capture
+ * threads, the ring joins the fanout group of the device so that the kernel spreads
+ * flows over the threads.
+ * @param config [in] eucanetd_meter configuration parameters
+ * @param ring [in] the ring to open
+ * @param fanout [in] identifier of the fanout group
+ * @return 0 on success. Positive integer on failure.
+ */
+static int enm_ring_open(enmConfig *config, enmRing *ring, int fanout) {
+    int version = TPACKET_V3;
+    int fanout_arg = ((fanout & 0xFFFF) | (PACKET_FANOUT_HASH << 16));
+    struct tpacket_req3 req = { 0 };
+    struct sockaddr_ll ll = { 0 };
+    struct packet_mreq mreq = { 0 };
+    struct sock_filter snap[] = { BPF_STMT(BPF_RET | BPF_K, ((config->snaplen > 0) ? config->snaplen : 0x40000)) };
+    struct sock_fprog prog = { 1, snap };
+
+    ring->fd = -1;
+    ring->map = NULL;
+    int ifindex = if_nametoindex(config->device);
+    if (!ifindex) {
+        LOGDEBUG("cannot find %s\n", config->device);
+        return (1);
+    }
+
+    // protocol 0 until bound, not to receive packets of other interfaces
+    if ((ring->fd = socket(AF_PACKET, SOCK_RAW, 0)) < 0) {
+        LOGERROR("cannot open packet socket: %s\n", strerror(errno));
+        return (1);
+    }
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof (version))) {
+        LOGERROR("TPACKET_V3 not supported: %s\n", strerror(errno));
+        enm_ring_close(ring);
+        return (1);
+    }
+    if (setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof (prog))) {
+        LOGWARN("cannot truncate packets to %d bytes: %s\n", config->snaplen, strerror(errno));
+    }
+
+    req.tp_block_size = ENM_RING_BLOCK_SIZE;
+    req.tp_block_nr = ENM_RING_BLOCK_NR;
+    req.tp_frame_size = ENM_RING_FRAME_SIZE;
+    req.tp_frame_nr = (ENM_RING_BLOCK_SIZE / ENM_RING_FRAME_SIZE) * ENM_RING_BLOCK_NR;
+    req.tp_retire_blk_tov = ENM_RING_BLOCK_TIMEOUT;
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof (req))) {
+        LOGERROR("cannot set up capture ring: %s\n", strerror(errno));
+        enm_ring_close(ring);
+        return (1);
+    }
+    ring->map = mmap(NULL, (size_t) ENM_RING_BLOCK_SIZE * ENM_RING_BLOCK_NR, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+    if (ring->map == MAP_FAILED) {
+        LOGERROR("cannot map capture ring: %s\n", strerror(errno));
+        ring->map = NULL;
+        enm_ring_close(ring);
+        return (1);
+    }
+
+    ll.sll_family = AF_PACKET;
+    ll.sll_protocol = htons(ETH_P_IP);
+    ll.sll_ifindex = ifindex;
+    if (bind(ring->fd, (struct sockaddr *) &ll, sizeof (ll))) {
+        LOGERROR("cannot bind to %s: %s\n", config->device, strerror(errno));
+        enm_ring_close(ring);
+        return (1);
+    }
+    if (config->promiscuous_mode) {
+        mreq.mr_ifindex = ifindex;
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(ring->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof (mreq))) {
+            LOGWARN("cannot set %s in promiscuous mode: %s\n", config->device, strerror(errno));
+        }
+    }
+    if ((config->queues > 1) && setsockopt(ring->fd, SOL_PACKET, PACKET_FANOUT, &fanout_arg, sizeof (fanout_arg))) {
+        LOGERROR("cannot join fanout group %d: %s\n", fanout, strerror(errno));
+        enm_ring_close(ring);
+        return (1);
+    }
+    return (0);
+}
+
+/**
+ * Releases a capture ring.
+ * @param ring [in] the ring to close
+ */
+static void enm_ring_close(enmRing *ring) {
+    if (ring->map) {
+        munmap(ring->map, (size_t) ENM_RING_BLOCK_SIZE * ENM_RING_BLOCK_NR);
+        ring->map = NULL;
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+        ring->fd = -1;
+    }
+}
+
+/**
+ * Try tries times (once a second) to open config->queues capture rings on config->device.
+ * Useful when waiting for VM interface to be created.
+ * @param config [in] eucanetd_meter configuration parameters
+ * @param tries [in] number of open attempts
+ * @return 0 on success. Positive integer on failure.
+ */
+static int enm_rings_open_retry(enmConfig *config, int tries) {
+    int rc = 0;
+
+    if (!config || !config->device || (config->queues < 1)) {
+        LOGWARN("cannot open NULL device.\n");
+        return (1);
+    }
+    LOGINFO("opening %d capture rings on %s\n", config->queues, config->device);
+    rings = EUCA_ZALLOC_C(config->queues, sizeof (enmRing));
+    while (tries) {
+        rc = 0;
+        for (int i = 0; (i < config->queues) && !rc; i++) {
+            rc = enm_ring_open(config, &(rings[i]), getpid());
+        }
+        if (!rc) {
+            return (0);
+        }
+        enm_rings_close(config);
+        rings = EUCA_ZALLOC_C(config->queues, sizeof (enmRing));
+        tries--;
+        sleep(1);
+    }
+    LOGERROR("Failed to open capture rings on %s\n", config->device);
+    EUCA_FREE(rings);
+    return (1);
+}
+
+/**
+ * Releases the capture rings.
+ * @param config [in] eucanetd_meter configuration parameters
+ */
+static void enm_rings_close(enmConfig *config) {
+    if (!rings) {
+        return;
+    }
+    for (int i = 0; i < config->queues; i++) {
+        enm_ring_close(&(rings[i]));
+    }
+    EUCA_FREE(rings);
+}
+
+/**
+ * Capture thread of a TPACKET_V3 ring: accounts the packets of each block the kernel
+ * hands over, in place, then hands the block back.
+ * @param ring [in] the ring to read
+ * @return NULL
+ */
+static void *enm_ring_thread(void *ring) {
+    enmRing *r = (enmRing *) ring;
+    enmInterface *eni = &(r->config->eni);
+    enmClassCounts *counts = &(eni->counts[r->shard * eni->shard_stride]);
+    struct pollfd pfd = { 0 };
+    int block = 0;
+
+    pfd.fd = r->fd;
+    pfd.events = POLLIN | POLLERR;
+    while (ringThreadsRunning) {
+        struct tpacket_block_desc *bd = (struct tpacket_block_desc *) (r->map + ((size_t) block * ENM_RING_BLOCK_SIZE));
+        if (!(bd->hdr.bh1.block_status & TP_STATUS_USER)) {
+            poll(&pfd, 1, 1000);
+            continue;
+        }
+        struct tpacket3_hdr *pkt = (struct tpacket3_hdr *) ((u_char *) bd + bd->hdr.bh1.offset_to_first_pkt);
+        for (u32 i = 0; i < bd->hdr.bh1.num_pkts; i++) {
+            enm_account_ippkt(eni, counts, (u_char *) pkt + pkt->tp_mac, pkt->tp_snaplen, pkt->tp_len);
+            pkt = (struct tpacket3_hdr *) ((u_char *) pkt + pkt->tp_next_offset);
+        }
+        r->pkts += bd->hdr.bh1.num_pkts;
+        __sync_synchronize();
+        bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+        block = (block + 1) % ENM_RING_BLOCK_NR;
+    }
+    return (NULL);
+}
+
+/**
+ * Runs a capture thread per ring until a signal stops them.
+ * @param config [in] eucanetd_meter configuration parameters
+ * @return 0 on success. Positive integer on any failure.
+ */
+static int enm_ring_loop(enmConfig *config) {
+    int ret = 0;
+    struct tpacket_stats_v3 stats = { 0 };
+    socklen_t statslen = sizeof (stats);
+
+    ringThreadsRunning = TRUE;
+    for (int i = 0; i < config->queues; i++) {
+        rings[i].config = config;
+        rings[i].shard = i;
+        rings[i].tid = enm_create_thread(enm_ring_thread, &(rings[i]));
+        if (rings[i].tid > 0) {
+            LOGINFO("created capture thread %ld\n", rings[i].tid);
+        } else {
+            ret = 1;
+        }
+    }
+    for (int i = 0; i < config->queues; i++) {
+        if (rings[i].tid > 0) {
+            pthread_join(rings[i].tid, NULL);
+        }
+        if (!getsockopt(rings[i].fd, SOL_PACKET, PACKET_STATISTICS, &stats, &statslen)) {
+            LOGINFO("capture ring %d: %lld packets accounted, %u dropped\n", i, rings[i].pkts, stats.tp_drops);
+        }
+    }
+    ringThreadsRunning = FALSE;
+    return (ret);
+}
+
+/**
+ * Replay thread: accounts every max_shards packet of a pcap file, starting with
+ * the shard-th, replay->passes times.
+ * @param replay [in] the packets to replay
+ * @return NULL
+ */
+static void *enm_replay_thread(void *replay) {
+    enmReplay *rp = (enmReplay *) replay;
+    enmInterface *eni = &(rp->config->eni);
+    enmClassCounts *counts = &(eni->counts[rp->shard * eni->shard_stride]);
+
+    for (int pass = 0; pass < rp->passes; pass++) {
+        for (int i = rp->shard; i < rp->max_pkts; i += eni->max_shards) {
+            enmReplayPacket *pkt = &(rp->pkts[i]);
+            enm_account_ippkt(eni, counts, rp->data + pkt->offset, pkt->caplen, pkt->len);
+        }
+    }
+    return (NULL);
+}
+
+/**
+ * Replays the packets of the pcap file config->replay through the counters and
+ * reports the accounting rate. Packets are loaded in memory first (up to snaplen
+ * bytes each) so that only the accounting is measured. The packets are split over
+ * one thread per counter shard and replayed config->count times.
+ * @param config [in] eucanetd_meter configuration parameters
+ * @return 0 on success. Positive integer on any failure.
+ */
+static int enm_replay(enmConfig *config) {
+    int rc = 0;
+    int max_pkts = 0;
+    size_t used = 0;
+    size_t size = 0;
+    u32 keep = 0;
+    char errbuf[PCAP_ERRBUF_SIZE] = "";
+    u_char *data = NULL;
+    const u_char *bytes = NULL;
+    struct pcap_pkthdr *header = NULL;
+    enmReplayPacket *pkts = NULL;
+    enmInterface *eni = &(config->eni);
+    enmReplay *replays = NULL;
+    struct timeval tv = { 0 };
+
+    pcap_t *rh = pcap_open_offline(config->replay, errbuf);
+    if (!rh) {
+        LOGERROR("Failed to open %s: %s\n", config->replay, errbuf);
+        return (1);
+    }
+    if (pcap_datalink(rh) != DLT_EN10MB) {
+        LOGERROR("%s is not an ethernet capture\n", config->replay);
+        pcap_close(rh);
+        return (1);
+    }
+    while ((rc = pcap_next_ex(rh, &header, &bytes)) == 1) {
+        keep = (((config->snaplen > 0) && (header->caplen > config->snaplen)) ? config->snaplen : header->caplen);
+        if ((used + keep) > size) {
+            size = (size ? (size * 2) : (1 << 20)) + keep;
+            data = EUCA_REALLOC_C(data, size, sizeof (u_char));
+        }
+        if ((max_pkts % 1024) == 0) {
+            pkts = EUCA_REALLOC_C(pkts, max_pkts + 1024, sizeof (enmReplayPacket));
+        }
+        memcpy(data + used, bytes, keep);
+        pkts[max_pkts].offset = used;
+        pkts[max_pkts].caplen = keep;
+        pkts[max_pkts].len = header->len;
+        max_pkts++;
+        used += keep;
+    }
+    if (rc == -1) {
+        LOGWARN("error reading %s: %s\n", config->replay, pcap_geterr(rh));
+    }
+    pcap_close(rh);
+
+    replays = EUCA_ZALLOC_C(eni->max_shards, sizeof (enmReplay));
+    for (int i = 0; i < eni->max_shards; i++) {
+        replays[i].config = config;
+        replays[i].data = data;
+        replays[i].pkts = pkts;
+        replays[i].max_pkts = max_pkts;
+        replays[i].shard = i;
+        replays[i].passes = ((config->count > 0) ? config->count : 1);
+    }
+
+    eucanetd_timer_usec(&tv);
+    if (eni->max_shards == 1) {
+        enm_replay_thread(&(replays[0]));
+    } else {
+        pthread_t *tids = EUCA_ZALLOC_C(eni->max_shards, sizeof (pthread_t));
+        for (int i = 0; i < eni->max_shards; i++) {
+            tids[i] = enm_create_thread(enm_replay_thread, &(replays[i]));
+        }
+        for (int i = 0; i < eni->max_shards; i++) {
+            if (tids[i] > 0) {
+                pthread_join(tids[i], NULL);
+            }
+        }
+        EUCA_FREE(tids);
+    }
+    long elapsed = eucanetd_timer_usec(&tv);
+
+    double total = (double) max_pkts * replays[0].passes;
+    LOGINFO("replayed %.0f packets of %s with %d threads in %.2f ms: %.0f packets/s\n", total, config->replay,
+            eni->max_shards, elapsed / 1000.0, (elapsed ? (total * 1000000.0 / elapsed) : 0));
+
+    EUCA_FREE(replays);
+    EUCA_FREE(pkts);
+    EUCA_FREE(data);
+    return (0);
+}
+
 /**
  * Reads the eucalyptus.conf configuration file and pull the important fields.
  * @param config [in] pointer to data structure that hold eucanetd_meter information
@@ -970,6 +1375,7 @@ static int enm_config_free(enmConfig *config) {
         EUCA_FREE(config->device);
         EUCA_FREE(config->lips);
         EUCA_FREE(config->lsn);
+        EUCA_FREE(config->replay);
         atomic_file_free(&(config->gni_atomic_file));
         memset(config, 0, sizeof (enmConfig));
     }
@@ -984,6 +1390,7 @@ static void enm_sigterm_handler(int signal) {
     LOGINFO("enm caught SIGTERM signal.\n");
     termCaught = TRUE;
     enm_sig_rcvd = signal;
+    ringThreadsRunning = FALSE;
     if (ph && pcapThreadRunning) {
         pcap_breakloop(ph);
     }
@@ -997,6 +1404,7 @@ static void enm_sigint_handler(int signal) {
     LOGINFO("enm caught SIGINT signal.\n");
     intCaught = TRUE;
     enm_sig_rcvd = signal;
+    ringThreadsRunning = FALSE;
     if (ph && pcapThreadRunning) {
         pcap_breakloop(ph);
     }
@@ -1120,6 +1528,10 @@ int enmInterface_free(enmInterface *eni) {
         EUCA_FREE(eni->counters[i]);
     }
     EUCA_FREE(eni->counters);
+    euca_lpm_clear(&(eni->classifier));
+    EUCA_FREE(eni->classes);
+    EUCA_FREE(eni->hits);
+    EUCA_FREE(eni->counts);
     memset(eni, 0, sizeof(enmInterface));
     return (0);
 }
@@ -1251,6 +1663,201 @@ int counterAddMatch(enmCounter *counter, boolean inv, char *cidr) {
     return (0);
 }
 
+/**
+ * Compiles the local IPs and the counters of the given interface into a classifier.
+ * Every distinct network of the counter match lists and every local IP becomes a
+ * traffic class, along with the list of counter entries it matches, so that a
+ * captured packet is accounted with two lookups whatever the number of counters.
+ * Packets accounted by a previous classifier are first added to the counters.
+ * The class counters are replicated in max_shards shards, one per capture thread,
+ * so that threads never write to the same counters.
+ * @param eni [in] enmInterface structure of interest
+ * @param max_shards [in] number of capture threads
+ * @return 0 on success. 1 on any failure.
+ */
+int enmCompileCounters(enmInterface *eni, int max_shards) {
+    if (!eni || (max_shards < 1)) {
+        return (1);
+    }
+
+    enm_fold_classes(eni);
+    euca_lpm_clear(&(eni->classifier));
+    EUCA_FREE(eni->classes);
+    EUCA_FREE(eni->hits);
+    EUCA_FREE(eni->counts);
+    eni->max_classes = 0;
+    eni->max_hits = 0;
+    eni->max_shards = 0;
+    eni->shard_stride = 0;
+
+    // Distinct networks of the local IPs and counter entries
+    int max_prefixes = eni->max_local_ips;
+    for (int i = 0; i < eni->max_counters; i++) {
+        max_prefixes += eni->counters[i]->max_match + eni->counters[i]->max_inv_match;
+    }
+    euca_lpm_prefix *prefixes = EUCA_ZALLOC_C(max_prefixes + 1, sizeof (euca_lpm_prefix));
+    int j = 0;
+    for (int i = 0; i < eni->max_local_ips; i++, j++) {
+        prefixes[j].addr = ntohl(eni->local_ips[i]->s_addr);
+        prefixes[j].len = 32;
+    }
+    for (int i = 0; i < eni->max_counters; i++) {
+        enmCounter *counter = eni->counters[i];
+        for (int k = 0; k < counter->max_match; k++, j++) {
+            prefixes[j].len = NETMASK_TO_SLASHNET(ntohl(counter->match_netmask[k]->s_addr));
+            prefixes[j].addr = ntohl(counter->match_netaddr[k]->s_addr);
+        }
+        for (int k = 0; k < counter->max_inv_match; k++, j++) {
+            prefixes[j].len = NETMASK_TO_SLASHNET(ntohl(counter->inv_match_netmask[k]->s_addr));
+            prefixes[j].addr = ntohl(counter->inv_match_netaddr[k]->s_addr);
+        }
+    }
+    for (int i = 0; i < max_prefixes; i++) {
+        prefixes[i].addr &= (prefixes[i].len ? (0xFFFFFFFF << (32 - prefixes[i].len)) : 0);
+    }
+    qsort(prefixes, max_prefixes, sizeof (euca_lpm_prefix), enm_prefix_cmp);
+    j = 0;
+    for (int i = 0; i < max_prefixes; i++) {
+        if (!j || enm_prefix_cmp(&(prefixes[j - 1]), &(prefixes[i]))) {
+            prefixes[j++] = prefixes[i];
+        }
+    }
+    max_prefixes = j;
+
+    // Class 0 holds the addresses that are in none of the networks
+    eni->max_classes = max_prefixes + 1;
+    eni->classes = EUCA_ZALLOC_C(eni->max_classes, sizeof (enmClass));
+    for (int i = 0; i < eni->max_classes; i++) {
+        enmClass *class = &(eni->classes[i]);
+        u32 addr = (i ? prefixes[i - 1].addr : 0);
+        int len = (i ? prefixes[i - 1].len : -1);
+        if (i) {
+            prefixes[i - 1].value = i;
+        }
+        for (int k = 0; (len == 32) && !class->local && (k < eni->max_local_ips); k++) {
+            class->local = (addr == ntohl(eni->local_ips[k]->s_addr));
+        }
+        // The networks containing a class are the same for all its addresses
+        class->first_hit = eni->max_hits;
+        for (int c = 0; c < eni->max_counters; c++) {
+            enmCounter *counter = eni->counters[c];
+            int hits = 0;
+            for (int k = 0; k < counter->max_match; k++) {
+                hits += enm_prefix_contains(ntohl(counter->match_netaddr[k]->s_addr),
+                        NETMASK_TO_SLASHNET(ntohl(counter->match_netmask[k]->s_addr)), addr, len);
+            }
+            for (int k = 0; k < counter->max_inv_match; k++) {
+                hits += !enm_prefix_contains(ntohl(counter->inv_match_netaddr[k]->s_addr),
+                        NETMASK_TO_SLASHNET(ntohl(counter->inv_match_netmask[k]->s_addr)), addr, len);
+            }
+            if (hits) {
+                eni->hits = EUCA_REALLOC_C(eni->hits, eni->max_hits + hits, sizeof (int));
+                for (; hits > 0; hits--) {
+                    eni->hits[eni->max_hits++] = c;
+                }
+            }
+        }
+        class->max_hits = eni->max_hits - class->first_hit;
+    }
+
+    int rc = euca_lpm_build(&(eni->classifier), prefixes, max_prefixes, 0);
+    EUCA_FREE(prefixes);
+    if (rc) {
+        LOGERROR("failed to build the classifier of %s\n", eni->name);
+        EUCA_FREE(eni->classes);
+        eni->max_classes = 0;
+        return (1);
+    }
+    // Even stride: 2 class counters per 64 bytes cache line, shards never share a line
+    eni->max_shards = max_shards;
+    eni->shard_stride = (eni->max_classes + 1) & ~1;
+    eni->counts = EUCA_ZALLOC_C(eni->max_shards * eni->shard_stride, sizeof (enmClassCounts));
+    LOGINFO("\t%d counters compiled into %d classes (%d nodes)\n", eni->max_counters, eni->max_classes, eni->classifier.max_nodes);
+    return (0);
+}
+
+/**
+ * Orders euca_lpm_prefix structures by address then length.
+ * @param p1 [in] pointer to the first euca_lpm_prefix
+ * @param p2 [in] pointer to the second euca_lpm_prefix
+ * @return a negative, zero or positive integer as p1 is lower, equal or greater than p2
+ */
+static int enm_prefix_cmp(const void *p1, const void *p2) {
+    const euca_lpm_prefix *a = (const euca_lpm_prefix *) p1;
+    const euca_lpm_prefix *b = (const euca_lpm_prefix *) p2;
+    if (a->addr != b->addr) {
+        return ((a->addr < b->addr) ? -1 : 1);
+    }
+    return (a->len - b->len);
+}
+
+/**
+ * Checks whether the network netaddr/netlen contains the network addr/len.
+ * @param netaddr [in] network address, host byte order
+ * @param netlen [in] network prefix length
+ * @param addr [in] address of the network of interest, host byte order
+ * @param len [in] prefix length of the network of interest. -1 stands for the
+ * addresses that are in no network, which no network contains.
+ * @return TRUE if addr/len is within netaddr/netlen. FALSE otherwise.
+ */
+static boolean enm_prefix_contains(u32 netaddr, int netlen, u32 addr, int len) {
+    if ((len < 0) || (netlen > len)) {
+        return (FALSE);
+    }
+    u32 mask = (netlen ? (0xFFFFFFFF << (32 - netlen)) : 0);
+    return (((addr ^ netaddr) & mask) ? FALSE : TRUE);
+}
+
+/**
+ * Adds the packets accounted by the classes of the given interface to its counters
+ * and resets the classes.
+ * @param eni [in] enmInterface structure of interest
+ */
+static void enm_fold_classes(enmInterface *eni) {
+    for (int i = 0; i < eni->max_counters; i++) {
+        enmCounter *counter = eni->counters[i];
+        enm_counter_totals(eni, i, &(counter->pkts_in), &(counter->bytes_in), &(counter->pkts_out), &(counter->bytes_out));
+    }
+    if (eni->counts) {
+        memset(eni->counts, 0, eni->max_shards * eni->shard_stride * sizeof (enmClassCounts));
+    }
+}
+
+/**
+ * Computes the totals of a counter: what it accounted before the current classifier
+ * was compiled plus what the classes that match it accounted since, in all shards.
+ * @param eni [in] enmInterface structure of interest
+ * @param idx [in] position of the counter in eni->counters
+ * @param pkts_in [out] number of packets received
+ * @param bytes_in [out] number of bytes received
+ * @param pkts_out [out] number of packets sent
+ * @param bytes_out [out] number of bytes sent
+ */
+static void enm_counter_totals(enmInterface *eni, int idx, long long *pkts_in, long long *bytes_in, long long *pkts_out, long long *bytes_out) {
+    enmCounter *counter = eni->counters[idx];
+    long long pi = counter->pkts_in, bi = counter->bytes_in, po = counter->pkts_out, bo = counter->bytes_out;
+
+    for (int i = 0; eni->counts && (i < eni->max_classes); i++) {
+        enmClass *class = &(eni->classes[i]);
+        for (int k = class->first_hit; k < (class->first_hit + class->max_hits); k++) {
+            if (eni->hits[k] != idx) {
+                continue;
+            }
+            for (int s = 0; s < eni->max_shards; s++) {
+                enmClassCounts *counts = &(eni->counts[s * eni->shard_stride + i]);
+                pi += counts->pkts_in;
+                bi += counts->bytes_in;
+                po += counts->pkts_out;
+                bo += counts->bytes_out;
+            }
+        }
+    }
+    *pkts_in = pi;
+    *bytes_in = bi;
+    *pkts_out = po;
+    *bytes_out = bo;
+}
+
 /**
  * Generates a string with current counter statistics.
  * @param config [in] pointer to data structure that hold eucanetd_meter information
@@ -1270,11 +1877,13 @@ char *enmPrintCounters(enmConfig *config) {
     
     for (int i = 0; i < eni->max_counters; i++) {
         enmCounter *counter = eni->counters[i];
+        long long pkts_in, bytes_in, pkts_out, bytes_out;
+        enm_counter_totals(eni, i, &pkts_in, &bytes_in, &pkts_out, &bytes_out);
         euca_buffer_snprintf(&pbuf, &pbuf_len, "%s\n", counter->name);
         euca_buffer_snprintf(&pbuf, &pbuf_len, "\tpkts_in : %ld, bytes_in  %ld\n",
-                counter->pkts_in, counter->bytes_in);
+                pkts_in, bytes_in);
         euca_buffer_snprintf(&pbuf, &pbuf_len, "\tpkts_out: %ld, bytes_out %ld\n",
-                counter->pkts_out, counter->bytes_out);
+                pkts_out, bytes_out);
     }
     
     return (buf);
@@ -35,6 +35,8 @@
 #include <config.h>
 #include <atomic_file.h>
 
+#include "euca_lpm.h"
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                  DEFINES                                   |
@@ -43,6 +45,12 @@
 
 #define NUM_ENM_CONFIG                      1
 
+#define ENM_MAX_QUEUES                     64   //!< Maximum number of capture threads (-q)
+#define ENM_RING_BLOCK_SIZE         (1 << 18)   //!< Size of a block of a TPACKET_V3 capture ring
+#define ENM_RING_BLOCK_NR                  16   //!< Number of blocks of a capture ring
+#define ENM_RING_FRAME_SIZE              2048   //!< Nominal frame size of a capture ring (TPACKET_V3 packs frames of any size)
+#define ENM_RING_BLOCK_TIMEOUT            100   //!< Milliseconds after which a partially filled block is handed over
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                  TYPEDEFS                                  |
@@ -87,6 +95,21 @@ typedef struct enmCounter_t {
     char name[SMALL_CHAR_BUFFER_SIZE];
 } enmCounter;
 
+//! Addresses that are local IPs or not and that match the same counter entries
+typedef struct enmClass_t {
+    boolean local;                     //!< TRUE if the addresses of the class are local IPs
+    int first_hit;                     //!< Position of the first counter of the class in enmInterface.hits
+    int max_hits;                      //!< Number of counter entries matched by the class
+} enmClass;
+
+//! Traffic of a class accounted by one capture thread since the class was compiled
+typedef struct enmClassCounts_t {
+    long long bytes_in;                //!< Bytes received from the addresses of the class
+    long long bytes_out;               //!< Bytes sent to the addresses of the class
+    long long pkts_in;                 //!< Packets received from the addresses of the class
+    long long pkts_out;                //!< Packets sent to the addresses of the class
+} enmClassCounts;
+
 typedef struct enmInterface_t {
     long long id;
     char name[INTERFACE_ID_LEN];
@@ -99,6 +122,14 @@ typedef struct enmInterface_t {
     enmCounter *external;
     enmCounter *metadata;
     enmCounter *clc;
+    euca_lpm classifier;               //!< Maps addresses (host byte order) to their position in classes
+    enmClass *classes;                 //!< Traffic classes compiled from local_ips and counters, 0 is the default class
+    int max_classes;
+    int *hits;                         //!< Counter positions matched by each class, a counter appears once per matching entry
+    int max_hits;
+    enmClassCounts *counts;            //!< Class counters of each capture thread, shard_stride entries per thread
+    int max_shards;                    //!< Number of capture threads
+    int shard_stride;                  //!< max_classes rounded up so that threads do not share cache lines
 } enmInterface;
 
 //! Structure defining eucanetd_meter configuration
@@ -122,6 +153,8 @@ typedef struct enmConfig_t {
     int promiscuous_mode;
     int daemonize;
     int snaplen;
+    int queues;                        /** number of TPACKET_V3 capture threads, 0 to capture with libpcap */
+    char *replay;                      /** pcap file to replay through the counters instead of capturing */
     
     enmInterface eni;
 } enmConfig;
@@ -152,6 +185,7 @@ enmCounter *newCounter(char *name, char *cidr);
 enmCounter *findCounter(char *name, enmCounter **counters, int max_counters);
 
 int counterAddMatch(enmCounter *counter, boolean inv, char *cidr);
+int enmCompileCounters(enmInterface *eni, int max_shards);
 
 char *enmPrintCounters(enmConfig *config);
 
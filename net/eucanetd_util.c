@@ -188,9 +188,35 @@ int eucanetd_stop_dhcpd_server(eucanetdConfig *config) {
     return (rc);
 }
 
+/**
+ * Checks whether the local DHCP server is running, based on the PID file it
+ * maintains. This is cheap enough to be called on every GNI update.
+ *
+ * @param config [in] pointer to system-wide eucanetdConfig data structure
+ * @return TRUE if a dhcpd process matching the PID file is running, FALSE otherwise
+ */
+boolean eucanetd_dhcpd_server_running(eucanetdConfig *config) {
+    pid_t pid = 0;
+    char *psPid = NULL;
+    char sPidFileName[EUCA_MAX_PATH] = "";
+
+    snprintf(sPidFileName, EUCA_MAX_PATH, NC_NET_PATH_DEFAULT "/euca-dhcp.pid", config->eucahome);
+    if ((psPid = file2str(sPidFileName)) == NULL) {
+        return (FALSE);
+    }
+    pid = atoi(psPid);
+    EUCA_FREE(psPid);
+
+    if ((pid > 1) && (check_process(pid, "dhcpd") == 0)) {
+        return (TRUE);
+    }
+    return (FALSE);
+}
+
 /**
  * Restart or simply start the local DHCP server so it can pick up the new
- * configuration.
+ * configuration. A single systemctl restart is issued so that the server is
+ * down for as short a time as possible.
  *
  * @param config [in] pointer to system-wide eucanetdConfig data structure 
  * @return 0 on success or 1 if a failure occurred
@@ -207,20 +233,14 @@ int eucanetd_kick_dhcpd_server(eucanetdConfig *config) {
     int ret = 0;
     int rc = 0;
     char *psConfig = NULL;
-    char sPidFileName[EUCA_MAX_PATH] = "";
     char sConfigFileName[EUCA_MAX_PATH] = "";
     char sLeaseFileName[EUCA_MAX_PATH] = "";
-    char sTraceFileName[EUCA_MAX_PATH] = "";
     struct stat mystat = { 0 };
 
     // Setup the path to the various files involved
-    snprintf(sPidFileName, EUCA_MAX_PATH, NC_NET_PATH_DEFAULT "/euca-dhcp.pid", config->eucahome);
     snprintf(sLeaseFileName, EUCA_MAX_PATH, NC_NET_PATH_DEFAULT "/euca-dhcp.leases", config->eucahome);
-    snprintf(sTraceFileName, EUCA_MAX_PATH, NC_NET_PATH_DEFAULT "/euca-dhcp.trace", config->eucahome);
     snprintf(sConfigFileName, EUCA_MAX_PATH, NC_NET_PATH_DEFAULT "/euca-dhcp.conf", config->eucahome);
 
-    eucanetd_stop_dhcpd_server(config);
-
     // Check to make sure the lease file is present
     if (stat(sLeaseFileName, &mystat) != 0) {
         // nope, just create an empty one
@@ -230,24 +250,25 @@ int eucanetd_kick_dhcpd_server(eucanetdConfig *config) {
         }
     }
     // We should be able to load the configuration file
-    if ((psConfig = file2str(sConfigFileName)) != NULL) {
-        // Do we have any "node-" statement
-        if (strstr(psConfig, "node-")) {
-            // Run the DHCP command
-            char dhcpdunit[EUCA_MAX_PATH] = "";
-            snprintf(dhcpdunit, EUCA_MAX_PATH, EUCANETD_DHCPD_UNIT, config->bridgeDev);
-            char cmd[EUCA_MAX_PATH] = "";
-            snprintf(cmd, EUCA_MAX_PATH, "%s %s start %s", config->cmdprefix,
-                    config->systemctl, dhcpdunit);
-            rc = timeshell_nb(cmd, 10, FALSE);
-
-            if (rc != 0) {
-                LOGERROR("failed to start eucanetd-dhcpd\n");
-                ret = 1;
-            }
+    psConfig = file2str(sConfigFileName);
+    // Do we have any "node-" statement
+    if (psConfig && strstr(psConfig, "node-")) {
+        // Run the DHCP command
+        char dhcpdunit[EUCA_MAX_PATH] = "";
+        snprintf(dhcpdunit, EUCA_MAX_PATH, EUCANETD_DHCPD_UNIT, config->bridgeDev);
+        char cmd[EUCA_MAX_PATH] = "";
+        snprintf(cmd, EUCA_MAX_PATH, "%s %s restart %s", config->cmdprefix,
+                config->systemctl, dhcpdunit);
+        rc = timeshell_nb(cmd, 10, FALSE);
+
+        if (rc != 0) {
+            LOGERROR("failed to restart eucanetd-dhcpd\n");
+            ret = 1;
         }
-        EUCA_FREE(psConfig);
+    } else {
+        eucanetd_stop_dhcpd_server(config);
     }
+    EUCA_FREE(psConfig);
 
     return (ret);
 }
@@ -549,6 +549,8 @@ static u32 network_driver_system_scrub(eucanetdConfig *pConfig, globalNetworkInf
     int rc = 0;
     u32 ret = EUCANETD_RUN_NO_API;
     struct timeval tv;
+    gni_diff diff = { 0 };
+    gni_diff *pDiff = NULL;
 
     eucanetd_timer(&tv);
     // Make sure midoname buffer is available
@@ -582,8 +584,16 @@ static u32 network_driver_system_scrub(eucanetdConfig *pConfig, globalNetworkInf
         pMidoConfig->midotz_ok = FALSE;
     }
 
+    // pGniApplied is only set when it was successfully applied: compare against it once
+    if (pGniApplied && (pGni != pGniApplied)) {
+        if (!gni_diff_build(pGniApplied, pGni, &diff)) {
+            pDiff = &diff;
+        }
+    }
+
     LOGTRACE("euca VPCMIDO system state: %s\n", midonet_api_system_changed == 0 ? "CLEAN" : "DIRTY");
-    rc = do_midonet_update(pGni, pGniApplied, pMidoConfig);
+    rc = do_midonet_update(pGni, pGniApplied, pDiff, pMidoConfig);
+    gni_diff_clear(&diff);
 
     if (rc != 0) {
         LOGERROR("failed to update midonet: check log for details\n");
@@ -643,6 +653,7 @@ static int network_driver_handle_signal(eucanetdConfig *pConfig, globalNetworkIn
         case SIGUSR2:
             LOGINFO("Going to invalidate midocache\n");
             midocache_invalid = 1;
+            midonet_api_cache_request_full_refresh();
             break;
         default:
             break;
@@ -93,6 +93,18 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+static int ips_handler_write_changes(ips_handler *ipsh, FILE *FH, int dodelete);
+static int ips_handler_write_full(ips_handler *ipsh, FILE *FH, int dodelete);
+static void ips_handler_mark_applied(ips_handler *ipsh, int repopulated, int dodelete);
+static void ips_set_write_members(FILE *FH, const char *setname, u32 *ips, int *nms, int max_ips);
+static void ips_set_release(ips_set *set);
+static const char *ips_set_key(const void *base, int idx);
+
+static unsigned int ips_member_hash(u32 ip, int nm);
+static int ips_member_index_find(ips_member_index *index, u32 *ips, int *nms, u32 ip, int nm);
+static int ips_member_index_add(ips_member_index *index, u32 *ips, int *nms, int idx);
+static void ips_member_index_clear(ips_member_index *index);
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                   MACROS                                   |
@@ -281,50 +293,234 @@ int ips_handler_repopulate(ips_handler *ipsh) {
     fclose(FH);
 
     unlink_handler_file(ipsh->ips_file);
+    ips_handler_mark_applied(ipsh, 1, 0);
     LOGDEBUG("ips populated in %.2f ms.\n", eucanetd_timer_usec(&tv) / 1000.0);
     return (0);
 }
 
 /**
- * Applies the ipset configuration in the handler to the system.
+ * Applies the ipset configuration in the handler to the system. Only the differences
+ * with what was last read from (or applied to) the system are handed to ipset restore:
+ * new sets are created and populated, members are added to or deleted from existing
+ * sets, and sets with more than IPS_SWAP_MIN_CHANGES changed members are rebuilt
+ * aside and swapped in atomically. Nothing is executed if there is no change. When
+ * the incremental restore fails, every set is flushed and repopulated as before.
  * @param ipsh [in] pointer to the ipset handler
  * @param dodelete [in] set to 1 if we need to flush an empty set or 0 if we ignore
  * @return 0 on success. 1 on failure.
  */
 int ips_handler_deploy(ips_handler *ipsh, int dodelete) {
-    int i = 0;
-    int j = 0;
+    int rc = 0;
+    int changed = 0;
     FILE *FH = NULL;
-    char *strptra = NULL;
+    struct timeval tv = { 0 };
 
     if (!ipsh || !ipsh->init) {
         return (1);
     }
 
+    eucanetd_timer_usec(&tv);
     FH = fopen(ipsh->ips_file, "w");
     if (!FH) {
         LOGERROR("could not open file for write '%s': check permissions\n", ipsh->ips_file);
         return (1);
     }
+    changed = ips_handler_write_changes(ipsh, FH, dodelete);
+    fclose(FH);
+
+    if (changed == 0) {
+        unlink_handler_file(ipsh->ips_file);
+    } else if ((rc = ips_system_restore(ipsh)) != 0) {
+        LOGWARN("incremental ipset restore failed, restoring all sets\n");
+        FH = fopen(ipsh->ips_file, "w");
+        if (!FH) {
+            LOGERROR("could not open file for write '%s': check permissions\n", ipsh->ips_file);
+            return (1);
+        }
+        changed = ips_handler_write_full(ipsh, FH, dodelete);
+        fclose(FH);
+        rc = ips_system_restore(ipsh);
+    }
+
+    if (rc == 0) {
+        ips_handler_mark_applied(ipsh, 0, dodelete);
+    }
+
+    ipsh->deploy_changes = changed;
+    ipsh->deploy_usec = eucanetd_timer_usec(&tv);
+    LOGDEBUG("ips deployed %d change(s) in %.2f ms.\n", changed, ipsh->deploy_usec / 1000.0);
+    return (rc);
+}
+
+/**
+ * Writes, in ipset restore format, the changes needed to bring the system sets to the
+ * content of the handler.
+ * @param ipsh [in] pointer to the ipset handler
+ * @param FH [in] file to write to
+ * @param dodelete [in] set to 1 if sets without members must be destroyed
+ * @return the number of sets created or destroyed plus the number of members added or deleted
+ */
+static int ips_handler_write_changes(ips_handler *ipsh, FILE *FH, int dodelete) {
+    int i = 0;
+    int j = 0;
+    int adds = 0;
+    int dels = 0;
+    int count = 0;
+    char *strptra = NULL;
+    char swapname[64] = "";
+    ips_set *set = NULL;
+
+    for (i = 0; i < ipsh->max_sets; i++) {
+        set = &(ipsh->sets[i]);
+        if (!set->ref_count) {
+            if (dodelete && set->in_system) {
+                fprintf(FH, "flush %s\n", set->name);
+                fprintf(FH, "destroy %s\n", set->name);
+                count++;
+            }
+            continue;
+        }
+
+        if (!set->in_system) {
+            fprintf(FH, "create %s hash:net family inet hashsize 2048 maxelem 65536\n", set->name);
+            ips_set_write_members(FH, set->name, set->member_ips, set->member_nms, set->max_member_ips);
+            count += 1 + set->max_member_ips;
+            continue;
+        }
+
+        adds = dels = 0;
+        for (j = 0; j < set->max_member_ips; j++) {
+            adds += (ips_member_index_find(&(set->sys_member_index), set->sys_member_ips, set->sys_member_nms, set->member_ips[j], set->member_nms[j]) < 0);
+        }
+        for (j = 0; j < set->max_sys_member_ips; j++) {
+            dels += (ips_member_index_find(&(set->member_index), set->member_ips, set->member_nms, set->sys_member_ips[j], set->sys_member_nms[j]) < 0);
+        }
+        if ((adds + dels) == 0) {
+            continue;
+        }
+        count += adds + dels;
+
+        if ((adds + dels) >= IPS_SWAP_MIN_CHANGES) {
+            // ipset names are limited to 31 characters, so the temporary set is named after its position
+            snprintf(swapname, 64, "EUCA_SWAP_%d", i);
+            LOGDEBUG("rebuilding ipset %s (%d adds, %d deletes) through %s\n", set->name, adds, dels, swapname);
+            fprintf(FH, "create %s hash:net family inet hashsize 2048 maxelem 65536\n", swapname);
+            fprintf(FH, "flush %s\n", swapname);
+            ips_set_write_members(FH, swapname, set->member_ips, set->member_nms, set->max_member_ips);
+            fprintf(FH, "swap %s %s\n", swapname, set->name);
+            fprintf(FH, "destroy %s\n", swapname);
+            continue;
+        }
+
+        for (j = 0; j < set->max_sys_member_ips; j++) {
+            if (ips_member_index_find(&(set->member_index), set->member_ips, set->member_nms, set->sys_member_ips[j], set->sys_member_nms[j]) < 0) {
+                strptra = hex2dot(set->sys_member_ips[j]);
+                LOGDEBUG("deleting ip/nm %s/%d from ipset %s\n", strptra, set->sys_member_nms[j], set->name);
+                fprintf(FH, "del %s %s/%d\n", set->name, strptra, set->sys_member_nms[j]);
+                EUCA_FREE(strptra);
+            }
+        }
+        for (j = 0; j < set->max_member_ips; j++) {
+            if (ips_member_index_find(&(set->sys_member_index), set->sys_member_ips, set->sys_member_nms, set->member_ips[j], set->member_nms[j]) < 0) {
+                strptra = hex2dot(set->member_ips[j]);
+                LOGDEBUG("adding ip/nm %s/%d to ipset %s\n", strptra, set->member_nms[j], set->name);
+                fprintf(FH, "add %s %s/%d\n", set->name, strptra, set->member_nms[j]);
+                EUCA_FREE(strptra);
+            }
+        }
+    }
+    return (count);
+}
+
+/**
+ * Writes, in ipset restore format, every set of the handler: each set is created if
+ * needed, flushed and repopulated.
+ * @param ipsh [in] pointer to the ipset handler
+ * @param FH [in] file to write to
+ * @param dodelete [in] set to 1 if sets without members must be destroyed
+ * @return the number of sets written
+ */
+static int ips_handler_write_full(ips_handler *ipsh, FILE *FH, int dodelete) {
+    int i = 0;
+    int count = 0;
+
     for (i = 0; i < ipsh->max_sets; i++) {
         if (ipsh->sets[i].ref_count) {
             fprintf(FH, "create %s hash:net family inet hashsize 2048 maxelem 65536\n", ipsh->sets[i].name);
             fprintf(FH, "flush %s\n", ipsh->sets[i].name);
-            for (j = 0; j < ipsh->sets[i].max_member_ips; j++) {
-                strptra = hex2dot(ipsh->sets[i].member_ips[j]);
-                LOGDEBUG("adding ip/nm %s/%d to ipset %s\n", strptra, ipsh->sets[i].member_nms[j], ipsh->sets[i].name);
-                fprintf(FH, "add %s %s/%d\n", ipsh->sets[i].name, strptra, ipsh->sets[i].member_nms[j]);
-                EUCA_FREE(strptra);
-            }
+            ips_set_write_members(FH, ipsh->sets[i].name, ipsh->sets[i].member_ips, ipsh->sets[i].member_nms, ipsh->sets[i].max_member_ips);
+            count++;
         } else if ((ipsh->sets[i].ref_count == 0) && dodelete) {
             fprintf(FH, "create %s hash:net family inet hashsize 2048 maxelem 65536\n", ipsh->sets[i].name);
             fprintf(FH, "flush %s\n", ipsh->sets[i].name);
             fprintf(FH, "destroy %s\n", ipsh->sets[i].name);
+            count++;
         }
     }
-    fclose(FH);
+    return (count);
+}
+
+/**
+ * Writes the add commands of a list of members.
+ * @param FH [in] file to write to
+ * @param setname [in] name of the set the members are added to
+ * @param ips [in] member addresses
+ * @param nms [in] member network masks
+ * @param max_ips [in] number of members
+ */
+static void ips_set_write_members(FILE *FH, const char *setname, u32 *ips, int *nms, int max_ips) {
+    int j = 0;
+    char *strptra = NULL;
+
+    for (j = 0; j < max_ips; j++) {
+        strptra = hex2dot(ips[j]);
+        LOGDEBUG("adding ip/nm %s/%d to ipset %s\n", strptra, nms[j], setname);
+        fprintf(FH, "add %s %s/%d\n", setname, strptra, nms[j]);
+        EUCA_FREE(strptra);
+    }
+}
 
-    return (ips_system_restore(ipsh));
+/**
+ * Records the current members of every set as being what the system has. Called once
+ * the system state was read in and after every successful deploy.
+ * @param ipsh [in] pointer to the ipset handler
+ * @param repopulated [in] set if the content was just read from the system, in which case
+ *                         every set is present there
+ * @param dodelete [in] set if the deploy destroyed the sets without members
+ */
+static void ips_handler_mark_applied(ips_handler *ipsh, int repopulated, int dodelete) {
+    int i = 0;
+    int j = 0;
+    ips_set *set = NULL;
+
+    for (i = 0; i < ipsh->max_sets; i++) {
+        set = &(ipsh->sets[i]);
+        if (!repopulated && !set->ref_count && !dodelete) {
+            // left alone by the deploy
+            continue;
+        }
+        EUCA_FREE(set->sys_member_ips);
+        EUCA_FREE(set->sys_member_nms);
+        set->max_sys_member_ips = 0;
+        ips_member_index_clear(&(set->sys_member_index));
+        set->in_system = (repopulated || set->ref_count);
+        if (!set->in_system || !set->max_member_ips) {
+            continue;
+        }
+
+        set->sys_member_ips = EUCA_ALLOC(set->max_member_ips, sizeof(u32));
+        set->sys_member_nms = EUCA_ALLOC(set->max_member_ips, sizeof(int));
+        if (!set->sys_member_ips || !set->sys_member_nms) {
+            LOGFATAL("out of memory!\n");
+            exit(1);
+        }
+        memcpy(set->sys_member_ips, set->member_ips, set->max_member_ips * sizeof(u32));
+        memcpy(set->sys_member_nms, set->member_nms, set->max_member_ips * sizeof(int));
+        set->max_sys_member_ips = set->max_member_ips;
+        for (j = 0; j < set->max_sys_member_ips; j++) {
+            ips_member_index_add(&(set->sys_member_index), set->sys_member_ips, set->sys_member_nms, j);
+        }
+    }
 }
 
 /**
@@ -350,6 +546,7 @@ int ips_handler_add_set(ips_handler *ipsh, char *setname) {
         bzero(&(ipsh->sets[ipsh->max_sets]), sizeof(ips_set));
         snprintf(ipsh->sets[ipsh->max_sets].name, 64, setname);
         ipsh->sets[ipsh->max_sets].ref_count = 1;
+        euca_strindex_add(&(ipsh->set_index), ipsh->sets[ipsh->max_sets].name, ipsh->max_sets, ips_set_key, ipsh->sets);
         ipsh->max_sets++;
     }
     return (0);
@@ -362,18 +559,13 @@ int ips_handler_add_set(ips_handler *ipsh, char *setname) {
  * @return pointer to the ip_set if found. NULL otherwise.
  */
 ips_set *ips_handler_find_set(ips_handler *ipsh, char *findset) {
-    int i, setidx = 0, found = 0;
+    int setidx = 0;
     if (!ipsh || !findset || !ipsh->init) {
         return (NULL);
     }
 
-    found = 0;
-    for (i = 0; i < ipsh->max_sets && !found; i++) {
-        setidx = i;
-        if (!strcmp(ipsh->sets[i].name, findset))
-            found++;
-    }
-    if (!found) {
+    setidx = euca_strindex_find(&(ipsh->set_index), findset, ips_set_key, ipsh->sets);
+    if (setidx < 0) {
         return (NULL);
     }
     return (&(ipsh->sets[setidx]));
@@ -400,7 +592,7 @@ int ips_set_add_ip(ips_handler *ipsh, char *setname, char *ipname) {
  */
 int ips_set_add_net(ips_handler *ipsh, char *setname, char *ipname, int nmname) {
     ips_set *set = NULL;
-    u32 *ip = NULL;
+    u32 ip = 0;
     if (!ipsh || !setname || !ipname || !ipsh->init) {
         return (1);
     }
@@ -410,8 +602,8 @@ int ips_set_add_net(ips_handler *ipsh, char *setname, char *ipname, int nmname)
         return (1);
     }
 
-    ip = ips_set_find_net(ipsh, setname, ipname, nmname);
-    if (!ip) {
+    ip = dot2hex(ipname);
+    if (ips_member_index_find(&(set->member_index), set->member_ips, set->member_nms, ip, nmname) < 0) {
         set->member_ips = realloc(set->member_ips, sizeof(u32) * (set->max_member_ips + 1));
         if (!set->member_ips) {
             LOGFATAL("out of memory!\n");
@@ -425,8 +617,12 @@ int ips_set_add_net(ips_handler *ipsh, char *setname, char *ipname, int nmname)
 
         bzero(&(set->member_ips[set->max_member_ips]), sizeof(u32));
         bzero(&(set->member_nms[set->max_member_ips]), sizeof(int));
-        set->member_ips[set->max_member_ips] = dot2hex(ipname);
+        set->member_ips[set->max_member_ips] = ip;
         set->member_nms[set->max_member_ips] = nmname;
+        if (ips_member_index_add(&(set->member_index), set->member_ips, set->member_nms, set->max_member_ips)) {
+            LOGFATAL("out of memory!\n");
+            exit(1);
+        }
         set->max_member_ips++;
         set->ref_count++;
     }
@@ -453,9 +649,8 @@ u32 *ips_set_find_ip(ips_handler *ipsh, char *setname, char *findipstr) {
  * @return pointer to an integer representing the IP address if found. NULL otherwise.
  */
 u32 *ips_set_find_net(ips_handler *ipsh, char *setname, char *findipstr, int findnm) {
-    int i, found = 0, ipidx = 0;
+    int ipidx = 0;
     ips_set *set = NULL;
-    u32 findip;
 
     if (!ipsh || !setname || !findipstr || !ipsh->init) {
         return (NULL);
@@ -466,15 +661,8 @@ u32 *ips_set_find_net(ips_handler *ipsh, char *setname, char *findipstr, int fin
         return (NULL);
     }
 
-    findip = dot2hex(findipstr);
-    found = 0;
-    for (i = 0; i < set->max_member_ips && !found; i++) {
-        ipidx = i;
-        if (set->member_ips[i] == findip && set->member_nms[i] == findnm)
-            found++;
-    }
-
-    if (!found) {
+    ipidx = ips_member_index_find(&(set->member_index), set->member_ips, set->member_nms, dot2hex(findipstr), findnm);
+    if (ipidx < 0) {
         return (NULL);
     }
 
@@ -501,6 +689,7 @@ int ips_set_flush(ips_handler *ipsh, char *setname) {
 
     EUCA_FREE(set->member_ips);
     EUCA_FREE(set->member_nms);
+    ips_member_index_clear(&(set->member_index));
     set->max_member_ips = set->ref_count = 0;
 
     return (0);
@@ -525,6 +714,7 @@ int ips_handler_deletesetmatch(ips_handler *ipsh, char *setmatch) {
         if (strstr(ipsh->sets[i].name, setmatch)) {
             EUCA_FREE(ipsh->sets[i].member_ips);
             EUCA_FREE(ipsh->sets[i].member_nms);
+            ips_member_index_clear(&(ipsh->sets[i].member_index));
             ipsh->sets[i].max_member_ips = 0;
             ipsh->sets[i].ref_count = 0;
         }
@@ -548,10 +738,10 @@ int ips_handler_free(ips_handler *ipsh) {
     snprintf(saved_cmdprefix, EUCA_MAX_PATH, "%s", ipsh->cmdprefix);
 
     for (i = 0; i < ipsh->max_sets; i++) {
-        EUCA_FREE(ipsh->sets[i].member_ips);
-        EUCA_FREE(ipsh->sets[i].member_nms);
+        ips_set_release(&(ipsh->sets[i]));
     }
     EUCA_FREE(ipsh->sets);
+    euca_strindex_clear(&(ipsh->set_index));
 
     return (ips_handler_init(ipsh, saved_cmdprefix));
 }
@@ -568,10 +758,10 @@ int ips_handler_close(ips_handler *ipsh) {
         return (1);
     }
     for (i = 0; i < ipsh->max_sets; i++) {
-        EUCA_FREE(ipsh->sets[i].member_ips);
-        EUCA_FREE(ipsh->sets[i].member_nms);
+        ips_set_release(&(ipsh->sets[i]));
     }
     EUCA_FREE(ipsh->sets);
+    euca_strindex_clear(&(ipsh->set_index));
 
     unlink_handler_file(ipsh->ips_file);
     ipsh->init = 0;
@@ -603,3 +793,112 @@ int ips_handler_print(ips_handler *ipsh) {
     }
     return (0);
 }
+
+/**
+ * Releases the members of a set, along with its record of the system members.
+ * @param set [in] pointer to the set
+ */
+static void ips_set_release(ips_set *set) {
+    EUCA_FREE(set->member_ips);
+    EUCA_FREE(set->member_nms);
+    ips_member_index_clear(&(set->member_index));
+    EUCA_FREE(set->sys_member_ips);
+    EUCA_FREE(set->sys_member_nms);
+    ips_member_index_clear(&(set->sys_member_index));
+}
+
+/**
+ * Returns the name of a set, for the set index of the handler.
+ * @param base [in] the set array of the handler
+ * @param idx [in] position of the set
+ * @return the set name
+ */
+static const char *ips_set_key(const void *base, int idx) {
+    return (((const ips_set *)base)[idx].name);
+}
+
+/**
+ * Hashes an ipset member.
+ * @param ip [in] member address
+ * @param nm [in] member network mask
+ * @return the hash value
+ */
+static unsigned int ips_member_hash(u32 ip, int nm) {
+    unsigned int hash = (ip ^ ((u32) nm << 24)) * 2654435761U;
+    return (hash ^ (hash >> 16));
+}
+
+/**
+ * Looks up the position of a member in the member arrays of a set.
+ * @param index [in] index of the member arrays
+ * @param ips [in] member addresses
+ * @param nms [in] member network masks
+ * @param ip [in] address we're looking for
+ * @param nm [in] network mask we're looking for
+ * @return the position of the member if found, -1 otherwise.
+ */
+static int ips_member_index_find(ips_member_index *index, u32 *ips, int *nms, u32 ip, int nm) {
+    unsigned int mask = 0;
+    unsigned int slot = 0;
+
+    if (index->size == 0) {
+        return (-1);
+    }
+    mask = index->size - 1;
+    for (slot = (ips_member_hash(ip, nm) & mask); index->slots[slot]; slot = ((slot + 1) & mask)) {
+        if ((ips[index->slots[slot] - 1] == ip) && (nms[index->slots[slot] - 1] == nm)) {
+            return (index->slots[slot] - 1);
+        }
+    }
+    return (-1);
+}
+
+/**
+ * Records the position of a member, which must not be indexed yet.
+ * @param index [in] index of the member arrays
+ * @param ips [in] member addresses
+ * @param nms [in] member network masks
+ * @param idx [in] position of the member
+ * @return 0 on success. 1 on failure.
+ */
+static int ips_member_index_add(ips_member_index *index, u32 *ips, int *nms, int idx) {
+    int i = 0;
+    int *slots = NULL;
+    unsigned int mask = 0;
+    unsigned int slot = 0;
+
+    // keep the load factor under 1/2 so probe sequences stay short
+    if ((2 * (index->count + 1)) > index->size) {
+        int size = ((index->size > 0) ? (2 * index->size) : EUCA_STRINDEX_MIN_SLOTS);
+        if ((slots = EUCA_ZALLOC(size, sizeof(int))) == NULL) {
+            LOGERROR("out of memory (failed to grow index to %d slots)\n", size);
+            return (1);
+        }
+        mask = size - 1;
+        for (i = 0; i < index->size; i++) {
+            if (index->slots[i]) {
+                for (slot = (ips_member_hash(ips[index->slots[i] - 1], nms[index->slots[i] - 1]) & mask); slots[slot]; slot = ((slot + 1) & mask)) ;
+                slots[slot] = index->slots[i];
+            }
+        }
+        EUCA_FREE(index->slots);
+        index->slots = slots;
+        index->size = size;
+    }
+
+    mask = index->size - 1;
+    for (slot = (ips_member_hash(ips[idx], nms[idx]) & mask); index->slots[slot]; slot = ((slot + 1) & mask)) ;
+    index->slots[slot] = idx + 1;
+    index->count++;
+    return (0);
+}
+
+/**
+ * Releases the memory held by a member index and leaves it empty.
+ * @param index [in] index of the member arrays
+ */
+static void ips_member_index_clear(ips_member_index *index) {
+    EUCA_FREE(index->slots);
+    index->size = 0;
+    index->count = 0;
+}
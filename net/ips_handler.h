@@ -31,12 +31,16 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+#include "euca_strindex.h"
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                  DEFINES                                   |
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+#define IPS_SWAP_MIN_CHANGES                    1024    //!< Number of member changes from which a set is rebuilt aside and swapped in
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                  TYPEDEFS                                  |
@@ -55,20 +59,36 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+//! Open addressing hash table of the positions of the members of an ipset
+typedef struct ips_member_index_t {
+    int *slots;                        //!< Member position + 1 of each entry, 0 for an empty slot
+    int size;                          //!< Number of slots, a power of two
+    int count;                         //!< Number of entries
+} ips_member_index;
+
 typedef struct ips_set_t {
     char name[64];
     u32 *member_ips;
     int *member_nms;
     int max_member_ips;
     int ref_count;
+    ips_member_index member_index;     //!< Members indexed by address and mask
+    int in_system;                     //!< Set if the set was last seen in (or applied to) the system
+    u32 *sys_member_ips;               //!< Members of the set as last seen in the system
+    int *sys_member_nms;
+    int max_sys_member_ips;
+    ips_member_index sys_member_index; //!< System members indexed by address and mask
 } ips_set;
 
 typedef struct ips_handler_t {
     ips_set *sets;
     int max_sets;
+    euca_strindex set_index;           //!< Sets indexed by name
     char ips_file[EUCA_MAX_PATH];
     char cmdprefix[EUCA_MAX_PATH];
     int init;
+    long int deploy_usec;              //!< Duration of the last ips_handler_deploy() in microseconds
+    int deploy_changes;                //!< Number of set and member changes the last ips_handler_deploy() had to apply
 } ips_handler;
 
 /*----------------------------------------------------------------------------*\
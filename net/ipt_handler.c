@@ -93,6 +93,17 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+static int ipt_system_restore_file(ipt_handler *pIpt, int noflush);
+static int ipt_handler_write_full(ipt_handler *pIpt, FILE *pFh);
+static int ipt_handler_write_changes(ipt_handler *pIpt, FILE *pFh);
+static void ipt_handler_mark_applied(ipt_handler *pIpt, int repopulated);
+static int ipt_chain_is_builtin(ipt_chain *chain);
+static unsigned long long ipt_chain_hash(ipt_chain *chain);
+static void ipt_chain_sort(ipt_chain *chain);
+static const char *ipt_chain_key(const void *base, int idx);
+static const char *ipt_rule_key(const void *base, int idx);
+static void ipt_handler_free_tables(ipt_handler *ipth);
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                   MACROS                                   |
@@ -252,8 +263,23 @@ int ipt_system_save(ipt_handler *pIpt) {
  * @note
  */
 int ipt_system_restore(ipt_handler *pIpt) {
+    return (ipt_system_restore_file(pIpt, 0));
+}
+
+/**
+ * Runs iptables-restore on our IP table configured file, optionally leaving
+ * alone the tables and chains that the file does not mention.
+ *
+ * @param pIpt [in] pointer to the IP table handler structure
+ * @param noflush [in] set to pass --noflush to iptables-restore
+ *
+ * @return 0 on success or any other value if any failure occurred
+ *
+ * @see ipt_system_restore()
+ */
+static int ipt_system_restore_file(ipt_handler *pIpt, int noflush) {
     int rc = EUCA_OK;
-    if (euca_execlp_redirect(NULL, pIpt->ipt_file, NULL, FALSE, NULL, FALSE, pIpt->cmdprefix, "iptables-restore", "-c", NULL) != EUCA_OK) {
+    if (euca_execlp_redirect(NULL, pIpt->ipt_file, NULL, FALSE, NULL, FALSE, pIpt->cmdprefix, "iptables-restore", "-c", (noflush ? "--noflush" : NULL), NULL) != EUCA_OK) {
         copy_file(pIpt->ipt_file, "/tmp/euca_ipt_file_failed");
         LOGERROR("iptables-restore failed. copying failed input file to '/tmp/euca_ipt_file_failed' for manual retry.\n");
         rc = EUCA_ERROR;
@@ -263,9 +289,11 @@ int ipt_system_restore(ipt_handler *pIpt) {
 }
 
 /**
- * Takes our latest IP table virtual content and puts it into a file in IP tables format that
- * will be passed to ip_system_restore(). Once completed, the system IP tables should contain
- * the latest changes we made.
+ * Takes our latest IP table virtual content and applies it to the system. Only the chains
+ * that differ from what was last read from (or applied to) the system are written out and
+ * handed to iptables-restore --noflush, so the rest of the rules and their counters are left
+ * alone. When a preload file is configured, or when the incremental restore fails, every
+ * table is rewritten in full as before.
  *
  * @param pIpt [in] pointer to the IP table handler structure
  *
@@ -287,20 +315,81 @@ int ipt_system_restore(ipt_handler *pIpt) {
 int ipt_handler_deploy(ipt_handler * pIpt) {
     int i = 0;
     int j = 0;
-    int k = 0;
-    char *psPreload = NULL;
+    int rc = 0;
+    int full = 0;
+    int changed = 0;
     FILE *pFh = NULL;
+    struct timeval tv = { 0 };
 
     if (!pIpt || !pIpt->init) {
         return (1);
     }
 
+    eucanetd_timer_usec(&tv);
     ipt_handler_update_refcounts(pIpt);
 
-    if ((pFh = fopen(pIpt->ipt_file, "w")) == NULL) {
-        LOGERROR("could not open file for write '%s': check permissions\n", pIpt->ipt_file);
-        return (1);
+    for (i = 0; i < pIpt->max_tables; i++) {
+        for (j = 0; j < pIpt->tables[i].max_chains; j++) {
+            if (!pIpt->tables[i].chains[j].flushed && pIpt->tables[i].chains[j].ref_count) {
+                ipt_chain_sort(&(pIpt->tables[i].chains[j]));
+            }
+        }
+    }
+
+    // the preload content can only be applied along with a complete ruleset
+    full = (strlen(pIpt->preloadPath) > 0);
+    if (!full) {
+        if ((pFh = fopen(pIpt->ipt_file, "w")) == NULL) {
+            LOGERROR("could not open file for write '%s': check permissions\n", pIpt->ipt_file);
+            return (1);
+        }
+        changed = ipt_handler_write_changes(pIpt, pFh);
+        fclose(pFh);
+
+        if (changed == 0) {
+            unlink_handler_file(pIpt->ipt_file);
+        } else if ((rc = ipt_system_restore_file(pIpt, 1)) != 0) {
+            LOGWARN("incremental iptables-restore failed, restoring all tables\n");
+            full = 1;
+        }
     }
+
+    if (full) {
+        if ((pFh = fopen(pIpt->ipt_file, "w")) == NULL) {
+            LOGERROR("could not open file for write '%s': check permissions\n", pIpt->ipt_file);
+            return (1);
+        }
+        changed = ipt_handler_write_full(pIpt, pFh);
+        fclose(pFh);
+        rc = ipt_system_restore_file(pIpt, 0);
+    }
+
+    if (rc == 0) {
+        ipt_handler_mark_applied(pIpt, 0);
+    }
+
+    pIpt->deploy_chains = changed;
+    pIpt->deploy_usec = eucanetd_timer_usec(&tv);
+    LOGDEBUG("ipt deployed %d chain(s)%s in %.2f ms.\n", changed, (full ? " (full restore)" : ""), pIpt->deploy_usec / 1000.0);
+    return (rc);
+}
+
+/**
+ * Writes every table of our IP table virtual content in iptables-restore format, along
+ * with the preload content if any.
+ *
+ * @param pIpt [in] pointer to the IP table handler structure
+ * @param pFh [in] file to write to
+ *
+ * @return the number of chains written
+ */
+static int ipt_handler_write_full(ipt_handler *pIpt, FILE *pFh) {
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    int count = 0;
+    char *psPreload = NULL;
+
     // do the preload stuff first if needed
     if (strlen(pIpt->preloadPath)) {
         if ((psPreload = file2str(pIpt->preloadPath)) == NULL) {
@@ -316,12 +405,11 @@ int ipt_handler_deploy(ipt_handler * pIpt) {
         for (j = 0; j < pIpt->tables[i].max_chains; j++) {
             if (!pIpt->tables[i].chains[j].flushed && pIpt->tables[i].chains[j].ref_count) {
                 fprintf(pFh, ":%s %s %s\n", pIpt->tables[i].chains[j].name, pIpt->tables[i].chains[j].policyname, pIpt->tables[i].chains[j].counters);
+                count++;
             }
         }
         for (j = 0; j < pIpt->tables[i].max_chains; j++) {
             if (!pIpt->tables[i].chains[j].flushed && pIpt->tables[i].chains[j].ref_count) {
-                // qsort!
-                qsort(pIpt->tables[i].chains[j].rules, pIpt->tables[i].chains[j].max_rules, sizeof(ipt_rule), ipt_ruleordercmp);
                 for (k = 0; k < pIpt->tables[i].chains[j].max_rules; k++) {
                     if (!pIpt->tables[i].chains[j].rules[k].flushed) {
                         fprintf(pFh, "%s %s\n", pIpt->tables[i].chains[j].rules[k].counterstr, pIpt->tables[i].chains[j].rules[k].iptrule);
@@ -331,8 +419,172 @@ int ipt_handler_deploy(ipt_handler * pIpt) {
         }
         fprintf(pFh, "COMMIT\n");
     }
-    fclose(pFh);
-    return (ipt_system_restore(pIpt));
+    return (count);
+}
+
+/**
+ * Writes, in iptables-restore --noflush format, only the chains that differ from what is
+ * in the system: new and modified chains are (re)declared, flushed and repopulated, and
+ * chains we no longer use are flushed and deleted. Tables without any change are skipped.
+ *
+ * @param pIpt [in] pointer to the IP table handler structure
+ * @param pFh [in] file to write to
+ *
+ * @return the number of chains written
+ */
+static int ipt_handler_write_changes(ipt_handler *pIpt, FILE *pFh) {
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    int live = 0;
+    int count = 0;
+    int tablecount = 0;
+    int *pChanged = NULL;
+    ipt_table *table = NULL;
+    ipt_chain *chain = NULL;
+
+    for (i = 0; i < pIpt->max_tables; i++) {
+        table = &(pIpt->tables[i]);
+        if (table->max_chains == 0) {
+            continue;
+        }
+        // 1 if the chain must be rewritten, -1 if it must be deleted
+        if ((pChanged = EUCA_ZALLOC(table->max_chains, sizeof(int))) == NULL) {
+            LOGFATAL("out of memory!\n");
+            exit(1);
+        }
+
+        tablecount = 0;
+        for (j = 0; j < table->max_chains; j++) {
+            chain = &(table->chains[j]);
+            live = (!chain->flushed && chain->ref_count);
+            if (live && (!chain->in_system || strcmp(chain->policyname, chain->sys_policyname) || (ipt_chain_hash(chain) != chain->sys_hash))) {
+                pChanged[j] = 1;
+                tablecount++;
+            } else if (!live && chain->in_system && !ipt_chain_is_builtin(chain)) {
+                pChanged[j] = -1;
+                tablecount++;
+            }
+        }
+
+        if (tablecount) {
+            fprintf(pFh, "*%s\n", table->name);
+            for (j = 0; j < table->max_chains; j++) {
+                chain = &(table->chains[j]);
+                if (pChanged[j] > 0) {
+                    fprintf(pFh, ":%s %s %s\n", chain->name, chain->policyname, chain->counters);
+                }
+            }
+            for (j = 0; j < table->max_chains; j++) {
+                chain = &(table->chains[j]);
+                if (pChanged[j] && chain->in_system) {
+                    // --noflush does not flush built-in chains on declaration
+                    fprintf(pFh, "-F %s\n", chain->name);
+                }
+            }
+            for (j = 0; j < table->max_chains; j++) {
+                chain = &(table->chains[j]);
+                if (pChanged[j] > 0) {
+                    for (k = 0; k < chain->max_rules; k++) {
+                        if (!chain->rules[k].flushed) {
+                            fprintf(pFh, "%s %s\n", chain->rules[k].counterstr, chain->rules[k].iptrule);
+                        }
+                    }
+                }
+            }
+            for (j = 0; j < table->max_chains; j++) {
+                chain = &(table->chains[j]);
+                if (pChanged[j] < 0) {
+                    fprintf(pFh, "-X %s\n", chain->name);
+                }
+            }
+            fprintf(pFh, "COMMIT\n");
+            count += tablecount;
+        }
+        EUCA_FREE(pChanged);
+    }
+    return (count);
+}
+
+/**
+ * Records the current content of every chain as being what the system has. Called
+ * once the system state was read in and after every successful deploy.
+ *
+ * @param pIpt [in] pointer to the IP table handler structure
+ * @param repopulated [in] set if the content was just read from the system, in which case
+ *                         every chain is present there
+ */
+static void ipt_handler_mark_applied(ipt_handler *pIpt, int repopulated) {
+    int i = 0;
+    int j = 0;
+    ipt_chain *chain = NULL;
+
+    for (i = 0; i < pIpt->max_tables; i++) {
+        for (j = 0; j < pIpt->tables[i].max_chains; j++) {
+            chain = &(pIpt->tables[i].chains[j]);
+            chain->in_system = (repopulated || (!chain->flushed && chain->ref_count));
+            if (chain->in_system) {
+                chain->sys_hash = ipt_chain_hash(chain);
+                snprintf(chain->sys_policyname, 64, "%s", chain->policyname);
+            }
+        }
+    }
+}
+
+/**
+ * Tells whether a chain is one of the chains built into the iptables tables.
+ *
+ * @param chain [in] pointer to the IP table chain structure
+ *
+ * @return 1 if the chain is a built-in chain, 0 otherwise
+ */
+static int ipt_chain_is_builtin(ipt_chain *chain) {
+    return (!strcmp(chain->name, IPT_CHAIN_INPUT) || !strcmp(chain->name, IPT_CHAIN_FORWARD) || !strcmp(chain->name, IPT_CHAIN_OUTPUT) ||
+            !strcmp(chain->name, IPT_CHAIN_PREROUTING) || !strcmp(chain->name, IPT_CHAIN_POSTROUTING));
+}
+
+/**
+ * Computes a 64-bit FNV-1a hash of the rules of a chain that are not flushed, in the
+ * order they are stored in.
+ *
+ * @param chain [in] pointer to the IP table chain structure
+ *
+ * @return the hash value
+ */
+static unsigned long long ipt_chain_hash(ipt_chain *chain) {
+    int i = 0;
+    unsigned long long hash = 14695981039346656037ULL;
+    const unsigned char *c = NULL;
+
+    for (i = 0; i < chain->max_rules; i++) {
+        if (chain->rules[i].flushed) {
+            continue;
+        }
+        for (c = (const unsigned char *)chain->rules[i].iptrule; *c; c++) {
+            hash = (hash ^ *c) * 1099511628211ULL;
+        }
+        hash = (hash ^ '\n') * 1099511628211ULL;
+    }
+    return (hash);
+}
+
+/**
+ * Sorts the rules of a chain by their order. Chains that are already in order, such as
+ * the ones we did not touch since they were read from the system, are left as they are
+ * since qsort() would not preserve the order of the rules that have the same order.
+ *
+ * @param chain [in] pointer to the IP table chain structure
+ */
+static void ipt_chain_sort(ipt_chain *chain) {
+    int i = 0;
+
+    for (i = 1; i < chain->max_rules; i++) {
+        if (ipt_ruleordercmp(&(chain->rules[i - 1]), &(chain->rules[i])) > 0) {
+            qsort(chain->rules, chain->max_rules, sizeof(ipt_rule), ipt_ruleordercmp);
+            euca_strindex_rebuild(&(chain->rule_index), chain->max_rules, ipt_rule_key, chain->rules);
+            return;
+        }
+    }
 }
 
 /**
@@ -443,6 +695,7 @@ int ipt_handler_repopulate(ipt_handler *ipth) {
     fclose(FH);
 
     unlink_handler_file(ipth->ipt_file);
+    ipt_handler_mark_applied(ipth, 1);
     LOGDEBUG("ipt populated in %.2f ms.\n", eucanetd_timer_usec(&tv) / 1000.0);
     return (0);
 }
@@ -519,6 +772,7 @@ int ipt_table_add_chain(ipt_handler *ipth, char *tablename, char *chainname, cha
             table->chains[table->max_chains].ref_count = 1;
         }
         chain = &(table->chains[table->max_chains]);
+        euca_strindex_add(&(table->chain_index), chain->name, table->max_chains, ipt_chain_key, table->chains);
         table->max_chains++;
     }
     chain->flushed = 0;
@@ -599,6 +853,7 @@ int ipt_chain_insert_rule(ipt_handler *ipth, char *tablename, char *chainname, c
         bzero(rule, sizeof(ipt_rule));
         snprintf(rule->iptrule, 1024, "%s", newrule);
         snprintf(rule->counterstr, 256, "[0:0]");
+        euca_strindex_add(&(chain->rule_index), rule->iptrule, chain->max_rules, ipt_rule_key, chain->rules);
         chain->max_rules++;
     }
     if (counterstr && strlen(counterstr)) {
@@ -696,7 +951,7 @@ ipt_table *ipt_handler_find_table(ipt_handler *ipth, const char *findtable)
  * @return a pointer to the IP table chain structure if found. Otherwise, NULL is returned
  */
 ipt_chain *ipt_table_find_chain(ipt_handler *ipth, const char *tablename, const char *findchain) {
-    int i, found = 0, chainidx = 0;
+    int chainidx = 0;
     ipt_table *table = NULL;
 
     if (!ipth || !tablename || !findchain || !ipth->init) {
@@ -708,14 +963,8 @@ ipt_chain *ipt_table_find_chain(ipt_handler *ipth, const char *tablename, const
         return (NULL);
     }
 
-    found = 0;
-    for (i = 0; i < table->max_chains && !found; i++) {
-        chainidx = i;
-        if (!strcmp(table->chains[i].name, findchain))
-            found++;
-    }
-
-    if (!found) {
+    chainidx = euca_strindex_find(&(table->chain_index), findchain, ipt_chain_key, table->chains);
+    if (chainidx < 0) {
         return (NULL);
     }
 
@@ -769,7 +1018,7 @@ int ipt_table_set_chain_policy(ipt_handler * pIpth, const char *tablename, const
  * @return a pointer to the IP table rule structure if found. Otherwise, NULL is returned
  */
 ipt_rule *ipt_chain_find_rule(ipt_handler *ipth, char *tablename, char *chainname, char *findrule) {
-    int i, found = 0, ruleidx = 0;
+    int ruleidx = 0;
     ipt_chain *chain;
 
     if (!ipth || !tablename || !chainname || !findrule || !ipth->init) {
@@ -781,12 +1030,8 @@ ipt_rule *ipt_chain_find_rule(ipt_handler *ipth, char *tablename, char *chainnam
         return (NULL);
     }
 
-    for (i = 0; i < chain->max_rules && !found; i++) {
-        ruleidx = i;
-        if (!strcmp(chain->rules[i].iptrule, findrule))
-            found++;
-    }
-    if (!found) {
+    ruleidx = euca_strindex_find(&(chain->rule_index), findrule, ipt_rule_key, chain->rules);
+    if (ruleidx < 0) {
         return (NULL);
     }
     return (&(chain->rules[ruleidx]));
@@ -915,8 +1160,8 @@ int ipt_chain_flush(ipt_handler *ipth, char *tablename, char *chainname) {
  * @return 0 on success or 1 if any failure occurred
  */
 int ipt_chain_flush_rule(ipt_handler *ipth, char *tablename, char *chainname, char *findrule) {
-    int i, found = 0;
     ipt_chain *chain;
+    ipt_rule *rule;
 
     if (!ipth || !tablename || !chainname || !findrule || !ipth->init) {
         return (EUCA_INVALID_ERROR);
@@ -927,16 +1172,12 @@ int ipt_chain_flush_rule(ipt_handler *ipth, char *tablename, char *chainname, ch
         return (EUCA_INVALID_ERROR);
     }
 
-    for (i = 0; i < chain->max_rules && !found; i++) {
-        if (!strcmp(chain->rules[i].iptrule, findrule)) {
-            found++;
-            chain->rules[i].flushed = 1;
-            chain->rules[i].order = 0;
-        }
-    }
-    if (!found) {
+    rule = ipt_chain_find_rule(ipth, tablename, chainname, findrule);
+    if (!rule) {
         return (EUCA_NOT_FOUND_ERROR);
     }
+    rule->flushed = 1;
+    rule->order = 0;
     return (EUCA_OK);
 }
 
@@ -948,8 +1189,6 @@ int ipt_chain_flush_rule(ipt_handler *ipth, char *tablename, char *chainname, ch
  * @return 0 on success or 1 if any failure occurred
  */
 int ipt_handler_free(ipt_handler *ipth) {
-    int i = 0;
-    int j = 0;
     char saved_cmdprefix[EUCA_MAX_PATH] = "";
     char saved_preloadPath[EUCA_MAX_PATH] = "";
 
@@ -959,13 +1198,7 @@ int ipt_handler_free(ipt_handler *ipth) {
     snprintf(saved_cmdprefix, EUCA_MAX_PATH, "%s", ipth->cmdprefix);
     snprintf(saved_preloadPath, EUCA_MAX_PATH, "%s", ipth->preloadPath);
 
-    for (i = 0; i < ipth->max_tables; i++) {
-        for (j = 0; j < ipth->tables[i].max_chains; j++) {
-            EUCA_FREE(ipth->tables[i].chains[j].rules);
-        }
-        EUCA_FREE(ipth->tables[i].chains);
-    }
-    EUCA_FREE(ipth->tables);
+    ipt_handler_free_tables(ipth);
 
     return (ipt_handler_init(ipth, saved_cmdprefix, saved_preloadPath));
 }
@@ -978,24 +1211,60 @@ int ipt_handler_free(ipt_handler *ipth) {
  * @return 0 on success or 1 if any failure occurred
  */
 int ipt_handler_close(ipt_handler *ipth) {
-    int i = 0;
-    int j = 0;
-
     if (!ipth || !ipth->init) {
         LOGDEBUG("Invalid argument. NULL or uninitialized ipt_handler.\n");
         return (1);
     }
 
+    ipt_handler_free_tables(ipth);
+    unlink_handler_file(ipth->ipt_file);
+    ipth->init = 0;
+    return (0);
+}
+
+/**
+ * Releases the tables, chains, rules and indexes of ipth.
+ *
+ * @param ipth [in] pointer to the IP table handler structure
+ */
+static void ipt_handler_free_tables(ipt_handler *ipth) {
+    int i = 0;
+    int j = 0;
+
     for (i = 0; i < ipth->max_tables; i++) {
         for (j = 0; j < ipth->tables[i].max_chains; j++) {
             EUCA_FREE(ipth->tables[i].chains[j].rules);
+            euca_strindex_clear(&(ipth->tables[i].chains[j].rule_index));
         }
         EUCA_FREE(ipth->tables[i].chains);
+        euca_strindex_clear(&(ipth->tables[i].chain_index));
     }
     EUCA_FREE(ipth->tables);
-    unlink_handler_file(ipth->ipt_file);
-    ipth->init = 0;
-    return (0);
+    ipth->max_tables = 0;
+}
+
+/**
+ * Returns the name of a chain, for the chain index of a table.
+ *
+ * @param base [in] the chain array of the table
+ * @param idx [in] position of the chain
+ *
+ * @return the chain name
+ */
+static const char *ipt_chain_key(const void *base, int idx) {
+    return (((const ipt_chain *)base)[idx].name);
+}
+
+/**
+ * Returns the text of a rule, for the rule index of a chain.
+ *
+ * @param base [in] the rule array of the chain
+ * @param idx [in] position of the rule
+ *
+ * @return the rule text
+ */
+static const char *ipt_rule_key(const void *base, int idx) {
+    return (((const ipt_rule *)base)[idx].iptrule);
 }
 
 /**
@@ -1031,3 +1300,291 @@ int ipt_handler_print(ipt_handler *ipth) {
     return (0);
 }
 
+
+#ifdef _UNIT_TEST
+#include <sys/time.h>
+
+#include "euca_gni.h"
+
+#define TEST_SECGROUPS                           500    //!< Number of security groups in the synthetic GNI
+#define TEST_SECGROUP_RULES                      100    //!< Number of ingress rules per security group
+
+//! EDGE chain of one security group, as rendered from the GNI
+typedef struct test_edge_chain_t {
+    char name[64];                     //!< Chain name
+    char fwdrule[1024];                //!< Rule jumping from EUCA_FILTER_FWD to this chain
+    char **rules;                      //!< Rules of the chain
+    int max_rules;                     //!< Number of rules of the chain
+} test_edge_chain;
+
+/**
+ * Returns the current time in microseconds
+ *
+ * @return the current time in microseconds
+ */
+static long long test_now_usec(void) {
+    struct timeval tv = { 0 };
+
+    gettimeofday(&tv, NULL);
+    return (((long long)tv.tv_sec) * 1000000LL + tv.tv_usec);
+}
+
+/**
+ * Builds a synthetic set of EDGE security groups. One rule out of ten refers to another
+ * group instead of a CIDR, the others are a mix of TCP, UDP and ICMP rules.
+ *
+ * @param count [in] number of security groups
+ * @param nrules [in] number of ingress rules per group
+ *
+ * @return the array of security groups. The caller must free it with test_free_secgroups()
+ */
+static gni_secgroup *test_fake_secgroups(int count, int nrules) {
+    int i = 0;
+    int j = 0;
+    gni_rule *rule = NULL;
+    gni_secgroup *secgroups = NULL;
+
+    secgroups = EUCA_ZALLOC(count, sizeof(gni_secgroup));
+    for (i = 0; i < count; i++) {
+        snprintf(secgroups[i].name, SECURITY_GROUP_ID_LEN, "sg-%08x", i);
+        snprintf(secgroups[i].accountId, OWNER_ID_LEN, "%012d", i % 7);
+        secgroups[i].ingress_rules = EUCA_ZALLOC(nrules, sizeof(gni_rule));
+        secgroups[i].max_ingress_rules = nrules;
+        for (j = 0; j < nrules; j++) {
+            rule = &(secgroups[i].ingress_rules[j]);
+            rule->protocol = ((j % 3) == 0) ? 1 : (((j % 3) == 1) ? 6 : 17);
+            rule->fromPort = 1000 + j;
+            rule->toPort = 1000 + j + (j % 5);
+            rule->icmpType = ((j % 2) ? -1 : (j % 16));
+            rule->icmpCode = -1;
+            if ((j % 10) == 9) {
+                snprintf(rule->groupId, SECURITY_GROUP_ID_LEN, "sg-%08x", (i + j) % count);
+            } else {
+                snprintf(rule->cidr, NETWORK_ADDR_LEN, "10.%d.%d.0/24", (i >> 8) & 0xff, (i + j) & 0xff);
+            }
+        }
+    }
+    return (secgroups);
+}
+
+/**
+ * Releases the security groups built by test_fake_secgroups()
+ *
+ * @param secgroups [in] array of security groups
+ * @param count [in] number of security groups
+ */
+static void test_free_secgroups(gni_secgroup *secgroups, int count) {
+    int i = 0;
+
+    for (i = 0; i < count; i++) {
+        EUCA_FREE(secgroups[i].ingress_rules);
+    }
+    EUCA_FREE(secgroups);
+}
+
+/**
+ * Converts the synthetic security groups into the EDGE filter rules, once, so that the
+ * cost of the GNI conversion is not accounted for in the handler timings.
+ *
+ * @param secgroups [in] array of security groups
+ * @param count [in] number of security groups
+ *
+ * @return the array of rendered chains. The caller must free it with test_free_edge()
+ */
+static test_edge_chain *test_render_edge(gni_secgroup *secgroups, int count) {
+    int i = 0;
+    int j = 0;
+    char rule[1024] = "";
+    char newrule[4096] = "";
+    gni_rule *ingress = NULL;
+    test_edge_chain *chains = NULL;
+
+    chains = EUCA_ZALLOC(count, sizeof(test_edge_chain));
+    for (i = 0; i < count; i++) {
+        snprintf(chains[i].name, 64, "EU_%s", secgroups[i].name);
+        snprintf(chains[i].fwdrule, 1024, "-A EUCA_FILTER_FWD -m set --match-set %s dst -j %s", chains[i].name, chains[i].name);
+        chains[i].rules = EUCA_ZALLOC(secgroups[i].max_ingress_rules + 1, sizeof(char *));
+
+        snprintf(newrule, 4096, "-A %s -m set --match-set %s src -j ACCEPT", chains[i].name, chains[i].name);
+        chains[i].rules[chains[i].max_rules++] = strdup(newrule);
+        for (j = 0; j < secgroups[i].max_ingress_rules; j++) {
+            ingress = &(secgroups[i].ingress_rules[j]);
+            if (ingress_gni_to_iptables_rule(NULL, ingress, rule, 0)) {
+                continue;
+            }
+            if (strlen(ingress->groupId)) {
+                snprintf(newrule, 4096, "-A %s -m set --match-set EU_%s src %s -j ACCEPT", chains[i].name, ingress->groupId, rule);
+            } else {
+                snprintf(newrule, 4096, "-A %s %s -j ACCEPT", chains[i].name, rule);
+            }
+            chains[i].rules[chains[i].max_rules++] = strdup(newrule);
+        }
+    }
+    return (chains);
+}
+
+/**
+ * Releases the chains built by test_render_edge()
+ *
+ * @param chains [in] array of rendered chains
+ * @param count [in] number of chains
+ */
+static void test_free_edge(test_edge_chain *chains, int count) {
+    int i = 0;
+    int j = 0;
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < chains[i].max_rules; j++) {
+            EUCA_FREE(chains[i].rules[j]);
+        }
+        EUCA_FREE(chains[i].rules);
+    }
+    EUCA_FREE(chains);
+}
+
+/**
+ * Populates the filter table the way the EDGE driver does on every iteration: the
+ * forward chain and every security group chain are flushed and their rules added back.
+ *
+ * @param ipth [in] pointer to the IP table handler structure
+ * @param chains [in] array of rendered chains
+ * @param count [in] number of chains
+ *
+ * @return the number of rules added
+ */
+static int test_populate_edge(ipt_handler *ipth, test_edge_chain *chains, int count) {
+    int i = 0;
+    int j = 0;
+    int added = 0;
+
+    ipt_handler_add_table(ipth, "filter");
+    ipt_table_add_chain(ipth, "filter", "FORWARD", "ACCEPT", "[0:0]");
+    ipt_table_add_chain(ipth, "filter", "EUCA_FILTER_FWD", "-", "[0:0]");
+    ipt_chain_flush(ipth, "filter", "EUCA_FILTER_FWD");
+    ipt_chain_add_rule(ipth, "filter", "FORWARD", "-A FORWARD -j EUCA_FILTER_FWD");
+    added++;
+
+    for (i = 0; i < count; i++) {
+        ipt_table_add_chain(ipth, "filter", chains[i].name, "-", "[0:0]");
+        ipt_chain_flush(ipth, "filter", chains[i].name);
+        ipt_chain_add_rule(ipth, "filter", "EUCA_FILTER_FWD", chains[i].fwdrule);
+        added++;
+        for (j = 0; j < chains[i].max_rules; j++) {
+            ipt_chain_add_rule(ipth, "filter", chains[i].name, chains[i].rules[j]);
+            added++;
+        }
+    }
+    return (added);
+}
+
+/**
+ * Checks that every chain and rule of the handler is found by name at its own position.
+ *
+ * @param ipth [in] pointer to the IP table handler structure
+ *
+ * @return the number of lookups that did not return the expected entry
+ */
+static int test_check_lookups(ipt_handler *ipth) {
+    int i = 0;
+    int j = 0;
+    int errors = 0;
+    ipt_table *table = NULL;
+    ipt_chain *chain = NULL;
+
+    table = ipt_handler_find_table(ipth, "filter");
+    for (i = 0; i < table->max_chains; i++) {
+        chain = &(table->chains[i]);
+        if (ipt_table_find_chain(ipth, "filter", chain->name) != chain) {
+            errors++;
+        }
+        for (j = 0; j < chain->max_rules; j++) {
+            if (ipt_chain_find_rule(ipth, "filter", chain->name, chain->rules[j].iptrule) != &(chain->rules[j])) {
+                errors++;
+            }
+        }
+    }
+    if (ipt_table_find_chain(ipth, "filter", "EU_sg-nothere") || ipt_chain_find_rule(ipth, "filter", "EUCA_FILTER_FWD", "-A EUCA_FILTER_FWD -j DROP")) {
+        errors++;
+    }
+    return (errors);
+}
+
+/**
+ * Builds a ~50k rules EDGE ruleset from a synthetic GNI and reports how long it takes to
+ * build, look up and deploy. iptables-save and iptables-restore are run through the "true"
+ * command prefix so the deploy path is exercised up to, but not including, the kernel update.
+ *
+ * @return 0 on success or 1 if any check failed
+ */
+int main(int argc, char **argv) {
+    int rules = 0;
+    int errors = 0;
+    int count = TEST_SECGROUPS;
+    long long start = 0;
+    long long build = 0;
+    long long rebuild = 0;
+    long long lookup = 0;
+    gni_secgroup *secgroups = NULL;
+    test_edge_chain *chains = NULL;
+    ipt_handler ipth = { 0 };
+
+    log_params_set(EUCA_LOG_WARN, 0, 100000);
+    if (argc > 1) {
+        count = atoi(argv[1]);
+    }
+
+    if (ipt_handler_init(&ipth, "true", NULL)) {
+        printf("cannot initialize the IP table handler\n");
+        return (1);
+    }
+
+    secgroups = test_fake_secgroups(count, TEST_SECGROUP_RULES);
+    chains = test_render_edge(secgroups, count);
+
+    // first iteration: nothing is in the system yet
+    start = test_now_usec();
+    rules = test_populate_edge(&ipth, chains, count);
+    build = test_now_usec() - start;
+
+    start = test_now_usec();
+    errors += test_check_lookups(&ipth);
+    lookup = test_now_usec() - start;
+
+    if (ipt_handler_deploy(&ipth) || (ipth.deploy_chains != (count + 2))) {
+        printf("initial deploy wrote %d chain(s), expected %d\n", ipth.deploy_chains, count + 2);
+        errors++;
+    }
+    printf("built %d rules in %d chains in %.2f ms (%.2f ms for all lookups), deployed in %.2f ms\n", rules, count + 2, build / 1000.0, lookup / 1000.0,
+           ipth.deploy_usec / 1000.0);
+
+    // following iterations: same content, flushed and added back
+    start = test_now_usec();
+    test_populate_edge(&ipth, chains, count);
+    rebuild = test_now_usec() - start;
+    if (ipt_handler_deploy(&ipth) || (ipth.deploy_chains != 0)) {
+        printf("unchanged deploy wrote %d chain(s), expected 0\n", ipth.deploy_chains);
+        errors++;
+    }
+    printf("rebuilt unchanged ruleset in %.2f ms, deployed in %.2f ms\n", rebuild / 1000.0, ipth.deploy_usec / 1000.0);
+
+    // one security group rule changes
+    EUCA_FREE(chains[count / 2].rules[1]);
+    chains[count / 2].rules[1] = strdup("-A EU_changed -p tcp -m tcp --dport 22 -j ACCEPT");
+    start = test_now_usec();
+    test_populate_edge(&ipth, chains, count);
+    rebuild = test_now_usec() - start;
+    if (ipt_handler_deploy(&ipth) || (ipth.deploy_chains != 1)) {
+        printf("single group deploy wrote %d chain(s), expected 1\n", ipth.deploy_chains);
+        errors++;
+    }
+    printf("rebuilt ruleset with one changed group in %.2f ms, deployed in %.2f ms\n", rebuild / 1000.0, ipth.deploy_usec / 1000.0);
+
+    errors += test_check_lookups(&ipth);
+    test_free_edge(chains, count);
+    test_free_secgroups(secgroups, count);
+    ipt_handler_close(&ipth);
+
+    printf("%s\n", (errors ? "FAILED" : "PASSED"));
+    return (errors ? 1 : 0);
+}
+#endif /* _UNIT_TEST */
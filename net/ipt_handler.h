@@ -34,6 +34,8 @@
 #include <unistd.h>
 #include <errno.h>
 
+#include "euca_strindex.h"
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                  DEFINES                                   |
@@ -107,12 +109,17 @@ typedef struct ipt_chain_t {
     int ruleorder;
     int ref_count;
     int flushed;
+    int in_system;                     //!< Set if the chain was last seen in (or applied to) the system
+    unsigned long long sys_hash;       //!< Hash of the rules of the chain as last seen in the system
+    char sys_policyname[64];           //!< Policy of the chain as last seen in the system
+    euca_strindex rule_index;          //!< Rules indexed by their text
 } ipt_chain;
 
 typedef struct ipt_table_t {
     char name[64];
     ipt_chain *chains;
     int max_chains;
+    euca_strindex chain_index;         //!< Chains indexed by name
 } ipt_table;
 
 typedef struct ipt_handler_t {
@@ -122,6 +129,8 @@ typedef struct ipt_handler_t {
     char ipt_file[EUCA_MAX_PATH];
     char cmdprefix[EUCA_MAX_PATH];
     char preloadPath[EUCA_MAX_PATH];
+    long int deploy_usec;              //!< Duration of the last ipt_handler_deploy() in microseconds
+    int deploy_chains;                 //!< Number of chains the last ipt_handler_deploy() had to write
 } ipt_handler;
 
 /*----------------------------------------------------------------------------*\
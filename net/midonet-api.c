@@ -89,6 +89,30 @@
 struct mem_params_t {
     char *mem;
     size_t size;
+    size_t capacity;
+};
+
+//! MidoNet API request deferred until mido_batch_commit()
+typedef struct mido_batch_request_t {
+    int op;                          //!< one of MIDO_BATCH_POST, MIDO_BATCH_PUT, MIDO_BATCH_DELETE
+    char url[EUCA_MAX_PATH];         //!< target of the request
+    char *media_type;                //!< Content-Type/accept media type
+    char *payload;                   //!< JSON payload of POST/PUT
+    char *loc;                       //!< Location of a newly POSTed resource
+    char *outhttp;                   //!< resource retrieved after POST/PUT
+    midoname *outmn;                 //!< midoname to be filled with the retrieved resource
+    int failed;
+    CURL *curl;                      //!< easy_handle while the request is in flight
+    struct curl_slist *headers;
+    struct mem_params_t rparams;
+    struct mem_params_t wparams;
+} mido_batch_request;
+
+enum {
+    MIDO_BATCH_POST,
+    MIDO_BATCH_PUT,
+    MIDO_BATCH_DELETE,
+    MIDO_BATCH_GET,
 };
 
 /*----------------------------------------------------------------------------*\
@@ -135,9 +159,49 @@ static pthread_mutex_t libcurl_handles_mutex;
 static pthread_mutex_t mido_buffer_mutex;
 static pthread_mutex_t mido_cache_ports_mutex;
 
+static int midocache_full_refresh_interval = MIDOCACHE_FULL_REFRESH_INTERVAL;
+static time_t midocache_full_refresh_ts = 0;
+static int midocache_full_refresh_req = 0;
+
+static int mido_batch_open = 0;
+static mido_batch_request **mido_batch_requests = NULL;
+static int max_mido_batch_requests = 0;
+
 static size_t header_find_location(char *content, size_t size, size_t nmemb, void *params);
 static size_t mem_writer(void *contents, size_t size, size_t nmemb, void *in_params);
 static size_t mem_reader(void *contents, size_t size, size_t nmemb, void *in_params);
+static void mido_libcurl_set_keepalive(CURL *curl);
+static const char *mido_json_ws(const char *p, const char *end);
+static const char *mido_json_skip(const char *p, const char *end);
+static int mido_json_find(const char *json, const char *end, const char *key, const char **val, const char **valend);
+static char *mido_json_utf8(char *q, unsigned int cp);
+static char *mido_json_strdup(const char *val, const char *valend);
+static char *mido_json_get(const char *json, const char *end, const char *key);
+static int mido_json_array_begin(const char **p, const char *end);
+static int mido_json_array_next(const char **p, const char *end, const char **el, const char **elend);
+static int mido_batch_queue(int op, char *url, char *media_type, char *payload, midoname *outmn);
+static int mido_batch_perform(mido_batch_request **reqs, int max_reqs, int phase);
+static void mido_batch_request_free(mido_batch_request *req);
+static void mido_batch_uncache(midoname *mn);
+static int mido_batch_setup(mido_batch_request *req, int get);
+static void mido_batch_done(mido_batch_request *req, CURLcode curlret, int get);
+
+static int midonet_api_cache_refresh_incremental(void);
+static int midonet_api_cache_reusable(midoname *cached, int dirty, midoname *obj);
+static int midonet_api_bridge_dirty(midonet_api_bridge *bridge);
+static int midonet_api_cache_count_midos(midonet_api_cache *cache);
+
+static int midonet_api_index_find(midonet_api_index *index, const char *key, const void *base, int nmemb, euca_strindex_key_fn keyof);
+static void midonet_api_index_clear(midonet_api_index *index);
+static const char *midonet_api_port_uuid(const void *base, int idx);
+static const char *midonet_api_pgport_id(const void *base, int idx);
+static const char *midonet_api_router_name(const void *base, int idx);
+static const char *midonet_api_bridge_name(const void *base, int idx);
+static const char *midonet_api_chain_name(const void *base, int idx);
+static const char *midonet_api_host_name(const void *base, int idx);
+static const char *midonet_api_host_uuid(const void *base, int idx);
+static const char *midonet_api_ipaddrgroup_name(const void *base, int idx);
+static const char *midonet_api_portgroup_name(const void *base, int idx);
 
 /**
  * Prepares an array of mido_cache_thread_params structures: divides ntasks to
@@ -541,6 +605,275 @@ void mido_free_midoname(midoname *name) {
     bzero(name, sizeof(midoname));
 }
 
+/**
+ * Skips JSON whitespace.
+ * @param p [in] position of interest in a JSON buffer.
+ * @param end [in] end of the JSON buffer.
+ * @return pointer to the first non-whitespace character (or end).
+ */
+static const char *mido_json_ws(const char *p, const char *end) {
+    while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\n') || (*p == '\r'))) {
+        p++;
+    }
+    return (p);
+}
+
+/**
+ * Skips the JSON value (string, number, literal, object or array) at p, without
+ * building any json-c object.
+ * @param p [in] beginning of the value of interest.
+ * @param end [in] end of the JSON buffer.
+ * @return pointer past the value. NULL if the value is malformed or truncated.
+ */
+static const char *mido_json_skip(const char *p, const char *end) {
+    int depth = 0;
+
+    p = mido_json_ws(p, end);
+    if ((p >= end) || (*p == '}') || (*p == ']') || (*p == ',') || (*p == ':')) {
+        return (NULL);
+    }
+    do {
+        p = mido_json_ws(p, end);
+        if (p >= end) {
+            return (NULL);
+        }
+        switch (*p) {
+            case '"':
+                for (p++; (p < end) && (*p != '"'); p++) {
+                    if (*p == '\\') {
+                        p++;
+                    }
+                }
+                if (p >= end) {
+                    return (NULL);
+                }
+                p++;
+                break;
+            case '{':
+            case '[':
+                depth++;
+                p++;
+                break;
+            case '}':
+            case ']':
+                depth--;
+                p++;
+                break;
+            case ',':
+            case ':':
+                p++;
+                break;
+            case '\0':
+                return (NULL);
+            default:
+                // number, true, false or null
+                while ((p < end) && *p && !strchr(",:]} \t\r\n", *p)) {
+                    p++;
+                }
+                break;
+        }
+    } while (depth > 0);
+    return (p);
+}
+
+/**
+ * Searches for a top level member of the JSON object at json.
+ * @param json [in] beginning of the JSON object of interest.
+ * @param end [in] end of the JSON buffer.
+ * @param key [in] member name of interest.
+ * @param val [out] beginning of the member value, if found.
+ * @param valend [out] end of the member value, if found.
+ * @return 0 if the member is found. 1 otherwise.
+ */
+static int mido_json_find(const char *json, const char *end, const char *key, const char **val, const char **valend) {
+    size_t keylen = strlen(key);
+    const char *p = NULL, *k = NULL, *v = NULL;
+    int match = 0;
+
+    p = mido_json_ws(json, end);
+    if ((p >= end) || (*p != '{')) {
+        return (1);
+    }
+    for (p++;;) {
+        p = mido_json_ws(p, end);
+        if ((p >= end) || (*p != '"')) {
+            return (1);
+        }
+        k = p + 1;
+        p = mido_json_skip(p, end);
+        if (!p) {
+            return (1);
+        }
+        match = (((size_t) (p - 1 - k) == keylen) && !strncmp(k, key, keylen));
+        p = mido_json_ws(p, end);
+        if ((p >= end) || (*p != ':')) {
+            return (1);
+        }
+        v = mido_json_ws(p + 1, end);
+        p = mido_json_skip(v, end);
+        if (!p) {
+            return (1);
+        }
+        if (match) {
+            *val = v;
+            *valend = p;
+            return (0);
+        }
+        p = mido_json_ws(p, end);
+        if ((p >= end) || (*p != ',')) {
+            return (1);
+        }
+        p++;
+    }
+    return (1);
+}
+
+/**
+ * Appends the UTF-8 encoding of a code point to a buffer.
+ * @param q [in] buffer position to write into.
+ * @param cp [in] code point of interest.
+ * @return pointer past the encoded code point.
+ */
+static char *mido_json_utf8(char *q, unsigned int cp) {
+    if (cp < 0x80) {
+        *q++ = cp;
+    } else if (cp < 0x800) {
+        *q++ = 0xC0 | (cp >> 6);
+        *q++ = 0x80 | (cp & 0x3F);
+    } else if (cp < 0x10000) {
+        *q++ = 0xE0 | (cp >> 12);
+        *q++ = 0x80 | ((cp >> 6) & 0x3F);
+        *q++ = 0x80 | (cp & 0x3F);
+    } else {
+        *q++ = 0xF0 | (cp >> 18);
+        *q++ = 0x80 | ((cp >> 12) & 0x3F);
+        *q++ = 0x80 | ((cp >> 6) & 0x3F);
+        *q++ = 0x80 | (cp & 0x3F);
+    }
+    return (q);
+}
+
+/**
+ * Returns a copy of the JSON value in the argument, in the same representation
+ * as json_object_get_string() (strings are unescaped, objects and arrays are
+ * rendered by json-c).
+ * @param val [in] beginning of the value of interest.
+ * @param valend [in] end of the value of interest.
+ * @return newly allocated string. NULL if the value is JSON null. Caller is
+ * responsible to release the memory allocated.
+ */
+static char *mido_json_strdup(const char *val, const char *valend) {
+    char *res = NULL, *q = NULL;
+    const char *p = NULL;
+    unsigned int cp = 0, lo = 0;
+
+    if (*val == '"') {
+        res = EUCA_ZALLOC_C(valend - val, sizeof (char));
+        for (p = val + 1, q = res; p < (valend - 1); p++) {
+            if (*p != '\\') {
+                *q++ = *p;
+                continue;
+            }
+            p++;
+            switch (*p) {
+                case 'b': *q++ = '\b'; break;
+                case 'f': *q++ = '\f'; break;
+                case 'n': *q++ = '\n'; break;
+                case 'r': *q++ = '\r'; break;
+                case 't': *q++ = '\t'; break;
+                case 'u':
+                    if (((valend - 1 - p) < 5) || (sscanf(p + 1, "%4x", &cp) != 1)) {
+                        break;
+                    }
+                    p += 4;
+                    if ((cp >= 0xD800) && (cp < 0xDC00) && ((valend - 1 - p) >= 7) && (p[1] == '\\') && (p[2] == 'u') &&
+                            (sscanf(p + 3, "%4x", &lo) == 1) && (lo >= 0xDC00) && (lo < 0xE000)) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        p += 6;
+                    }
+                    q = mido_json_utf8(q, cp);
+                    break;
+                default:
+                    *q++ = *p;
+                    break;
+            }
+        }
+        *q = '\0';
+    } else if ((*val == '{') || (*val == '[')) {
+        json_object *jobj = NULL;
+        char *buf = strndup(val, valend - val);
+        jobj = json_tokener_parse(buf);
+        if (jobj) {
+            res = strdup(json_object_get_string(jobj));
+            json_object_put(jobj);
+        }
+        EUCA_FREE(buf);
+    } else if (((valend - val) != 4) || strncmp(val, "null", 4)) {
+        res = strndup(val, valend - val);
+    }
+    return (res);
+}
+
+/**
+ * Retrieves a top level member of the JSON object at json, without parsing the
+ * whole object.
+ * @param json [in] beginning of the JSON object of interest.
+ * @param end [in] end of the JSON buffer.
+ * @param key [in] member name of interest.
+ * @return newly allocated string (see mido_json_strdup()) holding the value of
+ * interest. NULL if the member is not found or is null.
+ */
+static char *mido_json_get(const char *json, const char *end, const char *key) {
+    const char *val = NULL, *valend = NULL;
+
+    if (mido_json_find(json, end, key, &val, &valend)) {
+        return (NULL);
+    }
+    return (mido_json_strdup(val, valend));
+}
+
+/**
+ * Positions p at the first element of the JSON array at p.
+ * @param p [i/o] beginning of the JSON array of interest.
+ * @param end [in] end of the JSON buffer.
+ * @return 0 on success. 1 if p does not point to a JSON array.
+ */
+static int mido_json_array_begin(const char **p, const char *end) {
+    *p = mido_json_ws(*p, end);
+    if ((*p >= end) || (**p != '[')) {
+        return (1);
+    }
+    (*p)++;
+    return (0);
+}
+
+/**
+ * Retrieves the next element of a JSON array.
+ * @param p [i/o] position within the JSON array (see mido_json_array_begin()).
+ * On success, p is advanced past the element.
+ * @param end [in] end of the JSON buffer.
+ * @param el [out] beginning of the element.
+ * @param elend [out] end of the element.
+ * @return 0 on success. 1 if there are no more elements (or the array is malformed).
+ */
+static int mido_json_array_next(const char **p, const char *end, const char **el, const char **elend) {
+    const char *q = mido_json_ws(*p, end);
+
+    if ((q < end) && (*q == ',')) {
+        q = mido_json_ws(q + 1, end);
+    }
+    if ((q >= end) || (*q == ']')) {
+        return (1);
+    }
+    *el = q;
+    *elend = mido_json_skip(q, end);
+    if (!*elend) {
+        return (1);
+    }
+    *p = *elend;
+    return (0);
+}
+
 /**
  * Retrieves an element that corresponds to the given key from name.
  *
@@ -552,23 +885,15 @@ void mido_free_midoname(midoname *name) {
  */
 int mido_getel_midoname(midoname *name, char *key, char **val) {
     int ret = 0;
-    json_object *jobj = NULL;
+    const char *el = NULL, *elend = NULL;
 
     if (!name || !key || !val || (!name->init)) {
         return (1);
     }
 
     *val = NULL;
-    jobj = json_tokener_parse(name->jsonbuf);
-    if (jobj) {
-        json_object_object_foreach(jobj, elkey, elval) {
-            if (!*val && elkey && elval) {
-                if (!strcmp(elkey, key)) {
-                    *val = strdup(SP(json_object_get_string(elval)));
-                }
-            }
-        }
-        json_object_put(jobj);
+    if (name->jsonbuf && !mido_json_find(name->jsonbuf, name->jsonbuf + strlen(name->jsonbuf), key, &el, &elend)) {
+        *val = mido_json_strdup(el, elend);
     }
 
     if (*val == NULL) {
@@ -593,9 +918,8 @@ int mido_getel_midoname(midoname *name, char *key, char **val) {
  */
 int mido_getarr_midoname(midoname *name, char *key, char ***values, int *max_values) {
     int ret = 0;
-    json_object *jobj = NULL;
-    json_object *jarr = NULL;
-    json_object *jarrel = NULL;
+    const char *jend = NULL, *jarr = NULL, *jarrend = NULL, *p = NULL;
+    const char *jarrel = NULL, *jarrelend = NULL;
     int jarr_len = 0;
     char **res;
 
@@ -607,26 +931,30 @@ int mido_getarr_midoname(midoname *name, char *key, char ***values, int *max_val
 
     *values = NULL;
     *max_values = 0;
-    jobj = json_tokener_parse(name->jsonbuf);
-    if (jobj) {
-        json_object_object_get_ex(jobj, key, &jarr);
-        if ((jarr == NULL) || (!json_object_is_type(jarr, json_type_array))) {
-            ret = 1;
-        } else {
-            jarr_len = json_object_array_length(jarr);
-            LOGEXTREME("\tfound %d\n", jarr_len);
-            if (jarr_len > 0) {
-                res = EUCA_ZALLOC_C(jarr_len, sizeof (char *));
-                for (int i = 0; i < jarr_len; i++) {
-                    jarrel = json_object_array_get_idx(jarr, i);
-                    res[i] = strdup(json_object_get_string(jarrel));
-                    LOGEXTREME("\t%d %s\n", i, res[i]);
+    if (!name->jsonbuf) {
+        return (ret);
+    }
+    jend = name->jsonbuf + strlen(name->jsonbuf);
+    if (mido_json_find(name->jsonbuf, jend, key, &jarr, &jarrend) || mido_json_array_begin(&jarr, jarrend)) {
+        ret = 1;
+    } else {
+        p = jarr;
+        while (!mido_json_array_next(&p, jarrend, &jarrel, &jarrelend)) {
+            jarr_len++;
+        }
+        LOGEXTREME("\tfound %d\n", jarr_len);
+        if (jarr_len > 0) {
+            res = EUCA_ZALLOC_C(jarr_len, sizeof (char *));
+            for (int i = 0; (i < jarr_len) && !mido_json_array_next(&jarr, jarrend, &jarrel, &jarrelend); i++) {
+                res[i] = mido_json_strdup(jarrel, jarrelend);
+                if (res[i] == NULL) {
+                    res[i] = strdup("");
                 }
-                *values = res;
-                *max_values = jarr_len;
+                LOGEXTREME("\t%d %s\n", i, res[i]);
             }
+            *values = res;
+            *max_values = jarr_len;
         }
-        json_object_put(jobj);
     }
 
     return (ret);
@@ -1208,7 +1536,7 @@ midonet_api_portgroup *mido_get_portgroup(char *name) {
  * @return 0 on success. 1 otherwise.
  */
 int mido_create_portgroup_port(midoname *portgroup, midoname *port, midoname **outname) {
-    int rc = 0, max_ports = 0;
+    int rc = 0, max_ports = 0, pos = 0;
     midoname myname, **ports = NULL;
     midoname *out = NULL;
 
@@ -1230,25 +1558,20 @@ int mido_create_portgroup_port(midoname *portgroup, midoname *port, midoname **o
         max_ports = pg->max_ports;
     }
     if (out && out->init) {
-        for (int i = 0; i < max_ports; i++) {
-            if (ports[i] == NULL) {
-                continue;
-            }
-            if (ports[i] == out) {
-                LOGEXTREME("port %s already a member of %s - abort create\n", out->uuid, portgroup->name);
-                return (0);
-            }
+        if (midonet_api_cache_lookup_portgroup_port(pg, out, NULL) == out) {
+            LOGEXTREME("port %s already a member of %s - abort create\n", out->uuid, portgroup->name);
+            return (0);
         }
         out = NULL;
     }
-    for (int i = 0; i < max_ports; i++) {
-        if (strstr(ports[i]->uuid, port->uuid)) {
-            if (outname) {
-                *outname = ports[i];
-            }
-            LOGEXTREME("port %s already a member of %s - abort create.\n", ports[i]->uuid, portgroup->name);
-            return (0);
+    // port-group ports are keyed by the uuid of their member port
+    pos = midonet_api_index_find(&(pg->ports_byid), port->uuid, ports, max_ports, midonet_api_pgport_id);
+    if (pos >= 0) {
+        if (outname) {
+            *outname = ports[pos];
         }
+        LOGEXTREME("port %s already a member of %s - abort create.\n", ports[pos]->uuid, portgroup->name);
+        return (0);
     }
 
     bzero(&myname, sizeof(midoname));
@@ -1259,6 +1582,8 @@ int mido_create_portgroup_port(midoname *portgroup, midoname *port, midoname **o
     rc = mido_create_resource(portgroup, 1, &myname, &out, "portId", port->uuid, NULL);
     if (rc == 0) {
         midonet_api_cache_add_portgroup_port(pg, out);
+    } else if (rc > 0) {
+        pg->dirty = 1;
     }
     if (outname) {
         *outname = out;
@@ -1463,23 +1788,11 @@ int mido_get_ipaddrgroups(char *tenant, midoname ***outnames, int *outnames_max)
  * @return pointer to the data structure that represents the ipaddrgroup, when found. NULL otherwise.
  */
 midonet_api_ipaddrgroup *mido_get_ipaddrgroup(char *name) {
+    int pos = 0;
     if (midocache != NULL) {
-        if (midocache->sorted_ipaddrgroups == 0) {
-            qsort(midocache->ipaddrgroups, midocache->max_ipaddrgroups,
-                    sizeof (midonet_api_ipaddrgroup *), compare_midonet_api_ipaddrgroup);
-            midocache->sorted_ipaddrgroups = 1;
-        }
-        midoname tmp;
-        tmp.name = strdup(name);
-        midonet_api_ipaddrgroup ipag;
-        ipag.obj = &tmp;
-        midonet_api_ipaddrgroup *pipag = &ipag;
-        midonet_api_ipaddrgroup **res = (midonet_api_ipaddrgroup **) bsearch(&pipag,
-                midocache->ipaddrgroups, midocache->max_ipaddrgroups,
-                sizeof (midonet_api_ipaddrgroup *), compare_midonet_api_ipaddrgroup);
-        EUCA_FREE(tmp.name);
-        if (res) {
-            return (*res);
+        pos = midonet_api_index_find(&(midocache->ipaddrgroups_byname), name, midocache->ipaddrgroups, midocache->max_ipaddrgroups, midonet_api_ipaddrgroup_name);
+        if (pos >= 0) {
+            return (midocache->ipaddrgroups[pos]);
         }
     }
     return (NULL);
@@ -1579,6 +1892,7 @@ int mido_create_ip4mac(midonet_api_bridge *br, midoname *devname, char *ip, char
     } else if (rc < 0) {
         ret = 0;
     } else {
+        br->dirty = 1;
         ret = 1;
     }
     mido_free_midoname(&myname);
@@ -1761,6 +2075,7 @@ int mido_create_macport(midonet_api_bridge *br, midoname *devname, char *macAddr
     } else if (rc < 0) {
         ret = 0;
     } else {
+        br->dirty = 1;
         ret = 1;
     }
     mido_free_midoname(&myname);
@@ -2036,6 +2351,7 @@ int mido_create_dhcp(midonet_api_bridge *br, midoname *devname, char *subnet, ch
         } else if (rc < 0) {
             ret = 0;
         } else {
+            br->dirty = 1;
             ret = 1;
         }
         EUCA_FREE(dnslist);
@@ -2345,6 +2661,7 @@ int mido_create_dhcphost(midonet_api_bridge *bridge, midoname *dhcp, char *name,
             } else if (rc < 0) {
                 ret = 0;
             } else {
+                dh->dirty = 1;
                 ret = 1;
             }
         }
@@ -2565,6 +2882,7 @@ int mido_create_ipaddrgroup_ip(midonet_api_ipaddrgroup *ipag, midoname *ipaddrgr
         } else if (rc < 0) {
             ret = 0;
         } else {
+            ig->dirty = 1;
             ret = 1;
         }
         mido_free_midoname(&myname);
@@ -2834,6 +3152,7 @@ int mido_create_rule(midonet_api_chain *ch, midoname *chain, midoname **outname,
         } else if (rc < 0) {
             ret = 0;
         } else {
+            ch->dirty = 1;
             ret = 1;
         }
         mido_free_midoname(&myname);
@@ -2975,6 +3294,7 @@ int mido_create_bridge_port(midonet_api_bridge *br, midoname *devname, midoname
         midonet_api_cache_add_bridge_port(br, out);
         ret = 0;
     } else {
+        br->dirty = 1;
         ret = 1;
     }
     return (ret);
@@ -3059,6 +3379,7 @@ int mido_create_router_port(midonet_api_router *rt, midoname *devname, char *ip,
         } else if (rc < 0) {
             ret = 0;
         } else {
+            rt->dirty = 1;
             ret = 1;
         }
     }
@@ -3673,7 +3994,11 @@ int mido_update_resource(midoname *name, va_list *al) {
     va_copy(ala, *al);
     payload = mido_jsonize(name->tenant, &ala);
     va_end(ala);
-       
+
+    if (payload && mido_batch_open) {
+        return (mido_batch_queue(MIDO_BATCH_PUT, name->uri, name->media_type, payload, name));
+    }
+
     if (payload) {
         rc = midonet_http_put(name->uri, name->media_type, payload);
         if (rc) {
@@ -3688,7 +4013,8 @@ int mido_update_resource(midoname *name, va_list *al) {
             ret = 1;
         } else {
             EUCA_FREE(name->jsonbuf);
-            name->jsonbuf = strdup(payload);
+            name->jsonbuf = payload;
+            payload = NULL;
             ret = mido_update_midoname(name);
         }
         EUCA_FREE(payload);
@@ -3974,6 +4300,15 @@ int mido_create_resource_v(midoname *parents, int max_parents, midoname *newname
             strcat(url, tmpbuf);
         }
 
+        if (mido_batch_open && outmn) {
+            // outmn is completed (init set) by mido_batch_commit(); name and type
+            // are filled now so that the new object can be cached by the caller
+            mido_copy_midoname(outmn, newname);
+            outmn->init = 0;
+            ret = mido_batch_queue(MIDO_BATCH_POST, url, newname->media_type, payload, outmn);
+            return (ret);
+        }
+
         // perform the create
         rc = midonet_http_post(url, newname->media_type, payload, &outloc);
         if (rc) {
@@ -3997,7 +4332,8 @@ int mido_create_resource_v(midoname *parents, int max_parents, midoname *newname
                     if (outmn->jsonbuf) {
                         EUCA_FREE(outmn->jsonbuf);
                     }
-                    outmn->jsonbuf = strdup(outhttp);
+                    outmn->jsonbuf = outhttp;
+                    outhttp = NULL;
                 }
 
                 outmn->init = 1;
@@ -4128,39 +4464,42 @@ int mido_create_midoname(char *tenant, char *name, char *uuid, char *resource_ty
  */
 int mido_update_midoname(midoname *name) {
     int ret = 0;
-    struct json_object *jobj = NULL, *el = NULL;
+    const char *jend = NULL;
+    char *el = NULL;
     char special_uuid[EUCA_MAX_PATH];
 
     if (!name || (!name->init)) {
         return (1);
     }
-    jobj = json_tokener_parse(name->jsonbuf);
-    if (!jobj) {
+    if (name->jsonbuf) {
+        jend = mido_json_skip(name->jsonbuf, name->jsonbuf + strlen(name->jsonbuf));
+    }
+    if (!jend || (*mido_json_ws(name->jsonbuf, jend) != '{')) {
         LOGERROR("failed to parse %s\n", name->jsonbuf ? name->jsonbuf : "NULL");
         ret = 1;
     } else {
-        json_object_object_get_ex(jobj, "id", &el);
+        el = mido_json_get(name->jsonbuf, jend, "id");
         if (el) {
             EUCA_FREE(name->uuid);
-            name->uuid = strdup(json_object_get_string(el));
+            name->uuid = el;
         }
 
-        json_object_object_get_ex(jobj, "tenantId", &el);
+        el = mido_json_get(name->jsonbuf, jend, "tenantId");
         if (el) {
             EUCA_FREE(name->tenant);
-            name->tenant = strdup(json_object_get_string(el));
+            name->tenant = el;
         }
 
-        json_object_object_get_ex(jobj, "name", &el);
+        el = mido_json_get(name->jsonbuf, jend, "name");
         if (el) {
             EUCA_FREE(name->name);
-            name->name = strdup(json_object_get_string(el));
+            name->name = el;
         }
 
-        json_object_object_get_ex(jobj, "uri", &el);
+        el = mido_json_get(name->jsonbuf, jend, "uri");
         if (el) {
             EUCA_FREE(name->uri);
-            name->uri = strdup(json_object_get_string(el));
+            name->uri = el;
         }
 
         // special cases
@@ -4169,14 +4508,14 @@ int mido_update_midoname(midoname *name) {
             EUCA_FREE(name->uuid);
             EUCA_FREE(name->name);
 
-            json_object_object_get_ex(jobj, "subnetPrefix", &el);
+            el = mido_json_get(name->jsonbuf, jend, "subnetPrefix");
             if (el) {
-                subnet = strdup(json_object_get_string(el));
+                subnet = el;
             }
 
-            json_object_object_get_ex(jobj, "subnetLength", &el);
+            el = mido_json_get(name->jsonbuf, jend, "subnetLength");
             if (el) {
-                slashnet = strdup(json_object_get_string(el));
+                slashnet = el;
             }
 
             if (subnet && slashnet) {
@@ -4190,9 +4529,9 @@ int mido_update_midoname(midoname *name) {
             char *ip = NULL;
             EUCA_FREE(name->uuid);
             EUCA_FREE(name->name);
-            json_object_object_get_ex(jobj, "addr", &el);
+            el = mido_json_get(name->jsonbuf, jend, "addr");
             if (el) {
-                ip = strdup(json_object_get_string(el));
+                ip = el;
             }
             
             if (ip) {
@@ -4219,33 +4558,33 @@ int mido_update_midoname(midoname *name) {
             } else {
                 name->rule = EUCA_ZALLOC_C(1, sizeof (midoname_rule_extras));
             }
-            json_object_object_get_ex(jobj, "type", &el);
+            el = mido_json_get(name->jsonbuf, jend, "type");
             if (el) {
-                name->rule->type = strdup(json_object_get_string(el));
+                name->rule->type = el;
             }
-            json_object_object_get_ex(jobj, "nwDstAddress", &el);
+            el = mido_json_get(name->jsonbuf, jend, "nwDstAddress");
             if (el) {
-                name->rule->nwdstaddress = strdup(json_object_get_string(el));
+                name->rule->nwdstaddress = el;
             }
-            json_object_object_get_ex(jobj, "nwDstLength", &el);
+            el = mido_json_get(name->jsonbuf, jend, "nwDstLength");
             if (el) {
-                name->rule->nwsrclength = strdup(json_object_get_string(el));
+                name->rule->nwsrclength = el;
             }
-            json_object_object_get_ex(jobj, "nwSrcAddress", &el);
+            el = mido_json_get(name->jsonbuf, jend, "nwSrcAddress");
             if (el) {
-                name->rule->nwsrcaddress = strdup(json_object_get_string(el));
+                name->rule->nwsrcaddress = el;
             }
-            json_object_object_get_ex(jobj, "nwSrcLength", &el);
+            el = mido_json_get(name->jsonbuf, jend, "nwSrcLength");
             if (el) {
-                name->rule->nwdstlength = strdup(json_object_get_string(el));
+                name->rule->nwdstlength = el;
             }
-            json_object_object_get_ex(jobj, "natTargets", &el);
+            el = mido_json_get(name->jsonbuf, jend, "natTargets");
             if (el) {
-                name->rule->nattarget = strdup(json_object_get_string(el));
+                name->rule->nattarget = el;
             }
-            json_object_object_get_ex(jobj, "jumpChainId", &el);
+            el = mido_json_get(name->jsonbuf, jend, "jumpChainId");
             if (el) {
-                name->rule->jumpchainid = strdup(json_object_get_string(el));
+                name->rule->jumpchainid = el;
             }
 
         } else if (!strcmp(name->resource_type, "ports")) {
@@ -4261,37 +4600,37 @@ int mido_update_midoname(midoname *name) {
             } else {
                 name->port = EUCA_ZALLOC_C(1, sizeof (midoname_port_extras));
             }
-            json_object_object_get_ex(jobj, "type", &el);
+            el = mido_json_get(name->jsonbuf, jend, "type");
             if (el) {
-                name->port->type = strdup(json_object_get_string(el));
+                name->port->type = el;
             }
-            json_object_object_get_ex(jobj, "hostId", &el);
+            el = mido_json_get(name->jsonbuf, jend, "hostId");
             if (el) {
-                name->port->hostid = strdup(json_object_get_string(el));
+                name->port->hostid = el;
             }
-            json_object_object_get_ex(jobj, "peerId", &el);
+            el = mido_json_get(name->jsonbuf, jend, "peerId");
             if (el) {
-                name->port->peerid = strdup(json_object_get_string(el));
+                name->port->peerid = el;
             }
-            json_object_object_get_ex(jobj, "interfaceName", &el);
+            el = mido_json_get(name->jsonbuf, jend, "interfaceName");
             if (el) {
-                name->port->ifname = strdup(json_object_get_string(el));
+                name->port->ifname = el;
             }
-            json_object_object_get_ex(jobj, "networkAddress", &el);
+            el = mido_json_get(name->jsonbuf, jend, "networkAddress");
             if (el) {
-                name->port->netaddr = strdup(json_object_get_string(el));
+                name->port->netaddr = el;
             }
-            json_object_object_get_ex(jobj, "networkLength", &el);
+            el = mido_json_get(name->jsonbuf, jend, "networkLength");
             if (el) {
-                name->port->netlen = strdup(json_object_get_string(el));
+                name->port->netlen = el;
             }
-            json_object_object_get_ex(jobj, "portAddress", &el);
+            el = mido_json_get(name->jsonbuf, jend, "portAddress");
             if (el) {
-                name->port->portaddr = strdup(json_object_get_string(el));
+                name->port->portaddr = el;
             }
-            json_object_object_get_ex(jobj, "portMac", &el);
+            el = mido_json_get(name->jsonbuf, jend, "portMac");
             if (el) {
-                name->port->portmac = strdup(json_object_get_string(el));
+                name->port->portmac = el;
             }
         } else if (!strcmp(name->resource_type, "routes")) {
             if (name->route) {
@@ -4306,37 +4645,37 @@ int mido_update_midoname(midoname *name) {
             } else {
                 name->route = EUCA_ZALLOC_C(1, sizeof (midoname_route_extras));
             }
-            json_object_object_get_ex(jobj, "srcNetworkAddr", &el);
+            el = mido_json_get(name->jsonbuf, jend, "srcNetworkAddr");
             if (el) {
-                name->route->srcnet = strdup(json_object_get_string(el));
+                name->route->srcnet = el;
             }
-            json_object_object_get_ex(jobj, "srcNetworkLength", &el);
+            el = mido_json_get(name->jsonbuf, jend, "srcNetworkLength");
             if (el) {
-                name->route->srclen = strdup(json_object_get_string(el));
+                name->route->srclen = el;
             }
-            json_object_object_get_ex(jobj, "dstNetworkAddr", &el);
+            el = mido_json_get(name->jsonbuf, jend, "dstNetworkAddr");
             if (el) {
-                name->route->dstnet = strdup(json_object_get_string(el));
+                name->route->dstnet = el;
             }
-            json_object_object_get_ex(jobj, "dstNetworkLength", &el);
+            el = mido_json_get(name->jsonbuf, jend, "dstNetworkLength");
             if (el) {
-                name->route->dstlen = strdup(json_object_get_string(el));
+                name->route->dstlen = el;
             }
-            json_object_object_get_ex(jobj, "type", &el);
+            el = mido_json_get(name->jsonbuf, jend, "type");
             if (el) {
-                name->route->type = strdup(json_object_get_string(el));
+                name->route->type = el;
             }
-            json_object_object_get_ex(jobj, "nextHopPort", &el);
+            el = mido_json_get(name->jsonbuf, jend, "nextHopPort");
             if (el) {
-                name->route->nexthopport = strdup(json_object_get_string(el));
+                name->route->nexthopport = el;
             }
-            json_object_object_get_ex(jobj, "nextHopGateway", &el);
+            el = mido_json_get(name->jsonbuf, jend, "nextHopGateway");
             if (el) {
-                name->route->nexthopgateway = strdup(json_object_get_string(el));
+                name->route->nexthopgateway = el;
             }
-            json_object_object_get_ex(jobj, "weight", &el);
+            el = mido_json_get(name->jsonbuf, jend, "weight");
             if (el) {
-                name->route->weight = strdup(json_object_get_string(el));
+                name->route->weight = el;
             }
         } else if (!strcmp(name->resource_type, "arp_table")) {
             if (name->ip4mac) {
@@ -4345,13 +4684,13 @@ int mido_update_midoname(midoname *name) {
             } else {
                 name->ip4mac = EUCA_ZALLOC_C(1, sizeof (midoname_ip4mac_extras));
             }
-            json_object_object_get_ex(jobj, "ip", &el);
+            el = mido_json_get(name->jsonbuf, jend, "ip");
             if (el) {
-                name->ip4mac->ip = strdup(json_object_get_string(el));
+                name->ip4mac->ip = el;
             }
-            json_object_object_get_ex(jobj, "mac", &el);
+            el = mido_json_get(name->jsonbuf, jend, "mac");
             if (el) {
-                name->ip4mac->mac = strdup(json_object_get_string(el));
+                name->ip4mac->mac = el;
             }
         } else if (!strcmp(name->resource_type, "mac_table")) {
             if (name->macport) {
@@ -4360,13 +4699,13 @@ int mido_update_midoname(midoname *name) {
             } else {
                 name->macport = EUCA_ZALLOC_C(1, sizeof (midoname_macport_extras));
             }
-            json_object_object_get_ex(jobj, "macAddr", &el);
+            el = mido_json_get(name->jsonbuf, jend, "macAddr");
             if (el) {
-                name->macport->macAddr = strdup(json_object_get_string(el));
+                name->macport->macAddr = el;
             }
-            json_object_object_get_ex(jobj, "portId", &el);
+            el = mido_json_get(name->jsonbuf, jend, "portId");
             if (el) {
-                name->macport->portId = strdup(json_object_get_string(el));
+                name->macport->portId = el;
             }
         }
         
@@ -4378,8 +4717,6 @@ int mido_update_midoname(midoname *name) {
         if (!name->name || (strlen(name->name) <= 0)) {
             name->name = strdup(name->uuid);
         }
-
-        json_object_put(jobj);
     }
 
     return (ret);
@@ -4415,6 +4752,15 @@ int mido_delete_resource(midoname *parentname, midoname *name) {
 
     LOGTRACE("resource to delete: %s/%s url to delete: %s\n", SP(name->name), SP(name->uuid), url);
 
+    if (mido_batch_open) {
+        // callers drop name after a successful delete; failures are reported by mido_batch_commit()
+        ret = mido_batch_queue(MIDO_BATCH_DELETE, url, NULL, NULL, NULL);
+        if (!ret) {
+            mido_free_midoname(name);
+        }
+        return (ret);
+    }
+
     rc = midonet_http_delete(url);
     if (rc) {
         ret = 1;
@@ -4437,12 +4783,19 @@ int mido_delete_resource(midoname *parentname, midoname *name) {
 static size_t mem_writer(void *contents, size_t size, size_t nmemb, void *in_params) {
     struct mem_params_t *params = (struct mem_params_t *)in_params;
 
-    if (!params->mem) {
-        params->mem = calloc(1, 1);
-    }
-    params->mem = realloc(params->mem, params->size + (size * nmemb) + 1);
-    if (params->mem == NULL) {
-        return (0);
+    if ((params->size + (size * nmemb) + 1) > params->capacity) {
+        // grow geometrically - large collections arrive in many small chunks
+        size_t capacity = (params->capacity > 0) ? (params->capacity * 2) : MIDONET_API_HTTP_BUFFER_MIN;
+        char *mem = NULL;
+        while (capacity < (params->size + (size * nmemb) + 1)) {
+            capacity *= 2;
+        }
+        mem = realloc(params->mem, capacity);
+        if (mem == NULL) {
+            return (0);
+        }
+        params->mem = mem;
+        params->capacity = capacity;
     }
     memcpy(&(params->mem[params->size]), contents, size * nmemb);
     params->size += size * nmemb;
@@ -4635,6 +4988,9 @@ int mido_libcurl_cleanup_handles(mido_libcurl_handles *handles) {
             curl_easy_cleanup(handles->gethandles[i]);
         }
         EUCA_FREE(handles->gethandles);
+        if (handles->multi) {
+            curl_multi_cleanup(handles->multi);
+        }
         bzero(handles, sizeof (mido_libcurl_handles));
     }
     pthread_mutex_unlock(&libcurl_handles_mutex);
@@ -4698,11 +5054,14 @@ CURL *mido_libcurl_get_handle(mido_libcurl_handles *handles) {
         res = curl_easy_init();
         if (!res) {
             LOGERROR("Unable to get libcurl easy_handle\n");
-        } else {
-            curl_easy_setopt(res, CURLOPT_NOSIGNAL, 1L);
         }
     }
     pthread_mutex_unlock(&libcurl_handles_mutex);
+    if (res) {
+        // curl_easy_reset() clears options but keeps the connection cache
+        curl_easy_setopt(res, CURLOPT_NOSIGNAL, 1L);
+        mido_libcurl_set_keepalive(res);
+    }
     return (res);
 }
 
@@ -4733,13 +5092,24 @@ CURL *mido_libcurl_get_gethandle(mido_libcurl_handles *handles) {
         curl_easy_setopt(res, CURLOPT_HTTPGET, 1L);
         curl_easy_setopt(res, CURLOPT_WRITEFUNCTION, mem_writer);
         curl_easy_setopt(res, CURLOPT_NOSIGNAL, 1L);
-        //curl_easy_setopt(res, CURLOPT_TCP_KEEPALIVE, 1L);
-        //curl_easy_setopt(res, CURLOPT_TCP_KEEPINTVL, 30L);
-        //curl_easy_setopt(res, CURLOPT_TCP_KEEPIDLE, 600L);
+        mido_libcurl_set_keepalive(res);
     }
     return (res);
 }
 
+/**
+ * Enables TCP keep-alive probes on the connections of the given easy_handle, so
+ * that pooled connections to MidoNet API survive idle periods between requests.
+ * @param curl [in] libcurl easy_handle of interest.
+ */
+static void mido_libcurl_set_keepalive(CURL *curl) {
+#if LIBCURL_VERSION_NUM >= 0x071900
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, (long) MIDONET_API_TCP_KEEPINTVL);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, (long) MIDONET_API_TCP_KEEPIDLE);
+#endif /* LIBCURL_VERSION_NUM >= 0x071900 */
+}
+
 /**
  * Releases the libcurl easy_handle in the argument for other threads to use.
  * @param handles [in] pointer to mido_libcurl_handles structure
@@ -4840,8 +5210,13 @@ int midonet_http_get(char *url, char *apistr, char **out_payload) {
 
     if (!ret) {
         if (mem_writer_params.mem && mem_writer_params.size > 0) {
-            *out_payload = EUCA_ZALLOC_C(mem_writer_params.size + 1, sizeof(char));
-            memcpy(*out_payload, mem_writer_params.mem, mem_writer_params.size + 1);
+            // hand the response buffer over to the caller, trimmed (in place) as
+            // it may be kept as a jsonbuf
+            *out_payload = realloc(mem_writer_params.mem, mem_writer_params.size + 1);
+            if (*out_payload == NULL) {
+                *out_payload = mem_writer_params.mem;
+            }
+            mem_writer_params.mem = NULL;
         } else {
             LOGERROR("ERROR: no data to return after successful curl operation\n");
             ret = 1;
@@ -5080,92 +5455,484 @@ int midonet_http_delete(char *url) {
 }
 
 /**
- * Searches for a mido router route specified in the arguments from a list (also
- * specified in the arguments). 
- *
- * @param routes [in] list of routes to look for a matching route entry.
- * @param max_routes [in] number of routes in the list.
- * @param rport [in] router port to be routed.
- * @param src [in] source subnet.
- * @param src_slashnet [in] source slash net.
- * @param dst [in] destination subnet.
- * @param dst_slashnet [in] destination slash net.
- * @param next_hop_ip [in] next hop.
- * @param weight [in] route weight.
- * @param foundidx [out] index at which the route was found. -1 if the route was not found.
- * @return 0 if the route was found. 1 otherwise.
+ * Opens a batch of MidoNet API requests. Until mido_batch_commit() is called,
+ * creates (with an output midoname), updates and deletes are queued instead of
+ * being sent. Objects created in a batch are returned with init set to 0; name,
+ * tenant and type are valid so that they can be cached, but uuid and jsonbuf are
+ * only available after mido_batch_commit(). Requests in a batch must not depend
+ * on each other.
+ * @return 0 on success. 1 if a batch is already open.
  */
-int mido_find_route_from_list(midoname **routes, int max_routes, midoname *rport,
-        char *src, char *src_slashnet, char *dst, char *dst_slashnet, char *next_hop_ip,
-        char *weight, int *foundidx) {
-    int rc = 0, found = 0, ret = 0;
-    int i = 0;
+int mido_batch_begin(void) {
+    if (mido_batch_open) {
+        LOGWARN("MidoNet API batch already open\n");
+        return (1);
+    }
+    mido_batch_open = 1;
+    return (0);
+}
 
-    if ((routes == NULL) || (max_routes == 0)) {
+/**
+ * Checks whether MidoNet API requests are currently being batched.
+ * @return 1 if a batch is open. 0 otherwise.
+ */
+int mido_batch_active(void) {
+    return (mido_batch_open);
+}
+
+/**
+ * Sends all requests queued since mido_batch_begin(). Requests are performed
+ * concurrently, on at most MIDONET_API_BATCH_CONNECTIONS connections that are
+ * kept alive across batches. Created and updated objects are then retrieved
+ * (also concurrently) and their midoname structures completed. Created objects
+ * that failed are left with init set to 0 and, if top level, removed from midocache
+ * (cache entries returned for them before the commit are no longer valid).
+ * @return 0 if all requests succeeded. Number of failed requests otherwise.
+ */
+int mido_batch_commit(void) {
+    int ret = 0, max_gets = 0;
+    mido_batch_request **gets = NULL;
+    mido_batch_request *req = NULL;
+    struct timeval tv;
+    long int batchtime;
+
+    if (!mido_batch_open) {
+        LOGWARN("Cannot commit: no open MidoNet API batch\n");
         return (1);
     }
+    mido_batch_open = 0;
+    if (max_mido_batch_requests == 0) {
+        return (0);
+    }
 
-    found = 0;
-    for (i = 0; i < max_routes && !found; i++) {
-        if ((routes[i] == NULL) || (routes[i]->init == 0)) {
+    eucanetd_timer_usec(&tv);
+    mido_check_state();
+
+    mido_batch_perform(mido_batch_requests, max_mido_batch_requests, 0);
+
+    // retrieve created and updated objects
+    for (int i = 0; i < max_mido_batch_requests; i++) {
+        req = mido_batch_requests[i];
+        if (req->failed || !req->outmn || (req->op == MIDO_BATCH_DELETE)) {
             continue;
         }
-        if (!next_hop_ip || strcmp(next_hop_ip, "UNSET")) {
-            rc = 1;
-            if (routes[i]->route) {
-                if ((src && routes[i]->route->srcnet && !strcmp(src, routes[i]->route->srcnet)) &&
-                        (src_slashnet && routes[i]->route->srclen && !strcmp(src_slashnet, routes[i]->route->srclen)) &&
-                        (dst && routes[i]->route->dstnet && !strcmp(dst, routes[i]->route->dstnet)) &&
-                        (dst_slashnet && routes[i]->route->dstlen && !strcmp(dst_slashnet, routes[i]->route->dstlen)) &&
-                        (!strcmp("Normal", routes[i]->route->type)) &&
-                        (rport->uuid && routes[i]->route->nexthopport && !strcmp(rport->uuid, routes[i]->route->nexthopport)) &&
-                        (weight && routes[i]->route->weight && !strcmp(weight, routes[i]->route->weight)) &&
-                        (next_hop_ip && routes[i]->route->nexthopgateway && !strcmp(next_hop_ip, routes[i]->route->nexthopgateway))) {
-                    rc = 0;
-                }
-            }
-            if (!rc) {
-                found = 1;
-                if (foundidx) {
-                    *foundidx = i;
-                }
-            }
-        } else {
-            rc = mido_cmp_midoname_to_input(routes[i], "srcNetworkAddr", src, "srcNetworkLength", src_slashnet, "dstNetworkAddr", dst, "dstNetworkLength", dst_slashnet,
-                    "type", "Normal", "nextHopPort", rport->uuid, "weight", weight, NULL);
-            rc = 1;
-            if (routes[i]->route) {
-                if ((src && routes[i]->route->srcnet && !strcmp(src, routes[i]->route->srcnet)) &&
-                        (src_slashnet && routes[i]->route->srclen && !strcmp(src_slashnet, routes[i]->route->srclen)) &&
-                        (dst && routes[i]->route->dstnet && !strcmp(dst, routes[i]->route->dstnet)) &&
-                        (dst_slashnet && routes[i]->route->dstlen && !strcmp(dst_slashnet, routes[i]->route->dstlen)) &&
-                        (!strcmp("Normal", routes[i]->route->type)) &&
-                        (rport->uuid && routes[i]->route->nexthopport && !strcmp(rport->uuid, routes[i]->route->nexthopport)) &&
-                        (weight && routes[i]->route->weight && !strcmp(weight, routes[i]->route->weight))) {
-                    rc = 0;
-                }
+        if ((req->op == MIDO_BATCH_POST) && !req->loc) {
+            LOGWARN("No location returned for new resource %s\n", SP(req->outmn->name));
+            req->failed = 1;
+            continue;
+        }
+        gets = EUCA_APPEND_PTRARR(gets, &max_gets, req);
+    }
+    mido_batch_perform(gets, max_gets, 1);
+
+    for (int i = 0; i < max_mido_batch_requests; i++) {
+        req = mido_batch_requests[i];
+        if (!req->failed && req->outmn && (req->op != MIDO_BATCH_DELETE)) {
+            EUCA_FREE(req->outmn->jsonbuf);
+            req->outmn->jsonbuf = req->outhttp;
+            req->outhttp = NULL;
+            req->outmn->init = 1;
+            if (mido_update_midoname(req->outmn)) {
+                req->failed = 1;
             }
-            if (!rc) {
-                found = 1;
-                if (foundidx) {
-                    *foundidx = i;
-                }
+        }
+        if (req->failed) {
+            if ((req->op == MIDO_BATCH_POST) && req->outmn) {
+                mido_batch_uncache(req->outmn);
             }
+            ret++;
         }
+        mido_batch_request_free(req);
     }
-    if (found) {
-        ret = 0;
-    } else {
-        ret = 1;
-    }
+    EUCA_FREE(mido_batch_requests);
+    EUCA_FREE(gets);
+
+    batchtime = eucanetd_timer_usec(&tv);
+    LOGDEBUG("committed %d MidoNet API requests in %ld us (%d failed)\n", max_mido_batch_requests, batchtime, ret);
+    max_mido_batch_requests = 0;
     return (ret);
 }
 
 /**
- * Creates a new router route as specified in the argument. 
- *
- * @param rt [in] router or interest. rt has priority over router. If rt is NULL,
- * midocache lookup is performed based on router.
+ * Appends a request to the open batch.
+ * @param op [in] MIDO_BATCH_POST, MIDO_BATCH_PUT or MIDO_BATCH_DELETE
+ * @param url [in] target of the request.
+ * @param media_type [in] optional media type of the resource.
+ * @param payload [in] optional JSON payload. The request takes ownership of payload.
+ * @param outmn [in] optional midoname to be completed when the batch is committed.
+ * @return 0 on success. 1 otherwise.
+ */
+static int mido_batch_queue(int op, char *url, char *media_type, char *payload, midoname *outmn) {
+    mido_batch_request *req = NULL;
+
+    if (!url || !strlen(url)) {
+        LOGWARN("Invalid argument: cannot queue MidoNet API request without url\n");
+        EUCA_FREE(payload);
+        return (1);
+    }
+    req = EUCA_ZALLOC_C(1, sizeof (mido_batch_request));
+    req->op = op;
+    snprintf(req->url, EUCA_MAX_PATH, "%s", url);
+    if (media_type) {
+        req->media_type = strdup(media_type);
+    }
+    req->payload = payload;
+    req->outmn = outmn;
+    mido_batch_requests = EUCA_APPEND_PTRARR(mido_batch_requests, &max_mido_batch_requests, req);
+    return (0);
+}
+
+/**
+ * Removes a top level object that failed to be created in a batch from midocache,
+ * so that a subsequent create of the same object is not mistaken for a duplicate.
+ * @param mn [in] midoname of the object that failed to be created.
+ */
+static void mido_batch_uncache(midoname *mn) {
+    if (!mn->resource_type || !mn->name) {
+        return;
+    }
+    if (!strcmp(mn->resource_type, "chains")) {
+        midonet_api_cache_del_chain(mn);
+    } else if (!strcmp(mn->resource_type, "ip_addr_groups")) {
+        midonet_api_cache_del_ipaddrgroup(mn);
+    } else if (!strcmp(mn->resource_type, "bridges")) {
+        midonet_api_cache_del_bridge(mn);
+    } else if (!strcmp(mn->resource_type, "routers")) {
+        midonet_api_cache_del_router(mn);
+    } else if (!strcmp(mn->resource_type, "port_groups")) {
+        midonet_api_cache_del_portgroup(mn);
+    }
+}
+
+/**
+ * Releases the memory used by a batched request.
+ * @param req [in] request of interest.
+ */
+static void mido_batch_request_free(mido_batch_request *req) {
+    if (!req) {
+        return;
+    }
+    EUCA_FREE(req->media_type);
+    EUCA_FREE(req->payload);
+    EUCA_FREE(req->loc);
+    EUCA_FREE(req->outhttp);
+    EUCA_FREE(req->wparams.mem);
+    EUCA_FREE(req);
+}
+
+/**
+ * Prepares a pooled easy_handle to perform a batched request.
+ * @param req [in] request of interest.
+ * @param get [in] if set, retrieve the object created/updated by req instead
+ * of performing req.
+ * @return 0 on success. 1 otherwise.
+ */
+static int mido_batch_setup(mido_batch_request *req, int get) {
+    CURL *curl = NULL;
+    char hbuf[EUCA_MAX_PATH];
+
+    if (get) {
+        curl = mido_libcurl_get_gethandle(&libcurl_handles);
+    } else {
+        curl = mido_libcurl_get_handle(&libcurl_handles);
+    }
+    if (!curl) {
+        LOGWARN("failed to get a libcurl handle - unable to perform batched request\n");
+        return (1);
+    }
+    req->curl = curl;
+    req->headers = NULL;
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, (char *) req);
+
+    if (get) {
+        curl_easy_setopt(curl, CURLOPT_URL, (req->op == MIDO_BATCH_POST) ? req->loc : req->url);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *) &(req->wparams));
+        if (req->media_type && strlen(req->media_type)) {
+            snprintf(hbuf, EUCA_MAX_PATH, "accept: %s", req->media_type);
+            req->headers = curl_slist_append(req->headers, hbuf);
+        }
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req->headers);
+        return (0);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, req->url);
+    switch (req->op) {
+        case MIDO_BATCH_POST:
+            curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+            curl_easy_setopt(curl, CURLOPT_POST, 1L);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req->payload);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, strlen(req->payload));
+            curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_find_location);
+            curl_easy_setopt(curl, CURLOPT_HEADERDATA, &(req->loc));
+            break;
+        case MIDO_BATCH_PUT:
+            req->rparams.mem = req->payload;
+            req->rparams.size = strlen(req->payload) + 1;
+            curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+            curl_easy_setopt(curl, CURLOPT_PUT, 1L);
+            curl_easy_setopt(curl, CURLOPT_READFUNCTION, mem_reader);
+            curl_easy_setopt(curl, CURLOPT_READDATA, (void *) &(req->rparams));
+            curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (long) req->rparams.size);
+            req->headers = curl_slist_append(req->headers, "Expect:");
+            break;
+        case MIDO_BATCH_DELETE:
+        default:
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+            return (0);
+    }
+    if (req->media_type && strlen(req->media_type)) {
+        snprintf(hbuf, EUCA_MAX_PATH, "Content-Type: %s", req->media_type);
+    } else {
+        snprintf(hbuf, EUCA_MAX_PATH, "Content-Type: application/json");
+    }
+    req->headers = curl_slist_append(req->headers, hbuf);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req->headers);
+    return (0);
+}
+
+/**
+ * Collects the result of a completed batched request and returns its easy_handle
+ * to the pool.
+ * @param req [in] request of interest.
+ * @param curlret [in] libcurl result of the transfer.
+ * @param get [in] if set, req completed the retrieval of its object.
+ */
+static void mido_batch_done(mido_batch_request *req, CURLcode curlret, int get) {
+    long httpcode = 0L;
+    double xfertime = 0.0;
+    int op = get ? MIDO_BATCH_GET : req->op;
+    int ok = 0;
+
+    curl_easy_getinfo(req->curl, CURLINFO_RESPONSE_CODE, &httpcode);
+    curl_easy_getinfo(req->curl, CURLINFO_TOTAL_TIME, &xfertime);
+    if (curlret != CURLE_OK) {
+        LOGERROR("ERROR: batched request: %s\n", curl_easy_strerror(curlret));
+    }
+    switch (op) {
+        case MIDO_BATCH_GET:
+            ok = (httpcode == 200L) && req->wparams.mem && (req->wparams.size > 0);
+            http_gets++;
+            http_gets_time += xfertime * 1000000.0;
+            break;
+        case MIDO_BATCH_POST:
+            ok = (httpcode == 200L) || (httpcode == 201L);
+            http_posts++;
+            http_posts_time += xfertime * 1000000.0;
+            break;
+        case MIDO_BATCH_PUT:
+            ok = (httpcode == 200L) || (httpcode == 204L);
+            http_puts++;
+            http_puts_time += xfertime * 1000000.0;
+            break;
+        case MIDO_BATCH_DELETE:
+        default:
+            ok = (httpcode == 200L) || (httpcode == 204L);
+            http_deletes++;
+            http_deletes_time += xfertime * 1000000.0;
+            break;
+    }
+    if ((curlret != CURLE_OK) || !ok) {
+        LOGWARN("batched request http code: %ld\n", httpcode);
+        LOGINFO("\turl %s payload %s\n", (get && req->loc) ? req->loc : req->url, SP(req->payload));
+        req->failed = 1;
+    } else if (get) {
+        req->outhttp = realloc(req->wparams.mem, req->wparams.size + 1);
+        if (req->outhttp == NULL) {
+            req->outhttp = req->wparams.mem;
+        }
+        req->wparams.mem = NULL;
+    } else {
+        midonet_api_system_changed = 1;
+    }
+
+    curl_multi_remove_handle(libcurl_handles.multi, req->curl);
+    curl_slist_free_all(req->headers);
+    req->headers = NULL;
+    if (get) {
+        mido_libcurl_release_gethandle(&libcurl_handles, req->curl);
+    } else {
+        mido_libcurl_release_handle(&libcurl_handles, req->curl);
+    }
+    req->curl = NULL;
+}
+
+/**
+ * Performs the given requests concurrently using libcurl multi interface. At most
+ * MIDONET_API_BATCH_CONNECTIONS requests are in flight at any time; connections
+ * are cached by the multi handle and reused by subsequent requests.
+ * @param reqs [in] requests to perform.
+ * @param max_reqs [in] number of requests.
+ * @param get [in] if set, retrieve the objects created/updated by reqs.
+ * @return number of failed requests.
+ */
+static int mido_batch_perform(mido_batch_request **reqs, int max_reqs, int get) {
+    CURLM *multi = NULL;
+    CURLMsg *msg = NULL;
+    mido_batch_request *req = NULL;
+    int next = 0, inflight = 0, running = 0, pending = 0, ret = 0;
+
+    if (max_reqs == 0) {
+        return (0);
+    }
+    if (!libcurl_handles.multi) {
+        libcurl_handles.multi = curl_multi_init();
+    }
+    multi = libcurl_handles.multi;
+    if (!multi) {
+        LOGERROR("Unable to get libcurl multi_handle\n");
+        for (int i = 0; i < max_reqs; i++) {
+            reqs[i]->failed = 1;
+        }
+        return (max_reqs);
+    }
+
+    while ((next < max_reqs) || (inflight > 0)) {
+        while ((next < max_reqs) && (inflight < MIDONET_API_BATCH_CONNECTIONS)) {
+            req = reqs[next++];
+            if (mido_batch_setup(req, get)) {
+                req->failed = 1;
+                continue;
+            }
+            curl_multi_add_handle(multi, req->curl);
+            inflight++;
+        }
+
+        curl_multi_perform(multi, &running);
+        while ((msg = curl_multi_info_read(multi, &pending)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            req = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &req);
+            if (req) {
+                // msg is invalidated once its handle is removed
+                mido_batch_done(req, msg->data.result, get);
+                inflight--;
+            }
+        }
+
+        if ((running > 0) && (inflight > 0)) {
+#if LIBCURL_VERSION_NUM >= 0x071c00
+            curl_multi_wait(multi, NULL, 0, 1000, NULL);
+#else
+            fd_set rfds, wfds, efds;
+            int maxfd = -1;
+            long timeout = -1;
+            struct timeval to = { 1, 0 };
+
+            FD_ZERO(&rfds);
+            FD_ZERO(&wfds);
+            FD_ZERO(&efds);
+            curl_multi_timeout(multi, &timeout);
+            if ((timeout >= 0) && (timeout < 1000)) {
+                to.tv_sec = 0;
+                to.tv_usec = timeout * 1000;
+            }
+            curl_multi_fdset(multi, &rfds, &wfds, &efds, &maxfd);
+            if (maxfd >= 0) {
+                select(maxfd + 1, &rfds, &wfds, &efds, &to);
+            } else {
+                usleep(100000);
+            }
+#endif /* LIBCURL_VERSION_NUM >= 0x071c00 */
+        }
+    }
+
+    for (int i = 0; i < max_reqs; i++) {
+        if (reqs[i]->failed) {
+            ret++;
+        }
+    }
+    return (ret);
+}
+
+/**
+ * Searches for a mido router route specified in the arguments from a list (also
+ * specified in the arguments). 
+ *
+ * @param routes [in] list of routes to look for a matching route entry.
+ * @param max_routes [in] number of routes in the list.
+ * @param rport [in] router port to be routed.
+ * @param src [in] source subnet.
+ * @param src_slashnet [in] source slash net.
+ * @param dst [in] destination subnet.
+ * @param dst_slashnet [in] destination slash net.
+ * @param next_hop_ip [in] next hop.
+ * @param weight [in] route weight.
+ * @param foundidx [out] index at which the route was found. -1 if the route was not found.
+ * @return 0 if the route was found. 1 otherwise.
+ */
+int mido_find_route_from_list(midoname **routes, int max_routes, midoname *rport,
+        char *src, char *src_slashnet, char *dst, char *dst_slashnet, char *next_hop_ip,
+        char *weight, int *foundidx) {
+    int rc = 0, found = 0, ret = 0;
+    int i = 0;
+
+    if ((routes == NULL) || (max_routes == 0)) {
+        return (1);
+    }
+
+    found = 0;
+    for (i = 0; i < max_routes && !found; i++) {
+        if ((routes[i] == NULL) || (routes[i]->init == 0)) {
+            continue;
+        }
+        if (!next_hop_ip || strcmp(next_hop_ip, "UNSET")) {
+            rc = 1;
+            if (routes[i]->route) {
+                if ((src && routes[i]->route->srcnet && !strcmp(src, routes[i]->route->srcnet)) &&
+                        (src_slashnet && routes[i]->route->srclen && !strcmp(src_slashnet, routes[i]->route->srclen)) &&
+                        (dst && routes[i]->route->dstnet && !strcmp(dst, routes[i]->route->dstnet)) &&
+                        (dst_slashnet && routes[i]->route->dstlen && !strcmp(dst_slashnet, routes[i]->route->dstlen)) &&
+                        (!strcmp("Normal", routes[i]->route->type)) &&
+                        (rport->uuid && routes[i]->route->nexthopport && !strcmp(rport->uuid, routes[i]->route->nexthopport)) &&
+                        (weight && routes[i]->route->weight && !strcmp(weight, routes[i]->route->weight)) &&
+                        (next_hop_ip && routes[i]->route->nexthopgateway && !strcmp(next_hop_ip, routes[i]->route->nexthopgateway))) {
+                    rc = 0;
+                }
+            }
+            if (!rc) {
+                found = 1;
+                if (foundidx) {
+                    *foundidx = i;
+                }
+            }
+        } else {
+            rc = mido_cmp_midoname_to_input(routes[i], "srcNetworkAddr", src, "srcNetworkLength", src_slashnet, "dstNetworkAddr", dst, "dstNetworkLength", dst_slashnet,
+                    "type", "Normal", "nextHopPort", rport->uuid, "weight", weight, NULL);
+            rc = 1;
+            if (routes[i]->route) {
+                if ((src && routes[i]->route->srcnet && !strcmp(src, routes[i]->route->srcnet)) &&
+                        (src_slashnet && routes[i]->route->srclen && !strcmp(src_slashnet, routes[i]->route->srclen)) &&
+                        (dst && routes[i]->route->dstnet && !strcmp(dst, routes[i]->route->dstnet)) &&
+                        (dst_slashnet && routes[i]->route->dstlen && !strcmp(dst_slashnet, routes[i]->route->dstlen)) &&
+                        (!strcmp("Normal", routes[i]->route->type)) &&
+                        (rport->uuid && routes[i]->route->nexthopport && !strcmp(rport->uuid, routes[i]->route->nexthopport)) &&
+                        (weight && routes[i]->route->weight && !strcmp(weight, routes[i]->route->weight))) {
+                    rc = 0;
+                }
+            }
+            if (!rc) {
+                found = 1;
+                if (foundidx) {
+                    *foundidx = i;
+                }
+            }
+        }
+    }
+    if (found) {
+        ret = 0;
+    } else {
+        ret = 1;
+    }
+    return (ret);
+}
+
+/**
+ * Creates a new router route as specified in the argument. 
+ *
+ * @param rt [in] router or interest. rt has priority over router. If rt is NULL,
+ * midocache lookup is performed based on router.
  * @param router [in] router of interest.
  * @param rport [in] router port where matching packets will be routed.
  * @param src [in] source subnet.
@@ -5253,6 +6020,7 @@ int mido_create_route(midonet_api_router *rt, midoname *router, midoname *rport,
         } else if (rc < 0) {
             ret = 0;
         } else {
+            rt->dirty = 1;
             ret = 1;
         }
         mido_free_midoname(&myname);
@@ -6087,23 +6855,11 @@ int mido_get_routers(char *tenant, midoname ***outnames, int *outnames_max) {
  * @return pointer to the data structure that represents the router, when found. NULL otherwise.
  */
 midonet_api_router *mido_get_router(char *name) {
+    int pos = 0;
     if (midocache != NULL) {
-        if (midocache->sorted_routers == 0) {
-            qsort(midocache->routers, midocache->max_routers,
-                    sizeof (midonet_api_router *), compare_midonet_api_router);
-            midocache->sorted_routers = 1;
-        }
-        midoname tmp;
-        tmp.name = strdup(name);
-        midonet_api_router router;
-        router.obj = &tmp;
-        midonet_api_router *prouter = &router;
-        midonet_api_router **res = (midonet_api_router **) bsearch(&prouter,
-                midocache->routers, midocache->max_routers,
-                sizeof (midonet_api_router *), compare_midonet_api_router);
-        EUCA_FREE(tmp.name);
-        if (res) {
-            return (*res);
+        pos = midonet_api_index_find(&(midocache->routers_byname), name, midocache->routers, midocache->max_routers, midonet_api_router_name);
+        if (pos >= 0) {
+            return (midocache->routers[pos]);
         }
     }
     return (NULL);
@@ -6148,26 +6904,13 @@ int mido_get_bridges(char *tenant, midoname ***outnames, int *outnames_max) {
  * @return pointer to the data structure that represents the bridge, when found. NULL otherwise.
  */
 midonet_api_bridge *mido_get_bridge(char *name) {
+    int pos = 0;
     if (midocache != NULL) {
-        if (midocache->sorted_bridges == 0) {
-            qsort(midocache->bridges, midocache->max_bridges,
-                    sizeof (midonet_api_bridge *), compare_midonet_api_bridge);
-            midocache->sorted_bridges = 1;
-        }
-        midoname tmp;
-        tmp.name = strdup(name);
-        midonet_api_bridge bridge;
-        bridge.obj = &tmp;
-        midonet_api_bridge *pbridge = &bridge;
-        midonet_api_bridge **res = (midonet_api_bridge **) bsearch(&pbridge,
-                midocache->bridges, midocache->max_bridges,
-                sizeof (midonet_api_bridge *), compare_midonet_api_bridge);
-        EUCA_FREE(tmp.name);
-        if (res) {
-            return (*res);
+        pos = midonet_api_index_find(&(midocache->bridges_byname), name, midocache->bridges, midocache->max_bridges, midonet_api_bridge_name);
+        if (pos >= 0) {
+            return (midocache->bridges[pos]);
         }
     }
-
     return (NULL);
 }
 
@@ -6260,23 +7003,11 @@ int mido_get_chains_with_prefix(char *tenant, char *prefix, midoname ***outnames
  * @return pointer to the data structure that represents the chain, when found. NULL otherwise.
  */
 midonet_api_chain *mido_get_chain(char *name) {
+    int pos = 0;
     if (midocache != NULL) {
-        if (midocache->sorted_chains == 0) {
-            qsort(midocache->chains, midocache->max_chains,
-                    sizeof (midonet_api_chain *), compare_midonet_api_chain);
-            midocache->sorted_chains = 1;
-        }
-        midoname tmp;
-        tmp.name = strdup(name);
-        midonet_api_chain ch;
-        ch.obj = &tmp;
-        midonet_api_chain *pch = &ch;
-        midonet_api_chain **res = (midonet_api_chain **) bsearch(&pch,
-                midocache->chains, midocache->max_chains,
-                sizeof (midonet_api_chain *), compare_midonet_api_chain);
-        EUCA_FREE(tmp.name);
-        if (res) {
-            return (*res);
+        pos = midonet_api_index_find(&(midocache->chains_byname), name, midocache->chains, midocache->max_chains, midonet_api_chain_name);
+        if (pos >= 0) {
+            return (midocache->chains[pos]);
         }
     }
     return (NULL);
@@ -6321,32 +7052,33 @@ int mido_get_resources(midoname *parents, int max_parents, char *tenant, char *r
 
     rc = midonet_http_get(url, apistr, &payload);
     if (!rc) {
-        struct json_object *jobj = NULL, *resource = NULL;
+        // the response is split into objects in place - each midoname gets a copy
+        // of its own object, and only the fields midoname needs are extracted
+        const char *jend = payload + strlen(payload), *jarr = payload, *p = NULL;
+        const char *resource = NULL, *resourceend = NULL;
+        int count = 0;
 
-        jobj = json_tokener_parse(payload);
-        if (!jobj) {
+        if (mido_json_array_begin(&jarr, jend)) {
             LOGWARN("cannot tokenize midonet response: check midonet health\n");
         } else {
-            if (json_object_is_type(jobj, json_type_array)) {
-                names_max = 0;
-                midoname_list_get_midonames(midocache_midos, &names, json_object_array_length(jobj));
+            p = jarr;
+            while (!mido_json_array_next(&p, jend, &resource, &resourceend)) {
+                count++;
+            }
+            names_max = 0;
+            midoname_list_get_midonames(midocache_midos, &names, count);
 
-                for (i = 0; i < json_object_array_length(jobj); i++) {
-                    resource = json_object_array_get_idx(jobj, i);
-                    if (resource) {
-                        names[names_max]->tenant = strdup(tenant);
-                        names[names_max]->jsonbuf = strdup(json_object_to_json_string(resource));
-                        names[names_max]->resource_type = strdup(resource_type);
-                        names[names_max]->init = 1;
-                        if (mtype && strlen(mtype)) {
-                            names[names_max]->media_type = strdup(mtype);
-                        }
-                        mido_update_midoname(names[names_max]);
-                        names_max++;
-                    }
+            for (p = jarr; (names_max < count) && !mido_json_array_next(&p, jend, &resource, &resourceend);) {
+                names[names_max]->tenant = strdup(tenant);
+                names[names_max]->jsonbuf = strndup(resource, resourceend - resource);
+                names[names_max]->resource_type = strdup(resource_type);
+                names[names_max]->init = 1;
+                if (mtype && strlen(mtype)) {
+                    names[names_max]->media_type = strdup(mtype);
                 }
+                mido_update_midoname(names[names_max]);
+                names_max++;
             }
-            json_object_put(jobj);
         }
         EUCA_FREE(payload);
     }
@@ -6388,7 +7120,8 @@ int mido_refresh_resource(midoname *resc) {
     if (!rc) {
         if (payload && (strlen(payload))) {
             EUCA_FREE(resc->jsonbuf);
-            resc->jsonbuf = strdup(payload);
+            resc->jsonbuf = payload;
+            payload = NULL;
             resc->init = 1;
             rc = mido_update_midoname(resc);
         }
@@ -7099,6 +7832,14 @@ int midonet_api_cache_flush(midonet_api_cache *cache) {
     }
     
     EUCA_FREE(cache->ports);
+    midonet_api_index_clear(&(cache->ports_byuuid));
+    midonet_api_index_clear(&(cache->routers_byname));
+    midonet_api_index_clear(&(cache->bridges_byname));
+    midonet_api_index_clear(&(cache->chains_byname));
+    midonet_api_index_clear(&(cache->hosts_byname));
+    midonet_api_index_clear(&(cache->hosts_byuuid));
+    midonet_api_index_clear(&(cache->ipaddrgroups_byname));
+    midonet_api_index_clear(&(cache->portgroups_byname));
 
     for (i = 0; i < cache->max_routers; i++) {
         midonet_api_router_free(cache->routers[i]);
@@ -7807,6 +8548,9 @@ int midonet_api_cache_refresh_hosts(midonet_api_cache *cache) {
         midonet_api_host_free(cache->hosts[i]);
     }
     EUCA_FREE(cache->hosts);
+    cache->max_hosts = 0;
+    midonet_api_index_clear(&(cache->hosts_byname));
+    midonet_api_index_clear(&(cache->hosts_byuuid));
 
     // get all hosts
     // disable midocache (load all hosts from MidoNet
@@ -7840,7 +8584,9 @@ int midonet_api_cache_refresh_hosts(midonet_api_cache *cache) {
 /**
  * Clear the current midocache and populates the midonet_api_cache data structure.
  * @param refreshmode [in] specify whether to populate hosts (MIDO_CACHE_REFRESH_ALL)
- * or not (MIDO_CACHE_REFRESH_NOHOSTS).
+ * or not (MIDO_CACHE_REFRESH_NOHOSTS). MIDO_CACHE_REFRESH_INCREMENTAL keeps the
+ * current midocache and only reloads what changed (see midonet_api_cache_refresh_incremental()),
+ * unless a full refresh is due.
  * @return 0 on success. 1 on any failure.
  */
 int midonet_api_cache_refresh_v_threads(enum mido_cache_refresh_mode_t refreshmode) {
@@ -7856,6 +8602,15 @@ int midonet_api_cache_refresh_v_threads(enum mido_cache_refresh_mode_t refreshmo
     pthread_t pt[MIDO_CACHE_THREAD_END];
     pthread_attr_t ptattr;
 
+    if (refreshmode == MIDO_CACHE_REFRESH_INCREMENTAL) {
+        if ((midocache != NULL) && !midocache_full_refresh_req && (midocache_full_refresh_interval > 0) &&
+                ((time(NULL) - midocache_full_refresh_ts) < midocache_full_refresh_interval) &&
+                ((midocache_midos == NULL) || (midocache_midos->released <= MIDONAME_LIST_RELEASES_B4INVALIDATE))) {
+            return (midonet_api_cache_refresh_incremental());
+        }
+        refreshmode = MIDO_CACHE_REFRESH_ALL;
+    }
+
     midonet_api_cleanup();
     midonet_api_init();
 
@@ -8061,43 +8816,419 @@ int midonet_api_cache_refresh_v_threads(enum mido_cache_refresh_mode_t refreshmo
 
     // Enable midocache
     midocache = cache;
+    midocache_full_refresh_ts = time(NULL);
+    midocache_full_refresh_req = 0;
     //mido_info_midocache();
     return (ret);
 }
 
 /**
- * Populates the midonet_api_cache iphostmap table. Existing iphostmap is flushed.
- * The list of hosts is always loaded from MidoNet (regardless of midocache state).
- * @param cache [in] midonet_api_cache structure that holds the iphostmap of interest.
+ * Brings the current midocache in sync with MidoNet without reloading all of it.
+ * Routers, bridges, chains, ip-address-groups, and port-groups are listed from
+ * MidoNet. The children (ports, routes, rules, dhcps, ips, etc) of an object are
+ * only reloaded if the object is new, if its representation in MidoNet changed,
+ * or if eucanetd changed (or failed to change) its children since they were loaded.
+ * Objects no longer in MidoNet are dropped. Hosts and tunnel-zones are always reloaded.
  * @return 0 on success. 1 on any failure.
  */
-int midonet_api_cache_iphostmap_populate(midonet_api_cache *cache) {
+static int midonet_api_cache_refresh_incremental(void) {
     int rc = 0;
-    midonet_api_cache *midocache_bak = NULL;
-    
-    if (!cache) {
-        cache = midonet_api_cache_get();
+    int pos = 0;
+    int reused = 0;
+    int dropped = 0;
+    midonet_api_cache *oldcache = midocache;
+    midonet_api_cache *cache = NULL;
+    midonet_api_cache *fetch = NULL;
+    midoname **rtnames = NULL;
+    int max_rtnames = 0;
+    midoname **brnames = NULL;
+    int max_brnames = 0;
+    midoname **chnames = NULL;
+    int max_chnames = 0;
+    midoname **ignames = NULL;
+    int max_ignames = 0;
+    midoname **pgnames = NULL;
+    int max_pgnames = 0;
+    struct timeval tv = {0};
+    mido_cache_main_thread_params param[MIDO_CACHE_THREAD_END];
+    pthread_t pt[MIDO_CACHE_THREAD_END];
+    pthread_attr_t ptattr;
+
+    midonet_api_cleanup();
+    midonet_api_init();
+
+    rc = mido_check_state();
+    if (rc) {
+        LOGERROR("Unable to access midonet-api.\n");
+        return (1);
     }
 
-    // Disable midocache
-    midocache_bak = midocache;
+    eucanetd_timer_usec(&tv);
+
+    // disable midocache (list all objects from MidoNet)
     midocache = NULL;
-    
-    rc = midonet_api_cache_refresh_hosts(cache);
-    if (rc != 0) {
-        LOGWARN("Unable to load hosts information from MidoNet.\n");
-        return (1);
+    rc = mido_get_routers(VPCMIDO_TENANT, &rtnames, &max_rtnames);
+    if (!rc) {
+        rc = mido_get_bridges(VPCMIDO_TENANT, &brnames, &max_brnames);
     }
-    midonet_api_iphostmap *iphm = &(cache->iphostmap);
-    if (iphm->entries) {
-        EUCA_FREE(iphm->entries);
-        iphm->entries = NULL;
+    if (!rc) {
+        rc = mido_get_chains(VPCMIDO_TENANT, &chnames, &max_chnames);
     }
-    iphm->max_entries = 0;
-    LOGDEBUG("\tpopulating ip-to-midohost map table.\n");
-    
-    for (int i = 0; i < cache->max_hosts; i++) {
-        iphm->entries = EUCA_REALLOC_C(iphm->entries, iphm->max_entries + cache->hosts[i]->max_addresses,
+    if (!rc) {
+        rc = mido_get_ipaddrgroups(VPCMIDO_TENANT, &ignames, &max_ignames);
+    }
+    if (!rc) {
+        rc = mido_get_portgroups(VPCMIDO_TENANT, &pgnames, &max_pgnames);
+    }
+    if (rc) {
+        LOGWARN("Failed to list mido objects - reloading midocache\n");
+        EUCA_FREE(rtnames);
+        EUCA_FREE(brnames);
+        EUCA_FREE(chnames);
+        EUCA_FREE(ignames);
+        EUCA_FREE(pgnames);
+        midocache = oldcache;
+        return (midonet_api_cache_refresh_v_threads(MIDO_CACHE_REFRESH_ALL));
+    }
+    LOGTRACE("\tlisted in %.2f\n", eucanetd_timer_usec(&tv) / 1000.0);
+
+    // objects that can be reused are moved from oldcache to cache; objects that
+    // need their children reloaded are also referenced in fetch
+    cache = EUCA_ZALLOC_C(1, sizeof (midonet_api_cache));
+    fetch = EUCA_ZALLOC_C(1, sizeof (midonet_api_cache));
+
+    if (max_rtnames) {
+        cache->routers = EUCA_ZALLOC_C(max_rtnames, sizeof (midonet_api_router *));
+        for (int i = 0; i < max_rtnames; i++) {
+            midonet_api_router *router = NULL;
+            pos = midonet_api_index_find(&(oldcache->routers_byname), rtnames[i]->name, oldcache->routers, oldcache->max_routers, midonet_api_router_name);
+            if ((pos >= 0) && oldcache->routers[pos] &&
+                    midonet_api_cache_reusable(oldcache->routers[pos]->obj, oldcache->routers[pos]->dirty, rtnames[i])) {
+                router = oldcache->routers[pos];
+                oldcache->routers[pos] = NULL;
+                reused++;
+                dropped++;
+            } else {
+                router = EUCA_ZALLOC_C(1, sizeof (midonet_api_router));
+                router->obj = rtnames[i];
+                fetch->routers = EUCA_APPEND_PTRARR(fetch->routers, &(fetch->max_routers), router);
+            }
+            cache->routers[i] = router;
+        }
+        cache->max_routers = max_rtnames;
+    }
+
+    if (max_brnames) {
+        cache->bridges = EUCA_ZALLOC_C(max_brnames, sizeof (midonet_api_bridge *));
+        for (int i = 0; i < max_brnames; i++) {
+            midonet_api_bridge *bridge = NULL;
+            pos = midonet_api_index_find(&(oldcache->bridges_byname), brnames[i]->name, oldcache->bridges, oldcache->max_bridges, midonet_api_bridge_name);
+            if ((pos >= 0) && oldcache->bridges[pos] &&
+                    midonet_api_cache_reusable(oldcache->bridges[pos]->obj, midonet_api_bridge_dirty(oldcache->bridges[pos]), brnames[i])) {
+                bridge = oldcache->bridges[pos];
+                oldcache->bridges[pos] = NULL;
+                reused++;
+                dropped++;
+            } else {
+                bridge = EUCA_ZALLOC_C(1, sizeof (midonet_api_bridge));
+                bridge->obj = brnames[i];
+                fetch->bridges = EUCA_APPEND_PTRARR(fetch->bridges, &(fetch->max_bridges), bridge);
+            }
+            cache->bridges[i] = bridge;
+        }
+        cache->max_bridges = max_brnames;
+    }
+
+    if (max_chnames) {
+        cache->chains = EUCA_ZALLOC_C(max_chnames, sizeof (midonet_api_chain *));
+        for (int i = 0; i < max_chnames; i++) {
+            midonet_api_chain *chain = NULL;
+            pos = midonet_api_index_find(&(oldcache->chains_byname), chnames[i]->name, oldcache->chains, oldcache->max_chains, midonet_api_chain_name);
+            if ((pos >= 0) && oldcache->chains[pos] &&
+                    midonet_api_cache_reusable(oldcache->chains[pos]->obj, oldcache->chains[pos]->dirty, chnames[i])) {
+                chain = oldcache->chains[pos];
+                oldcache->chains[pos] = NULL;
+                reused++;
+                dropped++;
+            } else {
+                chain = EUCA_ZALLOC_C(1, sizeof (midonet_api_chain));
+                chain->obj = chnames[i];
+                fetch->chains = EUCA_APPEND_PTRARR(fetch->chains, &(fetch->max_chains), chain);
+            }
+            cache->chains[i] = chain;
+        }
+        cache->max_chains = max_chnames;
+    }
+
+    if (max_ignames) {
+        cache->ipaddrgroups = EUCA_ZALLOC_C(max_ignames, sizeof (midonet_api_ipaddrgroup *));
+        for (int i = 0; i < max_ignames; i++) {
+            midonet_api_ipaddrgroup *ipaddrgroup = NULL;
+            pos = midonet_api_index_find(&(oldcache->ipaddrgroups_byname), ignames[i]->name, oldcache->ipaddrgroups, oldcache->max_ipaddrgroups, midonet_api_ipaddrgroup_name);
+            if ((pos >= 0) && oldcache->ipaddrgroups[pos] &&
+                    midonet_api_cache_reusable(oldcache->ipaddrgroups[pos]->obj, oldcache->ipaddrgroups[pos]->dirty, ignames[i])) {
+                ipaddrgroup = oldcache->ipaddrgroups[pos];
+                oldcache->ipaddrgroups[pos] = NULL;
+                reused++;
+                dropped++;
+            } else {
+                ipaddrgroup = EUCA_ZALLOC_C(1, sizeof (midonet_api_ipaddrgroup));
+                ipaddrgroup->obj = ignames[i];
+                fetch->ipaddrgroups = EUCA_APPEND_PTRARR(fetch->ipaddrgroups, &(fetch->max_ipaddrgroups), ipaddrgroup);
+            }
+            cache->ipaddrgroups[i] = ipaddrgroup;
+        }
+        cache->max_ipaddrgroups = max_ignames;
+    }
+
+    if (max_pgnames) {
+        cache->portgroups = EUCA_ZALLOC_C(max_pgnames, sizeof (midonet_api_portgroup *));
+        for (int i = 0; i < max_pgnames; i++) {
+            midonet_api_portgroup *portgroup = NULL;
+            pos = midonet_api_index_find(&(oldcache->portgroups_byname), pgnames[i]->name, oldcache->portgroups, oldcache->max_portgroups, midonet_api_portgroup_name);
+            if ((pos >= 0) && oldcache->portgroups[pos] &&
+                    midonet_api_cache_reusable(oldcache->portgroups[pos]->obj, oldcache->portgroups[pos]->dirty, pgnames[i])) {
+                portgroup = oldcache->portgroups[pos];
+                oldcache->portgroups[pos] = NULL;
+                reused++;
+                dropped++;
+            } else {
+                portgroup = EUCA_ZALLOC_C(1, sizeof (midonet_api_portgroup));
+                portgroup->obj = pgnames[i];
+                fetch->portgroups = EUCA_APPEND_PTRARR(fetch->portgroups, &(fetch->max_portgroups), portgroup);
+            }
+            cache->portgroups[i] = portgroup;
+        }
+        cache->max_portgroups = max_pgnames;
+    }
+    EUCA_FREE(rtnames);
+    EUCA_FREE(brnames);
+    EUCA_FREE(chnames);
+    EUCA_FREE(ignames);
+    EUCA_FREE(pgnames);
+
+    LOGDEBUG("\treusing %d cached objects, reloading %d routers %d bridges %d chains %d ipags %d pgs\n", reused,
+            fetch->max_routers, fetch->max_bridges, fetch->max_chains, fetch->max_ipaddrgroups, fetch->max_portgroups);
+
+    pthread_attr_init(&ptattr);
+    pthread_attr_setdetachstate(&ptattr, PTHREAD_CREATE_JOINABLE);
+
+    snprintf(param[MIDO_CACHE_THREAD_ROUTER].name, MIDO_CACHE_THREAD_NAME_LEN, "router");
+    param[MIDO_CACHE_THREAD_ROUTER].n = fetch->max_routers;
+    param[MIDO_CACHE_THREAD_ROUTER].get_from_mido = midonet_api_cache_refresh_routerroutes;
+    param[MIDO_CACHE_THREAD_ROUTER].cache = fetch;
+    pthread_create(&pt[MIDO_CACHE_THREAD_ROUTER], &ptattr, midonet_api_cache_refresh_objects_main_thread,
+            (void *) &param[MIDO_CACHE_THREAD_ROUTER]);
+
+    snprintf(param[MIDO_CACHE_THREAD_BRIDGE].name, MIDO_CACHE_THREAD_NAME_LEN, "bridge");
+    param[MIDO_CACHE_THREAD_BRIDGE].n = fetch->max_bridges;
+    param[MIDO_CACHE_THREAD_BRIDGE].get_from_mido = midonet_api_cache_refresh_bridgeobjects;
+    param[MIDO_CACHE_THREAD_BRIDGE].cache = fetch;
+    pthread_create(&pt[MIDO_CACHE_THREAD_BRIDGE], &ptattr, midonet_api_cache_refresh_objects_main_thread,
+            (void *) &param[MIDO_CACHE_THREAD_BRIDGE]);
+
+    snprintf(param[MIDO_CACHE_THREAD_CHAIN].name, MIDO_CACHE_THREAD_NAME_LEN, "chain");
+    param[MIDO_CACHE_THREAD_CHAIN].n = fetch->max_chains;
+    param[MIDO_CACHE_THREAD_CHAIN].get_from_mido = midonet_api_cache_refresh_chainrules;
+    param[MIDO_CACHE_THREAD_CHAIN].cache = fetch;
+    pthread_create(&pt[MIDO_CACHE_THREAD_CHAIN], &ptattr, midonet_api_cache_refresh_objects_main_thread,
+            (void *) &param[MIDO_CACHE_THREAD_CHAIN]);
+
+    snprintf(param[MIDO_CACHE_THREAD_IPAG].name, MIDO_CACHE_THREAD_NAME_LEN, "ipag");
+    param[MIDO_CACHE_THREAD_IPAG].n = fetch->max_ipaddrgroups;
+    param[MIDO_CACHE_THREAD_IPAG].get_from_mido = midonet_api_cache_refresh_ipagips;
+    param[MIDO_CACHE_THREAD_IPAG].cache = fetch;
+    pthread_create(&pt[MIDO_CACHE_THREAD_IPAG], &ptattr, midonet_api_cache_refresh_objects_main_thread,
+            (void *) &param[MIDO_CACHE_THREAD_IPAG]);
+
+    for (int i = 0; i < fetch->max_portgroups; i++) {
+        midonet_api_portgroup *portgroup = fetch->portgroups[i];
+        rc = mido_get_portgroup_ports(portgroup->obj, &(portgroup->ports), &(portgroup->max_ports));
+        if (rc) {
+            LOGWARN("\tFailed to retrieve %s ports\n", portgroup->obj->name);
+        }
+    }
+
+    midonet_api_cache_refresh_tunnelzones(cache);
+    rc = midonet_api_cache_iphostmap_populate(cache);
+    if (rc) {
+        LOGWARN("failed to populate mido ip-host map\n");
+    }
+
+    for (int i = 0; i < MIDO_CACHE_THREAD_END; i++) {
+        pthread_join(pt[i], NULL);
+    }
+    pthread_attr_destroy(&ptattr);
+
+    // rebuild the list of all ports from router and bridge ports
+    for (int i = 0; i < cache->max_routers; i++) {
+        midonet_api_router *router = cache->routers[i];
+        for (int j = 0; j < router->max_ports; j++) {
+            if (router->ports[j]) {
+                cache->ports = EUCA_APPEND_PTRARR(cache->ports, &(cache->max_ports), router->ports[j]);
+            }
+        }
+    }
+    for (int i = 0; i < cache->max_bridges; i++) {
+        midonet_api_bridge *bridge = cache->bridges[i];
+        for (int j = 0; j < bridge->max_ports; j++) {
+            if (bridge->ports[j]) {
+                cache->ports = EUCA_APPEND_PTRARR(cache->ports, &(cache->max_ports), bridge->ports[j]);
+            }
+        }
+    }
+
+    // objects left in oldcache are no longer needed - their midonames are released with midocache_midos
+    dropped += midonet_api_cache_count_midos(oldcache);
+    midonet_api_cache_flush(oldcache);
+    EUCA_FREE(fetch->ports);
+    EUCA_FREE(fetch->routers);
+    EUCA_FREE(fetch->bridges);
+    EUCA_FREE(fetch->chains);
+    EUCA_FREE(fetch->ipaddrgroups);
+    EUCA_FREE(fetch->portgroups);
+    EUCA_FREE(fetch);
+
+    // Enable midocache
+    midocache = cache;
+    if (midocache_midos) {
+        midocache_midos->released += dropped;
+    }
+    LOGTRACE("\tincremental refresh in %.2f\n", eucanetd_timer_usec(&tv) / 1000.0);
+    return (0);
+}
+
+/**
+ * Checks whether a cached object (and its children) can be kept in midocache.
+ * @param cached [in] cached object of interest.
+ * @param dirty [in] set if eucanetd changed the children of the cached object.
+ * @param obj [in] the same object as just retrieved from MidoNet.
+ * @return 1 if cached is up to date. 0 otherwise.
+ */
+static int midonet_api_cache_reusable(midoname *cached, int dirty, midoname *obj) {
+    if (dirty || !cached || !obj || !cached->uuid || !obj->uuid || !cached->jsonbuf || !obj->jsonbuf) {
+        return (0);
+    }
+    if (strcmp(cached->uuid, obj->uuid) || strcmp(cached->jsonbuf, obj->jsonbuf)) {
+        return (0);
+    }
+    return (1);
+}
+
+/**
+ * Checks whether eucanetd changed the children of a bridge, including dhcp hosts.
+ * @param bridge [in] bridge of interest.
+ * @return 1 if the bridge or any of its dhcps is dirty. 0 otherwise.
+ */
+static int midonet_api_bridge_dirty(midonet_api_bridge *bridge) {
+    if (bridge->dirty) {
+        return (1);
+    }
+    for (int i = 0; i < bridge->max_dhcps; i++) {
+        if (bridge->dhcps[i] && bridge->dhcps[i]->dirty) {
+            return (1);
+        }
+    }
+    return (0);
+}
+
+/**
+ * Counts the midonames held by the objects of a midonet_api_cache (deleted entries
+ * included).
+ * @param cache [in] midonet_api_cache of interest.
+ * @return number of midonames referenced in cache.
+ */
+static int midonet_api_cache_count_midos(midonet_api_cache *cache) {
+    int count = 0;
+    for (int i = 0; i < cache->max_routers; i++) {
+        midonet_api_router *router = cache->routers[i];
+        if (router) {
+            count += 1 + router->max_ports + router->max_routes;
+        }
+    }
+    for (int i = 0; i < cache->max_bridges; i++) {
+        midonet_api_bridge *bridge = cache->bridges[i];
+        if (bridge) {
+            count += 1 + bridge->max_ports + bridge->max_ip4mac_pairs + bridge->max_macport_pairs;
+            for (int j = 0; j < bridge->max_dhcps; j++) {
+                if (bridge->dhcps[j]) {
+                    count += 1 + bridge->dhcps[j]->max_dhcphosts;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < cache->max_chains; i++) {
+        if (cache->chains[i]) {
+            count += 1 + cache->chains[i]->max_rules;
+        }
+    }
+    for (int i = 0; i < cache->max_ipaddrgroups; i++) {
+        if (cache->ipaddrgroups[i]) {
+            count += 1 + cache->ipaddrgroups[i]->max_ips;
+        }
+    }
+    for (int i = 0; i < cache->max_portgroups; i++) {
+        if (cache->portgroups[i]) {
+            count += 1 + cache->portgroups[i]->max_ports;
+        }
+    }
+    for (int i = 0; i < cache->max_tunnelzones; i++) {
+        if (cache->tunnelzones[i]) {
+            count += 1 + cache->tunnelzones[i]->max_hosts;
+        }
+    }
+    return (count + cache->max_hosts);
+}
+
+/**
+ * Sets the maximum time between two full midocache refreshes. Incremental refreshes
+ * are promoted to full refreshes once this interval elapses.
+ * @param interval [in] interval in seconds. 0 disables incremental refreshes.
+ */
+void midonet_api_cache_set_full_refresh_interval(int interval) {
+    midocache_full_refresh_interval = interval;
+}
+
+/**
+ * Requests the next midocache refresh to reload all objects from MidoNet.
+ */
+void midonet_api_cache_request_full_refresh(void) {
+    midocache_full_refresh_req = 1;
+}
+
+/**
+ * Populates the midonet_api_cache iphostmap table. Existing iphostmap is flushed.
+ * The list of hosts is always loaded from MidoNet (regardless of midocache state).
+ * @param cache [in] midonet_api_cache structure that holds the iphostmap of interest.
+ * @return 0 on success. 1 on any failure.
+ */
+int midonet_api_cache_iphostmap_populate(midonet_api_cache *cache) {
+    int rc = 0;
+    midonet_api_cache *midocache_bak = NULL;
+    
+    if (!cache) {
+        cache = midonet_api_cache_get();
+    }
+
+    // Disable midocache
+    midocache_bak = midocache;
+    midocache = NULL;
+    
+    rc = midonet_api_cache_refresh_hosts(cache);
+    if (rc != 0) {
+        LOGWARN("Unable to load hosts information from MidoNet.\n");
+        return (1);
+    }
+    midonet_api_iphostmap *iphm = &(cache->iphostmap);
+    if (iphm->entries) {
+        EUCA_FREE(iphm->entries);
+        iphm->entries = NULL;
+    }
+    iphm->max_entries = 0;
+    LOGDEBUG("\tpopulating ip-to-midohost map table.\n");
+    
+    for (int i = 0; i < cache->max_hosts; i++) {
+        iphm->entries = EUCA_REALLOC_C(iphm->entries, iphm->max_entries + cache->hosts[i]->max_addresses,
                 sizeof (midonet_api_iphostmap_entry));
         if (iphm->entries) {
             bzero(&(iphm->entries[iphm->max_entries]), cache->hosts[i]->max_addresses * sizeof (midonet_api_iphostmap_entry));
@@ -8195,27 +9326,114 @@ int midonet_api_cache_add_tunnelzone_host(midonet_api_tunnelzone *tzone, midonam
     return (0);
 }
 
+/**
+ * Looks up the position of an element of a midocache array. Elements appended to
+ * the array since the last lookup are indexed first.
+ * @param index [in] index of the array of interest
+ * @param key [in] name or uuid of interest
+ * @param base [in] the array the index refers to
+ * @param nmemb [in] number of elements in the array
+ * @param keyof [in] function returning the key of an element of the array
+ * @return position of the first element with the given key. -1 if not found.
+ */
+static int midonet_api_index_find(midonet_api_index *index, const char *key, const void *base, int nmemb, euca_strindex_key_fn keyof) {
+    if (!key || !base) {
+        return (-1);
+    }
+    if (index->nmemb > nmemb) {
+        // the array has been replaced
+        euca_strindex_rebuild(&(index->index), 0, keyof, base);
+        index->nmemb = 0;
+    }
+    for (; index->nmemb < nmemb; index->nmemb++) {
+        euca_strindex_add(&(index->index), keyof(base, index->nmemb), index->nmemb, keyof, base);
+    }
+    return (euca_strindex_find(&(index->index), key, keyof, base));
+}
+
+/**
+ * Releases the memory held by a midocache index and leaves it empty.
+ * @param index [in] index of interest
+ */
+static void midonet_api_index_clear(midonet_api_index *index) {
+    euca_strindex_clear(&(index->index));
+    index->nmemb = 0;
+}
+
+//! Key of a deleted (NULL) midocache element, or of an element without name/uuid
+#define MIDO_INDEX_KEY(_obj, _field)  ((((_obj) != NULL) && ((_obj)->_field != NULL)) ? (_obj)->_field : "")
+
+//! @{
+//! @name midocache index key functions
+static const char *midonet_api_port_uuid(const void *base, int idx) {
+    midoname *port = ((midoname * const *)base)[idx];
+    return (MIDO_INDEX_KEY(port, uuid));
+}
+
+//! Port-group ports are keyed by the uuid of their member port, which ends their uri-based uuid
+static const char *midonet_api_pgport_id(const void *base, int idx) {
+    char *id = NULL;
+    const char *uuid = midonet_api_port_uuid(base, idx);
+    if ((id = strrchr(uuid, '/')) != NULL) {
+        return (id + 1);
+    }
+    return (uuid);
+}
+
+static const char *midonet_api_router_name(const void *base, int idx) {
+    midonet_api_router *router = ((midonet_api_router * const *)base)[idx];
+    return ((router != NULL) ? MIDO_INDEX_KEY(router->obj, name) : "");
+}
+
+static const char *midonet_api_bridge_name(const void *base, int idx) {
+    midonet_api_bridge *bridge = ((midonet_api_bridge * const *)base)[idx];
+    return ((bridge != NULL) ? MIDO_INDEX_KEY(bridge->obj, name) : "");
+}
+
+static const char *midonet_api_chain_name(const void *base, int idx) {
+    midonet_api_chain *chain = ((midonet_api_chain * const *)base)[idx];
+    return ((chain != NULL) ? MIDO_INDEX_KEY(chain->obj, name) : "");
+}
+
+static const char *midonet_api_host_name(const void *base, int idx) {
+    midonet_api_host *host = ((midonet_api_host * const *)base)[idx];
+    return ((host != NULL) ? MIDO_INDEX_KEY(host->obj, name) : "");
+}
+
+static const char *midonet_api_host_uuid(const void *base, int idx) {
+    midonet_api_host *host = ((midonet_api_host * const *)base)[idx];
+    return ((host != NULL) ? MIDO_INDEX_KEY(host->obj, uuid) : "");
+}
+
+static const char *midonet_api_ipaddrgroup_name(const void *base, int idx) {
+    midonet_api_ipaddrgroup *ipag = ((midonet_api_ipaddrgroup * const *)base)[idx];
+    return ((ipag != NULL) ? MIDO_INDEX_KEY(ipag->obj, name) : "");
+}
+
+static const char *midonet_api_portgroup_name(const void *base, int idx) {
+    midonet_api_portgroup *pgroup = ((midonet_api_portgroup * const *)base)[idx];
+    return ((pgroup != NULL) ? MIDO_INDEX_KEY(pgroup->obj, name) : "");
+}
+//! @}
+
 /**
  * Searches midocache for the host in the argument.
  * @param host [in] host of interest.
  * @return pointer to the host data structure if found. NULL otherwise.
  */
 midonet_api_host *midonet_api_cache_lookup_host(midoname *name) {
+    int byname = -1;
+    int byuuid = -1;
     if (midocache != NULL) {
         midonet_api_host **hosts = midocache->hosts;
-        for (int i = 0; i < midocache->max_hosts; i++) {
-            if (hosts[i] == NULL) {
-                continue;
-            }
-            if (name == hosts[i]->obj) {
-                return hosts[i];
-            }
-            if (name->name && (!strcmp(name->name, hosts[i]->obj->name))) {
-                return hosts[i];
-            }
-            if (name->uuid && (!strcmp(name->uuid, hosts[i]->obj->uuid))) {
-                return hosts[i];
-            }
+        byname = midonet_api_index_find(&(midocache->hosts_byname), name->name, hosts, midocache->max_hosts, midonet_api_host_name);
+        byuuid = midonet_api_index_find(&(midocache->hosts_byuuid), name->uuid, hosts, midocache->max_hosts, midonet_api_host_uuid);
+        // the first host matching either the name or the uuid wins
+        if ((byname >= 0) && ((byuuid < 0) || (byname < byuuid))) {
+            return (hosts[byname]);
+        }
+        if (byuuid >= 0) {
+            return (hosts[byuuid]);
         }
     }
     return (NULL);
@@ -8239,6 +9457,7 @@ int midonet_api_cache_add_port(midoname *port) {
  */
 int midonet_api_cache_add_bridge_port(midonet_api_bridge *bridge, midoname *port) {
     bridge->ports = EUCA_APPEND_PTRARR(bridge->ports, &(bridge->max_ports), port);
+    bridge->dirty = 1;
     midocache->ports = EUCA_APPEND_PTRARR(midocache->ports, &(midocache->max_ports), port);
     return (0);
 }
@@ -8251,6 +9470,7 @@ int midonet_api_cache_add_bridge_port(midonet_api_bridge *bridge, midoname *port
  */
 int midonet_api_cache_add_router_port(midonet_api_router *router, midoname *port) {
     router->ports = EUCA_APPEND_PTRARR(router->ports, &(router->max_ports), port);
+    router->dirty = 1;
     midocache->ports = EUCA_APPEND_PTRARR(midocache->ports, &(midocache->max_ports), port);
     return (0);
 }
@@ -8285,6 +9505,7 @@ int midonet_api_cache_del_bridge_port(midonet_api_bridge *bridge, midoname *port
     midoname **bports = bridge->ports;
     int max_bports = bridge->max_ports;
     
+    bridge->dirty = 1;
     for (int i = 0; i < max_bports && !found; i++) {
         if (bports[i] == port) {
             // midoname data structure should be released with midocache_midos
@@ -8310,6 +9531,7 @@ int midonet_api_cache_del_router_port(midonet_api_router *router, midoname *port
     midoname **rports = router->ports;
     int max_rports = router->max_ports;
     
+    router->dirty = 1;
     for (int i = 0; i < max_rports && !found; i++) {
         if (rports[i] == port) {
             // midoname data structure should be released with midocache_midos
@@ -8331,30 +9553,14 @@ int midonet_api_cache_del_router_port(midonet_api_router *router, midoname *port
  * @return pointer to the port midoname structure if found. NULL otherwise.
  */
 midoname *midonet_api_cache_lookup_port(midoname *port, int *idx) {
+    int pos = 0;
     if (midocache != NULL) {
-        midoname **ports = midocache->ports;
-        for (int i = 0; i < midocache->max_ports; i++) {
-            if (ports[i] == NULL) {
-                continue;
-            }
-            if (ports[i] == port) {
-                if (idx) {
-                    *idx = i;
-                }
-                return ports[i];
-            }
-        }
-        for (int i = 0; i < midocache->max_ports; i++) {
-            if (ports[i] == NULL) {
-                continue;
-            }
-            if (!strcmp(port->uuid, ports[i]->uuid)) {
-                LOGEXTREME("%s found with uuid cmp.\n", port->name);
-                if (idx) {
-                    *idx = i;
-                }
-                return ports[i];
+        pos = midonet_api_index_find(&(midocache->ports_byuuid), port->uuid, midocache->ports, midocache->max_ports, midonet_api_port_uuid);
+        if (pos >= 0) {
+            if (idx) {
+                *idx = pos;
             }
+            return (midocache->ports[pos]);
         }
     }
     return (NULL);
@@ -8399,8 +9605,8 @@ midonet_api_bridge *midonet_api_cache_add_bridge(midoname *bridge) {
     midonet_api_bridge *newbr = NULL;
     newbr = EUCA_ZALLOC_C(1, sizeof (midonet_api_bridge));
     newbr->obj = bridge;
+    newbr->dirty = 1;
     midocache->bridges = EUCA_APPEND_PTRARR(midocache->bridges, &(midocache->max_bridges), newbr);
-    midocache->sorted_bridges = 0;
     return (newbr);
 }
 
@@ -8428,8 +9634,7 @@ int midonet_api_cache_del_bridge(midoname *bridge) {
         }
         midonet_api_bridge_free(todel);
         midocache->bridges[idx] = NULL;
-        midocache->sorted_bridges = 0;
-        (midocache_midos->released)++;
+            (midocache_midos->released)++;
         return (0);
     }
     return (1);
@@ -8442,19 +9647,17 @@ int midonet_api_cache_del_bridge(midoname *bridge) {
  * @return pointer to the bridge data structure if found. NULL otherwise.
  */
 midonet_api_bridge *midonet_api_cache_lookup_bridge(midoname *bridge, int *idx) {
+    int pos = 0;
     if (midocache != NULL) {
         midonet_api_bridge **bridges = midocache->bridges;
-        for (int i = 0; i < midocache->max_bridges; i++) {
-            if (bridges[i] == NULL) {
-                continue;
-            }
-            if (bridges[i]->obj == bridge) {
-                if (idx) {
-                    *idx = i;
-                }
-                return bridges[i];
+        pos = midonet_api_index_find(&(midocache->bridges_byname), bridge->name, bridges, midocache->max_bridges, midonet_api_bridge_name);
+        if (pos >= 0) {
+            if (idx) {
+                *idx = pos;
             }
+            return (bridges[pos]);
         }
+        // names are not always given in full
         for (int i = 0; i < midocache->max_bridges; i++) {
             if (bridges[i] == NULL) {
                 continue;
@@ -8479,6 +9682,7 @@ midonet_api_bridge *midonet_api_cache_lookup_bridge(midoname *bridge, int *idx)
  */
 int midonet_api_cache_add_ip4mac(midonet_api_bridge *bridge, midoname *ip4mac) {
     bridge->ip4mac_pairs = EUCA_APPEND_PTRARR(bridge->ip4mac_pairs, &(bridge->max_ip4mac_pairs), ip4mac);
+    bridge->dirty = 1;
     return (0);
 }
 
@@ -8494,6 +9698,7 @@ int midonet_api_cache_del_ip4mac(midonet_api_bridge *bridge, midoname *ip4mac) {
     todel = midonet_api_cache_lookup_ip4mac(bridge, ip4mac, &idx);
     if (todel) {
         bridge->ip4mac_pairs[idx] = NULL;
+        bridge->dirty = 1;
         (midocache_midos->released)++;
         return (0);
     }
@@ -8597,6 +9802,7 @@ midoname *midonet_api_cache_lookup_ip4mac_bymac(midonet_api_bridge *bridge, char
  */
 int midonet_api_cache_add_macport(midonet_api_bridge *bridge, midoname *macport) {
     bridge->macport_pairs = EUCA_APPEND_PTRARR(bridge->macport_pairs, &(bridge->max_macport_pairs), macport);
+    bridge->dirty = 1;
     return (0);
 }
 
@@ -8612,6 +9818,7 @@ int midonet_api_cache_del_macport(midonet_api_bridge *bridge, midoname *macport)
     todel = midonet_api_cache_lookup_macport(bridge, macport, &idx);
     if (todel) {
         bridge->macport_pairs[idx] = NULL;
+        bridge->dirty = 1;
         (midocache_midos->released)++;
         return (0);
     }
@@ -8718,6 +9925,7 @@ int midonet_api_cache_add_dhcp(midonet_api_bridge *bridge, midoname *dhcp) {
     newdhcp = EUCA_ZALLOC_C(1, sizeof (midonet_api_dhcp));
     newdhcp->obj = dhcp;
     bridge->dhcps = EUCA_APPEND_PTRARR(bridge->dhcps, &(bridge->max_dhcps), newdhcp);
+    bridge->dirty = 1;
     return (0);
 }
 
@@ -8740,6 +9948,7 @@ int midonet_api_cache_del_dhcp(midonet_api_bridge *bridge, midoname *dhcp) {
         }
         midonet_api_dhcp_free(todel);
         bridge->dhcps[idx] = NULL;
+        bridge->dirty = 1;
         (midocache_midos->released)++;
         return (0);
     }
@@ -8825,6 +10034,7 @@ midonet_api_dhcp *midonet_api_cache_lookup_dhcp_byparam(midonet_api_bridge *brid
 int midonet_api_cache_add_dhcp_host(midonet_api_dhcp *dhcp, midoname *dhcphost) {
     dhcp->dhcphosts = EUCA_APPEND_PTRARR(dhcp->dhcphosts, &(dhcp->max_dhcphosts), dhcphost);
     dhcp->sorted_dhcphosts = 0;
+    dhcp->dirty = 1;
     return (0);
 }
 
@@ -8842,6 +10052,7 @@ int midonet_api_cache_del_dhcp_host(midonet_api_dhcp *dhcp, midoname *dhcphost)
         // midoname data structure should be released with midocache_midos
         dhcp->dhcphosts[idx] = NULL;
         dhcp->sorted_dhcphosts = 0;
+        dhcp->dirty = 1;
         (midocache_midos->released)++;
         return (0);
     }
@@ -8980,8 +10191,8 @@ midonet_api_router *midonet_api_cache_add_router(midoname *router) {
     midonet_api_router *newrt = NULL;
     newrt = EUCA_ZALLOC_C(1, sizeof (midonet_api_router));
     newrt->obj = router;
+    newrt->dirty = 1;
     midocache->routers = EUCA_APPEND_PTRARR(midocache->routers, &(midocache->max_routers), newrt);
-    midocache->sorted_routers = 0;
     return (newrt);
 }
 
@@ -9009,8 +10220,7 @@ int midonet_api_cache_del_router(midoname *router) {
         }
         midonet_api_router_free(todel);
         midocache->routers[idx] = NULL;
-        midocache->sorted_routers = 0;
-        (midocache_midos->released)++;
+            (midocache_midos->released)++;
         return (0);
     }
     return (1);
@@ -9023,19 +10233,17 @@ int midonet_api_cache_del_router(midoname *router) {
  * @return pointer to the router data structure if found. NULL otherwise.
  */
 midonet_api_router *midonet_api_cache_lookup_router(midoname *router, int *idx) {
+    int pos = 0;
     if (midocache != NULL) {
         midonet_api_router **routers = midocache->routers;
-        for (int i = 0; i < midocache->max_routers; i++) {
-            if (routers[i] == NULL) {
-                continue;
-            }
-            if (routers[i]->obj == router) {
-                if (idx) {
-                    *idx = i;
-                }
-                return routers[i];
+        pos = midonet_api_index_find(&(midocache->routers_byname), router->name, routers, midocache->max_routers, midonet_api_router_name);
+        if (pos >= 0) {
+            if (idx) {
+                *idx = pos;
             }
+            return (routers[pos]);
         }
+        // names are not always given in full
         for (int i = 0; i < midocache->max_routers; i++) {
             if (routers[i] == NULL) {
                 continue;
@@ -9060,6 +10268,7 @@ midonet_api_router *midonet_api_cache_lookup_router(midoname *router, int *idx)
  */
 int midonet_api_cache_add_router_route(midonet_api_router *router, midoname *route) {
     router->routes = EUCA_APPEND_PTRARR(router->routes, &(router->max_routes), route);
+    router->dirty = 1;
     return (0);
 }
 
@@ -9076,6 +10285,7 @@ int midonet_api_cache_del_router_route(midonet_api_router *router, midoname *rou
         }
         if (router->routes[i] == route) {
             router->routes[i] = NULL;
+            router->dirty = 1;
             (midocache_midos->released)++;
             return (0);
         }
@@ -9092,6 +10302,7 @@ int midonet_api_cache_add_portgroup(midoname *pgroup) {
     midonet_api_portgroup *newpg = NULL;
     newpg = EUCA_ZALLOC_C(1, sizeof (midonet_api_portgroup));
     newpg->obj = pgroup;
+    newpg->dirty = 1;
     midocache->portgroups = EUCA_APPEND_PTRARR(midocache->portgroups, &(midocache->max_portgroups), newpg);
     return (0);
 }
@@ -9128,30 +10339,14 @@ int midonet_api_cache_del_portgroup(midoname *pgroup) {
  * @return pointer to the port-group data structure if found. NULL otherwise.
  */
 midonet_api_portgroup *midonet_api_cache_lookup_portgroup(midoname *pgroup, int *idx) {
+    int pos = 0;
     if (midocache != NULL) {
-        midonet_api_portgroup **pgs = midocache->portgroups;
-        for (int i = 0; i < midocache->max_portgroups; i++) {
-            if (pgs[i] == NULL) {
-                continue;
-            }
-            if (pgs[i]->obj == pgroup) {
-                if (idx) {
-                    *idx = i;
-                }
-                return pgs[i];
-            }
-        }
-        for (int i = 0; i < midocache->max_portgroups; i++) {
-            if (pgs[i] == NULL) {
-                continue;
-            }
-            if (!strcmp(pgroup->name, pgs[i]->obj->name)) {
-                LOGEXTREME("%s found with name cmp.\n", pgroup->name);
-                if (idx) {
-                    *idx = i;
-                }
-                return pgs[i];
+        pos = midonet_api_index_find(&(midocache->portgroups_byname), pgroup->name, midocache->portgroups, midocache->max_portgroups, midonet_api_portgroup_name);
+        if (pos >= 0) {
+            if (idx) {
+                *idx = pos;
             }
+            return (midocache->portgroups[pos]);
         }
     }
     return (NULL);
@@ -9165,6 +10360,7 @@ midonet_api_portgroup *midonet_api_cache_lookup_portgroup(midoname *pgroup, int
  */
 int midonet_api_cache_add_portgroup_port(midonet_api_portgroup *pgroup, midoname *port) {
     pgroup->ports = EUCA_APPEND_PTRARR(pgroup->ports, &(pgroup->max_ports), port);
+    pgroup->dirty = 1;
     return (0);
 }
 
@@ -9180,6 +10376,7 @@ int midonet_api_cache_del_portgroup_port(midonet_api_portgroup *pgroup, midoname
     todel = midonet_api_cache_lookup_portgroup_port(pgroup, port, &idx);
     if (todel) {
         pgroup->ports[idx] = NULL;
+        pgroup->dirty = 1;
         (midocache_midos->released)++;
         return (0);
     }
@@ -9194,30 +10391,14 @@ int midonet_api_cache_del_portgroup_port(midonet_api_portgroup *pgroup, midoname
  * @return pointer to the port midoname data structure if found. NULL otherwise.
  */
 midoname *midonet_api_cache_lookup_portgroup_port(midonet_api_portgroup *pgroup, midoname *port, int *idx) {
+    int pos = 0;
     if (midocache != NULL) {
-        midoname **ports = pgroup->ports;
-        for (int i = 0; i < pgroup->max_ports; i++) {
-            if (ports[i] == NULL) {
-                continue;
-            }
-            if (ports[i] == port) {
-                if (idx) {
-                    *idx = i;
-                }
-                return ports[i];
-            }
-        }
-        for (int i = 0; i < pgroup->max_ports; i++) {
-            if (ports[i] == NULL) {
-                continue;
-            }
-            if (!strcmp(port->uuid, ports[i]->uuid)) {
-                LOGEXTREME("%s port found with uuid cmp.\n", pgroup->obj->name);
-                if (idx) {
-                    *idx = i;
-                }
-                return ports[i];
+        pos = midonet_api_index_find(&(pgroup->ports_byid), midonet_api_pgport_id(&port, 0), pgroup->ports, pgroup->max_ports, midonet_api_pgport_id);
+        if (pos >= 0) {
+            if (idx) {
+                *idx = pos;
             }
+            return (pgroup->ports[pos]);
         }
     }
     return (NULL);
@@ -9232,8 +10413,8 @@ midonet_api_chain *midonet_api_cache_add_chain(midoname *chain) {
     midonet_api_chain *newchain = NULL;
     newchain = EUCA_ZALLOC_C(1, sizeof (midonet_api_chain));
     newchain->obj = chain;
+    newchain->dirty = 1;
     midocache->chains = EUCA_APPEND_PTRARR(midocache->chains, &(midocache->max_chains), newchain);
-    midocache->sorted_chains = 0;
     return (newchain);
 }
 
@@ -9255,8 +10436,7 @@ int midonet_api_cache_del_chain(midoname *chain) {
         }
         midonet_api_chain_free(todel);
         midocache->chains[idx] = NULL;
-        midocache->sorted_chains = 0;
-        (midocache_midos->released)++;
+            (midocache_midos->released)++;
         return (0);
     }
     return (1);
@@ -9269,30 +10449,14 @@ int midonet_api_cache_del_chain(midoname *chain) {
  * @return pointer to the chain data structure if found. NULL otherwise.
  */
 midonet_api_chain *midonet_api_cache_lookup_chain(midoname *chain, int *idx) {
+    int pos = 0;
     if (midocache != NULL) {
-        midonet_api_chain **chains = midocache->chains;
-        for (int i = 0; i < midocache->max_chains; i++) {
-            if (chains[i] == NULL) {
-                continue;
-            }
-            if (chains[i]->obj == chain) {
-                if (idx) {
-                    *idx = i;
-                }
-                return chains[i];
-            }
-        }
-        for (int i = 0; i < midocache->max_chains; i++) {
-            if (chains[i] == NULL) {
-                continue;
-            }
-            if (!strcmp(chain->name, chains[i]->obj->name)) {
-                LOGEXTREME("%s found with name cmp.\n", chain->name);
-                if (idx) {
-                    *idx = i;
-                }
-                return chains[i];
+        pos = midonet_api_index_find(&(midocache->chains_byname), chain->name, midocache->chains, midocache->max_chains, midonet_api_chain_name);
+        if (pos >= 0) {
+            if (idx) {
+                *idx = pos;
             }
+            return (midocache->chains[pos]);
         }
     }
     return (NULL);
@@ -9307,6 +10471,7 @@ midonet_api_chain *midonet_api_cache_lookup_chain(midoname *chain, int *idx) {
 int midonet_api_cache_add_chain_rule(midonet_api_chain *chain, midoname *rule) {
     chain->rules = EUCA_APPEND_PTRARR(chain->rules, &(chain->max_rules), rule);
     (chain->rules_count)++;
+    chain->dirty = 1;
     return (0);
 }
 
@@ -9324,6 +10489,7 @@ int midonet_api_cache_del_chain_rule(midonet_api_chain *chain, midoname *rule) {
         if (chain->rules[i] == rule) {
             chain->rules[i] = NULL;
             (chain->rules_count)--;
+            chain->dirty = 1;
             (midocache_midos->released)++;
             return (0);
         }
@@ -9340,8 +10506,8 @@ midonet_api_ipaddrgroup *midonet_api_cache_add_ipaddrgroup(midoname *ipaddrgroup
     midonet_api_ipaddrgroup *newipaddrgroup = NULL;
     newipaddrgroup = EUCA_ZALLOC_C(1, sizeof (midonet_api_ipaddrgroup));
     newipaddrgroup->obj = ipaddrgroup;
+    newipaddrgroup->dirty = 1;
     midocache->ipaddrgroups = EUCA_APPEND_PTRARR(midocache->ipaddrgroups, &(midocache->max_ipaddrgroups), newipaddrgroup);
-    midocache->sorted_ipaddrgroups = 0;
     return (newipaddrgroup);
 }
 
@@ -9363,8 +10529,7 @@ int midonet_api_cache_del_ipaddrgroup(midoname *ipaddrgroup) {
         }
         midonet_api_ipaddrgroup_free(todel);
         midocache->ipaddrgroups[idx] = NULL;
-        midocache->sorted_ipaddrgroups = 0;
-        (midocache_midos->released)++;
+            (midocache_midos->released)++;
         return (0);
     }
     return (1);
@@ -9377,30 +10542,14 @@ int midonet_api_cache_del_ipaddrgroup(midoname *ipaddrgroup) {
  * @return pointer to the ipaddrgroup data structure if found. NULL otherwise.
  */
 midonet_api_ipaddrgroup *midonet_api_cache_lookup_ipaddrgroup(midoname *ipaddrgroup, int *idx) {
+    int pos = 0;
     if (midocache != NULL) {
-        midonet_api_ipaddrgroup **ipaddrgroups = midocache->ipaddrgroups;
-        for (int i = 0; i < midocache->max_ipaddrgroups; i++) {
-            if (ipaddrgroups[i] == NULL) {
-                continue;
-            }
-            if (ipaddrgroups[i]->obj == ipaddrgroup) {
-                if (idx) {
-                    *idx = i;
-                }
-                return ipaddrgroups[i];
-            }
-        }
-        for (int i = 0; i < midocache->max_ipaddrgroups; i++) {
-            if (ipaddrgroups[i] == NULL) {
-                continue;
-            }
-            if (!strcmp(ipaddrgroup->name, ipaddrgroups[i]->obj->name)) {
-                LOGEXTREME("%s found with name cmp.\n", ipaddrgroup->name);
-                if (idx) {
-                    *idx = i;
-                }
-                return ipaddrgroups[i];
+        pos = midonet_api_index_find(&(midocache->ipaddrgroups_byname), ipaddrgroup->name, midocache->ipaddrgroups, midocache->max_ipaddrgroups, midonet_api_ipaddrgroup_name);
+        if (pos >= 0) {
+            if (idx) {
+                *idx = pos;
             }
+            return (midocache->ipaddrgroups[pos]);
         }
     }
     return (NULL);
@@ -9418,6 +10567,7 @@ int midonet_api_cache_add_ipaddrgroup_ip(midonet_api_ipaddrgroup *ipaddrgroup, m
     ipaddrgroup->hexips[ipaddrgroup->max_ips] = hexip;
     ipaddrgroup->ips = EUCA_APPEND_PTRARR(ipaddrgroup->ips, &(ipaddrgroup->max_ips), ip);
     (ipaddrgroup->ips_count)++;
+    ipaddrgroup->dirty = 1;
     return (0);
 }
 
@@ -9436,6 +10586,7 @@ int midonet_api_cache_del_ipaddrgroup_ip(midonet_api_ipaddrgroup *ipaddrgroup, m
             ipaddrgroup->hexips[i] = 0;
             ipaddrgroup->ips[i] = NULL;
             (ipaddrgroup->ips_count)--;
+            ipaddrgroup->dirty = 1;
             (midocache_midos->released)++;
             if (ipaddrgroup->ips_count == 0) {
                 EUCA_FREE(ipaddrgroup->ips);
@@ -9558,6 +10709,7 @@ int midonet_api_portgroup_free(midonet_api_portgroup *portgroup) {
         return (1);
     }
     EUCA_FREE(portgroup->ports);
+    midonet_api_index_clear(&(portgroup->ports_byid));
     bzero(portgroup, sizeof (midonet_api_portgroup));
     EUCA_FREE(portgroup);
     return (0);
@@ -10184,17 +11336,181 @@ int compare_midonet_api_chain(const void *p1, const void *p2) {
 }
 
 #ifdef MIDONET_API_TEST
+int midocache_invalid = 0;
+int sig_rcvd = 0;
+
+/**
+ * Allocates a midoname from the midocache midos list.
+ * @param name [in] name of the object
+ * @param uuid [in] uuid of the object
+ * @return pointer to the newly allocated midoname.
+ */
+static midoname *test_midoname(const char *name, const char *uuid) {
+    midoname *res = midoname_list_get_midoname(midocache_midos);
+    res->name = strdup(name);
+    res->uuid = strdup(uuid);
+    res->init = 1;
+    return (res);
+}
+
 /**
+ * Times the retrieval of the top level MidoNet collections loaded on a midocache
+ * refresh, from the MidoNet API (or a stub serving a recorded dump) at apiuribase.
  *
+ * @param apiuribase [in] MidoNet API base URL
  *
- * @param argc [in]
- * @param argv [in]
+ * @return number of collections that could not be retrieved
+ */
+static int test_midonet_api_refresh(char *apiuribase) {
+    int errors = 0;
+    int max_names = 0;
+    long usec = 0;
+    midoname **names = NULL;
+    struct timeval tv = { 0 };
+    char *resources[] = { "tunnel_zones", "routers", "bridges", "chains", "ip_addr_groups", "port_groups", "ports" };
+
+    mido_set_apiuribase(apiuribase);
+    for (int i = 0; i < (sizeof (resources) / sizeof (char *)); i++) {
+        eucanetd_timer_usec(&tv);
+        mido_get_resources(NULL, 0, VPCMIDO_TENANT, resources[i], "application/json", "application/json", &names, &max_names);
+        usec = eucanetd_timer_usec(&tv);
+        printf("%8d %-14s retrieved in %10.2f ms\n", max_names, resources[i], usec / 1000.0);
+        errors += (max_names == 0);
+        EUCA_FREE(names);
+    }
+    return (errors);
+}
+
+/**
+ * Builds a synthetic midocache of the size of a large VPCMIDO deployment and
+ * times the midocache lookups eucanetd performs for every instance.
  *
- * @return
+ * @param argc [in] the number of arguments
+ * @param argv [in] optional number of instance ports (default 50000), and
+ * optional MidoNet API base URL to time a midocache refresh against.
  *
- * @note
+ * @return 0 on success, 1 if a lookup returned the wrong object
  */
 int main(int argc, char **argv) {
-    exit(0);
+    int i = 0;
+    int errors = 0;
+    int nports = 50000;
+    int nsubnets = 0;
+    int nsgs = 0;
+    int nhosts = 0;
+    long usec = 0;
+    char name[EUCA_MAX_PATH] = "";
+    char uuid[EUCA_MAX_PATH] = "";
+    midoname tmp = { 0 };
+    midoname **ports = NULL;
+    midoname **pgports = NULL;
+    midonet_api_bridge *br = NULL;
+    midonet_api_portgroup *pg = NULL;
+    struct timeval tv = { 0 };
+
+    if (argc > 1) {
+        nports = atoi(argv[1]);
+    }
+    nports = ((nports > 0) ? nports : 1);
+    nsubnets = (nports / 25) + 1;
+    nsgs = (nports / 10) + 1;
+    nhosts = (nports / 50) + 1;
+
+    log_params_set(EUCA_LOG_WARN, 0, 100);
+    midocache = midonet_api_cache_init();
+
+    eucanetd_timer_usec(&tv);
+    for (i = 0; i < nsubnets; i++) {
+        snprintf(name, EUCA_MAX_PATH, "vb_vpc-%08x_subnet-%08x", (i / 4), i);
+        snprintf(uuid, EUCA_MAX_PATH, "b0000000-0000-0000-0000-%012d", i);
+        midonet_api_cache_add_bridge(test_midoname(name, uuid));
+        snprintf(name, EUCA_MAX_PATH, "vr_vpc-%08x_subnet-%08x", (i / 4), i);
+        snprintf(uuid, EUCA_MAX_PATH, "a0000000-0000-0000-0000-%012d", i);
+        midonet_api_cache_add_router(test_midoname(name, uuid));
+    }
+    for (i = 0; i < nsgs; i++) {
+        snprintf(name, EUCA_MAX_PATH, "sg_ingress_sg-%08x", i);
+        snprintf(uuid, EUCA_MAX_PATH, "c0000000-0000-0000-0000-%012d", i);
+        midonet_api_cache_add_chain(test_midoname(name, uuid));
+        snprintf(name, EUCA_MAX_PATH, "sg_priv_sg-%08x", i);
+        snprintf(uuid, EUCA_MAX_PATH, "d0000000-0000-0000-0000-%012d", i);
+        midonet_api_cache_add_ipaddrgroup(test_midoname(name, uuid));
+        snprintf(name, EUCA_MAX_PATH, "pg_sg-%08x", i);
+        snprintf(uuid, EUCA_MAX_PATH, "e0000000-0000-0000-0000-%012d", i);
+        midonet_api_cache_add_portgroup(test_midoname(name, uuid));
+    }
+    for (i = 0; i < nhosts; i++) {
+        snprintf(name, EUCA_MAX_PATH, "node-%d.example.com", i);
+        snprintf(uuid, EUCA_MAX_PATH, "f0000000-0000-0000-0000-%012d", i);
+        midocache->hosts = EUCA_APPEND_PTRARR(midocache->hosts, &(midocache->max_hosts), EUCA_ZALLOC_C(1, sizeof (midonet_api_host)));
+        midocache->hosts[i]->obj = test_midoname(name, uuid);
+    }
+    ports = EUCA_ZALLOC_C(nports, sizeof (midoname *));
+    pgports = EUCA_ZALLOC_C(nports, sizeof (midoname *));
+    for (i = 0; i < nports; i++) {
+        snprintf(name, EUCA_MAX_PATH, "eni-%08x", i);
+        snprintf(uuid, EUCA_MAX_PATH, "10000000-0000-0000-0000-%012d", i);
+        ports[i] = test_midoname(name, uuid);
+        midonet_api_cache_add_bridge_port(midocache->bridges[i % nsubnets], ports[i]);
+        pg = midocache->portgroups[i % nsgs];
+        snprintf(uuid, EUCA_MAX_PATH, "http://midonet:8080/midonet-api/port_groups/%s/ports/%s", pg->obj->uuid, ports[i]->uuid);
+        pgports[i] = test_midoname(uuid, uuid);
+        midonet_api_cache_add_portgroup_port(pg, pgports[i]);
+    }
+    printf("built midocache: %d ports, %d bridges, %d routers, %d chains, %d port-groups, %d hosts in %.2f ms\n", nports, nsubnets, nsubnets,
+           nsgs, nsgs, nhosts, eucanetd_timer_usec(&tv) / 1000.0);
+
+    // ports by uuid
+    for (i = 0; i < nports; i++) {
+        tmp.uuid = ports[i]->uuid;
+        errors += (midonet_api_cache_lookup_port(&tmp, NULL) != ports[i]);
+    }
+    usec = eucanetd_timer_usec(&tv);
+    printf("%8d port lookups in %10.2f ms (%.3f us/lookup)\n", nports, usec / 1000.0, (double) usec / nports);
+
+    // bridges, routers, chains, ip-address-groups and port-groups by name
+    for (i = 0; i < nports; i++) {
+        br = midocache->bridges[i % nsubnets];
+        errors += (mido_get_bridge(br->obj->name) != br);
+        tmp.name = midocache->routers[i % nsubnets]->obj->name;
+        errors += (midonet_api_cache_lookup_router(&tmp, NULL) != midocache->routers[i % nsubnets]);
+        tmp.name = midocache->chains[i % nsgs]->obj->name;
+        errors += (midonet_api_cache_lookup_chain(&tmp, NULL) != midocache->chains[i % nsgs]);
+        errors += (mido_get_ipaddrgroup(midocache->ipaddrgroups[i % nsgs]->obj->name) != midocache->ipaddrgroups[i % nsgs]);
+        tmp.name = midocache->portgroups[i % nsgs]->obj->name;
+        errors += (midonet_api_cache_lookup_portgroup(&tmp, NULL) != midocache->portgroups[i % nsgs]);
+    }
+    usec = eucanetd_timer_usec(&tv);
+    printf("%8d device lookups in %10.2f ms (%.3f us/lookup)\n", (5 * nports), usec / 1000.0, (double) usec / (5 * nports));
+
+    // hosts by name, port-group ports by member port
+    for (i = 0; i < nports; i++) {
+        tmp.name = midocache->hosts[i % nhosts]->obj->name;
+        tmp.uuid = NULL;
+        errors += (midonet_api_cache_lookup_host(&tmp) != midocache->hosts[i % nhosts]);
+        pg = midocache->portgroups[i % nsgs];
+        errors += (midonet_api_cache_lookup_portgroup_port(pg, pgports[i], NULL) != pgports[i]);
+    }
+    usec = eucanetd_timer_usec(&tv);
+    printf("%8d host/port-group port lookups in %10.2f ms (%.3f us/lookup)\n", (2 * nports), usec / 1000.0, (double) usec / (2 * nports));
+
+    // deleted ports must not be found anymore
+    for (i = 0; i < nports; i += 2) {
+        midonet_api_cache_del_bridge_port(midocache->bridges[i % nsubnets], ports[i]);
+    }
+    for (i = 0; i < nports; i++) {
+        tmp.uuid = ports[i]->uuid;
+        errors += ((midonet_api_cache_lookup_port(&tmp, NULL) != NULL) != (i % 2));
+    }
+    printf("%d lookup errors\n", errors);
+
+    if (argc > 2) {
+        errors += test_midonet_api_refresh(argv[2]);
+    }
+
+    EUCA_FREE(ports);
+    EUCA_FREE(pgports);
+    midonet_api_cache_flush(NULL);
+    return ((errors == 0) ? 0 : 1);
 }
 #endif
@@ -29,6 +29,7 @@
 #include "dev_handler.h"
 #include "eucanetd.h"
 #include "eucanetd_util.h"
+#include "euca_strindex.h"
 
 //!
 //! @file net/midonet-api.h
@@ -76,12 +77,18 @@
 
 #define MIDONAME_LIST_CAPACITY_STEP            1000
 #define MIDONAME_LIST_RELEASES_B4INVALIDATE    36000
+#define MIDOCACHE_FULL_REFRESH_INTERVAL        3600
 
 #define MIDONET_API_RELOAD_THREADS             6
 #define MIDONET_API_USE_THREADS_THRESHOLD      100
 
 #define MIDO_CACHE_THREAD_NAME_LEN             8
 
+#define MIDONET_API_BATCH_CONNECTIONS          8
+#define MIDONET_API_TCP_KEEPIDLE               600
+#define MIDONET_API_TCP_KEEPINTVL              30
+#define MIDONET_API_HTTP_BUFFER_MIN            16384
+
 #define MIDONET_API_BASE_URL_8080              "http://127.0.0.1:8080/midonet-api"
 #define MIDONET_API_BASE_URL_8181              "http://127.0.0.1:8181/midonet-api"
 
@@ -179,6 +186,7 @@ enum mido_chain_rule_elements_t {
 enum mido_cache_refresh_mode_t {
     MIDO_CACHE_REFRESH_ALL,
     MIDO_CACHE_REFRESH_NOHOSTS,
+    MIDO_CACHE_REFRESH_INCREMENTAL,
     MIDO_CACHE_REFRESH_NONE
 };
 
@@ -319,12 +327,21 @@ typedef struct midoname_list_t {
     int released;
 } midoname_list;
 
+//! Hash index over one of the midocache arrays, keyed by name or uuid. Elements
+//! appended to the array are indexed on the next lookup; deleted (NULL) elements
+//! simply stop matching.
+typedef struct midonet_api_index_t {
+    euca_strindex index;
+    int nmemb;                         //!< number of leading array elements already indexed
+} midonet_api_index;
+
 typedef struct midonet_api_router_t {
     midoname *obj;
     midoname **ports;
     int max_ports;
     midoname **routes;
     int max_routes;
+    int dirty;                         //!< children changed by eucanetd since they were loaded
 } midonet_api_router;
 
 typedef struct midonet_api_dhcp_t {
@@ -332,6 +349,7 @@ typedef struct midonet_api_dhcp_t {
     midoname **dhcphosts;
     int max_dhcphosts;
     int sorted_dhcphosts;
+    int dirty;                         //!< dhcphosts changed by eucanetd since they were loaded
 } midonet_api_dhcp;
 
 typedef struct midonet_api_bridge_t {
@@ -344,6 +362,7 @@ typedef struct midonet_api_bridge_t {
     int max_macport_pairs;
     midonet_api_dhcp **dhcps;
     int max_dhcps;
+    int dirty;                         //!< children changed by eucanetd since they were loaded
 } midonet_api_bridge;
 
 typedef struct midonet_api_chain_t {
@@ -351,6 +370,7 @@ typedef struct midonet_api_chain_t {
     midoname **rules;
     int max_rules;
     int rules_count;
+    int dirty;                         //!< rules changed by eucanetd since they were loaded
 } midonet_api_chain;
 
 typedef struct midonet_api_host_t {
@@ -367,12 +387,15 @@ typedef struct midonet_api_ipaddrgroup_t {
     u32 *hexips;
     int max_ips;
     int ips_count;
+    int dirty;                         //!< ips changed by eucanetd since they were loaded
 } midonet_api_ipaddrgroup;
 
 typedef struct midonet_api_portgroup_t {
     midoname *obj;
     midoname **ports;
     int max_ports;
+    midonet_api_index ports_byid;
+    int dirty;                         //!< ports changed by eucanetd since they were loaded
 } midonet_api_portgroup;
 
 typedef struct midonet_api_tunnelzone_t {
@@ -395,22 +418,26 @@ typedef struct midonet_api_iphostmap_t {
 typedef struct midonet_api_cache_t {
     midoname **ports;
     int max_ports;
+    midonet_api_index ports_byuuid;
     midonet_api_router **routers;
     int max_routers;
-    int sorted_routers;
+    midonet_api_index routers_byname;
     midonet_api_bridge **bridges;
     int max_bridges;
-    int sorted_bridges;
+    midonet_api_index bridges_byname;
     midonet_api_chain **chains;
     int max_chains;
-    int sorted_chains;
+    midonet_api_index chains_byname;
     midonet_api_host **hosts;
     int max_hosts;
+    midonet_api_index hosts_byname;
+    midonet_api_index hosts_byuuid;
     midonet_api_ipaddrgroup **ipaddrgroups;
     int max_ipaddrgroups;
-    int sorted_ipaddrgroups;
+    midonet_api_index ipaddrgroups_byname;
     midonet_api_portgroup **portgroups;
     int max_portgroups;
+    midonet_api_index portgroups_byname;
     midonet_api_tunnelzone **tunnelzones;
     int max_tunnelzones;
     midonet_api_iphostmap iphostmap;
@@ -456,6 +483,7 @@ typedef struct mido_libcurl_handles_t {
     int max_gethandles;
     CURL **handles;
     CURL **gethandles;
+    CURLM *multi;                   //!< shared by batched requests (connection cache)
 } mido_libcurl_handles;
 
 /*----------------------------------------------------------------------------*\
@@ -681,6 +709,10 @@ int midonet_http_put(char *url, char *apistr, char *payload);
 int midonet_http_post(char *url, char *apistr, char *payload, char **out_payload);
 int midonet_http_delete(char *url);
 
+int mido_batch_begin(void);
+int mido_batch_active(void);
+int mido_batch_commit(void);
+
 midoname_list *midoname_list_new(void);
 int midoname_list_free(midoname_list *list);
 midoname *midoname_list_get_midoname(midoname_list *list);
@@ -697,6 +729,8 @@ int midonet_api_cache_populate(void);
 int midonet_api_cache_refresh(void);
 int midonet_api_cache_refresh_v(enum mido_cache_refresh_mode_t refreshmode);
 int midonet_api_cache_refresh_v_threads(enum mido_cache_refresh_mode_t refreshmode);
+void midonet_api_cache_set_full_refresh_interval(int interval);
+void midonet_api_cache_request_full_refresh(void);
 
 int midonet_api_cache_refresh_routerroutes(midonet_api_cache *cache, int start, int end);
 int midonet_api_cache_refresh_bridgeobjects(midonet_api_cache *cache, int start, int end);
@@ -84,6 +84,8 @@
 #include <neethi_util.h>
 
 #include <axis2_stub_EucalyptusNC.h>
+#include <axis2_http_header.h>
+#include <axis2_http_transport.h>
 
 #include "client-marshal.h"
 #include "handlers.h"
@@ -275,6 +277,74 @@ int ncStubDestroy(ncStub * pStub)
     return (EUCA_OK);
 }
 
+//!
+//! Sets the transport timeout used by all subsequent calls made with the stub
+//!
+//! @param[in] pStub a pointer to the node controller (NC) stub structure
+//! @param[in] timeoutMs the timeout in milliseconds (ignored if not positive)
+//!
+//! @return EUCA_OK on success or EUCA_ERROR on failure
+//!
+int ncStubSetTimeout(ncStub * pStub, long timeoutMs)
+{
+    axis2_options_t *options = NULL;
+
+    if ((pStub == NULL) || (pStub->stub == NULL))
+        return (EUCA_ERROR);
+
+    if (timeoutMs <= 0)
+        return (EUCA_OK);
+
+    if ((options = axis2_stub_get_options(pStub->stub, pStub->env)) == NULL) {
+        LOGERROR("could not get options from stub for %s\n", pStub->node_name);
+        return (EUCA_ERROR);
+    }
+
+    axis2_options_set_timeout_in_milli_seconds(options, pStub->env, timeoutMs);
+    return (EUCA_OK);
+}
+
+//!
+//! Asks the transport to keep the HTTP connection open between calls made
+//! with this stub, so that long-lived (pooled) stubs do not pay for a new
+//! TCP connection on each request.
+//!
+//! @param[in] pStub a pointer to the node controller (NC) stub structure
+//! @param[in] keepAlive set to TRUE to request persistent connections
+//!
+//! @return EUCA_OK on success or EUCA_ERROR on failure
+//!
+int ncStubSetKeepAlive(ncStub * pStub, boolean keepAlive)
+{
+    axis2_options_t *options = NULL;
+    axutil_array_list_t *headers = NULL;
+    axutil_property_t *property = NULL;
+    axis2_http_header_t *header = NULL;
+
+    if ((pStub == NULL) || (pStub->stub == NULL))
+        return (EUCA_ERROR);
+
+    if ((options = axis2_stub_get_options(pStub->stub, pStub->env)) == NULL) {
+        LOGERROR("could not get options from stub for %s\n", pStub->node_name);
+        return (EUCA_ERROR);
+    }
+
+    if ((headers = axutil_array_list_create(pStub->env, 1)) == NULL)
+        return (EUCA_ERROR);
+
+    header = axis2_http_header_create(pStub->env, AXIS2_HTTP_HEADER_CONNECTION,
+                                      (keepAlive ? AXIS2_HTTP_HEADER_CONNECTION_KEEPALIVE : AXIS2_HTTP_HEADER_CONNECTION_CLOSE));
+    if (header == NULL) {
+        axutil_array_list_free(headers, pStub->env);
+        return (EUCA_ERROR);
+    }
+    axutil_array_list_add(headers, pStub->env, header);
+
+    property = axutil_property_create_with_args(pStub->env, AXIS2_SCOPE_APPLICATION, AXIS2_FALSE, NULL, headers);
+    axis2_options_set_property(options, pStub->env, AXIS2_TRANSPORT_HEADER_PROPERTY, property);
+    return (EUCA_OK);
+}
+
 //!
 //! Marshals the Run instance request
 //!
@@ -408,6 +478,11 @@ int ncRunInstanceStub(ncStub * pStub, ncMetadata * pMeta, char *uuid, char *inst
         *outInstPtr = copy_instance_from_adb(instance, env);
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncRunInstanceResponse_free(output, env);
+    adb_ncRunInstance_free(input, env);
+
     return (status);
 }
 
@@ -464,9 +539,16 @@ int ncGetConsoleOutputStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId,
             status = 1;
         }
 
-        *consoleOutput = adb_ncGetConsoleOutputResponseType_get_consoleOutput(response, env);
+        // copy it out, the response is freed below
+        if ((*consoleOutput = adb_ncGetConsoleOutputResponseType_get_consoleOutput(response, env)) != NULL)
+            *consoleOutput = strdup(*consoleOutput);
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncGetConsoleOutputResponse_free(output, env);
+    adb_ncGetConsoleOutput_free(input, env);
+
     return (status);
 }
 
@@ -521,6 +603,11 @@ int ncRebootInstanceStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId)
         status = adb_ncRebootInstanceResponseType_get_status(response, env);
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncRebootInstanceResponse_free(output, env);
+    adb_ncRebootInstance_free(input, env);
+
     return (status);
 }
 
@@ -586,6 +673,11 @@ int ncTerminateInstanceStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId
         *previousState = 0;            //strdup(adb_ncTerminateInstanceResponseType_get_previousState(response, env));
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncTerminateInstanceResponse_free(output, env);
+    adb_ncTerminateInstance_free(input, env);
+
     return (status);
 }
 
@@ -658,6 +750,124 @@ int ncDescribeInstancesStub(ncStub * pStub, ncMetadata * pMeta, char **instIds,
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncDescribeInstancesResponse_free(output, env);
+    adb_ncDescribeInstances_free(input, env);
+
+    return (status);
+}
+
+//!
+//! Marshals the client describe instance request asking only for the changes
+//! made since a previous request. An NC that does not know about change
+//! sequences returns its full list, which is reported with isDelta cleared and
+//! a zero epoch and sequence number.
+//!
+//! @param[in]  pStub a pointer to the node controller (NC) stub structure
+//! @param[in]  pMeta a pointer to the node controller (NC) metadata structure
+//! @param[in]  sinceEpoch the sequence epoch returned by the previous request
+//! @param[in]  sinceSeq the sequence number returned by the previous request (0 for a full list)
+//! @param[out] outInsts a pointer the list of instances for which we have data
+//! @param[out] outInstsLen the number of instances in the outInsts list.
+//! @param[out] removedIds a pointer to the list of identifiers of the instances removed since sinceSeq
+//! @param[out] removedIdsLen the number of identifiers in the removedIds list
+//! @param[out] outEpoch the sequence epoch to send with the next request
+//! @param[out] outSeq the sequence number to send with the next request
+//! @param[out] isDelta set to TRUE if only the changes were returned
+//!
+//! @return EUCA_OK on success or EUCA_ERROR on failure.
+//!
+int ncDescribeInstancesSinceStub(ncStub * pStub, ncMetadata * pMeta, long long sinceEpoch, long long sinceSeq, ncInstance *** outInsts, int *outInstsLen,
+                                 char ***removedIds, int *removedIdsLen, long long *outEpoch, long long *outSeq, boolean * isDelta)
+{
+    int i = 0;
+    int status = 0;
+    axutil_env_t *env = NULL;
+    axis2_stub_t *stub = NULL;
+    adb_instanceType_t *instance = NULL;
+    adb_ncDescribeInstances_t *input = NULL;
+    adb_ncDescribeInstancesType_t *request = NULL;
+    adb_ncDescribeInstancesResponse_t *output = NULL;
+    adb_ncDescribeInstancesResponseType_t *response = NULL;
+    char *correlation_id = NULL;
+
+    *outInsts = NULL;
+    *outInstsLen = 0;
+    *removedIds = NULL;
+    *removedIdsLen = 0;
+    *outEpoch = 0;
+    *outSeq = 0;
+    *isDelta = FALSE;
+
+    env = pStub->env;
+    stub = pStub->stub;
+    input = adb_ncDescribeInstances_create(env);
+    request = adb_ncDescribeInstancesType_create(env);
+
+    /* set input fields */
+    adb_ncDescribeInstancesType_set_nodeName(request, env, pStub->node_name);
+    if (pMeta) {
+        correlation_id = create_corrid(pMeta->correlationId);
+        EUCA_FREE(pMeta->correlationId);
+        EUCA_MESSAGE_MARSHAL(ncDescribeInstancesType, request, pMeta);
+    }
+    if (correlation_id != NULL)
+        adb_ncDescribeInstancesType_set_correlationId(request, env, correlation_id);
+
+    adb_ncDescribeInstancesType_set_seqEpoch(request, env, sinceEpoch);
+    adb_ncDescribeInstancesType_set_changedSince(request, env, sinceSeq);
+    adb_ncDescribeInstances_set_ncDescribeInstances(input, env, request);
+
+    if ((output = axis2_stub_op_EucalyptusNC_ncDescribeInstances(stub, env, input)) == NULL) {
+        LOGERROR(NULL_ERROR_MSG);
+        status = -1;
+    } else {
+        response = adb_ncDescribeInstancesResponse_get_ncDescribeInstancesResponse(output, env);
+        if (adb_ncDescribeInstancesResponseType_get_return(response, env) == AXIS2_FALSE) {
+            LOGERROR("returned an error\n");
+            status = 1;
+        }
+
+        if ((*outInstsLen = adb_ncDescribeInstancesResponseType_sizeof_instances(response, env)) != 0) {
+            if ((*outInsts = EUCA_ZALLOC(*outInstsLen, sizeof(ncInstance *))) == NULL) {
+                LOGERROR("out of memory\n");
+                *outInstsLen = 0;
+                status = 2;
+            } else {
+                for (i = 0; i < *outInstsLen; i++) {
+                    instance = adb_ncDescribeInstancesResponseType_get_instances_at(response, env, i);
+                    (*outInsts)[i] = copy_instance_from_adb(instance, env);
+                }
+            }
+        }
+
+        if (!adb_ncDescribeInstancesResponseType_is_seqEpoch_nil(response, env) && !adb_ncDescribeInstancesResponseType_is_currentSeq_nil(response, env)) {
+            *outEpoch = adb_ncDescribeInstancesResponseType_get_seqEpoch(response, env);
+            *outSeq = adb_ncDescribeInstancesResponseType_get_currentSeq(response, env);
+            if (!adb_ncDescribeInstancesResponseType_is_isDelta_nil(response, env))
+                *isDelta = (adb_ncDescribeInstancesResponseType_get_isDelta(response, env) == AXIS2_TRUE) ? TRUE : FALSE;
+        }
+
+        if ((*removedIdsLen = adb_ncDescribeInstancesResponseType_sizeof_removedInstanceIds(response, env)) != 0) {
+            if ((*removedIds = EUCA_ZALLOC(*removedIdsLen, sizeof(char *))) == NULL) {
+                LOGERROR("out of memory\n");
+                *removedIdsLen = 0;
+                *isDelta = FALSE;
+                status = 2;
+            } else {
+                for (i = 0; i < *removedIdsLen; i++) {
+                    (*removedIds)[i] = strdup(adb_ncDescribeInstancesResponseType_get_removedInstanceIds_at(response, env, i));
+                }
+            }
+        }
+    }
+
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncDescribeInstancesResponse_free(output, env);
+    adb_ncDescribeInstances_free(input, env);
+
     return (status);
 }
 
@@ -732,6 +942,11 @@ int ncDescribeResourceStub(ncStub * pStub, ncMetadata * pMeta, char *resourceTyp
         *outRes = res;
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncDescribeResourceResponse_free(output, env);
+    adb_ncDescribeResource_free(input, env);
+
     return (status);
 }
 
@@ -787,6 +1002,11 @@ int ncBroadcastNetworkInfoStub(ncStub * pStub, ncMetadata * pMeta, char *network
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncBroadcastNetworkInfoResponse_free(output, env);
+    adb_ncBroadcastNetworkInfo_free(input, env);
+
     return (status);
 }
 
@@ -844,6 +1064,11 @@ int ncAssignAddressStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId, ch
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncAssignAddressResponse_free(output, env);
+    adb_ncAssignAddress_free(input, env);
+
     return (status);
 }
 
@@ -896,6 +1121,11 @@ int ncPowerDownStub(ncStub * pStub, ncMetadata * pMeta)
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncPowerDownResponse_free(output, env);
+    adb_ncPowerDown_free(input, env);
+
     return (status);
 }
 
@@ -964,6 +1194,11 @@ int ncStartNetworkStub(ncStub * pStub, ncMetadata * pMeta, char *uuid, char **pe
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncStartNetworkResponse_free(output, env);
+    adb_ncStartNetwork_free(input, env);
+
     return (status);
 }
 
@@ -1024,6 +1259,11 @@ int ncAttachVolumeStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId, cha
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncAttachVolumeResponse_free(output, env);
+    adb_ncAttachVolume_free(input, env);
+
     return (status);
 }
 
@@ -1092,6 +1332,11 @@ int ncDetachVolumeStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId, cha
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncDetachVolumeResponse_free(output, env);
+    adb_ncDetachVolume_free(input, env);
+
     return (status);
 }
 
@@ -1158,6 +1403,11 @@ int ncAttachNetworkInterfaceStub(ncStub * pStub, ncMetadata * pMeta, char *insta
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncAttachNetworkInterfaceResponse_free(output, env);
+    adb_ncAttachNetworkInterface_free(input, env);
+
     return (status);
 }
 
@@ -1222,6 +1472,11 @@ int ncDetachNetworkInterfaceStub(ncStub * pStub, ncMetadata * pMeta, char *insta
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncDetachNetworkInterfaceResponse_free(output, env);
+    adb_ncDetachNetworkInterface_free(input, env);
+
     return (status);
 }
 
@@ -1291,6 +1546,11 @@ int ncBundleInstanceStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId, c
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncBundleInstanceResponse_free(output, env);
+    adb_ncBundleInstance_free(input, env);
+
     return (status);
 }
 
@@ -1345,6 +1605,11 @@ int ncBundleRestartInstanceStub(ncStub * pStub, ncMetadata * pMeta, char *instan
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncBundleRestartInstanceResponse_free(output, env);
+    adb_ncBundleRestartInstance_free(input, env);
+
     return (status);
 }
 
@@ -1399,6 +1664,11 @@ int ncCancelBundleTaskStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId)
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncCancelBundleTaskResponse_free(output, env);
+    adb_ncCancelBundleTask_free(input, env);
+
     return (status);
 }
 
@@ -1457,6 +1727,11 @@ int ncCreateImageStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId, char
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncCreateImageResponse_free(output, env);
+    adb_ncCreateImage_free(input, env);
+
     return (status);
 }
 
@@ -1545,6 +1820,11 @@ int ncDescribeSensorsStub(ncStub * pStub, ncMetadata * pMeta, int historySize, l
         }
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncDescribeSensorsResponse_free(output, env);
+    adb_ncDescribeSensors_free(input, env);
+
     return (status);
 }
 
@@ -1602,6 +1882,11 @@ int ncModifyNodeStub(ncStub * pStub, ncMetadata * pMeta, char *stateName)
         // no output other than success/failure
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncModifyNodeResponse_free(output, env);
+    adb_ncModifyNode_free(input, env);
+
     return (status);
 }
 
@@ -1679,6 +1964,11 @@ int ncMigrateInstancesStub(ncStub * pStub, ncMetadata * pMeta, ncInstance ** ins
             pMeta->replyString = strdup(statusMessage);
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncMigrateInstancesResponse_free(output, env);
+    adb_ncMigrateInstances_free(input, env);
+
     return (status);
 }
 
@@ -1738,6 +2028,11 @@ int ncStartInstanceStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId)
         // extract the fields from reponse
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncStartInstanceResponse_free(output, env);
+    adb_ncStartInstance_free(input, env);
+
     return (status);
 }
 
@@ -1797,6 +2092,11 @@ int ncStopInstanceStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId)
         // extract the fields from reponse
     }
 
+    EUCA_FREE(correlation_id);
+    if (output)
+        adb_ncStopInstanceResponse_free(output, env);
+    adb_ncStopInstance_free(input, env);
+
     return (status);
 }
 
@@ -472,6 +472,32 @@ int ncStubDestroy(ncStub * pStub)
     return (EUCA_OK);
 }
 
+//!
+//! Sets the transport timeout of the stub (no transport is used here)
+//!
+//! @param[in] pStub a pointer to the node controller (NC) stub structure
+//! @param[in] timeoutMs the timeout in milliseconds
+//!
+//! @return Always returns EUCA_OK
+//!
+int ncStubSetTimeout(ncStub * pStub, long timeoutMs)
+{
+    return (EUCA_OK);
+}
+
+//!
+//! Requests persistent connections for the stub (no transport is used here)
+//!
+//! @param[in] pStub a pointer to the node controller (NC) stub structure
+//! @param[in] keepAlive set to TRUE to request persistent connections
+//!
+//! @return Always returns EUCA_OK
+//!
+int ncStubSetKeepAlive(ncStub * pStub, boolean keepAlive)
+{
+    return (EUCA_OK);
+}
+
 //! Handles the client broadcast network info rquest
 //!
 //! @param[in] pStub a pointer to the node controller (NC) stub structure
@@ -733,6 +759,36 @@ int ncDescribeInstancesStub(ncStub * pStub, ncMetadata * pMeta, char **instIds,
     return (EUCA_OK);
 }
 
+//!
+//! Handles the client describe instance request asking for the changes since a
+//! previous request. The fake NC does not track changes and always returns
+//! its full list.
+//!
+//! @param[in]  pStub a pointer to the node controller (NC) stub structure
+//! @param[in]  pMeta a pointer to the node controller (NC) metadata structure
+//! @param[in]  sinceEpoch UNUSED
+//! @param[in]  sinceSeq UNUSED
+//! @param[out] outInsts a pointer the list of instances for which we have data
+//! @param[out] outInstsLen the number of instances in the outInsts list.
+//! @param[out] removedIds always set to NULL
+//! @param[out] removedIdsLen always set to 0
+//! @param[out] outEpoch always set to 0
+//! @param[out] outSeq always set to 0
+//! @param[out] isDelta always set to FALSE
+//!
+//! @return the result of ncDescribeInstancesStub()
+//!
+int ncDescribeInstancesSinceStub(ncStub * pStub, ncMetadata * pMeta, long long sinceEpoch, long long sinceSeq, ncInstance *** outInsts, int *outInstsLen,
+                                 char ***removedIds, int *removedIdsLen, long long *outEpoch, long long *outSeq, boolean * isDelta)
+{
+    *removedIds = NULL;
+    *removedIdsLen = 0;
+    *outEpoch = 0;
+    *outSeq = 0;
+    *isDelta = FALSE;
+    return (ncDescribeInstancesStub(pStub, pMeta, NULL, 0, outInsts, outInstsLen));
+}
+
 //!
 //! Handles the client bundle instance request.
 //!
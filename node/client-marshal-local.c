@@ -173,6 +173,32 @@ int ncStubDestroy(ncStub * pStub)
     return (EUCA_OK);
 }
 
+//!
+//! Sets the transport timeout of the stub (no transport is used here)
+//!
+//! @param[in] pStub a pointer to the node controller (NC) stub structure
+//! @param[in] timeoutMs the timeout in milliseconds
+//!
+//! @return Always returns EUCA_OK
+//!
+int ncStubSetTimeout(ncStub * pStub, long timeoutMs)
+{
+    return (EUCA_OK);
+}
+
+//!
+//! Requests persistent connections for the stub (no transport is used here)
+//!
+//! @param[in] pStub a pointer to the node controller (NC) stub structure
+//! @param[in] keepAlive set to TRUE to request persistent connections
+//!
+//! @return Always returns EUCA_OK
+//!
+int ncStubSetKeepAlive(ncStub * pStub, boolean keepAlive)
+{
+    return (EUCA_OK);
+}
+
 //!
 //! Handles the Run instance request
 //!
@@ -301,6 +327,32 @@ int ncDescribeInstancesStub(ncStub * pStub, ncMetadata * pMeta, char **instIds,
     return doDescribeInstances(pMeta, instIds, instIdsLen, outInsts, outInstsLen);
 }
 
+//!
+//! Handles the client describe instance request asking for the changes since a
+//! previous request.
+//!
+//! @param[in]  pStub a pointer to the node controller (NC) stub structure
+//! @param[in]  pMeta a pointer to the node controller (NC) metadata structure
+//! @param[in]  sinceEpoch the sequence epoch returned by the previous request
+//! @param[in]  sinceSeq the sequence number returned by the previous request (0 for a full list)
+//! @param[out] outInsts a pointer the list of instances for which we have data
+//! @param[out] outInstsLen the number of instances in the outInsts list.
+//! @param[out] removedIds a pointer to the list of identifiers of the instances removed since sinceSeq
+//! @param[out] removedIdsLen the number of identifiers in the removedIds list
+//! @param[out] outEpoch the sequence epoch to send with the next request
+//! @param[out] outSeq the sequence number to send with the next request
+//! @param[out] isDelta set to TRUE if only the changes were returned
+//!
+//! @return the result of doDescribeInstancesSince()
+//!
+//! @see doDescribeInstancesSince()
+//!
+int ncDescribeInstancesSinceStub(ncStub * pStub, ncMetadata * pMeta, long long sinceEpoch, long long sinceSeq, ncInstance *** outInsts, int *outInstsLen,
+                                 char ***removedIds, int *removedIdsLen, long long *outEpoch, long long *outSeq, boolean * isDelta)
+{
+    return doDescribeInstancesSince(pMeta, sinceEpoch, sinceSeq, outInsts, outInstsLen, removedIds, removedIdsLen, outEpoch, outSeq, isDelta);
+}
+
 //!
 //! Handles the client bundle instance request.
 //!
@@ -128,6 +128,8 @@ typedef struct ncStub_t {
 
 ncStub *ncStubCreate(char *endpoint, char *logfile, char *homedir);
 int ncStubDestroy(ncStub * stub);
+int ncStubSetTimeout(ncStub * pStub, long timeoutMs);
+int ncStubSetKeepAlive(ncStub * pStub, boolean keepAlive);
 
 int ncRunInstanceStub(ncStub * pStub, ncMetadata * pMeta, char *uuid, char *instanceId, char *reservationId, virtualMachine * params, char *imageId,
                       char *imageURL, char *kernelId, char *kernelURL, char *ramdiskId, char *ramdiskURL, char *ownerId, char *accountId,
@@ -137,6 +139,8 @@ int ncGetConsoleOutputStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId,
 int ncRebootInstanceStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId);
 int ncTerminateInstanceStub(ncStub * pStub, ncMetadata * pMeta, char *instanceId, int force, int *shutdownState, int *previousState);
 int ncDescribeInstancesStub(ncStub * pStub, ncMetadata * pMeta, char **instIds, int instIdsLen, ncInstance *** outInsts, int *outInstsLen);
+int ncDescribeInstancesSinceStub(ncStub * pStub, ncMetadata * pMeta, long long sinceEpoch, long long sinceSeq, ncInstance *** outInsts, int *outInstsLen,
+                                 char ***removedIds, int *removedIdsLen, long long *outEpoch, long long *outSeq, boolean * isDelta);
 int ncDescribeResourceStub(ncStub * pStub, ncMetadata * pMeta, char *resourceType, ncResource ** outRes);
 int ncStartNetworkStub(ncStub * pStub, ncMetadata * pMeta, char *uuid, char **peers, int peersLen, int port, int vlan, char **outStatus);
 int ncBroadcastNetworkInfoStub(ncStub * pStub, ncMetadata * pMeta, char *networkInfo);
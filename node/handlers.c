@@ -82,6 +82,7 @@
 #include <time.h>
 #include <limits.h>                    /* INT_MAX */
 #include <sys/unistd.h>
+#include <stddef.h>                    /* offsetof */
 #include <sys/types.h>                 /* fork */
 #include <sys/wait.h>                  /* waitpid */
 #include <unistd.h>
@@ -149,6 +150,7 @@
 #define FS_BUFFER_PERCENT                            0.03   //!< leave 3% extra when deciding on blobstore sizes automatically
 #define WORK_BS_PERCENT                              0.33   //!< give a third of available space to work, the rest to cache
 #define MAX_CONNECTION_ERRORS                        5
+#define MAX_REMOVED_INSTANCES                        1024   //!< how many instance removals are remembered for delta describe requests
 
 /*----------------------------------------------------------------------------*\
  |                                                                            |
@@ -168,6 +170,12 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+//! An instance that disappeared from the copied instance list
+typedef struct removedInstance_t {
+    char instanceId[CHAR_BUFFER_SIZE]; //!< identifier of the removed instance
+    long long changeSeq;               //!< change sequence number assigned to the removal (0 if the slot is unused)
+} removedInstance;
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                             EXTERNAL VARIABLES                             |
@@ -262,6 +270,15 @@ static json_object *stats_json = NULL; //!< The json object that holds all of th
 static int stats_sensor_interval_sec;  //!< Keeps the current value for sensor interval. Set during init
 static int hypervisor_conn_errors = 0;
 
+//! @{
+//! @name change tracking of the copied instance list, all guarded by inst_copy_sem
+static long long instance_change_epoch = 0;    //!< identifies this incarnation of the sequence; a CC holding another epoch gets a full list
+static long long instance_change_seq = 0;  //!< last change sequence number handed out
+static long long instance_removed_floor = 0;   //!< removals at or below this sequence number may have been forgotten
+static removedInstance removed_instances[MAX_REMOVED_INSTANCES] = { {{0}} };    //!< ring of the most recent removals
+static int removed_instances_next = 0; //!< next slot of the ring to use
+//! @}
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                              STATIC PROTOTYPES                             |
@@ -270,6 +287,8 @@ static int hypervisor_conn_errors = 0;
 
 static void *libvirt_thread(void *ptr);
 static void refresh_instance_info(struct nc_state_t *nc, ncInstance * instance);
+static ncInstance *find_copied_instance(bunchOfInstances * list, bunchOfInstances ** cursor, const char *instanceId);
+static void remember_removed_instance(const char *instanceId);
 static void update_log_params(void);
 static void update_ebs_params(void);
 static void nc_signal_handler(int sig);
@@ -1379,37 +1398,111 @@ static void refresh_instance_info(struct nc_state_t *nc, ncInstance * instance)
     save_instance_struct(instance);
 }
 
+//!
+//! Looks up an instance in a copied instance list. Successive copies of the list
+//! keep the same order, so the entry following the previous match is tried first
+//! before falling back to a scan of the whole list.
+//!
+//! @param[in]     list the copied instance list to search
+//! @param[in,out] cursor the entry expected to match; advanced past the match on success
+//! @param[in]     instanceId the identifier of the instance to look for
+//!
+//! @return a pointer to the matching instance or NULL if it is not in the list
+//!
+static ncInstance *find_copied_instance(bunchOfInstances * list, bunchOfInstances ** cursor, const char *instanceId)
+{
+    bunchOfInstances *head = NULL;
+
+    if (*cursor && !strcmp((*cursor)->instance->instanceId, instanceId)) {
+        head = *cursor;
+        *cursor = head->next;
+        return (head->instance);
+    }
+
+    for (head = list; head; head = head->next) {
+        if (!strcmp(head->instance->instanceId, instanceId)) {
+            *cursor = head->next;
+            return (head->instance);
+        }
+    }
+    return (NULL);
+}
+
+//!
+//! Records the removal of an instance from the copied list so that a delta
+//! describe request can report it. When the ring is full the oldest removal is
+//! forgotten and the floor is raised so that a CC which could have missed it is
+//! sent the full list instead.
+//!
+//! @param[in] instanceId the identifier of the removed instance
+//!
+//! @pre inst_copy_sem is held
+//!
+static void remember_removed_instance(const char *instanceId)
+{
+    removedInstance *removed = &removed_instances[removed_instances_next];
+
+    if (removed->changeSeq > instance_removed_floor)
+        instance_removed_floor = removed->changeSeq;
+
+    euca_strncpy(removed->instanceId, instanceId, CHAR_BUFFER_SIZE);
+    removed->changeSeq = ++instance_change_seq;
+    removed_instances_next = (removed_instances_next + 1) % MAX_REMOVED_INSTANCES;
+}
+
 //!
 //! copying the linked list for use by Describe* requests
 //!
+//! Every copied instance carries the change sequence number of its last
+//! modification: instances identical to their previous copy keep their number,
+//! new or modified ones get a fresh one, and the ones that disappeared are
+//! remembered with theirs. This is what doDescribeInstancesSince() relies on.
+//!
 void copy_instances(void)
 {
     ncInstance *instance = NULL;
     ncInstance *src_instance = NULL;
     ncInstance *dst_instance = NULL;
+    ncInstance *old_instance = NULL;
     bunchOfInstances *head = NULL;
     bunchOfInstances *container = NULL;
+    bunchOfInstances *old_copy = NULL;
+    bunchOfInstances *cursor = NULL;
 
     sem_p(inst_copy_sem);
     {
-        // free the old linked list copy
-        for (head = global_instances_copy; head;) {
-            container = head;
-            instance = head->instance;
-            head = head->next;
-            EUCA_FREE(instance);
-            EUCA_FREE(container);
-        }
+        if (instance_change_epoch == 0)
+            instance_change_epoch = time_usec();
 
+        old_copy = global_instances_copy;
         global_instances_copy = NULL;
 
         // make a fresh copy
+        cursor = old_copy;
         for (head = global_instances; head; head = head->next) {
             src_instance = head->instance;
             dst_instance = (ncInstance *) EUCA_ALLOC(1, sizeof(ncInstance));
             memcpy(dst_instance, src_instance, sizeof(ncInstance));
+
+            old_instance = find_copied_instance(old_copy, &cursor, dst_instance->instanceId);
+            if (old_instance && !memcmp(old_instance, dst_instance, offsetof(ncInstance, changeSeq)))
+                dst_instance->changeSeq = old_instance->changeSeq;
+            else
+                dst_instance->changeSeq = ++instance_change_seq;
             add_instance(&global_instances_copy, dst_instance);
         }
+
+        // free the old linked list copy, remembering what is gone
+        cursor = global_instances_copy;
+        for (head = old_copy; head;) {
+            container = head;
+            instance = head->instance;
+            head = head->next;
+            if (!find_copied_instance(global_instances_copy, &cursor, instance->instanceId))
+                remember_removed_instance(instance->instanceId);
+            EUCA_FREE(instance);
+            EUCA_FREE(container);
+        }
     }
     sem_v(inst_copy_sem);
 }
@@ -3193,6 +3286,99 @@ int doDescribeInstances(ncMetadata * pMeta, char **instIds, int instIdsLen, ncIn
     return (EUCA_OK);
 }
 
+//!
+//! Handles a describe instance request from a CC that already knows the state
+//! of this NC's instances up to a given change sequence number. Only the
+//! instances modified after that point and the identifiers of the instances
+//! removed after it are returned. The full list is returned instead (and
+//! isDelta is cleared) when the CC's sequence number comes from another
+//! incarnation of the NC, is in the future or is older than the removals
+//! this NC still remembers.
+//!
+//! @param[in]  pMeta a pointer to the node controller (NC) metadata structure
+//! @param[in]  sinceEpoch the sequence epoch returned to the CC by its previous request
+//! @param[in]  sinceSeq the sequence number returned to the CC by its previous request (0 for a full list)
+//! @param[out] outInsts a pointer the list of instances for which we have data
+//! @param[out] outInstsLen the number of instances in the outInsts list.
+//! @param[out] removedIds a pointer to the list of identifiers of the removed instances
+//! @param[out] removedIdsLen the number of identifiers in the removedIds list
+//! @param[out] outEpoch the current sequence epoch, to be sent back on the next request
+//! @param[out] outSeq the current sequence number, to be sent back on the next request
+//! @param[out] isDelta set to TRUE if only the changes were returned
+//!
+//! @return EUCA_OK on success or the error code returned by doDescribeInstances()
+//!
+int doDescribeInstancesSince(ncMetadata * pMeta, long long sinceEpoch, long long sinceSeq, ncInstance *** outInsts, int *outInstsLen, char ***removedIds,
+                             int *removedIdsLen, long long *outEpoch, long long *outSeq, boolean * isDelta)
+{
+    int i = 0;
+    int j = 0;
+    int ret = EUCA_OK;
+    long long epoch = 0;
+    long long seq = 0;
+    boolean delta = FALSE;
+    char **ids = NULL;
+    int idsLen = 0;
+
+    *removedIds = NULL;
+    *removedIdsLen = 0;
+    *isDelta = FALSE;
+
+    // anything that changes after this point will have a higher number and be sent again next time
+    sem_p(inst_copy_sem);
+    {
+        if (instance_change_epoch == 0)
+            instance_change_epoch = time_usec();
+        epoch = instance_change_epoch;
+        seq = instance_change_seq;
+
+        if ((sinceEpoch == epoch) && (sinceSeq > 0) && (sinceSeq >= instance_removed_floor) && (sinceSeq <= seq)) {
+            delta = TRUE;
+            for (i = 0; i < MAX_REMOVED_INSTANCES; i++) {
+                if (removed_instances[i].changeSeq > sinceSeq)
+                    idsLen++;
+            }
+
+            if ((idsLen > 0) && ((ids = EUCA_ZALLOC(idsLen, sizeof(char *))) == NULL)) {
+                sem_v(inst_copy_sem);
+                return (EUCA_MEMORY_ERROR);
+            }
+
+            for (i = 0, j = 0; (i < MAX_REMOVED_INSTANCES) && (j < idsLen); i++) {
+                if (removed_instances[i].changeSeq > sinceSeq)
+                    ids[j++] = strdup(removed_instances[i].instanceId);
+            }
+        }
+    }
+    sem_v(inst_copy_sem);
+
+    if ((ret = doDescribeInstances(pMeta, NULL, 0, outInsts, outInstsLen)) != EUCA_OK) {
+        for (i = 0; i < idsLen; i++)
+            EUCA_FREE(ids[i]);
+        EUCA_FREE(ids);
+        return (ret);
+    }
+
+    if (delta) {
+        // only keep what the CC has not seen yet
+        for (i = 0, j = 0; i < (*outInstsLen); i++) {
+            if ((*outInsts)[i]->changeSeq > sinceSeq)
+                (*outInsts)[j++] = (*outInsts)[i];
+            else
+                EUCA_FREE((*outInsts)[i]);
+        }
+        *outInstsLen = j;
+        LOGTRACE("returning %d changed and %d removed instances since %lld (now at %lld)\n", j, idsLen, sinceSeq, seq);
+    }
+
+    *removedIds = ids;
+    *removedIdsLen = idsLen;
+    *outEpoch = epoch;
+    *outSeq = seq;
+    *isDelta = delta;
+    return (EUCA_OK);
+}
+
 //!
 //! Handles the broadcast network info request
 //!
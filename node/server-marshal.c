@@ -655,7 +655,15 @@ adb_ncDescribeInstancesResponse_t *ncDescribeInstancesMarshal(adb_ncDescribeInst
     int error = EUCA_OK;
     int instIdsLen = 0;
     int outInstsLen = 0;
+    int removedIdsLen = 0;
     char **instIds = NULL;
+    char **removedIds = NULL;
+    boolean sinceRequested = FALSE;
+    boolean isDelta = FALSE;
+    long long sinceEpoch = 0;
+    long long sinceSeq = 0;
+    long long outEpoch = 0;
+    long long outSeq = 0;
     ncMetadata meta = { 0 };
     ncInstance **outInsts = NULL;
     adb_instanceType_t *instance = NULL;
@@ -679,10 +687,24 @@ adb_ncDescribeInstancesResponse_t *ncDescribeInstancesMarshal(adb_ncDescribeInst
                 instIds[i] = adb_ncDescribeInstancesType_get_instanceIds_at(input, env, i);
             }
 
+            // a CC asking for the changes since its last request (only honored when describing all instances)
+            if ((instIdsLen == 0) && !adb_ncDescribeInstancesType_is_changedSince_nil(input, env)) {
+                sinceRequested = TRUE;
+                sinceSeq = adb_ncDescribeInstancesType_get_changedSince(input, env);
+                if (!adb_ncDescribeInstancesType_is_seqEpoch_nil(input, env))
+                    sinceEpoch = adb_ncDescribeInstancesType_get_seqEpoch(input, env);
+            }
+
             // do it
             EUCA_MESSAGE_UNMARSHAL(ncDescribeInstancesType, input, (&meta));
             threadCorrelationId *corr_id = set_corrid(meta.correlationId);
-            if ((error = doDescribeInstances(&meta, instIds, instIdsLen, &outInsts, &outInstsLen)) != EUCA_OK) {
+            if (sinceRequested) {
+                error = doDescribeInstancesSince(&meta, sinceEpoch, sinceSeq, &outInsts, &outInstsLen, &removedIds, &removedIdsLen, &outEpoch, &outSeq, &isDelta);
+            } else {
+                error = doDescribeInstances(&meta, instIds, instIdsLen, &outInsts, &outInstsLen);
+            }
+
+            if (error != EUCA_OK) {
                 LOGERROR("failed error=%d\n", error);
                 adb_ncDescribeInstancesResponseType_set_return(output, env, AXIS2_FALSE);
             } else {
@@ -702,6 +724,18 @@ adb_ncDescribeInstancesResponse_t *ncDescribeInstancesMarshal(adb_ncDescribeInst
                 }
 
                 EUCA_FREE(outInsts);
+
+                // the sequence fields are only sent to a CC that asked for them
+                if (sinceRequested) {
+                    adb_ncDescribeInstancesResponseType_set_seqEpoch(output, env, outEpoch);
+                    adb_ncDescribeInstancesResponseType_set_currentSeq(output, env, outSeq);
+                    adb_ncDescribeInstancesResponseType_set_isDelta(output, env, ((isDelta) ? AXIS2_TRUE : AXIS2_FALSE));
+                    for (i = 0; i < removedIdsLen; i++) {
+                        adb_ncDescribeInstancesResponseType_add_removedInstanceIds(output, env, removedIds[i]);
+                        EUCA_FREE(removedIds[i]);
+                    }
+                    EUCA_FREE(removedIds);
+                }
             }
             unset_corrid(corr_id);
         }
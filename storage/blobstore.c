@@ -92,6 +92,10 @@
 #include <sys/types.h>                 // gettid
 #include <regex.h>
 #include <libgen.h>                    // basename
+#include <fcntl.h>                     // fallocate
+#include <sys/ioctl.h>
+#include <linux/fs.h>                  // FIDEDUPERANGE, FS_IOC_FIEMAP
+#include <linux/fiemap.h>
 
 #include <eucalyptus.h>                // euca user
 #include <misc.h>                      // ensure_...
@@ -112,6 +116,12 @@
 \*----------------------------------------------------------------------------*/
 
 #define BLOBSTORE_METADATA_FILE                  ".blobstore"
+#define BLOBSTORE_JOURNAL_FILE                   ".blobstore.journal"   //!< snapshot of the blob index followed by the changes made since
+#define BLOBSTORE_JOURNAL_TMP_FILE               ".blobstore.journal.tmp"
+#define BLOBSTORE_JOURNAL_MAX_RECORDS               4096    //!< compact the journal past this many records, if that is more than twice the number of blobs
+#define BLOBSTORE_JOURNAL_APPEND_TRIES                 8    //!< times a record is retried when the journal keeps being replaced under it
+#define BLOBSTORE_INDEX_BUCKETS                      256    //!< hash buckets of the in-memory blob index
+#define BOOT_ID_PATH                             "/proc/sys/kernel/random/boot_id"
 #define BLOBSTORE_METADATA_TIMEOUT_USEC          (1000000LL * 60 * 2)   //!< it may take dozens of seconds to open blobstore when others are LRU-purging it
 #define BLOBSTORE_LOCK_TIMEOUT_USEC               500000LL
 #define BLOBSTORE_FIND_TIMEOUT_USEC                50000LL
@@ -175,6 +185,22 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+//! A content-addressed chunk and the blobs of a store referencing it
+typedef struct _blobstore_chunk {
+    unsigned long long key;            //!< hash of the chunk content (0 = unused slot)
+    unsigned long long blocks;         //!< blocks taken by the chunk
+    unsigned int refs;                 //!< number of references from blobs in the store
+    unsigned int opened_refs;          //!< ...of which from blobs that are opened
+    const blockblob *holder;           //!< a blob holding the chunk, to share it from (NULL if none)
+    unsigned int holder_idx;           //!< index of the chunk in that blob
+} blobstore_chunk;
+
+//! Open-addressed table of the chunks referenced by the blobs of a store
+typedef struct _blobstore_chunks {
+    blobstore_chunk *slots;            //!< the table, NULL if no blob in the store is deduplicated
+    unsigned int size;                 //!< number of slots, a power of two
+} blobstore_chunks;
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                ENUMERATIONS                                |
@@ -192,6 +218,7 @@ typedef enum {                         //!< paths to files containing...
     BLOCKBLOB_PATH_SIG,                //!< ...signature of the blob, if provided from outside
     BLOCKBLOB_PATH_REFS,               //!< ...names of blockblobs that depend on this blockblob, if any
     BLOCKBLOB_PATH_HOLLOW,             //!< ...nothing, but the file acts as a marker of 'hollow' blobs
+    BLOCKBLOB_PATH_CHUNKS,             //!< ...hashes of the blob's chunks, if it was deduplicated
     BLOCKBLOB_PATH_TOTAL,
 } blockblob_path_t;
 
@@ -222,6 +249,20 @@ typedef struct _blobstore_filelock {
     struct _blobstore_filelock *next;  //!< pointer for constructing a LL
 } blobstore_filelock;
 
+//! In-memory index of the blobs in a blobstore, kept current by replaying the journal
+typedef struct _blobstore_index {
+    char path[PATH_MAX];               //!< path of the blobstore
+    boolean loaded;                    //!< the entries reflect the journal up to journal_offset
+    dev_t journal_dev;                 //!< device of the journal that was replayed
+    ino_t journal_ino;                 //!< inode of the journal that was replayed
+    off_t journal_offset;              //!< how much of the journal has been replayed
+    char header[128];                  //!< first line of the journal that was replayed, changes when someone compacts it
+    unsigned int records;              //!< number of records in the journal
+    unsigned int num_blobs;            //!< number of blobs in the index
+    blockblob *buckets[BLOBSTORE_INDEX_BUCKETS];    //!< blobs hashed by ID, chained through their next pointers
+    struct _blobstore_index *next;     //!< pointer for constructing a LL
+} blobstore_index;
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                             EXTERNAL VARIABLES                             |
@@ -282,6 +323,7 @@ static const char *blobstore_metadata_suffixes[] = {
     "sig",
     "refs",
     "hollow",
+    "chunks",
 };
 
 static void (*err_fn) (const char *msg) = NULL;
@@ -289,6 +331,8 @@ static unsigned char _do_print_errors = 1;
 static unsigned char _do_print_trace = 1;
 static pthread_mutex_t _blobstore_mutex = PTHREAD_MUTEX_INITIALIZER;    //!< process-global mutex
 static blobstore_filelock *locks_list = NULL;   //!< process-global LL head @TODO replace this with a hash table
+static pthread_mutex_t _index_mutex = PTHREAD_MUTEX_INITIALIZER;    //!< protects the list below, each index is protected by the blobstore lock
+static blobstore_index *indexes = NULL; //!< process-global LL of blobstore indexes
 
 //! @{
 //! @name debugging counters
@@ -367,10 +411,36 @@ static int ensure_blockblob_metadata_path(const blobstore * bs, const char *bb_i
 static void free_bbs(blockblob * bbs);
 static unsigned int check_in_use(blobstore * bs, const char *bb_id, long long timeout_usec);
 static void set_device_path(blockblob * bb);
+static blockblob *load_blockblob(blobstore * bs, const char *blob_id, const char *blocks_path, const struct stat *sb);
 static blockblob **walk_bs(blobstore * bs, const char *dir_path, blockblob ** tail_bb, const blockblob * bb_to_avoid);
+static blockblob *walk_blobstore(blobstore * bs, const blockblob * bb_to_avoid);
+static void journal_blockblob(const blobstore * bs, char op, const char *bb_id);
+static blobstore_index *get_index(const blobstore * bs);
+static unsigned int index_bucket(const char *bb_id);
+static void clear_index(blobstore_index * idx);
+static void put_index(blobstore_index * idx, blockblob * bb);
+static void remove_index(blobstore_index * idx, const char *bb_id);
+static blockblob *find_index(blobstore_index * idx, const char *bb_id);
+static int read_boot_id(char *boot_id, size_t boot_id_size);
+static int replay_journal(blobstore * bs, blobstore_index * idx);
+static int verify_index(blobstore_index * idx);
+static int snapshot_index(blobstore * bs, blobstore_index * idx, boolean catch_up);
+static int rebuild_index(blobstore * bs, blobstore_index * idx);
+static blockblob *copy_index(blobstore * bs, const blobstore_index * idx, const blockblob * bb_to_avoid);
 static blockblob *scan_blobstore(blobstore * bs, const blockblob * bb_to_avoid);
+static blockblob *rescan_blobstore(blobstore * bs, const blockblob * bb_to_avoid);
 static int compare_bbs(const void *bb1, const void *bb2);
-static long long purge_blockblobs_lru(blobstore * bs, blockblob * bb_list, long long need_blocks);
+static int read_blockblob_chunks(blockblob * bb);
+static unsigned long long chunk_blocks(const blockblob * bb, unsigned int idx);
+static blobstore_chunk *find_chunk(blobstore_chunks * table, unsigned long long key, boolean insert);
+static int build_chunks(blobstore_chunks * table, const blockblob * bbs, unsigned int extra);
+static long long release_chunks(blobstore_chunks * table, const blockblob * bb);
+static void sum_blockblobs(const blockblob * bbs, const blobstore_chunks * table, boolean skip_hollow, long long *blocks_locked, long long *blocks_unlocked);
+static int compare_extents(const void *e1, const void *e2);
+static unsigned long long physical_blocks(const blockblob * bbs);
+static unsigned long long hash_chunk(const char *buf, size_t len);
+static int share_chunk(int src_fd, off_t src_offset, int dst_fd, off_t dst_offset, size_t len);
+static long long purge_blockblobs_lru(blobstore * bs, blockblob * bb_list, blobstore_chunks * chunks, long long need_blocks);
 static int get_stale_refs(const blockblob * bb, char ***refs);
 static int loop_remove(blobstore * bs, const char *bb_id);
 static int dm_suspend_resume(const char *dev_name);
@@ -392,6 +462,8 @@ static char read_byte(blockblob * bb, int seek);
 static int do_clone_stresstest(const char *base, const char *name, blobstore_format_t format, blobstore_revocation_t revocation, blobstore_snapshot_t snapshot);
 static int check_destination(blockblob * bb4, char *op);
 static int do_copy_test(const char *base, const char *name);
+static int do_dedup_test(const char *base, const char *name);
+static int do_index_test(const char *base, const char *name);
 static int do_clone_test(const char *base, const char *name, blobstore_format_t format, blobstore_revocation_t revocation, blobstore_snapshot_t snapshot, int copy_or_snapshot);
 static int do_metadata_test(const char *base, const char *name);
 static int do_blobstore_test(const char *base, const char *name, blobstore_format_t format, blobstore_revocation_t revocation);
@@ -1702,6 +1774,8 @@ int blobstore_delete(blobstore * bs)
     snprintf(meta_path, sizeof(meta_path), "%s/%s", bs->path, BLOBSTORE_METADATA_FILE);
     LOGINFO("removing blobstore metadata '%s'\n", meta_path);
     unlink(meta_path);
+    snprintf(meta_path, sizeof(meta_path), "%s/%s", bs->path, BLOBSTORE_JOURNAL_FILE);
+    unlink(meta_path);
     EUCA_FREE(bs);
 
     return EUCA_OK;
@@ -1774,6 +1848,9 @@ static int set_blockblob_metadata_path(blockblob_path_t path_t, const blobstore
     case BLOCKBLOB_PATH_HOLLOW:
         euca_strncpy(name, blobstore_metadata_suffixes[BLOCKBLOB_PATH_HOLLOW], sizeof(name));
         break;
+    case BLOCKBLOB_PATH_CHUNKS:
+        euca_strncpy(name, blobstore_metadata_suffixes[BLOCKBLOB_PATH_CHUNKS], sizeof(name));
+        break;
     default:
         ERR(BLOBSTORE_ERROR_INVAL, "invalid path_t");
         return -1;
@@ -1922,6 +1999,10 @@ static int write_array_blockblob_metadata_path(blockblob_path_t path_t, const bl
         PROPAGATE_ERR(BLOBSTORE_ERROR_UNKNOWN);
         ret = -1;
     }
+    // these determine whether the blob is in use and how much space it takes, so let the index know
+    if ((path_t == BLOCKBLOB_PATH_REFS) || (path_t == BLOCKBLOB_PATH_DEPS) || (path_t == BLOCKBLOB_PATH_DM) || (path_t == BLOCKBLOB_PATH_CHUNKS)) {
+        journal_blockblob(bs, '+', bb_id);
+    }
 
     return (ret);
 }
@@ -2250,6 +2331,9 @@ static int delete_blockblob_files(const blobstore * bs, const char *bb_id)
         }
     }
 
+    if (count > 0)
+        journal_blockblob(bs, '-', bb_id);
+
     return count;
 }
 
@@ -2285,6 +2369,7 @@ static void free_bbs(blockblob * bbs)
 {
     while (bbs) {
         blockblob *next_bb = bbs->next;
+        EUCA_FREE(bbs->chunks);
         EUCA_FREE(bbs);
         bbs = next_bb;
     }
@@ -2399,7 +2484,8 @@ int blobstore_delete_nonblobs(blobstore * bs, const char *dir_path)
     while ((dir_entry = readdir(dir)) != NULL) {
         char *entry_name = dir_entry->d_name;
 
-        if (!strcmp(".", entry_name) || !strcmp("..", entry_name) || !strcmp(BLOBSTORE_METADATA_FILE, entry_name))
+        if (!strcmp(".", entry_name) || !strcmp("..", entry_name) || !strcmp(BLOBSTORE_METADATA_FILE, entry_name)
+            || !strcmp(BLOBSTORE_JOURNAL_FILE, entry_name) || !strcmp(BLOBSTORE_JOURNAL_TMP_FILE, entry_name))
             continue;                  // ignore known unrelated files
 
         // get the path of the directory item
@@ -2421,6 +2507,73 @@ int blobstore_delete_nonblobs(blobstore * bs, const char *dir_path)
     return ndeleted;
 }
 
+//!
+//! Fills out a blockblob struct from the files of a blob found in the blobstore
+//!
+//! @param[in] bs the blobstore
+//! @param[in] blob_id the ID of the blob
+//! @param[in] blocks_path path of the .blocks file of the blob
+//! @param[in] sb result of stat() on the .blocks file
+//!
+//! @return a new blockblob, to be freed with free_bbs(), or NULL if out of memory
+//!
+static blockblob *load_blockblob(blobstore * bs, const char *blob_id, const char *blocks_path, const struct stat *sb)
+{
+    blockblob *bb = EUCA_ZALLOC(1, sizeof(blockblob));
+    if (bb == NULL) {
+        return NULL;
+    }
+    // fill out the struct
+    bb->store = bs;
+    euca_strncpy(bb->id, blob_id, sizeof(bb->id));
+    euca_strncpy(bb->blocks_path, blocks_path, sizeof(bb->blocks_path));
+    set_device_path(bb);               // read .dm and .loopback and set bb->device_path accordingly
+    bb->size_bytes = sb->st_size;
+    bb->blocks_allocated = sb->st_blocks;
+    bb->last_accessed = sb->st_atime;
+    bb->last_modified = sb->st_mtime;
+    bb->snapshot_type = BLOBSTORE_FORMAT_ANY;   // it is not necessary to know whether this is a snapshot
+    bb->in_use = check_in_use(bs, bb->id, 0);
+
+    // see if it's hollow
+    char buf[64];
+    if (read_blockblob_metadata_path(BLOCKBLOB_PATH_HOLLOW, bb->store, bb->id, buf, sizeof(buf)) != -1) {
+        bb->is_hollow = TRUE;
+    }
+    // if there is a .refs file, subtract the mapped blocks, if any, from the size
+    char **array = NULL;
+    int array_size = 0;
+    if (read_array_blockblob_metadata_path(BLOCKBLOB_PATH_DEPS, bb->store, bb->id, &array, &array_size) != -1) {
+        for (int i = 0; i < array_size; i++) {
+            char *store_path = NULL;
+            char *blob_id = NULL;
+            char *rel_type = NULL;
+            char *start_block = NULL;
+            char *len_blocks = NULL;
+
+            store_path = strtok(array[i], " ");
+            blob_id = strtok(NULL, " ");
+            rel_type = strtok(NULL, " ");
+            start_block = strtok(NULL, " ");
+            len_blocks = strtok(NULL, " ");
+            if (rel_type && len_blocks && strcmp(rel_type, blobstore_relation_type_name[BLOBSTORE_MAP]) == 0) {
+                bb->size_bytes -= strtoull(len_blocks, NULL, 0) * 512LL;
+            }
+        }
+    }
+
+    if (array) {
+        for (int i = 0; i < array_size; i++)
+            EUCA_FREE(array[i]);
+        EUCA_FREE(array);
+    }
+
+    // if the blob was deduplicated, the space it takes is accounted by chunk
+    read_blockblob_chunks(bb);
+
+    return bb;
+}
+
 //!
 //!
 //!
@@ -2446,7 +2599,8 @@ static blockblob **walk_bs(blobstore * bs, const char *dir_path, blockblob ** ta
     while ((dir_entry = readdir(dir)) != NULL) {
         char *entry_name = dir_entry->d_name;
 
-        if (!strcmp(".", entry_name) || !strcmp("..", entry_name) || !strcmp(BLOBSTORE_METADATA_FILE, entry_name))
+        if (!strcmp(".", entry_name) || !strcmp("..", entry_name) || !strcmp(BLOBSTORE_METADATA_FILE, entry_name)
+            || !strcmp(BLOBSTORE_JOURNAL_FILE, entry_name) || !strcmp(BLOBSTORE_JOURNAL_TMP_FILE, entry_name))
             continue;                  // ignore known unrelated files
 
         // get the path of the directory item
@@ -2475,103 +2629,931 @@ static blockblob **walk_bs(blobstore * bs, const char *dir_path, blockblob ** ta
         if (bb_to_avoid != NULL && strncmp(blob_id, bb_to_avoid->id, sizeof(blob_id)) == 0)
             continue;                  // avoid that particular blockblob
 
-        blockblob *bb = EUCA_ZALLOC(1, sizeof(blockblob));
+        blockblob *bb = load_blockblob(bs, blob_id, entry_path, &sb);
         if (bb == NULL) {
             goto free;
         }
         *tail_bb = bb;                 // add to LL
         tail_bb = &(bb->next);
+    }
 
-        // fill out the struct
-        bb->store = bs;
-        euca_strncpy(bb->id, blob_id, sizeof(bb->id));
-        euca_strncpy(bb->blocks_path, entry_path, sizeof(bb->blocks_path));
-        set_device_path(bb);           // read .dm and .loopback and set bb->device_path accordingly
-        bb->size_bytes = sb.st_size;
-        bb->blocks_allocated = sb.st_blocks;
-        bb->last_accessed = sb.st_atime;
-        bb->last_modified = sb.st_mtime;
-        bb->snapshot_type = BLOBSTORE_FORMAT_ANY;   // it is not necessary to know whether this is a snapshot
-        bb->in_use = check_in_use(bs, bb->id, 0);
+free:
+    closedir(dir);
+    return tail_bb;
+}
+
+//!
+//! Runs through the blobstore directory and puts all found blockblobs into a linked list, returning its head
+//!
+//! @param[in] bs
+//! @param[in] bb_to_avoid
+//!
+//! @return A pointer to the head of a linked list containing all found blockblobs
+//!
+//! @pre
+//!
+//! @note
+//!
+static blockblob *walk_blobstore(blobstore * bs, const blockblob * bb_to_avoid)
+{
+    blockblob *bbs = NULL;
+    if (walk_bs(bs, bs->path, &bbs, bb_to_avoid) == NULL) {
+        if (bbs)
+            free_bbs(bbs);
+        bbs = NULL;
+    }
+
+    return bbs;
+}
+
+//!
+//! Appends a record of a change to a blob to the journal of the blobstore. The record is
+//! appended with a single write() to a descriptor opened with O_APPEND, so the blobstore
+//! does not need to be locked. A shared flock() on the journal keeps it from being
+//! replaced by a compaction while the record is written, and a journal that was replaced
+//! before the lock was obtained is reopened, so no record ends up in an unlinked journal.
+//! Without a journal nothing is recorded, since the next scan of the blobstore will walk
+//! it and start a new journal anyway.
+//!
+//! @param[in] bs the blobstore
+//! @param[in] op '+' blob was created or its metadata changed, '-' blob was deleted, 'o' blob was opened, 'c' blob was closed
+//! @param[in] bb_id the ID of the blob
+//!
+//! @see snapshot_index()
+//!
+static void journal_blockblob(const blobstore * bs, char op, const char *bb_id)
+{
+    int fd = -1;
+    int len = 0;
+    char path[PATH_MAX] = "";
+    char record[BLOBSTORE_MAX_PATH + 4] = "";
+    struct stat fd_sb = { 0 };
+    struct stat path_sb = { 0 };
+
+    snprintf(path, sizeof(path), "%s/%s", bs->path, BLOBSTORE_JOURNAL_FILE);
+    len = snprintf(record, sizeof(record), "%c %s\n", op, bb_id);
+    for (int i = 0; i < BLOBSTORE_JOURNAL_APPEND_TRIES; i++) {
+        if ((fd = open(path, O_WRONLY | O_APPEND)) == -1)
+            return;
+        if ((flock(fd, LOCK_SH) == -1) || (fstat(fd, &fd_sb) == -1))
+            break;
+        if (stat(path, &path_sb) == -1) {
+            close(fd);                 // the journal was dropped, the next scan rebuilds the index
+            return;
+        }
+        if ((fd_sb.st_dev != path_sb.st_dev) || (fd_sb.st_ino != path_sb.st_ino)) {
+            close(fd);                 // compacted while we waited for the lock, append to the new journal
+            fd = -1;
+            continue;
+        }
+        if (write(fd, record, len) == len) {
+            close(fd);
+            return;
+        }
+        break;
+    }
+
+    // a lost record may leave the index out of date, so have the next scan rebuild it
+    LOGWARN("failed to journal a change to blob %s, dropping the journal of %s\n", bb_id, bs->path);
+    unlink(path);
+    if (fd != -1)
+        close(fd);
+}
+
+//!
+//! Finds the index of a blobstore, creating an empty one on first use
+//!
+//! @param[in] bs the blobstore
+//!
+//! @return the index or NULL if out of memory
+//!
+static blobstore_index *get_index(const blobstore * bs)
+{
+    blobstore_index *idx = NULL;
+
+    pthread_mutex_lock(&_index_mutex);
+    for (idx = indexes; idx; idx = idx->next) {
+        if (!strcmp(idx->path, bs->path))
+            break;
+    }
+    if ((idx == NULL) && ((idx = EUCA_ZALLOC(1, sizeof(blobstore_index))) != NULL)) {
+        euca_strncpy(idx->path, bs->path, sizeof(idx->path));
+        idx->next = indexes;
+        indexes = idx;
+    }
+    pthread_mutex_unlock(&_index_mutex);
+
+    return idx;
+}
+
+//!
+//! Hashes a blob ID into a bucket of the index
+//!
+//! @param[in] bb_id the ID of the blob
+//!
+//! @return the bucket number
+//!
+static unsigned int index_bucket(const char *bb_id)
+{
+    return (hash_chunk(bb_id, strlen(bb_id)) % BLOBSTORE_INDEX_BUCKETS);
+}
+
+//!
+//! Drops all entries of the index
+//!
+//! @param[in] idx the index
+//!
+static void clear_index(blobstore_index * idx)
+{
+    for (int i = 0; i < BLOBSTORE_INDEX_BUCKETS; i++) {
+        free_bbs(idx->buckets[i]);
+        idx->buckets[i] = NULL;
+    }
+    idx->num_blobs = 0;
+    idx->loaded = FALSE;
+}
+
+//!
+//! Looks up a blob in the index
+//!
+//! @param[in] idx the index
+//! @param[in] bb_id the ID of the blob
+//!
+//! @return the entry of the blob or NULL if it is not in the index
+//!
+static blockblob *find_index(blobstore_index * idx, const char *bb_id)
+{
+    for (blockblob * bb = idx->buckets[index_bucket(bb_id)]; bb; bb = bb->next) {
+        if (!strcmp(bb->id, bb_id))
+            return bb;
+    }
+    return NULL;
+}
+
+//!
+//! Removes a blob from the index, if it is there
+//!
+//! @param[in] idx the index
+//! @param[in] bb_id the ID of the blob
+//!
+static void remove_index(blobstore_index * idx, const char *bb_id)
+{
+    for (blockblob ** pbb = &(idx->buckets[index_bucket(bb_id)]); *pbb; pbb = &((*pbb)->next)) {
+        blockblob *bb = *pbb;
+        if (!strcmp(bb->id, bb_id)) {
+            *pbb = bb->next;
+            bb->next = NULL;
+            free_bbs(bb);
+            idx->num_blobs--;
+            return;
+        }
+    }
+}
+
+//!
+//! Adds a blob to the index, replacing the entry with the same ID, if any
+//!
+//! @param[in] idx the index
+//! @param[in] bb the entry, which now belongs to the index
+//!
+static void put_index(blobstore_index * idx, blockblob * bb)
+{
+    unsigned int i = index_bucket(bb->id);
+
+    remove_index(idx, bb->id);
+    bb->next = idx->buckets[i];
+    idx->buckets[i] = bb;
+    idx->num_blobs++;
+}
+
+//!
+//! Reads the ID of the current boot of the system
+//!
+//! @param[out] boot_id buffer for the ID
+//! @param[in]  boot_id_size size of the buffer
+//!
+//! @return 0 on success or -1 if the ID is not available
+//!
+static int read_boot_id(char *boot_id, size_t boot_id_size)
+{
+    FILE *fp = NULL;
+    char *got = NULL;
+
+    if ((fp = fopen(BOOT_ID_PATH, "r")) == NULL)
+        return -1;
+    got = fgets(boot_id, boot_id_size, fp);
+    fclose(fp);
+    if (got == NULL)
+        return -1;
+    boot_id[strcspn(boot_id, "\n")] = '\0';
+    return ((boot_id[0] != '\0') ? 0 : -1);
+}
+
+//!
+//! Brings the index up to date with the journal of the blobstore. The journal is replayed
+//! from the start if it was compacted since the last replay, otherwise only the records
+//! appended since then are. The journal starts with a header naming the boot during which
+//! it was written, since records appended before a crash of the system may have been lost.
+//!
+//! @param[in] bs the blobstore, which must be locked
+//! @param[in] idx its index
+//!
+//! @return 0 on success or -1 if the journal is missing, unreadable or was written during
+//!         an earlier boot, in which case the index must be rebuilt
+//!
+static int replay_journal(blobstore * bs, blobstore_index * idx)
+{
+    int ret = -1;
+    int fd = -1;
+    char *buf = NULL;
+    char *line = NULL;
+    char *end = NULL;
+    char path[PATH_MAX] = "";
+    char blocks_path[PATH_MAX] = "";
+    char header[sizeof(idx->header)] = "";
+    char boot_id[64] = "";
+    ssize_t n = 0;
+    size_t got = 0;
+    size_t len = 0;
+    off_t header_len = 0;
+    blockblob *bb = NULL;
+    struct stat sb = { 0 };
+    struct stat blocks_sb = { 0 };
+
+    snprintf(path, sizeof(path), "%s/%s", bs->path, BLOBSTORE_JOURNAL_FILE);
+    if ((fd = open(path, O_RDONLY)) == -1)
+        return -1;
+
+    if ((fstat(fd, &sb) == -1) || ((n = pread(fd, header, (sizeof(header) - 1), 0)) <= 0))
+        goto out;
+    header[n] = '\0';
+    if ((end = strchr(header, '\n')) == NULL)
+        goto out;
+    *end = '\0';
+    header_len = (end - header) + 1;
+
+    if (!idx->loaded || (sb.st_dev != idx->journal_dev) || (sb.st_ino != idx->journal_ino) || (sb.st_size < idx->journal_offset)
+        || strcmp(header, idx->header)) {
+        // someone compacted the journal (or this is the first scan), so start over
+        clear_index(idx);
+        if ((read_boot_id(boot_id, sizeof(boot_id)) == -1) || strncmp(header, "# ", 2) || strncmp((header + 2), boot_id, strlen(boot_id))
+            || (header[2 + strlen(boot_id)] != ' ')) {
+            LOGDEBUG("journal of %s was written during an earlier boot, ignoring it\n", bs->path);
+            goto out;
+        }
+        euca_strncpy(idx->header, header, sizeof(idx->header));
+        idx->journal_dev = sb.st_dev;
+        idx->journal_ino = sb.st_ino;
+        idx->journal_offset = header_len;
+        idx->records = 0;
+    }
+
+    len = sb.st_size - idx->journal_offset;
+    if ((buf = EUCA_ALLOC((len + 1), sizeof(char))) == NULL)
+        goto out;
+    while (got < len) {
+        if ((n = pread(fd, (buf + got), (len - got), (idx->journal_offset + got))) <= 0) {
+            if ((n == -1) && (errno == EINTR))
+                continue;
+            break;
+        }
+        got += n;
+    }
+    buf[got] = '\0';
+
+    // a record without its newline is still being appended and is left for the next replay
+    for (line = buf; (end = memchr(line, '\n', ((buf + got) - line))) != NULL; line = end + 1) {
+        unsigned int in_use = 0;
+        unsigned int is_hollow = 0;
+        unsigned int num_chunks = 0;
+        unsigned long long size_bytes = 0;
+        int id_offset = 0;
+        char *id = (line + 2);
+
+        *end = '\0';
+        if ((strlen(line) < 3) || (line[1] != ' '))
+            goto out;
+
+        switch (line[0]) {
+        case '=':                      // entry of a snapshot of the index
+            if ((sscanf(id, "%u %u %u %llu %n", &in_use, &is_hollow, &num_chunks, &size_bytes, &id_offset) != 4) || (id_offset == 0))
+                goto out;
+            if ((bb = EUCA_ZALLOC(1, sizeof(blockblob))) == NULL)
+                goto out;
+            bb->store = bs;
+            euca_strncpy(bb->id, (id + id_offset), sizeof(bb->id));
+            set_blockblob_metadata_path(BLOCKBLOB_PATH_BLOCKS, bs, bb->id, bb->blocks_path, sizeof(bb->blocks_path));
+            bb->size_bytes = size_bytes;
+            bb->in_use = in_use;
+            bb->is_hollow = is_hollow;
+            bb->snapshot_type = BLOBSTORE_FORMAT_ANY;
+            if (num_chunks > 0)
+                read_blockblob_chunks(bb);
+            put_index(idx, bb);
+            break;
+
+        case '+':                      // blob was created or its metadata changed, reload it
+            set_blockblob_metadata_path(BLOCKBLOB_PATH_BLOCKS, bs, id, blocks_path, sizeof(blocks_path));
+            if (stat(blocks_path, &blocks_sb) == -1) {
+                remove_index(idx, id);
+                break;
+            }
+            if ((bb = load_blockblob(bs, id, blocks_path, &blocks_sb)) == NULL)
+                goto out;
+            put_index(idx, bb);
+            break;
+
+        case '-':                      // blob was deleted
+            remove_index(idx, id);
+            break;
+
+        case 'o':                      // blob was opened
+            if ((bb = find_index(idx, id)) != NULL)
+                bb->in_use |= BLOCKBLOB_STATUS_OPENED;
+            break;
+
+        case 'c':                      // blob was closed properly
+            if ((bb = find_index(idx, id)) != NULL)
+                bb->in_use &= ~(BLOCKBLOB_STATUS_OPENED | BLOCKBLOB_STATUS_ABANDONED);
+            break;
+
+        default:
+            goto out;
+        }
+        idx->records++;
+    }
+
+    idx->journal_offset += (line - buf);
+    idx->loaded = TRUE;
+    ret = 0;
+
+out:
+    if (ret == -1)
+        clear_index(idx);
+    EUCA_FREE(buf);
+    close(fd);
+    return ret;
+}
+
+//!
+//! Checks that the blobs in the index are still there, refreshing their allocation and timestamps
+//!
+//! @param[in] idx the index
+//!
+//! @return 0 if all blobs in the index were found or -1 if some were removed behind its back
+//!
+static int verify_index(blobstore_index * idx)
+{
+    struct stat sb = { 0 };
+
+    for (int i = 0; i < BLOBSTORE_INDEX_BUCKETS; i++) {
+        for (blockblob * bb = idx->buckets[i]; bb; bb = bb->next) {
+            if ((stat(bb->blocks_path, &sb) == -1) || !S_ISREG(sb.st_mode)) {
+                LOGDEBUG("blob %s is missing from %s, rebuilding its index\n", bb->id, idx->path);
+                return -1;
+            }
+            bb->blocks_allocated = sb.st_blocks;
+            bb->last_accessed = sb.st_atime;
+            bb->last_modified = sb.st_mtime;
+        }
+    }
+    return 0;
+}
+
+//!
+//! Replaces the journal of the blobstore with a snapshot of the index. The journal being
+//! replaced is locked exclusively until the snapshot took its place, so that records are
+//! not appended to it in the meantime and lost with it.
+//!
+//! @param[in] bs the blobstore, which must be locked
+//! @param[in] idx its index
+//! @param[in] catch_up TRUE to replay the records appended since the index was last brought
+//!            up to date first, as when compacting; FALSE if the index was just rebuilt
+//!
+//! @return 0 on success or -1 on error, in which case the journal is removed
+//!
+//! @see journal_blockblob()
+//!
+static int snapshot_index(blobstore * bs, blobstore_index * idx, boolean catch_up)
+{
+    int ret = -1;
+    int lock_fd = -1;
+    FILE *fp = NULL;
+    char path[PATH_MAX] = "";
+    char tmp_path[PATH_MAX] = "";
+    char boot_id[64] = "";
+    char header[sizeof(idx->header)] = "";
+    struct stat sb = { 0 };
+
+    snprintf(path, sizeof(path), "%s/%s", bs->path, BLOBSTORE_JOURNAL_FILE);
+    snprintf(tmp_path, sizeof(tmp_path), "%s/%s", bs->path, BLOBSTORE_JOURNAL_TMP_FILE);
+
+    // hold off appenders, which would otherwise write to the journal we are about to replace
+    if (((lock_fd = open(path, O_RDONLY)) != -1) && (flock(lock_fd, LOCK_EX) == -1))
+        goto out;
+    if (catch_up && ((lock_fd == -1) || (replay_journal(bs, idx) == -1)))
+        goto out;
+
+    // without the boot ID, records lost in a crash could not be detected
+    if (read_boot_id(boot_id, sizeof(boot_id)) == -1)
+        goto out;
+    snprintf(header, sizeof(header), "# %s %lld.%d", boot_id, time_usec(), getpid());
+
+    if ((fp = fopen(tmp_path, "w")) == NULL)
+        goto out;
+    fprintf(fp, "%s\n", header);
+    for (int i = 0; i < BLOBSTORE_INDEX_BUCKETS; i++) {
+        for (blockblob * bb = idx->buckets[i]; bb; bb = bb->next) {
+            fprintf(fp, "= %u %u %u %llu %s\n", bb->in_use, (unsigned int)bb->is_hollow, bb->num_chunks, bb->size_bytes, bb->id);
+        }
+    }
+    if (fflush(fp) || fsync(fileno(fp)) || fstat(fileno(fp), &sb))
+        goto out;
+    if (fclose(fp)) {
+        fp = NULL;
+        goto out;
+    }
+    fp = NULL;
+    if (rename(tmp_path, path) == -1)
+        goto out;
+
+    euca_strncpy(idx->header, header, sizeof(idx->header));
+    idx->journal_dev = sb.st_dev;
+    idx->journal_ino = sb.st_ino;
+    idx->journal_offset = sb.st_size;
+    idx->records = idx->num_blobs;
+    idx->loaded = TRUE;
+    ret = 0;
+
+out:
+    if (fp)
+        fclose(fp);
+    if (ret == -1) {
+        LOGWARN("failed to save the index of %s, it will be rebuilt on every scan\n", bs->path);
+        unlink(tmp_path);
+        unlink(path);                  // records appended to an older journal must not be replayed
+        idx->loaded = FALSE;
+    }
+    if (lock_fd != -1)
+        close(lock_fd);                // lets waiting appenders find the new journal
+    return ret;
+}
+
+//!
+//! Rebuilds the index from a walk of the blobstore directory and starts a new journal
+//!
+//! @param[in] bs the blobstore, which must be locked
+//! @param[in] idx its index
+//!
+//! @return 0 on success or -1 if the walk failed
+//!
+static int rebuild_index(blobstore * bs, blobstore_index * idx)
+{
+    blockblob *bb = NULL;
+    blockblob *bbs = NULL;
+
+    clear_index(idx);
+    _blobstore_errno = BLOBSTORE_ERROR_OK;
+    if (((bbs = walk_blobstore(bs, NULL)) == NULL) && (_blobstore_errno != BLOBSTORE_ERROR_OK))
+        return -1;
+
+    while ((bb = bbs) != NULL) {
+        bbs = bb->next;
+        put_index(idx, bb);
+    }
+
+    snapshot_index(bs, idx, FALSE);
+    return 0;
+}
+
+//!
+//! Copies the entries of the index into a linked list
+//!
+//! @param[in] bs the blobstore the copies will point to
+//! @param[in] idx its index
+//! @param[in] bb_to_avoid blob to leave out of the list, if any
+//!
+//! @return A pointer to the head of the list, NULL if the index is empty or on error
+//!
+static blockblob *copy_index(blobstore * bs, const blobstore_index * idx, const blockblob * bb_to_avoid)
+{
+    blockblob *bbs = NULL;
+    blockblob *copy = NULL;
+    blockblob **tail_bb = &bbs;
+
+    for (int i = 0; i < BLOBSTORE_INDEX_BUCKETS; i++) {
+        for (const blockblob * bb = idx->buckets[i]; bb; bb = bb->next) {
+            if (bb_to_avoid != NULL && !strcmp(bb->id, bb_to_avoid->id))
+                continue;              // avoid that particular blockblob
+
+            if ((copy = EUCA_ALLOC(1, sizeof(blockblob))) == NULL)
+                goto nomem;
+            memcpy(copy, bb, sizeof(blockblob));
+            copy->store = bs;          // the entry may have been loaded through another handle
+            copy->next = NULL;
+            copy->chunks = NULL;
+            *tail_bb = copy;           // add to LL
+            tail_bb = &(copy->next);
+
+            if (bb->num_chunks > 0) {
+                if ((copy->chunks = EUCA_ALLOC(bb->num_chunks, sizeof(unsigned long long))) == NULL)
+                    goto nomem;
+                memcpy(copy->chunks, bb->chunks, (bb->num_chunks * sizeof(unsigned long long)));
+            }
+        }
+    }
+    return bbs;
+
+nomem:
+    ERR(BLOBSTORE_ERROR_NOMEM, NULL);
+    free_bbs(bbs);
+    return NULL;
+}
+
+//!
+//! Puts all blockblobs in the blobstore into a linked list, returning its head. The list comes
+//! from the index of the blobstore, brought up to date with the journal, and the directory is
+//! walked only when the index cannot be trusted: the journal is gone or was written before a
+//! reboot, or a blob in the index no longer exists.
+//!
+//! @param[in] bs the blobstore, which must be locked
+//! @param[in] bb_to_avoid blob to leave out of the list, if any
+//!
+//! @return A pointer to the head of a linked list containing all found blockblobs
+//!
+//! @note The in-use status of the blobs comes from the journal, so callers that act on it
+//!       must check it again with check_in_use()
+//!
+static blockblob *scan_blobstore(blobstore * bs, const blockblob * bb_to_avoid)
+{
+    blobstore_index *idx = NULL;
+
+    if ((idx = get_index(bs)) == NULL)
+        return walk_blobstore(bs, bb_to_avoid);
+
+    if ((replay_journal(bs, idx) == -1) || (verify_index(idx) == -1)) {
+        if (rebuild_index(bs, idx) == -1)
+            return NULL;
+    } else if ((idx->records > BLOBSTORE_JOURNAL_MAX_RECORDS) && (idx->records > (2 * idx->num_blobs))) {
+        snapshot_index(bs, idx, TRUE); // compact the journal
+    }
+
+    _blobstore_errno = BLOBSTORE_ERROR_OK;  // loading blobs may have left an error for missing metadata
+    return copy_index(bs, idx, bb_to_avoid);
+}
+
+//!
+//! Same as scan_blobstore() but always walks the blobstore directory, rebuilding the index
+//!
+//! @param[in] bs the blobstore, which must be locked
+//! @param[in] bb_to_avoid blob to leave out of the list, if any
+//!
+//! @return A pointer to the head of a linked list containing all found blockblobs
+//!
+static blockblob *rescan_blobstore(blobstore * bs, const blockblob * bb_to_avoid)
+{
+    blobstore_index *idx = NULL;
+
+    if ((idx = get_index(bs)) == NULL)
+        return walk_blobstore(bs, bb_to_avoid);
+
+    if (rebuild_index(bs, idx) == -1)
+        return NULL;
+
+    _blobstore_errno = BLOBSTORE_ERROR_OK;
+    return copy_index(bs, idx, bb_to_avoid);
+}
+
+//!
+//!
+//!
+//! @param[in] bb1
+//! @param[in] bb2
+//!
+//! @return
+//!
+//! @pre
+//!
+//! @note
+//!
+static int compare_bbs(const void *bb1, const void *bb2)
+{
+    return (int)((*(blockblob **) bb1)->last_modified - (*(blockblob **) bb2)->last_modified);
+}
+
+//!
+//! Loads the hashes of the chunks of a deduplicated blob from its .chunks file
+//!
+//! @param[in] bb the blob, as found by walk_bs()
+//!
+//! @return 0 if the blob was not deduplicated or its chunks were loaded, -1 on error
+//!
+//! @note A .chunks file that does not match the size of the blob is ignored, so
+//!       the blob is accounted by its size.
+//!
+static int read_blockblob_chunks(blockblob * bb)
+{
+    int ret = 0;
+    int array_size = 0;
+    unsigned int expected = 0;
+    char **array = NULL;
+    char path[PATH_MAX] = "";
+    struct stat sb = { 0 };
+
+    set_blockblob_metadata_path(BLOCKBLOB_PATH_CHUNKS, bb->store, bb->id, path, sizeof(path));
+    if (stat(path, &sb) == -1)
+        return 0;                      // not deduplicated
+
+    if (read_array_blockblob_metadata_path(BLOCKBLOB_PATH_CHUNKS, bb->store, bb->id, &array, &array_size) == -1)
+        return -1;
+
+    expected = (bb->size_bytes + BLOBSTORE_CHUNK_BYTES - 1) / BLOBSTORE_CHUNK_BYTES;
+    if ((array_size > 0) && (array_size == expected)) {
+        if ((bb->chunks = EUCA_ZALLOC(array_size, sizeof(unsigned long long))) != NULL) {
+            for (int i = 0; i < array_size; i++)
+                bb->chunks[i] = strtoull(array[i], NULL, 16);
+            bb->num_chunks = array_size;
+        } else {
+            ret = -1;
+        }
+    } else {
+        LOGWARN("ignoring chunks of blob %s (found %d, expected %u)\n", bb->id, array_size, expected);
+    }
+
+    for (int i = 0; i < array_size; i++)
+        EUCA_FREE(array[i]);
+    EUCA_FREE(array);
+    return ret;
+}
+
+//!
+//! Number of blocks taken by a chunk of a blob (the last one may be partial)
+//!
+//! @param[in] bb the blob
+//! @param[in] idx index of the chunk
+//!
+//! @return the number of 512-byte blocks
+//!
+static unsigned long long chunk_blocks(const blockblob * bb, unsigned int idx)
+{
+    unsigned long long offset = (unsigned long long)idx * BLOBSTORE_CHUNK_BYTES;
+    return round_up_sec(MIN(BLOBSTORE_CHUNK_BYTES, (bb->size_bytes - offset))) / 512;
+}
+
+//!
+//! Looks up a chunk by hash in the table, optionally adding it
+//!
+//! @param[in] table the table, with at least one free slot
+//! @param[in] key hash of the chunk, must not be 0
+//! @param[in] insert set to TRUE to add the chunk if it is not in the table
+//!
+//! @return a pointer to the slot of the chunk or NULL if it was not found (and not inserted)
+//!
+static blobstore_chunk *find_chunk(blobstore_chunks * table, unsigned long long key, boolean insert)
+{
+    unsigned int i = 0;
+
+    if (table->slots == NULL)
+        return NULL;
+
+    for (i = ((unsigned int)(key ^ (key >> 32))) & (table->size - 1); table->slots[i].key != 0; i = (i + 1) & (table->size - 1)) {
+        if (table->slots[i].key == key)
+            return &(table->slots[i]);
+    }
+
+    if (!insert)
+        return NULL;
+    table->slots[i].key = key;
+    return &(table->slots[i]);
+}
+
+//!
+//! Builds the table of the chunks referenced by a list of blobs, counting references
+//!
+//! @param[out] table the table to fill, to be freed by the caller with EUCA_FREE(table->slots)
+//! @param[in]  bbs list of blobs, as returned by scan_blobstore()
+//! @param[in]  extra number of chunks the caller will add to the table
+//!
+//! @return 0 on success or -1 if out of memory
+//!
+static int build_chunks(blobstore_chunks * table, const blockblob * bbs, unsigned int extra)
+{
+    unsigned long long count = extra;
+    blobstore_chunk *chunk = NULL;
+
+    for (const blockblob * bb = bbs; bb; bb = bb->next)
+        count += bb->num_chunks;
+
+    table->slots = NULL;
+    table->size = 0;
+    if (count == 0)
+        return 0;
+
+    // keep the table at most half full
+    for (table->size = 16; table->size < (count * 2); table->size *= 2) ;
+    if ((table->slots = EUCA_ZALLOC(table->size, sizeof(blobstore_chunk))) == NULL) {
+        ERR(BLOBSTORE_ERROR_NOMEM, NULL);
+        table->size = 0;
+        return -1;
+    }
 
-        // see if it's hollow
-        char buf[64];
-        if (read_blockblob_metadata_path(BLOCKBLOB_PATH_HOLLOW, bb->store, bb->id, buf, sizeof(buf)) != -1) {
-            bb->is_hollow = TRUE;
-        }
-        // if there is a .refs file, subtract the mapped blocks, if any, from the size
-        char **array = NULL;
-        int array_size = 0;
-        if (read_array_blockblob_metadata_path(BLOCKBLOB_PATH_DEPS, bb->store, bb->id, &array, &array_size) != -1) {
-            for (int i = 0; i < array_size; i++) {
-                char *store_path = NULL;
-                char *blob_id = NULL;
-                char *rel_type = NULL;
-                char *start_block = NULL;
-                char *len_blocks = NULL;
-
-                store_path = strtok(array[i], " ");
-                blob_id = strtok(NULL, " ");
-                rel_type = strtok(NULL, " ");
-                start_block = strtok(NULL, " ");
-                len_blocks = strtok(NULL, " ");
-                if (rel_type && len_blocks && strcmp(rel_type, blobstore_relation_type_name[BLOBSTORE_MAP]) == 0) {
-                    bb->size_bytes -= strtoull(len_blocks, NULL, 0) * 512LL;
-                }
+    for (const blockblob * bb = bbs; bb; bb = bb->next) {
+        for (unsigned int i = 0; i < bb->num_chunks; i++) {
+            if (bb->chunks[i] == 0)
+                continue;              // all zeros, takes no space
+            chunk = find_chunk(table, bb->chunks[i], TRUE);
+            if (chunk->refs == 0) {
+                chunk->blocks = chunk_blocks(bb, i);
+                chunk->holder = bb;
+                chunk->holder_idx = i;
             }
-        }
-
-        if (array) {
-            for (int i = 0; i < array_size; i++)
-                EUCA_FREE(array[i]);
-            EUCA_FREE(array);
+            chunk->refs++;
+            if (bb->in_use & BLOCKBLOB_STATUS_OPENED)
+                chunk->opened_refs++;
         }
     }
-
-free:
-    closedir(dir);
-    return tail_bb;
+    return 0;
 }
 
 //!
-//! Runs through the blobstore and puts all found blockblobs into a linked list, returning its head
+//! Drops the references of a blob that is being deleted from the chunk table
 //!
-//! @param[in] bs
-//! @param[in] bb_to_avoid
+//! @param[in] table the table built by build_chunks()
+//! @param[in] bb the deduplicated blob
 //!
-//! @return A pointer to the head of a linked list containing all found blockblobs
+//! @return the number of blocks freed, i.e., of the chunks no other blob references
 //!
-//! @pre
+static long long release_chunks(blobstore_chunks * table, const blockblob * bb)
+{
+    long long freed = 0;
+    blobstore_chunk *chunk = NULL;
+
+    for (unsigned int i = 0; i < bb->num_chunks; i++) {
+        if ((bb->chunks[i] == 0) || ((chunk = find_chunk(table, bb->chunks[i], FALSE)) == NULL) || (chunk->refs == 0))
+            continue;
+        if (chunk->holder == bb)
+            chunk->holder = NULL;
+        if (--chunk->refs == 0)
+            freed += chunk->blocks;
+    }
+    return freed;
+}
+
 //!
-//! @note
+//! Adds up the blocks taken by a list of blobs, counting a chunk shared by
+//! deduplicated blobs once, as locked if any of them is opened
 //!
-static blockblob *scan_blobstore(blobstore * bs, const blockblob * bb_to_avoid)
+//! @param[in]  bbs list of blobs, as returned by scan_blobstore()
+//! @param[in]  table the chunks referenced by the blobs, built by build_chunks()
+//! @param[in]  skip_hollow set to TRUE to leave 'hollow' blobs out
+//! @param[out] blocks_locked blocks taken by opened blobs
+//! @param[out] blocks_unlocked blocks taken by other blobs
+//!
+static void sum_blockblobs(const blockblob * bbs, const blobstore_chunks * table, boolean skip_hollow, long long *blocks_locked, long long *blocks_unlocked)
 {
-    blockblob *bbs = NULL;
-    if (walk_bs(bs, bs->path, &bbs, bb_to_avoid) == NULL) {
-        if (bbs)
-            free_bbs(bbs);
-        bbs = NULL;
+    long long abb_size_blocks = 0;
+
+    *blocks_locked = 0;
+    *blocks_unlocked = 0;
+    for (const blockblob * abb = bbs; abb; abb = abb->next) {
+        if (abb->chunks)
+            continue;                  // accounted by chunk below
+        abb_size_blocks = round_up_sec(abb->size_bytes) / 512;
+        if (skip_hollow && abb->is_hollow)
+            abb_size_blocks = 0;
+        if (abb->in_use & BLOCKBLOB_STATUS_OPENED) {
+            // these can't be purged if we need space
+            //! @TODO look into recursive purging of unused references?
+            *blocks_locked += abb_size_blocks;
+        } else {
+            *blocks_unlocked += abb_size_blocks;    // these potentially can be purged, unless they are depended on by locked ones
+        }
     }
 
-    return bbs;
+    for (unsigned int i = 0; i < table->size; i++) {
+        if (table->slots[i].refs == 0)
+            continue;
+        if (table->slots[i].opened_refs)
+            *blocks_locked += table->slots[i].blocks;
+        else
+            *blocks_unlocked += table->slots[i].blocks;
+    }
 }
 
 //!
+//! Compares two extents by their physical offset, for qsort()
 //!
+//! @param[in] e1
+//! @param[in] e2
 //!
-//! @param[in] bb1
-//! @param[in] bb2
+//! @return -1, 0 or 1
 //!
-//! @return
+static int compare_extents(const void *e1, const void *e2)
+{
+    const struct fiemap_extent *x1 = e1;
+    const struct fiemap_extent *x2 = e2;
+    return ((x1->fe_physical > x2->fe_physical) - (x1->fe_physical < x2->fe_physical));
+}
+
 //!
-//! @pre
+//! Counts the blocks the blobs take on disk, with FIEMAP, counting the extents
+//! they share only once. Blobs whose extents cannot be mapped are counted by
+//! the blocks allocated to their file.
 //!
-//! @note
+//! @param[in] bbs list of blobs, as returned by scan_blobstore()
 //!
-static int compare_bbs(const void *bb1, const void *bb2)
+//! @return the number of 512-byte blocks
+//!
+static unsigned long long physical_blocks(const blockblob * bbs)
 {
-    return (int)((*(blockblob **) bb1)->last_modified - (*(blockblob **) bb2)->last_modified);
+#define FIEMAP_BATCH 256
+    int fd = -1;
+    int num_shared = 0;
+    int max_shared = 0;
+    boolean last = FALSE;
+    unsigned long long bytes = 0;
+    unsigned long long total = 0;
+    unsigned long long end = 0;
+    unsigned long long start = 0;
+    struct fiemap *fm = NULL;
+    struct fiemap_extent *shared = NULL;
+    struct fiemap_extent *bigger = NULL;
+
+    if ((fm = EUCA_ZALLOC(1, sizeof(struct fiemap) + FIEMAP_BATCH * sizeof(struct fiemap_extent))) == NULL)
+        goto fallback;
+
+    for (const blockblob * bb = bbs; bb; bb = bb->next) {
+        int file_shared = num_shared;
+
+        if ((fd = open(bb->blocks_path, O_RDONLY)) == -1) {
+            total += bb->blocks_allocated;
+            continue;
+        }
+
+        bytes = 0;
+        start = 0;
+        for (last = FALSE; !last;) {
+            bzero(fm, sizeof(struct fiemap));
+            fm->fm_start = start;
+            fm->fm_length = FIEMAP_MAX_OFFSET - start;
+            fm->fm_extent_count = FIEMAP_BATCH;
+            if ((ioctl(fd, FS_IOC_FIEMAP, fm) == -1) || (fm->fm_mapped_extents == 0))
+                break;
+
+            for (unsigned int i = 0; i < fm->fm_mapped_extents; i++) {
+                struct fiemap_extent *fe = &(fm->fm_extents[i]);
+                if ((fe->fe_flags & FIEMAP_EXTENT_SHARED) && !(fe->fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC))) {
+                    if (num_shared == max_shared) {
+                        max_shared = ((max_shared) ? (max_shared * 2) : (FIEMAP_BATCH));
+                        if ((bigger = EUCA_REALLOC(shared, max_shared, sizeof(struct fiemap_extent))) == NULL) {
+                            close(fd);
+                            goto fallback;
+                        }
+                        shared = bigger;
+                    }
+                    shared[num_shared++] = *fe;
+                } else {
+                    bytes += fe->fe_length;
+                }
+                last = ((fe->fe_flags & FIEMAP_EXTENT_LAST) != 0);
+                start = fe->fe_logical + fe->fe_length;
+            }
+        }
+        close(fd);
+
+        if (last || ((bytes == 0) && (num_shared == file_shared) && (bb->blocks_allocated == 0))) {
+            total += round_up_sec(bytes) / 512;
+        } else {
+            // FIEMAP is not supported or failed mid-way, count what the file system reports
+            num_shared = file_shared;
+            total += bb->blocks_allocated;
+        }
+    }
+
+    // add up the union of the shared extents
+    qsort(shared, num_shared, sizeof(struct fiemap_extent), compare_extents);
+    for (int i = 0; i < num_shared; i++) {
+        if (i == 0 || shared[i].fe_physical > end) {
+            total += round_up_sec(shared[i].fe_length) / 512;
+            end = shared[i].fe_physical + shared[i].fe_length;
+        } else if ((shared[i].fe_physical + shared[i].fe_length) > end) {
+            total += round_up_sec(shared[i].fe_physical + shared[i].fe_length - end) / 512;
+            end = shared[i].fe_physical + shared[i].fe_length;
+        }
+    }
+
+    EUCA_FREE(shared);
+    EUCA_FREE(fm);
+    return total;
+
+fallback:
+    EUCA_FREE(shared);
+    EUCA_FREE(fm);
+    total = 0;
+    for (const blockblob * bb = bbs; bb; bb = bb->next)
+        total += bb->blocks_allocated;
+    return total;
+#undef FIEMAP_BATCH
 }
 
 //!
@@ -2579,15 +3561,16 @@ static int compare_bbs(const void *bb1, const void *bb2)
 //!
 //! @param[in] bs
 //! @param[in] bb_list
+//! @param[in] chunks the chunks referenced by the blobs in bb_list, built by build_chunks()
 //! @param[in] need_blocks
 //!
 //! @return
 //!
 //! @pre
 //!
-//! @note
+//! @note A deduplicated blob only frees the chunks no other blob references.
 //!
-static long long purge_blockblobs_lru(blobstore * bs, blockblob * bb_list, long long need_blocks)
+static long long purge_blockblobs_lru(blobstore * bs, blockblob * bb_list, blobstore_chunks * chunks, long long need_blocks)
 {
     int list_length = 0;
     long long purged = 0;
@@ -2636,7 +3619,7 @@ static long long purge_blockblobs_lru(blobstore * bs, blockblob * bb_list, long
                     code = '!';
 
                 } else {
-                    purged += round_up_sec(bb->size_bytes) / 512;
+                    purged += ((bb->chunks) ? (release_chunks(chunks, bb)) : (round_up_sec(bb->size_bytes) / 512));
                     bb_array[i] = NULL; // mark it to skip in the future
                     code = 'D';
                     deleted++;
@@ -2674,6 +3657,9 @@ static long long purge_blockblobs_lru(blobstore * bs, blockblob * bb_list, long
 int blobstore_stat(blobstore * bs, blobstore_meta * meta)
 {
     int ret = 0;
+    long long blocks_locked = 0;
+    long long blocks_unlocked = 0;
+    blobstore_chunks chunks = { 0 };
 
     if (blobstore_lock(bs, BLOBSTORE_LOCK_TIMEOUT_USEC) == -1) {    // lock it so we can traverse blobstore safely
         return EUCA_ERROR;
@@ -2688,28 +3674,21 @@ int blobstore_stat(blobstore * bs, blobstore_meta * meta)
     }
     // analyze the LL, calculating sizes
     meta->blocks_allocated = 0;
-    meta->blocks_unlocked = 0;
-    meta->blocks_locked = 0;
+    meta->blocks_logical = 0;
     meta->num_blobs = 0;
-    for (blockblob * abb = bbs; abb;) {
-        //! @TODO unify this with locked/unlocked calculation in open()
-        long long abb_size_blocks = round_up_sec(abb->size_bytes) / 512;
-        if (abb->in_use & BLOCKBLOB_STATUS_OPENED) {
-            // these can't be purged if we need space
-            //! @TODO look into recursive purging of unused references?
-            meta->blocks_locked += abb_size_blocks;
-        } else {
-            // these potentially can be purged, unless they are depended on by locked ones
-            meta->blocks_unlocked += abb_size_blocks;
-        }
+    for (blockblob * abb = bbs; abb; abb = abb->next) {
+        meta->blocks_logical += round_up_sec(abb->size_bytes) / 512;
         meta->blocks_allocated += abb->blocks_allocated;
         meta->num_blobs++;
-
-        // free this node and move the pointer
-        blockblob *old_bb = abb;
-        abb = abb->next;
-        EUCA_FREE(old_bb);
     }
+    if (build_chunks(&chunks, bbs, 0) == 0) {
+        sum_blockblobs(bbs, &chunks, FALSE, &blocks_locked, &blocks_unlocked);
+        EUCA_FREE(chunks.slots);
+    }
+    meta->blocks_locked = blocks_locked;
+    meta->blocks_unlocked = blocks_unlocked;
+    meta->blocks_physical = physical_blocks(bbs);
+    free_bbs(bbs);
 
 unlock:
 
@@ -2838,9 +3817,9 @@ int blobstore_fsck(blobstore * bs, int (*examiner) (const blockblob * bb))
         ERR(BLOBSTORE_ERROR_UNKNOWN, "failed to lock the blobstore");
         return -1;
     }
-    // put existing items in the blobstore into a LL
+    // put existing items in the blobstore into a LL, walking the directory since we are checking integrity
     _blobstore_errno = BLOBSTORE_ERROR_OK;
-    blockblob *bbs = scan_blobstore(bs, NULL);
+    blockblob *bbs = rescan_blobstore(bs, NULL);
 
     if (blobstore_unlock(bs) == -1) {
         ERR(BLOBSTORE_ERROR_UNKNOWN, "failed to unlock the blobstore");
@@ -2998,7 +3977,7 @@ int blobstore_search(blobstore * bs, const char *regex, blockblob_meta ** result
         euca_strncpy(bm->id, abb->id, sizeof(bm->id));
         bm->bs = bs;
         bm->size_bytes = abb->size_bytes;
-        bm->in_use = abb->in_use;
+        bm->in_use = check_in_use(bs, abb->id, 0);  // the index may not know of a crashed opener
         bm->is_hollow = abb->is_hollow;
         bm->last_accessed = abb->last_accessed;
         bm->last_modified = abb->last_modified;
@@ -3123,6 +4102,7 @@ blockblob *blockblob_open(blobstore * bs, const char *id, unsigned long long siz
     LOGTRACE("{%u} blockblob_open: opening blob id=%s flags=%d timeout=%lld\n", (unsigned int)pthread_self(), id, flags, timeout_usec);
 
     blockblob *bbs = NULL;             // a temp LL of blockblobs, used for computing free space and for purging
+    blobstore_chunks chunks = { 0 };   // chunks referenced by deduplicated blobs in bbs
     blockblob *bb = EUCA_ZALLOC(1, sizeof(blockblob));
     if (bb == NULL) {
         ERR(BLOBSTORE_ERROR_NOMEM, NULL);
@@ -3225,38 +4205,47 @@ blockblob *blockblob_open(blobstore * bs, const char *id, unsigned long long siz
 
         } else {                       // enforce blobstore limits
 
-            // analyze the LL, calculating sizes
-            long long blocks_unlocked = 0;
-            long long blocks_locked = 0;
-            unsigned int num_blobs = 0;
-            for (blockblob * abb = bbs; abb; abb = abb->next) {
-                long long abb_size_blocks = round_up_sec(abb->size_bytes) / 512;
-                if (abb->is_hollow)
-                    abb_size_blocks = 0;
-                if (abb->in_use & BLOCKBLOB_STATUS_OPENED) {
-                    // these can't be purged if we need space
-                    //! @TODO look into recursive purging of unused references?
-                    blocks_locked += abb_size_blocks;
-                } else {
-                    blocks_unlocked += abb_size_blocks; // these potentially can be purged, unless they are depended on by locked ones
+            // the index the LL came from may be stale, so before failing for lack of space, walk the blobstore and try again
+            for (boolean rescanned = FALSE;; rescanned = TRUE) {
+                // analyze the LL, calculating sizes, with chunks shared by deduplicated blobs counted once
+                long long blocks_unlocked = 0;
+                long long blocks_locked = 0;
+                if (build_chunks(&chunks, bbs, 0) == -1) {
+                    goto clean;
                 }
-                num_blobs++;
-            }
+                sum_blockblobs(bbs, &chunks, TRUE, &blocks_locked, &blocks_unlocked);
+
+                long long blocks_free = bs->limit_blocks - (blocks_unlocked + blocks_locked);
+                if (blocks_free >= size_blocks)
+                    break;
 
-            long long blocks_free = bs->limit_blocks - (blocks_unlocked + blocks_locked);
-            if (blocks_free < size_blocks) {
                 if (!(bs->revocation_policy == BLOBSTORE_REVOCATION_LRU)    // not allowed to purge
                     || (blocks_free + blocks_unlocked) < size_blocks) { // not enough purgeable material
-                    ERR(BLOBSTORE_ERROR_NOSPC, NULL);
-                    goto clean;
+                    if (rescanned) {
+                        ERR(BLOBSTORE_ERROR_NOSPC, NULL);
+                        goto clean;
+                    }
+                } else {
+                    long long blocks_needed = size_blocks - blocks_free;
+                    _err_off();        // do not care about errors duing purging
+                    long long blocks_freed = purge_blockblobs_lru(bs, bbs, &chunks, blocks_needed);
+                    _err_on();
+                    if (blocks_freed >= blocks_needed)
+                        break;
+                    if (rescanned) {
+                        ERR(BLOBSTORE_ERROR_NOSPC, "could not purge enough from cache");
+                        goto clean;
+                    }
                 }
-                long long blocks_needed = size_blocks - blocks_free;
-                _err_off();            // do not care about errors duing purging
-                long long blocks_freed = purge_blockblobs_lru(bs, bbs, blocks_needed);
-                _err_on();
-                if (blocks_freed < blocks_needed) {
-                    ERR(BLOBSTORE_ERROR_NOSPC, "could not purge enough from cache");
-                    goto clean;
+
+                EUCA_FREE(chunks.slots);
+                free_bbs(bbs);
+                _blobstore_errno = BLOBSTORE_ERROR_OK;
+                bbs = rescan_blobstore(bs, bb);
+                if (bbs == NULL) {
+                    if (_blobstore_errno != BLOBSTORE_ERROR_OK) {
+                        goto clean;
+                    }
                 }
             }
         }
@@ -3274,6 +4263,7 @@ blockblob *blockblob_open(blobstore * bs, const char *id, unsigned long long siz
                 goto clean;
             }
         bb->snapshot_type = BLOBSTORE_SNAPSHOT_NONE;    // just created, so not a snapshot
+        journal_blockblob(bs, '+', bb->id);
 
         if (blobstore_unlock(bs) == -1) {
             ERR(BLOBSTORE_ERROR_UNKNOWN, "failed to unlock the blobstore");
@@ -3338,6 +4328,7 @@ blockblob *blockblob_open(blobstore * bs, const char *id, unsigned long long siz
     }
 
     set_device_path(bb);               // read .dm and .loopback and set bb->device_path accordingly
+    journal_blockblob(bs, 'o', bb->id);
 
     goto out;                          // all is well
 
@@ -3381,6 +4372,7 @@ out:
         LOGTRACE("{%u} blockblob_open: errno=%d msg=%s\n", (unsigned int)pthread_self(), _blobstore_errno, blobstore_get_last_msg());
     }
 
+    EUCA_FREE(chunks.slots);
     free_bbs(bbs);
     return bb;
 }
@@ -3451,6 +4443,7 @@ int blockblob_close(blockblob * bb)
         ERR(BLOBSTORE_ERROR_UNKNOWN, "failed to truncate the blobstore lock file.");
     }
     ret |= close_and_unlock(bb->fd_lock);
+    journal_blockblob(bb->store, 'c', bb->id);
     EUCA_FREE(bb);                     // we free the blob regardless of whether closing succeeds or not
     return ret;
 }
@@ -4033,7 +5026,8 @@ int blockblob_copy(blockblob * src_bb, unsigned long long src_offset_bytes, bloc
     if (verify_bb(src_bb, src_offset_bytes + copy_len_bytes) || verify_bb(dst_bb, dst_offset_bytes + copy_len_bytes)) {
         return -1;
     }
-    // determine the largest acceptable block size for dd, all the way down to a byte possibly
+    // diskutil_dd2() copies bytes in-process; the block size only matters if it has to fall back
+    // to dd, so determine the largest acceptable one, all the way down to a byte possibly
     int granularity = 4096;
     while (src_offset_bytes % granularity || dst_offset_bytes % granularity || copy_len_bytes % granularity) {
         granularity /= 2;
@@ -4053,6 +5047,221 @@ int blockblob_copy(blockblob * src_bb, unsigned long long src_offset_bytes, bloc
     return ret;
 }
 
+//!
+//! Hashes the content of a chunk. Collisions are harmless since the kernel
+//! compares the content before sharing extents.
+//!
+//! @param[in] buf the chunk content
+//! @param[in] len length of the content, a multiple of 8 but for the last chunk of a blob
+//!
+//! @return a hash, never 0
+//!
+static unsigned long long hash_chunk(const char *buf, size_t len)
+{
+    size_t i = 0;
+    unsigned long long word = 0;
+    unsigned long long h = 0xcbf29ce484222325ULL ^ len;
+
+    for (i = 0; (i + sizeof(word)) <= len; i += sizeof(word)) {
+        memcpy(&word, (buf + i), sizeof(word));
+        h = (h ^ word) * 0x100000001b3ULL;
+        h ^= (h >> 29);
+    }
+    for (; i < len; i++) {
+        h = (h ^ (unsigned char)buf[i]) * 0x100000001b3ULL;
+    }
+    h ^= (h >> 32);
+    return ((h) ? (h) : (1));
+}
+
+//!
+//! Makes a range of one file share the extents of an identical range of another
+//!
+//! @param[in] src_fd file holding the content
+//! @param[in] src_offset offset of the content in src_fd
+//! @param[in] dst_fd file to share the extents into, opened for writing
+//! @param[in] dst_offset offset of the range in dst_fd
+//! @param[in] len length of the range
+//!
+//! @return 0 if the range now shares the extents, -1 if the content differs or the
+//!         file system cannot share extents
+//!
+static int share_chunk(int src_fd, off_t src_offset, int dst_fd, off_t dst_offset, size_t len)
+{
+#ifdef FIDEDUPERANGE
+    union {
+        struct file_dedupe_range range;
+        char buf[sizeof(struct file_dedupe_range) + sizeof(struct file_dedupe_range_info)];
+    } req;
+
+    while (len > 0) {
+        bzero(&req, sizeof(req));
+        req.range.src_offset = src_offset;
+        req.range.src_length = len;
+        req.range.dest_count = 1;
+        req.range.info[0].dest_fd = dst_fd;
+        req.range.info[0].dest_offset = dst_offset;
+        if ((ioctl(src_fd, FIDEDUPERANGE, &req) == -1) || (req.range.info[0].status != FILE_DEDUPE_RANGE_SAME) || (req.range.info[0].bytes_deduped == 0))
+            return -1;
+        // the file system may share less than asked in one go
+        src_offset += req.range.info[0].bytes_deduped;
+        dst_offset += req.range.info[0].bytes_deduped;
+        len -= MIN(len, req.range.info[0].bytes_deduped);
+    }
+    return 0;
+#else /* FIDEDUPERANGE */
+    return -1;
+#endif /* FIDEDUPERANGE */
+}
+
+//!
+//! Deduplicates a blob against the other blobs of its store. The blob is split
+//! in chunks of BLOBSTORE_CHUNK_BYTES: chunks of zeros are punched out, chunks
+//! whose content another blob (or an earlier chunk) already holds share its
+//! extents on disk. The hashes of the chunks are kept in the blob's .chunks file
+//! so the store accounts a chunk shared by several blobs once, and LRU purging
+//! only counts the chunks nobody else references as freed.
+//!
+//! @param[in] bb the blob, opened for writing, with its content in place
+//!
+//! @return 0 on success (including when the blob cannot be deduplicated) or -1 on error
+//!
+//! @pre The blob content must not change afterwards, which is the case of cache blobs.
+//!
+//! @note Chunks that could not share extents, e.g. because the file system does not
+//!       support it, are recorded under a hash unique to the blob so they are still
+//!       accounted in full.
+//!
+int blockblob_dedup(blockblob * bb)
+{
+    int ret = -1;
+    int src_fd = -1;
+    char *buf = NULL;
+    char *text = NULL;
+    char **lines = NULL;
+    boolean is_zero = FALSE;
+    size_t len = 0;
+    ssize_t got = 0;
+    off_t offset = 0;
+    unsigned int i = 0;
+    unsigned int num_chunks = 0;
+    unsigned int num_shared = 0;
+    unsigned int num_zero = 0;
+    unsigned long long salt = 0;
+    unsigned long long *keys = NULL;
+    const blockblob *src_bb = NULL;
+    blockblob *bbs = NULL;
+    blobstore_chunk *chunk = NULL;
+    blobstore_chunks chunks = { 0 };
+
+    if (bb == NULL) {
+        ERR(BLOBSTORE_ERROR_INVAL, "blockblob pointer is NULL");
+        return -1;
+    }
+    // only blobs whose content is all in the blocks file
+    if ((bb->snapshot_type == BLOBSTORE_SNAPSHOT_DM) || bb->is_hollow || (bb->fd_blocks == -1) || (bb->size_bytes == 0)) {
+        return 0;
+    }
+
+    num_chunks = (bb->size_bytes + BLOBSTORE_CHUNK_BYTES - 1) / BLOBSTORE_CHUNK_BYTES;
+    if (((keys = EUCA_ZALLOC(num_chunks, sizeof(unsigned long long))) == NULL) || ((buf = EUCA_ALLOC(1, BLOBSTORE_CHUNK_BYTES)) == NULL)) {
+        ERR(BLOBSTORE_ERROR_NOMEM, NULL);
+        goto out;
+    }
+    // take a snapshot of the chunks of the other blobs, the sharing itself is checked by the kernel
+    if (blobstore_lock(bb->store, BLOBSTORE_LOCK_TIMEOUT_USEC) == -1) {
+        goto out;
+    }
+    _blobstore_errno = BLOBSTORE_ERROR_OK;
+    bbs = scan_blobstore(bb->store, bb);
+    if (blobstore_unlock(bb->store) == -1) {
+        ERR(BLOBSTORE_ERROR_UNKNOWN, "failed to unlock the blobstore");
+    }
+    if ((bbs == NULL) && (_blobstore_errno != BLOBSTORE_ERROR_OK)) {
+        goto out;
+    }
+    if (build_chunks(&chunks, bbs, num_chunks) == -1) {
+        goto out;
+    }
+
+    salt = hash_chunk(bb->id, strlen(bb->id));
+    for (i = 0; i < num_chunks; i++) {
+        offset = ((off_t) i) * BLOBSTORE_CHUNK_BYTES;
+        len = MIN(BLOBSTORE_CHUNK_BYTES, (bb->size_bytes - offset));
+        for (got = 0; got < len;) {
+            ssize_t n = pread(bb->fd_blocks, (buf + got), (len - got), (offset + got));
+            if (n <= 0) {
+                if ((n == -1) && (errno == EINTR))
+                    continue;
+                PROPAGATE_ERR(BLOBSTORE_ERROR_UNKNOWN);
+                goto out;
+            }
+            got += n;
+        }
+
+        is_zero = ((buf[0] == 0) && ((len == 1) || !memcmp(buf, (buf + 1), (len - 1))));
+#ifdef FALLOC_FL_PUNCH_HOLE
+        if (is_zero && (fallocate(bb->fd_blocks, (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE), offset, len) == 0)) {
+            keys[i] = 0;
+            num_zero++;
+            continue;
+        }
+#endif /* FALLOC_FL_PUNCH_HOLE */
+
+        keys[i] = hash_chunk(buf, len);
+        chunk = find_chunk(&chunks, keys[i], TRUE);
+        if (chunk->refs == 0) {
+            // first time this content is seen, later chunks may share it
+            chunk->holder = bb;
+            chunk->holder_idx = i;
+            chunk->refs++;
+            continue;
+        }
+
+        if (chunk->holder && (chunk->holder != src_bb)) {
+            if (src_fd != -1)
+                close(src_fd);
+            src_bb = chunk->holder;
+            src_fd = ((src_bb == bb) ? (dup(bb->fd_blocks)) : (open(src_bb->blocks_path, O_RDONLY)));
+        }
+        if (chunk->holder && (src_fd != -1) && (share_chunk(src_fd, ((off_t) chunk->holder_idx * BLOBSTORE_CHUNK_BYTES), bb->fd_blocks, offset, len) == 0)) {
+            num_shared++;
+        } else {
+            // same hash but not shared on disk, account for it separately
+            keys[i] = hash_chunk((const char *)&salt, sizeof(salt)) ^ (keys[i] * 0x9e3779b97f4a7c15ULL) ^ (i + 1);
+            if (keys[i] == 0)
+                keys[i] = 1;
+        }
+    }
+
+    // record the chunks so the store can account for them
+    if (((lines = EUCA_ZALLOC(num_chunks, sizeof(char *))) == NULL) || ((text = EUCA_ALLOC(num_chunks, 17)) == NULL)) {
+        ERR(BLOBSTORE_ERROR_NOMEM, NULL);
+        goto out;
+    }
+    for (i = 0; i < num_chunks; i++) {
+        lines[i] = text + (i * 17);
+        snprintf(lines[i], 17, "%016llx", keys[i]);
+    }
+    if (write_array_blockblob_metadata_path(BLOCKBLOB_PATH_CHUNKS, bb->store, bb->id, lines, num_chunks) == -1) {
+        goto out;
+    }
+
+    LOGDEBUG("deduplicated blob %s: %u chunks, %u shared, %u empty\n", bb->id, num_chunks, num_shared, num_zero);
+    ret = 0;
+
+out:
+    if (src_fd != -1)
+        close(src_fd);
+    EUCA_FREE(lines);
+    EUCA_FREE(text);
+    EUCA_FREE(chunks.slots);
+    free_bbs(bbs);
+    EUCA_FREE(keys);
+    EUCA_FREE(buf);
+    return ret;
+}
+
 //!
 //! Sorts the device mapper table string sent to dmsetup. In some case, the table is
 //! sent in partition ordering rather than start block ordering. This cause dmsetup to
@@ -4462,6 +5671,7 @@ cleanup:                              // this is failure cleanup code path
             char path[PATH_MAX];
             set_blockblob_metadata_path(BLOCKBLOB_PATH_DM, bb->store, bb->id, path, sizeof(path));
             unlink(path);
+            journal_blockblob(bb->store, '+', bb->id);
         }
         _blobstore_errno = saved_errno;
     }
@@ -5088,6 +6298,152 @@ done:
     return errors;
 }
 
+//!
+//! Checks that deduplicated blobs keep their content and that shared chunks
+//! are accounted once
+//!
+//! @param[in] base
+//! @param[in] name
+//!
+//! @return the number of errors
+//!
+static int do_dedup_test(const char *base, const char *name)
+{
+    int ret;
+    int errors = 0;
+    int data_blocks = 2 * BLOBSTORE_CHUNK_BYTES / 512;
+    int blob_blocks = 4 * BLOBSTORE_CHUNK_BYTES / 512;
+    char *buf = NULL;
+    char *check = NULL;
+    blobstore_meta meta;
+    printf("commencing dedup test\n");
+
+    blobstore *bs = create_teststore(blob_blocks * 3, base, name, BLOBSTORE_FORMAT_FILES, BLOBSTORE_REVOCATION_LRU, BLOBSTORE_SNAPSHOT_ANY);
+    if (bs == NULL) {
+        errors++;
+        goto done;
+    }
+
+    buf = EUCA_ALLOC(1, data_blocks * 512);
+    check = EUCA_ALLOC(1, data_blocks * 512);
+    for (long long i = 0; i < data_blocks * 512; i++)
+        buf[i] = (char)(i % 251);
+
+    // two blobs with the same data in the first half and zeros in the second
+    blockblob *bb1, *bb2;
+    _OPENBB(bb1, B1, blob_blocks, NULL, _CBB, 0, 0);
+    _OPENBB(bb2, B2, blob_blocks, NULL, _CBB, 0, 0);
+    if (errors)
+        goto done;
+    if ((pwrite(bb1->fd_blocks, buf, data_blocks * 512, 0) != data_blocks * 512) || (pwrite(bb2->fd_blocks, buf, data_blocks * 512, 0) != data_blocks * 512)) {
+        printf("failed to write test data\n");
+        errors++;
+        goto done;
+    }
+    if (blockblob_dedup(bb1) || blockblob_dedup(bb2)) {
+        printf("failed to deduplicate: %s\n", blobstore_get_last_msg());
+        errors++;
+    }
+    if ((pread(bb2->fd_blocks, check, data_blocks * 512, 0) != data_blocks * 512) || memcmp(buf, check, data_blocks * 512)) {
+        printf("deduplicated blob content has changed\n");
+        errors++;
+    }
+    _CLOSBB(bb1, B1);
+    _CLOSBB(bb2, B2);
+
+    // shared chunks count once, if the file system shared them, and zeros count for nothing, if it could punch them
+    blobstore_stat(bs, &meta);
+    printf("logical=%llu charged=%llu physical=%llu allocated=%llu\n", meta.blocks_logical, (meta.blocks_locked + meta.blocks_unlocked), meta.blocks_physical,
+           meta.blocks_allocated);
+    if ((meta.blocks_logical != 2 * blob_blocks) || ((meta.blocks_locked + meta.blocks_unlocked) < data_blocks)
+        || ((meta.blocks_locked + meta.blocks_unlocked) > meta.blocks_logical)) {
+        printf("unexpected accounting of deduplicated blobs\n");
+        errors++;
+    }
+
+    _OPENBB(bb1, B1, 0, NULL, 0, 0, 0);
+    _DELEBB(bb1, B1, 0);
+    blobstore_stat(bs, &meta);
+    if ((meta.blocks_locked + meta.blocks_unlocked) < data_blocks) {
+        printf("chunks of the remaining blob are not accounted\n");
+        errors++;
+    }
+    _OPENBB(bb2, B2, 0, NULL, 0, 0, 0);
+    if (bb2 && ((pread(bb2->fd_blocks, check, data_blocks * 512, 0) != data_blocks * 512) || memcmp(buf, check, data_blocks * 512))) {
+        printf("deduplicated blob content has changed after deleting the other\n");
+        errors++;
+    }
+    _DELEBB(bb2, B2, 0);
+    blobstore_close(bs);
+
+    printf("completed dedup test\n");
+done:
+    EUCA_FREE(buf);
+    EUCA_FREE(check);
+    return errors;
+}
+
+//!
+//! Checks that the blob index follows changes made through the blobstore and
+//! notices blobs removed behind its back
+//!
+//! @param[in] base
+//! @param[in] name
+//!
+//! @return the number of errors
+//!
+static int do_index_test(const char *base, const char *name)
+{
+    int ret;
+    int errors = 0;
+    int nresults;
+    blockblob_meta *results;
+    char path[PATH_MAX];
+    blobstore_meta meta;
+    blobstore_index *idx;
+    printf("commencing index test\n");
+
+    blobstore *bs = create_teststore(BS_SIZE, base, name, BLOBSTORE_FORMAT_FILES, BLOBSTORE_REVOCATION_LRU, BLOBSTORE_SNAPSHOT_ANY);
+    if (bs == NULL) {
+        errors++;
+        goto done;
+    }
+
+    blockblob *bb1, *bb2, *bb3;
+    _OPENBB(bb1, B1, BB_SIZE, NULL, _CBB, 0, 0);
+    _OPENBB(bb2, B2, BB_SIZE, NULL, _CBB, 0, 0);
+    _OPENBB(bb3, B3, BB_SIZE, NULL, _CBB, 0, 0);
+    if (errors)
+        goto done;
+    _CLOSBB(bb3, B3);
+    _SEARCH(".*", 3);                  // from the journal
+
+    // remove a blob behind the back of the blobstore, so the index must be rebuilt
+    set_blockblob_metadata_path(BLOCKBLOB_PATH_BLOCKS, bs, B3, path, sizeof(path));
+    unlink(path);
+    _SEARCH(".*", 2);
+
+    // forget the in-memory index, as if in another process, and replay the journal
+    if ((idx = get_index(bs)) != NULL)
+        clear_index(idx);
+    if ((blobstore_stat(bs, &meta) != 0) || (meta.num_blobs != 2) || (meta.blocks_locked != 2 * BB_SIZE)) {
+        printf("unexpected blobs after replaying the journal (%u blobs, %llu locked)\n", meta.num_blobs, meta.blocks_locked);
+        errors++;
+    }
+
+    _CLOSBB(bb2, B2);
+    _OPENBB(bb2, B2, 0, NULL, 0, 0, 0);
+    _DELEBB(bb2, B2, 0);
+    _DELEBB(bb1, B1, 0);
+    _SEARCH(".*", 0);
+    delete_blockblob_files(bs, B3);
+    blobstore_close(bs);
+
+    printf("completed index test\n");
+done:
+    return errors;
+}
+
 //!
 //!
 //!
@@ -5813,6 +7169,14 @@ int main(int argc, char **argv)
     if (errors)
         goto done;                     // no point in doing clone test if above isn't working
 
+    errors += do_dedup_test(cwd, "dedup");
+    if (errors)
+        goto done;
+
+    errors += do_index_test(cwd, "index");
+    if (errors)
+        goto done;
+
     errors += do_clone_test(cwd, "clone-with-snapshot", BLOBSTORE_FORMAT_DIRECTORY, BLOBSTORE_REVOCATION_LRU, BLOBSTORE_SNAPSHOT_DM, BLOBSTORE_SNAPSHOT);
     if (errors)
         goto done;                     // no point in doing clone stress test test if above isn't working
@@ -82,6 +82,7 @@
 #define MAX_DM_NAME                               128   //!< euca-819312998196-i-4336096F-prt-00512swap-ac8d5670
 #define MAX_DM_PATH                              (MAX_DM_NAME + 12) //!< /dev/mapper/euca-819312998196-i-4336096F-prt-00512swap-ac8d5670
 #define MAX_DM_LINE                              (MAX_DM_PATH * 2 + 40) //!< 0 1048576 snapshot $DM1 $DM2 p 16
+#define BLOBSTORE_CHUNK_BYTES                    (1024 * 1024)  //!< size of the content-addressed chunks blobs are deduplicated by
 
 //! @{
 //! @name default permissions for blosbstore content
@@ -220,6 +221,8 @@ typedef struct _blockblob {
     double priority;                   //!< priority, for assisting LRU
     int fd_lock;                       //!< file descriptor of the blockblob lock file
     int fd_blocks;                     //!< file descriptor of the blockblob content file
+    unsigned long long *chunks;        //!< content hashes of the blob's chunks, if it was deduplicated (0 = all zeros, not stored)
+    unsigned int num_chunks;           //!< number of entries in chunks
 
     // LL pointers
     struct _blockblob *next;
@@ -255,9 +258,11 @@ typedef struct _blobstore_meta {
     char id[BLOBSTORE_MAX_PATH];       //!< ID of the blobstore, to handle directory moving
     char path[PATH_MAX];               //!< canonical path of the blobstore directory
     unsigned long long blocks_limit;   //!< max size of the blobstore, in blocks
-    unsigned long long blocks_unlocked; //!< number of blocks in blobstore allocated to blobs that are not in use and is not mapped
-    unsigned long long blocks_locked;  //!< number of blocks in blobstore allocated to blobs that are in use or is mapped (a dependency)
+    unsigned long long blocks_unlocked; //!< number of blocks in blobstore allocated to blobs that are not in use and is not mapped (shared chunks counted once)
+    unsigned long long blocks_locked;  //!< number of blocks in blobstore allocated to blobs that are in use or is mapped (a dependency) (shared chunks counted once)
     unsigned long long blocks_allocated;    //!< number of blocks in blobstore that have been allocated on disk
+    unsigned long long blocks_logical; //!< number of blocks of all blobs, without accounting for chunks they share
+    unsigned long long blocks_physical; //!< number of blocks allocated on disk, counting extents shared by blobs once
     unsigned long long fs_bytes_size;  //!< size, in bytes, of the file system that blobstore resides on
     unsigned long long fs_bytes_available;  //!< bytes available on the file system that blobstore resides on
     int fs_id;                         //!< hash of file system ID, as returned by statfs()
@@ -320,6 +325,7 @@ int blockblob_close(blockblob * bb);
 int blockblob_delete(blockblob * bb, long long timeout_usec, char do_force);
 int blockblob_copy(blockblob * src_bb, unsigned long long src_offset_bytes, blockblob * dst_bb, unsigned long long dst_offset_bytes, unsigned long long len_bytes); //
 int blockblob_clone(blockblob * bb, const blockmap * map, unsigned int map_size);
+int blockblob_dedup(blockblob * bb);
 const char *blockblob_get_dev(blockblob * bb);
 const char *blockblob_get_file(blockblob * bb);
 blobstore *blockblob_get_blobstore(blockblob * bb);
@@ -86,7 +86,12 @@
 #include <sys/stat.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>                  // BLKGETSIZE64
 
+#include <eucalyptus-config.h>
 #include <eucalyptus.h>
 #include <misc.h>                      // logprintfl
 #include <ipc.h>                       // sem
@@ -104,12 +109,34 @@
 #define OUTPUT_ALLOC_CHUNK 1024
 #define MAX_OUTPUT_BYTES 1024*1024
 
+#define DISKUTIL_COPY_ALIGN                      4096   //!< Alignment of offsets, lengths and buffers required to write with O_DIRECT
+#define DISKUTIL_COPY_BUF_BYTES                  (4 * 1024 * 1024)  //!< Size of the buffer each copy worker reads into
+#define DISKUTIL_COPY_CHUNK_BYTES                (64 * 1024 * 1024) //!< Unit of work handed out to the copy workers
+#define DISKUTIL_COPY_MAX_WORKERS                4  //!< Maximum number of threads copying chunks of the same range
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                  TYPEDEFS                                  |
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+//! State shared by the threads copying one range in diskutil_copy()
+typedef struct diskutil_copy_job_t {
+    pthread_mutex_t mutex;             //!< Protects next, error, copied and zeroed
+    int in_fd;                         //!< Source descriptor
+    int out_fd;                        //!< Destination descriptor
+    boolean in_sparse;                 //!< Source is a regular file, so its holes can be found with SEEK_DATA/SEEK_HOLE
+    boolean out_file;                  //!< Destination is a regular file, so holes can be punched into it
+    boolean kernel_copy;               //!< Both ends are regular files, let copy_file_range() move the data
+    long long in_offset;               //!< Byte offset of the range in the source
+    long long out_offset;              //!< Byte offset of the range in the destination
+    long long len;                     //!< Length of the range in bytes
+    long long next;                    //!< Start (relative to the range) of the next chunk to hand out
+    long long copied;                  //!< Bytes of data copied so far
+    long long zeroed;                  //!< Bytes of source holes zeroed in the destination so far
+    int error;                         //!< First error hit by any worker (EUCA_OK if none)
+} diskutil_copy_job;
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                                ENUMERATIONS                                |
@@ -189,6 +216,10 @@ static char service_key_path[EUCA_MAX_PATH] = "/var/lib/eucalyptus/keys/node-pk.
 static char *pruntf(boolean log_error, char *format, ...)
 _attribute_wur_ _attribute_format_(2, 3);
 static char *execlp_output(boolean log_error, ...);
+static int diskutil_copy_zero(diskutil_copy_job * job, char *buf, long long pos, long long len);
+static int diskutil_copy_data(diskutil_copy_job * job, char *buf, long long pos, long long len);
+static int diskutil_copy_chunk(diskutil_copy_job * job, char *buf, long long start, long long end);
+static void *diskutil_copy_worker(void *arg);
 
 /*----------------------------------------------------------------------------*\
  |                                                                            |
@@ -328,6 +359,148 @@ int diskutil_ddzero(const char *path, const long long sectors, boolean zero_fill
     return (EUCA_INVALID_ERROR);
 }
 
+//!
+//! Copies a byte range from one file or block device to another within this
+//! process. The range is split in chunks that are copied by a few threads in
+//! parallel; holes in a sparse source are not read but zeroed (punched, when
+//! possible) in the destination, regular files are copied by the kernel with
+//! copy_file_range() when available and anything else goes through aligned
+//! buffers, with O_DIRECT on the destination when the range allows it. The
+//! destination is synced before returning, like 'dd conv=fsync'.
+//!
+//! @param[in] in path of the source
+//! @param[in] out path of the destination, created if it does not exist
+//! @param[in] in_offset byte offset of the range in the source
+//! @param[in] out_offset byte offset of the range in the destination
+//! @param[in] len_bytes number of bytes to copy (less if the source ends before)
+//! @param[in] truncate set to TRUE to truncate a regular destination file first
+//!
+//! @return EUCA_OK on success or the following error codes:
+//!         \li EUCA_ACCESS_ERROR: if either path cannot be opened by this process
+//!         \li EUCA_INVALID_ERROR: if any parameter does not meet the preconditions
+//!         \li EUCA_IO_ERROR: if reading, writing or syncing failed
+//!         \li EUCA_MEMORY_ERROR: if the copy buffers could not be allocated
+//!
+//! @pre Both in and out parameters must not be NULL and offsets and length must not be negative.
+//!
+//! @post On success the range from 'in' has been copied in 'out' and is on stable storage.
+//!
+//! @note Callers needing root privileges to open a device fall back to the rootwrap
+//!       helpers when EUCA_ACCESS_ERROR is returned.
+//!
+int diskutil_copy(const char *in, const char *out, long long in_offset, long long out_offset, long long len_bytes, boolean truncate)
+{
+    int i = 0;
+    int flags = 0;
+    int nworkers = 0;
+    int nthreads = 0;
+    int rc = EUCA_OK;
+    boolean direct = FALSE;
+    long long in_size = -1;
+    long long start_ms = 0;
+    struct stat in_st = { 0 };
+    struct stat out_st = { 0 };
+    pthread_t threads[DISKUTIL_COPY_MAX_WORKERS];
+    diskutil_copy_job job = { 0 };
+
+    if (!in || !out || (in_offset < 0) || (out_offset < 0) || (len_bytes < 0)) {
+        LOGWARN("bad params: in=%s, out=%s, in_offset=%lld, out_offset=%lld, len=%lld\n", SP(in), SP(out), in_offset, out_offset, len_bytes);
+        return (EUCA_INVALID_ERROR);
+    }
+
+    if ((job.in_fd = open(in, O_RDONLY)) < 0) {
+        LOGDEBUG("cannot open '%s' for reading: %s\n", in, strerror(errno));
+        return (EUCA_ACCESS_ERROR);
+    }
+
+    if (fstat(job.in_fd, &in_st) == 0) {
+        if (S_ISREG(in_st.st_mode)) {
+            in_size = in_st.st_size;
+            job.in_sparse = TRUE;
+        } else if (S_ISBLK(in_st.st_mode)) {
+            uint64_t bytes = 0;
+            if (ioctl(job.in_fd, BLKGETSIZE64, &bytes) == 0)
+                in_size = bytes;
+        }
+    }
+    // like dd, copy no further than the end of the source
+    if (in_size >= 0)
+        len_bytes = (in_offset >= in_size) ? (0) : (MIN(len_bytes, (in_size - in_offset)));
+
+    // two regular files are best copied by the kernel, anything else may bypass the page cache
+    if (stat(out, &out_st) == 0) {
+        job.kernel_copy = (job.in_sparse && S_ISREG(out_st.st_mode));
+    } else {
+        job.kernel_copy = job.in_sparse;
+    }
+#ifndef HAVE_COPY_FILE_RANGE
+    job.kernel_copy = FALSE;
+#endif /* ! HAVE_COPY_FILE_RANGE */
+    direct = (!job.kernel_copy && (in_size >= 0) && ((in_offset % DISKUTIL_COPY_ALIGN) == 0) && ((out_offset % DISKUTIL_COPY_ALIGN) == 0)
+              && ((len_bytes % DISKUTIL_COPY_ALIGN) == 0));
+
+    flags = O_WRONLY | O_CREAT | ((truncate) ? (O_TRUNC) : (0));
+    if ((job.out_fd = open(out, flags | ((direct) ? (O_DIRECT) : (0)), 0666)) < 0) {
+        if (direct && (errno == EINVAL)) {
+            // file system does not support O_DIRECT
+            direct = FALSE;
+            job.out_fd = open(out, flags, 0666);
+        }
+        if (job.out_fd < 0) {
+            LOGDEBUG("cannot open '%s' for writing: %s\n", out, strerror(errno));
+            close(job.in_fd);
+            return (EUCA_ACCESS_ERROR);
+        }
+    }
+    if (fstat(job.out_fd, &out_st) == 0)
+        job.out_file = S_ISREG(out_st.st_mode);
+    job.kernel_copy = (job.kernel_copy && job.out_file);
+
+    job.in_offset = in_offset;
+    job.out_offset = out_offset;
+    job.len = len_bytes;
+    job.error = EUCA_OK;
+    pthread_mutex_init(&job.mutex, NULL);
+
+    // the calling thread is one of the workers
+    start_ms = time_ms();
+    nworkers = (int)MIN(((len_bytes + DISKUTIL_COPY_CHUNK_BYTES - 1) / DISKUTIL_COPY_CHUNK_BYTES), DISKUTIL_COPY_MAX_WORKERS);
+    for (i = 1; i < nworkers; i++) {
+        if (pthread_create(&threads[nthreads], NULL, diskutil_copy_worker, &job) != 0) {
+            LOGWARN("cannot start copy worker, copying with %d thread(s)\n", (nthreads + 1));
+            break;
+        }
+        nthreads++;
+    }
+    diskutil_copy_worker(&job);
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&job.mutex);
+
+    if ((rc = job.error) == EUCA_OK) {
+        // holes punched at the end of a file do not extend it
+        if (job.out_file && (fstat(job.out_fd, &out_st) == 0) && (out_st.st_size < (out_offset + len_bytes))) {
+            if (ftruncate(job.out_fd, (out_offset + len_bytes)) != 0) {
+                LOGERROR("cannot extend '%s' to %lld bytes: %s\n", out, (out_offset + len_bytes), strerror(errno));
+                rc = EUCA_IO_ERROR;
+            }
+        }
+        if ((rc == EUCA_OK) && (fsync(job.out_fd) != 0)) {
+            LOGERROR("cannot sync '%s': %s\n", out, strerror(errno));
+            rc = EUCA_IO_ERROR;
+        }
+    }
+    close(job.out_fd);
+    close(job.in_fd);
+
+    if (rc == EUCA_OK) {
+        LOGDEBUG("copied %lld bytes (%lld zeroed from holes) in %lldms using %d thread(s)%s%s\n", job.copied, job.zeroed, (time_ms() - start_ms), (nthreads + 1),
+                 ((job.kernel_copy) ? (", copy_file_range") : ("")), ((direct) ? (", O_DIRECT") : ("")));
+    }
+    return (rc);
+}
+
 //!
 //!
 //!
@@ -344,6 +517,9 @@ int diskutil_ddzero(const char *path, const long long sectors, boolean zero_fill
 //!
 //! @post On success the data from 'in' has been copied in 'out'.
 //!
+//! @note The copy is done in-process by diskutil_copy() and only goes through
+//!       the rootwrap'ed dd when that fails (e.g. on a device owned by root).
+//!
 int diskutil_dd(const char *in, const char *out, const int bs, const long long count)
 {
     char *output = NULL;
@@ -352,6 +528,10 @@ int diskutil_dd(const char *in, const char *out, const int bs, const long long c
         LOGINFO("copying data from '%s'\n", in);
         LOGINFO("               to '%s' (blocks=%lld)\n", out, count);
 
+        if (diskutil_copy(in, out, 0, 0, ((long long)bs * count), TRUE) == EUCA_OK)
+            return (EUCA_OK);
+        LOGDEBUG("in-process copy failed, falling back to %s\n", helpers_path[DD]);
+
         char if_str[EUCA_MAX_PATH] = "";
         snprintf(if_str, sizeof(if_str), "if=%s", in);
         char of_str[EUCA_MAX_PATH] = "";
@@ -393,6 +573,9 @@ int diskutil_dd(const char *in, const char *out, const int bs, const long long c
 //!
 //! @post On success the data from 'in' has been copied in 'out'.
 //!
+//! @note The copy is done in-process by diskutil_copy() and only goes through
+//!       the rootwrap'ed dd when that fails (e.g. on a device owned by root).
+//!
 int diskutil_dd2(const char *in, const char *out, const int bs, const long long count, const long long seek, const long long skip)
 {
     char *output = NULL;
@@ -402,6 +585,10 @@ int diskutil_dd2(const char *in, const char *out, const int bs, const long long
         LOGINFO("               to '%s'\n", out);
         LOGINFO("               of %lld blocks (bs=%d), seeking %lld, skipping %lld\n", count, bs, seek, skip);
 
+        if (diskutil_copy(in, out, ((long long)bs * skip), ((long long)bs * seek), ((long long)bs * count), FALSE) == EUCA_OK)
+            return (EUCA_OK);
+        LOGDEBUG("in-process copy failed, falling back to %s\n", helpers_path[DD]);
+
         char if_str[EUCA_MAX_PATH] = "";
         snprintf(if_str, sizeof(if_str), "if=%s", in);
         char of_str[EUCA_MAX_PATH] = "";
@@ -1365,6 +1552,232 @@ long long round_down_sec(long long bytes)
     return ((bytes % SECTOR_SIZE) ? (((bytes / SECTOR_SIZE)) * SECTOR_SIZE) : bytes);
 }
 
+//!
+//! Zeroes a range of the destination that corresponds to a hole in the source,
+//! by punching a hole when the destination is a regular file or by writing zeros.
+//!
+//! @param[in] job the copy being performed
+//! @param[in] buf scratch buffer of DISKUTIL_COPY_BUF_BYTES bytes
+//! @param[in] pos start of the range, relative to the copied range
+//! @param[in] len length of the range in bytes
+//!
+//! @return EUCA_OK on success or EUCA_IO_ERROR if writing failed
+//!
+static int diskutil_copy_zero(diskutil_copy_job * job, char *buf, long long pos, long long len)
+{
+    ssize_t n = 0;
+    long long done = 0;
+    long long want = 0;
+
+#ifdef FALLOC_FL_PUNCH_HOLE
+    if (job->out_file && (fallocate(job->out_fd, (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE), (job->out_offset + pos), len) == 0)) {
+        done = len;
+    }
+#endif /* FALLOC_FL_PUNCH_HOLE */
+
+    if (done < len)
+        memset(buf, 0, MIN(len, DISKUTIL_COPY_BUF_BYTES));
+
+    while (done < len) {
+        want = MIN((len - done), DISKUTIL_COPY_BUF_BYTES);
+        if ((n = pwrite(job->out_fd, buf, want, (job->out_offset + pos + done))) < 0) {
+            if (errno == EINTR)
+                continue;
+            LOGERROR("cannot write zeros at offset %lld: %s\n", (job->out_offset + pos + done), strerror(errno));
+            return (EUCA_IO_ERROR);
+        }
+        done += n;
+    }
+
+    pthread_mutex_lock(&job->mutex);
+    job->zeroed += len;
+    pthread_mutex_unlock(&job->mutex);
+    return (EUCA_OK);
+}
+
+//!
+//! Copies a range of data from the source to the destination, with copy_file_range()
+//! when the job allows it and through the buffer otherwise.
+//!
+//! @param[in] job the copy being performed
+//! @param[in] buf buffer of DISKUTIL_COPY_BUF_BYTES bytes aligned on DISKUTIL_COPY_ALIGN
+//! @param[in] pos start of the range, relative to the copied range
+//! @param[in] len length of the range in bytes
+//!
+//! @return EUCA_OK on success (including when the source ends early) or EUCA_IO_ERROR
+//!
+static int diskutil_copy_data(diskutil_copy_job * job, char *buf, long long pos, long long len)
+{
+    ssize_t n = 0;
+    long long got = 0;
+    long long want = 0;
+    long long done = 0;
+    long long copied = 0;
+    int rc = EUCA_OK;
+
+#ifdef HAVE_COPY_FILE_RANGE
+    if (job->kernel_copy) {
+        loff_t in_off = (job->in_offset + pos);
+        loff_t out_off = (job->out_offset + pos);
+
+        while (copied < len) {
+            if ((n = copy_file_range(job->in_fd, &in_off, job->out_fd, &out_off, (len - copied), 0)) < 0) {
+                if (errno == EINTR)
+                    continue;
+                if ((errno == EXDEV) || (errno == EINVAL) || (errno == ENOSYS) || (errno == EOPNOTSUPP)) {
+                    // not supported between these two, finish through the buffer
+                    pthread_mutex_lock(&job->mutex);
+                    job->kernel_copy = FALSE;
+                    pthread_mutex_unlock(&job->mutex);
+                    break;
+                }
+                LOGERROR("cannot copy %lld bytes at offset %lld: %s\n", (len - copied), (long long)in_off, strerror(errno));
+                rc = EUCA_IO_ERROR;
+                break;
+            }
+            if (n == 0) {
+                // source ended
+                len = copied;
+                break;
+            }
+            copied += n;
+        }
+    }
+#endif /* HAVE_COPY_FILE_RANGE */
+
+    while ((rc == EUCA_OK) && (copied < len)) {
+        want = MIN((len - copied), DISKUTIL_COPY_BUF_BYTES);
+        for (got = 0; got < want; got += n) {
+            if ((n = pread(job->in_fd, (buf + got), (want - got), (job->in_offset + pos + copied + got))) < 0) {
+                if (errno == EINTR) {
+                    n = 0;
+                    continue;
+                }
+                LOGERROR("cannot read at offset %lld: %s\n", (job->in_offset + pos + copied + got), strerror(errno));
+                rc = EUCA_IO_ERROR;
+                break;
+            }
+            if (n == 0)
+                break;
+        }
+
+        for (done = 0; (rc == EUCA_OK) && (done < got); done += n) {
+            if ((n = pwrite(job->out_fd, (buf + done), (got - done), (job->out_offset + pos + copied + done))) < 0) {
+                if (errno == EINTR) {
+                    n = 0;
+                    continue;
+                }
+                LOGERROR("cannot write at offset %lld: %s\n", (job->out_offset + pos + copied + done), strerror(errno));
+                rc = EUCA_IO_ERROR;
+            }
+        }
+
+        copied += got;
+        if (got < want) {
+            // source ended
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&job->mutex);
+    job->copied += copied;
+    pthread_mutex_unlock(&job->mutex);
+    return (rc);
+}
+
+//!
+//! Copies one chunk of the range, skipping over the holes of a sparse source.
+//!
+//! @param[in] job the copy being performed
+//! @param[in] buf buffer of DISKUTIL_COPY_BUF_BYTES bytes aligned on DISKUTIL_COPY_ALIGN
+//! @param[in] start start of the chunk, relative to the copied range
+//! @param[in] end end of the chunk (excluded), relative to the copied range
+//!
+//! @return EUCA_OK on success or the error of diskutil_copy_zero() or diskutil_copy_data()
+//!
+static int diskutil_copy_chunk(diskutil_copy_job * job, char *buf, long long start, long long end)
+{
+    int rc = EUCA_OK;
+    long long pos = start;
+    long long data_end = 0;
+
+    while ((rc == EUCA_OK) && (pos < end)) {
+        data_end = end;
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+        if (job->in_sparse) {
+            long long hole_end = pos;
+            off_t off = lseek(job->in_fd, (job->in_offset + pos), SEEK_DATA);
+
+            if (off < 0) {
+                // ENXIO means there is no more data in the file, anything else that holes cannot be found
+                if (errno == ENXIO)
+                    hole_end = end;
+            } else {
+                hole_end = MIN((off - job->in_offset), end);
+            }
+
+            if (hole_end > pos) {
+                rc = diskutil_copy_zero(job, buf, pos, (hole_end - pos));
+                pos = hole_end;
+                continue;
+            }
+
+            if ((off = lseek(job->in_fd, (job->in_offset + pos), SEEK_HOLE)) > (job->in_offset + pos))
+                data_end = MIN((off - job->in_offset), end);
+        }
+#endif /* SEEK_DATA && SEEK_HOLE */
+        rc = diskutil_copy_data(job, buf, pos, (data_end - pos));
+        pos = data_end;
+    }
+    return (rc);
+}
+
+//!
+//! Copy thread: takes chunks of the range until none is left or any worker failed.
+//!
+//! @param[in] arg the diskutil_copy_job being performed
+//!
+//! @return Always NULL, errors are recorded in the job
+//!
+static void *diskutil_copy_worker(void *arg)
+{
+    int rc = EUCA_OK;
+    void *buf = NULL;
+    long long start = 0;
+    diskutil_copy_job *job = ((diskutil_copy_job *) arg);
+
+    if (posix_memalign(&buf, DISKUTIL_COPY_ALIGN, DISKUTIL_COPY_BUF_BYTES) != 0) {
+        LOGERROR("cannot allocate copy buffer\n");
+        pthread_mutex_lock(&job->mutex);
+        if (job->error == EUCA_OK)
+            job->error = EUCA_MEMORY_ERROR;
+        pthread_mutex_unlock(&job->mutex);
+        return (NULL);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&job->mutex);
+        if ((job->error != EUCA_OK) || (job->next >= job->len)) {
+            pthread_mutex_unlock(&job->mutex);
+            break;
+        }
+        start = job->next;
+        job->next += DISKUTIL_COPY_CHUNK_BYTES;
+        pthread_mutex_unlock(&job->mutex);
+
+        if ((rc = diskutil_copy_chunk(job, buf, start, MIN((start + DISKUTIL_COPY_CHUNK_BYTES), job->len))) != EUCA_OK) {
+            pthread_mutex_lock(&job->mutex);
+            if (job->error == EUCA_OK)
+                job->error = rc;
+            pthread_mutex_unlock(&job->mutex);
+            break;
+        }
+    }
+
+    free(buf);
+    return (NULL);
+}
+
 #ifdef _UNIT_TEST
 int main(int argc, char *argv[])
 {
@@ -1397,6 +1810,37 @@ int main(int argc, char *argv[])
     output = execlp_output(TRUE, "ls", "a-ridiculously-long-name-that-does-not-exist", NULL);
     assert(output == NULL);
 
+    {                                  // test diskutil_copy() on a sparse file spanning several chunks
+        char src[] = "/tmp/diskutil-copy-src-XXXXXX";
+        char dst[] = "/tmp/diskutil-copy-dst-XXXXXX";
+        long long len = 3 * DISKUTIL_COPY_CHUNK_BYTES + 12345;
+        long long offsets[] = { 0, 4096, DISKUTIL_COPY_CHUNK_BYTES - 10, 2 * DISKUTIL_COPY_CHUNK_BYTES + 777 };
+        char a[8192], b[8192];
+        int sfd = mkstemp(src);
+        int dfd = mkstemp(dst);
+        assert((sfd >= 0) && (dfd >= 0));
+        assert(ftruncate(sfd, len) == 0);
+        memset(a, 0xEB, sizeof(a));
+        for (int i = 0; i < (sizeof(offsets) / sizeof(offsets[0])); i++) {
+            assert(pwrite(sfd, a, sizeof(a), offsets[i]) == sizeof(a));
+        }
+        memset(b, 0xFF, sizeof(b));
+        assert(pwrite(dfd, b, sizeof(b), DISKUTIL_COPY_CHUNK_BYTES + 512) == sizeof(b));  // garbage where the source has a hole
+
+        assert(diskutil_copy(src, dst, 0, 512, len, FALSE) == EUCA_OK);
+        for (long long off = 0; off < len; off += sizeof(a)) {
+            ssize_t n = pread(sfd, a, sizeof(a), off);
+            assert((n > 0) && (pread(dfd, b, n, off + 512) == n));
+            assert(memcmp(a, b, n) == 0);
+        }
+        assert(diskutil_copy(src, "/a/path/that/does/not/exist", 0, 0, len, FALSE) == EUCA_ACCESS_ERROR);
+
+        close(sfd);
+        close(dfd);
+        unlink(src);
+        unlink(dst);
+    }
+
     {                                  // test diskutil_get_parts()
         struct partition_table_entry parts[5];
         int n = diskutil_get_parts("/dev/sda", parts, 5);
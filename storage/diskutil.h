@@ -136,6 +136,7 @@ int imaging_image_by_manifest_url(const char *instanceId, const char *url, const
 int diskutil_init(int check_first);
 int diskutil_cleanup(void);
 int diskutil_ddzero(const char *path, const long long sectors, boolean zero_fill);
+int diskutil_copy(const char *in, const char *out, long long in_offset, long long out_offset, long long len_bytes, boolean truncate);
 int diskutil_dd(const char *in, const char *out, const int bs, const long long count);
 int diskutil_dd2(const char *in, const char *out, const int bs, const long long count, const long long seek, const long long skip);
 int diskutil_mbr(const char *path, const char *type);
@@ -76,6 +76,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <time.h>
 #include <unistd.h>                    /* close */
 #include <assert.h>
@@ -84,6 +85,7 @@
 #include <fcntl.h>                     /* open */
 #include <curl/curl.h>
 #include <curl/easy.h>
+#include <openssl/crypto.h>
 #include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -110,10 +112,13 @@
 #define TOTAL_ATTEMPTS                                9 //!< download is retried in case of connection problems (13+ min of retrying)
 #define FIRST_TIMEOUT                                 2 //!< in seconds, goes in powers of two afterwards
 #define MAX_TIMEOUT                                 300 //!< in seconds, the cap for growing timeout values
-#define CHUNK                                    262144 //!< buffer size for decompression operations
 #define BUFSIZE                                  262144 //!< should be big enough for CERT and the signature
 #define STRSIZE                                    1024 //!< for short strings: files, hosts, URLs
 #define PROGRESS_UPDATE_SEC                           3 //!< how often to report on progress of long downloads
+#define PIPE_BUF_BYTES                  (1024 * 1024)   //!< size of each buffer handed between the stages of a download
+#define PIPE_BUF_ALIGN                             4096 //!< alignment of the download buffers
+#define PIPE_DEPTH                                    4 //!< number of buffers in flight between two stages of a download
+#define DIGEST_MAX_BYTES                        2000000 //!< largest digest we are willing to keep in memory
 
 #define OBJECT_STORAGE_ENDPOINT                          "/services/objectstorage"
 #define DEFAULT_HOST_PORT                        "localhost:8773"
@@ -142,11 +147,48 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+//! Buffer handed between the stages of a download
+struct pipe_buf {
+    unsigned char *data;               //!< PIPE_BUF_BYTES bytes aligned on PIPE_BUF_ALIGN
+    size_t len;                        //!< bytes of data filled in
+};
+
+//! Bounded FIFO of buffers between two stages of a download
+struct pipe_queue {
+    struct pipe_buf *bufs[PIPE_DEPTH]; //!< ring of queued buffers
+    int head;                          //!< index of the oldest queued buffer
+    int count;                         //!< number of queued buffers
+    boolean closed;                    //!< set by the producer once it will queue nothing more
+};
+
 //! Defines the OBJECT_STORAGE request structure
+//!
+//! The curl thread only copies the received data into large buffers. When the
+//! stream is compressed, an inflater thread decompresses those into a second set
+//! of buffers and a writer thread writes the results out, so the transfer never
+//! waits on zlib or on the disk unless all buffers are in use.
 struct request {
-    int fd;                            //!< output file descriptor to be used by curl WRITERs
+    int fd;                            //!< output file descriptor to be used by the writer
     long long total_wrote;             //!< bytes written during the operation
     long long total_calls;             //!< write calls made during the operation
+    boolean do_compress;               //!< TRUE if the stream must be inflated before it is written
+    struct pipe_buf raw[PIPE_DEPTH];   //!< buffers filled by curl when the stream is compressed
+    struct pipe_buf out[PIPE_DEPTH];   //!< buffers consumed by the writer
+    struct pipe_queue raw_free;        //!< raw buffers curl can fill
+    struct pipe_queue raw_full;        //!< raw buffers waiting to be inflated
+    struct pipe_queue out_free;        //!< out buffers the inflater (or curl) can fill
+    struct pipe_queue out_full;        //!< out buffers waiting to be written
+    struct pipe_buf *cur;              //!< buffer curl is currently filling
+    int error;                         //!< first failure of any stage, EUCA_OK otherwise
+    boolean inflating;                 //!< TRUE if the inflater thread was started
+    boolean writing;                   //!< TRUE if the writer thread was started
+    pthread_t inflater;                //!< thread inflating raw buffers
+    pthread_t writer;                  //!< thread writing out buffers
+    pthread_mutex_t mutex;             //!< protects the queues and the error
+    pthread_cond_t cond;               //!< signaled on any change of the queues or the error
+    char *mem;                         //!< response kept in memory when there is no output file
+    size_t mem_len;                    //!< bytes of response in mem
+    size_t mem_size;                   //!< bytes allocated for mem
 #if defined (CAN_GZIP)
     z_stream strm;                     //!< stream struct used by zlib
     int ret;                           //!< return value of last inflate() call
@@ -179,8 +221,12 @@ struct progress_data_t {
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
-//! objectstorage_request internal lock to prevent apparent race in curl ssl dependency
+//! objectstorage_request internal lock serializing libcurl initialization and request signing
 static pthread_mutex_t wreq_mutex = PTHREAD_MUTEX_INITIALIZER;
+static boolean curl_initialized = FALSE;    //!< boolean to indicate if we have already initialize libcurl
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static pthread_mutex_t *ssl_locks = NULL;   //!< locks handed to OpenSSL so transfers can run concurrently
+#endif /* OPENSSL_VERSION_NUMBER < 0x10100000L */
 static unsigned short total_attempts = TOTAL_ATTEMPTS;
 
 /*----------------------------------------------------------------------------*\
@@ -189,15 +235,30 @@ static unsigned short total_attempts = TOTAL_ATTEMPTS;
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static unsigned long ssl_id_callback(void);
+static void ssl_locking_callback(int mode, int n, const char *file, int line);
+#endif /* OPENSSL_VERSION_NUMBER < 0x10100000L */
+static void init_ssl_locks(void);
 static int objectstorage_request_timeout(const char *objectstorage_op, const char *verb, const char *requested_url, const char *outfile, const int do_compress,
-                                         int connect_timeout, int total_timeout);
+                                         int connect_timeout, int total_timeout, char **reply);
+static int pipe_alloc(struct request *params);
+static void pipe_free(struct request *params);
+static struct pipe_buf *pipe_get(struct request *params, struct pipe_queue *q);
+static void pipe_put(struct request *params, struct pipe_queue *q, struct pipe_buf *buf);
+static void pipe_close(struct request *params, struct pipe_queue *q);
+static void pipe_fail(struct request *params, int error);
+static int pipe_start(struct request *params);
+static int pipe_finish(struct request *params);
+static void *pipe_writer(void *arg);
 static size_t write_header(void *buffer, size_t size, size_t nmemb, void *params);
 static size_t write_data(void *buffer, size_t size, size_t nmemb, void *params);
+static size_t write_data_mem(void *buffer, size_t size, size_t nmemb, void *params);
 
 #if defined(CAN_GZIP)
 static void print_data(unsigned char *buf, const int size);
 static void zerr(int ret, char *where);
-static size_t write_data_zlib(void *buffer, size_t size, size_t nmemb, void *params);
+static void *pipe_inflater(void *arg);
 #endif /* CAN_GZIP */
 
 static int progress_function(void *clientp, double dltotal, double dlnow, double ultotal, double ulnow);
@@ -214,6 +275,61 @@ static int progress_function(void *clientp, double dltotal, double dlnow, double
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+//!
+//! Thread id callback for OpenSSL versions that need one
+//!
+//! @return the calling thread's identifier
+//!
+static unsigned long ssl_id_callback(void)
+{
+    return ((unsigned long)pthread_self());
+}
+
+//!
+//! Locking callback for OpenSSL versions that need one
+//!
+//! @param[in] mode CRYPTO_LOCK to acquire the lock, anything else to release it
+//! @param[in] n the index of the OpenSSL lock
+//! @param[in] file unused
+//! @param[in] line unused
+//!
+static void ssl_locking_callback(int mode, int n, const char *file, int line)
+{
+    if (mode & CRYPTO_LOCK)
+        pthread_mutex_lock(&ssl_locks[n]);
+    else
+        pthread_mutex_unlock(&ssl_locks[n]);
+}
+#endif /* OPENSSL_VERSION_NUMBER < 0x10100000L */
+
+//!
+//! Makes OpenSSL safe for the concurrent transfers started by objectstorage_request_timeout().
+//! OpenSSL 1.1 and later lock internally; older versions need callbacks, which are only
+//! installed if nobody in the process has installed their own.
+//!
+//! @pre must be called with wreq_mutex held
+//!
+static void init_ssl_locks(void)
+{
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    int i = 0;
+
+    if ((ssl_locks != NULL) || (CRYPTO_get_locking_callback() != NULL))
+        return;
+
+    if ((ssl_locks = EUCA_ZALLOC(CRYPTO_num_locks(), sizeof(pthread_mutex_t))) == NULL) {
+        LOGFATAL("out of memory allocating OpenSSL locks\n");
+        return;
+    }
+    for (i = 0; i < CRYPTO_num_locks(); i++)
+        pthread_mutex_init(&ssl_locks[i], NULL);
+
+    CRYPTO_set_id_callback(ssl_id_callback);
+    CRYPTO_set_locking_callback(ssl_locking_callback);
+#endif /* OPENSSL_VERSION_NUMBER < 0x10100000L */
+}
+
 //!
 //! downloads a decrypted image from objectstorage based on the manifest URL,
 //! saves it to outfile. Uses EucaV2 signing for the request. We keep
@@ -222,19 +338,24 @@ static int progress_function(void *clientp, double dltotal, double dlnow, double
 //! @param[in] objectstorage_op
 //! @param[in] verb
 //! @param[in] requested_url
-//! @param[in] outfile
+//! @param[in] outfile path of the file to write the response to, or NULL to return it in reply
 //! @param[in] do_compress
 //! @param[in] connect_timeout
 //! @param[in] total_timeout
+//! @param[out] reply set to a newly allocated copy of the response when outfile is NULL
 //!
 //! @return EUCA_OK on success or proper error code. Known error code returned include: EUCA_ERROR.
 //!
+//! @note the wreq_mutex is only held while the request is built and signed; the
+//!       transfers themselves run concurrently.
+//!
 static int objectstorage_request_timeout(const char *objectstorage_op, const char *verb, const char *requested_url, const char *outfile, const int do_compress,
-                                         int connect_timeout, int total_timeout)
+                                         int connect_timeout, int total_timeout, char **reply)
 {
     int fd = -1;
     int code = EUCA_ERROR;
     int timeout = FIRST_TIMEOUT;
+    int attempts = total_attempts;
     long httpcode = 0;
     char *url_path = NULL;
     char *newline = NULL;
@@ -253,8 +374,19 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
     struct request params = { 0 };
     struct curl_slist *headers = NULL; // beginning of a DLL with headers
 
+    if ((outfile == NULL) && (reply == NULL)) {
+        LOGERROR("objectstorage request has nowhere to put the result\n");
+        return (code);
+    }
+
     pthread_mutex_lock(&wreq_mutex);   // lock for curl construction
 
+    if (!curl_initialized) {
+        curl_global_init(CURL_GLOBAL_SSL);
+        init_ssl_locks();
+        curl_initialized = TRUE;
+    }
+
     euca_strncpy(url, requested_url, BUFSIZE);
 #if defined(CAN_GZIP)
     if (do_compress)
@@ -279,20 +411,24 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
         pthread_mutex_unlock(&wreq_mutex);
         return code;
     }
-    // we do not truncate the file because its size was set at blobstore allocation and
-    // it should reflect the size of the stored blob for accounting to work
-    fd = open(outfile, O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR);
-    if ((fd == -1) || (lseek(fd, 0, SEEK_SET) == -1)) {
-        LOGERROR("failed to open %s for writing result of objectstorage request\n", outfile);
-        pthread_mutex_unlock(&wreq_mutex);
-        if (fd >= 0)
-            close(fd);
-        return (code);
+
+    if (outfile != NULL) {
+        // we do not truncate the file because its size was set at blobstore allocation and
+        // it should reflect the size of the stored blob for accounting to work
+        fd = open(outfile, O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR);
+        if ((fd == -1) || (lseek(fd, 0, SEEK_SET) == -1)) {
+            LOGERROR("failed to open %s for writing result of objectstorage request\n", outfile);
+            pthread_mutex_unlock(&wreq_mutex);
+            if (fd >= 0)
+                close(fd);
+            return (code);
+        }
     }
 
     if ((curl = curl_easy_init()) == NULL) {
         LOGERROR("could not initialize libcurl\n");
-        close(fd);
+        if (fd >= 0)
+            close(fd);
         pthread_mutex_unlock(&wreq_mutex);
         return (code);
     }
@@ -305,6 +441,7 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
     curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 360L);  // must have at least a 360 baud modem
     curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 10L);    // abort if below speed limit for this many seconds
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);  //! @todo remove the comment once we want to follow redirects (e.g., on HTTP 407)
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);   // timeouts must not rely on signals with several transfers in flight
 
     // enable periodic progress statements in the log
     curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L); // enable progress function invocation
@@ -321,10 +458,12 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
         //! TODO: HEAD isn't very useful atm since we don't look at headers
         curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
     } else {
-        close(fd);
+        if (fd >= 0)
+            close(fd);
         LOGERROR("invalid HTTP verb %s for objectstorage request\n", verb);
+        curl_easy_cleanup(curl);
         pthread_mutex_unlock(&wreq_mutex);
-        return EUCA_ERROR;             //! TODO: dealloc structs before returning!
+        return EUCA_ERROR;
     }
 
     if (connect_timeout > 0) {
@@ -334,15 +473,17 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
     if (total_timeout > 0) {
         curl_easy_setopt(curl, CURLOPT_TIMEOUT, total_timeout);
     }
-    // set up the default write function, but possibly override it below, if compression is desired and possible
+    // files are written through the download pipeline, replies are kept in memory
     params.fd = fd;
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &params);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
 #if defined(CAN_GZIP)
-    if (do_compress) {
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data_zlib);
-    }
+    params.do_compress = (do_compress ? TRUE : FALSE);
 #endif
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &params);
+    if (outfile != NULL) {
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data_mem);
+    }
 
     if (objectstorage_op != NULL) {
         snprintf(op_hdr, STRSIZE, "EucaOperation: %s", objectstorage_op);
@@ -354,7 +495,10 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
 
     //Format for time
     if (strftime(date_str, 17, "%Y%m%dT%H%M%SZ", &tmp_t) == 0) {
-        close(fd);
+        if (fd >= 0)
+            close(fd);
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
         pthread_mutex_unlock(&wreq_mutex);
         return (EUCA_ERROR);
     }
@@ -371,6 +515,10 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
 
     if ((url_host = process_url(url, URL_HOSTNAME)) == NULL) {
         LOGERROR("objectstorage URL has no host\n");
+        if (fd >= 0)
+            close(fd);
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
         pthread_mutex_unlock(&wreq_mutex);
         return code;
     }
@@ -380,7 +528,10 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
 
     // create objectstorage-compliant sig
     if ((auth_str = eucav2_sign_request(verb, url, headers)) == NULL) {
-        close(fd);
+        if (fd >= 0)
+            close(fd);
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
         pthread_mutex_unlock(&wreq_mutex);
         EUCA_FREE(url_host);
         return (EUCA_ERROR);
@@ -394,16 +545,26 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
     if (objectstorage_op) {
         LOGDEBUG("writing %s/%s output\n", verb, objectstorage_op);
         LOGDEBUG("        from %s\n", url);
-        LOGDEBUG("        to %s\n", outfile);
+        LOGDEBUG("        to %s\n", SP(outfile));
     } else {
-        LOGDEBUG("writing %s output to %s\n", verb, outfile);
+        LOGDEBUG("writing %s output to %s\n", verb, SP(outfile));
+    }
+
+    // the handle and the signed headers are private to this request, so the
+    // transfer itself does not need to be serialized with other downloads
+    pthread_mutex_unlock(&wreq_mutex);
+
+    if ((outfile != NULL) && (pipe_alloc(&params) != EUCA_OK)) {
+        LOGERROR("failed to allocate download buffers for %s\n", outfile);
+        attempts = 0;
     }
 
-    for (int attempt = 1; attempt <= total_attempts; attempt++) {
+    for (int attempt = 1; attempt <= attempts; attempt++) {
         params.total_wrote = 0L;
         params.total_calls = 0L;
+        params.mem_len = 0;
 #if defined(CAN_GZIP)
-        if (do_compress) {
+        if (params.do_compress) {
             // allocate zlib inflate state
             params.strm.zalloc = Z_NULL;
             params.strm.zfree = Z_NULL;
@@ -418,17 +579,19 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
         }
 #endif
 
-        //! @todo There used to be a 'pthread_mutex_unlock(&wreq_mutex)' before curl invocation
-        //! and a 'lock' after it, but under heavy load we were seeing failures inside
-        //! libcurl code that would propagate to NC, implying lack of thread safety in
-        //! the library. For now, we will serialize all curl operations, but in the future
-        //! an approach to parallelizing objectstorage downloads is necessary
-        LOGINFO("downloading %s\n", url);
-        result = curl_easy_perform(curl);   // do it
+        int pipe_error = EUCA_OK;
+        if ((outfile != NULL) && ((pipe_error = pipe_start(&params)) != EUCA_OK)) {
+            LOGERROR("failed to start the download pipeline for %s\n", outfile);
+        } else {
+            LOGINFO("downloading %s\n", url);
+            result = curl_easy_perform(curl);   // do it
+            if (outfile != NULL)
+                pipe_error = pipe_finish(&params);
+        }
         LOGDEBUG("wrote %lld byte(s) in %lld write(s)\n", params.total_wrote, params.total_calls);
 
 #if defined(CAN_GZIP)
-        if (do_compress) {
+        if (params.do_compress) {
             inflateEnd(&(params.strm));
             if (params.ret != Z_STREAM_END) {
                 zerr(params.ret, "objectstorage_request");
@@ -438,7 +601,9 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
 
         boolean bail = FALSE;
 
-        if (result) {                  // curl error (connection or transfer failed)
+        if (pipe_error != EUCA_OK) {   // failed to inflate or write what was received
+            LOGERROR("failed to store the result of objectstorage request in %s\n", outfile);
+        } else if (result) {           // curl error (connection or transfer failed)
             LOGERROR("connection to objectstorage failed: %s (%d)\n", error_msg, result);
         } else {
             curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpcode);
@@ -446,7 +611,7 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
 
             switch (httpcode) {
             case 200L:                // all good
-                LOGINFO("downloaded %s\n", outfile);
+                LOGINFO("downloaded %s\n", SP(outfile));
                 code = EUCA_OK;
                 break;
             case 408L:                // timeout, retry
@@ -462,28 +627,35 @@ static int objectstorage_request_timeout(const char *objectstorage_op, const cha
         if (code == EUCA_OK || bail == TRUE) {
             break;                     // bail out of the retry loop
 
-        } else if ((attempt + 1) <= total_attempts) {
-            LOGWARN("download attempt %d of %d will commence in %d sec for %s\n", (attempt + 1), total_attempts, timeout, url);
+        } else if ((attempt + 1) <= attempts) {
+            LOGWARN("download attempt %d of %d will commence in %d sec for %s\n", (attempt + 1), attempts, timeout, url);
             sleep(timeout);
             timeout <<= 1;
             if (timeout > MAX_TIMEOUT)
                 timeout = MAX_TIMEOUT;
-
-            lseek(fd, 0L, SEEK_SET);   // move the file pointer to the beginning for the retry
         }
     }
-    close(fd);
+
+    if (fd >= 0)
+        close(fd);
+    pipe_free(&params);
 
     if (code != EUCA_OK) {
-        LOGINFO("due to error, removing %s\n", outfile);
-        remove(outfile);
+        if (outfile != NULL) {
+            LOGINFO("due to error, removing %s\n", outfile);
+            remove(outfile);
+        }
+        EUCA_FREE(params.mem);
+    } else if (reply != NULL) {
+        *reply = params.mem;           // already terminated by write_data_mem()
+        if (*reply == NULL)
+            *reply = strdup("");
     }
 
     EUCA_FREE(auth_str);
     EUCA_FREE(url_host);
     curl_slist_free_all(headers);
     curl_easy_cleanup(curl);
-    pthread_mutex_unlock(&wreq_mutex);
     return (code);
 }
 
@@ -518,7 +690,7 @@ int objectstorage_set_max_download_attempts(unsigned short new_max_attempts)
 //!
 int objectstorage_object_by_url(const char *url, const char *outfile, const int do_compress)
 {
-    return objectstorage_request_timeout(NULL, "GET", url, outfile, do_compress, CONNECT_TIMEOUT_SEC, TOTAL_TIMEOUT_SEC);
+    return objectstorage_request_timeout(NULL, "GET", url, outfile, do_compress, CONNECT_TIMEOUT_SEC, TOTAL_TIMEOUT_SEC, NULL);
 }
 
 //!
@@ -555,7 +727,7 @@ int objectstorage_object_by_path(const char *path, const char *outfile, const in
 //!
 int objectstorage_image_by_manifest_url(const char *url, const char *outfile, const int do_compress)
 {
-    return objectstorage_request_timeout(GET_IMAGE_CMD, "GET", url, outfile, do_compress, CONNECT_TIMEOUT_SEC, TOTAL_TIMEOUT_SEC);
+    return objectstorage_request_timeout(GET_IMAGE_CMD, "GET", url, outfile, do_compress, CONNECT_TIMEOUT_SEC, TOTAL_TIMEOUT_SEC, NULL);
 }
 
 //!
@@ -580,41 +752,24 @@ int objectstorage_image_by_manifest_path(const char *manifest_path, const char *
 
 //!
 //! downloads a digest and returns it as a new string (or NULL if error)
-//! that the caller must free
+//! that the caller must free. The digest is collected in memory as it is
+//! received, so it never goes through a temporary file.
 //!
 //! @param[in] url
 //!
 //! @return the digested string.
 //!
-//! @see file2strn()
-//!
 //! @note the caller must free the returned memory when done.
 //!
 char *objectstorage_get_digest(const char *url)
 {
     char *digest_str = NULL;
-    char *digest_path = strdup("/tmp/objectstorage-digest-XXXXXX");
-
-    if (!digest_path) {
-        LOGERROR("out of memory (failed to allocate digest path)\n");
-        return digest_path;
-    }
-
-    int tmp_fd = safe_mkstemp(digest_path);
-    if (tmp_fd < 0) {
-        LOGERROR("failed to create a digest file %s (unable to write to /tmp)\n", digest_path);
-    } else {
-        close(tmp_fd);                 // objectstorage_ routine will reopen the file
 
-        // download a fresh digest
-        if (objectstorage_object_by_url(url, digest_path, 0) != 0) {
-            LOGERROR("failed to download digest to %s\n", digest_path);
-        } else {
-            digest_str = file2strn(digest_path, 2000000);
-        }
-        unlink(digest_path);
+    // download a fresh digest
+    if (objectstorage_request_timeout(NULL, "GET", url, NULL, 0, CONNECT_TIMEOUT_SEC, TOTAL_TIMEOUT_SEC, &digest_str) != EUCA_OK) {
+        LOGERROR("failed to download digest from %s\n", url);
+        return (NULL);
     }
-    EUCA_FREE(digest_path);
     return digest_str;
 }
 
@@ -652,6 +807,222 @@ int objectstorage_verify_digest(const char *url, const char *old_digest_path)
     return e;
 }
 
+//!
+//! Allocates the buffers of the download pipeline of a request
+//!
+//! @param[in] params the request
+//!
+//! @return EUCA_OK on success or EUCA_MEMORY_ERROR
+//!
+static int pipe_alloc(struct request *params)
+{
+    void *data = NULL;
+
+    pthread_mutex_init(&params->mutex, NULL);
+    pthread_cond_init(&params->cond, NULL);
+    for (int i = 0; i < PIPE_DEPTH; i++) {
+        if (posix_memalign(&data, PIPE_BUF_ALIGN, PIPE_BUF_BYTES) != 0)
+            return (EUCA_MEMORY_ERROR);
+        params->out[i].data = data;
+        if (!params->do_compress)
+            continue;
+        if (posix_memalign(&data, PIPE_BUF_ALIGN, PIPE_BUF_BYTES) != 0)
+            return (EUCA_MEMORY_ERROR);
+        params->raw[i].data = data;
+    }
+    return (EUCA_OK);
+}
+
+//!
+//! Frees whatever pipe_alloc() allocated for a request
+//!
+//! @param[in] params the request
+//!
+static void pipe_free(struct request *params)
+{
+    if (params->out[0].data == NULL)
+        return;
+
+    for (int i = 0; i < PIPE_DEPTH; i++) {
+        EUCA_FREE(params->out[i].data);
+        EUCA_FREE(params->raw[i].data);
+    }
+    pthread_cond_destroy(&params->cond);
+    pthread_mutex_destroy(&params->mutex);
+}
+
+//!
+//! Takes the oldest buffer off a queue, waiting for one if needed
+//!
+//! @param[in] params the request
+//! @param[in] q the queue
+//!
+//! @return the buffer or NULL if the queue was closed and is empty, or if any stage failed
+//!
+static struct pipe_buf *pipe_get(struct request *params, struct pipe_queue *q)
+{
+    struct pipe_buf *buf = NULL;
+
+    pthread_mutex_lock(&params->mutex);
+    while ((q->count == 0) && !q->closed && (params->error == EUCA_OK))
+        pthread_cond_wait(&params->cond, &params->mutex);
+    if ((q->count > 0) && (params->error == EUCA_OK)) {
+        buf = q->bufs[q->head];
+        q->head = (q->head + 1) % PIPE_DEPTH;
+        q->count--;
+        pthread_cond_broadcast(&params->cond);
+    }
+    pthread_mutex_unlock(&params->mutex);
+    return (buf);
+}
+
+//!
+//! Adds a buffer to a queue. A queue never holds more buffers than its pool
+//! has, so this never waits.
+//!
+//! @param[in] params the request
+//! @param[in] q the queue
+//! @param[in] buf the buffer
+//!
+static void pipe_put(struct request *params, struct pipe_queue *q, struct pipe_buf *buf)
+{
+    pthread_mutex_lock(&params->mutex);
+    assert(q->count < PIPE_DEPTH);
+    q->bufs[(q->head + q->count) % PIPE_DEPTH] = buf;
+    q->count++;
+    pthread_cond_broadcast(&params->cond);
+    pthread_mutex_unlock(&params->mutex);
+}
+
+//!
+//! Tells the consumer of a queue that nothing more will be added to it
+//!
+//! @param[in] params the request
+//! @param[in] q the queue
+//!
+static void pipe_close(struct request *params, struct pipe_queue *q)
+{
+    pthread_mutex_lock(&params->mutex);
+    q->closed = TRUE;
+    pthread_cond_broadcast(&params->cond);
+    pthread_mutex_unlock(&params->mutex);
+}
+
+//!
+//! Records the failure of a stage, which stops all the others
+//!
+//! @param[in] params the request
+//! @param[in] error the error code to report
+//!
+static void pipe_fail(struct request *params, int error)
+{
+    pthread_mutex_lock(&params->mutex);
+    if (params->error == EUCA_OK)
+        params->error = error;
+    pthread_cond_broadcast(&params->cond);
+    pthread_mutex_unlock(&params->mutex);
+}
+
+//!
+//! Resets the queues of a request and starts the threads of its pipeline,
+//! once per download attempt
+//!
+//! @param[in] params the request
+//!
+//! @return EUCA_OK on success or EUCA_THREAD_ERROR
+//!
+static int pipe_start(struct request *params)
+{
+    struct pipe_queue empty = { {0} };
+
+    params->raw_free = params->raw_full = params->out_free = params->out_full = empty;
+    for (int i = 0; i < PIPE_DEPTH; i++) {
+        params->out[i].len = 0;
+        params->raw[i].len = 0;
+        pipe_put(params, &params->out_free, &params->out[i]);
+        if (params->do_compress)
+            pipe_put(params, &params->raw_free, &params->raw[i]);
+    }
+    params->cur = NULL;
+    params->error = EUCA_OK;
+    params->inflating = FALSE;
+    params->writing = FALSE;
+
+    if (pthread_create(&params->writer, NULL, pipe_writer, params) != 0) {
+        LOGERROR("failed to start the download writer thread\n");
+        return (EUCA_THREAD_ERROR);
+    }
+    params->writing = TRUE;
+#if defined(CAN_GZIP)
+    if (params->do_compress) {
+        if (pthread_create(&params->inflater, NULL, pipe_inflater, params) != 0) {
+            LOGERROR("failed to start the download inflater thread\n");
+            pipe_fail(params, EUCA_THREAD_ERROR);
+            pipe_finish(params);
+            return (EUCA_THREAD_ERROR);
+        }
+        params->inflating = TRUE;
+    }
+#endif /* CAN_GZIP */
+    return (EUCA_OK);
+}
+
+//!
+//! Hands the last buffer curl filled to the pipeline and waits for all the
+//! data to be inflated and written
+//!
+//! @param[in] params the request
+//!
+//! @return EUCA_OK if everything received was stored or the error of the failed stage
+//!
+static int pipe_finish(struct request *params)
+{
+    struct pipe_queue *full = (params->do_compress ? &params->raw_full : &params->out_full);
+
+    if (params->cur != NULL) {
+        pipe_put(params, full, params->cur);
+        params->cur = NULL;
+    }
+    pipe_close(params, full);
+    if (params->inflating)
+        pthread_join(params->inflater, NULL);
+    else
+        pipe_close(params, &params->out_full);
+    if (params->writing)
+        pthread_join(params->writer, NULL);
+    params->inflating = params->writing = FALSE;
+    return (params->error);
+}
+
+//!
+//! Writer stage of the download pipeline: writes out buffers to the output
+//! file in the order they were queued
+//!
+//! @param[in] arg the request
+//!
+//! @return NULL
+//!
+static void *pipe_writer(void *arg)
+{
+    struct request *params = (struct request *)arg;
+    struct pipe_buf *buf = NULL;
+    ssize_t wrote = 0;
+
+    while ((buf = pipe_get(params, &params->out_full)) != NULL) {
+        for (size_t done = 0; done < buf->len; done += wrote) {
+            if ((wrote = pwrite(params->fd, buf->data + done, buf->len - done, params->total_wrote)) <= 0) {
+                LOGERROR("failed to write downloaded data: %s\n", strerror(errno));
+                pipe_fail(params, EUCA_IO_ERROR);
+                return (NULL);
+            }
+            params->total_wrote += wrote;
+        }
+        buf->len = 0;
+        pipe_put(params, &params->out_free, buf);
+    }
+    return (NULL);
+}
+
 //!
 //! libcurl header write handler
 //!
@@ -669,26 +1040,85 @@ static size_t write_header(void *buffer, size_t size, size_t nmemb, void *params
 }
 
 //!
-//! libcurl write handler
+//! libcurl write handler, which copies the received data into the buffers of
+//! the download pipeline
 //!
 //! @param[in] buffer
 //! @param[in] size
 //! @param[in] nmemb
 //! @param[in] params
 //!
-//! @return the number of bytes written. If the returned value does not match
+//! @return the number of bytes taken. If the returned value does not match
 //!         size*nmemb, then libcurl will return an error.
 //!
 static size_t write_data(void *buffer, size_t size, size_t nmemb, void *params)
 {
     assert(params != NULL);
 
-    int fd = ((struct request *)params)->fd;
-    int wrote = write(fd, buffer, size * nmemb);    // any blocking in this call is not subject to connection timeouts
-    ((struct request *)params)->total_wrote += wrote;
-    ((struct request *)params)->total_calls++;
+    struct request *req = (struct request *)params;
+    struct pipe_queue *free_q = (req->do_compress ? &req->raw_free : &req->out_free);
+    struct pipe_queue *full_q = (req->do_compress ? &req->raw_full : &req->out_full);
+    size_t len = size * nmemb;
+    size_t copied = 0;
+    size_t n = 0;
+
+    // we only block here when every buffer is waiting on the next stage
+    while (copied < len) {
+        if ((req->cur == NULL) && ((req->cur = pipe_get(req, free_q)) == NULL))
+            return (copied);           // a later stage failed
+        n = MIN((len - copied), (PIPE_BUF_BYTES - req->cur->len));
+        memcpy(req->cur->data + req->cur->len, ((unsigned char *)buffer) + copied, n);
+        req->cur->len += n;
+        copied += n;
+        if (req->cur->len == PIPE_BUF_BYTES) {
+            pipe_put(req, full_q, req->cur);
+            req->cur = NULL;
+        }
+    }
+    req->total_calls++;
+    return (len);
+}
 
-    return wrote;
+//!
+//! libcurl write handler for responses kept in memory
+//!
+//! @param[in] buffer
+//! @param[in] size
+//! @param[in] nmemb
+//! @param[in] params
+//!
+//! @return the number of bytes taken. If the returned value does not match
+//!         size*nmemb, then libcurl will return an error.
+//!
+static size_t write_data_mem(void *buffer, size_t size, size_t nmemb, void *params)
+{
+    assert(params != NULL);
+
+    struct request *req = (struct request *)params;
+    size_t len = size * nmemb;
+    size_t new_size = 0;
+    char *mem = NULL;
+
+    if ((req->mem_len + len) >= DIGEST_MAX_BYTES) {
+        LOGERROR("objectstorage reply is larger than %d bytes\n", DIGEST_MAX_BYTES);
+        return (0);
+    }
+
+    if ((req->mem_len + len + 1) > req->mem_size) {
+        new_size = MAX((req->mem_size * 2), (req->mem_len + len + 1));
+        if ((mem = EUCA_REALLOC(req->mem, new_size, sizeof(char))) == NULL) {
+            LOGERROR("out of memory (failed to grow objectstorage reply to %lu bytes)\n", (unsigned long)new_size);
+            return (0);
+        }
+        req->mem = mem;
+        req->mem_size = new_size;
+    }
+    memcpy(req->mem + req->mem_len, buffer, len);
+    req->mem_len += len;
+    req->mem[req->mem_len] = '\0';
+    req->total_wrote += len;
+    req->total_calls++;
+    return (len);
 }
 
 #if defined(CAN_GZIP)
@@ -739,57 +1169,60 @@ static void zerr(int ret, char *where)
 }
 
 //!
-//! libcurl write handler for gzipped streams
+//! Inflater stage of the download pipeline for gzipped streams: decompresses
+//! raw buffers into out buffers and hands those to the writer
 //!
-//! @param[in] buffer
-//! @param[in] size
-//! @param[in] nmemb
-//! @param[in] params
+//! @param[in] arg the request
 //!
-//! @return the number of bytes written. If the returned value does not match
-//!         size*nmemb, then libcurl will return an error.
+//! @return NULL
 //!
-static size_t write_data_zlib(void *buffer, size_t size, size_t nmemb, void *params)
+static void *pipe_inflater(void *arg)
 {
-    assert(params != NULL);
-    z_stream *strm = &(((struct request *)params)->strm);
-    int fd = ((struct request *)params)->fd;
-    unsigned char out[CHUNK];
-    int wrote = 0;
-    int ret;
-
-    // any blocking in this function is not subject to connection timeouts
-
-    strm->avail_in = size * nmemb;
-    strm->next_in = (unsigned char *)buffer;
-    do {
-        strm->avail_out = CHUNK;
-        strm->next_out = out;
-
-        ((struct request *)params)->ret = ret = inflate(strm, Z_NO_FLUSH);
-        switch (ret) {
-        case Z_NEED_DICT:
-            ret = Z_DATA_ERROR;        // ok to fall through
-        case Z_DATA_ERROR:
-        case Z_MEM_ERROR:
-        case Z_STREAM_ERROR:
-            inflateEnd(strm);
-            zerr(ret, "write_data_zlib");
-            return ret;
-        }
+    struct request *params = (struct request *)arg;
+    z_stream *strm = &(params->strm);
+    struct pipe_buf *in = NULL;
+    struct pipe_buf *out = NULL;
+    int ret = Z_OK;
+    boolean failed = FALSE;
+
+    while ((in = pipe_get(params, &params->raw_full)) != NULL) {
+        strm->avail_in = in->len;
+        strm->next_in = in->data;
+        while ((strm->avail_in > 0) && (ret != Z_STREAM_END)) {
+            if ((out == NULL) && ((out = pipe_get(params, &params->out_free)) == NULL))
+                break;                 // the writer failed
+
+            strm->avail_out = PIPE_BUF_BYTES - out->len;
+            strm->next_out = out->data + out->len;
+            params->ret = ret = inflate(strm, Z_NO_FLUSH);
+            switch (ret) {
+            case Z_NEED_DICT:
+                ret = Z_DATA_ERROR;    // ok to fall through
+            case Z_DATA_ERROR:
+            case Z_MEM_ERROR:
+            case Z_STREAM_ERROR:
+                zerr(ret, "pipe_inflater");
+                pipe_fail(params, EUCA_ERROR);
+                failed = TRUE;
+                break;
+            }
+            if (failed)
+                break;
 
-        unsigned have = CHUNK - strm->avail_out;
-        if (write(fd, out, have) != have) {
-            LOGERROR("write call with compressed data failed\n");
-            inflateEnd(strm);
-            return Z_ERRNO;
+            out->len = PIPE_BUF_BYTES - strm->avail_out;
+            if (out->len == PIPE_BUF_BYTES) {
+                pipe_put(params, &params->out_full, out);
+                out = NULL;
+            }
         }
-        wrote += have;
-    } while (strm->avail_out == 0);
+        in->len = 0;
+        pipe_put(params, &params->raw_free, in);
+    }
 
-    ((struct request *)params)->total_wrote += wrote;
-    ((struct request *)params)->total_calls++;
-    return size * nmemb;
+    if (out != NULL)
+        pipe_put(params, ((out->len > 0) ? &params->out_full : &params->out_free), out);
+    pipe_close(params, &params->out_full);
+    return (NULL);
 }
 #endif /* CAN_GZIP */
 
@@ -84,6 +84,7 @@
 #include <sys/stat.h>
 #include <sys/wait.h>                  // waitpid
 #include <stdarg.h>
+#include <pthread.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <limits.h>
@@ -120,6 +121,7 @@
 #define CREATE                                   1
 
 #define ARTIFACT_RETRY_SLEEP_USEC                500000LL
+#define ARTIFACT_MAX_WORKERS                           8    //!< process-wide limit on threads implementing independent dependencies concurrently
 
 #ifdef _UNIT_TEST
 #define BS_SIZE                                  20000000000 / 512
@@ -156,6 +158,23 @@
  |                                                                            |
 \*----------------------------------------------------------------------------*/
 
+//! A dependency subtree implemented by a thread of its own
+typedef struct _art_worker {
+    artifact *dep;                     //!< root of the subtree
+    blobstore *work_bs;                //!< work blobstore to pass to art_implement_tree()
+    blobstore *cache_bs;               //!< OPTIONAL cache blobstore to pass to art_implement_tree()
+    const char *work_prefix;           //!< OPTIONAL work prefix to pass to art_implement_tree()
+    long long timeout_usec;            //!< timeout to pass to art_implement_tree()
+    boolean hold;                      //!< keep the dependency open until released, for the creator of the parent
+    boolean started;                   //!< the thread is running and must be released
+    boolean done;                      //!< the subtree has been implemented, or failed to, and ret is set
+    boolean released;                  //!< the parent no longer needs the dependency
+    int ret;                           //!< what art_implement_tree() returned
+    pthread_t thread;
+    pthread_mutex_t mutex;             //!< protects done, released and ret
+    pthread_cond_t cond;               //!< signals changes to done and released
+} art_worker;
+
 /*----------------------------------------------------------------------------*\
  |                                                                            |
  |                             EXTERNAL VARIABLES                             |
@@ -186,6 +205,8 @@ const char *euca_client_component_name = "nc";  //!< The client component name
 
 static __thread char current_instanceId[512] = "";  //!< instance ID that is being serviced, for logging only
 static sem *hostconfig_sem;
+static pthread_mutex_t art_workers_mutex = PTHREAD_MUTEX_INITIALIZER;   //!< protects the count below
+static int art_workers_busy = 0;       //!< number of art_worker threads in the process
 
 #ifdef _UNIT_TEST
 static blobstore *cache_bs = NULL;
@@ -242,6 +263,14 @@ static artifact *art_alloc_disk(virtualBootRecord * vbr, artifact * prereqs[], i
                                 artifact * emi_disk, boolean do_make_work_copy, boolean is_migration_dest);
 static int find_or_create_blob(int flags, blobstore * bs, const char *id, long long size_bytes, const char *sig, blockblob ** bbp);
 static int find_or_create_artifact(int do_create, artifact * a, blobstore * work_bs, blobstore * cache_bs, const char *work_prefix, blockblob ** bbp);
+static boolean art_has_id(artifact * a, const char *id);
+static boolean art_shares_id(artifact * a, artifact * b);
+static boolean art_is_unshared(artifact * a);
+static boolean art_is_independent(artifact * root, int idx);
+static void *art_worker_thread(void *arg);
+static int art_start_worker(art_worker * w);
+static int art_wait_worker(art_worker * w);
+static void art_release_worker(art_worker * w);
 
 #ifdef _UNIT_TEST
 static blobstore *create_teststore(int size_blocks, const char *base, const char *name, blobstore_format_t format, blobstore_revocation_t revocation,
@@ -2660,6 +2689,204 @@ try_work:
     return find_or_create_blob(flags, work_bs, id_work, size_bytes, a->sig, bbp);
 }
 
+//!
+//! Tells whether an artifact or any of its dependencies has the given ID
+//!
+//! @param[in] a root of the subtree
+//! @param[in] id the ID to look for
+//!
+//! @return TRUE if the ID was found
+//!
+static boolean art_has_id(artifact * a, const char *id)
+{
+    if (!strcmp(a->id, id))
+        return (TRUE);
+
+    for (int i = 0; i < MAX_ARTIFACT_DEPS && a->deps[i]; i++) {
+        if (art_has_id(a->deps[i], id))
+            return (TRUE);
+    }
+    return (FALSE);
+}
+
+//!
+//! Tells whether two subtrees have artifacts with the same ID, which would compete for the same blob
+//!
+//! @param[in] a root of one subtree
+//! @param[in] b root of the other subtree
+//!
+//! @return TRUE if some ID is in both
+//!
+static boolean art_shares_id(artifact * a, artifact * b)
+{
+    if (art_has_id(b, a->id))
+        return (TRUE);
+
+    for (int i = 0; i < MAX_ARTIFACT_DEPS && a->deps[i]; i++) {
+        if (art_shares_id(a->deps[i], b))
+            return (TRUE);
+    }
+    return (FALSE);
+}
+
+//!
+//! Tells whether no artifact in a subtree is also a dependency of an artifact outside of it
+//!
+//! @param[in] a root of the subtree
+//!
+//! @return TRUE if the subtree shares no artifacts
+//!
+static boolean art_is_unshared(artifact * a)
+{
+    if (a->refs > 1)
+        return (FALSE);
+
+    for (int i = 0; i < MAX_ARTIFACT_DEPS && a->deps[i]; i++) {
+        if (!art_is_unshared(a->deps[i]))
+            return (FALSE);
+    }
+    return (TRUE);
+}
+
+//!
+//! Tells whether a dependency can be implemented concurrently with the other dependencies
+//! of the same artifact, which is the case if its subtree shares neither artifacts nor blob
+//! IDs with them
+//!
+//! @param[in] root the artifact
+//! @param[in] idx index of the dependency in root->deps[]
+//!
+//! @return TRUE if the subtree is independent of its siblings
+//!
+static boolean art_is_independent(artifact * root, int idx)
+{
+    if (!art_is_unshared(root->deps[idx]))
+        return (FALSE);
+
+    for (int i = 0; i < MAX_ARTIFACT_DEPS && root->deps[i]; i++) {
+        if ((i != idx) && art_shares_id(root->deps[idx], root->deps[i]))
+            return (FALSE);
+    }
+    return (TRUE);
+}
+
+//!
+//! Thread that implements a dependency subtree and, if asked to hold it, keeps it
+//! open until the parent is done with it. Blobs are locked by the thread that opens
+//! them, so the thread that implemented the dependency must also be the one that
+//! closes it.
+//!
+//! @param[in] arg pointer to the art_worker
+//!
+//! @return NULL
+//!
+static void *art_worker_thread(void *arg)
+{
+    int ret = EUCA_OK;
+    art_worker *w = ((art_worker *) arg);
+
+    art_set_instanceId(w->dep->instanceId);
+    ret = art_implement_tree(w->dep, w->work_bs, w->cache_bs, w->work_prefix, w->timeout_usec);
+
+    pthread_mutex_lock(&(w->mutex));
+    {
+        w->ret = ret;
+        w->done = TRUE;
+        pthread_cond_broadcast(&(w->cond));
+        while (w->hold && !w->released)
+            pthread_cond_wait(&(w->cond), &(w->mutex));
+    }
+    pthread_mutex_unlock(&(w->mutex));
+
+    if ((ret == EUCA_OK) && w->dep->bb && (blockblob_close(w->dep->bb) == -1)) {
+        LOGERROR("[%s] failed to close dependency %s: %d %s (potential resource leak!)\n", w->dep->instanceId, w->dep->id, blobstore_get_error(),
+                 blobstore_get_last_msg());
+    }
+    w->dep->bb = NULL;
+    return (NULL);
+}
+
+//!
+//! Starts a thread implementing a dependency subtree, unless the process already
+//! runs ARTIFACT_MAX_WORKERS of them
+//!
+//! @param[in] w the worker, with dep, work_bs, cache_bs, work_prefix, timeout_usec and hold set
+//!
+//! @return EUCA_OK if the thread was started, in which case art_release_worker() must be called,
+//!         or EUCA_THREAD_ERROR if the caller should implement the dependency itself
+//!
+static int art_start_worker(art_worker * w)
+{
+    pthread_mutex_lock(&art_workers_mutex);
+    {
+        if (art_workers_busy >= ARTIFACT_MAX_WORKERS) {
+            pthread_mutex_unlock(&art_workers_mutex);
+            return (EUCA_THREAD_ERROR);
+        }
+        art_workers_busy++;
+    }
+    pthread_mutex_unlock(&art_workers_mutex);
+
+    pthread_mutex_init(&(w->mutex), NULL);
+    pthread_cond_init(&(w->cond), NULL);
+    if (pthread_create(&(w->thread), NULL, art_worker_thread, w) != 0) {
+        LOGWARN("[%s] failed to start a thread for dependency %s, implementing it sequentially\n", w->dep->instanceId, w->dep->id);
+        pthread_cond_destroy(&(w->cond));
+        pthread_mutex_destroy(&(w->mutex));
+        pthread_mutex_lock(&art_workers_mutex);
+        art_workers_busy--;
+        pthread_mutex_unlock(&art_workers_mutex);
+        return (EUCA_THREAD_ERROR);
+    }
+    w->started = TRUE;
+    return (EUCA_OK);
+}
+
+//!
+//! Waits for a worker to implement its dependency subtree
+//!
+//! @param[in] w the worker
+//!
+//! @return what art_implement_tree() returned for the subtree
+//!
+static int art_wait_worker(art_worker * w)
+{
+    int ret = EUCA_OK;
+
+    pthread_mutex_lock(&(w->mutex));
+    {
+        while (!w->done)
+            pthread_cond_wait(&(w->cond), &(w->mutex));
+        ret = w->ret;
+    }
+    pthread_mutex_unlock(&(w->mutex));
+    return (ret);
+}
+
+//!
+//! Lets a worker close its dependency and waits for its thread to exit
+//!
+//! @param[in] w the worker
+//!
+static void art_release_worker(art_worker * w)
+{
+    pthread_mutex_lock(&(w->mutex));
+    {
+        w->released = TRUE;
+        pthread_cond_broadcast(&(w->cond));
+    }
+    pthread_mutex_unlock(&(w->mutex));
+
+    pthread_join(w->thread, NULL);
+    pthread_cond_destroy(&(w->cond));
+    pthread_mutex_destroy(&(w->mutex));
+    w->started = FALSE;
+
+    pthread_mutex_lock(&art_workers_mutex);
+    art_workers_busy--;
+    pthread_mutex_unlock(&art_workers_mutex);
+}
+
 //!
 //! Traverse artifact tree and create/download/combine artifacts
 //!
@@ -2677,6 +2904,10 @@ try_work:
 //!
 //! Either way, none of the child blobs are open.
 //!
+//! Dependencies whose subtrees are independent of their siblings are implemented
+//! concurrently, each by a thread of its own (see art_is_independent()), so the
+//! time it takes is close to that of the slowest dependency rather than the sum.
+//!
 //! @param[in] root pointer to root of the tree
 //! @param[in] work_bs pointero to work blobstore
 //! @param[in] cache_bs pointer to OPTIONAL cache blobstore
@@ -2699,7 +2930,9 @@ int art_implement_tree(artifact * root, blobstore * work_bs, blobstore * cache_b
     int ret = EUCA_OK;
     int tries = 0;
     do {                               // we may have to retry multiple times due to competition
-        int num_opened_deps = 0;
+        int num_deps = 0;
+        boolean opened[MAX_ARTIFACT_DEPS] = { FALSE };  // dependencies this thread holds open for the creator
+        art_worker workers[MAX_ARTIFACT_DEPS] = { {0} };    // dependencies implemented by other threads
         boolean do_deps = TRUE;
         boolean do_create = TRUE;
 
@@ -2738,7 +2971,10 @@ int art_implement_tree(artifact * root, blobstore * work_bs, blobstore * cache_b
         // (though it could be created before we get around to that)
 
         if (do_deps) {                 // recursively go over dependencies, if any
-            for (int i = 0; i < MAX_ARTIFACT_DEPS && root->deps[i]; i++) {
+            while (num_deps < MAX_ARTIFACT_DEPS && root->deps[num_deps])
+                num_deps++;
+
+            for (int i = 0; i < num_deps; i++) {
 
                 // recalculate the time that remains in the timeout period
                 long long new_timeout_usec = timeout_usec;
@@ -2749,10 +2985,22 @@ int art_implement_tree(artifact * root, blobstore * work_bs, blobstore * cache_b
                         goto retry_or_fail;
                     }
                 }
+                // hand independent subtrees to other threads, if any are available, and do the rest here
+                if ((num_deps > 1) && art_is_independent(root, i)) {
+                    workers[i].dep = root->deps[i];
+                    workers[i].work_bs = work_bs;
+                    workers[i].cache_bs = cache_bs;
+                    workers[i].work_prefix = work_prefix;
+                    workers[i].timeout_usec = new_timeout_usec;
+                    workers[i].hold = do_create;
+                    if (art_start_worker(&(workers[i])) == EUCA_OK)
+                        continue;
+                }
+
                 switch (ret = art_implement_tree(root->deps[i], work_bs, cache_bs, work_prefix, new_timeout_usec)) {
                 case BLOBSTORE_ERROR_OK:
                     if (do_create) {   // we'll hold the dependency open for the creator
-                        num_opened_deps++;
+                        opened[i] = TRUE;
                     } else {           // this is a sentinel, we're not creating anything, so release the dep immediately
                         if (root->deps[i]->bb && (blockblob_close(root->deps[i]->bb) == -1)) {
                             LOGERROR("[%s] failed to close dependency of %s: %d %s (potential resource leak!) on try %d\n",
@@ -2769,6 +3017,22 @@ int art_implement_tree(artifact * root, blobstore * work_bs, blobstore * cache_b
                     goto retry_or_fail;
                 }
             }
+
+            // collect the dependencies implemented by other threads, which hold them open for the creator
+            for (int i = 0; i < num_deps; i++) {
+                if (!workers[i].started)
+                    continue;
+                switch (ret = art_wait_worker(&(workers[i]))) {
+                case BLOBSTORE_ERROR_OK:
+                    break;
+                case BLOBSTORE_ERROR_AGAIN:    // timed out => the competition took too long
+                case BLOBSTORE_ERROR_MFILE:    // out of file descriptors for locking => same problem
+                    goto retry_or_fail;
+                default:              // all other errors
+                    LOGERROR("[%s] failed to provision dependency %s for artifact %s (error=%d) on try %d\n", root->instanceId, root->deps[i]->id, root->id, ret, tries);
+                    goto retry_or_fail;
+                }
+            }
         }
         // at this point the dependencies, if any, needed to create
         // the artifact, have been created and opened (i.e. locked
@@ -2786,7 +3050,7 @@ int art_implement_tree(artifact * root, blobstore * work_bs, blobstore * cache_b
                 LOGDEBUG("[%s] bypassing redundant artifact %03d|%s on try %d\n", root->instanceId, root->seq, root->id, tries);
                 root->bb = root->deps[0]->bb;
                 root->deps[0]->bb = NULL;
-                num_opened_deps--;     // so we won't attempt to close deps's blockblob
+                opened[0] = FALSE;     // so we won't attempt to close deps's blockblob
             } else {
 
                 // try to create the artifact since last time we checked it did not exist
@@ -2834,25 +3098,34 @@ create:
                 if (root->vbr && root->vbr->type != NC_RESOURCE_EBS)
                     if (work_bs && blockblob_get_blobstore(root->bb) == work_bs)
                         update_vbr_with_backing_info(root);
+                // let variants of the same image share their identical chunks in the cache
+                if (!root->id_is_path && cache_bs && (blockblob_get_blobstore(root->bb) == cache_bs) && (blockblob_dedup(root->bb) == -1)) {
+                    LOGWARN("[%s] failed to deduplicate cached artifact %s: %s\n", root->instanceId, root->id, blobstore_get_last_msg());
+                }
             }
         }
 
 retry_or_fail:
         // close all opened dependent blobs, whether we're trying again or returning
-        for (int i = 0; i < num_opened_deps; i++) {
-            if (root->deps[i]->bb != NULL)
-                blockblob_close(root->deps[i]->bb);
-            root->deps[i]->bb = 0;     // for debugging
+        for (int i = 0; i < num_deps; i++) {
+            if (workers[i].started) {  // other threads close what they opened
+                art_release_worker(&(workers[i]));
+            } else if (opened[i]) {
+                if (root->deps[i]->bb != NULL)
+                    blockblob_close(root->deps[i]->bb);
+                root->deps[i]->bb = 0; // for debugging
+            }
         }
 
     } while ((ret == BLOBSTORE_ERROR_AGAIN || ret == BLOBSTORE_ERROR_MFILE) // only timeout-type error causes us to keep trying
              && (timeout_usec == 0     // indefinitely if there is no timeout at all
                  || (time_usec() - started) < timeout_usec));   // or until we exceed the timeout
 
+    root->implement_usec = time_usec() - started;
     if (ret != EUCA_OK) {
-        LOGDEBUG("[%s] failed to implement artifact %03d|%s on try %d\n", root->instanceId, root->seq, root->id, tries);
+        LOGDEBUG("[%s] failed to implement artifact %03d|%s on try %d in %lld ms\n", root->instanceId, root->seq, root->id, tries, root->implement_usec / 1000);
     } else {
-        LOGDEBUG("[%s] implemented artifact %03d|%s on try %d\n", root->instanceId, root->seq, root->id, tries);
+        LOGDEBUG("[%s] implemented artifact %03d|%s on try %d in %lld ms\n", root->instanceId, root->seq, root->id, tries, root->implement_usec / 1000);
     }
 
     return (ret);
@@ -131,6 +131,7 @@ typedef struct _artifact {
     struct _artifact *deps[MAX_ARTIFACT_DEPS];  //!< array of pointers to artifacts that this artifact depends on
     int seq;                           //!< sequence number of the artifact
     int refs;                          //!< reference counter (1 or more if contained in deps[] of others)
+    long long implement_usec;          //!< time art_implement_tree() took for the artifact, dependencies included
     char instanceId[32];               //!< here purely for annotating logs
     void *internal;                    //!< OPTIONAL pointer to any other artifact-specific data 'creator' may need
 } artifact;
@@ -477,6 +477,11 @@ typedef struct ncInstance_t {
     //! @name updated by NC upon Attach/Detach ENI in VPC mode
     netConfig secNetCfgs[EUCA_MAX_NICS]; //!< Instance's attached secondary ENIs
     //! @}
+
+    //! @{
+    //! @name maintained by the NC on its copy of the instance list, never persisted; must remain the last field
+    long long changeSeq;               //!< NC-wide change sequence number of the last modification to this instance
+    //! @}
 } ncInstance;
 
 //! Structure defining NC resource information
@@ -2477,6 +2477,34 @@ char *get_username(void)
     return passwd->pw_name;
 }
 
+//!
+//! Fills in a random (version 4) UUID string without forking uuidgen, so that
+//! it is safe to call from threads.
+//!
+//! @param[out] uuid a buffer of at least 37 characters
+//!
+//! @return EUCA_OK on success or EUCA_ERROR if no randomness could be read
+//!
+static int make_random_uuid(char *uuid)
+{
+    int fd = -1;
+    ssize_t len = 0;
+    unsigned char b[16] = { 0 };
+
+    if ((fd = open("/dev/urandom", O_RDONLY)) < 0)
+        return (EUCA_ERROR);
+    len = read(fd, b, sizeof(b));
+    close(fd);
+    if (len != sizeof(b))
+        return (EUCA_ERROR);
+
+    b[6] = (b[6] & 0x0f) | 0x40;
+    b[8] = (b[8] & 0x3f) | 0x80;
+    snprintf(uuid, 37, "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+             b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], b[8], b[9], b[10], b[11], b[12], b[13], b[14], b[15]);
+    return (EUCA_OK);
+}
+
 //! Make a correlation ID that is prefixed with the ID received from other components
 char *create_corrid(const char *id)
 {
@@ -2487,8 +2515,7 @@ char *create_corrid(const char *id)
         return NULL;
     // correlation_id = [prefix(36)::new_id(36)]
     if (id != NULL && strstr(id, "::") != NULL && strlen(id) >= 74) {
-        char *newid = system_output("uuidgen");
-        newid[strlen(newid) - 1] = '\0';
+        char newid[37] = "";
         memset(hex_id, '\0', 8);
         strncpy(hex_id, strstr(id, "::") + 11, 4);
         hex_val = strtol(hex_id, NULL, 16);
@@ -2500,13 +2527,12 @@ char *create_corrid(const char *id)
             }
             hex_id[0] = '0';
         }
-        if (newid != NULL) {
+        if (make_random_uuid(newid) == EUCA_OK) {
             new_corr_id = calloc(75, sizeof(char));
             strncpy(new_corr_id, id, 38);   // copy request id part
             strncpy(new_corr_id + 38, newid, 9);    // copy the first part of the uuid
             strncpy(new_corr_id + 47, hex_id, 4);   // copy the incremented hex string from base id
             strcpy(new_corr_id + 51, newid + 13);   // copy the remaining part of the uuid
-            EUCA_FREE(newid);
         }
     }
     return new_corr_id;